@@ -19,6 +19,30 @@
 # * limitations under the License.
 # *
 
+# Options before the test arguments set the run conditions, applied by the binary:
+#   --cpus <list>   pin to the CPUs in <list> ("3", "2-3", "1,3")
+#   --fifo <prio>   run the test thread with SCHED_FIFO priority <prio>
+#   --mlock         lock all memory with mlockall()
+#   --warmup <n>    untimed passes of every benchmark before the timed one
+#   --stable        --cpus <last CPU> --mlock --warmup 3
+# The first other argument, or "--", ends the options.
+
+while [ $# -gt 0 ]; do
+    case "$1" in
+        --cpus)   export CELLULAR_RUN_CPUS="$2"; shift 2 ;;
+        --fifo)   export CELLULAR_RUN_FIFO="$2"; shift 2 ;;
+        --mlock)  export CELLULAR_RUN_MLOCK=1; shift ;;
+        --warmup) export CELLULAR_RUN_WARMUP="$2"; shift 2 ;;
+        --stable)
+            export CELLULAR_RUN_CPUS="${CELLULAR_RUN_CPUS:-$(( $(getconf _NPROCESSORS_ONLN) - 1 ))}"
+            export CELLULAR_RUN_MLOCK=1
+            export CELLULAR_RUN_WARMUP="${CELLULAR_RUN_WARMUP:-3}"
+            shift ;;
+        --)       shift; break ;;
+        *)        break ;;
+    esac
+done
+
 cd "$(dirname "$0")"
 export LD_LIBRARY_PATH=/usr/lib:/lib:/home/root:./.
-./cellular_hal_test $@
+./cellular_hal_test "$@"
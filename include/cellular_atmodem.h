@@ -0,0 +1,126 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:*
+ * Copyright 2023 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file cellular_atmodem.h
+ * @brief AT-command modem emulator on a pseudo-terminal
+ *
+ * A thread holds the master side of a pty and answers the 3GPP TS 27.007 commands a
+ * cellular HAL sends over the modem's serial port: identity (+CGMI, +CGMM, +CGMR,
+ * +CGSN, +CIMI, +CCID, +CNUM), SIM (+CPIN), power (+CFUN), signal (+CSQ, +CESQ),
+ * network (+COPS, +CREG, +CEREG, +CGATT, +WS46), PDP contexts (+CGDCONT, +CGAUTH,
+ * +CGACT, +CGPADDR) and the V.250 basics (E, V, Z, I, &F, +CMEE). Commands may be
+ * concatenated with ';'. Anything else answers ERROR, as a modem lacking it would.
+ *
+ * The HAL under test opens the slave device like a serial port: the reference backend in
+ * skeletons/src with cellular_sim_set_at_device(), a vendor library through its own
+ * device setting or a symlink to the slave.
+ *
+ * Timing follows a serial link: every byte in each direction takes 10 bits at the baud
+ * rate, and a command waits its latency between its last byte in and its response.
+ * Responses which do not fit in the pty buffer are dropped, as on a serial line.
+ */
+
+#ifndef CELLULAR_ATMODEM_H
+#define CELLULAR_ATMODEM_H
+
+#include <stdint.h>
+
+#define CELLULAR_ATMODEM_DEFAULT_BAUD  115200
+#define CELLULAR_ATMODEM_MAX_LATENCIES 32
+#define CELLULAR_ATMODEM_MAX_COMMANDS  48
+#define CELLULAR_ATMODEM_IMEI          "352099001761481"
+#define CELLULAR_ATMODEM_FIRMWARE      "ATMODEM_1.0.0"
+
+/**
+ * @brief Emulator totals
+ */
+typedef struct
+{
+    uint64_t commands;           /*!< Commands answered, each part of a concatenated line counted */
+    uint64_t errors;             /*!< Commands answered with an error */
+    uint64_t bytes_in;
+    uint64_t bytes_out;
+    uint64_t bytes_dropped;      /*!< Response bytes the pty could not take */
+    unsigned int baud;           /*!< 0 when not pacing */
+} CellularAtmodemStats_t;
+
+/**
+ * @brief Opens the pty and starts answering on it
+ *
+ * @param[in] baud       - line rate the bytes are paced at, 0 for no pacing
+ * @param[in] latency_ms - latency of the commands without one of their own
+ *
+ * @return RETURN_OK, also when already started (the arguments are then ignored), RETURN_ERROR on failure
+ */
+int cellular_atmodem_start(unsigned int baud, unsigned int latency_ms);
+
+/**
+ * @brief Returns the slave device to open, NULL when not started
+ */
+const char *cellular_atmodem_path(void);
+
+/**
+ * @brief Points a symlink at the slave device, for a HAL with a fixed device path
+ *
+ * @param[in] pLink - path of the link; an existing symlink there is replaced, any other file is left alone
+ *
+ * @return RETURN_OK, RETURN_ERROR when not started or the link cannot be made
+ */
+int cellular_atmodem_link(const char *pLink);
+
+/**
+ * @brief Sets the latency of the commands starting with a prefix
+ *
+ * The prefix is matched against each command as sent, without AT and ignoring case, so
+ * "+COPS=?" sets the network scan and "+COPS" every +COPS form; the longest match wins.
+ *
+ * @param[in] pCommand - prefix, NULL for the default latency
+ * @param[in] ms       - latency, negative to remove the prefix
+ *
+ * @return RETURN_OK, RETURN_ERROR when CELLULAR_ATMODEM_MAX_LATENCIES prefixes are set
+ */
+int cellular_atmodem_set_latency(const char *pCommand, int ms);
+
+/**
+ * @brief Sets latencies from a list such as "5,+COPS=?:2000,+CGACT:300"
+ *
+ * A plain number is the default, prefix:ms the latency of a prefix.
+ *
+ * @return RETURN_OK, RETURN_ERROR when an entry is invalid; the valid entries are applied
+ */
+int cellular_atmodem_set_latencies(const char *pList);
+
+/**
+ * @brief Copies the totals
+ *
+ * @return RETURN_OK, RETURN_ERROR when pStats is NULL
+ */
+int cellular_atmodem_get_stats(CellularAtmodemStats_t *pStats);
+
+/**
+ * @brief Stops the thread and closes the pty; the emulated modem is back to its defaults on the next start
+ */
+void cellular_atmodem_stop(void);
+
+/**
+ * @brief Logs the totals and the count of every command, once any was answered
+ */
+void cellular_atmodem_report(void);
+
+#endif /* CELLULAR_ATMODEM_H */
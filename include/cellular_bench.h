@@ -0,0 +1,60 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:*
+ * Copyright 2023 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file cellular_bench.h
+ * @brief Timing helpers shared by the cellular HAL benchmark tests
+ */
+
+#ifndef CELLULAR_BENCH_H
+#define CELLULAR_BENCH_H
+
+#include <stdint.h>
+
+/**
+ * @brief Returns CLOCK_MONOTONIC in nanoseconds
+ */
+uint64_t cellular_bench_now_ns(void);
+
+/**
+ * @brief Returns the CPU time consumed by the whole process in nanoseconds
+ */
+uint64_t cellular_bench_process_cpu_ns(void);
+
+/**
+ * @brief Returns the CPU time consumed by the calling thread in nanoseconds
+ */
+uint64_t cellular_bench_thread_cpu_ns(void);
+
+/**
+ * @brief Sleeps for the given number of milliseconds, restarting on EINTR
+ */
+void cellular_bench_sleep_ms(unsigned int ms);
+
+/**
+ * @brief Returns the nearest-rank percentile of the samples, which are sorted in place
+ *
+ * @param[in,out] pSamples   - samples, in any order
+ * @param[in]     count      - number of samples
+ * @param[in]     percentile - 0 to 100
+ *
+ * @returns the sample at the percentile, 0 when there are none
+ */
+uint64_t cellular_bench_percentile(uint64_t *pSamples, unsigned int count, unsigned int percentile);
+
+#endif /* CELLULAR_BENCH_H */
@@ -0,0 +1,106 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:*
+ * Copyright 2023 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file cellular_census.h
+ * @brief Thread and file descriptor census around every test and HAL call
+ *
+ * /proc/self/task and /proc/self/fd are listed when a test or a cellular_hal_* call
+ * starts and again when it returns. Threads and descriptors present only in the second
+ * listing were created by the scope, those present only in the first were released.
+ * Every thread first seen after a scope is attributed to it, and its name and CPU time
+ * are followed until the end of the run.
+ *
+ * The listings are process wide: a HAL call overlapping another one on a different
+ * thread shares its attribution. Threads and descriptors released asynchronously after
+ * a call returns are attributed to the scope which observes their disappearance.
+ */
+
+#ifndef CELLULAR_CENSUS_H
+#define CELLULAR_CENSUS_H
+
+#include <stdint.h>
+#include "cellular_trace.h"
+
+/**
+ * @brief Thread and descriptor changes of one API or test
+ */
+typedef struct
+{
+    uint64_t calls;
+    uint64_t threads_created;
+    uint64_t threads_exited;
+    uint64_t fds_opened;
+    uint64_t fds_closed;
+} CellularCensusStats_t;
+
+/**
+ * @brief A thread seen by the census
+ */
+typedef struct
+{
+    int tid;
+    char name[16];
+    const char *pCreatedBy;    /*!< API or test title of the scope it appeared in, NULL when present at start */
+    uint64_t cpu_ns;           /*!< User and system time, at its last sighting once it has exited */
+    unsigned char alive;
+} CellularCensusThread_t;
+
+#define CELLULAR_CENSUS_MAX_THREADS 256
+
+/**
+ * @brief Starts the census by adding the test and HAL call probe, each start is matched by a cellular_census_stop()
+ *
+ * Add it before the other probes so their measurements do not include the listings.
+ *
+ * @return RETURN_OK, RETURN_ERROR when the probe could not be added
+ */
+int cellular_census_start(void);
+
+/**
+ * @brief Matches a cellular_census_start(); the last one removes the probe and clears the counts and threads
+ *
+ * Call it outside the HAL calls of other threads.
+ */
+void cellular_census_stop(void);
+
+/**
+ * @brief Counts the threads and open descriptors of the process
+ *
+ * @return RETURN_OK, RETURN_ERROR when /proc cannot be read
+ */
+int cellular_census_count(unsigned int *pThreads, unsigned int *pFds);
+
+/**
+ * @brief Copies the totals of one HAL API
+ */
+int cellular_census_get_api(CellularHalApi_t api, CellularCensusStats_t *pStats);
+
+/**
+ * @brief Copies the threads seen so far
+ *
+ * @return number of threads copied, at most @p max
+ */
+unsigned int cellular_census_get_threads(CellularCensusThread_t *pThreads, unsigned int max);
+
+/**
+ * @brief Logs the per test and per API changes and the thread table, nothing when not started
+ */
+void cellular_census_report(void);
+
+#endif /* CELLULAR_CENSUS_H */
@@ -0,0 +1,270 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:*
+ * Copyright 2023 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file cellular_ctl_protocol.h
+ * @brief Framed binary control protocol of the emulated modem
+ *
+ * A QMI/MBIM style protocol: each frame carries a message id, a transaction id and a
+ * list of type-length-value fields. A client may have many requests outstanding; the
+ * modem answers each when it completes, so responses can come out of order and are
+ * matched by transaction id. Indications have transaction 0 and arrive unrequested;
+ * those raised by a request come before its response.
+ *
+ * One frame is one datagram on a SOCK_SEQPACKET Unix socket, as one read of a cdc-wdm
+ * device returns one message. All integers are little-endian.
+ *
+ * | Offset | Size | Field |
+ * | :----: | :--: | :---- |
+ * | 0 | 1 | CELLULAR_CTL_MARKER |
+ * | 1 | 2 | frame length, header included |
+ * | 3 | 1 | CELLULAR_CTL_FLAG_* |
+ * | 4 | 2 | transaction |
+ * | 6 | 2 | message |
+ * | 8 | 2 | length of the TLVs |
+ * | 10 | | TLVs: 1 byte type, 2 bytes length, value |
+ *
+ * Every response has a CELLULAR_CTL_TLV_RESULT of two 16-bit words, the result
+ * (0 success, 1 failure) and a CELLULAR_CTL_ERROR_* code.
+ */
+
+#ifndef CELLULAR_CTL_PROTOCOL_H
+#define CELLULAR_CTL_PROTOCOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define CELLULAR_CTL_MARKER      0x01
+#define CELLULAR_CTL_HEADER_SIZE 10
+#define CELLULAR_CTL_MAX_FRAME   2048
+
+#define CELLULAR_CTL_FLAG_REQUEST    0x00
+#define CELLULAR_CTL_FLAG_RESPONSE   0x02
+#define CELLULAR_CTL_FLAG_INDICATION 0x04
+
+/**
+ * @brief Request messages, each answered by a response of the same id
+ */
+typedef enum
+{
+    CELLULAR_CTL_GET_IDENTITY = 1,          /*!< Response: the identity TLVs */
+    CELLULAR_CTL_GET_SIGNAL,                /*!< Response: CELLULAR_CTL_TLV_SIGNAL */
+    CELLULAR_CTL_GET_SERVING_SYSTEM,        /*!< Response: CELLULAR_CTL_TLV_SERVING */
+    CELLULAR_CTL_GET_CARD_STATUS,           /*!< Response: CELLULAR_CTL_TLV_CARD, one byte */
+    CELLULAR_CTL_SET_OPERATING_MODE,        /*!< Request: CELLULAR_CTL_TLV_ARG, one byte CELLULAR_CTL_MODE_* */
+    CELLULAR_CTL_GET_RAT_PREFERENCE,        /*!< Response: CELLULAR_CTL_TLV_RAT, one byte CELLULAR_CTL_RAT_* mask */
+    CELLULAR_CTL_SET_RAT_PREFERENCE,        /*!< Request: CELLULAR_CTL_TLV_ARG, one byte CELLULAR_CTL_RAT_* mask */
+    CELLULAR_CTL_ATTACH,                    /*!< Request: CELLULAR_CTL_TLV_ARG, one byte, 1 attach, 0 detach */
+    CELLULAR_CTL_SET_PROFILE,               /*!< Request: CELLULAR_CTL_TLV_ARG cid and the profile TLVs */
+    CELLULAR_CTL_DELETE_PROFILE,            /*!< Request: CELLULAR_CTL_TLV_ARG cid */
+    CELLULAR_CTL_START_NETWORK,             /*!< Request: CELLULAR_CTL_TLV_ARG cid; response: CELLULAR_CTL_TLV_HANDLE, 32 bits */
+    CELLULAR_CTL_STOP_NETWORK,              /*!< Request: CELLULAR_CTL_TLV_ARG cid, or no TLV for every context */
+    CELLULAR_CTL_MESSAGE_COUNT
+} CellularCtlMessage_t;
+
+#define CELLULAR_CTL_SERVING_INDICATION 0x0100  /*!< CELLULAR_CTL_TLV_SERVING, after every change */
+#define CELLULAR_CTL_PACKET_INDICATION  0x0101  /*!< CELLULAR_CTL_TLV_ARG cid and CELLULAR_CTL_TLV_CONNECTED */
+
+#define CELLULAR_CTL_TLV_ARG       0x01
+#define CELLULAR_CTL_TLV_RESULT    0x02
+#define CELLULAR_CTL_TLV_IMEI      0x10
+#define CELLULAR_CTL_TLV_IMEI_SV   0x11
+#define CELLULAR_CTL_TLV_FIRMWARE  0x12
+#define CELLULAR_CTL_TLV_ICCID     0x13
+#define CELLULAR_CTL_TLV_MSISDN    0x14
+#define CELLULAR_CTL_TLV_SIGNAL    0x20     /*!< RSSI, RSRQ, RSRP, SNR and TX power as signed 16 bits, CELLULAR_CTL_SIGNAL_UNKNOWN when not known */
+#define CELLULAR_CTL_TLV_SERVING   0x21     /*!< Registration, roaming, 16-bit MCC and MNC, CELLULAR_CTL_RAT_* in use, 16-bit area, 32-bit cell */
+#define CELLULAR_CTL_TLV_CARD      0x22     /*!< CELLULAR_CTL_CARD_* */
+#define CELLULAR_CTL_TLV_RAT       0x23
+#define CELLULAR_CTL_TLV_HANDLE    0x24
+#define CELLULAR_CTL_TLV_CONNECTED 0x25
+#define CELLULAR_CTL_TLV_PDP_TYPE  0x30     /*!< One byte: 0 IPv4, 1 IPv6, 2 IPv4v6, 3 PPP */
+#define CELLULAR_CTL_TLV_AUTH      0x31     /*!< One byte: 0 none, 1 PAP, 2 CHAP */
+#define CELLULAR_CTL_TLV_APN       0x32
+#define CELLULAR_CTL_TLV_USER      0x33
+#define CELLULAR_CTL_TLV_PASSWORD  0x34
+
+#define CELLULAR_CTL_SERVING_SIZE  13
+#define CELLULAR_CTL_SIGNAL_SIZE   10
+#define CELLULAR_CTL_SIGNAL_UNKNOWN (-32768)
+
+#define CELLULAR_CTL_ERROR_NONE          0
+#define CELLULAR_CTL_ERROR_MALFORMED     1
+#define CELLULAR_CTL_ERROR_INVALID_ARG   2
+#define CELLULAR_CTL_ERROR_NOT_ALLOWED   3
+#define CELLULAR_CTL_ERROR_NO_SERVICE    4
+#define CELLULAR_CTL_ERROR_BUSY          5
+#define CELLULAR_CTL_ERROR_NOT_SUPPORTED 6
+
+#define CELLULAR_CTL_MODE_ONLINE        0
+#define CELLULAR_CTL_MODE_OFFLINE       1
+#define CELLULAR_CTL_MODE_LOW_POWER     2
+#define CELLULAR_CTL_MODE_RESET         3
+#define CELLULAR_CTL_MODE_FACTORY_RESET 4
+
+#define CELLULAR_CTL_RAT_GSM  0x01
+#define CELLULAR_CTL_RAT_UMTS 0x02
+#define CELLULAR_CTL_RAT_LTE  0x04
+#define CELLULAR_CTL_RAT_NR   0x08
+
+#define CELLULAR_CTL_CARD_READY   0
+#define CELLULAR_CTL_CARD_BLOCKED 1
+#define CELLULAR_CTL_CARD_ERROR   2
+#define CELLULAR_CTL_CARD_ABSENT  3
+
+/**
+ * @brief A parsed frame, pointing into the received bytes
+ */
+typedef struct
+{
+    uint8_t flags;
+    uint16_t transaction;
+    uint16_t message;
+    const uint8_t *pTlvs;
+    uint16_t tlv_length;
+} CellularCtlFrame_t;
+
+static inline void cellular_ctl_put16(uint8_t *pOut, uint16_t value)
+{
+    pOut[0] = (uint8_t)value;
+    pOut[1] = (uint8_t)(value >> 8);
+}
+
+static inline void cellular_ctl_put32(uint8_t *pOut, uint32_t value)
+{
+    cellular_ctl_put16(pOut, (uint16_t)value);
+    cellular_ctl_put16(&pOut[2], (uint16_t)(value >> 16));
+}
+
+static inline uint16_t cellular_ctl_get16(const uint8_t *pIn)
+{
+    return (uint16_t)(pIn[0] | (pIn[1] << 8));
+}
+
+static inline uint32_t cellular_ctl_get32(const uint8_t *pIn)
+{
+    return (uint32_t)cellular_ctl_get16(pIn) | ((uint32_t)cellular_ctl_get16(&pIn[2]) << 16);
+}
+
+/**
+ * @brief Writes a header without lengths, returns the bytes used
+ */
+static inline size_t cellular_ctl_begin(uint8_t *pFrame, uint8_t flags, uint16_t transaction, uint16_t message)
+{
+    pFrame[0] = CELLULAR_CTL_MARKER;
+    pFrame[3] = flags;
+    cellular_ctl_put16(&pFrame[4], transaction);
+    cellular_ctl_put16(&pFrame[6], message);
+    return CELLULAR_CTL_HEADER_SIZE;
+}
+
+/**
+ * @brief Appends a TLV to a frame of CELLULAR_CTL_MAX_FRAME bytes
+ *
+ * @return 0, -1 when the frame would overflow
+ */
+static inline int cellular_ctl_add(uint8_t *pFrame, size_t *pUsed, uint8_t type, const void *pValue, size_t length)
+{
+    if (*pUsed + 3 + length > CELLULAR_CTL_MAX_FRAME)
+    {
+        return -1;
+    }
+    pFrame[*pUsed] = type;
+    cellular_ctl_put16(&pFrame[*pUsed + 1], (uint16_t)length);
+    if (length > 0)
+    {
+        memcpy(&pFrame[*pUsed + 3], pValue, length);
+    }
+    *pUsed += 3 + length;
+    return 0;
+}
+
+/**
+ * @brief Fills in the lengths, returns the frame size
+ */
+static inline size_t cellular_ctl_end(uint8_t *pFrame, size_t used)
+{
+    cellular_ctl_put16(&pFrame[1], (uint16_t)used);
+    cellular_ctl_put16(&pFrame[8], (uint16_t)(used - CELLULAR_CTL_HEADER_SIZE));
+    return used;
+}
+
+/**
+ * @brief Checks the header and that the TLVs tile the frame exactly
+ *
+ * @return 0, -1 for a malformed frame
+ */
+static inline int cellular_ctl_parse(const uint8_t *pData, size_t size, CellularCtlFrame_t *pFrame)
+{
+    size_t offset;
+
+    if ((size < CELLULAR_CTL_HEADER_SIZE) || (pData[0] != CELLULAR_CTL_MARKER) || (cellular_ctl_get16(&pData[1]) != size) ||
+        (cellular_ctl_get16(&pData[8]) != size - CELLULAR_CTL_HEADER_SIZE))
+    {
+        return -1;
+    }
+    for (offset = CELLULAR_CTL_HEADER_SIZE; offset < size; offset += 3 + cellular_ctl_get16(&pData[offset + 1]))
+    {
+        if ((offset + 3 > size) || (offset + 3 + cellular_ctl_get16(&pData[offset + 1]) > size))
+        {
+            return -1;
+        }
+    }
+    pFrame->flags = pData[3];
+    pFrame->transaction = cellular_ctl_get16(&pData[4]);
+    pFrame->message = cellular_ctl_get16(&pData[6]);
+    pFrame->pTlvs = &pData[CELLULAR_CTL_HEADER_SIZE];
+    pFrame->tlv_length = (uint16_t)(size - CELLULAR_CTL_HEADER_SIZE);
+    return 0;
+}
+
+/**
+ * @brief Returns the value of the first TLV of a type, NULL when absent
+ */
+static inline const uint8_t *cellular_ctl_find(const CellularCtlFrame_t *pFrame, uint8_t type, uint16_t *pLength)
+{
+    size_t offset;
+
+    for (offset = 0; offset < pFrame->tlv_length; offset += 3 + cellular_ctl_get16(&pFrame->pTlvs[offset + 1]))
+    {
+        if (pFrame->pTlvs[offset] == type)
+        {
+            *pLength = cellular_ctl_get16(&pFrame->pTlvs[offset + 1]);
+            return &pFrame->pTlvs[offset + 3];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Returns the name of a request message, NULL for an unknown id
+ */
+static inline const char *cellular_ctl_message_name(uint16_t message)
+{
+    static const char *names[CELLULAR_CTL_MESSAGE_COUNT] =
+    {
+        NULL, "get_identity", "get_signal", "get_serving_system", "get_card_status", "set_operating_mode",
+        "get_rat_preference", "set_rat_preference", "attach", "set_profile", "delete_profile",
+        "start_network", "stop_network"
+    };
+
+    return (message < CELLULAR_CTL_MESSAGE_COUNT) ? names[message] : NULL;
+}
+
+#endif /* CELLULAR_CTL_PROTOCOL_H */
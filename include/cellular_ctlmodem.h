@@ -0,0 +1,107 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:*
+ * Copyright 2023 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file cellular_ctlmodem.h
+ * @brief Binary control-protocol modem emulator on a Unix socket
+ *
+ * A thread listens on a SOCK_SEQPACKET socket and answers the framed requests of
+ * cellular_ctl_protocol.h, the counterpart of cellular_atmodem.h for modems with a
+ * QMI/MBIM style interface. The reference backend in skeletons/src connects with
+ * cellular_sim_set_ctl_device().
+ *
+ * Requests are not serialised: each completes its latency after it arrived, however
+ * many others are outstanding, and its response goes out then, so concurrent requests
+ * overlap and a short one overtakes a long one. Serving system and packet status
+ * changes are also sent as indications to every client.
+ */
+
+#ifndef CELLULAR_CTLMODEM_H
+#define CELLULAR_CTLMODEM_H
+
+#include <stdint.h>
+
+#define CELLULAR_CTLMODEM_MAX_CLIENTS 4
+#define CELLULAR_CTLMODEM_MAX_PENDING 64   /*!< Outstanding requests; more are answered CELLULAR_CTL_ERROR_BUSY at once */
+#define CELLULAR_CTLMODEM_IMEI        "352099001761481"
+#define CELLULAR_CTLMODEM_FIRMWARE    "CTLMODEM_1.0.0"
+
+/**
+ * @brief Emulator totals
+ */
+typedef struct
+{
+    uint64_t requests;           /*!< Requests answered */
+    uint64_t errors;             /*!< Requests answered with a failure result */
+    uint64_t indications;        /*!< Indications sent, one per client */
+    uint64_t malformed;          /*!< Frames dropped without an answer */
+    uint64_t dropped;            /*!< Frames a client socket could not take */
+    unsigned int max_outstanding;   /*!< Most requests in progress at once */
+} CellularCtlmodemStats_t;
+
+/**
+ * @brief Creates the socket and starts answering on it
+ *
+ * @param[in] latency_ms - latency of the messages without one of their own
+ *
+ * @return RETURN_OK, also when already started, RETURN_ERROR on failure
+ */
+int cellular_ctlmodem_start(unsigned int latency_ms);
+
+/**
+ * @brief Returns the socket path to connect to, NULL when not started
+ */
+const char *cellular_ctlmodem_path(void);
+
+/**
+ * @brief Sets the latency of a message
+ *
+ * @param[in] pMessage - message name of cellular_ctl_message_name(), NULL for the default latency
+ * @param[in] ms       - latency, negative to go back to the default
+ *
+ * @return RETURN_OK, RETURN_ERROR for an unknown message
+ */
+int cellular_ctlmodem_set_latency(const char *pMessage, int ms);
+
+/**
+ * @brief Sets latencies from a list such as "2,get_serving_system:50,start_network:300"
+ *
+ * A plain number is the default, message:ms the latency of a message.
+ *
+ * @return RETURN_OK, RETURN_ERROR when an entry is invalid; the valid entries are applied
+ */
+int cellular_ctlmodem_set_latencies(const char *pList);
+
+/**
+ * @brief Copies the totals
+ *
+ * @return RETURN_OK, RETURN_ERROR when pStats is NULL
+ */
+int cellular_ctlmodem_get_stats(CellularCtlmodemStats_t *pStats);
+
+/**
+ * @brief Stops the thread, disconnects the clients and removes the socket; the emulated modem is back to its defaults on the next start
+ */
+void cellular_ctlmodem_stop(void);
+
+/**
+ * @brief Logs the totals and the count of every message, once any was answered
+ */
+void cellular_ctlmodem_report(void);
+
+#endif /* CELLULAR_CTLMODEM_H */
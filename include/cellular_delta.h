@@ -0,0 +1,155 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:*
+ * Copyright 2023 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file cellular_delta.h
+ * @brief Change notification for PLMN information and interface status
+ *
+ * A single poller thread reads cellular_hal_get_current_plmn_information() and
+ * cellular_hal_get_current_modem_interface_status(), compares each reading with
+ * the previous one field by field and queues only the changed fields to the
+ * subscribers interested in them. Every subscriber owns an eventfd which becomes
+ * readable when a change is pending, so consumers can wait in epoll instead of
+ * polling the HAL themselves.
+ */
+
+#ifndef CELLULAR_DELTA_H
+#define CELLULAR_DELTA_H
+
+#include <stdint.h>
+#include "cellular_hal.h"
+
+/**
+ * @brief Field identifiers used in the change mask
+ */
+typedef enum
+{
+    CELLULAR_DELTA_PLMN_NAME           = (1 << 0),
+    CELLULAR_DELTA_MCC                 = (1 << 1),
+    CELLULAR_DELTA_MNC                 = (1 << 2),
+    CELLULAR_DELTA_REGISTRATION_STATUS = (1 << 3),
+    CELLULAR_DELTA_REGISTERED_SERVICE  = (1 << 4),
+    CELLULAR_DELTA_ROAMING_STATUS      = (1 << 5),
+    CELLULAR_DELTA_ROAMING_ENABLED     = (1 << 6),
+    CELLULAR_DELTA_AREA_CODE           = (1 << 7),
+    CELLULAR_DELTA_CELL_ID             = (1 << 8),
+    CELLULAR_DELTA_INTERFACE_STATUS    = (1 << 9)
+} CellularDeltaField_t;
+
+#define CELLULAR_DELTA_PLMN_ALL (CELLULAR_DELTA_PLMN_NAME | CELLULAR_DELTA_MCC | CELLULAR_DELTA_MNC | \
+                                 CELLULAR_DELTA_REGISTRATION_STATUS | CELLULAR_DELTA_REGISTERED_SERVICE | \
+                                 CELLULAR_DELTA_ROAMING_STATUS | CELLULAR_DELTA_ROAMING_ENABLED | \
+                                 CELLULAR_DELTA_AREA_CODE | CELLULAR_DELTA_CELL_ID)
+#define CELLULAR_DELTA_ALL (CELLULAR_DELTA_PLMN_ALL | CELLULAR_DELTA_INTERFACE_STATUS)
+
+/**
+ * @brief A change delivered to a subscriber
+ *
+ * Only the fields whose bit is set in @p changed carry meaningful values, every
+ * other field is left zeroed.
+ */
+typedef struct
+{
+    uint32_t changed;                     /*!< Mask of CellularDeltaField_t */
+    uint64_t sequence;                    /*!< Poll sequence number that detected the change */
+    uint64_t timestamp_ns;                /*!< CLOCK_MONOTONIC time of detection */
+    CellularCurrentPlmnInfoStruct plmn;   /*!< Changed PLMN fields */
+    CellularInterfaceStatus_t if_status;  /*!< Changed interface status */
+} CellularDeltaChange_t;
+
+/**
+ * @brief Counters kept by the delta engine
+ */
+typedef struct
+{
+    uint64_t polls;            /*!< Number of HAL reads performed by the poller */
+    uint64_t poll_errors;      /*!< HAL reads which did not return RETURN_OK */
+    uint64_t changes;          /*!< Polls which detected at least one changed field */
+    uint64_t notifications;    /*!< eventfd signals sent to subscribers */
+    uint64_t coalesced;        /*!< Changes merged into a full subscriber queue */
+} CellularDeltaStats_t;
+
+typedef struct cellular_delta_s cellular_delta_t;
+typedef struct cellular_delta_sub_s cellular_delta_sub_t;
+
+/**
+ * @brief Creates a delta engine polling the HAL every @p poll_interval_ms
+ *
+ * @return engine handle, or NULL on allocation failure
+ */
+cellular_delta_t *cellular_delta_create(unsigned int poll_interval_ms);
+
+/**
+ * @brief Starts the poller thread
+ *
+ * @return RETURN_OK on success, RETURN_ERROR otherwise
+ */
+int cellular_delta_start(cellular_delta_t *pDelta);
+
+/**
+ * @brief Stops the poller thread, if running, and releases the engine and all subscribers
+ */
+void cellular_delta_destroy(cellular_delta_t *pDelta);
+
+/**
+ * @brief Reads the HAL once and dispatches any changes
+ *
+ * Used by the poller thread, and directly by tests which need deterministic timing.
+ * The first call only establishes the baseline and reports every field as changed.
+ *
+ * @return mask of changed fields, or -1 if both HAL reads failed
+ */
+int cellular_delta_poll_once(cellular_delta_t *pDelta);
+
+/**
+ * @brief Registers a subscriber interested in the fields of @p field_mask
+ *
+ * @return subscriber handle, or NULL on failure
+ */
+cellular_delta_sub_t *cellular_delta_subscribe(cellular_delta_t *pDelta, uint32_t field_mask);
+
+/**
+ * @brief Removes a subscriber and closes its eventfd
+ */
+void cellular_delta_unsubscribe(cellular_delta_t *pDelta, cellular_delta_sub_t *pSub);
+
+/**
+ * @brief Returns the eventfd of a subscriber, suitable for epoll (EPOLLIN)
+ */
+int cellular_delta_subscriber_fd(const cellular_delta_sub_t *pSub);
+
+/**
+ * @brief Pops the oldest pending change of a subscriber
+ *
+ * @return 1 when @p pChange was filled, 0 when nothing is pending
+ */
+int cellular_delta_read(cellular_delta_sub_t *pSub, CellularDeltaChange_t *pChange);
+
+/**
+ * @brief Compares two PLMN readings
+ *
+ * @return mask of CellularDeltaField_t for the differing fields
+ */
+uint32_t cellular_delta_compare_plmn(const CellularCurrentPlmnInfoStruct *pPrev, const CellularCurrentPlmnInfoStruct *pCur);
+
+/**
+ * @brief Copies the engine counters
+ */
+void cellular_delta_get_stats(cellular_delta_t *pDelta, CellularDeltaStats_t *pStats);
+
+#endif /* CELLULAR_DELTA_H */
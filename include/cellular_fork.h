@@ -0,0 +1,80 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:*
+ * Copyright 2023 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file cellular_fork.h
+ * @brief Fork server: every test runs in a copy-on-write child of the initialized process
+ *
+ * The process running the suites initializes the HAL and the simulator once and runs no
+ * test itself. Each wrapped test runs in a child forked from it, so every test starts
+ * from the same state whatever the tests before it reset, powered off or deleted, and
+ * none pays for the initialization again. The child sends its assertion failures and
+ * benchmark results back over a pipe and the parent replays them in the test's scope;
+ * a child which dies before the test returns fails the test.
+ *
+ * Probes see the test scopes in the parent; the HAL call scopes run in the children and
+ * their counts are not carried back. The watchdog ends a test past its deadline by killing
+ * the child, but does not see the HAL calls, so API deadlines are not enforced. On the simulator the children use the in-memory
+ * modem even when the parent has an AT or control-protocol device.
+ *
+ * Before the first fork the parent times one serial re-initialization, a simulator reset
+ * and cellular_hal_init() until registered, to report the time forking saves per run.
+ */
+
+#ifndef CELLULAR_FORK_H
+#define CELLULAR_FORK_H
+
+#include <stdint.h>
+#include "cellular_trace.h"
+
+#define CELLULAR_FORK_REINIT_TIMEOUT_MS 60000
+
+/**
+ * @brief Totals of the forked tests, times in nanoseconds
+ */
+typedef struct
+{
+    unsigned int tests;          /*!< Tests run in a child */
+    unsigned int lost;           /*!< Children which died before their test returned */
+    uint64_t overhead_ns;        /*!< Fork until the child ran, plus test return until reaped, over all tests */
+    uint64_t reinit_ns;          /*!< One serial re-initialization, 0 when it did not register in time */
+} CellularForkStats_t;
+
+/**
+ * @brief Runs every wrapped test in a forked child from now on
+ *
+ * @return RETURN_OK, also when already started
+ */
+int cellular_fork_start(void);
+
+/**
+ * @brief Returns 1 when this process runs its wrapped tests in forked children, else 0
+ */
+int cellular_fork_active(void);
+
+/**
+ * @brief Copies the totals so far
+ */
+void cellular_fork_get_stats(CellularForkStats_t *pStats);
+
+/**
+ * @brief Logs the totals and the time saved against a serial re-initialization per test, if started
+ */
+void cellular_fork_report(void);
+
+#endif /* CELLULAR_FORK_H */
@@ -0,0 +1,118 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:*
+ * Copyright 2023 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file cellular_fuzz.h
+ * @brief In-process fuzzing of the HAL calls which take structs and strings
+ *
+ * Every target decodes an input of bytes into the arguments of one input-taking API,
+ * calls it and checks the result against what the HAL reports back: a profile created
+ * is listed as given, a radio technology accepted is read back unchanged, a rejected
+ * call leaves the state as it was. Strings are copied with their NUL terminator inside
+ * the array, as the API requires; enum and integer fields take any value.
+ *
+ * The loop is persistent: one process runs every input, with cellular_sim_reset() in
+ * between, so an exec costs the HAL call and the reset rather than a process start.
+ * Inputs are mutated from the seeds of the target, the corpus directory and every input
+ * which gave a new outcome, an outcome being a hash of the return codes and read-backs.
+ *
+ * Under the artifact directory the fuzzer writes fail-, slow- and crash-<target>-<hash>
+ * files, each a reproducer for CELLULAR_FUZZ_INPUT. A crash is caught by a signal
+ * handler which saves the input and re-raises; with AddressSanitizer run with
+ * ASAN_OPTIONS=abort_on_error=1 so the report ends in SIGABRT.
+ *
+ * Against a vendor HAL there is no reset and state carries over between execs.
+ */
+
+#ifndef CELLULAR_FUZZ_H
+#define CELLULAR_FUZZ_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CELLULAR_FUZZ_MAX_INPUT       1024
+#define CELLULAR_FUZZ_MAX_CORPUS      256
+#define CELLULAR_FUZZ_DEFAULT_RUNS    100000
+#define CELLULAR_FUZZ_DEFAULT_SLOW_US 10000
+
+/**
+ * @brief How long and where to fuzz
+ */
+typedef struct
+{
+    uint64_t runs;               /*!< Execs per target, 0 for no limit */
+    unsigned int seconds;        /*!< Time per target, 0 for no limit; one of runs and seconds must be set */
+    uint32_t seed;               /*!< Mutation seed, the same seed repeats the same inputs */
+    unsigned int slow_us;        /*!< An exec longer than this is saved as slow, 0 for CELLULAR_FUZZ_DEFAULT_SLOW_US */
+    const char *pDir;            /*!< Artifact directory, its <target> subdirectory holds the corpus; NULL writes nothing */
+} CellularFuzzOptions_t;
+
+/**
+ * @brief Results of one target
+ */
+typedef struct
+{
+    uint64_t execs;
+    uint64_t ns;                 /*!< Wall time of the loop, resets included */
+    uint64_t max_exec_ns;        /*!< Longest exec */
+    uint64_t failures;           /*!< Execs whose result did not match the read-back */
+    uint64_t slow;               /*!< Execs over slow_us */
+    unsigned int outcomes;       /*!< Distinct outcomes seen */
+    unsigned int corpus;         /*!< Inputs mutated from at the end */
+    double execs_per_sec;
+} CellularFuzzStats_t;
+
+/**
+ * @brief Returns the number of targets
+ */
+unsigned int cellular_fuzz_target_count(void);
+
+/**
+ * @brief Returns the name of a target, the API name without cellular_hal_, NULL past the last
+ */
+const char *cellular_fuzz_target_name(unsigned int index);
+
+/**
+ * @brief Resets the simulator and runs one input, for replaying a file or driving the targets from another fuzzer
+ *
+ * @param[in]  pTarget  - target name
+ * @param[in]  pData    - input, may be NULL when size is 0
+ * @param[in]  size     - input size; bytes past CELLULAR_FUZZ_MAX_INPUT are ignored
+ * @param[out] pOutcome - hash of the outcome, may be NULL
+ *
+ * @return RETURN_OK, RETURN_ERROR when the result does not match the read-back or the target is unknown
+ */
+int cellular_fuzz_one(const char *pTarget, const uint8_t *pData, size_t size, uint32_t *pOutcome);
+
+/**
+ * @brief Fuzzes one target
+ *
+ * @return RETURN_OK when no exec failed, RETURN_ERROR on failures, an unknown target or invalid options
+ */
+int cellular_fuzz_run(const char *pTarget, const CellularFuzzOptions_t *pOptions, CellularFuzzStats_t *pStats);
+
+/**
+ * @brief Fuzzes the targets of a list, "all" for every target, with the options of the CELLULAR_FUZZ_* variables, and logs a table
+ *
+ * With CELLULAR_FUZZ_INPUT set, replays that file on the first target of the list instead.
+ *
+ * @return RETURN_OK when no exec failed
+ */
+int cellular_fuzz_main(const char *pTargets);
+
+#endif /* CELLULAR_FUZZ_H */
@@ -0,0 +1,99 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:*
+ * Copyright 2023 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file cellular_lock.h
+ * @brief Mutex, rwlock and condition variable contention per lock and HAL API
+ *
+ * The test binary defines the pthread mutex, rwlock and condition variable entry points
+ * and forwards them to the C library, so locks taken by the skeleton or by a vendor
+ * library are seen the same way. A lock is tracked from the first time it is taken inside
+ * a cellular_hal_* call; from then on every acquisition is counted, by the API the
+ * acquiring thread is in, or as "outside HAL calls" for HAL and harness threads.
+ *
+ * Wait time is the time spent blocked in a lock call which could not take the lock at
+ * once, hold time runs from the acquisition to the unlock. Time spent in a condition wait
+ * counts as neither, it is reported separately. When an acquisition blocks, the API of the
+ * thread which took the lock last is recorded as the holder, which shows the APIs that
+ * serialize each other. Locks taken inside the C library itself are not seen.
+ */
+
+#ifndef CELLULAR_LOCK_H
+#define CELLULAR_LOCK_H
+
+#include <stdint.h>
+#include "cellular_trace.h"
+
+/**
+ * @brief Scope index of acquisitions made outside of any HAL call
+ */
+#define CELLULAR_LOCK_OUTSIDE CELLULAR_HAL_API_COUNT
+
+/**
+ * @brief Acquisitions of a lock by one scope
+ */
+typedef struct
+{
+    uint64_t acquisitions;
+    uint64_t contended;       /*!< Acquisitions which blocked, and failed try locks */
+    uint64_t wait_ns;
+    uint64_t max_wait_ns;
+    uint64_t hold_ns;
+    uint64_t max_hold_ns;
+    uint64_t cond_waits;      /*!< Condition waits on the lock as mutex */
+    uint64_t cond_wait_ns;
+} CellularLockStats_t;
+
+/**
+ * @brief Starts tracking by adding the HAL call probe, each start is matched by a cellular_lock_stop()
+ *
+ * @return RETURN_OK, RETURN_ERROR when the probe could not be added
+ */
+int cellular_lock_start(void);
+
+/**
+ * @brief Matches a cellular_lock_start(); the last one removes the probe, stops tracking and clears the locks
+ *
+ * Call it outside the HAL calls of other threads.
+ */
+void cellular_lock_stop(void);
+
+/**
+ * @brief Copies the totals of a scope
+ *
+ * @param[in]  pLock  - mutex or rwlock, NULL for all tracked locks
+ * @param[in]  scope  - CellularHalApi_t, or CELLULAR_LOCK_OUTSIDE
+ * @param[out] pStats - totals, all zero when the lock is not tracked
+ *
+ * @return RETURN_OK, RETURN_ERROR on invalid arguments
+ */
+int cellular_lock_get(const void *pLock, unsigned int scope, CellularLockStats_t *pStats);
+
+/**
+ * @brief Returns the time threads in scope @p waiter spent blocked on a lock last taken by scope @p holder
+ *
+ * @param[in] pLock - mutex or rwlock, NULL for all tracked locks
+ */
+uint64_t cellular_lock_get_blocked_ns(const void *pLock, unsigned int waiter, unsigned int holder);
+
+/**
+ * @brief Logs the per lock and API table and the APIs serialized behind each lock, nothing when not started
+ */
+void cellular_lock_report(void);
+
+#endif /* CELLULAR_LOCK_H */
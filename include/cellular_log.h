@@ -0,0 +1,127 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:*
+ * Copyright 2023 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file cellular_log.h
+ * @brief Asynchronous logging backend for the test harness
+ *
+ * A log call stores the format string pointer, the call site and the raw argument
+ * values in a lock-free ring owned by the calling thread; nothing is formatted and no
+ * I/O is done on the calling thread. A background thread formats the records and hands
+ * them to the ut-core log. String arguments are copied, so they may go out of scope
+ * after the call; format strings must be literals.
+ *
+ * Errors are written synchronously after the rings are flushed, so an error line is never
+ * seen before the lines logged ahead of it. Setting CELLULAR_LOG_ASYNC=0 in the environment
+ * formats every record synchronously, which gives the reference timing.
+ *
+ * Levels below CELLULAR_LOG_LEVEL are compiled out; their arguments are still type
+ * checked but never evaluated.
+ *
+ * A file defining CELLULAR_LOG_REPLACE_UT_LOG before including this header has its
+ * UT_LOG_DEBUG, UT_LOG_INFO, UT_LOG_WARNING and UT_LOG_ERROR calls routed here.
+ */
+
+#ifndef CELLULAR_LOG_H
+#define CELLULAR_LOG_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define CELLULAR_LOG_LEVEL_DEBUG   0
+#define CELLULAR_LOG_LEVEL_INFO    1
+#define CELLULAR_LOG_LEVEL_WARNING 2
+#define CELLULAR_LOG_LEVEL_ERROR   3
+#define CELLULAR_LOG_LEVEL_NONE    4
+
+#ifndef CELLULAR_LOG_LEVEL
+#define CELLULAR_LOG_LEVEL CELLULAR_LOG_LEVEL_DEBUG
+#endif
+
+/**
+ * @brief Logger counters
+ */
+typedef struct
+{
+    uint64_t records;       /*!< Records logged */
+    uint64_t formatted;     /*!< Records formatted by the background thread */
+    uint64_t synchronous;   /*!< Records formatted on the calling thread */
+    uint64_t stalls;        /*!< Log calls which found their ring full and drained the rings themselves */
+    uint32_t rings;         /*!< Rings allocated, one per thread logging at the same time */
+    uint32_t retired;       /*!< Rings left by exited threads, reused before another is allocated */
+} CellularLogStats_t;
+
+/**
+ * @brief Records one log line, use the CELLULAR_LOG_* macros instead
+ */
+void cellular_log_write(int level, const char *pFunction, int line, const char *pFormat, ...) __attribute__((format(printf, 4, 5)));
+
+/**
+ * @brief Writes out every record logged so far before returning
+ */
+void cellular_log_flush(void);
+
+/**
+ * @brief Returns 1 when records are formatted on the background thread
+ */
+int cellular_log_is_async(void);
+
+/**
+ * @brief Copies the logger counters
+ */
+void cellular_log_get_stats(CellularLogStats_t *pStats);
+
+#define CELLULAR_LOG_DISCARD(fmt, ...) do { if (0) { printf(fmt, ##__VA_ARGS__); } } while (0)
+
+#if CELLULAR_LOG_LEVEL <= CELLULAR_LOG_LEVEL_DEBUG
+#define CELLULAR_LOG_DEBUG(fmt, ...) cellular_log_write(CELLULAR_LOG_LEVEL_DEBUG, __FUNCTION__, __LINE__, fmt, ##__VA_ARGS__)
+#else
+#define CELLULAR_LOG_DEBUG(fmt, ...) CELLULAR_LOG_DISCARD(fmt, ##__VA_ARGS__)
+#endif
+
+#if CELLULAR_LOG_LEVEL <= CELLULAR_LOG_LEVEL_INFO
+#define CELLULAR_LOG_INFO(fmt, ...) cellular_log_write(CELLULAR_LOG_LEVEL_INFO, __FUNCTION__, __LINE__, fmt, ##__VA_ARGS__)
+#else
+#define CELLULAR_LOG_INFO(fmt, ...) CELLULAR_LOG_DISCARD(fmt, ##__VA_ARGS__)
+#endif
+
+#if CELLULAR_LOG_LEVEL <= CELLULAR_LOG_LEVEL_WARNING
+#define CELLULAR_LOG_WARNING(fmt, ...) cellular_log_write(CELLULAR_LOG_LEVEL_WARNING, __FUNCTION__, __LINE__, fmt, ##__VA_ARGS__)
+#else
+#define CELLULAR_LOG_WARNING(fmt, ...) CELLULAR_LOG_DISCARD(fmt, ##__VA_ARGS__)
+#endif
+
+#if CELLULAR_LOG_LEVEL <= CELLULAR_LOG_LEVEL_ERROR
+#define CELLULAR_LOG_ERROR(fmt, ...) cellular_log_write(CELLULAR_LOG_LEVEL_ERROR, __FUNCTION__, __LINE__, fmt, ##__VA_ARGS__)
+#else
+#define CELLULAR_LOG_ERROR(fmt, ...) CELLULAR_LOG_DISCARD(fmt, ##__VA_ARGS__)
+#endif
+
+#ifdef CELLULAR_LOG_REPLACE_UT_LOG
+#include <ut_log.h>
+#undef UT_LOG_DEBUG
+#undef UT_LOG_INFO
+#undef UT_LOG_WARNING
+#undef UT_LOG_ERROR
+#define UT_LOG_DEBUG   CELLULAR_LOG_DEBUG
+#define UT_LOG_INFO    CELLULAR_LOG_INFO
+#define UT_LOG_WARNING CELLULAR_LOG_WARNING
+#define UT_LOG_ERROR   CELLULAR_LOG_ERROR
+#endif
+
+#endif /* CELLULAR_LOG_H */
@@ -0,0 +1,101 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:*
+ * Copyright 2023 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file cellular_matrix.h
+ * @brief Runs the init/start/stop sequence over many profiles in parallel processes
+ *
+ * Every profile runs in its own forked process, so it gets its own copy of the HAL
+ * state; with the simulator linked the child also resets the modem first, giving each
+ * profile a fresh simulator instance. Up to @p jobs children run at a time. A child
+ * which crashes or overruns its deadline is reported as such instead of stopping the run.
+ */
+
+#ifndef CELLULAR_MATRIX_H
+#define CELLULAR_MATRIX_H
+
+#include <stdint.h>
+#include "cellular_hal.h"
+
+/**
+ * @brief Outcome of one profile
+ */
+typedef enum
+{
+    CELLULAR_MATRIX_PASS = 0,
+    CELLULAR_MATRIX_FAIL,        /*!< A HAL call failed or a callback did not arrive */
+    CELLULAR_MATRIX_TIMEOUT,     /*!< The child was killed at its deadline */
+    CELLULAR_MATRIX_CRASHED      /*!< The child died without reporting */
+} CellularMatrixStatus_t;
+
+/**
+ * @brief Result of one profile, times in microseconds
+ */
+typedef struct
+{
+    CellularProfileStruct profile;
+    CellularMatrixStatus_t status;
+    int init_result;
+    int start_result;
+    int stop_result;
+    unsigned char ip_ready;        /*!< Every requested IP family reported DEVICE_NETWORK_IP_READY */
+    unsigned char disconnected;    /*!< DEVICE_NETWORK_STATUS_DISCONNECTED reported after stop */
+    uint64_t init_us;              /*!< cellular_hal_init() call */
+    uint64_t start_us;             /*!< cellular_hal_start_network() call */
+    uint64_t ip_ready_us;          /*!< cellular_hal_start_network() until the last IP ready callback */
+    uint64_t stop_us;              /*!< cellular_hal_stop_network() until the disconnected callback */
+    uint64_t total_us;             /*!< Whole sequence as seen by the parent */
+} CellularMatrixResult_t;
+
+/**
+ * @brief Builds every PDPType x PDPAuthentication x PDPNetworkConfig combination of a profile
+ *
+ * ProfileID is incremented per combination so each one is distinct.
+ *
+ * @param[in]  pBase      - profile providing every other field
+ * @param[out] ppProfiles - allocated array, released by the caller with free()
+ *
+ * @return number of profiles, 0 on allocation failure
+ */
+unsigned int cellular_matrix_cartesian(const CellularProfileStruct *pBase, CellularProfileStruct **ppProfiles);
+
+/**
+ * @brief Runs every profile in its own process
+ *
+ * @param[in]  pProfiles  - profiles to run
+ * @param[in]  count      - number of profiles
+ * @param[in]  jobs       - maximum number of concurrent processes, 0 is treated as 1
+ * @param[in]  timeout_ms - callback wait budget of a profile; the child is killed one second after it
+ * @param[out] pResults   - @p count results in profile order
+ *
+ * @return number of profiles which passed, -1 on invalid arguments
+ */
+int cellular_matrix_run(const CellularProfileStruct *pProfiles, unsigned int count, unsigned int jobs,
+                        uint32_t timeout_ms, CellularMatrixResult_t *pResults);
+
+/**
+ * @brief Logs the results as one table
+ */
+void cellular_matrix_log(const CellularMatrixResult_t *pResults, unsigned int count);
+
+/**
+ * @brief Returns a printable name of a status
+ */
+const char *cellular_matrix_status_to_string(CellularMatrixStatus_t status);
+
+#endif /* CELLULAR_MATRIX_H */
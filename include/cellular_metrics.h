@@ -0,0 +1,134 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:*
+ * Copyright 2023 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file cellular_metrics.h
+ * @brief OpenMetrics export of the harness timings, counters and histograms
+ *
+ * The exporter owns a latency histogram per HAL API, the duration of every test and the
+ * benchmark results the tests publish with cellular_metrics_set(). Each instrumentation
+ * module registers a collector which writes its own families when an export is made,
+ * so an export always reflects the current totals.
+ *
+ * Names follow the OpenMetrics conventions: cellular_hal_* for HAL call scopes,
+ * cellular_test_* for test scopes and cellular_bench_* for benchmark results, times in
+ * seconds. Samples carry the labels api, test, and the extra labels of their family,
+ * followed on every sample by target (the build TARGET) and firmware (the modem
+ * firmware version) so results of different builds and releases can be told apart.
+ */
+
+#ifndef CELLULAR_METRICS_H
+#define CELLULAR_METRICS_H
+
+#include <stdio.h>
+#include "cellular_trace.h"
+
+/**
+ * @brief OpenMetrics family types in use
+ */
+typedef enum
+{
+    CELLULAR_METRIC_GAUGE = 0,
+    CELLULAR_METRIC_COUNTER,
+    CELLULAR_METRIC_HISTOGRAM
+} CellularMetricType_t;
+
+/**
+ * @brief Writes the families of one module with cellular_metrics_family() and cellular_metrics_sample()
+ */
+typedef void (*CellularMetricsCollector_t)(FILE *pOut);
+
+#define CELLULAR_METRICS_MAX_COLLECTORS 16
+#define CELLULAR_METRICS_MAX_RESULTS    256
+
+/**
+ * @brief Adds the HAL call latency and test duration probe
+ *
+ * @return RETURN_OK, RETURN_ERROR when the probe could not be added
+ */
+int cellular_metrics_start(void);
+
+/**
+ * @brief Adds a collector run on every export; adding the same collector twice has no effect
+ *
+ * @return RETURN_OK, RETURN_ERROR when CELLULAR_METRICS_MAX_COLLECTORS are already added
+ */
+int cellular_metrics_add_collector(CellularMetricsCollector_t collect);
+
+/**
+ * @brief Starts a family: writes its TYPE and HELP lines, and UNIT for names ending in _seconds
+ *
+ * @param[in] pName - family name, without the _total suffix of counters
+ */
+void cellular_metrics_family(FILE *pOut, const char *pName, CellularMetricType_t type, const char *pHelp);
+
+/**
+ * @brief Writes one sample of the current family
+ *
+ * The value is followed by label name and value pairs ending with NULL; a pair with a
+ * NULL value is skipped. The target and firmware labels are added.
+ *
+ * @param[in] pName - sample name, including any _total, _bucket, _count or _sum suffix
+ */
+void cellular_metrics_sample(FILE *pOut, const char *pName, double value, ...);
+
+/**
+ * @brief Publishes a benchmark result of the running test as the gauge cellular_bench_<pName>
+ *
+ * Setting the same name and variant again in the same test replaces the value.
+ *
+ * @param[in] pName    - name after cellular_bench_, in the base unit (seconds, calls, ...)
+ * @param[in] pHelp    - description of the result, used by the first setter of the name
+ * @param[in] pVariant - value of the variant label, NULL when the test has one result of this name
+ *
+ * @return RETURN_OK, RETURN_ERROR when CELLULAR_METRICS_MAX_RESULTS are already stored
+ */
+int cellular_metrics_set(const char *pName, const char *pHelp, const char *pVariant, double value);
+
+/**
+ * @brief Copies a benchmark result, in the order the results were first set
+ *
+ * The strings stay valid for the life of the process.
+ *
+ * @param[in]  index     - 0 for the first result
+ * @param[out] ppName    - name after cellular_bench_
+ * @param[out] ppHelp    - description
+ * @param[out] ppVariant - variant label, NULL when none
+ * @param[out] pValue    - value
+ *
+ * @return RETURN_OK, RETURN_ERROR past the last result or on a NULL argument
+ */
+int cellular_metrics_get_result(unsigned int index, const char **ppName, const char **ppHelp, const char **ppVariant, double *pValue);
+
+/**
+ * @brief Writes every family to a file, replacing it atomically
+ *
+ * @return RETURN_OK, RETURN_ERROR when the file cannot be written
+ */
+int cellular_metrics_write(const char *pPath);
+
+/**
+ * @brief Serves the families at http://127.0.0.1:<port>/metrics from a background thread
+ *
+ * @param[in] port - TCP port, 0 for any free port
+ *
+ * @return the port listened on, -1 on error; a second call returns the first port
+ */
+int cellular_metrics_serve(unsigned short port);
+
+#endif /* CELLULAR_METRICS_H */
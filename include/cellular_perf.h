@@ -0,0 +1,95 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:*
+ * Copyright 2023 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file cellular_perf.h
+ * @brief CPU and scheduler counters around every test and HAL call
+ *
+ * Each thread opens one perf_event group: task-clock, context switches and page faults,
+ * plus cycles and instructions when the PMU provides them. Without perf_event support
+ * (containers, perf_event_paranoid > 2) the thread CPU clock and getrusage() stand in.
+ *
+ * On-CPU time is the task clock of the calling thread; blocked time is the wall time of
+ * the scope minus it, i.e. the time spent waiting on the modem, a lock or the scheduler.
+ * Work done on HAL threads or in the kernel on behalf of another thread is not included.
+ */
+
+#ifndef CELLULAR_PERF_H
+#define CELLULAR_PERF_H
+
+#include <stdint.h>
+#include "cellular_trace.h"
+
+/**
+ * @brief Where the counters come from
+ */
+typedef enum
+{
+    CELLULAR_PERF_SOURCE_HARDWARE = 0,   /*!< perf_event software and PMU events */
+    CELLULAR_PERF_SOURCE_SOFTWARE,       /*!< perf_event software events only */
+    CELLULAR_PERF_SOURCE_RUSAGE          /*!< Thread CPU clock and getrusage() */
+} CellularPerfSource_t;
+
+/**
+ * @brief Counter totals; cycles and instructions stay 0 without the PMU
+ */
+typedef struct
+{
+    uint64_t calls;
+    uint64_t wall_ns;
+    uint64_t cpu_ns;
+    uint64_t context_switches;
+    uint64_t page_faults;
+    uint64_t cycles;
+    uint64_t instructions;
+} CellularPerfCounters_t;
+
+/**
+ * @brief Selects the counter source and adds the test and HAL call probe
+ *
+ * The source falls back from hardware to software to rusage as far as needed.
+ *
+ * @return the source in use
+ */
+CellularPerfSource_t cellular_perf_start(CellularPerfSource_t preferred);
+
+/**
+ * @brief Reads the running counters of the calling thread, calls is left at 0
+ *
+ * Usable without cellular_perf_start(); the source is then detected on first use.
+ *
+ * @return RETURN_OK, RETURN_ERROR on invalid argument
+ */
+int cellular_perf_read(CellularPerfCounters_t *pCounters);
+
+/**
+ * @brief Copies the totals of one HAL API
+ */
+int cellular_perf_get_api(CellularHalApi_t api, CellularPerfCounters_t *pCounters);
+
+/**
+ * @brief Logs the per test and per HAL API tables, nothing when not started
+ */
+void cellular_perf_report(void);
+
+/**
+ * @brief Returns a printable name of a source
+ */
+const char *cellular_perf_source_to_string(CellularPerfSource_t source);
+
+#endif /* CELLULAR_PERF_H */
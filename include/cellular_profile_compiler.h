@@ -0,0 +1,75 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:*
+ * Copyright 2023 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file cellular_profile_compiler.h
+ * @brief Compiles YAML test profiles into the binary profile store format
+ *
+ * Profiles are read from the YAML profile loaded by ut-core: the single profile at
+ * `cellular.config.profile` and every entry of the optional `cellular.profiles` list,
+ * which uses the same keys. Enum names are resolved once at compile time through
+ * lookup tables; an unknown name is an error rather than a silently unset field.
+ * The output is the file described in cellular_profile_store.h, which
+ * cellular_profile_file_map() maps straight into a CellularProfileStruct array.
+ */
+
+#ifndef CELLULAR_PROFILE_COMPILER_H
+#define CELLULAR_PROFILE_COMPILER_H
+
+#include "cellular_hal.h"
+
+#define CELLULAR_PROFILE_CONFIG_KEY "cellular.config.profile"
+#define CELLULAR_PROFILE_LIST_KEY   "cellular.profiles"
+
+/**
+ * @brief Reads one profile from the YAML profile
+ *
+ * @param[in]  pPrefix  - key of the profile mapping, e.g. "cellular.config.profile" or "cellular.profiles.3"
+ * @param[out] pProfile - resolved profile
+ *
+ * @return RETURN_OK on success, RETURN_ERROR when an enum name is not recognised
+ */
+int cellular_profile_from_kvp(const char *pPrefix, CellularProfileStruct *pProfile);
+
+/**
+ * @brief Resolves an enum name used in the YAML profile
+ *
+ * @param[in]  pField - profile field, one of "ProfileType", "PDPType", "PDPAuthentication", "PDPNetworkConfig"
+ * @param[in]  pName  - enum name, e.g. "CELLULAR_PDP_TYPE_IPV6"
+ * @param[out] pValue - enum value
+ *
+ * @return RETURN_OK on success, RETURN_ERROR for an unknown field or name
+ */
+int cellular_profile_enum_from_string(const char *pField, const char *pName, int *pValue);
+
+/**
+ * @brief Returns the enum name of a profile field value, NULL when unknown
+ */
+const char *cellular_profile_enum_to_string(const char *pField, int value);
+
+/**
+ * @brief Compiles every YAML profile into a profile store file
+ *
+ * @param[in]  pOutPath - output file
+ * @param[out] pCount   - number of profiles written, may be NULL
+ *
+ * @return RETURN_OK on success, RETURN_ERROR if a profile could not be resolved or the file written
+ */
+int cellular_profile_compile(const char *pOutPath, unsigned int *pCount);
+
+#endif /* CELLULAR_PROFILE_COMPILER_H */
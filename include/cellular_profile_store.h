@@ -0,0 +1,201 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:*
+ * Copyright 2023 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file cellular_profile_store.h
+ * @brief Local profile store indexed by ProfileID and APN, with binary persistence
+ *
+ * The store keeps CellularProfileStruct records with two sorted indices, one by
+ * ProfileID and one by APN. It is saved to a versioned binary file laid out as
+ *
+ * | Section | Content |
+ * | :-----: | :-----: |
+ * | header  | CellularProfileFileHeader_t |
+ * | records | count x CellularProfileStruct, enums already resolved |
+ * | by_id   | count x uint32_t record numbers sorted by ProfileID |
+ * | by_apn  | count x uint32_t record numbers sorted by APN |
+ *
+ * Every section is 8 byte aligned, so a mapped file is used in place: records are
+ * read as a CellularProfileStruct array and lookups binary search the indices
+ * without building anything at startup. The header records sizeof(CellularProfileStruct)
+ * so a file written against a different HAL header is rejected rather than misread.
+ */
+
+#ifndef CELLULAR_PROFILE_STORE_H
+#define CELLULAR_PROFILE_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "cellular_hal.h"
+
+#define CELLULAR_PROFILE_FILE_MAGIC   "CPRF"
+#define CELLULAR_PROFILE_FILE_VERSION 1
+
+/**
+ * @brief Header of a profile store file
+ */
+typedef struct
+{
+    char magic[4];             /*!< CELLULAR_PROFILE_FILE_MAGIC */
+    uint16_t version;          /*!< CELLULAR_PROFILE_FILE_VERSION */
+    uint16_t header_size;      /*!< sizeof(CellularProfileFileHeader_t) */
+    uint32_t record_size;      /*!< sizeof(CellularProfileStruct) of the writer */
+    uint32_t count;            /*!< Number of records */
+    uint32_t records_offset;
+    uint32_t by_id_offset;
+    uint32_t by_apn_offset;
+    uint32_t file_size;
+    uint32_t checksum;         /*!< FNV-1a over the bytes following the header */
+    uint32_t reserved;
+} CellularProfileFileHeader_t;
+
+/**
+ * @brief Read-only view of a mapped profile store file
+ */
+typedef struct
+{
+    const CellularProfileStruct *pRecords;
+    const uint32_t *pById;
+    const uint32_t *pByApn;
+    uint32_t count;
+    void *pBase;
+    size_t length;
+} CellularProfileFileView_t;
+
+/**
+ * @brief Result of a store to HAL synchronisation
+ */
+typedef struct
+{
+    unsigned int created;
+    unsigned int modified;
+    unsigned int deleted;
+    unsigned int unchanged;
+    unsigned int failed;       /*!< HAL create/modify/delete calls which did not return RETURN_OK */
+} CellularProfileSyncResult_t;
+
+typedef struct cellular_profile_store_s cellular_profile_store_t;
+
+/**
+ * @brief Maps a profile store file read-only and validates it
+ *
+ * @return RETURN_OK on success, RETURN_ERROR if the file is missing, truncated, corrupt or of another version or layout
+ */
+int cellular_profile_file_map(const char *pPath, CellularProfileFileView_t *pView);
+
+/**
+ * @brief Unmaps a view returned by cellular_profile_file_map()
+ */
+void cellular_profile_file_unmap(CellularProfileFileView_t *pView);
+
+/**
+ * @brief Binary searches a mapped file by ProfileID, NULL if absent
+ */
+const CellularProfileStruct *cellular_profile_file_find_by_id(const CellularProfileFileView_t *pView, int profileId);
+
+/**
+ * @brief Binary searches a mapped file by APN, NULL if absent
+ */
+const CellularProfileStruct *cellular_profile_file_find_by_apn(const CellularProfileFileView_t *pView, const char *pApn);
+
+/**
+ * @brief Compares the meaningful fields of two profiles
+ *
+ * @return 1 when equal, 0 otherwise
+ */
+int cellular_profile_equal(const CellularProfileStruct *pA, const CellularProfileStruct *pB);
+
+/**
+ * @brief Creates an empty store
+ */
+cellular_profile_store_t *cellular_profile_store_create(void);
+
+/**
+ * @brief Releases a store
+ */
+void cellular_profile_store_destroy(cellular_profile_store_t *pStore);
+
+/**
+ * @brief Replaces the store content with the records of a profile store file
+ *
+ * @return RETURN_OK on success, RETURN_ERROR otherwise (the store is left unchanged)
+ */
+int cellular_profile_store_load(cellular_profile_store_t *pStore, const char *pPath);
+
+/**
+ * @brief Writes the store to a profile store file
+ *
+ * The file is written next to @p pPath and renamed over it, so readers never map a partial file.
+ *
+ * @return RETURN_OK on success, RETURN_ERROR otherwise
+ */
+int cellular_profile_store_save(const cellular_profile_store_t *pStore, const char *pPath);
+
+/**
+ * @brief Inserts a profile, or replaces the profile with the same ProfileID
+ *
+ * @return RETURN_OK on success, RETURN_ERROR on allocation failure
+ */
+int cellular_profile_store_put(cellular_profile_store_t *pStore, const CellularProfileStruct *pProfile);
+
+/**
+ * @brief Removes the profile with the given ProfileID
+ *
+ * @return RETURN_OK if removed, RETURN_ERROR if absent
+ */
+int cellular_profile_store_remove(cellular_profile_store_t *pStore, int profileId);
+
+/**
+ * @brief Looks up a profile by ProfileID, the pointer is valid until the next put or remove
+ */
+const CellularProfileStruct *cellular_profile_store_find_by_id(const cellular_profile_store_t *pStore, int profileId);
+
+/**
+ * @brief Looks up a profile by APN, the pointer is valid until the next put or remove
+ */
+const CellularProfileStruct *cellular_profile_store_find_by_apn(const cellular_profile_store_t *pStore, const char *pApn);
+
+/**
+ * @brief Returns the number of profiles
+ */
+unsigned int cellular_profile_store_count(const cellular_profile_store_t *pStore);
+
+/**
+ * @brief Returns the profile at position @p index in ProfileID order, NULL when out of range
+ */
+const CellularProfileStruct *cellular_profile_store_at(const cellular_profile_store_t *pStore, unsigned int index);
+
+/**
+ * @brief Returns the default profile (bIsThisDefaultProfile), or the lowest ProfileID when none is flagged
+ */
+const CellularProfileStruct *cellular_profile_store_default(const cellular_profile_store_t *pStore);
+
+/**
+ * @brief Brings the HAL profile list in line with the store
+ *
+ * Reads cellular_hal_get_profile_list() once, then calls cellular_hal_profile_create()
+ * for profiles missing in the HAL and cellular_hal_profile_modify() for profiles which
+ * differ. HAL profiles absent from the store are deleted only when @p allowDelete is set.
+ * Profiles which already match cost no HAL call.
+ *
+ * @return RETURN_OK when the profile list was read and every call succeeded, RETURN_ERROR otherwise
+ */
+int cellular_profile_store_sync(const cellular_profile_store_t *pStore, cellular_device_profile_status_api_callback pCallback,
+                                int allowDelete, CellularProfileSyncResult_t *pResult);
+
+#endif /* CELLULAR_PROFILE_STORE_H */
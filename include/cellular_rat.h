@@ -0,0 +1,54 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:*
+ * Copyright 2023 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file cellular_rat.h
+ * @brief Radio access technology names used by the cellular_hal RAT APIs
+ */
+
+#ifndef CELLULAR_RAT_H
+#define CELLULAR_RAT_H
+
+/**
+ * @brief Radio access technologies, as reported in the RAT strings of the HAL
+ */
+typedef enum
+{
+    CELLULAR_RAT_UNKNOWN = 0,
+    CELLULAR_RAT_CDMA20001X,
+    CELLULAR_RAT_EVDO,
+    CELLULAR_RAT_GSM,
+    CELLULAR_RAT_UMTS,
+    CELLULAR_RAT_LTE,
+    CELLULAR_RAT_NR,
+    CELLULAR_RAT_MAX
+} CellularRat_t;
+
+/**
+ * @brief Maps a single RAT name such as "LTE" to its enum value
+ *
+ * @return CELLULAR_RAT_UNKNOWN for NULL, empty or unrecognised names
+ */
+CellularRat_t cellular_rat_from_string(const char *pName);
+
+/**
+ * @brief Returns the HAL name of a RAT, "UNKNOWN" for out of range values
+ */
+const char *cellular_rat_to_string(CellularRat_t rat);
+
+#endif /* CELLULAR_RAT_H */
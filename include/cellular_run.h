@@ -0,0 +1,82 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:*
+ * Copyright 2023 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file cellular_run.h
+ * @brief Run conditions for stable benchmark results
+ *
+ * bin/run.sh turns its options into CELLULAR_RUN_* variables which are applied before
+ * any test or harness thread starts:
+ *
+ * - CELLULAR_RUN_CPUS: CPU list ("3", "2-3", "1,3") the process is pinned to; threads
+ *   created later inherit it
+ * - CELLULAR_RUN_FIFO: SCHED_FIFO priority of the test thread, which times the benchmarks,
+ *   and of the threads it creates; harness threads and benchmark load threads return to
+ *   SCHED_OTHER so they never delay the timing thread
+ * - CELLULAR_RUN_MLOCK: locks current and future memory with mlockall()
+ * - CELLULAR_RUN_WARMUP: untimed passes the benchmarks make before the timed one
+ *
+ * The conditions actually obtained, which may fall short of the request without the
+ * needed privileges, are logged and exported as the cellular_run_info metric so results
+ * are only compared between runs made under the same conditions.
+ */
+
+#ifndef CELLULAR_RUN_H
+#define CELLULAR_RUN_H
+
+/**
+ * @brief Run conditions in effect
+ */
+typedef struct
+{
+    char cpus[64];               /*!< CPU list of the affinity mask */
+    int fifo_priority;           /*!< SCHED_FIFO priority, 0 for SCHED_OTHER */
+    int memory_locked;           /*!< 1 when mlockall() succeeded */
+    unsigned int warmup;         /*!< Untimed passes before each timed benchmark pass */
+    char governor[32];           /*!< cpufreq governor of the first CPU, "unknown" without cpufreq */
+} CellularRunConditions_t;
+
+/**
+ * @brief Applies the CELLULAR_RUN_* variables, logs the resulting conditions and exports them
+ *
+ * Call it first in main(), before any thread is created. A condition which cannot be
+ * obtained is logged as a warning and left out; the run continues.
+ *
+ * @return RETURN_OK when every requested condition is in effect, RETURN_ERROR otherwise
+ */
+int cellular_run_apply(void);
+
+/**
+ * @brief Copies the conditions in effect
+ */
+void cellular_run_get_conditions(CellularRunConditions_t *pConditions);
+
+/**
+ * @brief Returns the number of untimed passes a benchmark makes before its timed one
+ */
+unsigned int cellular_run_warmup(void);
+
+/**
+ * @brief Returns the calling thread to SCHED_OTHER
+ *
+ * Harness threads call it so they never preempt the tests, and benchmark load threads
+ * so a busy one cannot keep the timing thread from running on the same CPU.
+ */
+void cellular_run_background_thread(void);
+
+#endif /* CELLULAR_RUN_H */
@@ -0,0 +1,104 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:*
+ * Copyright 2023 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file cellular_sampler.h
+ * @brief Sampling CPU profiler writing folded stacks per test
+ *
+ * An ITIMER_PROF timer raises SIGPROF each time the process has used 1/hz seconds of
+ * CPU, on the thread which was running. The handler captures the stack with backtrace()
+ * and counts it in a fixed table, tagged with the running test, its [GGIII] ID, the
+ * thread name and the cellular_hal_* API the thread is inside of. Only CPU time is
+ * sampled; time blocked in a HAL call shows up in CELLULAR_PERF instead.
+ *
+ * The folded file has one line per stack, "test [GGIII];thread;api;outer;...;inner count",
+ * the input of flamegraph.pl and speedscope. Frames are named by dladdr(): exported
+ * symbols by name, others as library+offset for addr2line.
+ *
+ * The kernel checks CPU timers on the scheduler tick, so rates above CONFIG_HZ give one
+ * sample per tick; the default stays below the 100 Hz tick of most gateways.
+ */
+
+#ifndef CELLULAR_SAMPLER_H
+#define CELLULAR_SAMPLER_H
+
+#include <stdint.h>
+
+#define CELLULAR_SAMPLER_DEFAULT_HZ 99
+#define CELLULAR_SAMPLER_MAX_DEPTH  32
+#define CELLULAR_SAMPLER_MAX_STACKS 4096
+
+/**
+ * @brief Share of the process CPU time spent in the handler above which the report warns
+ */
+#define CELLULAR_SAMPLER_OVERHEAD_LIMIT 0.03
+
+/**
+ * @brief Sampler totals
+ */
+typedef struct
+{
+    uint64_t samples;            /*!< Samples counted */
+    uint64_t dropped;            /*!< Samples lost because the stack table was full */
+    uint64_t stacks;             /*!< Distinct stacks in the table */
+    uint64_t handler_ns;         /*!< Time spent in the signal handler */
+    double overhead;             /*!< handler_ns over the CPU time of the process since the start */
+    unsigned int hz;             /*!< Sampling rate, 0 when not started */
+} CellularSamplerStats_t;
+
+/**
+ * @brief Starts sampling the whole process, each start is matched by a cellular_sampler_stop()
+ *
+ * @param[in] hz - samples per CPU second, 0 for CELLULAR_SAMPLER_DEFAULT_HZ; ignored when already started
+ *
+ * @return RETURN_OK, also when already started, RETURN_ERROR when the probe, the table or the timer could not be set up
+ */
+int cellular_sampler_start(unsigned int hz);
+
+/**
+ * @brief Matches a cellular_sampler_start(); the last one stops the timer, the samples are kept
+ */
+void cellular_sampler_stop(void);
+
+/**
+ * @brief Drops the samples of a stopped sampler and removes its probe, so nothing is reported or written
+ *
+ * Does nothing while a start is not matched by a stop.
+ */
+void cellular_sampler_reset(void);
+
+/**
+ * @brief Copies the totals
+ *
+ * @return RETURN_OK, RETURN_ERROR when pStats is NULL
+ */
+int cellular_sampler_get_stats(CellularSamplerStats_t *pStats);
+
+/**
+ * @brief Writes the folded stacks, equal lines merged, replacing the file
+ *
+ * @return RETURN_OK, RETURN_ERROR when not started or the file cannot be written
+ */
+int cellular_sampler_write(const char *pPath);
+
+/**
+ * @brief Logs the totals and the functions with the most samples of their own, if started
+ */
+void cellular_sampler_report(void);
+
+#endif /* CELLULAR_SAMPLER_H */
@@ -0,0 +1,132 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:*
+ * Copyright 2023 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file cellular_scan_index.h
+ * @brief Persistent index of network scan results keyed by (MCC, MNC, RAT)
+ *
+ * Results of cellular_hal_get_available_networks_information() are merged into a
+ * fixed size open addressing hash table, so a PLMN seen in an earlier scan is still
+ * known after a later scan missed it. Entries not refreshed for a configurable number
+ * of scans are aged out, and when the table is full the least recently seen entry is
+ * replaced, so memory is fixed at creation time.
+ */
+
+#ifndef CELLULAR_SCAN_INDEX_H
+#define CELLULAR_SCAN_INDEX_H
+
+#include <stdint.h>
+#include "cellular_hal.h"
+#include "cellular_rat.h"
+
+/**
+ * @brief One PLMN as remembered by the index
+ */
+typedef struct
+{
+    unsigned int MCC;
+    unsigned int MNC;
+    CellularRat_t rat;
+    char network_name[32];
+    unsigned char network_allowed_flag;
+    uint32_t first_seen_scan;   /*!< Scan generation in which the entry was inserted */
+    uint32_t last_seen_scan;    /*!< Scan generation in which the entry was last refreshed */
+    uint32_t seen_count;        /*!< Number of scans which reported the entry */
+} CellularScanIndexEntry_t;
+
+/**
+ * @brief Counters kept by the index
+ */
+typedef struct
+{
+    uint32_t scans;              /*!< Scan generations merged so far */
+    uint32_t entries;            /*!< Entries currently held */
+    uint32_t capacity;           /*!< Maximum number of entries */
+    uint64_t inserts;
+    uint64_t updates;
+    uint64_t aged_out;           /*!< Entries dropped for not being seen in max_age_scans scans */
+    uint64_t replaced;           /*!< Entries dropped to make room in a full table */
+    uint64_t lookups;
+    uint64_t probes;             /*!< Slots inspected by lookups, probes / lookups is the mean probe length */
+} CellularScanIndexStats_t;
+
+typedef struct cellular_scan_index_s cellular_scan_index_t;
+
+/**
+ * @brief Creates an index holding at most @p max_entries PLMNs
+ *
+ * @param[in] max_entries   - upper bound on remembered PLMNs, the table is sized so its load factor stays at or below 0.5
+ * @param[in] max_age_scans - entries not reported by this many consecutive scans are removed, 0 keeps them until replaced
+ *
+ * @return index handle, or NULL on invalid arguments or allocation failure
+ */
+cellular_scan_index_t *cellular_scan_index_create(unsigned int max_entries, unsigned int max_age_scans);
+
+/**
+ * @brief Releases the index
+ */
+void cellular_scan_index_destroy(cellular_scan_index_t *pIndex);
+
+/**
+ * @brief Merges one scan result array as a new scan generation
+ *
+ * Entries are inserted or refreshed, then entries older than max_age_scans are aged out.
+ *
+ * @param[in] pResults - scan results, may be NULL when @p count is 0
+ * @param[in] count    - number of results
+ * @param[in] rat      - RAT the scan was performed on, CELLULAR_RAT_UNKNOWN if not known
+ *
+ * @return number of newly inserted entries, or -1 on invalid arguments
+ */
+int cellular_scan_index_merge(cellular_scan_index_t *pIndex, const CellularNetworkScanResultInfoStruct *pResults, unsigned int count, CellularRat_t rat);
+
+/**
+ * @brief Runs cellular_hal_get_available_networks_information() and merges the result
+ *
+ * The RAT is taken from cellular_hal_get_modem_current_radio_technology(). The array
+ * returned by the HAL is released after merging.
+ *
+ * @return number of newly inserted entries, or -1 if the HAL scan failed
+ */
+int cellular_scan_index_scan(cellular_scan_index_t *pIndex);
+
+/**
+ * @brief Finds an entry
+ *
+ * @param[in] rat - RAT to look for; CELLULAR_RAT_UNKNOWN matches the most recently seen entry of any RAT
+ *
+ * @return pointer into the index, valid until the next merge, or NULL if not present
+ */
+const CellularScanIndexEntry_t *cellular_scan_index_lookup(cellular_scan_index_t *pIndex, unsigned int mcc, unsigned int mnc, CellularRat_t rat);
+
+/**
+ * @brief Returns 1 when the PLMN is present in the index
+ */
+int cellular_scan_index_is_visible(cellular_scan_index_t *pIndex, unsigned int mcc, unsigned int mnc, CellularRat_t rat);
+
+/**
+ * @brief Returns 1 when the PLMN is present and its last scan reported it as allowed
+ */
+int cellular_scan_index_is_allowed(cellular_scan_index_t *pIndex, unsigned int mcc, unsigned int mnc, CellularRat_t rat);
+
+/**
+ * @brief Copies the index counters
+ */
+void cellular_scan_index_get_stats(const cellular_scan_index_t *pIndex, CellularScanIndexStats_t *pStats);
+
+#endif /* CELLULAR_SCAN_INDEX_H */
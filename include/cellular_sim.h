@@ -0,0 +1,279 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:*
+ * Copyright 2023 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file cellular_sim.h
+ * @brief Control interface of the simulated modem behind the linux skeleton HAL
+ *
+ * The linux build links skeletons/src, which implements the HAL on top of an in-memory
+ * modem model: UICC slots, registration, profiles and a data session, with callbacks
+ * delivered asynchronously after configurable delays. A vendor build does not link the
+ * simulator, so every control function is a weak reference and harness code must check
+ * cellular_sim_available() before using it.
+ *
+ * With cellular_sim_set_at_device() the skeleton sends the HAL calls which have an AT
+ * command equivalent over a serial device, such as the pty of cellular_atmodem.h, and
+ * with cellular_sim_set_ctl_device() over a framed binary protocol socket.
+ * cellular_sim_set_data_plane() gives the data session a real network interface, and
+ * cellular_sim_set_channel() makes the signal, serving cell and radio technology move.
+ *
+ * Each process owns one simulator instance; a forked child continues with a copy of
+ * its parent's modem and can reset it without affecting any other process.
+ */
+
+#ifndef CELLULAR_SIM_H
+#define CELLULAR_SIM_H
+
+#include <stdint.h>
+#include "cellular_hal.h"
+
+#define CELLULAR_SIM_MAX_SLOTS    8
+#define CELLULAR_SIM_MAX_PROFILES 16
+
+/**
+ * @brief Simulated modem behaviour, all delays in milliseconds
+ */
+typedef struct
+{
+    uint32_t slots;                   /*!< Number of UICC slots, 1 to CELLULAR_SIM_MAX_SLOTS */
+    uint32_t esim_slots;              /*!< How many of the last slots hold an embedded UICC, at most slots */
+    uint32_t open_delay_ms;           /*!< cellular_hal_open_device() until the control interface is ready */
+    uint32_t slot_select_delay_ms;    /*!< cellular_hal_select_device_slot() until the slot is ready */
+    uint32_t registration_delay_ms;   /*!< Attach, SIM power on or modem restart until registered */
+    uint32_t connect_delay_ms;        /*!< cellular_hal_start_network() until the IP is ready */
+    uint32_t disconnect_delay_ms;     /*!< cellular_hal_stop_network() until the session is released */
+    uint32_t reset_delay_ms;          /*!< Modem reset until the device is present again */
+    uint32_t rat_switch_delay_ms;     /*!< Preferred radio technology change until the new technology is in use and registering */
+    uint32_t sim_power_delay_ms;      /*!< cellular_hal_sim_power_enable() until the card is on or off, 0 at once; switching it again sooner leaves the card in error */
+} CellularSimConfig_t;
+
+#define CELLULAR_SIM_WEAK __attribute__((weak))
+
+/**
+ * @brief Returns the default configuration
+ */
+CELLULAR_SIM_WEAK void cellular_sim_default_config(CellularSimConfig_t *pConfig);
+
+/**
+ * @brief Applies a configuration and resets the modem to its power-on state
+ *
+ * @return 0 on success, -1 on an invalid configuration
+ */
+CELLULAR_SIM_WEAK int cellular_sim_configure(const CellularSimConfig_t *pConfig);
+
+/**
+ * @brief Copies the configuration in use
+ */
+CELLULAR_SIM_WEAK void cellular_sim_get_config(CellularSimConfig_t *pConfig);
+
+/**
+ * @brief Resets the modem to its power-on state, keeping the configuration
+ *
+ * Pending callbacks are discarded and registered callbacks forgotten. The modem comes up
+ * present, online and registered on the first slot, with one default profile.
+ */
+CELLULAR_SIM_WEAK void cellular_sim_reset(void);
+
+/**
+ * @brief Replaces the contents of a UICC slot, as inserting, removing or swapping a card would
+ *
+ * CardEnable becomes the slot's power state. When the slot is the active one the modem
+ * deregisters if the card can no longer register, and registers again once it can.
+ *
+ * @param[in] slot  - slot index, below the configured slot count
+ * @param[in] pInfo - new slot contents
+ *
+ * @return 0 on success, -1 on an invalid slot or NULL pInfo
+ */
+CELLULAR_SIM_WEAK int cellular_sim_set_slot_info(unsigned int slot, const CellularUICCSlotInfoStruct *pInfo);
+
+/**
+ * @brief Sends the HAL calls with an AT equivalent over a serial device, or stops doing so
+ *
+ * Signal, identity, card status, PLMN, radio technology, operating configuration,
+ * attach, profiles and the data session then go to the device; callbacks and the
+ * fields without an AT command still come from the simulated modem.
+ *
+ * @param[in] pPath - device to open, NULL to go back to the simulated modem only
+ *
+ * @return 0 on success, -1 when the device cannot be opened or does not answer AT
+ */
+CELLULAR_SIM_WEAK int cellular_sim_set_at_device(const char *pPath);
+
+/**
+ * @brief Sends the same HAL calls as cellular_sim_set_at_device() over the binary control protocol, or stops doing so
+ *
+ * Connects to a SOCK_SEQPACKET socket speaking cellular_ctl_protocol.h, such as the one
+ * of cellular_ctlmodem.h. Concurrent HAL calls are pipelined. Takes precedence over an
+ * AT device while connected.
+ *
+ * @param[in] pPath - socket to connect to, NULL to disconnect
+ *
+ * @return 0 on success, -1 when the socket cannot be connected
+ */
+CELLULAR_SIM_WEAK int cellular_sim_set_ctl_device(const char *pPath);
+
+/**
+ * @brief Packets and bytes the kernel counted on the session's TUN device
+ */
+typedef struct
+{
+    uint64_t tx_packets;   /*!< Sent by the host, the modem's uplink */
+    uint64_t tx_bytes;
+    uint64_t rx_packets;   /*!< Delivered to the host, the modem's downlink */
+    uint64_t rx_bytes;
+    uint64_t tx_dropped;   /*!< Sent by the host but never read by the modem */
+    uint64_t rx_dropped;
+} CellularSimLinkStats_t;
+
+/**
+ * @brief Outcome of one cellular_sim_generate_traffic() run
+ */
+typedef struct
+{
+    uint64_t uplink_packets;     /*!< Offered by the generator, IP packets */
+    uint64_t uplink_bytes;
+    uint64_t downlink_packets;
+    uint64_t downlink_bytes;
+    uint64_t elapsed_ns;
+} CellularSimTraffic_t;
+
+/**
+ * @brief Carries the data sessions over a TUN device in a private network namespace, or stops doing so
+ *
+ * From the next session on, the IP ready callback's interface exists in the namespace with
+ * its addresses, and cellular_hal_get_packet_statistics() reports the packets and bytes the
+ * modem carried on it. The namespace keeps the host's routing untouched.
+ *
+ * @param[in] enable - 1 to create the namespace, 0 to take the device down and drop it
+ *
+ * @return 0 on success, -1 without CAP_SYS_ADMIN and CAP_NET_ADMIN or without /dev/net/tun
+ */
+CELLULAR_SIM_WEAK int cellular_sim_set_data_plane(int enable);
+
+/**
+ * @brief Pushes synthetic UDP traffic through the connected session's TUN device
+ *
+ * Uplink datagrams are sent from a socket in the namespace to the gateway, so the kernel
+ * routes them to the modem; downlink packets are written to the device for the session
+ * address. Returns when both byte counts are reached or the session went down.
+ *
+ * @param[in]  uplink_bytes   - IP bytes to send towards the network
+ * @param[in]  downlink_bytes - IP bytes to deliver to the host
+ * @param[in]  packet_size    - IP packet size, 28 to 1500
+ * @param[out] pTraffic       - what was offered and how long it took
+ *
+ * @return 0 on success, -1 without an IPv4 session on the data plane or on an invalid size
+ */
+CELLULAR_SIM_WEAK int cellular_sim_generate_traffic(uint64_t uplink_bytes, uint64_t downlink_bytes, uint32_t packet_size, CellularSimTraffic_t *pTraffic);
+
+/**
+ * @brief Reads the kernel's counters of the session's TUN device, the reference for the HAL's packet statistics
+ *
+ * @return 0 on success, -1 when no session is on the data plane
+ */
+CELLULAR_SIM_WEAK int cellular_sim_get_link_stats(CellularSimLinkStats_t *pStats);
+
+/**
+ * @brief Radio channel of a terminal moving along a line of evenly spaced cells
+ *
+ * The serving cell's RSRP follows its distance to the terminal plus correlated shadow
+ * fading; SNR, RSSI and RSRQ follow from it and the strongest neighbour, TXPower from
+ * uplink power control. The terminal hands over once the neighbour stayed 3 dB stronger
+ * for 640 ms, and falls back from NR to LTE to UMTS, within the preferred technologies,
+ * as the RSRP drops. Every eighth cell starts a new tracking area.
+ */
+typedef struct
+{
+    uint32_t seed;               /*!< Seed of the trajectory; a seed always gives the same steps */
+    uint32_t step_ms;            /*!< Time a step stands for, above 0 */
+    uint32_t timed;              /*!< 1 to take the steps on the event thread at their times, 0 for cellular_sim_step_channel() only */
+    int32_t mean_rsrp_dbm;       /*!< RSRP halfway between two cells, without fading */
+    uint32_t shadowing_db;       /*!< Standard deviation of the shadow fading */
+    uint32_t decorrelation_ms;   /*!< Time over which the shadow fading correlation falls to 1/e */
+    uint32_t cell_dwell_ms;      /*!< Time to travel from one cell to the next */
+} CellularSimChannel_t;
+
+/**
+ * @brief What the channel did since it was set
+ */
+typedef struct
+{
+    uint64_t steps;
+    uint64_t simulated_ms;       /*!< Sum of the steps' times, the trace's for a trace */
+    uint64_t signal_changes;     /*!< Steps which changed any signal value */
+    uint64_t handovers;          /*!< Serving cell changes */
+    uint64_t area_changes;       /*!< Tracking area changes, a subset of the handovers */
+    uint64_t rat_changes;        /*!< Radio technology changes */
+} CellularSimChannelStats_t;
+
+/**
+ * @brief Returns the default channel: seed 1, timed 100 ms steps, -95 dBm, 6 dB shadowing over 5 s, a cell a minute
+ */
+CELLULAR_SIM_WEAK void cellular_sim_default_channel(CellularSimChannel_t *pChannel);
+
+/**
+ * @brief Drives the signal, serving cell and current radio technology with a channel model, or stops doing so
+ *
+ * The channel survives modem resets, a reset only restores the values of its last step.
+ * With an AT or control-protocol device those calls report the device's values instead.
+ *
+ * @param[in] pChannel - model to start from its first step, NULL to keep the last values
+ *
+ * @return 0 on success, -1 on an invalid model
+ */
+CELLULAR_SIM_WEAK int cellular_sim_set_channel(const CellularSimChannel_t *pChannel);
+
+/**
+ * @brief Replays a recorded channel instead of the model
+ *
+ * Each line holds the time in ms since the first line, RSSI, RSRQ, RSRP, SNR, TXPower,
+ * cell id, area code and radio technology, separated by blanks; a '#' starts a comment.
+ * The first line applies at once, each other one at its time or on a
+ * cellular_sim_step_channel() step, and the last one stays.
+ *
+ * @param[in] pPath - file to replay, NULL to stop
+ * @param[in] timed - 1 to apply the lines at their times, 0 for cellular_sim_step_channel() only
+ *
+ * @return 0 on success, -1 when the file cannot be read or has an invalid line
+ */
+CELLULAR_SIM_WEAK int cellular_sim_set_channel_trace(const char *pPath, int timed);
+
+/**
+ * @brief Advances the channel or trace by a number of steps at once, as fast as they compute
+ *
+ * @return 0 on success, -1 when neither a channel nor a trace is set
+ */
+CELLULAR_SIM_WEAK int cellular_sim_step_channel(unsigned int steps);
+
+/**
+ * @brief Copies what the channel or trace did since it was set
+ *
+ * @return 0 on success, -1 on NULL pStats
+ */
+CELLULAR_SIM_WEAK int cellular_sim_get_channel_stats(CellularSimChannelStats_t *pStats);
+
+/**
+ * @brief Returns 1 when the simulator is linked, 0 for a vendor HAL
+ */
+static inline int cellular_sim_available(void)
+{
+    return (cellular_sim_reset != NULL) ? 1 : 0;
+}
+
+#endif /* CELLULAR_SIM_H */
@@ -0,0 +1,108 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:*
+ * Copyright 2023 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file cellular_syscall.h
+ * @brief Counts and times the system calls made inside each HAL call
+ *
+ * The test binary defines open, close, read, write, ioctl, poll, sendmsg and recvmsg
+ * (and their 64 bit and fortified variants) and forwards them to the C library. The
+ * skeleton linked into the binary and a vendor library loaded at run time both bind to
+ * these definitions, so the same build profiles either HAL.
+ *
+ * Only calls made on the thread which entered a cellular_hal_* call, between its entry
+ * and return, are counted; work done by HAL threads is not attributed. Calls are grouped
+ * by the file descriptor target: the path given to open, or the /proc/self/fd link for
+ * descriptors opened earlier, with sockets shown by domain (e.g. "netlink:0").
+ */
+
+#ifndef CELLULAR_SYSCALL_H
+#define CELLULAR_SYSCALL_H
+
+#include <stdint.h>
+#include "cellular_trace.h"
+
+/**
+ * @brief Counted system calls
+ */
+typedef enum
+{
+    CELLULAR_SYSCALL_OPEN = 0,
+    CELLULAR_SYSCALL_CLOSE,
+    CELLULAR_SYSCALL_READ,
+    CELLULAR_SYSCALL_WRITE,
+    CELLULAR_SYSCALL_IOCTL,
+    CELLULAR_SYSCALL_POLL,
+    CELLULAR_SYSCALL_SENDMSG,
+    CELLULAR_SYSCALL_RECVMSG,
+    CELLULAR_SYSCALL_COUNT
+} CellularSyscall_t;
+
+/**
+ * @brief Totals of one API, on one target or on all of them
+ */
+typedef struct
+{
+    uint64_t calls;                              /*!< HAL calls of the API */
+    uint64_t count[CELLULAR_SYSCALL_COUNT];
+    uint64_t ns[CELLULAR_SYSCALL_COUNT];
+    uint64_t redundant_opens;                    /*!< Opens of a target already opened earlier in the same HAL call */
+    uint64_t max_per_call;                       /*!< Most system calls made by one HAL call */
+} CellularSyscallStats_t;
+
+/**
+ * @brief Syscalls per HAL call on one target above which the pattern is reported as chatty
+ */
+#define CELLULAR_SYSCALL_CHATTY 8
+
+/**
+ * @brief Starts counting by adding the HAL call probe, each start is matched by a cellular_syscall_stop()
+ *
+ * @return RETURN_OK, RETURN_ERROR when the probe could not be added
+ */
+int cellular_syscall_start(void);
+
+/**
+ * @brief Matches a cellular_syscall_start(); the last one removes the probe and clears the counts
+ *
+ * Call it outside the HAL calls of other threads.
+ */
+void cellular_syscall_stop(void);
+
+/**
+ * @brief Copies the totals of an API
+ *
+ * @param[in]  api     - HAL API
+ * @param[in]  pTarget - target name, NULL for all targets
+ * @param[out] pStats  - totals, all zero when the target was not used
+ *
+ * @return RETURN_OK, RETURN_ERROR on invalid arguments
+ */
+int cellular_syscall_get(CellularHalApi_t api, const char *pTarget, CellularSyscallStats_t *pStats);
+
+/**
+ * @brief Logs the per API and target table and the redundant or chatty patterns, nothing when not started
+ */
+void cellular_syscall_report(void);
+
+/**
+ * @brief Returns the name of a counted system call
+ */
+const char *cellular_syscall_to_string(CellularSyscall_t syscall);
+
+#endif /* CELLULAR_SYSCALL_H */
@@ -0,0 +1,263 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:*
+ * Copyright 2023 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file cellular_trace.h
+ * @brief Test and HAL call scopes for instrumentation probes
+ *
+ * A probe is a set of callbacks run when a registered test starts and ends and around
+ * every cellular_hal_* call made by the tests. Probes are added before the tests run;
+ * with no probe the scopes cost one branch.
+ *
+ * A file defining CELLULAR_TRACE_HAL_CALLS before including this header has its
+ * cellular_hal_* calls and its UT_add_test() registrations routed through the scopes.
+ * Calls are redirected at the call site, so the scopes work the same against the
+ * skeleton and against a vendor library.
+ */
+
+#ifndef CELLULAR_TRACE_H
+#define CELLULAR_TRACE_H
+
+#include <ut.h>
+#include "cellular_hal.h"
+
+/* Every cellular_hal API */
+#define CELLULAR_TRACE_API_LIST(X) \
+    X(IsModemDevicePresent) \
+    X(init) \
+    X(open_device) \
+    X(IsModemControlInterfaceOpened) \
+    X(select_device_slot) \
+    X(sim_power_enable) \
+    X(get_total_no_of_uicc_slots) \
+    X(get_uicc_slot_info) \
+    X(get_active_card_status) \
+    X(monitor_device_registration) \
+    X(profile_create) \
+    X(profile_delete) \
+    X(profile_modify) \
+    X(get_profile_list) \
+    X(start_network) \
+    X(stop_network) \
+    X(get_signal_info) \
+    X(set_modem_operating_configuration) \
+    X(get_device_imei) \
+    X(get_device_imei_sv) \
+    X(get_modem_current_iccid) \
+    X(get_modem_current_msisdn) \
+    X(get_packet_statistics) \
+    X(get_current_modem_interface_status) \
+    X(set_modem_network_attach) \
+    X(set_modem_network_detach) \
+    X(get_modem_firmware_version) \
+    X(get_current_plmn_information) \
+    X(get_available_networks_information) \
+    X(get_modem_preferred_radio_technology) \
+    X(set_modem_preferred_radio_technology) \
+    X(get_modem_current_radio_technology) \
+    X(get_modem_supported_radio_technology) \
+    X(modem_factory_reset) \
+    X(modem_reset)
+
+#define CELLULAR_TRACE_API_ENUM(name) CELLULAR_HAL_API_##name,
+
+/**
+ * @brief Identifies a cellular_hal API, CELLULAR_HAL_API_<name without cellular_hal_>
+ */
+typedef enum
+{
+    CELLULAR_TRACE_API_LIST(CELLULAR_TRACE_API_ENUM)
+    CELLULAR_HAL_API_COUNT
+} CellularHalApi_t;
+
+/**
+ * @brief Instrumentation callbacks, any of them may be NULL
+ *
+ * The callbacks run on the thread entering the scope; the end callbacks of the probes
+ * run in the reverse order of their begin callbacks.
+ */
+typedef struct
+{
+    void (*test_begin)(const char *pTitle);
+    void (*test_end)(const char *pTitle);
+    void (*call_begin)(CellularHalApi_t api);
+    void (*call_end)(CellularHalApi_t api);
+} CellularTraceProbe_t;
+
+/**
+ * @brief Runs the function of a wrapped test in place of a direct call, inside the test scope
+ */
+typedef void (*CellularTraceRunner_t)(const char *pTitle, UT_TestFunction_t pFunction);
+
+/**
+ * @brief Ends an abandoned test in place of the jump out of it, see cellular_trace_set_abandon()
+ *
+ * @return RETURN_OK when the test was ended, RETURN_ERROR to jump out of it as without a handler
+ */
+typedef int (*CellularTraceAbandon_t)(void);
+
+#define CELLULAR_TRACE_MAX_PROBES 8
+#define CELLULAR_TRACE_MAX_TESTS  120
+
+/**
+ * @brief Adds a probe, not thread safe: call it before the tests run
+ *
+ * @return RETURN_OK, RETURN_ERROR when CELLULAR_TRACE_MAX_PROBES are already added
+ */
+int cellular_trace_add_probe(const CellularTraceProbe_t *pProbe);
+
+/**
+ * @brief Removes a probe added with the same callbacks, not thread safe: call it outside the HAL call scopes of other threads
+ *
+ * The probe's end callback of the scopes it is inside of does not run.
+ *
+ * @return RETURN_OK, RETURN_ERROR when no such probe was added
+ */
+int cellular_trace_remove_probe(const CellularTraceProbe_t *pProbe);
+
+/**
+ * @brief Sets the runner of the wrapped tests, not thread safe: call it before the tests run
+ *
+ * @param[in] runner - runner, NULL to call the tests directly
+ */
+void cellular_trace_set_runner(CellularTraceRunner_t runner);
+
+/**
+ * @brief Sets how the runner ends an abandoned test, not thread safe: call it before the tests run
+ *
+ * A runner which runs the test elsewhere, such as in a child process, ends it there and
+ * returns as for a failed test rather than be jumped out of. The handler runs in a signal
+ * handler on the test thread, so it must be async-signal-safe.
+ *
+ * @param[in] abandon - handler, NULL to jump out of the test
+ */
+void cellular_trace_set_abandon(CellularTraceAbandon_t abandon);
+
+/**
+ * @brief Wraps a test function in a test scope without registering it
+ *
+ * @return the wrapped function, pFunction itself when CELLULAR_TRACE_MAX_TESTS tests are already wrapped
+ */
+UT_TestFunction_t cellular_trace_wrap_test(const char *pTitle, UT_TestFunction_t pFunction);
+
+/**
+ * @brief Registers a test which runs inside a test scope
+ *
+ * The first CELLULAR_TRACE_MAX_TESTS tests are wrapped, later ones are registered as they are.
+ */
+UT_test_t *cellular_trace_add_test(UT_test_suite_t *pSuite, const char *pTitle, UT_TestFunction_t pFunction);
+
+/**
+ * @brief Names the test group and ID variables which the tests registered from now on assign
+ *
+ * A test file calls it before its UT_add_test() calls with the addresses of its gTestGroup
+ * and gTestID, so probes can tag the running test with the ID it logs.
+ */
+void cellular_trace_set_test_id(const int *pGroup, const int *pId);
+
+/**
+ * @brief Returns the title of the running wrapped test, NULL outside of one; async-signal-safe
+ *
+ * @param[out] pId - group * 1000 + ID as logged by the test ([GGIII]), -1 when unknown; may be NULL
+ */
+const char *cellular_trace_current_test(int *pId);
+
+/**
+ * @brief Abandons the running test from a signal handler on its thread
+ *
+ * With an abandon handler set, the handler ends the test. Otherwise the test returns to
+ * its trampoline at once: the scope of the HAL call it was blocked in is closed, the test
+ * is failed with "Test abandoned" and the test end callbacks run. The HAL may be left in
+ * the middle of the call, but not inside a section held with cellular_trace_hold_abandon().
+ *
+ * @return RETURN_ERROR when not called on the thread of a running wrapped test, RETURN_OK when
+ *         the handler ended the test or the thread holds the abandon; does not return otherwise
+ */
+int cellular_trace_abandon_test(void);
+
+/**
+ * @brief Starts a section which the test is not jumped out of, such as one holding a lock; async-signal-safe
+ *
+ * An abandon arriving inside the section is carried out when the outermost section ends.
+ * Sections nest and cost a thread-local counter.
+ */
+void cellular_trace_hold_abandon(void);
+
+/**
+ * @brief Ends a section started with cellular_trace_hold_abandon(); async-signal-safe
+ */
+void cellular_trace_release_abandon(void);
+
+/**
+ * @brief Returns "cellular_hal_<name>" of an API
+ */
+const char *cellular_trace_api_name(CellularHalApi_t api);
+
+extern int gCellularTraceProbeCount;
+void cellular_trace_call_begin(CellularHalApi_t api);
+void cellular_trace_call_end(CellularHalApi_t api);
+
+#define CELLULAR_TRACE_CALL(api, call) \
+    __extension__ ({ \
+        if (gCellularTraceProbeCount > 0) cellular_trace_call_begin(CELLULAR_HAL_API_##api); \
+        __typeof__(call) cellularTraceResult = (call); \
+        if (gCellularTraceProbeCount > 0) cellular_trace_call_end(CELLULAR_HAL_API_##api); \
+        cellularTraceResult; \
+    })
+
+#ifdef CELLULAR_TRACE_HAL_CALLS
+#define UT_add_test(pSuite, pTitle, pFunction) cellular_trace_add_test(pSuite, pTitle, pFunction)
+
+#define cellular_hal_IsModemDevicePresent(...) CELLULAR_TRACE_CALL(IsModemDevicePresent, cellular_hal_IsModemDevicePresent(__VA_ARGS__))
+#define cellular_hal_init(...) CELLULAR_TRACE_CALL(init, cellular_hal_init(__VA_ARGS__))
+#define cellular_hal_open_device(...) CELLULAR_TRACE_CALL(open_device, cellular_hal_open_device(__VA_ARGS__))
+#define cellular_hal_IsModemControlInterfaceOpened(...) CELLULAR_TRACE_CALL(IsModemControlInterfaceOpened, cellular_hal_IsModemControlInterfaceOpened(__VA_ARGS__))
+#define cellular_hal_select_device_slot(...) CELLULAR_TRACE_CALL(select_device_slot, cellular_hal_select_device_slot(__VA_ARGS__))
+#define cellular_hal_sim_power_enable(...) CELLULAR_TRACE_CALL(sim_power_enable, cellular_hal_sim_power_enable(__VA_ARGS__))
+#define cellular_hal_get_total_no_of_uicc_slots(...) CELLULAR_TRACE_CALL(get_total_no_of_uicc_slots, cellular_hal_get_total_no_of_uicc_slots(__VA_ARGS__))
+#define cellular_hal_get_uicc_slot_info(...) CELLULAR_TRACE_CALL(get_uicc_slot_info, cellular_hal_get_uicc_slot_info(__VA_ARGS__))
+#define cellular_hal_get_active_card_status(...) CELLULAR_TRACE_CALL(get_active_card_status, cellular_hal_get_active_card_status(__VA_ARGS__))
+#define cellular_hal_monitor_device_registration(...) CELLULAR_TRACE_CALL(monitor_device_registration, cellular_hal_monitor_device_registration(__VA_ARGS__))
+#define cellular_hal_profile_create(...) CELLULAR_TRACE_CALL(profile_create, cellular_hal_profile_create(__VA_ARGS__))
+#define cellular_hal_profile_delete(...) CELLULAR_TRACE_CALL(profile_delete, cellular_hal_profile_delete(__VA_ARGS__))
+#define cellular_hal_profile_modify(...) CELLULAR_TRACE_CALL(profile_modify, cellular_hal_profile_modify(__VA_ARGS__))
+#define cellular_hal_get_profile_list(...) CELLULAR_TRACE_CALL(get_profile_list, cellular_hal_get_profile_list(__VA_ARGS__))
+#define cellular_hal_start_network(...) CELLULAR_TRACE_CALL(start_network, cellular_hal_start_network(__VA_ARGS__))
+#define cellular_hal_stop_network(...) CELLULAR_TRACE_CALL(stop_network, cellular_hal_stop_network(__VA_ARGS__))
+#define cellular_hal_get_signal_info(...) CELLULAR_TRACE_CALL(get_signal_info, cellular_hal_get_signal_info(__VA_ARGS__))
+#define cellular_hal_set_modem_operating_configuration(...) CELLULAR_TRACE_CALL(set_modem_operating_configuration, cellular_hal_set_modem_operating_configuration(__VA_ARGS__))
+#define cellular_hal_get_device_imei(...) CELLULAR_TRACE_CALL(get_device_imei, cellular_hal_get_device_imei(__VA_ARGS__))
+#define cellular_hal_get_device_imei_sv(...) CELLULAR_TRACE_CALL(get_device_imei_sv, cellular_hal_get_device_imei_sv(__VA_ARGS__))
+#define cellular_hal_get_modem_current_iccid(...) CELLULAR_TRACE_CALL(get_modem_current_iccid, cellular_hal_get_modem_current_iccid(__VA_ARGS__))
+#define cellular_hal_get_modem_current_msisdn(...) CELLULAR_TRACE_CALL(get_modem_current_msisdn, cellular_hal_get_modem_current_msisdn(__VA_ARGS__))
+#define cellular_hal_get_packet_statistics(...) CELLULAR_TRACE_CALL(get_packet_statistics, cellular_hal_get_packet_statistics(__VA_ARGS__))
+#define cellular_hal_get_current_modem_interface_status(...) CELLULAR_TRACE_CALL(get_current_modem_interface_status, cellular_hal_get_current_modem_interface_status(__VA_ARGS__))
+#define cellular_hal_set_modem_network_attach(...) CELLULAR_TRACE_CALL(set_modem_network_attach, cellular_hal_set_modem_network_attach(__VA_ARGS__))
+#define cellular_hal_set_modem_network_detach(...) CELLULAR_TRACE_CALL(set_modem_network_detach, cellular_hal_set_modem_network_detach(__VA_ARGS__))
+#define cellular_hal_get_modem_firmware_version(...) CELLULAR_TRACE_CALL(get_modem_firmware_version, cellular_hal_get_modem_firmware_version(__VA_ARGS__))
+#define cellular_hal_get_current_plmn_information(...) CELLULAR_TRACE_CALL(get_current_plmn_information, cellular_hal_get_current_plmn_information(__VA_ARGS__))
+#define cellular_hal_get_available_networks_information(...) CELLULAR_TRACE_CALL(get_available_networks_information, cellular_hal_get_available_networks_information(__VA_ARGS__))
+#define cellular_hal_get_modem_preferred_radio_technology(...) CELLULAR_TRACE_CALL(get_modem_preferred_radio_technology, cellular_hal_get_modem_preferred_radio_technology(__VA_ARGS__))
+#define cellular_hal_set_modem_preferred_radio_technology(...) CELLULAR_TRACE_CALL(set_modem_preferred_radio_technology, cellular_hal_set_modem_preferred_radio_technology(__VA_ARGS__))
+#define cellular_hal_get_modem_current_radio_technology(...) CELLULAR_TRACE_CALL(get_modem_current_radio_technology, cellular_hal_get_modem_current_radio_technology(__VA_ARGS__))
+#define cellular_hal_get_modem_supported_radio_technology(...) CELLULAR_TRACE_CALL(get_modem_supported_radio_technology, cellular_hal_get_modem_supported_radio_technology(__VA_ARGS__))
+#define cellular_hal_modem_factory_reset(...) CELLULAR_TRACE_CALL(modem_factory_reset, cellular_hal_modem_factory_reset(__VA_ARGS__))
+#define cellular_hal_modem_reset(...) CELLULAR_TRACE_CALL(modem_reset, cellular_hal_modem_reset(__VA_ARGS__))
+#endif
+
+#endif /* CELLULAR_TRACE_H */
@@ -0,0 +1,123 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:*
+ * Copyright 2023 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file cellular_watchdog.h
+ * @brief Deadlines for tests and HAL calls, with a diagnosis of what hung
+ *
+ * A background thread checks the running test against the test deadline and every
+ * cellular_hal_* call in progress, on any thread, against the deadline of its API. On
+ * expiry it logs the stacks of all threads, the last HAL calls and the time spent per
+ * API, then applies the action:
+ *
+ * - CELLULAR_WATCHDOG_SKIP: when the expired scope is on the test thread the test is
+ *   abandoned with cellular_trace_abandon_test() and marked hung, and the run goes on;
+ *   a HAL call hung on another thread is left to the test deadline
+ * - CELLULAR_WATCHDOG_ABORT: the log is flushed and the process aborts, leaving a core
+ *   file when they are enabled
+ *
+ * Stacks are captured by each thread in a handler of CELLULAR_WATCHDOG_DUMP_SIGNAL;
+ * a thread blocking the signal is reported as not answering.
+ */
+
+#ifndef CELLULAR_WATCHDOG_H
+#define CELLULAR_WATCHDOG_H
+
+#include <signal.h>
+#include "cellular_trace.h"
+
+#define CELLULAR_WATCHDOG_DUMP_SIGNAL    (SIGRTMIN + 4)
+#define CELLULAR_WATCHDOG_ABANDON_SIGNAL (SIGRTMIN + 5)
+#define CELLULAR_WATCHDOG_HISTORY        32
+#define CELLULAR_WATCHDOG_MAX_HANGS      16
+
+/**
+ * @brief What to do once a deadline expired and the diagnosis is logged
+ */
+typedef enum
+{
+    CELLULAR_WATCHDOG_SKIP = 0,
+    CELLULAR_WATCHDOG_ABORT
+} CellularWatchdogAction_t;
+
+/**
+ * @brief One expired deadline
+ */
+typedef struct
+{
+    const char *pTest;           /*!< Test running at the time, NULL outside of tests */
+    CellularHalApi_t api;        /*!< API of the expired call, CELLULAR_HAL_API_COUNT for the test deadline */
+    int tid;                     /*!< Thread of the expired scope */
+    unsigned int deadline_ms;
+    unsigned int elapsed_ms;     /*!< Time in the scope when the deadline was found expired */
+    unsigned int threads;        /*!< Threads whose stacks were logged */
+    int abandoned;               /*!< 1 when the test was abandoned */
+} CellularWatchdogHang_t;
+
+/**
+ * @brief Adds the probe and starts the watchdog thread, each start is matched by a cellular_watchdog_stop()
+ *
+ * @param[in] test_ms - deadline of every test, 0 for none
+ * @param[in] action  - action on expiry
+ *
+ * @return RETURN_OK, also when already started (the arguments are then ignored), RETURN_ERROR on failure
+ */
+int cellular_watchdog_start(unsigned int test_ms, CellularWatchdogAction_t action);
+
+/**
+ * @brief Matches a cellular_watchdog_start(); the last one removes the probe, ends the thread and clears the deadlines and expiries
+ *
+ * Call it outside the HAL calls of other threads.
+ */
+void cellular_watchdog_stop(void);
+
+/**
+ * @brief Sets the deadline of the calls of one API
+ *
+ * @param[in] api - API, CELLULAR_HAL_API_COUNT for the default of the APIs without their own deadline
+ * @param[in] ms  - deadline, 0 for the default (or for none when api is CELLULAR_HAL_API_COUNT)
+ *
+ * Warns that it is not enforced when the fork server is active, see cellular_fork_active().
+ *
+ * @return RETURN_OK, RETURN_ERROR for an invalid API
+ */
+int cellular_watchdog_set_api_deadline(CellularHalApi_t api, unsigned int ms);
+
+/**
+ * @brief Sets API deadlines from a list such as "30,get_available_networks_information=180"
+ *
+ * A plain number is the default, name=seconds the deadline of one API; names are taken
+ * with or without the cellular_hal_ prefix.
+ *
+ * @return RETURN_OK, RETURN_ERROR when an entry is invalid; the valid entries are applied
+ */
+int cellular_watchdog_set_api_deadlines(const char *pList);
+
+/**
+ * @brief Copies the expired deadlines
+ *
+ * @return the number of expired deadlines so far, of which the first max are copied
+ */
+unsigned int cellular_watchdog_get_hangs(CellularWatchdogHang_t *pHangs, unsigned int max);
+
+/**
+ * @brief Logs the expired deadlines, if started
+ */
+void cellular_watchdog_report(void);
+
+#endif /* CELLULAR_WATCHDOG_H */
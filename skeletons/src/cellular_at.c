@@ -0,0 +1,334 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:*
+ * Copyright 2023 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * AT-command transport of the reference HAL. Once cellular_sim_set_at_device() opened a
+ * serial device, the HAL calls with a 3GPP TS 27.007 equivalent send it and wait for the
+ * final result; the in-memory modem keeps delivering callbacks and answers what AT has
+ * no command for. A forked child goes back to the in-memory modem, the line stays with
+ * the parent.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include "cellular_sim_private.h"
+
+#define AT_TIMEOUT_MS      5000
+#define AT_SLOW_TIMEOUT_MS 30000
+#define AT_COMMAND_LENGTH  640
+#define AT_BUFFER_LENGTH   1024
+
+static pthread_mutex_t gAtLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t gAtOnce = PTHREAD_ONCE_INIT;
+static int gAtFd = -1;
+static char gAtBuffer[AT_BUFFER_LENGTH];
+static size_t gAtUsed;
+
+static uint64_t at_now_ms(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ((uint64_t)ts.tv_sec * 1000ull) + ((uint64_t)ts.tv_nsec / 1000000ull);
+}
+
+/* Taken by the calling threads only; a test abandoned by the harness watchdog is not jumped out of while it holds it */
+static void at_lock(void)
+{
+  sim_hold_abandon();
+  pthread_mutex_lock(&gAtLock);
+}
+
+static void at_unlock(void)
+{
+  pthread_mutex_unlock(&gAtLock);
+  sim_release_abandon();
+}
+
+static void at_atfork_child(void)
+{
+  pthread_mutex_init(&gAtLock, NULL);
+  if (gAtFd >= 0)
+  {
+    close(gAtFd);
+    gAtFd = -1;
+  }
+}
+
+static void at_once(void)
+{
+  pthread_atfork(NULL, NULL, at_atfork_child);
+}
+
+/* Network procedures may take the modem much longer than a query */
+static int at_timeout_ms(const char *pCommand)
+{
+  static const char *slow[] = { "+CFUN", "+COPS=", "+CGATT", "+CGACT" };
+  unsigned int i;
+
+  for (i = 0; i < sizeof(slow) / sizeof(slow[0]); i++)
+  {
+    if (strncmp(pCommand, slow[i], strlen(slow[i])) == 0)
+    {
+      return AT_SLOW_TIMEOUT_MS;
+    }
+  }
+  return AT_TIMEOUT_MS;
+}
+
+/* Reads the next non-empty line; lock must be held */
+static int at_read_line(char *pLine, size_t size, uint64_t deadline_ms)
+{
+  struct pollfd fd;
+  uint64_t now;
+  ssize_t got;
+  size_t i, length;
+
+  for (;;)
+  {
+    for (i = 0; (i < gAtUsed) && (gAtBuffer[i] != '\r') && (gAtBuffer[i] != '\n'); i++)
+    {
+    }
+    if (i < gAtUsed)
+    {
+      length = (i < size - 1) ? i : size - 1;
+      memcpy(pLine, gAtBuffer, length);
+      pLine[length] = '\0';
+      memmove(gAtBuffer, &gAtBuffer[i + 1], gAtUsed - i - 1);
+      gAtUsed -= i + 1;
+      if (i > 0)
+      {
+        return 0;
+      }
+      continue;
+    }
+    if (gAtUsed == sizeof(gAtBuffer))
+    {
+      /* No line end in a full buffer: the line is garbage */
+      gAtUsed = 0;
+    }
+    now = at_now_ms();
+    if (now >= deadline_ms)
+    {
+      return -1;
+    }
+    fd.fd = gAtFd;
+    fd.events = POLLIN;
+    if (poll(&fd, 1, (int)(deadline_ms - now)) <= 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      return -1;
+    }
+    got = read(gAtFd, &gAtBuffer[gAtUsed], sizeof(gAtBuffer) - gAtUsed);
+    if (got <= 0)
+    {
+      if ((got < 0) && ((errno == EINTR) || (errno == EAGAIN)))
+      {
+        continue;
+      }
+      return -1;
+    }
+    gAtUsed += (size_t)got;
+  }
+}
+
+/* Sends one command line and collects its response; lock must be held */
+static int at_transact(const char *pCommand, const char *pPrefix, char *pInfo, size_t size)
+{
+  char line[AT_BUFFER_LENGTH];
+  char command[AT_COMMAND_LENGTH];
+  uint64_t deadline;
+  size_t length, sent;
+  ssize_t written;
+  int found = 0;
+
+  length = (size_t)snprintf(command, sizeof(command), "AT%s\r", pCommand);
+  if (length >= sizeof(command))
+  {
+    return -1;
+  }
+  /* Whatever arrived between commands, unsolicited results or the end of a timed out response, is not ours */
+  tcflush(gAtFd, TCIFLUSH);
+  gAtUsed = 0;
+  for (sent = 0; sent < length; sent += (size_t)written)
+  {
+    written = write(gAtFd, &command[sent], length - sent);
+    if (written < 0)
+    {
+      if (errno == EINTR)
+      {
+        written = 0;
+        continue;
+      }
+      return -1;
+    }
+  }
+  command[length - 1] = '\0';
+
+  deadline = at_now_ms() + (uint64_t)at_timeout_ms(pCommand);
+  while (at_read_line(line, sizeof(line), deadline) == 0)
+  {
+    if (strcmp(line, "OK") == 0)
+    {
+      return ((pPrefix == NULL) || found) ? 0 : -1;
+    }
+    if ((strcmp(line, "ERROR") == 0) || (strncmp(line, "+CME ERROR", 10) == 0))
+    {
+      return -1;
+    }
+    if ((strcmp(line, command) == 0) || found || (pPrefix == NULL))
+    {
+      continue;
+    }
+    if (strncmp(line, pPrefix, strlen(pPrefix)) == 0)
+    {
+      for (length = strlen(pPrefix); line[length] == ' '; length++)
+      {
+      }
+      snprintf(pInfo, size, "%s", &line[length]);
+      found = 1;
+    }
+  }
+  return -1;
+}
+
+int cellular_sim_set_at_device(const char *pPath)
+{
+  struct termios tio;
+  int fd;
+  int result = 0;
+
+  pthread_once(&gAtOnce, at_once);
+  at_lock();
+  if (gAtFd >= 0)
+  {
+    close(gAtFd);
+    gAtFd = -1;
+  }
+  if (pPath != NULL)
+  {
+    fd = open(pPath, O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if ((fd < 0) || (tcgetattr(fd, &tio) != 0))
+    {
+      if (fd >= 0)
+      {
+        close(fd);
+      }
+      at_unlock();
+      return -1;
+    }
+    cfmakeraw(&tio);
+    cfsetspeed(&tio, B115200);
+    tio.c_cc[VMIN] = 0;
+    tio.c_cc[VTIME] = 0;
+    tcsetattr(fd, TCSANOW, &tio);
+    gAtFd = fd;
+    /* No echo, numeric errors and the numeric PLMN in +COPS? */
+    if ((at_transact("E0", NULL, NULL, 0) != 0) || (at_transact("+CMEE=1", NULL, NULL, 0) != 0) ||
+        (at_transact("+COPS=3,2", NULL, NULL, 0) != 0))
+    {
+      close(gAtFd);
+      gAtFd = -1;
+      result = -1;
+    }
+  }
+  at_unlock();
+  return result;
+}
+
+int sim_at_active(void)
+{
+  int active;
+
+  at_lock();
+  active = (gAtFd >= 0);
+  at_unlock();
+  return active;
+}
+
+int sim_at(const char *pPrefix, char *pInfo, size_t size, const char *pFormat, ...)
+{
+  char command[AT_COMMAND_LENGTH];
+  va_list args;
+  int length;
+  int result = -1;
+
+  va_start(args, pFormat);
+  length = vsnprintf(command, sizeof(command), pFormat, args);
+  va_end(args);
+  if ((length < 0) || ((size_t)length >= sizeof(command)))
+  {
+    return -1;
+  }
+  at_lock();
+  if (gAtFd >= 0)
+  {
+    result = at_transact(command, pPrefix, pInfo, size);
+  }
+  at_unlock();
+  return result;
+}
+
+int sim_at_field(const char *pInfo, unsigned int index, char *pField, size_t size)
+{
+  size_t used = 0;
+  int quoted = 0;
+
+  for (; (*pInfo != '\0') && (index > 0); pInfo++)
+  {
+    if (*pInfo == '"')
+    {
+      quoted = !quoted;
+    }
+    else if ((*pInfo == ',') && !quoted)
+    {
+      index--;
+    }
+  }
+  if (index > 0)
+  {
+    return -1;
+  }
+  for (; (*pInfo != '\0') && ((*pInfo != ',') || quoted); pInfo++)
+  {
+    if (*pInfo == '"')
+    {
+      quoted = !quoted;
+    }
+    else if ((*pInfo != ' ') || quoted)
+    {
+      if (used + 1 >= size)
+      {
+        return -1;
+      }
+      pField[used++] = *pInfo;
+    }
+  }
+  pField[used] = '\0';
+  return 0;
+}
@@ -0,0 +1,480 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:*
+ * Copyright 2023 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Radio channel of the simulated modem. The terminal moves at a constant speed along a
+ * line of cell sites, one dwell time apart; a site's level falls linearly with the
+ * distance to it, and each of the serving and neighbour cells adds shadow fading, a
+ * first order autoregressive process, so successive values are correlated as real
+ * measurements are. Every random draw comes from a seeded generator, which makes a
+ * trajectory reproducible step by step. A recorded trace can take the model's place.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cellular_sim_private.h"
+
+#define CHANNEL_SWING_DB       20.0     /* Above the mean at a site, below it at the next one */
+#define CHANNEL_HYSTERESIS_DB  3.0
+#define CHANNEL_TRIGGER_MS     640      /* Time the neighbour must stay the stronger one before the handover */
+#define CHANNEL_NOISE_DBM      -110.0   /* Thermal noise and noise figure over the carrier */
+#define CHANNEL_RESOURCE_BLOCKS 50      /* 10 MHz carrier */
+#define CHANNEL_CELLS_PER_AREA 8
+#define CHANNEL_CELL_ID        0x1A2B3C /* Power-on serving cell and area of the simulator */
+#define CHANNEL_AREA_CODE      0x2A1F
+#define CHANNEL_TRACE_LINE     256
+
+enum
+{
+  CHANNEL_OFF = 0,
+  CHANNEL_MODEL,
+  CHANNEL_TRACE
+};
+
+typedef struct
+{
+  const char *pName;
+  double enter_dbm;    /* RSRP to move up to it */
+  double leave_dbm;    /* RSRP below which it is left */
+} ChannelRat_t;
+
+/* Lowest first; GSM is what is left when nothing else can be held */
+static const ChannelRat_t gRats[] =
+{
+  { "GSM", -140.0, -140.0 },
+  { "UMTS", -118.0, -124.0 },
+  { "LTE", -110.0, -116.0 },
+  { "NR", -100.0, -106.0 },
+};
+
+#define CHANNEL_RAT_COUNT (sizeof(gRats) / sizeof(gRats[0]))
+
+typedef struct
+{
+  uint32_t ms;
+  CellularSignalInfoStruct signal;
+  unsigned long cell_id;
+  unsigned int area_code;
+  unsigned int rat;
+} ChannelSample_t;
+
+typedef struct
+{
+  unsigned char mode;
+  unsigned char timed;
+  uint32_t run;    /* Bumped by every set, so the pending step of an earlier run is dropped */
+  CellularSimChannel_t model;
+  uint64_t rng;
+  double position;    /* In cells, site n being at n */
+  long site;
+  long neighbour;
+  double shadow_serving;
+  double shadow_neighbour;
+  uint32_t trigger_ms;    /* How long the neighbour has been the stronger one */
+  ChannelSample_t *pTrace;
+  unsigned int trace_count;
+  unsigned int trace_next;
+  ChannelSample_t last;    /* What the modem reports, put back after a reset */
+  CellularSimChannelStats_t stats;
+} Channel_t;
+
+static Channel_t gChannel;
+
+/* splitmix64 */
+static uint64_t channel_random(void)
+{
+  uint64_t z = (gChannel.rng += 0x9E3779B97F4A7C15ull);
+
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  return z ^ (z >> 31);
+}
+
+/* Standard normal draw, Box-Muller */
+static double channel_gauss(void)
+{
+  double u1 = (double)((channel_random() >> 11) + 1) / 9007199254740992.0;
+  double u2 = (double)(channel_random() >> 11) / 9007199254740992.0;
+
+  return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+static double clamp(double value, double low, double high)
+{
+  return (value < low) ? low : ((value > high) ? high : value);
+}
+
+/* Best allowed technology the RSRP holds, with hysteresis against the current one; the current one when none is allowed */
+static unsigned int select_rat(unsigned int current, double rsrp)
+{
+  unsigned int rat, lowest = CHANNEL_RAT_COUNT;
+
+  for (rat = CHANNEL_RAT_COUNT; rat-- > 0;)
+  {
+    if (!sim_rat_allowed(gRats[rat].pName))
+    {
+      continue;
+    }
+    if (rsrp >= ((current >= rat) ? gRats[rat].leave_dbm : gRats[rat].enter_dbm))
+    {
+      return rat;
+    }
+    lowest = rat;
+  }
+  return (lowest < CHANNEL_RAT_COUNT) ? lowest : current;
+}
+
+static double site_level(long site)
+{
+  double distance = fabs(gChannel.position - (double)site);
+
+  return (double)gChannel.model.mean_rsrp_dbm + CHANNEL_SWING_DB * (1.0 - 2.0 * distance);
+}
+
+/* Serving and neighbour levels of the current position; lock must be held */
+static void model_sample(ChannelSample_t *pSample)
+{
+  double serving = site_level(gChannel.site) + gChannel.shadow_serving;
+  double neighbour = site_level(gChannel.neighbour) + gChannel.shadow_neighbour;
+  double sinr, rsrp, rssi;
+
+  rsrp = clamp(serving, -140.0, -44.0);
+  sinr = pow(10.0, serving / 10.0) / (pow(10.0, CHANNEL_NOISE_DBM / 10.0) + pow(10.0, neighbour / 10.0));
+  /* RSSI is the power over all resource elements, RSRQ the reference signal's share of it */
+  rssi = rsrp + 10.0 * log10(12.0 * CHANNEL_RESOURCE_BLOCKS) + 10.0 * log10(1.0 + 1.0 / sinr);
+  pSample->signal.RSRP = (int)lround(rsrp);
+  pSample->signal.RSSI = (int)lround(clamp(rssi, -120.0, -25.0));
+  pSample->signal.RSRQ = (int)lround(clamp(rsrp + 10.0 * log10(CHANNEL_RESOURCE_BLOCKS) - rssi, -20.0, -3.0));
+  pSample->signal.SNR = (int)lround(clamp(10.0 * log10(sinr), -20.0, 30.0));
+  /* Open loop power control from the path loss of an 18 dBm reference signal */
+  pSample->signal.TXPower = (int)lround(clamp(-80.0 + 0.8 * (18.0 - rsrp), -40.0, 23.0));
+  pSample->cell_id = CHANNEL_CELL_ID + (unsigned long)gChannel.site;
+  pSample->area_code = CHANNEL_AREA_CODE + (unsigned int)(gChannel.site / CHANNEL_CELLS_PER_AREA);
+  pSample->rat = select_rat(gChannel.last.rat, rsrp);
+}
+
+/* Moves the terminal one step on; lock must be held */
+static void model_step(ChannelSample_t *pSample)
+{
+  double rho = exp(-(double)gChannel.model.step_ms / (double)gChannel.model.decorrelation_ms);
+  double innovation = sqrt(1.0 - rho * rho) * (double)gChannel.model.shadowing_db;
+  double swap;
+  long neighbour;
+
+  gChannel.position += (double)gChannel.model.step_ms / (double)gChannel.model.cell_dwell_ms;
+  gChannel.shadow_serving = rho * gChannel.shadow_serving + innovation * channel_gauss();
+  gChannel.shadow_neighbour = rho * gChannel.shadow_neighbour + innovation * channel_gauss();
+  neighbour = (gChannel.position >= (double)gChannel.site) ? gChannel.site + 1 : gChannel.site - 1;
+  if (neighbour != gChannel.neighbour)
+  {
+    /* A cell not measured before has fading of its own */
+    gChannel.neighbour = neighbour;
+    gChannel.shadow_neighbour = (double)gChannel.model.shadowing_db * channel_gauss();
+    gChannel.trigger_ms = 0;
+  }
+  if (site_level(gChannel.neighbour) + gChannel.shadow_neighbour > site_level(gChannel.site) + gChannel.shadow_serving + CHANNEL_HYSTERESIS_DB)
+  {
+    gChannel.trigger_ms += gChannel.model.step_ms;
+  }
+  else
+  {
+    gChannel.trigger_ms = 0;
+  }
+  if (gChannel.trigger_ms >= CHANNEL_TRIGGER_MS)
+  {
+    gChannel.trigger_ms = 0;
+    neighbour = gChannel.site;
+    gChannel.site = gChannel.neighbour;
+    gChannel.neighbour = neighbour;
+    swap = gChannel.shadow_serving;
+    gChannel.shadow_serving = gChannel.shadow_neighbour;
+    gChannel.shadow_neighbour = swap;
+  }
+  model_sample(pSample);
+  pSample->ms = gChannel.last.ms + gChannel.model.step_ms;
+}
+
+/* Makes pSample what the modem reports and counts what changed; lock must be held */
+static void channel_apply(const ChannelSample_t *pSample, int counted)
+{
+  if (counted)
+  {
+    gChannel.stats.steps++;
+    gChannel.stats.simulated_ms += pSample->ms - gChannel.last.ms;
+    gChannel.stats.signal_changes += (memcmp(&pSample->signal, &gChannel.last.signal, sizeof(pSample->signal)) != 0);
+    gChannel.stats.handovers += (pSample->cell_id != gChannel.last.cell_id);
+    gChannel.stats.area_changes += (pSample->area_code != gChannel.last.area_code);
+    gChannel.stats.rat_changes += (pSample->rat != gChannel.last.rat);
+  }
+  gChannel.last = *pSample;
+  gSim.signal = pSample->signal;
+  gSim.plmn.cell_id = pSample->cell_id;
+  gSim.plmn.area_code = pSample->area_code;
+  snprintf(gSim.current_rat, sizeof(gSim.current_rat), "%s", gRats[pSample->rat].pName);
+}
+
+/* One step of the model or trace; 0 when a trace has no line left. Lock must be held */
+static int channel_step(void)
+{
+  ChannelSample_t sample;
+
+  if (gChannel.mode == CHANNEL_MODEL)
+  {
+    model_step(&sample);
+  }
+  else if (gChannel.trace_next < gChannel.trace_count)
+  {
+    sample = gChannel.pTrace[gChannel.trace_next++];
+  }
+  else
+  {
+    return 0;
+  }
+  channel_apply(&sample, 1);
+  return 1;
+}
+
+static void channel_event(void *pPayload);
+
+/* Posts the next step when the steps are timed and one is left; lock must be held */
+static void channel_schedule(void)
+{
+  uint32_t delay_ms;
+
+  if (!gChannel.timed)
+  {
+    return;
+  }
+  if (gChannel.mode == CHANNEL_MODEL)
+  {
+    delay_ms = gChannel.model.step_ms;
+  }
+  else if ((gChannel.mode == CHANNEL_TRACE) && (gChannel.trace_next < gChannel.trace_count))
+  {
+    /* Lines with the same time follow each other at once */
+    delay_ms = gChannel.pTrace[gChannel.trace_next].ms - gChannel.last.ms;
+  }
+  else
+  {
+    return;
+  }
+  sim_post(delay_ms, channel_event, &gChannel.run, sizeof(gChannel.run));
+}
+
+static void channel_event(void *pPayload)
+{
+  uint32_t run = *(uint32_t *)pPayload;
+
+  sim_lock();
+  if ((run == gChannel.run) && channel_step())
+  {
+    channel_schedule();
+  }
+  sim_unlock();
+}
+
+/* Drops the current model or trace and schedules the steps of the new one; lock must be held */
+static void channel_start(unsigned char mode, unsigned char timed, ChannelSample_t *pTrace, unsigned int count)
+{
+  free(gChannel.pTrace);
+  gChannel.pTrace = pTrace;
+  gChannel.trace_count = count;
+  gChannel.trace_next = 0;
+  gChannel.mode = mode;
+  gChannel.timed = timed;
+  gChannel.run++;
+  memset(&gChannel.stats, 0, sizeof(gChannel.stats));
+  channel_schedule();
+}
+
+void sim_channel_restart(void)
+{
+  if (gChannel.mode == CHANNEL_OFF)
+  {
+    return;
+  }
+  /* The reset dropped the pending step with the rest of the queue */
+  channel_apply(&gChannel.last, 0);
+  channel_schedule();
+}
+
+void cellular_sim_default_channel(CellularSimChannel_t *pChannel)
+{
+  if (pChannel == NULL)
+  {
+    return;
+  }
+  memset(pChannel, 0, sizeof(*pChannel));
+  pChannel->seed = 1;
+  pChannel->step_ms = 100;
+  pChannel->timed = 1;
+  pChannel->mean_rsrp_dbm = -95;
+  pChannel->shadowing_db = 6;
+  pChannel->decorrelation_ms = 5000;
+  pChannel->cell_dwell_ms = 60000;
+}
+
+int cellular_sim_set_channel(const CellularSimChannel_t *pChannel)
+{
+  ChannelSample_t first;
+
+  if ((pChannel != NULL) && ((pChannel->step_ms == 0) || (pChannel->decorrelation_ms == 0) || (pChannel->cell_dwell_ms == 0) ||
+                             (pChannel->mean_rsrp_dbm > -44) || (pChannel->mean_rsrp_dbm < -140)))
+  {
+    return -1;
+  }
+  sim_lock();
+  if (pChannel == NULL)
+  {
+    channel_start(CHANNEL_OFF, 0, NULL, 0);
+    sim_unlock();
+    return 0;
+  }
+  gChannel.model = *pChannel;
+  gChannel.rng = pChannel->seed;
+  gChannel.position = 0.0;
+  gChannel.site = 0;
+  gChannel.neighbour = 1;
+  gChannel.trigger_ms = 0;
+  gChannel.shadow_serving = (double)pChannel->shadowing_db * channel_gauss();
+  gChannel.shadow_neighbour = (double)pChannel->shadowing_db * channel_gauss();
+  memset(&gChannel.last, 0, sizeof(gChannel.last));
+  for (gChannel.last.rat = 0; (gChannel.last.rat < CHANNEL_RAT_COUNT) && (strcmp(gRats[gChannel.last.rat].pName, gSim.current_rat) != 0); gChannel.last.rat++)
+  {
+  }
+  gChannel.last.rat = (gChannel.last.rat < CHANNEL_RAT_COUNT) ? gChannel.last.rat : 0;
+  model_sample(&first);
+  first.ms = 0;
+  channel_apply(&first, 0);
+  channel_start(CHANNEL_MODEL, pChannel->timed ? 1 : 0, NULL, 0);
+  sim_unlock();
+  return 0;
+}
+
+/* One trace line into pSample; 0 on success, 1 for a blank or comment line, -1 when invalid */
+static int parse_sample(char *pLine, ChannelSample_t *pSample)
+{
+  char rat[8];
+  long cell;
+  int area;
+  unsigned int i;
+
+  pLine[strcspn(pLine, "#\r\n")] = '\0';
+  if (pLine[strspn(pLine, " \t")] == '\0')
+  {
+    return 1;
+  }
+  memset(pSample, 0, sizeof(*pSample));
+  if (sscanf(pLine, "%u %d %d %d %d %d %li %i %7s", &pSample->ms, &pSample->signal.RSSI, &pSample->signal.RSRQ, &pSample->signal.RSRP,
+             &pSample->signal.SNR, &pSample->signal.TXPower, &cell, &area, rat) != 9)
+  {
+    return -1;
+  }
+  pSample->cell_id = (unsigned long)cell;
+  pSample->area_code = (unsigned int)area;
+  for (i = 0; (i < CHANNEL_RAT_COUNT) && (strcmp(gRats[i].pName, rat) != 0); i++)
+  {
+  }
+  pSample->rat = i;
+  return (i < CHANNEL_RAT_COUNT) ? 0 : -1;
+}
+
+int cellular_sim_set_channel_trace(const char *pPath, int timed)
+{
+  char line[CHANNEL_TRACE_LINE];
+  ChannelSample_t *pTrace = NULL;
+  ChannelSample_t *pGrown;
+  unsigned int count = 0, capacity = 0;
+  int parsed = 0;
+  FILE *pFile;
+
+  if (pPath == NULL)
+  {
+    return cellular_sim_set_channel(NULL);
+  }
+  pFile = fopen(pPath, "r");
+  if (pFile == NULL)
+  {
+    return -1;
+  }
+  while ((parsed >= 0) && (fgets(line, sizeof(line), pFile) != NULL))
+  {
+    if (count == capacity)
+    {
+      capacity = (capacity == 0) ? 64 : capacity * 2;
+      pGrown = (ChannelSample_t *)realloc(pTrace, capacity * sizeof(ChannelSample_t));
+      if (pGrown == NULL)
+      {
+        parsed = -1;
+        break;
+      }
+      pTrace = pGrown;
+    }
+    parsed = parse_sample(line, &pTrace[count]);
+    if ((parsed == 0) && (count > 0) && (pTrace[count].ms < pTrace[count - 1].ms))
+    {
+      parsed = -1;
+    }
+    count += (parsed == 0);
+  }
+  fclose(pFile);
+  if ((parsed < 0) || (count == 0))
+  {
+    free(pTrace);
+    return -1;
+  }
+  sim_lock();
+  /* The first line applies at once, the others at their times from it */
+  channel_start(CHANNEL_TRACE, timed ? 1 : 0, pTrace, count);
+  gChannel.trace_next = 1;
+  channel_apply(&pTrace[0], 0);
+  channel_schedule();
+  sim_unlock();
+  return 0;
+}
+
+int cellular_sim_step_channel(unsigned int steps)
+{
+  unsigned int i;
+
+  sim_lock();
+  if (gChannel.mode == CHANNEL_OFF)
+  {
+    sim_unlock();
+    return -1;
+  }
+  for (i = 0; (i < steps) && channel_step(); i++)
+  {
+  }
+  sim_unlock();
+  return 0;
+}
+
+int cellular_sim_get_channel_stats(CellularSimChannelStats_t *pStats)
+{
+  if (pStats == NULL)
+  {
+    return -1;
+  }
+  sim_lock();
+  *pStats = gChannel.stats;
+  sim_unlock();
+  return 0;
+}
@@ -0,0 +1,307 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:*
+ * Copyright 2023 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Binary control-protocol transport of the reference HAL, the framed counterpart of
+ * cellular_at.c. Requests are pipelined: every calling thread sends its request under
+ * its own transaction id and waits for that response only, while a reader thread
+ * matches responses to waiters and keeps the serving system of the indications, so
+ * PLMN and RAT reads after the first take no round trip. A forked child goes back to
+ * the in-memory modem, the socket stays with the parent.
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "cellular_ctl_protocol.h"
+#include "cellular_sim_private.h"
+
+#define CTL_TIMEOUT_MS      5000
+#define CTL_SLOW_TIMEOUT_MS 30000
+#define CTL_MAX_OUTSTANDING 32
+
+typedef struct
+{
+  unsigned char busy;
+  unsigned char done;
+  uint16_t transaction;
+  size_t size;
+  uint8_t frame[CELLULAR_CTL_MAX_FRAME];
+} CtlSlot_t;
+
+static pthread_mutex_t gCtlLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t gCtlCond;
+static pthread_once_t gCtlOnce = PTHREAD_ONCE_INIT;
+static int gCtlFd = -1;
+static uint32_t gCtlGeneration;
+static pthread_t gCtlReader;
+static uint16_t gCtlTransaction;
+static CtlSlot_t gCtlSlots[CTL_MAX_OUTSTANDING];
+static uint8_t gCtlServing[CELLULAR_CTL_SERVING_SIZE];
+static unsigned char gCtlServingValid;
+
+/* The lock as taken by the calling threads; the reader thread is never abandoned and takes it directly */
+static void ctl_lock(void)
+{
+  sim_hold_abandon();
+  pthread_mutex_lock(&gCtlLock);
+}
+
+static void ctl_unlock(void)
+{
+  pthread_mutex_unlock(&gCtlLock);
+  sim_release_abandon();
+}
+
+static void ctl_atfork_child(void)
+{
+  pthread_mutex_init(&gCtlLock, NULL);
+  memset(gCtlSlots, 0, sizeof(gCtlSlots));
+  if (gCtlFd >= 0)
+  {
+    close(gCtlFd);
+    gCtlFd = -1;
+  }
+}
+
+static void ctl_once(void)
+{
+  pthread_condattr_t attr;
+
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&gCtlCond, &attr);
+  pthread_condattr_destroy(&attr);
+  pthread_atfork(NULL, NULL, ctl_atfork_child);
+}
+
+static void *ctl_reader(void *pArg)
+{
+  int fd = (int)(intptr_t)pArg;
+  uint8_t frame[CELLULAR_CTL_MAX_FRAME];
+  CellularCtlFrame_t parsed;
+  const uint8_t *pServing;
+  uint16_t length;
+  unsigned int i;
+  ssize_t got;
+
+  prctl(PR_SET_NAME, "cellular_ctlrd", 0, 0, 0);
+  while ((got = recv(fd, frame, sizeof(frame), 0)) > 0)
+  {
+    if (cellular_ctl_parse(frame, (size_t)got, &parsed) != 0)
+    {
+      continue;
+    }
+    pthread_mutex_lock(&gCtlLock);
+    if ((parsed.flags == CELLULAR_CTL_FLAG_INDICATION) && (parsed.message == CELLULAR_CTL_SERVING_INDICATION))
+    {
+      pServing = cellular_ctl_find(&parsed, CELLULAR_CTL_TLV_SERVING, &length);
+      if ((pServing != NULL) && (length == sizeof(gCtlServing)))
+      {
+        memcpy(gCtlServing, pServing, sizeof(gCtlServing));
+        gCtlServingValid = 1;
+      }
+    }
+    else if (parsed.flags == CELLULAR_CTL_FLAG_RESPONSE)
+    {
+      for (i = 0; i < CTL_MAX_OUTSTANDING; i++)
+      {
+        if (gCtlSlots[i].busy && !gCtlSlots[i].done && (gCtlSlots[i].transaction == parsed.transaction))
+        {
+          memcpy(gCtlSlots[i].frame, frame, (size_t)got);
+          gCtlSlots[i].size = (size_t)got;
+          gCtlSlots[i].done = 1;
+          pthread_cond_broadcast(&gCtlCond);
+          break;
+        }
+      }
+    }
+    pthread_mutex_unlock(&gCtlLock);
+  }
+  return NULL;
+}
+
+/* Closes the socket and wakes the waiters, who fail; lock must not be held */
+static void ctl_close(void)
+{
+  int fd;
+
+  ctl_lock();
+  fd = gCtlFd;
+  gCtlFd = -1;
+  gCtlGeneration++;
+  gCtlServingValid = 0;
+  pthread_cond_broadcast(&gCtlCond);
+  ctl_unlock();
+  if (fd >= 0)
+  {
+    shutdown(fd, SHUT_RDWR);
+    pthread_join(gCtlReader, NULL);
+    close(fd);
+  }
+}
+
+int cellular_sim_set_ctl_device(const char *pPath)
+{
+  struct sockaddr_un address;
+  int fd;
+
+  pthread_once(&gCtlOnce, ctl_once);
+  ctl_close();
+  if (pPath == NULL)
+  {
+    return 0;
+  }
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (strlen(pPath) >= sizeof(address.sun_path))
+  {
+    return -1;
+  }
+  strcpy(address.sun_path, pPath);
+  fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+  if ((fd < 0) || (connect(fd, (struct sockaddr *)&address, sizeof(address)) != 0) ||
+      (pthread_create(&gCtlReader, NULL, ctl_reader, (void *)(intptr_t)fd) != 0))
+  {
+    if (fd >= 0)
+    {
+      close(fd);
+    }
+    return -1;
+  }
+  ctl_lock();
+  gCtlFd = fd;
+  ctl_unlock();
+  return 0;
+}
+
+int sim_ctl_active(void)
+{
+  int active;
+
+  ctl_lock();
+  active = (gCtlFd >= 0);
+  ctl_unlock();
+  return active;
+}
+
+int sim_ctl(uint16_t message, uint8_t *pFrame, size_t used, uint8_t *pResponse, CellularCtlFrame_t *pParsed)
+{
+  CellularCtlFrame_t parsed;
+  const uint8_t *pResult;
+  struct timespec deadline;
+  uint32_t generation;
+  uint16_t length;
+  unsigned int i;
+  int timeout_ms;
+  int result = -1;
+
+  timeout_ms = ((message == CELLULAR_CTL_SET_OPERATING_MODE) || (message == CELLULAR_CTL_ATTACH) ||
+                (message == CELLULAR_CTL_START_NETWORK) || (message == CELLULAR_CTL_STOP_NETWORK)) ? CTL_SLOW_TIMEOUT_MS : CTL_TIMEOUT_MS;
+  clock_gettime(CLOCK_MONOTONIC, &deadline);
+  deadline.tv_sec += timeout_ms / 1000;
+
+  ctl_lock();
+  generation = gCtlGeneration;
+  for (;;)
+  {
+    for (i = 0; (i < CTL_MAX_OUTSTANDING) && gCtlSlots[i].busy; i++)
+    {
+    }
+    if ((gCtlFd < 0) || (generation != gCtlGeneration) || (i < CTL_MAX_OUTSTANDING) ||
+        (pthread_cond_timedwait(&gCtlCond, &gCtlLock, &deadline) == ETIMEDOUT))
+    {
+      break;
+    }
+  }
+  if ((gCtlFd < 0) || (generation != gCtlGeneration) || (i == CTL_MAX_OUTSTANDING))
+  {
+    ctl_unlock();
+    return -1;
+  }
+  gCtlSlots[i].busy = 1;
+  gCtlSlots[i].done = 0;
+  gCtlTransaction = (gCtlTransaction == UINT16_MAX) ? 1 : gCtlTransaction + 1;
+  gCtlSlots[i].transaction = gCtlTransaction;
+  cellular_ctl_begin(pFrame, CELLULAR_CTL_FLAG_REQUEST, gCtlTransaction, message);
+  /* One datagram per request, so concurrent sends never interleave */
+  if (send(gCtlFd, pFrame, cellular_ctl_end(pFrame, used), MSG_NOSIGNAL) == (ssize_t)used)
+  {
+    while (!gCtlSlots[i].done && (generation == gCtlGeneration) &&
+           (pthread_cond_timedwait(&gCtlCond, &gCtlLock, &deadline) != ETIMEDOUT))
+    {
+    }
+  }
+  if (gCtlSlots[i].done && (cellular_ctl_parse(gCtlSlots[i].frame, gCtlSlots[i].size, &parsed) == 0))
+  {
+    pResult = cellular_ctl_find(&parsed, CELLULAR_CTL_TLV_RESULT, &length);
+    result = ((pResult != NULL) && (length == 4) && (cellular_ctl_get16(pResult) == 0)) ? 0 : -1;
+    if ((result == 0) && (pResponse != NULL))
+    {
+      memcpy(pResponse, gCtlSlots[i].frame, gCtlSlots[i].size);
+      cellular_ctl_parse(pResponse, gCtlSlots[i].size, pParsed);
+    }
+  }
+  gCtlSlots[i].busy = 0;
+  pthread_cond_broadcast(&gCtlCond);
+  ctl_unlock();
+  return result;
+}
+
+int sim_ctl_serving(uint8_t *pServing)
+{
+  uint8_t frame[CELLULAR_CTL_MAX_FRAME];
+  uint8_t response[CELLULAR_CTL_MAX_FRAME];
+  CellularCtlFrame_t parsed;
+  const uint8_t *pValue;
+  uint16_t length;
+
+  ctl_lock();
+  if (gCtlServingValid)
+  {
+    memcpy(pServing, gCtlServing, CELLULAR_CTL_SERVING_SIZE);
+    ctl_unlock();
+    return 0;
+  }
+  ctl_unlock();
+  if (sim_ctl(CELLULAR_CTL_GET_SERVING_SYSTEM, frame, CELLULAR_CTL_HEADER_SIZE, response, &parsed) != 0)
+  {
+    return -1;
+  }
+  pValue = cellular_ctl_find(&parsed, CELLULAR_CTL_TLV_SERVING, &length);
+  if ((pValue == NULL) || (length != CELLULAR_CTL_SERVING_SIZE))
+  {
+    return -1;
+  }
+  memcpy(pServing, pValue, CELLULAR_CTL_SERVING_SIZE);
+  /* An indication which came in meanwhile is newer than this response */
+  ctl_lock();
+  if (!gCtlServingValid)
+  {
+    memcpy(gCtlServing, pValue, CELLULAR_CTL_SERVING_SIZE);
+    gCtlServingValid = 1;
+  }
+  ctl_unlock();
+  return 0;
+}
@@ -16,255 +16,1290 @@
  * limitations under the License.
  */
 
+/*
+ * Reference HAL for the linux build, backed by the simulated modem in cellular_sim.c.
+ * Arguments are validated as the HAL specification requires and callbacks are
+ * delivered asynchronously from the simulator event thread. With an AT device set, the
+ * calls with an AT equivalent go through cellular_at.c first; with a control-protocol
+ * socket set, those with a message go through cellular_ctl.c instead.
+ */
+
 #include <string.h>
 #include <stdlib.h>
-#include <setjmp.h>
+#include <stdio.h>
 #include "cellular_hal.h"
+#include "cellular_sim_private.h"
+
+#define SIM_IMEI          "352099001761481"
+#define SIM_IMEI_SV       "352099001761401"
+#define SIM_FIRMWARE      "SIM_1.0.0"
+#define SIM_SUPPORTED_RAT "GSM,UMTS,LTE,NR"
+#define SIM_FIRMWARE_LENGTH 64
+
+typedef struct
+{
+  CellularDeviceContextCBStruct cb;
+  CellularModemOperatingConfiguration_t operating_config;
+} DeviceOpenEvent_t;
+
+typedef struct
+{
+  cellular_device_slot_status_api_callback cb;
+  unsigned int slot;
+  CellularUICCApplication_t application;
+  CellularDeviceSlotStatus_t status;
+} SlotEvent_t;
+
+typedef struct
+{
+  cellular_device_profile_status_api_callback cb;
+  int profile_id;
+  CellularProfileType_t type;
+  CellularDeviceProfileSelectionStatus_t status;
+} ProfileEvent_t;
+
+/* +WS46 selections with their technologies as GSM 1, UMTS 2, LTE 4 and NR 8 */
+static const struct
+{
+  int ws46;
+  unsigned int rats;
+  const char *pName;
+} gWs46[] =
+{
+  { 25, 7, "AUTO" },
+  { 12, 1, "GSM" },
+  { 22, 2, "UMTS" },
+  { 28, 4, "LTE" },
+  { 29, 3, "GSM,UMTS" },
+  { 30, 5, "GSM,LTE" },
+  { 31, 6, "UMTS,LTE" },
+  { 36, 8, "NR" },
+  { 37, 12, "LTE,NR" }
+};
+
+static const CellularNetworkScanResultInfoStruct gScanResults[] =
+{
+  { "Sim Operator", 310, 260, TRUE },
+  { "Sim Partner", 310, 410, TRUE },
+  { "Sim Roaming", 311, 480, FALSE },
+  { "Sim Foreign", 234, 15, FALSE }
+};
+
+static void device_open_event(void *pPayload)
+{
+  DeviceOpenEvent_t *pEvent = (DeviceOpenEvent_t *)pPayload;
+  char deviceName[] = SIM_DEVICE_NAME;
+  char wanIfName[] = SIM_WAN_IFNAME;
+
+  sim_lock();
+  gSim.ctrl_opened = gSim.present;
+  sim_unlock();
+  if (pEvent->cb.device_open_status_cb != NULL)
+  {
+    pEvent->cb.device_open_status_cb(deviceName, wanIfName, DEVICE_OPEN_STATUS_READY, pEvent->operating_config);
+  }
+}
+
+static void slot_event(void *pPayload)
+{
+  SlotEvent_t *pEvent = (SlotEvent_t *)pPayload;
+  char slotName[16];
+  char slotType[8];
+
+  snprintf(slotName, sizeof(slotName), "slot%u", pEvent->slot + 1);
+  snprintf(slotType, sizeof(slotType), "%s", (pEvent->application == CELLULAR_UICC_APPLICATION_ESIM) ? "eSIM" :
+           (pEvent->application == CELLULAR_UICC_APPLICATION_ISIM) ? "ISIM" : "USIM");
+  pEvent->cb(slotName, slotType, (int)pEvent->slot, pEvent->status);
+}
+
+static void profile_event(void *pPayload)
+{
+  ProfileEvent_t *pEvent = (ProfileEvent_t *)pPayload;
+  char profileId[16];
+
+  snprintf(profileId, sizeof(profileId), "%d", pEvent->profile_id);
+  pEvent->cb(profileId, pEvent->type, pEvent->status);
+}
+
+static void post_profile_status(cellular_device_profile_status_api_callback cb, const CellularProfileStruct *pProfile, CellularDeviceProfileSelectionStatus_t status)
+{
+  ProfileEvent_t event;
+
+  if (cb != NULL)
+  {
+    event.cb = cb;
+    event.profile_id = pProfile->ProfileID;
+    event.type = pProfile->ProfileType;
+    event.status = status;
+    sim_post(0, profile_event, &event, sizeof(event));
+  }
+}
+
+/* The active slot while its card can register, else the first powered slot whose card can; the slot count when none can. Lock must be held */
+static unsigned int usable_slot(void)
+{
+  unsigned int slot, i;
+
+  for (i = 0; i <= gSim.config.slots; i++)
+  {
+    slot = (i == 0) ? gSim.active_slot : i - 1;
+    if (sim_card_ready(slot))
+    {
+      return slot;
+    }
+  }
+  return gSim.config.slots;
+}
+
+static int profile_valid(const CellularProfileStruct *pProfile)
+{
+  return ((pProfile != NULL) &&
+          (pProfile->ProfileType >= CELLULAR_PROFILE_TYPE_3GPP) && (pProfile->ProfileType <= CELLULAR_PROFILE_TYPE_3GPP2) &&
+          (pProfile->PDPType >= CELLULAR_PDP_TYPE_IPV4) && (pProfile->PDPType <= CELLULAR_PDP_TYPE_IPV4_OR_IPV6) &&
+          (pProfile->PDPAuthentication >= CELLULAR_PDP_AUTHENTICATION_NONE) && (pProfile->PDPAuthentication <= CELLULAR_PDP_AUTHENTICATION_CHAP) &&
+          (pProfile->PDPNetworkConfig >= CELLULAR_PDP_NETWORK_CONFIG_NAS) && (pProfile->PDPNetworkConfig <= CELLULAR_PDP_NETWORK_CONFIG_DHCP)) ? 1 : 0;
+}
+
+static int find_profile(int profileId)
+{
+  unsigned int i;
+
+  for (i = 0; i < gSim.profile_count; i++)
+  {
+    if (gSim.profiles[i].ProfileID == profileId)
+    {
+      return (int)i;
+    }
+  }
+  return -1;
+}
+
+/* Accepts "AUTO" or a comma separated list of known technologies */
+static int rat_valid(const char *pRat)
+{
+  static const char *known[] = { "AUTO", "CDMA20001X", "EVDO", "GSM", "UMTS", "LTE", "NR" };
+  char copy[SIM_RAT_LENGTH];
+  char *pSave = NULL;
+  char *pToken;
+  unsigned int i;
+  int found;
+
+  if ((pRat == NULL) || (pRat[0] == '\0') || (strlen(pRat) >= sizeof(copy)))
+  {
+    return 0;
+  }
+  strcpy(copy, pRat);
+  for (pToken = strtok_r(copy, ",", &pSave); pToken != NULL; pToken = strtok_r(NULL, ",", &pSave))
+  {
+    found = 0;
+    for (i = 0; i < sizeof(known) / sizeof(known[0]); i++)
+    {
+      found |= (strcmp(pToken, known[i]) == 0);
+    }
+    if (!found)
+    {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/* Technologies of a RAT list, 0 when one has no bit; AUTO is what +WS46=25 selects */
+static unsigned int rat_mask(const char *pRat)
+{
+  static const char *names[] = { "GSM", "UMTS", "LTE", "NR" };
+  char copy[SIM_RAT_LENGTH];
+  char *pSave = NULL;
+  char *pToken;
+  unsigned int i, mask = 0, bit;
+
+  if (strcmp(pRat, "AUTO") == 0)
+  {
+    return 7;
+  }
+  snprintf(copy, sizeof(copy), "%s", pRat);
+  for (pToken = strtok_r(copy, ",", &pSave); pToken != NULL; pToken = strtok_r(NULL, ",", &pSave))
+  {
+    for (i = 0, bit = 0; i < sizeof(names) / sizeof(names[0]); i++)
+    {
+      bit |= (strcmp(pToken, names[i]) == 0) ? (1u << i) : 0;
+    }
+    if (bit == 0)
+    {
+      return 0;
+    }
+    mask |= bit;
+  }
+  return mask;
+}
+
+/* Copies one field of an AT response, refusing values longer than the HAL output */
+static int at_string(const char *pCommand, const char *pPrefix, unsigned int field, char *pOut, size_t size)
+{
+  char info[128];
+  char value[128];
+
+  if ((sim_at(pPrefix, info, sizeof(info), "%s", pCommand) != 0) ||
+      (sim_at_field(info, field, value, sizeof(value)) != 0) || (strlen(value) >= size))
+  {
+    return RETURN_ERROR;
+  }
+  strcpy(pOut, value);
+  return RETURN_OK;
+}
+
+static int at_field_int(const char *pInfo, unsigned int field, int *pValue)
+{
+  char value[16];
+
+  if ((sim_at_field(pInfo, field, value, sizeof(value)) != 0) || (value[0] == '\0'))
+  {
+    return -1;
+  }
+  *pValue = atoi(value);
+  return 0;
+}
+
+/* RSSI from +CSQ, RSRQ and RSRP from +CESQ; unknown values keep the simulated ones */
+static int at_signal_info(CellularSignalInfoStruct *pSignal)
+{
+  char info[64];
+  int value;
+
+  if (sim_at("+CSQ:", info, sizeof(info), "+CSQ") != 0)
+  {
+    return RETURN_ERROR;
+  }
+  if ((at_field_int(info, 0, &value) == 0) && (value < 99))
+  {
+    pSignal->RSSI = -113 + (2 * value);
+  }
+  if (sim_at("+CESQ:", info, sizeof(info), "+CESQ") == 0)
+  {
+    if ((at_field_int(info, 4, &value) == 0) && (value < 255))
+    {
+      pSignal->RSRQ = (value / 2) - 20;
+    }
+    if ((at_field_int(info, 5, &value) == 0) && (value < 255))
+    {
+      pSignal->RSRP = value - 141;
+    }
+  }
+  return RETURN_OK;
+}
+
+/* Registration from +CEREG?, the numeric PLMN from +COPS? */
+static int at_plmn_information(CellularCurrentPlmnInfoStruct *pPlmn)
+{
+  char info[128];
+  char plmn[16];
+  int stat;
+
+  if ((sim_at("+CEREG:", info, sizeof(info), "+CEREG?") != 0) || (at_field_int(info, 1, &stat) != 0))
+  {
+    return RETURN_ERROR;
+  }
+  pPlmn->registration_status = ((stat == 1) || (stat == 5)) ? DEVICE_NAS_STATUS_REGISTERED :
+                               (stat == 2) ? DEVICE_NAS_STATUS_REGISTERING : DEVICE_NAS_STATUS_NOT_REGISTERED;
+  pPlmn->roaming_status = (stat == 5) ? DEVICE_NAS_STATUS_ROAMING_ON : DEVICE_NAS_STATUS_ROAMING_OFF;
+  if (pPlmn->registration_status != DEVICE_NAS_STATUS_REGISTERED)
+  {
+    return RETURN_OK;
+  }
+  if (sim_at("+COPS:", info, sizeof(info), "+COPS?") != 0)
+  {
+    return RETURN_ERROR;
+  }
+  if ((sim_at_field(info, 2, plmn, sizeof(plmn)) == 0) && (strlen(plmn) >= 5))
+  {
+    pPlmn->MNC = (unsigned int)atoi(&plmn[3]);
+    plmn[3] = '\0';
+    pPlmn->MCC = (unsigned int)atoi(plmn);
+  }
+  return RETURN_OK;
+}
+
+static int at_operating_configuration(CellularModemOperatingConfiguration_t config)
+{
+  switch (config)
+  {
+    case CELLULAR_MODEM_SET_ONLINE:
+      return sim_at(NULL, NULL, 0, "+CFUN=1");
+    case CELLULAR_MODEM_SET_OFFLINE:
+      return sim_at(NULL, NULL, 0, "+CFUN=4");
+    case CELLULAR_MODEM_SET_LOW_POWER_MODE:
+      return sim_at(NULL, NULL, 0, "+CFUN=0");
+    case CELLULAR_MODEM_SET_RESET:
+      return sim_at(NULL, NULL, 0, "+CFUN=1,1");
+    case CELLULAR_MODEM_SET_FACTORY_RESET:
+      /* &F brings back echo and the long PLMN format the transport turned off */
+      return ((sim_at(NULL, NULL, 0, "&FE0;+COPS=3,2") == 0) && (sim_at(NULL, NULL, 0, "+CFUN=1,1") == 0)) ? 0 : -1;
+    default:
+      return 0;
+  }
+}
+
+/* +CGDCONT and +CGAUTH for the PDP context of a profile */
+static int at_define_context(const CellularProfileStruct *pProfile)
+{
+  const char *pType;
+
+  switch (pProfile->PDPType)
+  {
+    case CELLULAR_PDP_TYPE_IPV6:
+      pType = "IPV6";
+      break;
+    case CELLULAR_PDP_TYPE_IPV4_OR_IPV6:
+      pType = "IPV4V6";
+      break;
+    case CELLULAR_PDP_TYPE_PPP:
+      pType = "PPP";
+      break;
+    default:
+      pType = "IP";
+      break;
+  }
+  /* A quote would end the string parameter early */
+  if ((memchr(pProfile->APN, '"', strnlen(pProfile->APN, sizeof(pProfile->APN))) != NULL) ||
+      (memchr(pProfile->Username, '"', strnlen(pProfile->Username, sizeof(pProfile->Username))) != NULL) ||
+      (memchr(pProfile->Password, '"', strnlen(pProfile->Password, sizeof(pProfile->Password))) != NULL) ||
+      (sim_at(NULL, NULL, 0, "+CGDCONT=%d,\"%s\",\"%.*s\"", pProfile->PDPContextNumber, pType,
+              (int)sizeof(pProfile->APN), pProfile->APN) != 0))
+  {
+    return -1;
+  }
+  if (pProfile->PDPAuthentication == CELLULAR_PDP_AUTHENTICATION_NONE)
+  {
+    return sim_at(NULL, NULL, 0, "+CGAUTH=%d,0", pProfile->PDPContextNumber);
+  }
+  return sim_at(NULL, NULL, 0, "+CGAUTH=%d,%d,\"%.*s\",\"%.*s\"", pProfile->PDPContextNumber,
+                (pProfile->PDPAuthentication == CELLULAR_PDP_AUTHENTICATION_PAP) ? 1 : 2,
+                (int)sizeof(pProfile->Username), pProfile->Username, (int)sizeof(pProfile->Password), pProfile->Password);
+}
+
+/* Index of the profile, or -1; takes the lock */
+static int profile_index(int profileId, int *pContext)
+{
+  int index;
+
+  sim_lock();
+  index = find_profile(profileId);
+  if ((index >= 0) && (pContext != NULL))
+  {
+    *pContext = gSim.profiles[index].PDPContextNumber;
+  }
+  sim_unlock();
+  return index;
+}
+
+/* Copies a string TLV of the identity response, refusing values longer than the HAL output */
+static int ctl_identity(uint8_t type, char *pOut, size_t size)
+{
+  uint8_t frame[CELLULAR_CTL_MAX_FRAME];
+  uint8_t response[CELLULAR_CTL_MAX_FRAME];
+  CellularCtlFrame_t parsed;
+  const uint8_t *pValue;
+  uint16_t length;
+
+  if ((sim_ctl(CELLULAR_CTL_GET_IDENTITY, frame, CELLULAR_CTL_HEADER_SIZE, response, &parsed) != 0) ||
+      ((pValue = cellular_ctl_find(&parsed, type, &length)) == NULL) || (length >= size))
+  {
+    return RETURN_ERROR;
+  }
+  memcpy(pOut, pValue, length);
+  pOut[length] = '\0';
+  return RETURN_OK;
+}
+
+/* Sends a request whose only argument is one byte */
+static int ctl_byte(uint16_t message, uint8_t value)
+{
+  uint8_t frame[CELLULAR_CTL_MAX_FRAME];
+  size_t used = CELLULAR_CTL_HEADER_SIZE;
+
+  cellular_ctl_add(frame, &used, CELLULAR_CTL_TLV_ARG, &value, 1);
+  return sim_ctl(message, frame, used, NULL, NULL);
+}
+
+/* Unknown values keep the simulated ones */
+static int ctl_signal_info(CellularSignalInfoStruct *pSignal)
+{
+  uint8_t frame[CELLULAR_CTL_MAX_FRAME];
+  uint8_t response[CELLULAR_CTL_MAX_FRAME];
+  CellularCtlFrame_t parsed;
+  const uint8_t *pValue;
+  int value[CELLULAR_CTL_SIGNAL_SIZE / 2];
+  uint16_t length;
+  unsigned int i;
+
+  if ((sim_ctl(CELLULAR_CTL_GET_SIGNAL, frame, CELLULAR_CTL_HEADER_SIZE, response, &parsed) != 0) ||
+      ((pValue = cellular_ctl_find(&parsed, CELLULAR_CTL_TLV_SIGNAL, &length)) == NULL) || (length != CELLULAR_CTL_SIGNAL_SIZE))
+  {
+    return RETURN_ERROR;
+  }
+  for (i = 0; i < sizeof(value) / sizeof(value[0]); i++)
+  {
+    value[i] = (int16_t)cellular_ctl_get16(&pValue[2 * i]);
+  }
+  pSignal->RSSI = (value[0] != CELLULAR_CTL_SIGNAL_UNKNOWN) ? value[0] : pSignal->RSSI;
+  pSignal->RSRQ = (value[1] != CELLULAR_CTL_SIGNAL_UNKNOWN) ? value[1] : pSignal->RSRQ;
+  pSignal->RSRP = (value[2] != CELLULAR_CTL_SIGNAL_UNKNOWN) ? value[2] : pSignal->RSRP;
+  pSignal->SNR = (value[3] != CELLULAR_CTL_SIGNAL_UNKNOWN) ? value[3] : pSignal->SNR;
+  pSignal->TXPower = (value[4] != CELLULAR_CTL_SIGNAL_UNKNOWN) ? value[4] : pSignal->TXPower;
+  return RETURN_OK;
+}
+
+static int ctl_plmn_information(CellularCurrentPlmnInfoStruct *pPlmn)
+{
+  uint8_t serving[CELLULAR_CTL_SERVING_SIZE];
+
+  if (sim_ctl_serving(serving) != 0)
+  {
+    return RETURN_ERROR;
+  }
+  pPlmn->registration_status = (CellularDeviceNASStatus_t)serving[0];
+  pPlmn->roaming_status = (CellularDeviceNASRoamingStatus_t)serving[1];
+  if (pPlmn->registration_status == DEVICE_NAS_STATUS_REGISTERED)
+  {
+    pPlmn->MCC = cellular_ctl_get16(&serving[2]);
+    pPlmn->MNC = cellular_ctl_get16(&serving[4]);
+    pPlmn->area_code = cellular_ctl_get16(&serving[7]);
+    pPlmn->cell_id = cellular_ctl_get32(&serving[9]);
+  }
+  return RETURN_OK;
+}
+
+static int ctl_operating_configuration(CellularModemOperatingConfiguration_t config)
+{
+  switch (config)
+  {
+    case CELLULAR_MODEM_SET_ONLINE:
+      return ctl_byte(CELLULAR_CTL_SET_OPERATING_MODE, CELLULAR_CTL_MODE_ONLINE);
+    case CELLULAR_MODEM_SET_OFFLINE:
+      return ctl_byte(CELLULAR_CTL_SET_OPERATING_MODE, CELLULAR_CTL_MODE_OFFLINE);
+    case CELLULAR_MODEM_SET_LOW_POWER_MODE:
+      return ctl_byte(CELLULAR_CTL_SET_OPERATING_MODE, CELLULAR_CTL_MODE_LOW_POWER);
+    case CELLULAR_MODEM_SET_RESET:
+      return ctl_byte(CELLULAR_CTL_SET_OPERATING_MODE, CELLULAR_CTL_MODE_RESET);
+    case CELLULAR_MODEM_SET_FACTORY_RESET:
+      return ctl_byte(CELLULAR_CTL_SET_OPERATING_MODE, CELLULAR_CTL_MODE_FACTORY_RESET);
+    default:
+      return 0;
+  }
+}
+
+/* The PDP context of a profile, fields longer than the protocol allows are refused by the modem */
+static int ctl_define_context(const CellularProfileStruct *pProfile)
+{
+  uint8_t frame[CELLULAR_CTL_MAX_FRAME];
+  size_t used = CELLULAR_CTL_HEADER_SIZE;
+  uint8_t cid = (uint8_t)pProfile->PDPContextNumber;
+  uint8_t type, auth;
+
+  type = (pProfile->PDPType == CELLULAR_PDP_TYPE_IPV6) ? 1 :
+         (pProfile->PDPType == CELLULAR_PDP_TYPE_IPV4_OR_IPV6) ? 2 :
+         (pProfile->PDPType == CELLULAR_PDP_TYPE_PPP) ? 3 : 0;
+  auth = (pProfile->PDPAuthentication == CELLULAR_PDP_AUTHENTICATION_PAP) ? 1 :
+         (pProfile->PDPAuthentication == CELLULAR_PDP_AUTHENTICATION_CHAP) ? 2 : 0;
+  if ((pProfile->PDPContextNumber < 1) || (pProfile->PDPContextNumber > UINT8_MAX))
+  {
+    return -1;
+  }
+  cellular_ctl_add(frame, &used, CELLULAR_CTL_TLV_ARG, &cid, 1);
+  cellular_ctl_add(frame, &used, CELLULAR_CTL_TLV_PDP_TYPE, &type, 1);
+  cellular_ctl_add(frame, &used, CELLULAR_CTL_TLV_AUTH, &auth, 1);
+  if ((cellular_ctl_add(frame, &used, CELLULAR_CTL_TLV_APN, pProfile->APN, strnlen(pProfile->APN, sizeof(pProfile->APN))) != 0) ||
+      (cellular_ctl_add(frame, &used, CELLULAR_CTL_TLV_USER, pProfile->Username, strnlen(pProfile->Username, sizeof(pProfile->Username))) != 0) ||
+      (cellular_ctl_add(frame, &used, CELLULAR_CTL_TLV_PASSWORD, pProfile->Password, strnlen(pProfile->Password, sizeof(pProfile->Password))) != 0))
+  {
+    return -1;
+  }
+  return sim_ctl(CELLULAR_CTL_SET_PROFILE, frame, used, NULL, NULL);
+}
+
+/* Comma separated names of a technology mask */
+static void ctl_rat_names(unsigned int mask, char *pOut)
+{
+  static const char *names[] = { "GSM", "UMTS", "LTE", "NR" };
+  unsigned int i;
+
+  pOut[0] = '\0';
+  for (i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+  {
+    if (mask & (1u << i))
+    {
+      strcat(pOut, (pOut[0] != '\0') ? "," : "");
+      strcat(pOut, names[i]);
+    }
+  }
+}
 
 unsigned int cellular_hal_IsModemDevicePresent(void)
 {
-  /*TODO: Implement Me!*/
-  return (unsigned int)0;
+  unsigned int present;
+
+  sim_lock();
+  present = gSim.present;
+  sim_unlock();
+  return present;
 }
 
 int cellular_hal_init(CellularContextInitInputStruct *pstCtxInputStruct)
 {
-  /*TODO: Implement Me!*/
-  (void)pstCtxInputStruct;
-  return (int)0;
+  if (pstCtxInputStruct == NULL)
+  {
+    return RETURN_ERROR;
+  }
+  sim_lock();
+  sim_start_registration(gSim.config.registration_delay_ms);
+  sim_unlock();
+  return RETURN_OK;
 }
 
 int cellular_hal_open_device(CellularDeviceContextCBStruct *pstDeviceCtxCB)
 {
-  /*TODO: Implement Me!*/
-  (void)pstDeviceCtxCB;
-  return (int)0;
+  DeviceOpenEvent_t event;
+  int result = RETURN_ERROR;
+
+  if (pstDeviceCtxCB == NULL)
+  {
+    return RETURN_ERROR;
+  }
+  sim_lock();
+  if (gSim.present)
+  {
+    gSim.device_cb = *pstDeviceCtxCB;
+    event.cb = *pstDeviceCtxCB;
+    event.operating_config = gSim.operating_config;
+    result = (sim_post(gSim.config.open_delay_ms, device_open_event, &event, sizeof(event)) == 0) ? RETURN_OK : RETURN_ERROR;
+  }
+  sim_unlock();
+  return result;
 }
 
 unsigned char cellular_hal_IsModemControlInterfaceOpened(void)
 {
-  /*TODO: Implement Me!*/
-  return (unsigned char)0;
+  unsigned char opened;
+
+  sim_lock();
+  opened = gSim.ctrl_opened;
+  sim_unlock();
+  return opened;
 }
 
 int cellular_hal_select_device_slot(cellular_device_slot_status_api_callback device_slot_status_cb)
 {
-  /*TODO: Implement Me!*/
-  (void)device_slot_status_cb;
-  return (int)0;
+  SlotEvent_t event;
+  unsigned int slot;
+
+  if (device_slot_status_cb == NULL)
+  {
+    return RETURN_ERROR;
+  }
+  sim_lock();
+  slot = usable_slot();
+  event.cb = device_slot_status_cb;
+  event.slot = (slot < gSim.config.slots) ? slot : gSim.active_slot;
+  event.application = gSim.slots[event.slot].info.Application;
+  event.status = DEVICE_SLOT_STATUS_SELECTING;
+  sim_post(0, slot_event, &event, sizeof(event));
+  if (slot == gSim.config.slots)
+  {
+    event.status = DEVICE_SLOT_STATUS_NOT_READY;
+    sim_post(gSim.config.slot_select_delay_ms, slot_event, &event, sizeof(event));
+    sim_unlock();
+    return RETURN_OK;
+  }
+  if (slot != gSim.active_slot)
+  {
+    /* Switching drops the registration of the old card; the new one registers once its slot is ready */
+    sim_set_registration(DEVICE_NAS_STATUS_NOT_REGISTERED);
+    gSim.active_slot = slot;
+    sim_start_registration(gSim.config.slot_select_delay_ms + gSim.config.registration_delay_ms);
+  }
+  event.status = DEVICE_SLOT_STATUS_READY;
+  sim_post(gSim.config.slot_select_delay_ms, slot_event, &event, sizeof(event));
+  sim_unlock();
+  return RETURN_OK;
 }
 
 int cellular_hal_sim_power_enable(unsigned int slot_id, unsigned char enable)
 {
-  /*TODO: Implement Me!*/
-  (void)slot_id;
-  (void)enable;
-  return (int)0;
+  if (enable > 1)
+  {
+    return RETURN_ERROR;
+  }
+  sim_lock();
+  if (slot_id >= gSim.config.slots)
+  {
+    sim_unlock();
+    return RETURN_ERROR;
+  }
+  sim_power_card(slot_id, enable);
+  sim_unlock();
+  return RETURN_OK;
 }
 
 int cellular_hal_get_total_no_of_uicc_slots(unsigned int *total_count)
 {
-  /*TODO: Implement Me!*/
-  (void)total_count;
-  return (int)0;
+  if (total_count == NULL)
+  {
+    return RETURN_ERROR;
+  }
+  sim_lock();
+  *total_count = gSim.config.slots;
+  sim_unlock();
+  return RETURN_OK;
 }
 
 int cellular_hal_get_uicc_slot_info(unsigned int slot_index, CellularUICCSlotInfoStruct *pstSlotInfo)
 {
-  /*TODO: Implement Me!*/
-  (void)slot_index;
-  (void)pstSlotInfo;
-  return (int)0;
+  int result = RETURN_ERROR;
+
+  if (pstSlotInfo == NULL)
+  {
+    return RETURN_ERROR;
+  }
+  sim_lock();
+  if (slot_index < gSim.config.slots)
+  {
+    *pstSlotInfo = gSim.slots[slot_index].info;
+    pstSlotInfo->Status = gSim.slots[slot_index].glitched ? CELLULAR_UICC_STATUS_ERROR : pstSlotInfo->Status;
+    result = RETURN_OK;
+  }
+  sim_unlock();
+  return result;
 }
 
 int cellular_hal_get_active_card_status(CellularUICCStatus_t *card_status)
 {
-  /*TODO: Implement Me!*/
-  (void)card_status;
-  return (int)0;
+  SimSlot_t *pSlot;
+  uint8_t frame[CELLULAR_CTL_MAX_FRAME];
+  uint8_t response[CELLULAR_CTL_MAX_FRAME];
+  CellularCtlFrame_t parsed;
+  const uint8_t *pCard;
+  uint16_t length;
+  char info[32];
+
+  if (card_status == NULL)
+  {
+    return RETURN_ERROR;
+  }
+  sim_lock();
+  pSlot = &gSim.slots[gSim.active_slot];
+  *card_status = (pSlot->info.IsCardPresent && pSlot->info.CardEnable) ? pSlot->info.Status : CELLULAR_UICC_STATUS_EMPTY;
+  *card_status = (pSlot->glitched && (*card_status != CELLULAR_UICC_STATUS_EMPTY)) ? CELLULAR_UICC_STATUS_ERROR : *card_status;
+  sim_unlock();
+  if (sim_ctl_active() && (*card_status != CELLULAR_UICC_STATUS_EMPTY))
+  {
+    if ((sim_ctl(CELLULAR_CTL_GET_CARD_STATUS, frame, CELLULAR_CTL_HEADER_SIZE, response, &parsed) != 0) ||
+        ((pCard = cellular_ctl_find(&parsed, CELLULAR_CTL_TLV_CARD, &length)) == NULL) || (length != 1) ||
+        (pCard[0] == CELLULAR_CTL_CARD_ABSENT))
+    {
+      *card_status = CELLULAR_UICC_STATUS_EMPTY;
+    }
+    else if (pCard[0] != CELLULAR_CTL_CARD_READY)
+    {
+      *card_status = (pCard[0] == CELLULAR_CTL_CARD_BLOCKED) ? CELLULAR_UICC_STATUS_BLOCKED : CELLULAR_UICC_STATUS_ERROR;
+    }
+  }
+  else if (sim_at_active() && (*card_status != CELLULAR_UICC_STATUS_EMPTY))
+  {
+    if (sim_at("+CPIN:", info, sizeof(info), "+CPIN?") != 0)
+    {
+      *card_status = CELLULAR_UICC_STATUS_EMPTY;
+    }
+    else if (strcmp(info, "READY") != 0)
+    {
+      *card_status = CELLULAR_UICC_STATUS_BLOCKED;
+    }
+  }
+  return RETURN_OK;
 }
 
 int cellular_hal_monitor_device_registration(cellular_device_registration_status_callback device_registration_status_cb)
 {
-  /*TODO: Implement Me!*/
-  (void)device_registration_status_cb;
-  return (int)0;
+  if (device_registration_status_cb == NULL)
+  {
+    return RETURN_ERROR;
+  }
+  sim_lock();
+  gSim.registration_cb = device_registration_status_cb;
+  sim_unlock();
+  return RETURN_OK;
 }
 
 int cellular_hal_profile_create(CellularProfileStruct *pstProfileInput, cellular_device_profile_status_api_callback device_profile_status_cb)
 {
-  /*TODO: Implement Me!*/
-  (void)pstProfileInput;
-  (void)device_profile_status_cb;
-  return (int)0;
+  int result = RETURN_ERROR;
+
+  if (!profile_valid(pstProfileInput))
+  {
+    return RETURN_ERROR;
+  }
+  if (sim_ctl_active() && ((profile_index(pstProfileInput->ProfileID, NULL) >= 0) || (ctl_define_context(pstProfileInput) != 0)))
+  {
+    return RETURN_ERROR;
+  }
+  if (!sim_ctl_active() && sim_at_active() &&
+      ((profile_index(pstProfileInput->ProfileID, NULL) >= 0) || (at_define_context(pstProfileInput) != 0)))
+  {
+    return RETURN_ERROR;
+  }
+  sim_lock();
+  if ((find_profile(pstProfileInput->ProfileID) < 0) && (gSim.profile_count < CELLULAR_SIM_MAX_PROFILES))
+  {
+    gSim.profiles[gSim.profile_count++] = *pstProfileInput;
+    post_profile_status(device_profile_status_cb, pstProfileInput, DEVICE_PROFILE_STATUS_READY);
+    result = RETURN_OK;
+  }
+  sim_unlock();
+  return result;
 }
 
 int cellular_hal_profile_delete(CellularProfileStruct *pstProfileInput, cellular_device_profile_status_api_callback device_profile_status_cb)
 {
-  /*TODO: Implement Me!*/
-  (void)pstProfileInput;
-  (void)device_profile_status_cb;
-  return (int)0;
+  int index;
+  int context = 0;
+  int result = RETURN_ERROR;
+
+  if (pstProfileInput == NULL)
+  {
+    return RETURN_ERROR;
+  }
+  if (sim_ctl_active() &&
+      ((profile_index(pstProfileInput->ProfileID, &context) < 0) || (context < 1) || (context > UINT8_MAX) ||
+       (ctl_byte(CELLULAR_CTL_DELETE_PROFILE, (uint8_t)context) != 0)))
+  {
+    return RETURN_ERROR;
+  }
+  if (!sim_ctl_active() && sim_at_active() &&
+      ((profile_index(pstProfileInput->ProfileID, &context) < 0) || (sim_at(NULL, NULL, 0, "+CGDCONT=%d", context) != 0)))
+  {
+    return RETURN_ERROR;
+  }
+  sim_lock();
+  index = find_profile(pstProfileInput->ProfileID);
+  if (index >= 0)
+  {
+    post_profile_status(device_profile_status_cb, &gSim.profiles[index], DEVICE_PROFILE_STATUS_DELETED);
+    gSim.profiles[index] = gSim.profiles[--gSim.profile_count];
+    result = RETURN_OK;
+  }
+  sim_unlock();
+  return result;
 }
 
 int cellular_hal_profile_modify(CellularProfileStruct *pstProfileInput, cellular_device_profile_status_api_callback device_profile_status_cb)
 {
-  /*TODO: Implement Me!*/
-  (void)pstProfileInput;
-  (void)device_profile_status_cb;
-  return (int)0;
+  int index;
+  int result = RETURN_ERROR;
+
+  if (!profile_valid(pstProfileInput))
+  {
+    return RETURN_ERROR;
+  }
+  if (sim_ctl_active() && ((profile_index(pstProfileInput->ProfileID, NULL) < 0) || (ctl_define_context(pstProfileInput) != 0)))
+  {
+    return RETURN_ERROR;
+  }
+  if (!sim_ctl_active() && sim_at_active() &&
+      ((profile_index(pstProfileInput->ProfileID, NULL) < 0) || (at_define_context(pstProfileInput) != 0)))
+  {
+    return RETURN_ERROR;
+  }
+  sim_lock();
+  index = find_profile(pstProfileInput->ProfileID);
+  if (index >= 0)
+  {
+    gSim.profiles[index] = *pstProfileInput;
+    post_profile_status(device_profile_status_cb, pstProfileInput, DEVICE_PROFILE_STATUS_READY);
+    result = RETURN_OK;
+  }
+  sim_unlock();
+  return result;
 }
 
 int cellular_hal_get_profile_list(CellularProfileStruct **ppstProfileOutput, int *profile_count)
 {
-  /*TODO: Implement Me!*/
-  (void)ppstProfileOutput;
-  (void)profile_count;
-  return (int)0;
+  CellularProfileStruct *pList;
+
+  if ((ppstProfileOutput == NULL) || (profile_count == NULL))
+  {
+    return RETURN_ERROR;
+  }
+  sim_lock();
+  pList = (CellularProfileStruct *)malloc((gSim.profile_count + 1) * sizeof(CellularProfileStruct));
+  if (pList == NULL)
+  {
+    sim_unlock();
+    return RETURN_ERROR;
+  }
+  memcpy(pList, gSim.profiles, gSim.profile_count * sizeof(CellularProfileStruct));
+  *ppstProfileOutput = pList;
+  *profile_count = (int)gSim.profile_count;
+  sim_unlock();
+  return RETURN_OK;
 }
 
 int cellular_hal_start_network(CellularNetworkIPType_t ip_request_type, CellularProfileStruct *pstProfileInput, CellularNetworkCBStruct *pstCBStruct)
 {
-  /*TODO: Implement Me!*/
-  (void)ip_request_type;
-  (void)pstProfileInput;
-  (void)pstCBStruct;
-  return (int)0;
+  int context;
+
+  if ((ip_request_type > CELLULAR_NETWORK_IP_FAMILY_IPV4_IPV6) || (pstCBStruct == NULL) ||
+      ((pstProfileInput != NULL) && !profile_valid(pstProfileInput)))
+  {
+    return RETURN_ERROR;
+  }
+  if (sim_ctl_active() || sim_at_active())
+  {
+    sim_lock();
+    context = (pstProfileInput != NULL) ? pstProfileInput->PDPContextNumber : gSim.profiles[0].PDPContextNumber;
+    sim_unlock();
+    if (sim_ctl_active() ? ((context < 1) || (context > UINT8_MAX) || (ctl_byte(CELLULAR_CTL_START_NETWORK, (uint8_t)context) != 0)) :
+        (sim_at(NULL, NULL, 0, "+CGACT=1,%d", context) != 0))
+    {
+      return RETURN_ERROR;
+    }
+  }
+  sim_lock();
+  if (!gSim.present)
+  {
+    sim_unlock();
+    return RETURN_ERROR;
+  }
+  if (pstProfileInput != NULL)
+  {
+    gSim.session_profile = *pstProfileInput;
+  }
+  else
+  {
+    gSim.session_profile = gSim.profiles[0];
+  }
+  if (ip_request_type == CELLULAR_NETWORK_IP_FAMILY_UNKNOWN)
+  {
+    /* Take the family from the PDP type, PPP carries IPv4 */
+    switch (gSim.session_profile.PDPType)
+    {
+      case CELLULAR_PDP_TYPE_IPV6:
+        ip_request_type = CELLULAR_NETWORK_IP_FAMILY_IPV6;
+        break;
+      case CELLULAR_PDP_TYPE_IPV4_OR_IPV6:
+        ip_request_type = CELLULAR_NETWORK_IP_FAMILY_IPV4_IPV6;
+        break;
+      default:
+        ip_request_type = CELLULAR_NETWORK_IP_FAMILY_IPV4;
+        break;
+    }
+  }
+  gSim.ip_type = ip_request_type;
+  gSim.network_cb = *pstCBStruct;
+  gSim.session_requested = 1;
+  sim_session_connect();
+  sim_unlock();
+  return RETURN_OK;
 }
 
 int cellular_hal_stop_network(CellularNetworkIPType_t ip_request_type)
 {
-  /*TODO: Implement Me!*/
-  (void)ip_request_type;
-  return (int)0;
+  uint8_t frame[CELLULAR_CTL_MAX_FRAME];
+
+  if (ip_request_type > CELLULAR_NETWORK_IP_FAMILY_IPV4_IPV6)
+  {
+    return RETURN_ERROR;
+  }
+  if (sim_ctl_active() ? (sim_ctl(CELLULAR_CTL_STOP_NETWORK, frame, CELLULAR_CTL_HEADER_SIZE, NULL, NULL) != 0) :
+      (sim_at_active() && (sim_at(NULL, NULL, 0, "+CGACT=0") != 0)))
+  {
+    return RETURN_ERROR;
+  }
+  sim_lock();
+  gSim.session_requested = 0;
+  sim_session_down();
+  sim_unlock();
+  return RETURN_OK;
 }
 
 int cellular_hal_get_signal_info(CellularSignalInfoStruct *signal_info)
 {
-  /*TODO: Implement Me!*/
-  (void)signal_info;
-  return (int)0;
+  if (signal_info == NULL)
+  {
+    return RETURN_ERROR;
+  }
+  sim_lock();
+  *signal_info = gSim.signal;
+  sim_unlock();
+  if (sim_ctl_active())
+  {
+    return ctl_signal_info(signal_info);
+  }
+  return sim_at_active() ? at_signal_info(signal_info) : RETURN_OK;
 }
 
 int cellular_hal_set_modem_operating_configuration(CellularModemOperatingConfiguration_t modem_operating_config)
 {
-  /*TODO: Implement Me!*/
-  (void)modem_operating_config;
-  return (int)0;
+  int result = RETURN_OK;
+
+  if (sim_ctl_active() ? (ctl_operating_configuration(modem_operating_config) != 0) :
+      (sim_at_active() && (at_operating_configuration(modem_operating_config) != 0)))
+  {
+    return RETURN_ERROR;
+  }
+  sim_lock();
+  switch (modem_operating_config)
+  {
+    case CELLULAR_MODEM_SET_ONLINE:
+      gSim.operating_config = modem_operating_config;
+      sim_start_registration(gSim.config.registration_delay_ms);
+      break;
+    case CELLULAR_MODEM_SET_OFFLINE:
+    case CELLULAR_MODEM_SET_LOW_POWER_MODE:
+      gSim.operating_config = modem_operating_config;
+      sim_set_registration(DEVICE_NAS_STATUS_NOT_REGISTERED);
+      break;
+    case CELLULAR_MODEM_SET_RESET:
+      sim_restart(0);
+      break;
+    case CELLULAR_MODEM_SET_FACTORY_RESET:
+      sim_restart(1);
+      break;
+    default:
+      result = RETURN_ERROR;
+      break;
+  }
+  sim_unlock();
+  return result;
 }
 
 int cellular_hal_get_device_imei(char *imei)
 {
-  /*TODO: Implement Me!*/
-  (void)imei;
-  return (int)0;
+  if (imei == NULL)
+  {
+    return RETURN_ERROR;
+  }
+  if (sim_ctl_active())
+  {
+    return ctl_identity(CELLULAR_CTL_TLV_IMEI, imei, sizeof(SIM_IMEI));
+  }
+  if (sim_at_active())
+  {
+    return at_string("+CGSN", "", 0, imei, sizeof(SIM_IMEI));
+  }
+  strcpy(imei, SIM_IMEI);
+  return RETURN_OK;
 }
 
 int cellular_hal_get_device_imei_sv(char *imei_sv)
 {
-  /*TODO: Implement Me!*/
-  (void)imei_sv;
-  return (int)0;
+  if (imei_sv == NULL)
+  {
+    return RETURN_ERROR;
+  }
+  if (sim_ctl_active())
+  {
+    return ctl_identity(CELLULAR_CTL_TLV_IMEI_SV, imei_sv, sizeof(SIM_IMEI_SV));
+  }
+  if (sim_at_active())
+  {
+    return at_string("+CGSN=2", "+CGSN:", 0, imei_sv, sizeof(SIM_IMEI_SV));
+  }
+  strcpy(imei_sv, SIM_IMEI_SV);
+  return RETURN_OK;
 }
 
 int cellular_hal_get_modem_current_iccid(char *iccid)
 {
-  /*TODO: Implement Me!*/
-  (void)iccid;
-  return (int)0;
+  if (iccid == NULL)
+  {
+    return RETURN_ERROR;
+  }
+  if (sim_ctl_active())
+  {
+    return ctl_identity(CELLULAR_CTL_TLV_ICCID, iccid, sizeof(gSim.slots[0].info.iccid));
+  }
+  if (sim_at_active())
+  {
+    return at_string("+CCID", "+CCID:", 0, iccid, sizeof(gSim.slots[0].info.iccid));
+  }
+  sim_lock();
+  strcpy(iccid, gSim.slots[gSim.active_slot].info.iccid);
+  sim_unlock();
+  return RETURN_OK;
 }
 
 int cellular_hal_get_modem_current_msisdn(char *msisdn)
 {
-  /*TODO: Implement Me!*/
-  (void)msisdn;
-  return (int)0;
+  if (msisdn == NULL)
+  {
+    return RETURN_ERROR;
+  }
+  if (sim_ctl_active())
+  {
+    return ctl_identity(CELLULAR_CTL_TLV_MSISDN, msisdn, sizeof(gSim.slots[0].info.msisdn));
+  }
+  if (sim_at_active())
+  {
+    return at_string("+CNUM", "+CNUM:", 1, msisdn, sizeof(gSim.slots[0].info.msisdn));
+  }
+  sim_lock();
+  strcpy(msisdn, gSim.slots[gSim.active_slot].info.msisdn);
+  sim_unlock();
+  return RETURN_OK;
 }
 
 int cellular_hal_get_packet_statistics(CellularPacketStatsStruct *network_packet_stats)
 {
-  /*TODO: Implement Me!*/
-  (void)network_packet_stats;
-  return (int)0;
+  if (network_packet_stats == NULL)
+  {
+    return RETURN_ERROR;
+  }
+  memset(network_packet_stats, 0, sizeof(*network_packet_stats));
+  sim_lock();
+  if (gSim.if_status == IF_UP)
+  {
+    network_packet_stats->UpStreamMaxBitRate = 50000000;
+    network_packet_stats->DownStreamMaxBitRate = 150000000;
+  }
+  sim_unlock();
+  /* Counters exist once the session has an interface to count on */
+  sim_data_stats(network_packet_stats);
+  return RETURN_OK;
 }
 
 int cellular_hal_get_current_modem_interface_status(CellularInterfaceStatus_t *status)
 {
-  /*TODO: Implement Me!*/
-  (void)status;
-  return (int)0;
+  if (status == NULL)
+  {
+    return RETURN_ERROR;
+  }
+  sim_lock();
+  *status = gSim.present ? gSim.if_status : IF_NOTPRESENT;
+  sim_unlock();
+  return RETURN_OK;
 }
 
 int cellular_hal_set_modem_network_attach(void)
 {
-  /*TODO: Implement Me!*/
-  return (int)0;
+  int result;
+
+  if (sim_ctl_active() ? (ctl_byte(CELLULAR_CTL_ATTACH, 1) != 0) : (sim_at_active() && (sim_at(NULL, NULL, 0, "+CGATT=1") != 0)))
+  {
+    return RETURN_ERROR;
+  }
+  sim_lock();
+  result = gSim.present ? RETURN_OK : RETURN_ERROR;
+  sim_start_registration(gSim.config.registration_delay_ms);
+  sim_unlock();
+  return result;
 }
 
 int cellular_hal_set_modem_network_detach(void)
 {
-  /*TODO: Implement Me!*/
-  return (int)0;
+  int result;
+
+  if (sim_ctl_active() ? (ctl_byte(CELLULAR_CTL_ATTACH, 0) != 0) : (sim_at_active() && (sim_at(NULL, NULL, 0, "+CGATT=0") != 0)))
+  {
+    return RETURN_ERROR;
+  }
+  sim_lock();
+  result = gSim.present ? RETURN_OK : RETURN_ERROR;
+  sim_set_registration(DEVICE_NAS_STATUS_NOT_REGISTERED);
+  sim_unlock();
+  return result;
 }
 
 int cellular_hal_get_modem_firmware_version(char *firmware_version)
 {
-  /*TODO: Implement Me!*/
-  (void)firmware_version;
-  return (int)0;
+  if (firmware_version == NULL)
+  {
+    return RETURN_ERROR;
+  }
+  if (sim_ctl_active())
+  {
+    return ctl_identity(CELLULAR_CTL_TLV_FIRMWARE, firmware_version, SIM_FIRMWARE_LENGTH);
+  }
+  if (sim_at_active())
+  {
+    return at_string("+CGMR", "", 0, firmware_version, SIM_FIRMWARE_LENGTH);
+  }
+  strcpy(firmware_version, SIM_FIRMWARE);
+  return RETURN_OK;
 }
 
 int cellular_hal_get_current_plmn_information(CellularCurrentPlmnInfoStruct *plmn_info)
 {
-  /*TODO: Implement Me!*/
-  (void)plmn_info;
-  return (int)0;
+  if (plmn_info == NULL)
+  {
+    return RETURN_ERROR;
+  }
+  sim_lock();
+  *plmn_info = gSim.plmn;
+  sim_unlock();
+  if (sim_ctl_active())
+  {
+    return ctl_plmn_information(plmn_info);
+  }
+  return sim_at_active() ? at_plmn_information(plmn_info) : RETURN_OK;
 }
 
 int cellular_hal_get_available_networks_information(CellularNetworkScanResultInfoStruct **network_info, unsigned int *total_network_count)
 {
-  /*TODO: Implement Me!*/
-  (void)network_info;
-  (void)total_network_count;
-  return (int)0;
+  if ((network_info == NULL) || (total_network_count == NULL))
+  {
+    return RETURN_ERROR;
+  }
+  *network_info = (CellularNetworkScanResultInfoStruct *)malloc(sizeof(gScanResults));
+  if (*network_info == NULL)
+  {
+    return RETURN_ERROR;
+  }
+  memcpy(*network_info, gScanResults, sizeof(gScanResults));
+  *total_network_count = sizeof(gScanResults) / sizeof(gScanResults[0]);
+  return RETURN_OK;
 }
 
 int cellular_hal_get_modem_preferred_radio_technology(char *preferred_rat)
 {
-  /*TODO: Implement Me!*/
-  (void)preferred_rat;
-  return (int)0;
+  uint8_t frame[CELLULAR_CTL_MAX_FRAME];
+  uint8_t response[CELLULAR_CTL_MAX_FRAME];
+  CellularCtlFrame_t parsed;
+  const uint8_t *pRats;
+  uint16_t length;
+  char info[32];
+  unsigned int i;
+  int ws46;
+
+  if (preferred_rat == NULL)
+  {
+    return RETURN_ERROR;
+  }
+  sim_lock();
+  strcpy(preferred_rat, gSim.preferred_rat);
+  sim_unlock();
+  if (sim_ctl_active())
+  {
+    if ((sim_ctl(CELLULAR_CTL_GET_RAT_PREFERENCE, frame, CELLULAR_CTL_HEADER_SIZE, response, &parsed) != 0) ||
+        ((pRats = cellular_ctl_find(&parsed, CELLULAR_CTL_TLV_RAT, &length)) == NULL) || (length != 1))
+    {
+      return RETURN_ERROR;
+    }
+    /* As with +WS46, the list last set is kept while the modem still has its technologies */
+    if (pRats[0] != rat_mask(preferred_rat))
+    {
+      ctl_rat_names(pRats[0], preferred_rat);
+    }
+    return RETURN_OK;
+  }
+  if (!sim_at_active())
+  {
+    return RETURN_OK;
+  }
+  if ((sim_at("+WS46:", info, sizeof(info), "+WS46?") != 0) || (at_field_int(info, 0, &ws46) != 0))
+  {
+    return RETURN_ERROR;
+  }
+  /* The list last set is kept when the modem still selects its technologies, "GSM,UMTS,LTE" is not read back as AUTO */
+  for (i = 0; i < sizeof(gWs46) / sizeof(gWs46[0]); i++)
+  {
+    if ((gWs46[i].ws46 == ws46) && (gWs46[i].rats != rat_mask(preferred_rat)))
+    {
+      strcpy(preferred_rat, gWs46[i].pName);
+    }
+  }
+  return RETURN_OK;
 }
 
 int cellular_hal_set_modem_preferred_radio_technology(char *preferred_rat)
 {
-  /*TODO: Implement Me!*/
-  (void)preferred_rat;
-  return (int)0;
+  unsigned int i, mask;
+
+  if (!rat_valid(preferred_rat))
+  {
+    return RETURN_ERROR;
+  }
+  if (sim_ctl_active())
+  {
+    mask = rat_mask(preferred_rat);
+    if ((mask == 0) || (ctl_byte(CELLULAR_CTL_SET_RAT_PREFERENCE, (uint8_t)mask) != 0))
+    {
+      return RETURN_ERROR;
+    }
+  }
+  else if (sim_at_active())
+  {
+    mask = rat_mask(preferred_rat);
+    for (i = 0; (i < sizeof(gWs46) / sizeof(gWs46[0])) && (gWs46[i].rats != mask); i++)
+    {
+    }
+    if ((i == sizeof(gWs46) / sizeof(gWs46[0])) || (sim_at(NULL, NULL, 0, "+WS46=%d", gWs46[i].ws46) != 0))
+    {
+      return RETURN_ERROR;
+    }
+  }
+  sim_lock();
+  snprintf(gSim.preferred_rat, sizeof(gSim.preferred_rat), "%s", preferred_rat);
+  sim_switch_rat();
+  sim_unlock();
+  return RETURN_OK;
 }
 
 int cellular_hal_get_modem_current_radio_technology(char *current_rat)
 {
-  /*TODO: Implement Me!*/
-  (void)current_rat;
-  return (int)0;
+  uint8_t serving[CELLULAR_CTL_SERVING_SIZE];
+  char info[64];
+  int act;
+
+  if (current_rat == NULL)
+  {
+    return RETURN_ERROR;
+  }
+  sim_lock();
+  strcpy(current_rat, gSim.current_rat);
+  sim_unlock();
+  if (sim_ctl_active())
+  {
+    if (sim_ctl_serving(serving) != 0)
+    {
+      return RETURN_ERROR;
+    }
+    if (serving[6] != 0)
+    {
+      ctl_rat_names(serving[6], current_rat);
+    }
+    return RETURN_OK;
+  }
+  if (!sim_at_active())
+  {
+    return RETURN_OK;
+  }
+  if (sim_at("+COPS:", info, sizeof(info), "+COPS?") != 0)
+  {
+    return RETURN_ERROR;
+  }
+  /* <AcT> of 27.007: 0 GSM, 2 to 6 UMTS and HSPA, 7 LTE, 11 to 13 NR */
+  if (at_field_int(info, 3, &act) == 0)
+  {
+    strcpy(current_rat, (act == 0) ? "GSM" : (act <= 6) ? "UMTS" : (act <= 10) ? "LTE" : "NR");
+  }
+  return RETURN_OK;
 }
 
 int cellular_hal_get_modem_supported_radio_technology(char *supported_rat)
 {
-  /*TODO: Implement Me!*/
-  (void)supported_rat;
-  return (int)0;
+  if (supported_rat == NULL)
+  {
+    return RETURN_ERROR;
+  }
+  strcpy(supported_rat, SIM_SUPPORTED_RAT);
+  return RETURN_OK;
 }
 
 int cellular_hal_modem_factory_reset(void)
 {
-  /*TODO: Implement Me!*/
-  return (int)0;
+  return cellular_hal_set_modem_operating_configuration(CELLULAR_MODEM_SET_FACTORY_RESET);
 }
 
 int cellular_hal_modem_reset(void)
 {
-  /*TODO: Implement Me!*/
-  return (int)0;
+  return cellular_hal_set_modem_operating_configuration(CELLULAR_MODEM_SET_RESET);
 }
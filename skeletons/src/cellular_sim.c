@@ -0,0 +1,747 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:*
+ * Copyright 2023 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Simulated modem core: state, power-on defaults and the event thread which delivers
+ * HAL callbacks after the configured delays. Events posted before a reset are dropped.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/prctl.h>
+#include "cellular_sim_private.h"
+
+typedef struct SimEvent_s
+{
+  struct SimEvent_s *pNext;
+  uint64_t due_ns;
+  uint32_t generation;
+  SimEventFn_t pFn;
+  unsigned char payload[];
+} SimEvent_t;
+
+typedef struct
+{
+  cellular_device_registration_status_callback cb;
+  CellularDeviceNASStatus_t status;
+  CellularDeviceNASRoamingStatus_t roaming;
+  CellularModemRegisteredServiceType_t service;
+} RegistrationEvent_t;
+
+typedef struct
+{
+  CellularNetworkCBStruct cb;
+  CellularNetworkIPType_t ip_type;
+  CellularIPStruct ip;
+  CellularDeviceIPReadyStatus_t ip_status;
+  CellularNetworkPacketStatus_t packet_status;
+} SessionEvent_t;
+
+typedef struct
+{
+  cellular_device_status_cb cb;
+  CellularDeviceDetectionStatus_t status;
+} DetectionEvent_t;
+
+typedef struct
+{
+  uint32_t attempt;
+  char rat[SIM_RAT_LENGTH];
+} RatSwitchEvent_t;
+
+typedef struct
+{
+  unsigned int slot;
+  uint32_t attempt;
+} PowerEvent_t;
+
+SimState_t gSim;
+
+static pthread_once_t gOnce = PTHREAD_ONCE_INIT;
+static pthread_cond_t gEventCond;
+static pthread_t gEventThread;
+static unsigned char gEventThreadStarted;
+static SimEvent_t *pEvents;
+
+static uint64_t now_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ((uint64_t)ts.tv_sec * 1000000000ull) + (uint64_t)ts.tv_nsec;
+}
+
+static void init_sync(void)
+{
+  pthread_condattr_t attr;
+
+  pthread_mutex_init(&gSim.lock, NULL);
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&gEventCond, &attr);
+  pthread_condattr_destroy(&attr);
+}
+
+static void free_events(void)
+{
+  SimEvent_t *pEvent;
+
+  while (pEvents != NULL)
+  {
+    pEvent = pEvents;
+    pEvents = pEvent->pNext;
+    free(pEvent);
+  }
+}
+
+static void default_profile(CellularProfileStruct *pProfile)
+{
+  memset(pProfile, 0, sizeof(*pProfile));
+  pProfile->ProfileID = 1;
+  pProfile->ProfileType = CELLULAR_PROFILE_TYPE_3GPP;
+  pProfile->PDPContextNumber = 1;
+  pProfile->PDPType = CELLULAR_PDP_TYPE_IPV4_OR_IPV6;
+  pProfile->PDPAuthentication = CELLULAR_PDP_AUTHENTICATION_NONE;
+  pProfile->PDPNetworkConfig = CELLULAR_PDP_NETWORK_CONFIG_NAS;
+  strncpy(pProfile->ProfileName, "Default", sizeof(pProfile->ProfileName) - 1);
+  strncpy(pProfile->APN, "internet", sizeof(pProfile->APN) - 1);
+  strncpy(pProfile->Username, "user", sizeof(pProfile->Username) - 1);
+  strncpy(pProfile->Password, "password", sizeof(pProfile->Password) - 1);
+  strncpy(pProfile->Proxy, "192.168.0.1", sizeof(pProfile->Proxy) - 1);
+  pProfile->ProxyPort = 8080;
+  pProfile->bIsThisDefaultProfile = 1;
+}
+
+/* Power-on state; lock must be held */
+static void reset_state(void)
+{
+  unsigned int i;
+
+  gSim.generation++;
+  free_events();
+
+  gSim.present = 1;
+  gSim.ctrl_opened = 0;
+  gSim.operating_config = CELLULAR_MODEM_SET_ONLINE;
+  memset(&gSim.device_cb, 0, sizeof(gSim.device_cb));
+
+  gSim.active_slot = 0;
+  memset(gSim.slots, 0, sizeof(gSim.slots));
+  for (i = 0; i < gSim.config.slots; i++)
+  {
+    gSim.slots[i].powered = (i == 0);
+    gSim.slots[i].info.SlotEnable = TRUE;
+    gSim.slots[i].info.IsCardPresent = TRUE;
+    gSim.slots[i].info.CardEnable = gSim.slots[i].powered;
+    gSim.slots[i].info.FormFactor = CELLULAR_UICC_FORM_FACTOR_4FF;
+    gSim.slots[i].info.Application = (i >= gSim.config.slots - gSim.config.esim_slots) ? CELLULAR_UICC_APPLICATION_ESIM : CELLULAR_UICC_APPLICATION_USIM;
+    gSim.slots[i].info.Status = CELLULAR_UICC_STATUS_VALID;
+    if (i == 0)
+    {
+      snprintf(gSim.slots[i].info.MnoName, sizeof(gSim.slots[i].info.MnoName), "Sim Operator");
+    }
+    else
+    {
+      snprintf(gSim.slots[i].info.MnoName, sizeof(gSim.slots[i].info.MnoName), "Sim Operator %u", i + 1);
+    }
+    snprintf(gSim.slots[i].info.iccid, sizeof(gSim.slots[i].info.iccid), "89012600000000000%02u", i);
+    snprintf(gSim.slots[i].info.msisdn, sizeof(gSim.slots[i].info.msisdn), "1555010%04u", i);
+  }
+
+  gSim.registration = DEVICE_NAS_STATUS_REGISTERED;
+  gSim.registration_cb = NULL;
+  memset(&gSim.plmn, 0, sizeof(gSim.plmn));
+  snprintf(gSim.plmn.plmn_name, sizeof(gSim.plmn.plmn_name), "Sim Operator");
+  gSim.plmn.MCC = 310;
+  gSim.plmn.MNC = 260;
+  gSim.plmn.registration_status = DEVICE_NAS_STATUS_REGISTERED;
+  gSim.plmn.registered_service = CELLULAR_MODEM_REGISTERED_SERVICE_PS;
+  gSim.plmn.roaming_status = DEVICE_NAS_STATUS_ROAMING_OFF;
+  gSim.plmn.roaming_enabled = TRUE;
+  gSim.plmn.area_code = 0x2A1F;
+  gSim.plmn.cell_id = 0x1A2B3C;
+
+  default_profile(&gSim.profiles[0]);
+  gSim.profile_count = 1;
+
+  sim_data_down();
+  gSim.if_status = IF_DOWN;
+  gSim.session_requested = 0;
+  gSim.ip_type = CELLULAR_NETWORK_IP_FAMILY_UNKNOWN;
+  memset(&gSim.session_profile, 0, sizeof(gSim.session_profile));
+  memset(&gSim.network_cb, 0, sizeof(gSim.network_cb));
+
+  snprintf(gSim.preferred_rat, sizeof(gSim.preferred_rat), "AUTO");
+  snprintf(gSim.current_rat, sizeof(gSim.current_rat), "LTE");
+  gSim.rat_switching = 0;
+  gSim.signal.RSSI = -65;
+  gSim.signal.RSRQ = -10;
+  gSim.signal.RSRP = -95;
+  gSim.signal.SNR = 15;
+  gSim.signal.TXPower = 10;
+  sim_channel_restart();
+}
+
+/* A forked child gets a copy of the modem but not the event thread, it is restarted on the next post */
+static void atfork_prepare(void)
+{
+  pthread_mutex_lock(&gSim.lock);
+}
+
+static void atfork_parent(void)
+{
+  pthread_mutex_unlock(&gSim.lock);
+}
+
+static void atfork_child(void)
+{
+  init_sync();
+  gEventThreadStarted = 0;
+}
+
+static void sim_once(void)
+{
+  init_sync();
+  cellular_sim_default_config(&gSim.config);
+  reset_state();
+  pthread_atfork(atfork_prepare, atfork_parent, atfork_child);
+}
+
+void sim_hold_abandon(void)
+{
+  if (cellular_trace_hold_abandon != NULL)
+  {
+    cellular_trace_hold_abandon();
+  }
+}
+
+void sim_release_abandon(void)
+{
+  if (cellular_trace_release_abandon != NULL)
+  {
+    cellular_trace_release_abandon();
+  }
+}
+
+void sim_lock(void)
+{
+  pthread_once(&gOnce, sim_once);
+  sim_hold_abandon();
+  pthread_mutex_lock(&gSim.lock);
+}
+
+void sim_unlock(void)
+{
+  pthread_mutex_unlock(&gSim.lock);
+  sim_release_abandon();
+}
+
+static void *event_thread(void *pArg)
+{
+  SimEvent_t *pEvent;
+  struct timespec due;
+  uint64_t now;
+
+  (void)pArg;
+  prctl(PR_SET_NAME, "hal_sim_events", 0, 0, 0);
+  pthread_mutex_lock(&gSim.lock);
+  for (;;)
+  {
+    if (pEvents == NULL)
+    {
+      pthread_cond_wait(&gEventCond, &gSim.lock);
+      continue;
+    }
+    now = now_ns();
+    if (pEvents->due_ns > now)
+    {
+      due.tv_sec = (time_t)(pEvents->due_ns / 1000000000ull);
+      due.tv_nsec = (long)(pEvents->due_ns % 1000000000ull);
+      pthread_cond_timedwait(&gEventCond, &gSim.lock, &due);
+      continue;
+    }
+    pEvent = pEvents;
+    pEvents = pEvent->pNext;
+    if (pEvent->generation == gSim.generation)
+    {
+      /* Handlers take the lock themselves and call HAL callbacks without it */
+      pthread_mutex_unlock(&gSim.lock);
+      pEvent->pFn(pEvent->payload);
+      pthread_mutex_lock(&gSim.lock);
+    }
+    free(pEvent);
+  }
+  return NULL;
+}
+
+int sim_post(uint32_t delay_ms, SimEventFn_t pFn, const void *pPayload, size_t size)
+{
+  SimEvent_t *pEvent = (SimEvent_t *)malloc(sizeof(SimEvent_t) + size);
+  SimEvent_t **ppPos = &pEvents;
+
+  if (pEvent == NULL)
+  {
+    return -1;
+  }
+  if (!gEventThreadStarted)
+  {
+    if (pthread_create(&gEventThread, NULL, event_thread, NULL) != 0)
+    {
+      free(pEvent);
+      return -1;
+    }
+    pthread_detach(gEventThread);
+    gEventThreadStarted = 1;
+  }
+  pEvent->due_ns = now_ns() + ((uint64_t)delay_ms * 1000000ull);
+  pEvent->generation = gSim.generation;
+  pEvent->pFn = pFn;
+  if (size > 0)
+  {
+    memcpy(pEvent->payload, pPayload, size);
+  }
+  /* Keep the queue ordered by due time, events due together run in posting order */
+  while ((*ppPos != NULL) && ((*ppPos)->due_ns <= pEvent->due_ns))
+  {
+    ppPos = &(*ppPos)->pNext;
+  }
+  pEvent->pNext = *ppPos;
+  *ppPos = pEvent;
+  pthread_cond_signal(&gEventCond);
+  return 0;
+}
+
+static void registration_event(void *pPayload)
+{
+  RegistrationEvent_t *pEvent = (RegistrationEvent_t *)pPayload;
+
+  pEvent->cb(pEvent->status, pEvent->roaming, pEvent->service);
+}
+
+static void session_event(void *pPayload)
+{
+  SessionEvent_t *pEvent = (SessionEvent_t *)pPayload;
+  char deviceName[] = SIM_DEVICE_NAME;
+
+  if ((pEvent->cb.device_network_ip_ready_cb != NULL) && (pEvent->ip_type != CELLULAR_NETWORK_IP_FAMILY_UNKNOWN))
+  {
+    pEvent->cb.device_network_ip_ready_cb(&pEvent->ip, pEvent->ip_status);
+  }
+  if (pEvent->cb.packet_service_status_cb != NULL)
+  {
+    pEvent->cb.packet_service_status_cb(deviceName, pEvent->ip_type, pEvent->packet_status);
+  }
+}
+
+static void detection_event(void *pPayload)
+{
+  DetectionEvent_t *pEvent = (DetectionEvent_t *)pPayload;
+  char deviceName[] = SIM_DEVICE_NAME;
+
+  pEvent->cb(deviceName, pEvent->status);
+}
+
+static void fill_ip(CellularIPStruct *pIp, CellularNetworkIPType_t ipType)
+{
+  memset(pIp, 0, sizeof(*pIp));
+  snprintf(pIp->WANIFName, sizeof(pIp->WANIFName), SIM_WAN_IFNAME);
+  pIp->IPType = ipType;
+  pIp->MTUSize = 1500;
+  if (ipType == CELLULAR_NETWORK_IP_FAMILY_IPV6)
+  {
+    snprintf(pIp->IPAddress, sizeof(pIp->IPAddress), "2001:db8:0:1::2");
+    snprintf(pIp->SubnetMask, sizeof(pIp->SubnetMask), "64");
+    snprintf(pIp->DefaultGateWay, sizeof(pIp->DefaultGateWay), "2001:db8:0:1::1");
+    snprintf(pIp->DNSServer1, sizeof(pIp->DNSServer1), "2001:4860:4860::8888");
+    snprintf(pIp->DNSServer2, sizeof(pIp->DNSServer2), "2001:4860:4860::8844");
+  }
+  else
+  {
+    snprintf(pIp->IPAddress, sizeof(pIp->IPAddress), "10.64.0.2");
+    snprintf(pIp->SubnetMask, sizeof(pIp->SubnetMask), "255.255.255.252");
+    snprintf(pIp->DefaultGateWay, sizeof(pIp->DefaultGateWay), "10.64.0.1");
+    snprintf(pIp->DNSServer1, sizeof(pIp->DNSServer1), "8.8.8.8");
+    snprintf(pIp->DNSServer2, sizeof(pIp->DNSServer2), "8.8.4.4");
+  }
+}
+
+/* Posts one ip ready and packet service callback per IP family of the session */
+static void post_session(uint32_t delay_ms, CellularDeviceIPReadyStatus_t ipStatus, CellularNetworkPacketStatus_t packetStatus)
+{
+  SessionEvent_t event;
+
+  memset(&event, 0, sizeof(event));
+  event.cb = gSim.network_cb;
+  event.ip_status = ipStatus;
+  event.packet_status = packetStatus;
+  if (gSim.ip_type != CELLULAR_NETWORK_IP_FAMILY_IPV6)
+  {
+    event.ip_type = CELLULAR_NETWORK_IP_FAMILY_IPV4;
+    fill_ip(&event.ip, event.ip_type);
+    sim_post(delay_ms, session_event, &event, sizeof(event));
+  }
+  if ((gSim.ip_type == CELLULAR_NETWORK_IP_FAMILY_IPV6) || (gSim.ip_type == CELLULAR_NETWORK_IP_FAMILY_IPV4_IPV6))
+  {
+    event.ip_type = CELLULAR_NETWORK_IP_FAMILY_IPV6;
+    fill_ip(&event.ip, event.ip_type);
+    sim_post(delay_ms, session_event, &event, sizeof(event));
+  }
+}
+
+static void connect_event(void *pPayload)
+{
+  CellularIPStruct ipv4, ipv6;
+
+  (void)pPayload;
+  sim_lock();
+  if (gSim.session_requested && (gSim.if_status != IF_UP) && (gSim.registration == DEVICE_NAS_STATUS_REGISTERED))
+  {
+    gSim.if_status = IF_UP;
+    /* The interface is there before the host hears of it */
+    fill_ip(&ipv4, CELLULAR_NETWORK_IP_FAMILY_IPV4);
+    fill_ip(&ipv6, CELLULAR_NETWORK_IP_FAMILY_IPV6);
+    sim_data_up((gSim.ip_type != CELLULAR_NETWORK_IP_FAMILY_IPV6) ? &ipv4 : NULL,
+                ((gSim.ip_type == CELLULAR_NETWORK_IP_FAMILY_IPV6) || (gSim.ip_type == CELLULAR_NETWORK_IP_FAMILY_IPV4_IPV6)) ? &ipv6 : NULL);
+    post_session(0, DEVICE_NETWORK_IP_READY, DEVICE_NETWORK_STATUS_CONNECTED);
+  }
+  sim_unlock();
+}
+
+void sim_session_connect(void)
+{
+  sim_post(gSim.config.connect_delay_ms, connect_event, NULL, 0);
+}
+
+void sim_session_down(void)
+{
+  if (gSim.if_status == IF_UP)
+  {
+    gSim.if_status = IF_DOWN;
+    sim_data_down();
+    post_session(gSim.config.disconnect_delay_ms, DEVICE_NETWORK_IP_NOT_READY, DEVICE_NETWORK_STATUS_DISCONNECTED);
+  }
+}
+
+int sim_card_ready(unsigned int slot)
+{
+  SimSlot_t *pSlot = &gSim.slots[slot];
+
+  return (pSlot->powered && pSlot->info.CardEnable && !pSlot->glitched && pSlot->info.IsCardPresent &&
+          (pSlot->info.Status == CELLULAR_UICC_STATUS_VALID)) ? 1 : 0;
+}
+
+int sim_can_register(void)
+{
+  return (gSim.present && (gSim.operating_config == CELLULAR_MODEM_SET_ONLINE) && sim_card_ready(gSim.active_slot)) ? 1 : 0;
+}
+
+/* The card has finished switching; lock must be held */
+static void card_settled(unsigned int slot)
+{
+  SimSlot_t *pSlot = &gSim.slots[slot];
+
+  pSlot->settling = 0;
+  pSlot->info.CardEnable = pSlot->powered;
+  if (!pSlot->powered)
+  {
+    /* A clean power off clears an error */
+    pSlot->glitched = 0;
+  }
+  else if (slot == gSim.active_slot)
+  {
+    sim_start_registration(gSim.config.registration_delay_ms);
+  }
+}
+
+static void card_power_event(void *pPayload)
+{
+  PowerEvent_t *pEvent = (PowerEvent_t *)pPayload;
+
+  sim_lock();
+  if (gSim.slots[pEvent->slot].settling && (pEvent->attempt == gSim.slots[pEvent->slot].power_attempt))
+  {
+    card_settled(pEvent->slot);
+  }
+  sim_unlock();
+}
+
+void sim_power_card(unsigned int slot, unsigned char enable)
+{
+  SimSlot_t *pSlot = &gSim.slots[slot];
+  PowerEvent_t event;
+
+  /* Switched again before the last switch finished, like a card losing power during its reset */
+  pSlot->glitched |= pSlot->settling;
+  pSlot->powered = enable;
+  pSlot->power_attempt++;
+  if ((slot == gSim.active_slot) && !enable)
+  {
+    sim_set_registration(DEVICE_NAS_STATUS_NOT_REGISTERED);
+  }
+  if (gSim.config.sim_power_delay_ms == 0)
+  {
+    card_settled(slot);
+    return;
+  }
+  pSlot->settling = 1;
+  event.slot = slot;
+  event.attempt = pSlot->power_attempt;
+  sim_post(gSim.config.sim_power_delay_ms, card_power_event, &event, sizeof(event));
+}
+
+void sim_set_registration(CellularDeviceNASStatus_t status)
+{
+  RegistrationEvent_t event;
+
+  if (gSim.registration == status)
+  {
+    return;
+  }
+  gSim.registration = status;
+  gSim.plmn.registration_status = status;
+  gSim.plmn.registered_service = (status == DEVICE_NAS_STATUS_REGISTERED) ? CELLULAR_MODEM_REGISTERED_SERVICE_PS : CELLULAR_MODEM_REGISTERED_SERVICE_NONE;
+  if (gSim.registration_cb != NULL)
+  {
+    event.cb = gSim.registration_cb;
+    event.status = status;
+    event.roaming = gSim.plmn.roaming_status;
+    event.service = gSim.plmn.registered_service;
+    sim_post(0, registration_event, &event, sizeof(event));
+  }
+  if (status != DEVICE_NAS_STATUS_REGISTERED)
+  {
+    sim_session_down();
+  }
+  else if (gSim.session_requested)
+  {
+    /* A requested session comes back by itself once the modem registers again */
+    sim_session_connect();
+  }
+}
+
+static void registered_event(void *pPayload)
+{
+  uint32_t attempt = *(uint32_t *)pPayload;
+
+  sim_lock();
+  /* An attempt which was cut short by power or slot changes must not complete a later one */
+  if (sim_can_register() && (gSim.registration == DEVICE_NAS_STATUS_REGISTERING) && (attempt == gSim.registration_attempt))
+  {
+    sim_set_registration(DEVICE_NAS_STATUS_REGISTERED);
+  }
+  sim_unlock();
+}
+
+void sim_start_registration(uint32_t delay_ms)
+{
+  if (!sim_can_register() || (gSim.registration != DEVICE_NAS_STATUS_NOT_REGISTERED))
+  {
+    return;
+  }
+  sim_set_registration(DEVICE_NAS_STATUS_REGISTERING);
+  gSim.registration_attempt++;
+  sim_post(delay_ms, registered_event, &gSim.registration_attempt, sizeof(gSim.registration_attempt));
+}
+
+int sim_rat_allowed(const char *pRat)
+{
+  char copy[SIM_RAT_LENGTH];
+  char *pSave = NULL;
+  char *pToken;
+
+  if (strcmp(gSim.preferred_rat, "AUTO") == 0)
+  {
+    return 1;
+  }
+  snprintf(copy, sizeof(copy), "%s", gSim.preferred_rat);
+  for (pToken = strtok_r(copy, ",", &pSave); pToken != NULL; pToken = strtok_r(NULL, ",", &pSave))
+  {
+    if (strcmp(pToken, pRat) == 0)
+    {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static void rat_switched_event(void *pPayload)
+{
+  RatSwitchEvent_t *pEvent = (RatSwitchEvent_t *)pPayload;
+
+  sim_lock();
+  if (pEvent->attempt == gSim.rat_switch)
+  {
+    gSim.rat_switching = 0;
+    snprintf(gSim.current_rat, sizeof(gSim.current_rat), "%s", pEvent->rat);
+    sim_start_registration(gSim.config.registration_delay_ms);
+  }
+  sim_unlock();
+}
+
+void sim_switch_rat(void)
+{
+  static const char *best[] = { "NR", "LTE", "UMTS", "GSM" };
+  RatSwitchEvent_t event;
+  unsigned int i;
+
+  gSim.rat_switch++;
+  if (sim_rat_allowed(gSim.current_rat))
+  {
+    /* Back to the technology in use before an earlier switch finished */
+    if (gSim.rat_switching)
+    {
+      gSim.rat_switching = 0;
+      sim_start_registration(gSim.config.registration_delay_ms);
+    }
+    return;
+  }
+  for (i = 0; (i < sizeof(best) / sizeof(best[0])) && !sim_rat_allowed(best[i]); i++)
+  {
+  }
+  if (i == sizeof(best) / sizeof(best[0]))
+  {
+    return;
+  }
+  sim_set_registration(DEVICE_NAS_STATUS_NOT_REGISTERED);
+  gSim.rat_switching = 1;
+  event.attempt = gSim.rat_switch;
+  snprintf(event.rat, sizeof(event.rat), "%s", best[i]);
+  sim_post(gSim.config.rat_switch_delay_ms, rat_switched_event, &event, sizeof(event));
+}
+
+static void post_detection(CellularDeviceDetectionStatus_t status)
+{
+  DetectionEvent_t event;
+
+  if (gSim.device_cb.device_remove_status_cb != NULL)
+  {
+    event.cb = gSim.device_cb.device_remove_status_cb;
+    event.status = status;
+    sim_post(0, detection_event, &event, sizeof(event));
+  }
+}
+
+static void restarted_event(void *pPayload)
+{
+  (void)pPayload;
+  sim_lock();
+  gSim.present = 1;
+  gSim.operating_config = CELLULAR_MODEM_SET_ONLINE;
+  post_detection(DEVICE_DETECTED);
+  sim_start_registration(gSim.config.registration_delay_ms);
+  sim_unlock();
+}
+
+void sim_restart(unsigned char factory)
+{
+  sim_set_registration(DEVICE_NAS_STATUS_NOT_REGISTERED);
+  gSim.present = 0;
+  gSim.ctrl_opened = 0;
+  post_detection(DEVICE_REMOVED);
+  if (factory)
+  {
+    default_profile(&gSim.profiles[0]);
+    gSim.profile_count = 1;
+    gSim.session_requested = 0;
+    snprintf(gSim.preferred_rat, sizeof(gSim.preferred_rat), "AUTO");
+  }
+  sim_post(gSim.config.reset_delay_ms, restarted_event, NULL, 0);
+}
+
+void cellular_sim_default_config(CellularSimConfig_t *pConfig)
+{
+  if (pConfig == NULL)
+  {
+    return;
+  }
+  memset(pConfig, 0, sizeof(*pConfig));
+  pConfig->slots = 3;
+  pConfig->esim_slots = 1;
+  pConfig->open_delay_ms = 5;
+  pConfig->slot_select_delay_ms = 5;
+  pConfig->registration_delay_ms = 20;
+  pConfig->connect_delay_ms = 20;
+  pConfig->disconnect_delay_ms = 5;
+  pConfig->reset_delay_ms = 50;
+  pConfig->rat_switch_delay_ms = 50;
+  pConfig->sim_power_delay_ms = 0;
+}
+
+int cellular_sim_configure(const CellularSimConfig_t *pConfig)
+{
+  if ((pConfig == NULL) || (pConfig->slots == 0) || (pConfig->slots > CELLULAR_SIM_MAX_SLOTS) || (pConfig->esim_slots > pConfig->slots))
+  {
+    return -1;
+  }
+  sim_lock();
+  gSim.config = *pConfig;
+  reset_state();
+  sim_unlock();
+  return 0;
+}
+
+void cellular_sim_get_config(CellularSimConfig_t *pConfig)
+{
+  if (pConfig == NULL)
+  {
+    return;
+  }
+  sim_lock();
+  *pConfig = gSim.config;
+  sim_unlock();
+}
+
+void cellular_sim_reset(void)
+{
+  sim_lock();
+  reset_state();
+  sim_unlock();
+}
+
+int cellular_sim_set_slot_info(unsigned int slot, const CellularUICCSlotInfoStruct *pInfo)
+{
+  if (pInfo == NULL)
+  {
+    return -1;
+  }
+  sim_lock();
+  if (slot >= gSim.config.slots)
+  {
+    sim_unlock();
+    return -1;
+  }
+  gSim.slots[slot].info = *pInfo;
+  gSim.slots[slot].powered = pInfo->CardEnable ? 1 : 0;
+  gSim.slots[slot].settling = 0;
+  gSim.slots[slot].glitched = 0;
+  if (slot == gSim.active_slot)
+  {
+    if (!sim_can_register())
+    {
+      sim_set_registration(DEVICE_NAS_STATUS_NOT_REGISTERED);
+    }
+    else
+    {
+      sim_start_registration(gSim.config.registration_delay_ms);
+    }
+  }
+  sim_unlock();
+  return 0;
+}
@@ -0,0 +1,137 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:*
+ * Copyright 2023 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Simulated modem state shared by the skeleton HAL and the simulator core */
+
+#ifndef CELLULAR_SIM_PRIVATE_H
+#define CELLULAR_SIM_PRIVATE_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include "cellular_hal.h"
+#include "cellular_ctl_protocol.h"
+#include "cellular_sim.h"
+
+#define SIM_DEVICE_NAME "cdc-wdm0"
+#define SIM_WAN_IFNAME  "wwan0"
+#define SIM_RAT_LENGTH  64
+
+/* info.CardEnable follows 'powered' once the card has finished switching */
+typedef struct
+{
+  unsigned char powered;
+  unsigned char settling;
+  unsigned char glitched;
+  uint32_t power_attempt;
+  CellularUICCSlotInfoStruct info;
+} SimSlot_t;
+
+typedef struct
+{
+  pthread_mutex_t lock;
+  CellularSimConfig_t config;
+  uint32_t generation;
+
+  unsigned char present;
+  unsigned char ctrl_opened;
+  CellularModemOperatingConfiguration_t operating_config;
+  CellularDeviceContextCBStruct device_cb;
+
+  unsigned int active_slot;
+  SimSlot_t slots[CELLULAR_SIM_MAX_SLOTS];
+
+  CellularDeviceNASStatus_t registration;
+  uint32_t registration_attempt;
+  cellular_device_registration_status_callback registration_cb;
+  CellularCurrentPlmnInfoStruct plmn;
+
+  CellularProfileStruct profiles[CELLULAR_SIM_MAX_PROFILES];
+  unsigned int profile_count;
+
+  CellularInterfaceStatus_t if_status;
+  unsigned char session_requested;
+  CellularNetworkIPType_t ip_type;
+  CellularProfileStruct session_profile;
+  CellularNetworkCBStruct network_cb;
+
+  char preferred_rat[SIM_RAT_LENGTH];
+  char current_rat[SIM_RAT_LENGTH];
+  uint32_t rat_switch;    /* Bumped by every preference change, so only the last switch completes */
+  unsigned char rat_switching;
+  CellularSignalInfoStruct signal;
+} SimState_t;
+
+typedef void (*SimEventFn_t)(void *pPayload);
+
+extern SimState_t gSim;
+
+/* Takes the state lock, starting the simulator on first use */
+void sim_lock(void);
+void sim_unlock(void);
+
+/* Bracket a section holding a lock, which a test abandoned by the harness watchdog is not jumped out of */
+void sim_hold_abandon(void);
+void sim_release_abandon(void);
+
+/* Test harness hooks behind them; weak as the simulator also builds on its own */
+void cellular_trace_hold_abandon(void) __attribute__((weak));
+void cellular_trace_release_abandon(void) __attribute__((weak));
+
+/* Runs pFn with a copy of the payload on the event thread after delay_ms; lock must be held */
+int sim_post(uint32_t delay_ms, SimEventFn_t pFn, const void *pPayload, size_t size);
+
+/* State transitions; lock must be held */
+void sim_set_registration(CellularDeviceNASStatus_t status);
+void sim_start_registration(uint32_t delay_ms);
+void sim_session_connect(void);
+void sim_session_down(void);
+int sim_can_register(void);
+/* 1 when the slot's card is on, valid and not in error */
+int sim_card_ready(unsigned int slot);
+/* Switches the slot's card on or off, after sim_power_delay_ms */
+void sim_power_card(unsigned int slot, unsigned char enable);
+/* 1 when the preferred technologies include pRat */
+int sim_rat_allowed(const char *pRat);
+/* Moves to the best preferred technology when the current one no longer is, out of service meanwhile */
+void sim_switch_rat(void);
+void sim_restart(unsigned char factory);
+
+/* AT transport in cellular_at.c; call without the state lock held */
+int sim_at_active(void);
+/* Sends AT<format>; the first response line starting with pPrefix is copied to pInfo without it. 0 on OK, -1 on an error result or timeout */
+int sim_at(const char *pPrefix, char *pInfo, size_t size, const char *pFormat, ...) __attribute__((format(printf, 4, 5)));
+/* Copies field index of a comma separated response, without quotes */
+int sim_at_field(const char *pInfo, unsigned int index, char *pField, size_t size);
+
+/* TUN data plane in cellular_tun.c; no-ops until cellular_sim_set_data_plane() */
+int sim_data_up(const CellularIPStruct *pIpv4, const CellularIPStruct *pIpv6);
+void sim_data_down(void);
+/* Fills the packet and byte counters the modem keeps, 0 when no session is on the data plane */
+int sim_data_stats(CellularPacketStatsStruct *pStats);
+
+/* Channel model in cellular_channel.c; puts the last step's values back and resumes stepping after a reset. Lock must be held */
+void sim_channel_restart(void);
+
+/* Control-protocol transport in cellular_ctl.c; call without the state lock held */
+int sim_ctl_active(void);
+/* Sends the TLVs after the header room of pFrame and waits for the response, copied to pResponse when not NULL. 0 on a success result, -1 otherwise */
+int sim_ctl(uint16_t message, uint8_t *pFrame, size_t used, uint8_t *pResponse, CellularCtlFrame_t *pParsed);
+/* Serving system TLV, from the last indication when there was one */
+int sim_ctl_serving(uint8_t *pServing);
+
+#endif /* CELLULAR_SIM_PRIVATE_H */
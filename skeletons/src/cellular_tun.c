@@ -0,0 +1,519 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:*
+ * Copyright 2023 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Data plane of the simulated modem. Once cellular_sim_set_data_plane() made a private
+ * network namespace, every connected session gets a TUN device there with the name and
+ * addresses of its ip ready callback. A pump thread reads what the host sends on it, as
+ * the modem transmits it, and the traffic generator writes what the network sends back.
+ * The modem counts both as a modem does, which is what the HAL reports; the kernel
+ * counts its side of the interface independently, for comparison.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <linux/if_tun.h>
+#include <linux/rtnetlink.h>
+#include <linux/if_link.h>
+#include "cellular_sim_private.h"
+
+#define TUN_PORT          9      /* discard */
+#define TUN_MIN_PACKET    28     /* IPv4 and UDP headers */
+#define TUN_MAX_PACKET    1500
+#define TUN_NETLINK_BYTES 4096
+
+/* struct in6_ifreq of linux/ipv6.h, which does not mix with netinet/in.h */
+typedef struct
+{
+  struct in6_addr addr;
+  uint32_t prefix_length;
+  int ifindex;
+} TunIn6Request_t;
+
+static pthread_mutex_t gTunLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t gTunOnce = PTHREAD_ONCE_INIT;
+static int gNetnsFd = -1;
+static int gTunFd = -1;
+static int gUplinkFd = -1;     /* UDP socket in the namespace, sending towards the network */
+static int gSinkFd = -1;       /* Bound to the session address so downlink packets are delivered */
+static int gNetlinkFd = -1;
+static int gStopFd = -1;
+static int gIfIndex;
+static struct in_addr gAddress;
+static struct in_addr gGateway;
+static pthread_t gPump;
+static uint32_t gSession;      /* Bumped when a device goes away, stopping the generator */
+
+/* Modem counters of the session, updated without the lock */
+static uint64_t gPacketsSent;
+static uint64_t gBytesSent;
+static uint64_t gPacketsReceived;
+static uint64_t gBytesReceived;
+static uint64_t gPacketsReceivedDrop;
+
+static void close_fd(int *pFd)
+{
+  if (*pFd >= 0)
+  {
+    close(*pFd);
+    *pFd = -1;
+  }
+}
+
+/* Taken by the calling threads only; a test abandoned by the harness watchdog is not jumped out of while it holds it */
+static void tun_lock(void)
+{
+  sim_hold_abandon();
+  pthread_mutex_lock(&gTunLock);
+}
+
+static void tun_unlock(void)
+{
+  pthread_mutex_unlock(&gTunLock);
+  sim_release_abandon();
+}
+
+/* The child shares the parent's device; it must not read the parent's packets */
+static void tun_atfork_child(void)
+{
+  pthread_mutex_init(&gTunLock, NULL);
+  close_fd(&gTunFd);
+  close_fd(&gUplinkFd);
+  close_fd(&gSinkFd);
+  close_fd(&gNetlinkFd);
+  close_fd(&gStopFd);
+  close_fd(&gNetnsFd);
+}
+
+static void tun_once(void)
+{
+  pthread_atfork(NULL, NULL, tun_atfork_child);
+}
+
+static void *pump_thread(void *pArg)
+{
+  unsigned char packet[65536];
+  struct pollfd fds[2];
+  ssize_t got;
+
+  (void)pArg;
+  prctl(PR_SET_NAME, "hal_sim_tun", 0, 0, 0);
+  fds[0].fd = gStopFd;
+  fds[0].events = POLLIN;
+  fds[1].fd = gTunFd;
+  fds[1].events = POLLIN;
+  while ((poll(fds, 2, -1) >= 0) || (errno == EINTR))
+  {
+    if (fds[0].revents != 0)
+    {
+      break;
+    }
+    while ((got = read(gTunFd, packet, sizeof(packet))) > 0)
+    {
+      __atomic_fetch_add(&gPacketsSent, 1, __ATOMIC_RELAXED);
+      __atomic_fetch_add(&gBytesSent, (uint64_t)got, __ATOMIC_RELAXED);
+    }
+  }
+  return NULL;
+}
+
+static int set_address(int fd, const char *pName, unsigned long request, const char *pAddress)
+{
+  struct ifreq ifr;
+  struct sockaddr_in *pIn = (struct sockaddr_in *)&ifr.ifr_addr;
+
+  memset(&ifr, 0, sizeof(ifr));
+  snprintf(ifr.ifr_name, sizeof(ifr.ifr_name), "%s", pName);
+  pIn->sin_family = AF_INET;
+  if (inet_pton(AF_INET, pAddress, &pIn->sin_addr) != 1)
+  {
+    return -1;
+  }
+  return ioctl(fd, request, &ifr);
+}
+
+/* Brings the device up with the addresses of the session; runs inside the namespace */
+static int configure_device(const CellularIPStruct *pIpv4, const CellularIPStruct *pIpv6)
+{
+  const CellularIPStruct *pIp = (pIpv4 != NULL) ? pIpv4 : pIpv6;
+  TunIn6Request_t request6;
+  struct sockaddr_in address;
+  struct ifreq ifr;
+  int fd, fd6;
+  int result = -1;
+
+  fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+  if (fd < 0)
+  {
+    return -1;
+  }
+  memset(&ifr, 0, sizeof(ifr));
+  snprintf(ifr.ifr_name, sizeof(ifr.ifr_name), "%s", pIp->WANIFName);
+  ifr.ifr_mtu = (int)pIp->MTUSize;
+  if ((ioctl(fd, SIOCSIFMTU, &ifr) != 0) || (ioctl(fd, SIOCGIFINDEX, &ifr) != 0))
+  {
+    close(fd);
+    return -1;
+  }
+  gIfIndex = ifr.ifr_ifindex;
+  if ((pIpv4 != NULL) &&
+      ((set_address(fd, pIpv4->WANIFName, SIOCSIFADDR, pIpv4->IPAddress) != 0) ||
+       (set_address(fd, pIpv4->WANIFName, SIOCSIFNETMASK, pIpv4->SubnetMask) != 0) ||
+       (inet_pton(AF_INET, pIpv4->IPAddress, &gAddress) != 1) || (inet_pton(AF_INET, pIpv4->DefaultGateWay, &gGateway) != 1)))
+  {
+    close(fd);
+    return -1;
+  }
+  memset(&ifr, 0, sizeof(ifr));
+  snprintf(ifr.ifr_name, sizeof(ifr.ifr_name), "%s", pIp->WANIFName);
+  ifr.ifr_flags = IFF_UP | IFF_RUNNING;
+  result = ioctl(fd, SIOCSIFFLAGS, &ifr);
+  close(fd);
+
+  /* IPv6 may be disabled in the kernel, the session then carries IPv4 only */
+  fd6 = (pIpv6 != NULL) ? socket(AF_INET6, SOCK_DGRAM | SOCK_CLOEXEC, 0) : -1;
+  if (fd6 >= 0)
+  {
+    memset(&request6, 0, sizeof(request6));
+    request6.prefix_length = (uint32_t)atoi(pIpv6->SubnetMask);
+    request6.ifindex = gIfIndex;
+    if (inet_pton(AF_INET6, pIpv6->IPAddress, &request6.addr) == 1)
+    {
+      ioctl(fd6, SIOCSIFADDR, &request6);
+    }
+    close(fd6);
+  }
+  if ((result != 0) || (pIpv4 == NULL))
+  {
+    return result;
+  }
+
+  gUplinkFd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  gSinkFd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr = gAddress;
+  address.sin_port = htons(TUN_PORT);
+  if ((gUplinkFd < 0) || (gSinkFd < 0) || (bind(gSinkFd, (struct sockaddr *)&address, sizeof(address)) != 0))
+  {
+    return -1;
+  }
+  return 0;
+}
+
+int cellular_sim_set_data_plane(int enable)
+{
+  int original;
+  int result = 0;
+
+  pthread_once(&gTunOnce, tun_once);
+  tun_lock();
+  if (!enable)
+  {
+    tun_unlock();
+    sim_data_down();
+    tun_lock();
+    close_fd(&gNetnsFd);
+  }
+  else if (gNetnsFd < 0)
+  {
+    /* Namespaces belong to threads: make one on this thread, keep it and come back */
+    original = open("/proc/thread-self/ns/net", O_RDONLY | O_CLOEXEC);
+    if ((original < 0) || (unshare(CLONE_NEWNET) != 0))
+    {
+      result = -1;
+    }
+    else
+    {
+      gNetnsFd = open("/proc/thread-self/ns/net", O_RDONLY | O_CLOEXEC);
+      if ((setns(original, CLONE_NEWNET) != 0) || (gNetnsFd < 0) || (access("/dev/net/tun", R_OK | W_OK) != 0))
+      {
+        close_fd(&gNetnsFd);
+        result = -1;
+      }
+    }
+    if (original >= 0)
+    {
+      close(original);
+    }
+  }
+  tun_unlock();
+  return result;
+}
+
+int sim_data_up(const CellularIPStruct *pIpv4, const CellularIPStruct *pIpv6)
+{
+  struct sockaddr_nl local;
+  struct ifreq ifr;
+  int original;
+  int result = -1;
+
+  tun_lock();
+  if ((gNetnsFd < 0) || (gTunFd >= 0) || ((pIpv4 == NULL) && (pIpv6 == NULL)))
+  {
+    tun_unlock();
+    return (gNetnsFd < 0) ? 0 : -1;
+  }
+  original = open("/proc/thread-self/ns/net", O_RDONLY | O_CLOEXEC);
+  if ((original >= 0) && (setns(gNetnsFd, CLONE_NEWNET) == 0))
+  {
+    /* The device belongs to the namespace of the thread opening it and goes away with the descriptor */
+    gTunFd = open("/dev/net/tun", O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    memset(&ifr, 0, sizeof(ifr));
+    ifr.ifr_flags = IFF_TUN | IFF_NO_PI;
+    snprintf(ifr.ifr_name, sizeof(ifr.ifr_name), "%s", (pIpv4 != NULL) ? pIpv4->WANIFName : pIpv6->WANIFName);
+    memset(&local, 0, sizeof(local));
+    local.nl_family = AF_NETLINK;
+    if ((gTunFd >= 0) && (ioctl(gTunFd, TUNSETIFF, &ifr) == 0) && (configure_device(pIpv4, pIpv6) == 0))
+    {
+      gNetlinkFd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+      gStopFd = eventfd(0, EFD_CLOEXEC);
+      result = ((gNetlinkFd >= 0) && (bind(gNetlinkFd, (struct sockaddr *)&local, sizeof(local)) == 0) && (gStopFd >= 0)) ? 0 : -1;
+    }
+    setns(original, CLONE_NEWNET);
+  }
+  if (original >= 0)
+  {
+    close(original);
+  }
+  __atomic_store_n(&gPacketsSent, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&gBytesSent, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&gPacketsReceived, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&gBytesReceived, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&gPacketsReceivedDrop, 0, __ATOMIC_RELAXED);
+  if ((result != 0) || (pthread_create(&gPump, NULL, pump_thread, NULL) != 0))
+  {
+    close_fd(&gTunFd);
+    close_fd(&gUplinkFd);
+    close_fd(&gSinkFd);
+    close_fd(&gNetlinkFd);
+    close_fd(&gStopFd);
+    result = -1;
+  }
+  tun_unlock();
+  return result;
+}
+
+void sim_data_down(void)
+{
+  uint64_t one = 1;
+
+  tun_lock();
+  if (gTunFd >= 0)
+  {
+    if (write(gStopFd, &one, sizeof(one)) == (ssize_t)sizeof(one))
+    {
+      pthread_join(gPump, NULL);
+    }
+    close_fd(&gTunFd);
+    close_fd(&gUplinkFd);
+    close_fd(&gSinkFd);
+    close_fd(&gNetlinkFd);
+    close_fd(&gStopFd);
+    __atomic_fetch_add(&gSession, 1, __ATOMIC_RELAXED);
+  }
+  tun_unlock();
+}
+
+int sim_data_stats(CellularPacketStatsStruct *pStats)
+{
+  if (__atomic_load_n(&gTunFd, __ATOMIC_RELAXED) < 0)
+  {
+    return 0;
+  }
+  pStats->PacketsSent = (unsigned long)__atomic_load_n(&gPacketsSent, __ATOMIC_RELAXED);
+  pStats->BytesSent = (unsigned long)__atomic_load_n(&gBytesSent, __ATOMIC_RELAXED);
+  pStats->PacketsReceived = (unsigned long)__atomic_load_n(&gPacketsReceived, __ATOMIC_RELAXED);
+  pStats->BytesReceived = (unsigned long)__atomic_load_n(&gBytesReceived, __ATOMIC_RELAXED);
+  pStats->PacketsReceivedDrop = (unsigned long)__atomic_load_n(&gPacketsReceivedDrop, __ATOMIC_RELAXED);
+  return 1;
+}
+
+/* IPv4 and UDP headers of a downlink packet from the gateway to the session address */
+static void build_downlink(unsigned char *pPacket, size_t size)
+{
+  uint32_t sum = 0;
+  size_t i;
+
+  memset(pPacket, 0, size);
+  pPacket[0] = 0x45;
+  pPacket[2] = (unsigned char)(size >> 8);
+  pPacket[3] = (unsigned char)size;
+  pPacket[6] = 0x40;   /* don't fragment */
+  pPacket[8] = 64;
+  pPacket[9] = IPPROTO_UDP;
+  memcpy(&pPacket[12], &gGateway, 4);
+  memcpy(&pPacket[16], &gAddress, 4);
+  for (i = 0; i < 20; i += 2)
+  {
+    sum += (uint32_t)((pPacket[i] << 8) | pPacket[i + 1]);
+  }
+  sum = (sum & 0xFFFF) + (sum >> 16);
+  sum = (sum & 0xFFFF) + (sum >> 16);
+  pPacket[10] = (unsigned char)(~sum >> 8);
+  pPacket[11] = (unsigned char)~sum;
+  pPacket[20] = TUN_PORT >> 8;
+  pPacket[21] = TUN_PORT & 0xFF;
+  pPacket[22] = TUN_PORT >> 8;
+  pPacket[23] = TUN_PORT & 0xFF;
+  pPacket[24] = (unsigned char)((size - 20) >> 8);
+  pPacket[25] = (unsigned char)(size - 20);
+  /* A zero UDP checksum is "none" over IPv4 */
+}
+
+int cellular_sim_generate_traffic(uint64_t uplink_bytes, uint64_t downlink_bytes, uint32_t packet_size, CellularSimTraffic_t *pTraffic)
+{
+  unsigned char packet[TUN_MAX_PACKET];
+  struct sockaddr_in gateway;
+  struct timespec start, end;
+  uint64_t up = 0, down = 0;
+  uint32_t session;
+  ssize_t done;
+  int tunFd, uplinkFd;
+
+  if ((pTraffic == NULL) || (packet_size < TUN_MIN_PACKET) || (packet_size > TUN_MAX_PACKET))
+  {
+    return -1;
+  }
+  memset(pTraffic, 0, sizeof(*pTraffic));
+  tun_lock();
+  if ((gTunFd < 0) || (gUplinkFd < 0))
+  {
+    tun_unlock();
+    return -1;
+  }
+  /* Own descriptors, so the session can go down meanwhile without waiting for the run */
+  tunFd = fcntl(gTunFd, F_DUPFD_CLOEXEC, 0);
+  uplinkFd = fcntl(gUplinkFd, F_DUPFD_CLOEXEC, 0);
+  session = gSession;
+  build_downlink(packet, packet_size);
+  tun_unlock();
+  memset(&gateway, 0, sizeof(gateway));
+  gateway.sin_family = AF_INET;
+  gateway.sin_addr = gGateway;
+  gateway.sin_port = htons(TUN_PORT);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  while ((tunFd >= 0) && (uplinkFd >= 0) && ((up < uplink_bytes) || (down < downlink_bytes)) &&
+         (__atomic_load_n(&gSession, __ATOMIC_RELAXED) == session))
+  {
+    /* The kernel routes this out of the device, where the pump reads it */
+    if ((up < uplink_bytes) &&
+        (sendto(uplinkFd, &packet[TUN_MIN_PACKET], packet_size - TUN_MIN_PACKET, 0, (struct sockaddr *)&gateway, sizeof(gateway)) >= 0))
+    {
+      up += packet_size;
+      pTraffic->uplink_packets++;
+    }
+    if (down < downlink_bytes)
+    {
+      done = write(tunFd, packet, packet_size);
+      if (done == (ssize_t)packet_size)
+      {
+        __atomic_fetch_add(&gPacketsReceived, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&gBytesReceived, packet_size, __ATOMIC_RELAXED);
+      }
+      else
+      {
+        __atomic_fetch_add(&gPacketsReceivedDrop, 1, __ATOMIC_RELAXED);
+      }
+      down += packet_size;
+      pTraffic->downlink_packets++;
+    }
+    /* The sink is never read, a full receive buffer drops in UDP and not on the device */
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  pTraffic->uplink_bytes = up;
+  pTraffic->downlink_bytes = down;
+  pTraffic->elapsed_ns = ((uint64_t)(end.tv_sec - start.tv_sec) * 1000000000ull) + (uint64_t)end.tv_nsec - (uint64_t)start.tv_nsec;
+  close_fd(&tunFd);
+  close_fd(&uplinkFd);
+  return ((up >= uplink_bytes) && (down >= downlink_bytes)) ? 0 : -1;
+}
+
+int cellular_sim_get_link_stats(CellularSimLinkStats_t *pStats)
+{
+  struct
+  {
+    struct nlmsghdr header;
+    struct ifinfomsg info;
+  } request;
+  unsigned char reply[TUN_NETLINK_BYTES] __attribute__((aligned(NLMSG_ALIGNTO)));
+  struct rtnl_link_stats64 stats;
+  struct nlmsghdr *pHeader;
+  struct rtattr *pAttr;
+  ssize_t got;
+  int length;
+  int result = -1;
+
+  if (pStats == NULL)
+  {
+    return -1;
+  }
+  tun_lock();
+  if (gNetlinkFd < 0)
+  {
+    tun_unlock();
+    return -1;
+  }
+  memset(&request, 0, sizeof(request));
+  request.header.nlmsg_len = sizeof(request);
+  request.header.nlmsg_type = RTM_GETLINK;
+  request.header.nlmsg_flags = NLM_F_REQUEST;
+  request.info.ifi_family = AF_UNSPEC;
+  request.info.ifi_index = gIfIndex;
+  if ((send(gNetlinkFd, &request, sizeof(request), 0) == (ssize_t)sizeof(request)) &&
+      ((got = recv(gNetlinkFd, reply, sizeof(reply), 0)) > 0))
+  {
+    pHeader = (struct nlmsghdr *)reply;
+    if (NLMSG_OK(pHeader, (unsigned int)got) && (pHeader->nlmsg_type == RTM_NEWLINK))
+    {
+      length = (int)IFLA_PAYLOAD(pHeader);
+      for (pAttr = IFLA_RTA(NLMSG_DATA(pHeader)); RTA_OK(pAttr, length); pAttr = RTA_NEXT(pAttr, length))
+      {
+        if ((pAttr->rta_type == IFLA_STATS64) && (RTA_PAYLOAD(pAttr) >= sizeof(stats)))
+        {
+          memcpy(&stats, RTA_DATA(pAttr), sizeof(stats));
+          pStats->tx_packets = stats.tx_packets;
+          pStats->tx_bytes = stats.tx_bytes;
+          pStats->rx_packets = stats.rx_packets;
+          pStats->rx_bytes = stats.rx_bytes;
+          pStats->tx_dropped = stats.tx_dropped;
+          pStats->rx_dropped = stats.rx_dropped;
+          result = 0;
+        }
+      }
+    }
+  }
+  tun_unlock();
+  return result;
+}
@@ -0,0 +1,1462 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:*
+ * Copyright 2023 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file cellular_atmodem.c
+ * @brief AT-command modem emulator on a pseudo-terminal
+ */
+
+#define _GNU_SOURCE
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/prctl.h>
+#include <sys/stat.h>
+#include <ut_log.h>
+#include "cellular_atmodem.h"
+#include "cellular_hal.h"
+#include "cellular_metrics.h"
+#include "cellular_run.h"
+
+#define LINE_LENGTH     512
+#define RESPONSE_LENGTH 4096
+#define PACING_CHUNK    16
+#define MAX_CONTEXTS    16
+#define MAX_ARGS        8
+
+#define ATMODEM_IMEI_SV "352099001761401"
+#define ATMODEM_IMSI    "310260000000001"
+#define ATMODEM_ICCID   "8901260000000000001"
+#define ATMODEM_MSISDN  "15550100000"
+
+/* +CME ERROR codes of 3GPP TS 27.007 */
+#define CME_NOT_ALLOWED         3
+#define CME_NOT_SUPPORTED       4
+#define CME_SIM_NOT_INSERTED    10
+#define CME_NO_NETWORK          30
+#define CME_INCORRECT_PARAMETER 50
+
+/* Plain ERROR whatever +CMEE says, for a command the modem does not know */
+#define AT_UNKNOWN (-1)
+
+typedef enum
+{
+    AT_EXEC = 0,    /*!< +CMD */
+    AT_READ,        /*!< +CMD? */
+    AT_TEST,        /*!< +CMD=? */
+    AT_SET          /*!< +CMD=args */
+} AtKind_t;
+
+typedef struct
+{
+    int defined;
+    char type[16];
+    char apn[100];
+    int auth;
+    char user[64];
+    char password[64];
+    int active;
+} AtContext_t;
+
+typedef struct
+{
+    int echo;
+    int cmee;
+    int cfun;
+    int cops_mode;
+    int cops_format;
+    int creg_n;
+    int cereg_n;
+    int attached;
+    int ws46;
+    int rssi;
+    int ber;
+    int rsrq;
+    int rsrp;
+    AtContext_t contexts[MAX_CONTEXTS + 1];    /*!< Indexed by cid, 0 unused */
+} AtModem_t;
+
+typedef struct
+{
+    char prefix[32];
+    int ms;
+} AtLatency_t;
+
+typedef struct
+{
+    char name[16];
+    uint64_t count;
+    uint64_t errors;
+} AtCommandCount_t;
+
+typedef int (*AtHandlerFn_t)(AtKind_t kind, char **ppArgs, int count);
+
+typedef struct
+{
+    const char *pName;
+    AtHandlerFn_t pFn;
+} AtHandler_t;
+
+static pthread_mutex_t gLock = PTHREAD_MUTEX_INITIALIZER;
+static AtModem_t gModem;
+static AtLatency_t gLatencies[CELLULAR_ATMODEM_MAX_LATENCIES];
+static unsigned int gLatencyCount = 0;
+static int gDefaultLatencyMs = 0;
+static AtCommandCount_t gCommands[CELLULAR_ATMODEM_MAX_COMMANDS];
+static unsigned int gCommandCount = 0;
+static CellularAtmodemStats_t gStats;
+
+static int gStarted = 0;
+static volatile int gStop = 0;
+static int gMasterFd = -1;
+static int gSlaveFd = -1;
+static int gStopFd = -1;
+static pthread_t gThread;
+static char gPath[64];
+
+/* Response of the line being answered, written out in one paced burst */
+static char gResponse[RESPONSE_LENGTH];
+static size_t gResponseUsed = 0;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000ull) + (uint64_t)ts.tv_nsec;
+}
+
+static void sleep_until(uint64_t due_ns)
+{
+    struct timespec ts;
+
+    ts.tv_sec = (time_t)(due_ns / 1000000000ull);
+    ts.tv_nsec = (long)(due_ns % 1000000000ull);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+    {
+    }
+}
+
+/* Sleeps for a command latency, returning early on stop */
+static void wait_ms(int ms)
+{
+    struct pollfd fd = { gStopFd, POLLIN, 0 };
+
+    if (ms > 0)
+    {
+        poll(&fd, 1, ms);
+    }
+}
+
+/* Time of bytes on the line: a start bit, 8 data bits and a stop bit each */
+static uint64_t wire_ns(size_t bytes)
+{
+    return (gStats.baud > 0) ? ((uint64_t)bytes * 10ull * 1000000000ull) / gStats.baud : 0;
+}
+
+static void send_paced(const char *pData, size_t size)
+{
+    uint64_t due = now_ns();
+    size_t chunk;
+    ssize_t written;
+
+    while (size > 0)
+    {
+        chunk = (size < PACING_CHUNK) ? size : PACING_CHUNK;
+        due += wire_ns(chunk);
+        sleep_until(due);
+        written = write(gMasterFd, pData, chunk);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            gStats.bytes_dropped += size;
+            return;
+        }
+        gStats.bytes_out += (uint64_t)written;
+        pData += written;
+        size -= (size_t)written;
+    }
+}
+
+static void default_state(void)
+{
+    memset(&gModem, 0, sizeof(gModem));
+    gModem.echo = 1;
+    gModem.cmee = 1;
+    gModem.cfun = 1;
+    gModem.attached = 1;
+    gModem.ws46 = 25;
+    gModem.rssi = 26;
+    gModem.ber = 99;
+    gModem.rsrq = 20;
+    gModem.rsrp = 45;
+    gModem.contexts[1].defined = 1;
+    snprintf(gModem.contexts[1].type, sizeof(gModem.contexts[1].type), "IPV4V6");
+    snprintf(gModem.contexts[1].apn, sizeof(gModem.contexts[1].apn), "internet");
+}
+
+static int registered(void)
+{
+    return ((gModem.cfun == 1) && (gModem.cops_mode != 2)) ? 1 : 0;
+}
+
+/* Access technology of +COPS and +CEREG for the +WS46 selection */
+static int access_technology(void)
+{
+    switch (gModem.ws46)
+    {
+        case 12:
+            return 0;
+        case 22:
+        case 29:
+            return 2;
+        case 36:
+            return 11;
+        default:
+            return 7;
+    }
+}
+
+static void deactivate_all(void)
+{
+    unsigned int cid;
+
+    for (cid = 1; cid <= MAX_CONTEXTS; cid++)
+    {
+        gModem.contexts[cid].active = 0;
+    }
+}
+
+static void respond(const char *pFormat, ...)
+{
+    va_list args;
+    int length;
+
+    if (gResponseUsed + 4 >= sizeof(gResponse))
+    {
+        return;
+    }
+    gResponse[gResponseUsed++] = '\r';
+    gResponse[gResponseUsed++] = '\n';
+    va_start(args, pFormat);
+    length = vsnprintf(&gResponse[gResponseUsed], sizeof(gResponse) - gResponseUsed - 2, pFormat, args);
+    va_end(args);
+    if (length > 0)
+    {
+        gResponseUsed += ((size_t)length < sizeof(gResponse) - gResponseUsed - 2) ? (size_t)length : sizeof(gResponse) - gResponseUsed - 3;
+    }
+    gResponse[gResponseUsed++] = '\r';
+    gResponse[gResponseUsed++] = '\n';
+}
+
+static const char *cme_text(int error)
+{
+    switch (error)
+    {
+        case CME_NOT_ALLOWED:
+            return "operation not allowed";
+        case CME_NOT_SUPPORTED:
+            return "operation not supported";
+        case CME_SIM_NOT_INSERTED:
+            return "SIM not inserted";
+        case CME_NO_NETWORK:
+            return "no network service";
+        case CME_INCORRECT_PARAMETER:
+            return "incorrect parameters";
+        default:
+            return "unknown";
+    }
+}
+
+static void final_result(int error)
+{
+    if (error == 0)
+    {
+        respond("OK");
+    }
+    else if ((error == AT_UNKNOWN) || (gModem.cmee == 0))
+    {
+        respond("ERROR");
+    }
+    else if (gModem.cmee == 1)
+    {
+        respond("+CME ERROR: %d", error);
+    }
+    else
+    {
+        respond("+CME ERROR: %s", cme_text(error));
+    }
+}
+
+/* Strict decimal, so "1a" is an incorrect parameter rather than 1 */
+static int arg_int(const char *pArg, int *pValue)
+{
+    char *pEnd;
+    long value;
+
+    if ((pArg == NULL) || (*pArg == '\0'))
+    {
+        return -1;
+    }
+    value = strtol(pArg, &pEnd, 10);
+    if ((*pEnd != '\0') || (value < -100000) || (value > 100000))
+    {
+        return -1;
+    }
+    *pValue = (int)value;
+    return 0;
+}
+
+/* Splits on commas outside quotes, removing the quotes and the blanks around each argument */
+static int split_args(char *pArgs, char **ppArgs, int max)
+{
+    char *pRead = pArgs;
+    char *pWrite = pArgs;
+    int count = 0;
+    int quoted = 0;
+
+    if (*pArgs == '\0')
+    {
+        return 0;
+    }
+    ppArgs[count++] = pWrite;
+    for (; *pRead != '\0'; pRead++)
+    {
+        if (*pRead == '"')
+        {
+            quoted = !quoted;
+        }
+        else if ((*pRead == ',') && !quoted)
+        {
+            *pWrite++ = '\0';
+            if (count == max)
+            {
+                return -1;
+            }
+            ppArgs[count++] = pWrite;
+        }
+        else if (quoted || (*pRead != ' '))
+        {
+            *pWrite++ = *pRead;
+        }
+    }
+    *pWrite = '\0';
+    return quoted ? -1 : count;
+}
+
+static int context_id(const char *pArg, int *pCid)
+{
+    return ((arg_int(pArg, pCid) == 0) && (*pCid >= 1) && (*pCid <= MAX_CONTEXTS)) ? 0 : -1;
+}
+
+static int identity(AtKind_t kind, const char *pValue)
+{
+    if (kind == AT_TEST)
+    {
+        return 0;
+    }
+    if (kind != AT_EXEC)
+    {
+        return AT_UNKNOWN;
+    }
+    respond("%s", pValue);
+    return 0;
+}
+
+static int handle_cgmi(AtKind_t kind, char **ppArgs, int count)
+{
+    return identity(kind, "RDK");
+}
+
+static int handle_cgmm(AtKind_t kind, char **ppArgs, int count)
+{
+    return identity(kind, "ATMODEM");
+}
+
+static int handle_cgmr(AtKind_t kind, char **ppArgs, int count)
+{
+    return identity(kind, CELLULAR_ATMODEM_FIRMWARE);
+}
+
+static int handle_cgsn(AtKind_t kind, char **ppArgs, int count)
+{
+    int type;
+
+    if (kind == AT_TEST)
+    {
+        respond("+CGSN: (0-2)");
+        return 0;
+    }
+    if (kind == AT_EXEC)
+    {
+        respond("%s", CELLULAR_ATMODEM_IMEI);
+        return 0;
+    }
+    if ((kind != AT_SET) || (count != 1) || (arg_int(ppArgs[0], &type) != 0) || (type < 0) || (type > 2))
+    {
+        return CME_INCORRECT_PARAMETER;
+    }
+    respond("+CGSN: \"%s\"", (type == 2) ? ATMODEM_IMEI_SV : CELLULAR_ATMODEM_IMEI);
+    return 0;
+}
+
+static int handle_cimi(AtKind_t kind, char **ppArgs, int count)
+{
+    if ((kind == AT_EXEC) && (gModem.cfun == 0))
+    {
+        return CME_SIM_NOT_INSERTED;
+    }
+    return identity(kind, ATMODEM_IMSI);
+}
+
+static int handle_ccid(AtKind_t kind, char **ppArgs, int count)
+{
+    if (kind != AT_EXEC)
+    {
+        return identity(kind, "");
+    }
+    if (gModem.cfun == 0)
+    {
+        return CME_SIM_NOT_INSERTED;
+    }
+    respond("+CCID: %s", ATMODEM_ICCID);
+    return 0;
+}
+
+static int handle_cnum(AtKind_t kind, char **ppArgs, int count)
+{
+    if (kind != AT_EXEC)
+    {
+        return identity(kind, "");
+    }
+    if (gModem.cfun == 0)
+    {
+        return CME_SIM_NOT_INSERTED;
+    }
+    respond("+CNUM: \"\",\"%s\",129", ATMODEM_MSISDN);
+    return 0;
+}
+
+static int handle_cmee(AtKind_t kind, char **ppArgs, int count)
+{
+    int value;
+
+    switch (kind)
+    {
+        case AT_READ:
+            respond("+CMEE: %d", gModem.cmee);
+            return 0;
+        case AT_TEST:
+            respond("+CMEE: (0-2)");
+            return 0;
+        case AT_SET:
+            if ((count != 1) || (arg_int(ppArgs[0], &value) != 0) || (value < 0) || (value > 2))
+            {
+                return CME_INCORRECT_PARAMETER;
+            }
+            gModem.cmee = value;
+            return 0;
+        default:
+            return AT_UNKNOWN;
+    }
+}
+
+/* The SIM has no PIN; it is off with the radio at +CFUN=0 */
+static int handle_cpin(AtKind_t kind, char **ppArgs, int count)
+{
+    switch (kind)
+    {
+        case AT_READ:
+            if (gModem.cfun == 0)
+            {
+                return CME_SIM_NOT_INSERTED;
+            }
+            respond("+CPIN: READY");
+            return 0;
+        case AT_TEST:
+            return 0;
+        case AT_SET:
+            return CME_NOT_ALLOWED;
+        default:
+            return AT_UNKNOWN;
+    }
+}
+
+static int handle_cfun(AtKind_t kind, char **ppArgs, int count)
+{
+    int fun, reset = 0;
+
+    switch (kind)
+    {
+        case AT_READ:
+            respond("+CFUN: %d", gModem.cfun);
+            return 0;
+        case AT_TEST:
+            respond("+CFUN: (0,1,4),(0-1)");
+            return 0;
+        case AT_SET:
+            if ((count < 1) || (count > 2) || (arg_int(ppArgs[0], &fun) != 0) || ((fun != 0) && (fun != 1) && (fun != 4)) ||
+                ((count == 2) && ((arg_int(ppArgs[1], &reset) != 0) || (reset < 0) || (reset > 1))) || (reset && (fun != 1)))
+            {
+                return CME_INCORRECT_PARAMETER;
+            }
+            gModem.cfun = fun;
+            gModem.attached = (fun == 1) && (gModem.cops_mode != 2);
+            deactivate_all();
+            return 0;
+        default:
+            return AT_UNKNOWN;
+    }
+}
+
+static int handle_csq(AtKind_t kind, char **ppArgs, int count)
+{
+    if (kind == AT_TEST)
+    {
+        respond("+CSQ: (0-31,99),(0-7,99)");
+        return 0;
+    }
+    if (kind != AT_EXEC)
+    {
+        return AT_UNKNOWN;
+    }
+    respond("+CSQ: %d,%d", registered() ? gModem.rssi : 99, registered() ? gModem.ber : 99);
+    return 0;
+}
+
+static int handle_cesq(AtKind_t kind, char **ppArgs, int count)
+{
+    if (kind == AT_TEST)
+    {
+        respond("+CESQ: (0-63,99),(0-7,99),(0-96,255),(0-49,255),(0-34,255),(0-97,255)");
+        return 0;
+    }
+    if (kind != AT_EXEC)
+    {
+        return AT_UNKNOWN;
+    }
+    respond("+CESQ: 99,99,255,255,%d,%d", registered() ? gModem.rsrq : 255, registered() ? gModem.rsrp : 255);
+    return 0;
+}
+
+static int handle_cops(AtKind_t kind, char **ppArgs, int count)
+{
+    int mode, format;
+
+    switch (kind)
+    {
+        case AT_READ:
+            if (!registered())
+            {
+                respond("+COPS: %d", gModem.cops_mode);
+            }
+            else if (gModem.cops_format == 2)
+            {
+                respond("+COPS: %d,2,\"310260\",%d", gModem.cops_mode, access_technology());
+            }
+            else
+            {
+                respond("+COPS: %d,%d,\"%s\",%d", gModem.cops_mode, gModem.cops_format,
+                        (gModem.cops_format == 1) ? "SimOp" : "Sim Operator", access_technology());
+            }
+            return 0;
+        case AT_TEST:
+            if (gModem.cfun != 1)
+            {
+                return CME_NO_NETWORK;
+            }
+            respond("+COPS: (2,\"Sim Operator\",\"SimOp\",\"310260\",7),(1,\"Sim Partner\",\"Partner\",\"310410\",7),"
+                    "(1,\"Sim Roaming\",\"Roam\",\"311480\",2),(3,\"Sim Foreign\",\"Foreign\",\"23415\",0),,(0-4),(0-2)");
+            return 0;
+        case AT_SET:
+            if ((count < 1) || (arg_int(ppArgs[0], &mode) != 0) || (mode < 0) || (mode > 4))
+            {
+                return CME_INCORRECT_PARAMETER;
+            }
+            if ((count >= 2) && ((arg_int(ppArgs[1], &format) != 0) || (format < 0) || (format > 2)))
+            {
+                return CME_INCORRECT_PARAMETER;
+            }
+            if (mode == 3)
+            {
+                if (count < 2)
+                {
+                    return CME_INCORRECT_PARAMETER;
+                }
+                gModem.cops_format = format;
+                return 0;
+            }
+            /* Manual selection only finds the home network */
+            if (((mode == 1) || (mode == 4)) && ((count < 3) || ((strcmp(ppArgs[2], "310260") != 0) &&
+                                                                 (strcmp(ppArgs[2], "Sim Operator") != 0))))
+            {
+                if (mode == 1)
+                {
+                    return CME_NO_NETWORK;
+                }
+                mode = 0;
+            }
+            if ((mode != 2) && (gModem.cfun != 1))
+            {
+                return CME_NO_NETWORK;
+            }
+            gModem.cops_mode = (mode == 4) ? 1 : mode;
+            gModem.attached = (mode != 2);
+            if (mode == 2)
+            {
+                deactivate_all();
+            }
+            return 0;
+        default:
+            return AT_UNKNOWN;
+    }
+}
+
+/* +CREG and +CEREG store n but send no unsolicited results, the emulated registration only changes on command */
+static int registration(AtKind_t kind, char **ppArgs, int count, const char *pName, int *pN)
+{
+    int value;
+
+    switch (kind)
+    {
+        case AT_READ:
+            if ((*pN == 2) && registered())
+            {
+                respond("%s: 2,1,\"2A1F\",\"01A2B3C\",%d", pName, access_technology());
+            }
+            else
+            {
+                respond("%s: %d,%d", pName, *pN, registered());
+            }
+            return 0;
+        case AT_TEST:
+            respond("%s: (0-2)", pName);
+            return 0;
+        case AT_SET:
+            if ((count != 1) || (arg_int(ppArgs[0], &value) != 0) || (value < 0) || (value > 2))
+            {
+                return CME_INCORRECT_PARAMETER;
+            }
+            *pN = value;
+            return 0;
+        default:
+            return AT_UNKNOWN;
+    }
+}
+
+static int handle_creg(AtKind_t kind, char **ppArgs, int count)
+{
+    return registration(kind, ppArgs, count, "+CREG", &gModem.creg_n);
+}
+
+static int handle_cereg(AtKind_t kind, char **ppArgs, int count)
+{
+    return registration(kind, ppArgs, count, "+CEREG", &gModem.cereg_n);
+}
+
+static int handle_cgatt(AtKind_t kind, char **ppArgs, int count)
+{
+    int value;
+
+    switch (kind)
+    {
+        case AT_READ:
+            respond("+CGATT: %d", gModem.attached);
+            return 0;
+        case AT_TEST:
+            respond("+CGATT: (0-1)");
+            return 0;
+        case AT_SET:
+            if ((count != 1) || (arg_int(ppArgs[0], &value) != 0) || (value < 0) || (value > 1))
+            {
+                return CME_INCORRECT_PARAMETER;
+            }
+            if (value && !registered())
+            {
+                return CME_NO_NETWORK;
+            }
+            gModem.attached = value;
+            if (!value)
+            {
+                deactivate_all();
+            }
+            return 0;
+        default:
+            return AT_UNKNOWN;
+    }
+}
+
+static int handle_ws46(AtKind_t kind, char **ppArgs, int count)
+{
+    static const int known[] = { 12, 22, 25, 28, 29, 30, 31, 36, 37 };
+    unsigned int i;
+    int value;
+
+    switch (kind)
+    {
+        case AT_READ:
+            respond("+WS46: %d", gModem.ws46);
+            return 0;
+        case AT_TEST:
+            respond("+WS46: (12,22,25,28,29,30,31,36,37)");
+            return 0;
+        case AT_SET:
+            if ((count != 1) || (arg_int(ppArgs[0], &value) != 0))
+            {
+                return CME_INCORRECT_PARAMETER;
+            }
+            for (i = 0; i < sizeof(known) / sizeof(known[0]); i++)
+            {
+                if (known[i] == value)
+                {
+                    gModem.ws46 = value;
+                    return 0;
+                }
+            }
+            return CME_INCORRECT_PARAMETER;
+        default:
+            return AT_UNKNOWN;
+    }
+}
+
+static int handle_cgdcont(AtKind_t kind, char **ppArgs, int count)
+{
+    AtContext_t *pContext;
+    int cid;
+
+    switch (kind)
+    {
+        case AT_READ:
+            for (cid = 1; cid <= MAX_CONTEXTS; cid++)
+            {
+                pContext = &gModem.contexts[cid];
+                if (pContext->defined)
+                {
+                    respond("+CGDCONT: %d,\"%s\",\"%s\",\"\",0,0", cid, pContext->type, pContext->apn);
+                }
+            }
+            return 0;
+        case AT_TEST:
+            respond("+CGDCONT: (1-%d),\"IP\",,,(0-2),(0-4)", MAX_CONTEXTS);
+            respond("+CGDCONT: (1-%d),\"IPV6\",,,(0-2),(0-4)", MAX_CONTEXTS);
+            respond("+CGDCONT: (1-%d),\"IPV4V6\",,,(0-2),(0-4)", MAX_CONTEXTS);
+            respond("+CGDCONT: (1-%d),\"PPP\",,,(0-2),(0-4)", MAX_CONTEXTS);
+            return 0;
+        case AT_SET:
+            if ((count < 1) || (context_id(ppArgs[0], &cid) != 0))
+            {
+                return CME_INCORRECT_PARAMETER;
+            }
+            pContext = &gModem.contexts[cid];
+            if (pContext->active)
+            {
+                return CME_NOT_ALLOWED;
+            }
+            if (count == 1)
+            {
+                memset(pContext, 0, sizeof(*pContext));
+                return 0;
+            }
+            if (((strcmp(ppArgs[1], "IP") != 0) && (strcmp(ppArgs[1], "IPV6") != 0) && (strcmp(ppArgs[1], "IPV4V6") != 0) &&
+                 (strcmp(ppArgs[1], "PPP") != 0)) || ((count >= 3) && (strlen(ppArgs[2]) >= sizeof(pContext->apn))))
+            {
+                return CME_INCORRECT_PARAMETER;
+            }
+            pContext->defined = 1;
+            snprintf(pContext->type, sizeof(pContext->type), "%s", ppArgs[1]);
+            snprintf(pContext->apn, sizeof(pContext->apn), "%s", (count >= 3) ? ppArgs[2] : "");
+            return 0;
+        default:
+            return AT_UNKNOWN;
+    }
+}
+
+static int handle_cgauth(AtKind_t kind, char **ppArgs, int count)
+{
+    AtContext_t *pContext;
+    int cid, auth;
+
+    switch (kind)
+    {
+        case AT_READ:
+            for (cid = 1; cid <= MAX_CONTEXTS; cid++)
+            {
+                pContext = &gModem.contexts[cid];
+                if (pContext->defined)
+                {
+                    respond("+CGAUTH: %d,%d,\"%s\"", cid, pContext->auth, pContext->user);
+                }
+            }
+            return 0;
+        case AT_TEST:
+            respond("+CGAUTH: (1-%d),(0-2),64,64", MAX_CONTEXTS);
+            return 0;
+        case AT_SET:
+            if ((count < 2) || (count > 4) || (context_id(ppArgs[0], &cid) != 0) || (arg_int(ppArgs[1], &auth) != 0) ||
+                (auth < 0) || (auth > 2) || ((count >= 3) && (strlen(ppArgs[2]) >= sizeof(pContext->user))) ||
+                ((count == 4) && (strlen(ppArgs[3]) >= sizeof(pContext->password))))
+            {
+                return CME_INCORRECT_PARAMETER;
+            }
+            pContext = &gModem.contexts[cid];
+            pContext->auth = auth;
+            snprintf(pContext->user, sizeof(pContext->user), "%s", (count >= 3) ? ppArgs[2] : "");
+            snprintf(pContext->password, sizeof(pContext->password), "%s", (count == 4) ? ppArgs[3] : "");
+            return 0;
+        default:
+            return AT_UNKNOWN;
+    }
+}
+
+static int handle_cgact(AtKind_t kind, char **ppArgs, int count)
+{
+    int state, cid, i;
+
+    switch (kind)
+    {
+        case AT_READ:
+            for (cid = 1; cid <= MAX_CONTEXTS; cid++)
+            {
+                if (gModem.contexts[cid].defined)
+                {
+                    respond("+CGACT: %d,%d", cid, gModem.contexts[cid].active);
+                }
+            }
+            return 0;
+        case AT_TEST:
+            respond("+CGACT: (0-1)");
+            return 0;
+        case AT_SET:
+            if ((count < 1) || (arg_int(ppArgs[0], &state) != 0) || (state < 0) || (state > 1))
+            {
+                return CME_INCORRECT_PARAMETER;
+            }
+            for (i = 1; i < count; i++)
+            {
+                if ((context_id(ppArgs[i], &cid) != 0) || !gModem.contexts[cid].defined)
+                {
+                    return CME_INCORRECT_PARAMETER;
+                }
+            }
+            if (state && !gModem.attached)
+            {
+                return CME_NO_NETWORK;
+            }
+            /* Without a cid the state applies to every defined context */
+            for (cid = 1; cid <= MAX_CONTEXTS; cid++)
+            {
+                for (i = 1; i < count; i++)
+                {
+                    if (atoi(ppArgs[i]) == cid)
+                    {
+                        break;
+                    }
+                }
+                if (gModem.contexts[cid].defined && ((count == 1) || (i < count)))
+                {
+                    gModem.contexts[cid].active = state;
+                }
+            }
+            return 0;
+        default:
+            return AT_UNKNOWN;
+    }
+}
+
+static void address(int cid)
+{
+    if (gModem.contexts[cid].active)
+    {
+        respond("+CGPADDR: %d,\"10.64.0.%d\"", cid, cid + 1);
+    }
+    else
+    {
+        respond("+CGPADDR: %d", cid);
+    }
+}
+
+static int handle_cgpaddr(AtKind_t kind, char **ppArgs, int count)
+{
+    int cid, i;
+
+    switch (kind)
+    {
+        case AT_EXEC:
+            for (cid = 1; cid <= MAX_CONTEXTS; cid++)
+            {
+                if (gModem.contexts[cid].defined)
+                {
+                    address(cid);
+                }
+            }
+            return 0;
+        case AT_TEST:
+            respond("+CGPADDR: (1-%d)", MAX_CONTEXTS);
+            return 0;
+        case AT_SET:
+            for (i = 0; i < count; i++)
+            {
+                if ((context_id(ppArgs[i], &cid) != 0) || !gModem.contexts[cid].defined)
+                {
+                    return CME_INCORRECT_PARAMETER;
+                }
+                address(cid);
+            }
+            return 0;
+        default:
+            return AT_UNKNOWN;
+    }
+}
+
+static const AtHandler_t gHandlers[] =
+{
+    { "+CGMI", handle_cgmi },
+    { "+CGMM", handle_cgmm },
+    { "+CGMR", handle_cgmr },
+    { "+CGSN", handle_cgsn },
+    { "+CIMI", handle_cimi },
+    { "+CCID", handle_ccid },
+    { "+CNUM", handle_cnum },
+    { "+CMEE", handle_cmee },
+    { "+CPIN", handle_cpin },
+    { "+CFUN", handle_cfun },
+    { "+CSQ", handle_csq },
+    { "+CESQ", handle_cesq },
+    { "+COPS", handle_cops },
+    { "+CREG", handle_creg },
+    { "+CEREG", handle_cereg },
+    { "+CGATT", handle_cgatt },
+    { "+WS46", handle_ws46 },
+    { "+CGDCONT", handle_cgdcont },
+    { "+CGAUTH", handle_cgauth },
+    { "+CGACT", handle_cgact },
+    { "+CGPADDR", handle_cgpaddr },
+};
+
+static void count_command(const char *pName, int error)
+{
+    unsigned int i;
+
+    pthread_mutex_lock(&gLock);
+    gStats.commands++;
+    gStats.errors += (error != 0);
+    for (i = 0; i < gCommandCount; i++)
+    {
+        if (strcmp(gCommands[i].name, pName) == 0)
+        {
+            break;
+        }
+    }
+    if ((i == gCommandCount) && (gCommandCount < CELLULAR_ATMODEM_MAX_COMMANDS))
+    {
+        snprintf(gCommands[i].name, sizeof(gCommands[i].name), "%s", pName);
+        gCommandCount++;
+    }
+    if (i < gCommandCount)
+    {
+        gCommands[i].count++;
+        gCommands[i].errors += (error != 0);
+    }
+    pthread_mutex_unlock(&gLock);
+}
+
+static int latency_of(const char *pCommand)
+{
+    size_t best = 0, length;
+    int ms;
+    unsigned int i;
+
+    pthread_mutex_lock(&gLock);
+    ms = gDefaultLatencyMs;
+    for (i = 0; i < gLatencyCount; i++)
+    {
+        length = strlen(gLatencies[i].prefix);
+        if ((length > best) && (strncasecmp(pCommand, gLatencies[i].prefix, length) == 0))
+        {
+            best = length;
+            ms = gLatencies[i].ms;
+        }
+    }
+    pthread_mutex_unlock(&gLock);
+    return ms;
+}
+
+/* One extended command, "+NAME", "+NAME?", "+NAME=?" or "+NAME=args" */
+static int extended_command(char *pCommand)
+{
+    char *ppArgs[MAX_ARGS];
+    char name[16];
+    size_t length = 1;
+    AtKind_t kind = AT_EXEC;
+    char *pRest;
+    unsigned int i;
+    int count = 0;
+    int error = AT_UNKNOWN;
+
+    while ((isalnum((unsigned char)pCommand[length])) && (length < sizeof(name) - 1))
+    {
+        length++;
+    }
+    for (i = 0; i < length; i++)
+    {
+        name[i] = (char)toupper((unsigned char)pCommand[i]);
+    }
+    name[length] = '\0';
+    pRest = &pCommand[length];
+    if (strcmp(pRest, "?") == 0)
+    {
+        kind = AT_READ;
+    }
+    else if (strcmp(pRest, "=?") == 0)
+    {
+        kind = AT_TEST;
+    }
+    else if (pRest[0] == '=')
+    {
+        kind = AT_SET;
+        count = split_args(&pRest[1], ppArgs, MAX_ARGS);
+    }
+    else if (pRest[0] != '\0')
+    {
+        count = -1;
+    }
+
+    for (i = 0; i < sizeof(gHandlers) / sizeof(gHandlers[0]); i++)
+    {
+        if (strcmp(gHandlers[i].pName, name) == 0)
+        {
+            error = (count < 0) ? CME_INCORRECT_PARAMETER : gHandlers[i].pFn(kind, ppArgs, count);
+            break;
+        }
+    }
+    count_command(name, error);
+    return error;
+}
+
+/* V.250 basic commands, which may follow each other without a separator: E0V1 */
+static int basic_commands(const char *pCommand)
+{
+    char name[3];
+    int value;
+
+    while (*pCommand != '\0')
+    {
+        name[0] = (char)toupper((unsigned char)*pCommand++);
+        name[1] = '\0';
+        if ((name[0] == '&') && (*pCommand != '\0'))
+        {
+            name[1] = (char)toupper((unsigned char)*pCommand++);
+            name[2] = '\0';
+        }
+        value = 0;
+        while (isdigit((unsigned char)*pCommand))
+        {
+            value = (value * 10) + (*pCommand++ - '0');
+        }
+        count_command(name, 0);
+        if (strcmp(name, "E") == 0)
+        {
+            gModem.echo = (value != 0);
+        }
+        else if ((strcmp(name, "Z") == 0) || (strcmp(name, "&F") == 0))
+        {
+            gModem.echo = 1;
+            gModem.cmee = 1;
+            gModem.cops_format = 0;
+            gModem.creg_n = 0;
+            gModem.cereg_n = 0;
+        }
+        else if (strcmp(name, "I") == 0)
+        {
+            respond("RDK ATMODEM");
+            respond("Revision: %s", CELLULAR_ATMODEM_FIRMWARE);
+        }
+        else if (((strcmp(name, "V") != 0) || (value != 1)) && ((strcmp(name, "Q") != 0) || (value != 0)))
+        {
+            /* Numeric and quiet result codes are not emulated */
+            return AT_UNKNOWN;
+        }
+    }
+    return 0;
+}
+
+static void process_line(char *pLine, size_t length, uint64_t received_ns)
+{
+    char *pCommand;
+    char *pNext;
+    int quoted = 0;
+    int error = 0;
+
+    if (gModem.echo)
+    {
+        pLine[length] = '\r';
+        send_paced(pLine, length + 1);
+    }
+    pLine[length] = '\0';
+    /* The command is only complete once its last byte and the CR have crossed the line */
+    sleep_until(received_ns + wire_ns(length + 1));
+
+    while (*pLine == ' ')
+    {
+        pLine++;
+    }
+    if ((strncasecmp(pLine, "AT", 2) != 0))
+    {
+        return;
+    }
+    gResponseUsed = 0;
+    pCommand = pLine + 2;
+    if (*pCommand == '\0')
+    {
+        wait_ms(latency_of(""));
+        count_command("AT", 0);
+    }
+    while ((*pCommand != '\0') && (error == 0))
+    {
+        for (pNext = pCommand; (*pNext != '\0') && ((*pNext != ';') || quoted); pNext++)
+        {
+            quoted ^= (*pNext == '"');
+        }
+        if (*pNext == ';')
+        {
+            *pNext++ = '\0';
+        }
+        wait_ms(latency_of(pCommand));
+        if (gStop)
+        {
+            return;
+        }
+        error = (pCommand[0] == '+') ? extended_command(pCommand) : basic_commands(pCommand);
+        pCommand = pNext;
+    }
+    final_result(error);
+    send_paced(gResponse, gResponseUsed);
+}
+
+static void *atmodem_thread(void *pArg)
+{
+    char line[LINE_LENGTH + 1];
+    char chunk[256];
+    struct pollfd fds[2];
+    size_t used = 0;
+    int overflow = 0;
+    uint64_t received;
+    ssize_t got, i;
+
+    (void)pArg;
+    prctl(PR_SET_NAME, "cellular_atmdm", 0, 0, 0);
+    cellular_run_background_thread();
+    while (!gStop)
+    {
+        fds[0].fd = gMasterFd;
+        fds[0].events = POLLIN;
+        fds[1].fd = gStopFd;
+        fds[1].events = POLLIN;
+        if (poll(fds, 2, -1) < 0)
+        {
+            continue;
+        }
+        if (fds[1].revents != 0)
+        {
+            break;
+        }
+        got = read(gMasterFd, chunk, sizeof(chunk));
+        if (got <= 0)
+        {
+            continue;
+        }
+        received = now_ns();
+        gStats.bytes_in += (uint64_t)got;
+        for (i = 0; i < got; i++)
+        {
+            if ((chunk[i] == '\r') || (chunk[i] == '\n'))
+            {
+                if ((used > 0) && !overflow)
+                {
+                    process_line(line, used, received);
+                }
+                used = 0;
+                overflow = 0;
+            }
+            else if (used < LINE_LENGTH)
+            {
+                line[used++] = chunk[i];
+            }
+            else
+            {
+                /* A line longer than the modem's buffer is dropped whole */
+                overflow = 1;
+            }
+        }
+    }
+    return NULL;
+}
+
+/* Commands counted and the byte totals */
+static void collect_metrics(FILE *pOut)
+{
+    unsigned int i;
+    char count[24];
+
+    cellular_metrics_family(pOut, "cellular_atmodem_commands", CELLULAR_METRIC_COUNTER, "AT commands answered by the emulator");
+    pthread_mutex_lock(&gLock);
+    for (i = 0; i < gCommandCount; i++)
+    {
+        cellular_metrics_sample(pOut, "cellular_atmodem_commands_total", (double)(gCommands[i].count - gCommands[i].errors),
+                                "command", gCommands[i].name, "result", "ok", NULL);
+        cellular_metrics_sample(pOut, "cellular_atmodem_commands_total", (double)gCommands[i].errors,
+                                "command", gCommands[i].name, "result", "error", NULL);
+    }
+    pthread_mutex_unlock(&gLock);
+    cellular_metrics_family(pOut, "cellular_atmodem_bytes", CELLULAR_METRIC_COUNTER, "Bytes over the emulated serial line");
+    snprintf(count, sizeof(count), "%u", gStats.baud);
+    cellular_metrics_sample(pOut, "cellular_atmodem_bytes_total", (double)gStats.bytes_in, "direction", "in", "baud", count, NULL);
+    cellular_metrics_sample(pOut, "cellular_atmodem_bytes_total", (double)gStats.bytes_out, "direction", "out", "baud", count, NULL);
+    cellular_metrics_sample(pOut, "cellular_atmodem_bytes_total", (double)gStats.bytes_dropped, "direction", "dropped", "baud", count, NULL);
+}
+
+int cellular_atmodem_start(unsigned int baud, unsigned int latency_ms)
+{
+    struct termios tio;
+    int flags;
+
+    if (gStarted)
+    {
+        return RETURN_OK;
+    }
+    gMasterFd = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if ((gMasterFd < 0) || (grantpt(gMasterFd) != 0) || (unlockpt(gMasterFd) != 0) ||
+        (ptsname_r(gMasterFd, gPath, sizeof(gPath)) != 0))
+    {
+        UT_LOG_ERROR("AT modem: cannot open a pty: %s", strerror(errno));
+        cellular_atmodem_stop();
+        return RETURN_ERROR;
+    }
+    /* Holding the slave open keeps the master readable while the HAL reopens it, and sets the line raw for HALs which do not */
+    gSlaveFd = open(gPath, O_RDWR | O_NOCTTY | O_CLOEXEC);
+    gStopFd = eventfd(0, EFD_CLOEXEC);
+    if ((gSlaveFd < 0) || (gStopFd < 0) || (tcgetattr(gSlaveFd, &tio) != 0))
+    {
+        UT_LOG_ERROR("AT modem: cannot set up %s: %s", gPath, strerror(errno));
+        cellular_atmodem_stop();
+        return RETURN_ERROR;
+    }
+    cfmakeraw(&tio);
+    tcsetattr(gSlaveFd, TCSANOW, &tio);
+    flags = fcntl(gMasterFd, F_GETFL);
+    fcntl(gMasterFd, F_SETFL, flags | O_NONBLOCK);
+
+    default_state();
+    memset(&gStats, 0, sizeof(gStats));
+    gStats.baud = baud;
+    gCommandCount = 0;
+    gDefaultLatencyMs = (int)latency_ms;
+    gStop = 0;
+    if (pthread_create(&gThread, NULL, atmodem_thread, NULL) != 0)
+    {
+        UT_LOG_ERROR("AT modem: cannot start the thread");
+        cellular_atmodem_stop();
+        return RETURN_ERROR;
+    }
+    gStarted = 1;
+    cellular_metrics_add_collector(collect_metrics);
+    UT_LOG_INFO("AT modem: answering on %s at %u baud, %u ms per command", gPath, baud, latency_ms);
+    return RETURN_OK;
+}
+
+const char *cellular_atmodem_path(void)
+{
+    return gStarted ? gPath : NULL;
+}
+
+int cellular_atmodem_link(const char *pLink)
+{
+    struct stat st;
+
+    if (!gStarted || (pLink == NULL))
+    {
+        return RETURN_ERROR;
+    }
+    if ((lstat(pLink, &st) == 0) && (!S_ISLNK(st.st_mode) || (unlink(pLink) != 0)))
+    {
+        UT_LOG_ERROR("AT modem: %s exists and is not a replaceable symlink", pLink);
+        return RETURN_ERROR;
+    }
+    if (symlink(gPath, pLink) != 0)
+    {
+        UT_LOG_ERROR("AT modem: cannot link %s: %s", pLink, strerror(errno));
+        return RETURN_ERROR;
+    }
+    return RETURN_OK;
+}
+
+int cellular_atmodem_set_latency(const char *pCommand, int ms)
+{
+    unsigned int i;
+    int result = RETURN_OK;
+
+    pthread_mutex_lock(&gLock);
+    if (pCommand == NULL)
+    {
+        gDefaultLatencyMs = (ms > 0) ? ms : 0;
+        pthread_mutex_unlock(&gLock);
+        return RETURN_OK;
+    }
+    for (i = 0; i < gLatencyCount; i++)
+    {
+        if (strcasecmp(gLatencies[i].prefix, pCommand) == 0)
+        {
+            break;
+        }
+    }
+    if (ms < 0)
+    {
+        if (i < gLatencyCount)
+        {
+            gLatencies[i] = gLatencies[--gLatencyCount];
+        }
+    }
+    else if ((i < gLatencyCount) || (gLatencyCount < CELLULAR_ATMODEM_MAX_LATENCIES))
+    {
+        snprintf(gLatencies[i].prefix, sizeof(gLatencies[i].prefix), "%s", pCommand);
+        gLatencies[i].ms = ms;
+        gLatencyCount += (i == gLatencyCount);
+    }
+    else
+    {
+        result = RETURN_ERROR;
+    }
+    pthread_mutex_unlock(&gLock);
+    return result;
+}
+
+int cellular_atmodem_set_latencies(const char *pList)
+{
+    char copy[1024];
+    char *pSave = NULL;
+    char *pEntry;
+    char *pValue;
+    char *pEnd;
+    long ms;
+    int result = RETURN_OK;
+
+    if (pList == NULL)
+    {
+        return RETURN_ERROR;
+    }
+    snprintf(copy, sizeof(copy), "%s", pList);
+    for (pEntry = strtok_r(copy, ",", &pSave); pEntry != NULL; pEntry = strtok_r(NULL, ",", &pSave))
+    {
+        pValue = strrchr(pEntry, ':');
+        pValue = (pValue != NULL) ? pValue + 1 : pEntry;
+        ms = strtol(pValue, &pEnd, 10);
+        if ((*pEnd != '\0') || (pEnd == pValue) || (ms < 0) || (pValue == pEntry + 1))
+        {
+            UT_LOG_ERROR("AT modem: invalid latency [%s]", pEntry);
+            result = RETURN_ERROR;
+            continue;
+        }
+        if (pValue != pEntry)
+        {
+            pValue[-1] = '\0';
+        }
+        if (cellular_atmodem_set_latency((pValue != pEntry) ? pEntry : NULL, (int)ms) != RETURN_OK)
+        {
+            result = RETURN_ERROR;
+        }
+    }
+    return result;
+}
+
+int cellular_atmodem_get_stats(CellularAtmodemStats_t *pStats)
+{
+    if (pStats == NULL)
+    {
+        return RETURN_ERROR;
+    }
+    pthread_mutex_lock(&gLock);
+    *pStats = gStats;
+    pthread_mutex_unlock(&gLock);
+    return RETURN_OK;
+}
+
+void cellular_atmodem_stop(void)
+{
+    uint64_t one = 1;
+
+    if (gStarted)
+    {
+        gStop = 1;
+        if (write(gStopFd, &one, sizeof(one)) != (ssize_t)sizeof(one))
+        {
+            UT_LOG_WARNING("AT modem: stop signal failed");
+        }
+        pthread_join(gThread, NULL);
+        gStarted = 0;
+    }
+    if (gMasterFd >= 0)
+    {
+        close(gMasterFd);
+    }
+    if (gSlaveFd >= 0)
+    {
+        close(gSlaveFd);
+    }
+    if (gStopFd >= 0)
+    {
+        close(gStopFd);
+    }
+    gMasterFd = -1;
+    gSlaveFd = -1;
+    gStopFd = -1;
+}
+
+void cellular_atmodem_report(void)
+{
+    unsigned int i;
+
+    if (gCommandCount == 0)
+    {
+        return;
+    }
+    pthread_mutex_lock(&gLock);
+    UT_LOG_INFO("AT modem: %llu commands, %llu errors, %llu bytes in, %llu out, %llu dropped at %u baud",
+                (unsigned long long)gStats.commands, (unsigned long long)gStats.errors, (unsigned long long)gStats.bytes_in,
+                (unsigned long long)gStats.bytes_out, (unsigned long long)gStats.bytes_dropped, gStats.baud);
+    UT_LOG_INFO("| %-12s | %9s | %9s |", "Command", "count", "errors");
+    for (i = 0; i < gCommandCount; i++)
+    {
+        UT_LOG_INFO("| %-12s | %9llu | %9llu |", gCommands[i].name, (unsigned long long)gCommands[i].count,
+                    (unsigned long long)gCommands[i].errors);
+    }
+    pthread_mutex_unlock(&gLock);
+}
@@ -0,0 +1,85 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:*
+ * Copyright 2023 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file cellular_bench.c
+ * @brief Timing helpers shared by the cellular HAL benchmark tests
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <time.h>
+#include "cellular_bench.h"
+
+static uint64_t clock_ns(clockid_t clock)
+{
+    struct timespec ts;
+
+    if (clock_gettime(clock, &ts) != 0)
+    {
+        return 0;
+    }
+    return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+uint64_t cellular_bench_now_ns(void)
+{
+    return clock_ns(CLOCK_MONOTONIC);
+}
+
+uint64_t cellular_bench_process_cpu_ns(void)
+{
+    return clock_ns(CLOCK_PROCESS_CPUTIME_ID);
+}
+
+uint64_t cellular_bench_thread_cpu_ns(void)
+{
+    return clock_ns(CLOCK_THREAD_CPUTIME_ID);
+}
+
+void cellular_bench_sleep_ms(unsigned int ms)
+{
+    struct timespec req;
+
+    req.tv_sec = ms / 1000;
+    req.tv_nsec = (long)(ms % 1000) * 1000000L;
+    while ((nanosleep(&req, &req) != 0) && (errno == EINTR))
+    {
+    }
+}
+
+static int compare_u64(const void *pA, const void *pB)
+{
+    uint64_t a = *(const uint64_t *)pA;
+    uint64_t b = *(const uint64_t *)pB;
+
+    return (a > b) - (a < b);
+}
+
+uint64_t cellular_bench_percentile(uint64_t *pSamples, unsigned int count, unsigned int percentile)
+{
+    unsigned int rank;
+
+    if ((pSamples == NULL) || (count == 0))
+    {
+        return 0;
+    }
+    qsort(pSamples, count, sizeof(pSamples[0]), compare_u64);
+    rank = (unsigned int)(((uint64_t)count * ((percentile > 100) ? 100 : percentile) + 99) / 100);
+    return pSamples[(rank > 0) ? rank - 1 : 0];
+}
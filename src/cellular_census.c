@@ -0,0 +1,503 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:*
+ * Copyright 2023 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file cellular_census.c
+ * @brief Thread and file descriptor census around every test and HAL call
+ *
+ * /proc is read through stdio and readdir so the listings do not show up in the system
+ * call profile of the scope being observed.
+ */
+
+#include <dirent.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <ut_log.h>
+#include "cellular_census.h"
+#include "cellular_metrics.h"
+
+#define MAX_TASKS 256
+#define MAX_FDS   1024
+
+typedef struct
+{
+    int fd;
+    uint32_t key;    /* Hash of the link target, so a reused number counts as a new descriptor */
+} CensusFd_t;
+
+typedef struct
+{
+    unsigned int taskCount;
+    int tids[MAX_TASKS];
+    unsigned int fdCount;
+    CensusFd_t fds[MAX_FDS];
+} CensusSnapshot_t;
+
+typedef struct
+{
+    const char *pTitle;
+    CellularCensusStats_t stats;
+} CensusTest_t;
+
+static pthread_mutex_t gLock = PTHREAD_MUTEX_INITIALIZER;
+static int gStarted = 0;    /* Starts not yet stopped */
+static CellularCensusStats_t gApis[CELLULAR_HAL_API_COUNT];
+static CensusTest_t gTests[CELLULAR_TRACE_MAX_TESTS];
+static unsigned int gTestCount = 0;
+static CellularCensusThread_t gThreads[CELLULAR_CENSUS_MAX_THREADS];
+static unsigned int gThreadCount = 0;
+
+static __thread CensusSnapshot_t tTestBefore;
+static __thread CensusSnapshot_t tCallBefore;
+static __thread CensusSnapshot_t tAfter;
+
+static int compare_int(const void *pA, const void *pB)
+{
+    int a = *(const int *)pA, b = *(const int *)pB;
+
+    return (a > b) - (a < b);
+}
+
+static int compare_fd(const void *pA, const void *pB)
+{
+    return compare_int(&((const CensusFd_t *)pA)->fd, &((const CensusFd_t *)pB)->fd);
+}
+
+static uint32_t hash_string(const char *pString)
+{
+    uint32_t hash = 2166136261u;
+
+    while (*pString != '\0')
+    {
+        hash = (hash ^ (unsigned char)*pString++) * 16777619u;
+    }
+    return hash;
+}
+
+static int take_snapshot(CensusSnapshot_t *pSnapshot)
+{
+    struct dirent *pEntry;
+    char path[64];
+    char target[256];
+    ssize_t length;
+    DIR *pDir;
+    int fd;
+
+    pSnapshot->taskCount = 0;
+    pSnapshot->fdCount = 0;
+    pDir = opendir("/proc/self/task");
+    if (pDir == NULL)
+    {
+        return RETURN_ERROR;
+    }
+    while (((pEntry = readdir(pDir)) != NULL) && (pSnapshot->taskCount < MAX_TASKS))
+    {
+        if (pEntry->d_name[0] != '.')
+        {
+            pSnapshot->tids[pSnapshot->taskCount++] = atoi(pEntry->d_name);
+        }
+    }
+    closedir(pDir);
+
+    pDir = opendir("/proc/self/fd");
+    if (pDir == NULL)
+    {
+        return RETURN_ERROR;
+    }
+    while (((pEntry = readdir(pDir)) != NULL) && (pSnapshot->fdCount < MAX_FDS))
+    {
+        fd = atoi(pEntry->d_name);
+        if ((pEntry->d_name[0] == '.') || (fd == dirfd(pDir)))
+        {
+            continue;
+        }
+        snprintf(path, sizeof(path), "/proc/self/fd/%d", fd);
+        length = readlink(path, target, sizeof(target) - 1);
+        target[(length > 0) ? length : 0] = '\0';
+        if (strcmp(target, "anon_inode:[perf_event]") == 0)
+        {
+            /* Counter groups of the performance probe */
+            continue;
+        }
+        pSnapshot->fds[pSnapshot->fdCount].fd = fd;
+        pSnapshot->fds[pSnapshot->fdCount++].key = hash_string(target);
+    }
+    closedir(pDir);
+
+    qsort(pSnapshot->tids, pSnapshot->taskCount, sizeof(int), compare_int);
+    qsort(pSnapshot->fds, pSnapshot->fdCount, sizeof(CensusFd_t), compare_fd);
+    return RETURN_OK;
+}
+
+/* Adds the differences between two sorted snapshots to pStats */
+static void diff_snapshots(const CensusSnapshot_t *pBefore, const CensusSnapshot_t *pAfter, CellularCensusStats_t *pStats)
+{
+    unsigned int b = 0, a = 0;
+
+    while ((b < pBefore->taskCount) || (a < pAfter->taskCount))
+    {
+        if ((a == pAfter->taskCount) || ((b < pBefore->taskCount) && (pBefore->tids[b] < pAfter->tids[a])))
+        {
+            pStats->threads_exited++;
+            b++;
+        }
+        else if ((b == pBefore->taskCount) || (pAfter->tids[a] < pBefore->tids[b]))
+        {
+            pStats->threads_created++;
+            a++;
+        }
+        else
+        {
+            a++;
+            b++;
+        }
+    }
+
+    b = 0;
+    a = 0;
+    while ((b < pBefore->fdCount) || (a < pAfter->fdCount))
+    {
+        if ((a == pAfter->fdCount) || ((b < pBefore->fdCount) && (pBefore->fds[b].fd < pAfter->fds[a].fd)))
+        {
+            pStats->fds_closed++;
+            b++;
+        }
+        else if ((b == pBefore->fdCount) || (pAfter->fds[a].fd < pBefore->fds[b].fd))
+        {
+            pStats->fds_opened++;
+            a++;
+        }
+        else
+        {
+            if (pBefore->fds[b].key != pAfter->fds[a].key)
+            {
+                pStats->fds_closed++;
+                pStats->fds_opened++;
+            }
+            a++;
+            b++;
+        }
+    }
+    pStats->calls++;
+}
+
+static void read_thread(CellularCensusThread_t *pThread)
+{
+    unsigned long long utime = 0, stime = 0;
+    char path[64];
+    char line[512];
+    char *pEnd;
+    FILE *pFile;
+
+    snprintf(path, sizeof(path), "/proc/self/task/%d/comm", pThread->tid);
+    pFile = fopen(path, "r");
+    if (pFile != NULL)
+    {
+        if (fgets(pThread->name, sizeof(pThread->name), pFile) != NULL)
+        {
+            pThread->name[strcspn(pThread->name, "\n")] = '\0';
+        }
+        fclose(pFile);
+    }
+
+    snprintf(path, sizeof(path), "/proc/self/task/%d/stat", pThread->tid);
+    pFile = fopen(path, "r");
+    if (pFile == NULL)
+    {
+        return;
+    }
+    /* The name may contain spaces, fields are counted from the closing parenthesis */
+    if ((fgets(line, sizeof(line), pFile) != NULL) && ((pEnd = strrchr(line, ')')) != NULL) &&
+        (sscanf(pEnd + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu", &utime, &stime) == 2))
+    {
+        pThread->cpu_ns = (utime + stime) * (1000000000ull / (unsigned long long)sysconf(_SC_CLK_TCK));
+    }
+    fclose(pFile);
+}
+
+/* Follows the threads of a new snapshot; new ones are attributed to pOwner. gLock must be held */
+static void update_threads(const CensusSnapshot_t *pSnapshot, const char *pOwner)
+{
+    unsigned int i, t;
+
+    for (t = 0; t < gThreadCount; t++)
+    {
+        if (gThreads[t].alive && (bsearch(&gThreads[t].tid, pSnapshot->tids, pSnapshot->taskCount, sizeof(int), compare_int) == NULL))
+        {
+            gThreads[t].alive = 0;
+        }
+    }
+    for (i = 0; i < pSnapshot->taskCount; i++)
+    {
+        for (t = 0; t < gThreadCount; t++)
+        {
+            if (gThreads[t].alive && (gThreads[t].tid == pSnapshot->tids[i]))
+            {
+                break;
+            }
+        }
+        if ((t == gThreadCount) && (gThreadCount < CELLULAR_CENSUS_MAX_THREADS))
+        {
+            memset(&gThreads[t], 0, sizeof(gThreads[t]));
+            gThreads[t].tid = pSnapshot->tids[i];
+            gThreads[t].pCreatedBy = pOwner;
+            gThreads[t].alive = 1;
+            gThreadCount++;
+        }
+        if (t < gThreadCount)
+        {
+            read_thread(&gThreads[t]);
+        }
+    }
+}
+
+static void probe_test_begin(const char *pTitle)
+{
+    (void)pTitle;
+    take_snapshot(&tTestBefore);
+}
+
+static void probe_test_end(const char *pTitle)
+{
+    unsigned int i = 0;
+
+    take_snapshot(&tAfter);
+    pthread_mutex_lock(&gLock);
+    while ((i < gTestCount) && (gTests[i].pTitle != pTitle))
+    {
+        i++;
+    }
+    if (i < CELLULAR_TRACE_MAX_TESTS)
+    {
+        if (i == gTestCount)
+        {
+            gTests[gTestCount++].pTitle = pTitle;
+        }
+        diff_snapshots(&tTestBefore, &tAfter, &gTests[i].stats);
+    }
+    update_threads(&tAfter, pTitle);
+    pthread_mutex_unlock(&gLock);
+}
+
+static void probe_call_begin(CellularHalApi_t api)
+{
+    (void)api;
+    take_snapshot(&tCallBefore);
+}
+
+static void probe_call_end(CellularHalApi_t api)
+{
+    take_snapshot(&tAfter);
+    pthread_mutex_lock(&gLock);
+    diff_snapshots(&tCallBefore, &tAfter, &gApis[api]);
+    update_threads(&tAfter, cellular_trace_api_name(api));
+    pthread_mutex_unlock(&gLock);
+}
+
+static uint64_t census_change(const CellularCensusStats_t *pStats, unsigned int change)
+{
+    switch (change)
+    {
+        case 0:
+            return pStats->threads_created;
+        case 1:
+            return pStats->threads_exited;
+        case 2:
+            return pStats->fds_opened;
+        default:
+            return pStats->fds_closed;
+    }
+}
+
+/* Counter families cellular_hal_<change> by api and cellular_test_<change> by test */
+static void collect_metrics(FILE *pOut)
+{
+    static const char *names[4] = { "threads_created", "threads_exited", "fds_opened", "fds_closed" };
+    static const char *helps[4] = { "Threads created", "Threads exited", "File descriptors opened", "File descriptors closed" };
+    char name[64];
+    char sample[72];
+    char help[96];
+    unsigned int c, i;
+
+    if (gStarted == 0)
+    {
+        return;
+    }
+    pthread_mutex_lock(&gLock);
+    for (c = 0; c < 4; c++)
+    {
+        snprintf(name, sizeof(name), "cellular_hal_%s", names[c]);
+        snprintf(sample, sizeof(sample), "%s_total", name);
+        snprintf(help, sizeof(help), "%s during cellular_hal calls", helps[c]);
+        cellular_metrics_family(pOut, name, CELLULAR_METRIC_COUNTER, help);
+        for (i = 0; i < CELLULAR_HAL_API_COUNT; i++)
+        {
+            if (gApis[i].calls > 0)
+            {
+                cellular_metrics_sample(pOut, sample, (double)census_change(&gApis[i], c),
+                                        "api", cellular_trace_api_name((CellularHalApi_t)i), NULL);
+            }
+        }
+        snprintf(name, sizeof(name), "cellular_test_%s", names[c]);
+        snprintf(sample, sizeof(sample), "%s_total", name);
+        snprintf(help, sizeof(help), "%s during the tests", helps[c]);
+        cellular_metrics_family(pOut, name, CELLULAR_METRIC_COUNTER, help);
+        for (i = 0; i < gTestCount; i++)
+        {
+            cellular_metrics_sample(pOut, sample, (double)census_change(&gTests[i].stats, c), "test", gTests[i].pTitle, NULL);
+        }
+    }
+    pthread_mutex_unlock(&gLock);
+}
+
+static const CellularTraceProbe_t gProbe =
+{
+    probe_test_begin, probe_test_end, probe_call_begin, probe_call_end
+};
+
+int cellular_census_start(void)
+{
+    if (gStarted > 0)
+    {
+        gStarted++;
+        return RETURN_OK;
+    }
+    if ((take_snapshot(&tAfter) != RETURN_OK) || (cellular_trace_add_probe(&gProbe) != RETURN_OK))
+    {
+        return RETURN_ERROR;
+    }
+    pthread_mutex_lock(&gLock);
+    update_threads(&tAfter, NULL);
+    pthread_mutex_unlock(&gLock);
+    gStarted = 1;
+    cellular_metrics_add_collector(collect_metrics);
+    return RETURN_OK;
+}
+
+void cellular_census_stop(void)
+{
+    if ((gStarted == 0) || (--gStarted > 0))
+    {
+        return;
+    }
+    cellular_trace_remove_probe(&gProbe);
+    pthread_mutex_lock(&gLock);
+    memset(gApis, 0, sizeof(gApis));
+    memset(gTests, 0, sizeof(gTests));
+    gTestCount = 0;
+    gThreadCount = 0;
+    pthread_mutex_unlock(&gLock);
+}
+
+int cellular_census_count(unsigned int *pThreads, unsigned int *pFds)
+{
+    if ((pThreads == NULL) || (pFds == NULL) || (take_snapshot(&tAfter) != RETURN_OK))
+    {
+        return RETURN_ERROR;
+    }
+    *pThreads = tAfter.taskCount;
+    *pFds = tAfter.fdCount;
+    return RETURN_OK;
+}
+
+int cellular_census_get_api(CellularHalApi_t api, CellularCensusStats_t *pStats)
+{
+    if (((unsigned int)api >= CELLULAR_HAL_API_COUNT) || (pStats == NULL))
+    {
+        return RETURN_ERROR;
+    }
+    pthread_mutex_lock(&gLock);
+    *pStats = gApis[api];
+    pthread_mutex_unlock(&gLock);
+    return RETURN_OK;
+}
+
+unsigned int cellular_census_get_threads(CellularCensusThread_t *pThreads, unsigned int max)
+{
+    unsigned int count;
+
+    if (pThreads == NULL)
+    {
+        return 0;
+    }
+    pthread_mutex_lock(&gLock);
+    count = (gThreadCount < max) ? gThreadCount : max;
+    memcpy(pThreads, gThreads, count * sizeof(CellularCensusThread_t));
+    pthread_mutex_unlock(&gLock);
+    return count;
+}
+
+static void log_row(const char *pName, const CellularCensusStats_t *pStats)
+{
+    UT_LOG_INFO("| %-52s | %6llu | %7llu | %6llu | %6llu | %6llu |", pName, (unsigned long long)pStats->calls,
+                (unsigned long long)pStats->threads_created, (unsigned long long)pStats->threads_exited,
+                (unsigned long long)pStats->fds_opened, (unsigned long long)pStats->fds_closed);
+}
+
+void cellular_census_report(void)
+{
+    const CellularCensusStats_t *pStats;
+    const CellularCensusThread_t *pThread;
+    unsigned int i;
+
+    if (!gStarted)
+    {
+        return;
+    }
+    /* A last listing refreshes the CPU time of the threads still running */
+    take_snapshot(&tAfter);
+    pthread_mutex_lock(&gLock);
+    update_threads(&tAfter, "(between scopes)");
+
+    UT_LOG_INFO("| %-52s | %6s | %7s | %6s | %6s | %6s |", "Test", "runs", "threads", "exited", "fds", "closed");
+    for (i = 0; i < gTestCount; i++)
+    {
+        log_row(gTests[i].pTitle, &gTests[i].stats);
+    }
+    UT_LOG_INFO("| %-52s | %6s | %7s | %6s | %6s | %6s |", "HAL API", "calls", "threads", "exited", "fds", "closed");
+    for (i = 0; i < CELLULAR_HAL_API_COUNT; i++)
+    {
+        if (gApis[i].calls > 0)
+        {
+            log_row(cellular_trace_api_name((CellularHalApi_t)i), &gApis[i]);
+        }
+    }
+    UT_LOG_INFO("| %7s | %-15s | %-52s | %9s | %-7s |", "TID", "Name", "Created by", "CPU ms", "State");
+    for (i = 0; i < gThreadCount; i++)
+    {
+        pThread = &gThreads[i];
+        UT_LOG_INFO("| %7d | %-15s | %-52s | %9.1f | %-7s |", pThread->tid, pThread->name,
+                    (pThread->pCreatedBy != NULL) ? pThread->pCreatedBy : "(before tests)",
+                    (double)pThread->cpu_ns / 1000000.0, pThread->alive ? "running" : "exited");
+    }
+
+    for (i = 0; i < gTestCount; i++)
+    {
+        pStats = &gTests[i].stats;
+        if ((pStats->threads_created > pStats->threads_exited) || (pStats->fds_opened > pStats->fds_closed))
+        {
+            UT_LOG_WARNING("%s left %lld threads and %lld descriptors behind", gTests[i].pTitle,
+                           (long long)pStats->threads_created - (long long)pStats->threads_exited,
+                           (long long)pStats->fds_opened - (long long)pStats->fds_closed);
+        }
+    }
+    pthread_mutex_unlock(&gLock);
+}
@@ -0,0 +1,930 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:*
+ * Copyright 2023 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file cellular_ctlmodem.c
+ * @brief Binary control-protocol modem emulator on a Unix socket
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <ut_log.h>
+#include "cellular_ctlmodem.h"
+#include "cellular_ctl_protocol.h"
+#include "cellular_hal.h"
+#include "cellular_metrics.h"
+#include "cellular_run.h"
+
+#define MAX_CONTEXTS        16
+#define MAX_INDICATIONS     (MAX_CONTEXTS + 2)
+#define INDICATION_SIZE     64
+
+#define CTLMODEM_IMEI_SV "352099001761401"
+#define CTLMODEM_ICCID   "8901260000000000001"
+#define CTLMODEM_MSISDN  "15550100000"
+
+typedef struct
+{
+    int defined;
+    uint8_t pdp_type;
+    uint8_t auth;
+    char apn[100];
+    char user[64];
+    char password[64];
+    int active;
+} CtlContext_t;
+
+typedef struct
+{
+    uint8_t mode;
+    int attached;
+    uint8_t rats;
+    CtlContext_t contexts[MAX_CONTEXTS + 1];    /*!< Indexed by cid, 0 unused */
+} CtlModem_t;
+
+typedef struct
+{
+    int client;                  /*!< Index in gClients, -1 for a free entry */
+    uint64_t due_ns;
+    size_t size;
+    uint8_t frame[CELLULAR_CTL_MAX_FRAME];
+} CtlPending_t;
+
+typedef struct
+{
+    uint64_t requests;
+    uint64_t errors;
+} CtlMessageCount_t;
+
+/* Response under construction, the result TLV first */
+typedef struct
+{
+    uint8_t frame[CELLULAR_CTL_MAX_FRAME];
+    size_t used;
+} CtlResponse_t;
+
+static pthread_mutex_t gLock = PTHREAD_MUTEX_INITIALIZER;
+static CtlModem_t gModem;
+static int gDefaultLatencyMs = 0;
+static int gLatencyMs[CELLULAR_CTL_MESSAGE_COUNT];   /*!< -1 for the default */
+static CtlMessageCount_t gCounts[CELLULAR_CTL_MESSAGE_COUNT + 1];   /*!< The last entry counts unknown messages */
+static CellularCtlmodemStats_t gStats;
+
+/* Indications raised by the request being answered, sent ahead of its response */
+static uint8_t gIndications[MAX_INDICATIONS][INDICATION_SIZE];
+static size_t gIndicationSizes[MAX_INDICATIONS];
+static unsigned int gIndicationCount = 0;
+
+static CtlPending_t gPending[CELLULAR_CTLMODEM_MAX_PENDING];
+static int gClients[CELLULAR_CTLMODEM_MAX_CLIENTS];
+static int gStarted = 0;
+static volatile int gStop = 0;
+static int gListenFd = -1;
+static int gStopFd = -1;
+static pthread_t gThread;
+static char gPath[sizeof(((struct sockaddr_un *)0)->sun_path)];
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000ull) + (uint64_t)ts.tv_nsec;
+}
+
+static void default_state(void)
+{
+    memset(&gModem, 0, sizeof(gModem));
+    gModem.mode = CELLULAR_CTL_MODE_ONLINE;
+    gModem.attached = 1;
+    gModem.rats = CELLULAR_CTL_RAT_GSM | CELLULAR_CTL_RAT_UMTS | CELLULAR_CTL_RAT_LTE;
+    gModem.contexts[1].defined = 1;
+    gModem.contexts[1].pdp_type = 2;
+    snprintf(gModem.contexts[1].apn, sizeof(gModem.contexts[1].apn), "internet");
+}
+
+static int registered(void)
+{
+    return ((gModem.mode == CELLULAR_CTL_MODE_ONLINE) && gModem.attached) ? 1 : 0;
+}
+
+static void send_frame(int client, const uint8_t *pFrame, size_t size)
+{
+    if ((gClients[client] < 0) || (send(gClients[client], pFrame, size, MSG_DONTWAIT | MSG_NOSIGNAL) != (ssize_t)size))
+    {
+        gStats.dropped++;
+    }
+}
+
+static void indicate(uint8_t *pFrame, size_t used)
+{
+    if (gIndicationCount < MAX_INDICATIONS)
+    {
+        gIndicationSizes[gIndicationCount] = cellular_ctl_end(pFrame, used);
+        memcpy(gIndications[gIndicationCount++], pFrame, used);
+    }
+}
+
+static void flush_indications(void)
+{
+    unsigned int i, client;
+
+    for (i = 0; i < gIndicationCount; i++)
+    {
+        for (client = 0; client < CELLULAR_CTLMODEM_MAX_CLIENTS; client++)
+        {
+            if (gClients[client] >= 0)
+            {
+                send_frame((int)client, gIndications[i], gIndicationSizes[i]);
+                gStats.indications++;
+            }
+        }
+    }
+    gIndicationCount = 0;
+}
+
+/* Technology in use, the fastest of the preference with LTE before NR as the modem anchors on it */
+static uint8_t serving_rat(void)
+{
+    if (gModem.rats & CELLULAR_CTL_RAT_LTE)
+    {
+        return CELLULAR_CTL_RAT_LTE;
+    }
+    if (gModem.rats & CELLULAR_CTL_RAT_NR)
+    {
+        return CELLULAR_CTL_RAT_NR;
+    }
+    return (gModem.rats & CELLULAR_CTL_RAT_UMTS) ? CELLULAR_CTL_RAT_UMTS : CELLULAR_CTL_RAT_GSM;
+}
+
+static void serving_value(uint8_t *pValue)
+{
+    pValue[0] = (uint8_t)(registered() ? DEVICE_NAS_STATUS_REGISTERED : DEVICE_NAS_STATUS_NOT_REGISTERED);
+    pValue[1] = DEVICE_NAS_STATUS_ROAMING_OFF;
+    cellular_ctl_put16(&pValue[2], 310);
+    cellular_ctl_put16(&pValue[4], 260);
+    pValue[6] = serving_rat();
+    cellular_ctl_put16(&pValue[7], 0x2A1F);
+    cellular_ctl_put32(&pValue[9], 0x01A2B3C);
+}
+
+static void indicate_serving(void)
+{
+    uint8_t frame[INDICATION_SIZE];
+    uint8_t value[CELLULAR_CTL_SERVING_SIZE];
+    size_t used = cellular_ctl_begin(frame, CELLULAR_CTL_FLAG_INDICATION, 0, CELLULAR_CTL_SERVING_INDICATION);
+
+    serving_value(value);
+    cellular_ctl_add(frame, &used, CELLULAR_CTL_TLV_SERVING, value, sizeof(value));
+    indicate(frame, used);
+}
+
+static void set_active(unsigned int cid, int active)
+{
+    uint8_t frame[INDICATION_SIZE];
+    uint8_t value = (uint8_t)cid;
+    uint8_t connected = (uint8_t)active;
+    size_t used;
+
+    if (gModem.contexts[cid].active == active)
+    {
+        return;
+    }
+    gModem.contexts[cid].active = active;
+    used = cellular_ctl_begin(frame, CELLULAR_CTL_FLAG_INDICATION, 0, CELLULAR_CTL_PACKET_INDICATION);
+    cellular_ctl_add(frame, &used, CELLULAR_CTL_TLV_ARG, &value, 1);
+    cellular_ctl_add(frame, &used, CELLULAR_CTL_TLV_CONNECTED, &connected, 1);
+    indicate(frame, used);
+}
+
+static void deactivate_all(void)
+{
+    unsigned int cid;
+
+    for (cid = 1; cid <= MAX_CONTEXTS; cid++)
+    {
+        set_active(cid, 0);
+    }
+}
+
+/* One-byte argument of a request */
+static int arg_byte(const CellularCtlFrame_t *pRequest, uint8_t *pValue)
+{
+    const uint8_t *pArg;
+    uint16_t length;
+
+    pArg = cellular_ctl_find(pRequest, CELLULAR_CTL_TLV_ARG, &length);
+    if ((pArg == NULL) || (length != 1))
+    {
+        return -1;
+    }
+    *pValue = pArg[0];
+    return 0;
+}
+
+static int arg_context(const CellularCtlFrame_t *pRequest, unsigned int *pCid)
+{
+    uint8_t cid;
+
+    if ((arg_byte(pRequest, &cid) != 0) || (cid < 1) || (cid > MAX_CONTEXTS))
+    {
+        return -1;
+    }
+    *pCid = cid;
+    return 0;
+}
+
+/* Copies a string TLV; absent is empty, too long is an error */
+static int arg_string(const CellularCtlFrame_t *pRequest, uint8_t type, char *pOut, size_t size)
+{
+    const uint8_t *pValue;
+    uint16_t length;
+
+    pValue = cellular_ctl_find(pRequest, type, &length);
+    if (pValue == NULL)
+    {
+        length = 0;
+    }
+    if ((length >= size) || ((pValue != NULL) && (memchr(pValue, '\0', length) != NULL)))
+    {
+        return -1;
+    }
+    if (length > 0)
+    {
+        memcpy(pOut, pValue, length);
+    }
+    pOut[length] = '\0';
+    return 0;
+}
+
+static void add_string(CtlResponse_t *pResponse, uint8_t type, const char *pValue)
+{
+    cellular_ctl_add(pResponse->frame, &pResponse->used, type, pValue, strlen(pValue));
+}
+
+static int handle_identity(const CellularCtlFrame_t *pRequest, CtlResponse_t *pResponse)
+{
+    add_string(pResponse, CELLULAR_CTL_TLV_IMEI, CELLULAR_CTLMODEM_IMEI);
+    add_string(pResponse, CELLULAR_CTL_TLV_IMEI_SV, CTLMODEM_IMEI_SV);
+    add_string(pResponse, CELLULAR_CTL_TLV_FIRMWARE, CELLULAR_CTLMODEM_FIRMWARE);
+    if (gModem.mode != CELLULAR_CTL_MODE_LOW_POWER)
+    {
+        add_string(pResponse, CELLULAR_CTL_TLV_ICCID, CTLMODEM_ICCID);
+        add_string(pResponse, CELLULAR_CTL_TLV_MSISDN, CTLMODEM_MSISDN);
+    }
+    return CELLULAR_CTL_ERROR_NONE;
+}
+
+static int handle_signal(const CellularCtlFrame_t *pRequest, CtlResponse_t *pResponse)
+{
+    static const int16_t values[] = { -61, -10, -96, 12, 23 };
+    uint8_t value[CELLULAR_CTL_SIGNAL_SIZE];
+    unsigned int i;
+
+    for (i = 0; i < sizeof(values) / sizeof(values[0]); i++)
+    {
+        cellular_ctl_put16(&value[2 * i], (uint16_t)(registered() ? values[i] : CELLULAR_CTL_SIGNAL_UNKNOWN));
+    }
+    cellular_ctl_add(pResponse->frame, &pResponse->used, CELLULAR_CTL_TLV_SIGNAL, value, sizeof(value));
+    return CELLULAR_CTL_ERROR_NONE;
+}
+
+static int handle_serving(const CellularCtlFrame_t *pRequest, CtlResponse_t *pResponse)
+{
+    uint8_t value[CELLULAR_CTL_SERVING_SIZE];
+
+    serving_value(value);
+    cellular_ctl_add(pResponse->frame, &pResponse->used, CELLULAR_CTL_TLV_SERVING, value, sizeof(value));
+    return CELLULAR_CTL_ERROR_NONE;
+}
+
+/* The SIM is off in low power mode */
+static int handle_card(const CellularCtlFrame_t *pRequest, CtlResponse_t *pResponse)
+{
+    uint8_t card = (gModem.mode == CELLULAR_CTL_MODE_LOW_POWER) ? CELLULAR_CTL_CARD_ABSENT : CELLULAR_CTL_CARD_READY;
+
+    cellular_ctl_add(pResponse->frame, &pResponse->used, CELLULAR_CTL_TLV_CARD, &card, 1);
+    return CELLULAR_CTL_ERROR_NONE;
+}
+
+static int handle_operating_mode(const CellularCtlFrame_t *pRequest, CtlResponse_t *pResponse)
+{
+    uint8_t mode;
+
+    if ((arg_byte(pRequest, &mode) != 0) || (mode > CELLULAR_CTL_MODE_FACTORY_RESET))
+    {
+        return CELLULAR_CTL_ERROR_INVALID_ARG;
+    }
+    deactivate_all();
+    if (mode == CELLULAR_CTL_MODE_FACTORY_RESET)
+    {
+        default_state();
+    }
+    gModem.mode = (mode >= CELLULAR_CTL_MODE_RESET) ? CELLULAR_CTL_MODE_ONLINE : mode;
+    gModem.attached = (gModem.mode == CELLULAR_CTL_MODE_ONLINE);
+    indicate_serving();
+    return CELLULAR_CTL_ERROR_NONE;
+}
+
+static int handle_get_rat(const CellularCtlFrame_t *pRequest, CtlResponse_t *pResponse)
+{
+    cellular_ctl_add(pResponse->frame, &pResponse->used, CELLULAR_CTL_TLV_RAT, &gModem.rats, 1);
+    return CELLULAR_CTL_ERROR_NONE;
+}
+
+static int handle_set_rat(const CellularCtlFrame_t *pRequest, CtlResponse_t *pResponse)
+{
+    uint8_t rats;
+
+    if ((arg_byte(pRequest, &rats) != 0) || (rats == 0) ||
+        ((rats & ~(CELLULAR_CTL_RAT_GSM | CELLULAR_CTL_RAT_UMTS | CELLULAR_CTL_RAT_LTE | CELLULAR_CTL_RAT_NR)) != 0))
+    {
+        return CELLULAR_CTL_ERROR_INVALID_ARG;
+    }
+    if (rats != gModem.rats)
+    {
+        gModem.rats = rats;
+        indicate_serving();
+    }
+    return CELLULAR_CTL_ERROR_NONE;
+}
+
+static int handle_attach(const CellularCtlFrame_t *pRequest, CtlResponse_t *pResponse)
+{
+    uint8_t attach;
+
+    if ((arg_byte(pRequest, &attach) != 0) || (attach > 1))
+    {
+        return CELLULAR_CTL_ERROR_INVALID_ARG;
+    }
+    if (attach && (gModem.mode != CELLULAR_CTL_MODE_ONLINE))
+    {
+        return CELLULAR_CTL_ERROR_NO_SERVICE;
+    }
+    if (!attach)
+    {
+        deactivate_all();
+    }
+    if (gModem.attached != attach)
+    {
+        gModem.attached = attach;
+        indicate_serving();
+    }
+    return CELLULAR_CTL_ERROR_NONE;
+}
+
+static int handle_set_profile(const CellularCtlFrame_t *pRequest, CtlResponse_t *pResponse)
+{
+    CtlContext_t context;
+    const uint8_t *pValue;
+    uint16_t length;
+    unsigned int cid;
+
+    memset(&context, 0, sizeof(context));
+    if (arg_context(pRequest, &cid) != 0)
+    {
+        return CELLULAR_CTL_ERROR_INVALID_ARG;
+    }
+    pValue = cellular_ctl_find(pRequest, CELLULAR_CTL_TLV_PDP_TYPE, &length);
+    if ((pValue == NULL) || (length != 1) || (pValue[0] > 3))
+    {
+        return CELLULAR_CTL_ERROR_INVALID_ARG;
+    }
+    context.pdp_type = pValue[0];
+    pValue = cellular_ctl_find(pRequest, CELLULAR_CTL_TLV_AUTH, &length);
+    if ((pValue != NULL) && ((length != 1) || (pValue[0] > 2)))
+    {
+        return CELLULAR_CTL_ERROR_INVALID_ARG;
+    }
+    context.auth = (pValue != NULL) ? pValue[0] : 0;
+    if ((arg_string(pRequest, CELLULAR_CTL_TLV_APN, context.apn, sizeof(context.apn)) != 0) ||
+        (arg_string(pRequest, CELLULAR_CTL_TLV_USER, context.user, sizeof(context.user)) != 0) ||
+        (arg_string(pRequest, CELLULAR_CTL_TLV_PASSWORD, context.password, sizeof(context.password)) != 0))
+    {
+        return CELLULAR_CTL_ERROR_INVALID_ARG;
+    }
+    if (gModem.contexts[cid].active)
+    {
+        return CELLULAR_CTL_ERROR_NOT_ALLOWED;
+    }
+    context.defined = 1;
+    gModem.contexts[cid] = context;
+    return CELLULAR_CTL_ERROR_NONE;
+}
+
+static int handle_delete_profile(const CellularCtlFrame_t *pRequest, CtlResponse_t *pResponse)
+{
+    unsigned int cid;
+
+    if (arg_context(pRequest, &cid) != 0)
+    {
+        return CELLULAR_CTL_ERROR_INVALID_ARG;
+    }
+    if (gModem.contexts[cid].active)
+    {
+        return CELLULAR_CTL_ERROR_NOT_ALLOWED;
+    }
+    memset(&gModem.contexts[cid], 0, sizeof(gModem.contexts[cid]));
+    return CELLULAR_CTL_ERROR_NONE;
+}
+
+static int handle_start_network(const CellularCtlFrame_t *pRequest, CtlResponse_t *pResponse)
+{
+    uint8_t handle[4];
+    unsigned int cid;
+
+    if ((arg_context(pRequest, &cid) != 0) || !gModem.contexts[cid].defined)
+    {
+        return CELLULAR_CTL_ERROR_INVALID_ARG;
+    }
+    if (!registered())
+    {
+        return CELLULAR_CTL_ERROR_NO_SERVICE;
+    }
+    cellular_ctl_put32(handle, 0x1000 + cid);
+    cellular_ctl_add(pResponse->frame, &pResponse->used, CELLULAR_CTL_TLV_HANDLE, handle, sizeof(handle));
+    set_active(cid, 1);
+    return CELLULAR_CTL_ERROR_NONE;
+}
+
+static int handle_stop_network(const CellularCtlFrame_t *pRequest, CtlResponse_t *pResponse)
+{
+    uint16_t length;
+    unsigned int cid;
+
+    if (cellular_ctl_find(pRequest, CELLULAR_CTL_TLV_ARG, &length) == NULL)
+    {
+        deactivate_all();
+        return CELLULAR_CTL_ERROR_NONE;
+    }
+    if (arg_context(pRequest, &cid) != 0)
+    {
+        return CELLULAR_CTL_ERROR_INVALID_ARG;
+    }
+    set_active(cid, 0);
+    return CELLULAR_CTL_ERROR_NONE;
+}
+
+typedef int (*CtlHandlerFn_t)(const CellularCtlFrame_t *pRequest, CtlResponse_t *pResponse);
+
+static const CtlHandlerFn_t gHandlers[CELLULAR_CTL_MESSAGE_COUNT] =
+{
+    NULL,
+    handle_identity,
+    handle_signal,
+    handle_serving,
+    handle_card,
+    handle_operating_mode,
+    handle_get_rat,
+    handle_set_rat,
+    handle_attach,
+    handle_set_profile,
+    handle_delete_profile,
+    handle_start_network,
+    handle_stop_network
+};
+
+/* Sends the indications a request raised, then its response, so a client has the new state by the time it reads the response */
+static void answer(int client, const CellularCtlFrame_t *pRequest, int error)
+{
+    CtlResponse_t response;
+    uint8_t result[4];
+    unsigned int index = (pRequest->message < CELLULAR_CTL_MESSAGE_COUNT) ? pRequest->message : CELLULAR_CTL_MESSAGE_COUNT;
+    size_t tlvs = CELLULAR_CTL_HEADER_SIZE + 3 + sizeof(result);
+
+    response.used = cellular_ctl_begin(response.frame, CELLULAR_CTL_FLAG_RESPONSE, pRequest->transaction, pRequest->message) + 3 + sizeof(result);
+    if ((error == CELLULAR_CTL_ERROR_NONE) && ((index == CELLULAR_CTL_MESSAGE_COUNT) || (gHandlers[index] == NULL)))
+    {
+        error = CELLULAR_CTL_ERROR_NOT_SUPPORTED;
+    }
+    if (error == CELLULAR_CTL_ERROR_NONE)
+    {
+        error = gHandlers[index](pRequest, &response);
+    }
+    if (error != CELLULAR_CTL_ERROR_NONE)
+    {
+        /* A failure carries the result only */
+        response.used = tlvs;
+    }
+    cellular_ctl_put16(result, (error == CELLULAR_CTL_ERROR_NONE) ? 0 : 1);
+    cellular_ctl_put16(&result[2], (uint16_t)error);
+    response.frame[CELLULAR_CTL_HEADER_SIZE] = CELLULAR_CTL_TLV_RESULT;
+    cellular_ctl_put16(&response.frame[CELLULAR_CTL_HEADER_SIZE + 1], sizeof(result));
+    memcpy(&response.frame[CELLULAR_CTL_HEADER_SIZE + 3], result, sizeof(result));
+    flush_indications();
+    send_frame(client, response.frame, cellular_ctl_end(response.frame, response.used));
+
+    pthread_mutex_lock(&gLock);
+    gStats.requests++;
+    gStats.errors += (error != CELLULAR_CTL_ERROR_NONE);
+    gCounts[index].requests++;
+    gCounts[index].errors += (error != CELLULAR_CTL_ERROR_NONE);
+    pthread_mutex_unlock(&gLock);
+}
+
+static int latency_of(uint16_t message)
+{
+    int ms;
+
+    pthread_mutex_lock(&gLock);
+    ms = ((message < CELLULAR_CTL_MESSAGE_COUNT) && (gLatencyMs[message] >= 0)) ? gLatencyMs[message] : gDefaultLatencyMs;
+    pthread_mutex_unlock(&gLock);
+    return ms;
+}
+
+/* Queues a request to complete after its latency, or answers it busy when the queue is full */
+static void receive(int client, const uint8_t *pData, size_t size, uint64_t now)
+{
+    CellularCtlFrame_t request;
+    unsigned int i, outstanding = 0, slot = CELLULAR_CTLMODEM_MAX_PENDING;
+
+    if ((cellular_ctl_parse(pData, size, &request) != 0) || (request.flags != CELLULAR_CTL_FLAG_REQUEST) || (request.transaction == 0))
+    {
+        gStats.malformed++;
+        return;
+    }
+    for (i = 0; i < CELLULAR_CTLMODEM_MAX_PENDING; i++)
+    {
+        if (gPending[i].client >= 0)
+        {
+            outstanding++;
+        }
+        else if (slot == CELLULAR_CTLMODEM_MAX_PENDING)
+        {
+            slot = i;
+        }
+    }
+    if (slot == CELLULAR_CTLMODEM_MAX_PENDING)
+    {
+        answer(client, &request, CELLULAR_CTL_ERROR_BUSY);
+        return;
+    }
+    gPending[slot].client = client;
+    gPending[slot].due_ns = now + ((uint64_t)latency_of(request.message) * 1000000ull);
+    gPending[slot].size = size;
+    memcpy(gPending[slot].frame, pData, size);
+    if (outstanding + 1 > gStats.max_outstanding)
+    {
+        gStats.max_outstanding = outstanding + 1;
+    }
+}
+
+/* Answers the requests which are due in due order, returns the poll timeout to the next one */
+static int complete_due(void)
+{
+    CellularCtlFrame_t request;
+    uint64_t now, next;
+    unsigned int i, first;
+
+    for (;;)
+    {
+        now = now_ns();
+        first = CELLULAR_CTLMODEM_MAX_PENDING;
+        for (i = 0; i < CELLULAR_CTLMODEM_MAX_PENDING; i++)
+        {
+            if ((gPending[i].client >= 0) && ((first == CELLULAR_CTLMODEM_MAX_PENDING) || (gPending[i].due_ns < gPending[first].due_ns)))
+            {
+                first = i;
+            }
+        }
+        if (first == CELLULAR_CTLMODEM_MAX_PENDING)
+        {
+            return -1;
+        }
+        next = gPending[first].due_ns;
+        if (next > now)
+        {
+            return (int)((next - now + 999999ull) / 1000000ull);
+        }
+        cellular_ctl_parse(gPending[first].frame, gPending[first].size, &request);
+        answer(gPending[first].client, &request, CELLULAR_CTL_ERROR_NONE);
+        gPending[first].client = -1;
+    }
+}
+
+static void drop_client(unsigned int client)
+{
+    unsigned int i;
+
+    close(gClients[client]);
+    gClients[client] = -1;
+    for (i = 0; i < CELLULAR_CTLMODEM_MAX_PENDING; i++)
+    {
+        if (gPending[i].client == (int)client)
+        {
+            gPending[i].client = -1;
+        }
+    }
+}
+
+static void *ctlmodem_thread(void *pArg)
+{
+    struct pollfd fds[CELLULAR_CTLMODEM_MAX_CLIENTS + 2];
+    uint8_t frame[CELLULAR_CTL_MAX_FRAME + 1];
+    unsigned int i;
+    ssize_t got;
+    int fd, timeout;
+
+    (void)pArg;
+    prctl(PR_SET_NAME, "cellular_ctlmdm", 0, 0, 0);
+    cellular_run_background_thread();
+    while (!gStop)
+    {
+        timeout = complete_due();
+        fds[0].fd = gStopFd;
+        fds[0].events = POLLIN;
+        fds[1].fd = gListenFd;
+        fds[1].events = POLLIN;
+        for (i = 0; i < CELLULAR_CTLMODEM_MAX_CLIENTS; i++)
+        {
+            fds[i + 2].fd = gClients[i];
+            fds[i + 2].events = POLLIN;
+            fds[i + 2].revents = 0;
+        }
+        if (poll(fds, CELLULAR_CTLMODEM_MAX_CLIENTS + 2, timeout) <= 0)
+        {
+            continue;
+        }
+        if (fds[0].revents != 0)
+        {
+            break;
+        }
+        if (fds[1].revents & POLLIN)
+        {
+            fd = accept4(gListenFd, NULL, NULL, SOCK_CLOEXEC | SOCK_NONBLOCK);
+            for (i = 0; (fd >= 0) && (i < CELLULAR_CTLMODEM_MAX_CLIENTS) && (gClients[i] >= 0); i++)
+            {
+            }
+            if ((fd >= 0) && (i < CELLULAR_CTLMODEM_MAX_CLIENTS))
+            {
+                gClients[i] = fd;
+            }
+            else if (fd >= 0)
+            {
+                UT_LOG_WARNING("Control modem: refusing a client past %d", CELLULAR_CTLMODEM_MAX_CLIENTS);
+                close(fd);
+            }
+        }
+        for (i = 0; i < CELLULAR_CTLMODEM_MAX_CLIENTS; i++)
+        {
+            if ((gClients[i] < 0) || (fds[i + 2].revents == 0))
+            {
+                continue;
+            }
+            /* One datagram is one frame, a longer one is malformed */
+            while ((got = recv(gClients[i], frame, sizeof(frame), MSG_DONTWAIT)) > 0)
+            {
+                receive((int)i, frame, (size_t)got, now_ns());
+            }
+            if ((got == 0) || ((errno != EAGAIN) && (errno != EINTR)))
+            {
+                drop_client(i);
+            }
+        }
+    }
+    return NULL;
+}
+
+/* Requests answered per message and outcome, and the indications sent */
+static void collect_metrics(FILE *pOut)
+{
+    const char *pName;
+    unsigned int i;
+
+    cellular_metrics_family(pOut, "cellular_ctlmodem_requests", CELLULAR_METRIC_COUNTER, "Control protocol requests answered by the emulator");
+    pthread_mutex_lock(&gLock);
+    for (i = 1; i <= CELLULAR_CTL_MESSAGE_COUNT; i++)
+    {
+        if (gCounts[i].requests == 0)
+        {
+            continue;
+        }
+        pName = (i < CELLULAR_CTL_MESSAGE_COUNT) ? cellular_ctl_message_name((uint16_t)i) : "unknown";
+        cellular_metrics_sample(pOut, "cellular_ctlmodem_requests_total", (double)(gCounts[i].requests - gCounts[i].errors),
+                                "message", pName, "result", "ok", NULL);
+        cellular_metrics_sample(pOut, "cellular_ctlmodem_requests_total", (double)gCounts[i].errors,
+                                "message", pName, "result", "error", NULL);
+    }
+    pthread_mutex_unlock(&gLock);
+    cellular_metrics_family(pOut, "cellular_ctlmodem_indications", CELLULAR_METRIC_COUNTER, "Indications sent by the emulator, one per client");
+    cellular_metrics_sample(pOut, "cellular_ctlmodem_indications_total", (double)gStats.indications, NULL);
+    cellular_metrics_family(pOut, "cellular_ctlmodem_max_outstanding", CELLULAR_METRIC_GAUGE, "Most requests in progress at once");
+    cellular_metrics_sample(pOut, "cellular_ctlmodem_max_outstanding", (double)gStats.max_outstanding, NULL);
+}
+
+int cellular_ctlmodem_start(unsigned int latency_ms)
+{
+    struct sockaddr_un address;
+    unsigned int i;
+
+    if (gStarted)
+    {
+        return RETURN_OK;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    snprintf(gPath, sizeof(gPath), "%s/cellular_ctlmodem.%d", (getenv("TMPDIR") != NULL) ? getenv("TMPDIR") : "/tmp", (int)getpid());
+    memcpy(address.sun_path, gPath, sizeof(address.sun_path));
+    unlink(gPath);
+    gListenFd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    gStopFd = eventfd(0, EFD_CLOEXEC);
+    if ((gListenFd < 0) || (gStopFd < 0) || (bind(gListenFd, (struct sockaddr *)&address, sizeof(address)) != 0) ||
+        (listen(gListenFd, CELLULAR_CTLMODEM_MAX_CLIENTS) != 0))
+    {
+        UT_LOG_ERROR("Control modem: cannot listen on %s: %s", gPath, strerror(errno));
+        cellular_ctlmodem_stop();
+        return RETURN_ERROR;
+    }
+
+    default_state();
+    memset(&gStats, 0, sizeof(gStats));
+    memset(gCounts, 0, sizeof(gCounts));
+    for (i = 0; i < CELLULAR_CTL_MESSAGE_COUNT; i++)
+    {
+        gLatencyMs[i] = -1;
+    }
+    for (i = 0; i < CELLULAR_CTLMODEM_MAX_PENDING; i++)
+    {
+        gPending[i].client = -1;
+    }
+    for (i = 0; i < CELLULAR_CTLMODEM_MAX_CLIENTS; i++)
+    {
+        gClients[i] = -1;
+    }
+    gIndicationCount = 0;
+    gDefaultLatencyMs = (int)latency_ms;
+    gStop = 0;
+    if (pthread_create(&gThread, NULL, ctlmodem_thread, NULL) != 0)
+    {
+        UT_LOG_ERROR("Control modem: cannot start the thread");
+        cellular_ctlmodem_stop();
+        return RETURN_ERROR;
+    }
+    gStarted = 1;
+    cellular_metrics_add_collector(collect_metrics);
+    UT_LOG_INFO("Control modem: answering on %s, %u ms per request", gPath, latency_ms);
+    return RETURN_OK;
+}
+
+const char *cellular_ctlmodem_path(void)
+{
+    return gStarted ? gPath : NULL;
+}
+
+int cellular_ctlmodem_set_latency(const char *pMessage, int ms)
+{
+    const char *pName;
+    uint16_t i;
+
+    pthread_mutex_lock(&gLock);
+    if (pMessage == NULL)
+    {
+        gDefaultLatencyMs = (ms > 0) ? ms : 0;
+        pthread_mutex_unlock(&gLock);
+        return RETURN_OK;
+    }
+    for (i = 1; i < CELLULAR_CTL_MESSAGE_COUNT; i++)
+    {
+        pName = cellular_ctl_message_name(i);
+        if (strcmp(pName, pMessage) == 0)
+        {
+            gLatencyMs[i] = (ms >= 0) ? ms : -1;
+            pthread_mutex_unlock(&gLock);
+            return RETURN_OK;
+        }
+    }
+    pthread_mutex_unlock(&gLock);
+    return RETURN_ERROR;
+}
+
+int cellular_ctlmodem_set_latencies(const char *pList)
+{
+    char copy[1024];
+    char *pSave = NULL;
+    char *pEntry;
+    char *pValue;
+    char *pEnd;
+    long ms;
+    int result = RETURN_OK;
+
+    if (pList == NULL)
+    {
+        return RETURN_ERROR;
+    }
+    snprintf(copy, sizeof(copy), "%s", pList);
+    for (pEntry = strtok_r(copy, ",", &pSave); pEntry != NULL; pEntry = strtok_r(NULL, ",", &pSave))
+    {
+        pValue = strrchr(pEntry, ':');
+        pValue = (pValue != NULL) ? pValue + 1 : pEntry;
+        ms = strtol(pValue, &pEnd, 10);
+        if (pValue != pEntry)
+        {
+            pValue[-1] = '\0';
+        }
+        if ((*pEnd != '\0') || (pEnd == pValue) || (ms < 0) ||
+            (cellular_ctlmodem_set_latency((pValue != pEntry) ? pEntry : NULL, (int)ms) != RETURN_OK))
+        {
+            UT_LOG_ERROR("Control modem: invalid latency [%s]", pEntry);
+            result = RETURN_ERROR;
+        }
+    }
+    return result;
+}
+
+int cellular_ctlmodem_get_stats(CellularCtlmodemStats_t *pStats)
+{
+    if (pStats == NULL)
+    {
+        return RETURN_ERROR;
+    }
+    pthread_mutex_lock(&gLock);
+    *pStats = gStats;
+    pthread_mutex_unlock(&gLock);
+    return RETURN_OK;
+}
+
+void cellular_ctlmodem_stop(void)
+{
+    uint64_t one = 1;
+    unsigned int i;
+
+    if (gStarted)
+    {
+        gStop = 1;
+        if (write(gStopFd, &one, sizeof(one)) != (ssize_t)sizeof(one))
+        {
+            UT_LOG_WARNING("Control modem: stop signal failed");
+        }
+        pthread_join(gThread, NULL);
+        gStarted = 0;
+        for (i = 0; i < CELLULAR_CTLMODEM_MAX_CLIENTS; i++)
+        {
+            if (gClients[i] >= 0)
+            {
+                drop_client(i);
+            }
+        }
+        unlink(gPath);
+    }
+    if (gListenFd >= 0)
+    {
+        close(gListenFd);
+    }
+    if (gStopFd >= 0)
+    {
+        close(gStopFd);
+    }
+    gListenFd = -1;
+    gStopFd = -1;
+}
+
+void cellular_ctlmodem_report(void)
+{
+    unsigned int i;
+
+    if (gStats.requests == 0)
+    {
+        return;
+    }
+    pthread_mutex_lock(&gLock);
+    UT_LOG_INFO("Control modem: %llu requests, %llu errors, %llu indications, %llu malformed, %llu dropped, %u outstanding at most",
+                (unsigned long long)gStats.requests, (unsigned long long)gStats.errors, (unsigned long long)gStats.indications,
+                (unsigned long long)gStats.malformed, (unsigned long long)gStats.dropped, gStats.max_outstanding);
+    UT_LOG_INFO("| %-20s | %9s | %9s |", "Message", "count", "errors");
+    for (i = 1; i <= CELLULAR_CTL_MESSAGE_COUNT; i++)
+    {
+        if (gCounts[i].requests > 0)
+        {
+            UT_LOG_INFO("| %-20s | %9llu | %9llu |", (i < CELLULAR_CTL_MESSAGE_COUNT) ? cellular_ctl_message_name((uint16_t)i) : "unknown",
+                        (unsigned long long)gCounts[i].requests, (unsigned long long)gCounts[i].errors);
+        }
+    }
+    pthread_mutex_unlock(&gLock);
+}
@@ -0,0 +1,459 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:*
+ * Copyright 2023 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file cellular_delta.c
+ * @brief Change notification for PLMN information and interface status
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/prctl.h>
+#include "cellular_delta.h"
+#include "cellular_bench.h"
+#include "cellular_run.h"
+
+/* Pending changes per subscriber; when full, new changes are merged into the newest entry */
+#define CELLULAR_DELTA_QUEUE_DEPTH 16
+
+struct cellular_delta_sub_s
+{
+    struct cellular_delta_sub_s *pNext;
+    uint32_t field_mask;
+    int event_fd;
+    pthread_mutex_t lock;
+    unsigned int head;
+    unsigned int count;
+    CellularDeltaChange_t queue[CELLULAR_DELTA_QUEUE_DEPTH];
+};
+
+struct cellular_delta_s
+{
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_t thread;
+    int running;
+    int stop;
+    unsigned int poll_interval_ms;
+    int have_baseline;
+    CellularCurrentPlmnInfoStruct plmn;
+    CellularInterfaceStatus_t if_status;
+    cellular_delta_sub_t *pSubs;
+    CellularDeltaStats_t stats;
+};
+
+uint32_t cellular_delta_compare_plmn(const CellularCurrentPlmnInfoStruct *pPrev, const CellularCurrentPlmnInfoStruct *pCur)
+{
+    uint32_t changed = 0;
+
+    if (strncmp(pPrev->plmn_name, pCur->plmn_name, sizeof(pCur->plmn_name)) != 0)
+    {
+        changed |= CELLULAR_DELTA_PLMN_NAME;
+    }
+    if (pPrev->MCC != pCur->MCC)
+    {
+        changed |= CELLULAR_DELTA_MCC;
+    }
+    if (pPrev->MNC != pCur->MNC)
+    {
+        changed |= CELLULAR_DELTA_MNC;
+    }
+    if (pPrev->registration_status != pCur->registration_status)
+    {
+        changed |= CELLULAR_DELTA_REGISTRATION_STATUS;
+    }
+    if (pPrev->registered_service != pCur->registered_service)
+    {
+        changed |= CELLULAR_DELTA_REGISTERED_SERVICE;
+    }
+    if (pPrev->roaming_status != pCur->roaming_status)
+    {
+        changed |= CELLULAR_DELTA_ROAMING_STATUS;
+    }
+    if (pPrev->roaming_enabled != pCur->roaming_enabled)
+    {
+        changed |= CELLULAR_DELTA_ROAMING_ENABLED;
+    }
+    if (pPrev->area_code != pCur->area_code)
+    {
+        changed |= CELLULAR_DELTA_AREA_CODE;
+    }
+    if (pPrev->cell_id != pCur->cell_id)
+    {
+        changed |= CELLULAR_DELTA_CELL_ID;
+    }
+    return changed;
+}
+
+/* Copies only the fields selected by 'mask' from the current readings into 'pChange' */
+static void fill_change(CellularDeltaChange_t *pChange, uint32_t mask, const CellularCurrentPlmnInfoStruct *pPlmn, CellularInterfaceStatus_t if_status)
+{
+    if (mask & CELLULAR_DELTA_PLMN_NAME)
+    {
+        memcpy(pChange->plmn.plmn_name, pPlmn->plmn_name, sizeof(pChange->plmn.plmn_name));
+    }
+    if (mask & CELLULAR_DELTA_MCC)
+    {
+        pChange->plmn.MCC = pPlmn->MCC;
+    }
+    if (mask & CELLULAR_DELTA_MNC)
+    {
+        pChange->plmn.MNC = pPlmn->MNC;
+    }
+    if (mask & CELLULAR_DELTA_REGISTRATION_STATUS)
+    {
+        pChange->plmn.registration_status = pPlmn->registration_status;
+    }
+    if (mask & CELLULAR_DELTA_REGISTERED_SERVICE)
+    {
+        pChange->plmn.registered_service = pPlmn->registered_service;
+    }
+    if (mask & CELLULAR_DELTA_ROAMING_STATUS)
+    {
+        pChange->plmn.roaming_status = pPlmn->roaming_status;
+    }
+    if (mask & CELLULAR_DELTA_ROAMING_ENABLED)
+    {
+        pChange->plmn.roaming_enabled = pPlmn->roaming_enabled;
+    }
+    if (mask & CELLULAR_DELTA_AREA_CODE)
+    {
+        pChange->plmn.area_code = pPlmn->area_code;
+    }
+    if (mask & CELLULAR_DELTA_CELL_ID)
+    {
+        pChange->plmn.cell_id = pPlmn->cell_id;
+    }
+    if (mask & CELLULAR_DELTA_INTERFACE_STATUS)
+    {
+        pChange->if_status = if_status;
+    }
+    pChange->changed |= mask;
+}
+
+/* Queues a change for one subscriber, returns 1 if the eventfd was signalled */
+static int deliver(cellular_delta_t *pDelta, cellular_delta_sub_t *pSub, uint32_t changed, uint64_t sequence, uint64_t now)
+{
+    uint32_t mask = changed & pSub->field_mask;
+    CellularDeltaChange_t *pChange;
+    uint64_t one = 1;
+    int signal = 0;
+
+    if (mask == 0)
+    {
+        return 0;
+    }
+
+    pthread_mutex_lock(&pSub->lock);
+    if (pSub->count < CELLULAR_DELTA_QUEUE_DEPTH)
+    {
+        pChange = &pSub->queue[(pSub->head + pSub->count) % CELLULAR_DELTA_QUEUE_DEPTH];
+        memset(pChange, 0, sizeof(*pChange));
+        pSub->count++;
+        signal = 1;
+    }
+    else
+    {
+        /* Consumer is behind: fold into the newest entry so the latest values are never lost */
+        pChange = &pSub->queue[(pSub->head + pSub->count - 1) % CELLULAR_DELTA_QUEUE_DEPTH];
+        pDelta->stats.coalesced++;
+    }
+    fill_change(pChange, mask, &pDelta->plmn, pDelta->if_status);
+    pChange->sequence = sequence;
+    pChange->timestamp_ns = now;
+    /* Signalled under the queue lock so a reader draining the queue cannot reset the eventfd in between */
+    if (signal && (write(pSub->event_fd, &one, sizeof(one)) != (ssize_t)sizeof(one)))
+    {
+        signal = 0;
+    }
+    pthread_mutex_unlock(&pSub->lock);
+
+    return signal;
+}
+
+int cellular_delta_poll_once(cellular_delta_t *pDelta)
+{
+    CellularCurrentPlmnInfoStruct plmn;
+    CellularInterfaceStatus_t if_status = IF_UNKNOWN;
+    cellular_delta_sub_t *pSub;
+    uint32_t changed = 0;
+    int plmn_ok;
+    int if_ok;
+    uint64_t now;
+
+    if (pDelta == NULL)
+    {
+        return -1;
+    }
+
+    /* HAL calls are made outside the engine lock so subscribers are never blocked on the modem */
+    memset(&plmn, 0, sizeof(plmn));
+    plmn_ok = (cellular_hal_get_current_plmn_information(&plmn) == RETURN_OK);
+    if_ok = (cellular_hal_get_current_modem_interface_status(&if_status) == RETURN_OK);
+    now = cellular_bench_now_ns();
+
+    pthread_mutex_lock(&pDelta->lock);
+    pDelta->stats.polls++;
+    if (!plmn_ok || !if_ok)
+    {
+        pDelta->stats.poll_errors++;
+    }
+    if (!plmn_ok && !if_ok)
+    {
+        pthread_mutex_unlock(&pDelta->lock);
+        return -1;
+    }
+
+    if (!pDelta->have_baseline)
+    {
+        changed = CELLULAR_DELTA_ALL;
+        pDelta->have_baseline = 1;
+    }
+    else
+    {
+        if (plmn_ok)
+        {
+            changed |= cellular_delta_compare_plmn(&pDelta->plmn, &plmn);
+        }
+        if (if_ok && (pDelta->if_status != if_status))
+        {
+            changed |= CELLULAR_DELTA_INTERFACE_STATUS;
+        }
+    }
+
+    if (plmn_ok)
+    {
+        pDelta->plmn = plmn;
+    }
+    if (if_ok)
+    {
+        pDelta->if_status = if_status;
+    }
+
+    if (changed != 0)
+    {
+        pDelta->stats.changes++;
+        for (pSub = pDelta->pSubs; pSub != NULL; pSub = pSub->pNext)
+        {
+            pDelta->stats.notifications += deliver(pDelta, pSub, changed, pDelta->stats.polls, now);
+        }
+    }
+    pthread_mutex_unlock(&pDelta->lock);
+
+    return (int)changed;
+}
+
+static void *poller_thread(void *pArg)
+{
+    cellular_delta_t *pDelta = (cellular_delta_t *)pArg;
+    struct timespec deadline;
+
+    prctl(PR_SET_NAME, "cellular_delta", 0, 0, 0);
+    cellular_run_background_thread();
+    pthread_mutex_lock(&pDelta->lock);
+    while (!pDelta->stop)
+    {
+        pthread_mutex_unlock(&pDelta->lock);
+        cellular_delta_poll_once(pDelta);
+        pthread_mutex_lock(&pDelta->lock);
+
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += pDelta->poll_interval_ms / 1000;
+        deadline.tv_nsec += (long)(pDelta->poll_interval_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L)
+        {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        while (!pDelta->stop)
+        {
+            if (pthread_cond_timedwait(&pDelta->wake, &pDelta->lock, &deadline) == ETIMEDOUT)
+            {
+                break;
+            }
+        }
+    }
+    pthread_mutex_unlock(&pDelta->lock);
+    return NULL;
+}
+
+cellular_delta_t *cellular_delta_create(unsigned int poll_interval_ms)
+{
+    cellular_delta_t *pDelta = (cellular_delta_t *)calloc(1, sizeof(cellular_delta_t));
+    pthread_condattr_t attr;
+
+    if (pDelta == NULL)
+    {
+        return NULL;
+    }
+    pDelta->poll_interval_ms = (poll_interval_ms == 0) ? 1 : poll_interval_ms;
+    pDelta->if_status = IF_UNKNOWN;
+    pthread_mutex_init(&pDelta->lock, NULL);
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&pDelta->wake, &attr);
+    pthread_condattr_destroy(&attr);
+    return pDelta;
+}
+
+int cellular_delta_start(cellular_delta_t *pDelta)
+{
+    if ((pDelta == NULL) || pDelta->running)
+    {
+        return RETURN_ERROR;
+    }
+    pDelta->stop = 0;
+    if (pthread_create(&pDelta->thread, NULL, poller_thread, pDelta) != 0)
+    {
+        return RETURN_ERROR;
+    }
+    pDelta->running = 1;
+    return RETURN_OK;
+}
+
+void cellular_delta_destroy(cellular_delta_t *pDelta)
+{
+    cellular_delta_sub_t *pSub;
+
+    if (pDelta == NULL)
+    {
+        return;
+    }
+    if (pDelta->running)
+    {
+        pthread_mutex_lock(&pDelta->lock);
+        pDelta->stop = 1;
+        pthread_cond_signal(&pDelta->wake);
+        pthread_mutex_unlock(&pDelta->lock);
+        pthread_join(pDelta->thread, NULL);
+        pDelta->running = 0;
+    }
+    while ((pSub = pDelta->pSubs) != NULL)
+    {
+        pDelta->pSubs = pSub->pNext;
+        close(pSub->event_fd);
+        pthread_mutex_destroy(&pSub->lock);
+        free(pSub);
+    }
+    pthread_cond_destroy(&pDelta->wake);
+    pthread_mutex_destroy(&pDelta->lock);
+    free(pDelta);
+}
+
+cellular_delta_sub_t *cellular_delta_subscribe(cellular_delta_t *pDelta, uint32_t field_mask)
+{
+    cellular_delta_sub_t *pSub;
+
+    if ((pDelta == NULL) || (field_mask == 0))
+    {
+        return NULL;
+    }
+    pSub = (cellular_delta_sub_t *)calloc(1, sizeof(cellular_delta_sub_t));
+    if (pSub == NULL)
+    {
+        return NULL;
+    }
+    pSub->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (pSub->event_fd < 0)
+    {
+        free(pSub);
+        return NULL;
+    }
+    pSub->field_mask = field_mask;
+    pthread_mutex_init(&pSub->lock, NULL);
+
+    pthread_mutex_lock(&pDelta->lock);
+    pSub->pNext = pDelta->pSubs;
+    pDelta->pSubs = pSub;
+    pthread_mutex_unlock(&pDelta->lock);
+    return pSub;
+}
+
+void cellular_delta_unsubscribe(cellular_delta_t *pDelta, cellular_delta_sub_t *pSub)
+{
+    cellular_delta_sub_t **ppLink;
+
+    if ((pDelta == NULL) || (pSub == NULL))
+    {
+        return;
+    }
+    pthread_mutex_lock(&pDelta->lock);
+    for (ppLink = &pDelta->pSubs; *ppLink != NULL; ppLink = &(*ppLink)->pNext)
+    {
+        if (*ppLink == pSub)
+        {
+            *ppLink = pSub->pNext;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&pDelta->lock);
+    close(pSub->event_fd);
+    pthread_mutex_destroy(&pSub->lock);
+    free(pSub);
+}
+
+int cellular_delta_subscriber_fd(const cellular_delta_sub_t *pSub)
+{
+    return (pSub != NULL) ? pSub->event_fd : -1;
+}
+
+int cellular_delta_read(cellular_delta_sub_t *pSub, CellularDeltaChange_t *pChange)
+{
+    uint64_t counter;
+    int found = 0;
+
+    if ((pSub == NULL) || (pChange == NULL))
+    {
+        return 0;
+    }
+
+    pthread_mutex_lock(&pSub->lock);
+    if (pSub->count > 0)
+    {
+        *pChange = pSub->queue[pSub->head];
+        pSub->head = (pSub->head + 1) % CELLULAR_DELTA_QUEUE_DEPTH;
+        pSub->count--;
+        found = 1;
+    }
+    if (pSub->count == 0)
+    {
+        /* Queue drained: reset the eventfd so epoll stops reporting it readable */
+        if (read(pSub->event_fd, &counter, sizeof(counter)) < 0)
+        {
+            counter = 0;
+        }
+    }
+    pthread_mutex_unlock(&pSub->lock);
+    return found;
+}
+
+void cellular_delta_get_stats(cellular_delta_t *pDelta, CellularDeltaStats_t *pStats)
+{
+    if ((pDelta == NULL) || (pStats == NULL))
+    {
+        return;
+    }
+    pthread_mutex_lock(&pDelta->lock);
+    *pStats = pDelta->stats;
+    pthread_mutex_unlock(&pDelta->lock);
+}
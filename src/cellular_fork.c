@@ -0,0 +1,402 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:*
+ * Copyright 2023 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file cellular_fork.c
+ * @brief Fork server: every test runs in a copy-on-write child of the initialized process
+ *
+ * ut-core asserts through CUnit, which keeps the failures of a forked child in the
+ * child's copy of the registry. The child therefore sends the failure records added by
+ * its test as fixed-size records, followed by the benchmark results it set, and the
+ * parent asserts them again with the original file and line. A fatal assertion in the
+ * child jumps back to the child's runner, not into its copy of the suite run. A test the
+ * watchdog abandons is ended by killing its child, the parent is never jumped out of.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <CUnit/CUnit.h>
+#include <ut_log.h>
+#include "cellular_fork.h"
+#include "cellular_bench.h"
+#include "cellular_log.h"
+#include "cellular_metrics.h"
+#include "cellular_sim.h"
+
+#define FORK_TEXT_LENGTH 256
+
+typedef enum
+{
+    FORK_RECORD_STARTED = 1,
+    FORK_RECORD_FAILURE,
+    FORK_RECORD_RESULT,
+    FORK_RECORD_DONE
+} ForkRecordKind_t;
+
+/* FAILURE: line, file and condition; RESULT: value, name, help and variant, line 1 when there is a variant */
+typedef struct
+{
+    int kind;
+    unsigned int line;
+    double value;
+    uint64_t ns;
+    char text[3][FORK_TEXT_LENGTH];
+} ForkRecord_t;
+
+static int gStarted = 0;
+static pid_t gServer = 0;       /* Process which started the fork server, its children run their test in place */
+static int gReinitMeasured = 0;
+static CellularForkStats_t gStats;
+/* Child of the running test, also read by the abandon handler; reaped before the next fork if the parent was jumped out of */
+static volatile pid_t gChild = 0;
+static int gChildFd = -1;
+static volatile sig_atomic_t gAbandoned = 0;
+
+static void send_record(int fd, const ForkRecord_t *pRecord)
+{
+    ssize_t written;
+
+    do
+    {
+        written = write(fd, pRecord, sizeof(*pRecord));
+    } while ((written < 0) && (errno == EINTR));
+}
+
+/* Returns 0 with a whole record, -1 at the end of the stream */
+static int receive_record(int fd, ForkRecord_t *pRecord)
+{
+    size_t used = 0;
+    ssize_t got;
+
+    while (used < sizeof(*pRecord))
+    {
+        got = read(fd, (char *)pRecord + used, sizeof(*pRecord) - used);
+        if ((got < 0) && (errno == EINTR))
+        {
+            continue;
+        }
+        if (got <= 0)
+        {
+            return -1;
+        }
+        used += (size_t)got;
+    }
+    return 0;
+}
+
+static void reap_child(void)
+{
+    if (gChild > 0)
+    {
+        kill(gChild, SIGKILL);
+        while ((waitpid(gChild, NULL, 0) < 0) && (errno == EINTR))
+        {
+        }
+        gChild = 0;
+    }
+    if (gChildFd >= 0)
+    {
+        close(gChildFd);
+        gChildFd = -1;
+    }
+}
+
+/* The serial alternative: the modem back to its power-on state and initialized, until registered */
+static void measure_reinit(void)
+{
+    CellularContextInitInputStruct context;
+    CellularCurrentPlmnInfoStruct plmn;
+    uint64_t start = cellular_bench_now_ns();
+    uint64_t deadline = start + CELLULAR_FORK_REINIT_TIMEOUT_MS * 1000000ULL;
+
+    gReinitMeasured = 1;
+    if (cellular_sim_available())
+    {
+        cellular_sim_reset();
+    }
+    memset(&context, 0, sizeof(context));
+    if (cellular_hal_init(&context) != RETURN_OK)
+    {
+        UT_LOG_WARNING("Fork server: cellular_hal_init failed, the time saved is not known");
+        return;
+    }
+    do
+    {
+        memset(&plmn, 0, sizeof(plmn));
+        if ((cellular_hal_get_current_plmn_information(&plmn) == RETURN_OK) && (plmn.registration_status == DEVICE_NAS_STATUS_REGISTERED))
+        {
+            gStats.reinit_ns = cellular_bench_now_ns() - start;
+            return;
+        }
+        cellular_bench_sleep_ms(1);
+    } while (cellular_bench_now_ns() < deadline);
+    UT_LOG_WARNING("Fork server: not registered %u ms after cellular_hal_init, the time saved is not known", CELLULAR_FORK_REINIT_TIMEOUT_MS);
+}
+
+static void copy_text(char *pText, const char *pValue)
+{
+    snprintf(pText, FORK_TEXT_LENGTH, "%s", (pValue != NULL) ? pValue : "");
+}
+
+static void run_child(int fd, UT_TestFunction_t pFunction)
+{
+    ForkRecord_t record;
+    CU_pFailureRecord pFailure;
+    CU_pTest pTest = CU_get_current_test();
+    const char *pName, *pHelp, *pVariant;
+    unsigned int failures = CU_get_number_of_failure_records();
+    unsigned int results = 0;
+    unsigned int i;
+    double value;
+    jmp_buf fatal;
+
+    prctl(PR_SET_PDEATHSIG, SIGKILL, 0, 0, 0);
+    memset(&record, 0, sizeof(record));
+    record.kind = FORK_RECORD_STARTED;
+    record.ns = cellular_bench_now_ns();
+    send_record(fd, &record);
+    while (cellular_metrics_get_result(results, &pName, &pHelp, &pVariant, &value) == RETURN_OK)
+    {
+        results++;
+    }
+
+    if (pTest != NULL)
+    {
+        pTest->pJumpBuf = &fatal;
+    }
+    if (setjmp(fatal) == 0)
+    {
+        pFunction();
+    }
+    record.ns = cellular_bench_now_ns();
+
+    for (pFailure = CU_get_failure_list(), i = 0; pFailure != NULL; pFailure = pFailure->pNext, i++)
+    {
+        if (i < failures)
+        {
+            continue;
+        }
+        memset(&record, 0, sizeof(record));
+        record.kind = FORK_RECORD_FAILURE;
+        record.line = pFailure->uiLineNumber;
+        copy_text(record.text[0], pFailure->strFileName);
+        copy_text(record.text[1], pFailure->strCondition);
+        send_record(fd, &record);
+    }
+    for (i = results; cellular_metrics_get_result(i, &pName, &pHelp, &pVariant, &value) == RETURN_OK; i++)
+    {
+        memset(&record, 0, sizeof(record));
+        record.kind = FORK_RECORD_RESULT;
+        record.line = (pVariant != NULL) ? 1 : 0;
+        record.value = value;
+        copy_text(record.text[0], pName);
+        copy_text(record.text[1], pHelp);
+        copy_text(record.text[2], pVariant);
+        send_record(fd, &record);
+    }
+    memset(&record, 0, sizeof(record));
+    record.kind = FORK_RECORD_DONE;
+    record.ns = cellular_bench_now_ns();
+    send_record(fd, &record);
+    cellular_log_flush();
+    fflush(NULL);
+    /* Leave without running the parent's atexit handlers */
+    _exit(0);
+}
+
+/* Runs in the watchdog's signal handler on the test thread, blocked reading the child's records */
+static int abandon_child(void)
+{
+    pid_t child = gChild;
+
+    if (child <= 0)
+    {
+        return RETURN_ERROR;
+    }
+    gAbandoned = 1;
+    kill(child, SIGKILL);
+    return RETURN_OK;
+}
+
+static void fork_runner(const char *pTitle, UT_TestFunction_t pFunction)
+{
+    ForkRecord_t record;
+    uint64_t forkNs, startNs = 0, doneNs = 0;
+    int fds[2];
+    int status = 0;
+    int done = 0;
+    pid_t pid;
+
+    reap_child();
+    gAbandoned = 0;
+    if (!gReinitMeasured)
+    {
+        measure_reinit();
+    }
+    /* Nothing buffered may reach the output twice */
+    cellular_log_flush();
+    fflush(NULL);
+    if (pipe(fds) != 0)
+    {
+        UT_LOG_ERROR("Fork server: pipe failed for %s, running it unforked: %s", pTitle, strerror(errno));
+        pFunction();
+        return;
+    }
+    forkNs = cellular_bench_now_ns();
+    pid = fork();
+    if (pid < 0)
+    {
+        UT_LOG_ERROR("Fork server: fork failed for %s, running it unforked: %s", pTitle, strerror(errno));
+        close(fds[0]);
+        close(fds[1]);
+        pFunction();
+        return;
+    }
+    if (pid == 0)
+    {
+        close(fds[0]);
+        run_child(fds[1], pFunction);
+    }
+    close(fds[1]);
+    gChild = pid;
+    gChildFd = fds[0];
+
+    while (!done && (receive_record(fds[0], &record) == 0))
+    {
+        switch (record.kind)
+        {
+            case FORK_RECORD_STARTED:
+                startNs = record.ns;
+                break;
+            case FORK_RECORD_FAILURE:
+                CU_assertImplementation(CU_FALSE, record.line, record.text[1], record.text[0], "", CU_FALSE);
+                break;
+            case FORK_RECORD_RESULT:
+                cellular_metrics_set(record.text[0], record.text[1], (record.line != 0) ? record.text[2] : NULL, record.value);
+                break;
+            case FORK_RECORD_DONE:
+                doneNs = record.ns;
+                done = 1;
+                break;
+            default:
+                break;
+        }
+    }
+    while ((waitpid(pid, &status, 0) < 0) && (errno == EINTR))
+    {
+    }
+    gChild = 0;
+    close(fds[0]);
+    gChildFd = -1;
+
+    gStats.tests++;
+    if (!done)
+    {
+        gStats.lost++;
+        if (gAbandoned)
+        {
+            UT_LOG_ERROR("Fork server: %s abandoned, its child killed", pTitle);
+            UT_FAIL("Test abandoned");
+            return;
+        }
+        if (WIFSIGNALED(status))
+        {
+            UT_LOG_ERROR("Fork server: %s died of signal %d (%s)", pTitle, WTERMSIG(status), strsignal(WTERMSIG(status)));
+        }
+        else
+        {
+            UT_LOG_ERROR("Fork server: %s exited with %d before the test returned", pTitle, WEXITSTATUS(status));
+        }
+        UT_FAIL("Test child died");
+        return;
+    }
+    gStats.overhead_ns += ((startNs > forkNs) ? startNs - forkNs : 0) + (cellular_bench_now_ns() - doneNs);
+}
+
+static void collect_metrics(FILE *pOut)
+{
+    cellular_metrics_family(pOut, "cellular_fork_tests", CELLULAR_METRIC_COUNTER, "Tests run in a forked child");
+    cellular_metrics_sample(pOut, "cellular_fork_tests_total", (double)gStats.tests, NULL);
+    cellular_metrics_family(pOut, "cellular_fork_lost", CELLULAR_METRIC_COUNTER, "Forked children which died before their test returned");
+    cellular_metrics_sample(pOut, "cellular_fork_lost_total", (double)gStats.lost, NULL);
+    cellular_metrics_family(pOut, "cellular_fork_overhead_seconds", CELLULAR_METRIC_GAUGE, "Fork and reap time of all forked tests");
+    cellular_metrics_sample(pOut, "cellular_fork_overhead_seconds", (double)gStats.overhead_ns / 1e9, NULL);
+    if (gStats.reinit_ns > 0)
+    {
+        cellular_metrics_family(pOut, "cellular_fork_reinit_seconds", CELLULAR_METRIC_GAUGE, "One serial re-initialization until registered");
+        cellular_metrics_sample(pOut, "cellular_fork_reinit_seconds", (double)gStats.reinit_ns / 1e9, NULL);
+        cellular_metrics_family(pOut, "cellular_fork_saved_seconds", CELLULAR_METRIC_GAUGE,
+                                "Serial re-initialization before every forked test less the fork overhead");
+        cellular_metrics_sample(pOut, "cellular_fork_saved_seconds",
+                                ((double)gStats.tests * (double)gStats.reinit_ns - (double)gStats.overhead_ns) / 1e9, NULL);
+    }
+}
+
+int cellular_fork_start(void)
+{
+    if (gStarted)
+    {
+        return RETURN_OK;
+    }
+    cellular_trace_set_runner(fork_runner);
+    cellular_trace_set_abandon(abandon_child);
+    cellular_metrics_add_collector(collect_metrics);
+    gServer = getpid();
+    gStarted = 1;
+    return RETURN_OK;
+}
+
+int cellular_fork_active(void)
+{
+    return (gStarted && (getpid() == gServer)) ? 1 : 0;
+}
+
+void cellular_fork_get_stats(CellularForkStats_t *pStats)
+{
+    if (pStats != NULL)
+    {
+        *pStats = gStats;
+    }
+}
+
+void cellular_fork_report(void)
+{
+    unsigned int completed;
+
+    if (!gStarted)
+    {
+        return;
+    }
+    reap_child();
+    completed = gStats.tests - gStats.lost;
+    UT_LOG_INFO("Fork server: %u tests forked, %u children lost, %.1f ms fork and reap overhead, %.0f us per test", gStats.tests,
+                gStats.lost, (double)gStats.overhead_ns / 1e6, (completed > 0) ? (double)gStats.overhead_ns / 1e3 / (double)completed : 0.0);
+    if (gStats.reinit_ns > 0)
+    {
+        UT_LOG_INFO("Fork server: a serial re-initialization takes %.1f ms, %.1f ms before every test against %.1f ms of fork overhead",
+                    (double)gStats.reinit_ns / 1e6, (double)gStats.tests * (double)gStats.reinit_ns / 1e6, (double)gStats.overhead_ns / 1e6);
+    }
+}
@@ -0,0 +1,1150 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:*
+ * Copyright 2023 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file cellular_fuzz.c
+ * @brief In-process fuzzing of the HAL calls which take structs and strings
+ */
+
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <ut_log.h>
+#include "cellular_fuzz.h"
+#include "cellular_bench.h"
+#include "cellular_hal.h"
+#include "cellular_log.h"
+#include "cellular_sim.h"
+
+/* Calls one target makes at most, so a long input cannot turn into a long exec */
+#define MAX_RECORDS       32
+#define MAX_OUTCOMES      4096
+#define MAX_LOGGED        5
+#define MAX_SLOW_SAVED    8
+#define READ_BACK_LENGTH  256
+#define CRASH_STACK_SIZE  (64 * 1024)
+
+typedef struct
+{
+    const uint8_t *pData;
+    size_t size;
+    size_t pos;
+} FuzzReader_t;
+
+typedef uint32_t (*FuzzTargetFn_t)(FuzzReader_t *pIn);
+
+typedef struct
+{
+    const char *pName;
+    FuzzTargetFn_t pFn;
+    const char *const *ppDictionary;    /*!< Tokens inserted by the mutator, NULL terminated */
+} FuzzTarget_t;
+
+typedef struct
+{
+    uint8_t *pData;
+    size_t size;
+} FuzzInput_t;
+
+/* Set by a target when its result does not match the read-back */
+static const char *gpCheck = NULL;
+
+/* Input of the running exec, saved by the crash handler */
+static const char *gpCrashTarget = NULL;
+static const char *gpCrashDir = NULL;
+static const uint8_t *gpCrashData = NULL;
+static size_t gCrashSize = 0;
+
+static uint32_t gRandom = 1;
+
+static uint32_t next_random(void)
+{
+    gRandom ^= gRandom << 13;
+    gRandom ^= gRandom >> 17;
+    gRandom ^= gRandom << 5;
+    return gRandom;
+}
+
+static uint32_t hash_bytes(const uint8_t *pData, size_t size)
+{
+    uint32_t hash = 2166136261u;
+    size_t i;
+
+    for (i = 0; i < size; i++)
+    {
+        hash = (hash ^ pData[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static uint32_t mix(uint32_t hash, int32_t value)
+{
+    return hash_bytes((const uint8_t *)&value, sizeof(value)) ^ (hash * 31u);
+}
+
+/* Outcome of a target making several calls: the set of call results seen, so their order does not count as new */
+static uint32_t mark(uint32_t outcome, int32_t value)
+{
+    return outcome | (1u << (mix(0, value) % 32));
+}
+
+static void check(int condition, const char *pWhat)
+{
+    if (!condition && (gpCheck == NULL))
+    {
+        gpCheck = pWhat;
+    }
+}
+
+/* Reading past the end gives zeros, so every input decodes */
+static uint8_t take_u8(FuzzReader_t *pIn)
+{
+    return (pIn->pos < pIn->size) ? pIn->pData[pIn->pos++] : 0;
+}
+
+static uint32_t take_u32(FuzzReader_t *pIn)
+{
+    uint32_t value = 0;
+    unsigned int i;
+
+    for (i = 0; i < 4; i++)
+    {
+        value |= (uint32_t)take_u8(pIn) << (8 * i);
+    }
+    return value;
+}
+
+/* Enum and small integer fields: one byte, signed, so both the valid values and the edges are one mutation away */
+static int take_small(FuzzReader_t *pIn)
+{
+    return (int)(int8_t)take_u8(pIn);
+}
+
+/* A length byte and that many bytes, clipped to the array and NUL terminated */
+static void take_string(FuzzReader_t *pIn, char *pOut, size_t size)
+{
+    size_t length = take_u8(pIn);
+
+    if (length > size - 1)
+    {
+        length = size - 1;
+    }
+    if (length > pIn->size - pIn->pos)
+    {
+        length = pIn->size - pIn->pos;
+    }
+    memcpy(pOut, &pIn->pData[pIn->pos], length);
+    pOut[length] = '\0';
+    pIn->pos += length;
+}
+
+static void take_profile(FuzzReader_t *pIn, CellularProfileStruct *pProfile)
+{
+    memset(pProfile, 0, sizeof(*pProfile));
+    pProfile->ProfileID = take_small(pIn);
+    pProfile->ProfileType = (CellularProfileType_t)take_small(pIn);
+    pProfile->PDPContextNumber = take_small(pIn);
+    pProfile->PDPType = (CellularPDPType_t)take_small(pIn);
+    pProfile->PDPAuthentication = (CellularPDPAuthentication_t)take_small(pIn);
+    pProfile->PDPNetworkConfig = (CellularPDPNetworkConfig_t)take_small(pIn);
+    take_string(pIn, pProfile->ProfileName, sizeof(pProfile->ProfileName));
+    take_string(pIn, pProfile->APN, sizeof(pProfile->APN));
+    take_string(pIn, pProfile->Username, sizeof(pProfile->Username));
+    take_string(pIn, pProfile->Password, sizeof(pProfile->Password));
+    take_string(pIn, pProfile->Proxy, sizeof(pProfile->Proxy));
+    pProfile->ProxyPort = take_u32(pIn);
+    pProfile->bIsNoRoaming = take_u8(pIn);
+    pProfile->bIsAPNDisabled = take_u8(pIn);
+    pProfile->bIsThisDefaultProfile = take_u8(pIn);
+}
+
+static size_t put_string(uint8_t *pOut, const char *pString)
+{
+    size_t length = strlen(pString);
+
+    pOut[0] = (uint8_t)length;
+    memcpy(&pOut[1], pString, length);
+    return length + 1;
+}
+
+/* The inverse of take_profile(), for the seeds */
+static size_t put_profile(uint8_t *pOut, int profileId, CellularPDPType_t pdpType, CellularPDPAuthentication_t authentication)
+{
+    size_t size = 0;
+
+    pOut[size++] = (uint8_t)profileId;
+    pOut[size++] = CELLULAR_PROFILE_TYPE_3GPP;
+    pOut[size++] = 1;
+    pOut[size++] = (uint8_t)pdpType;
+    pOut[size++] = (uint8_t)authentication;
+    pOut[size++] = CELLULAR_PDP_NETWORK_CONFIG_NAS;
+    size += put_string(&pOut[size], "Fuzz");
+    size += put_string(&pOut[size], "internet");
+    size += put_string(&pOut[size], "user");
+    size += put_string(&pOut[size], "password");
+    size += put_string(&pOut[size], "192.168.0.1");
+    pOut[size++] = 0x90;
+    pOut[size++] = 0x1F;
+    pOut[size++] = 0;
+    pOut[size++] = 0;
+    pOut[size++] = 0;
+    pOut[size++] = 0;
+    pOut[size++] = 0;
+    return size;
+}
+
+static int profile_equal(const CellularProfileStruct *pA, const CellularProfileStruct *pB)
+{
+    return ((pA->ProfileID == pB->ProfileID) && (pA->ProfileType == pB->ProfileType) &&
+            (pA->PDPContextNumber == pB->PDPContextNumber) && (pA->PDPType == pB->PDPType) &&
+            (pA->PDPAuthentication == pB->PDPAuthentication) && (pA->PDPNetworkConfig == pB->PDPNetworkConfig) &&
+            (strncmp(pA->ProfileName, pB->ProfileName, sizeof(pA->ProfileName)) == 0) &&
+            (strncmp(pA->APN, pB->APN, sizeof(pA->APN)) == 0) &&
+            (strncmp(pA->Username, pB->Username, sizeof(pA->Username)) == 0) &&
+            (strncmp(pA->Password, pB->Password, sizeof(pA->Password)) == 0) &&
+            (strncmp(pA->Proxy, pB->Proxy, sizeof(pA->Proxy)) == 0) &&
+            (pA->ProxyPort == pB->ProxyPort) && (pA->bIsNoRoaming == pB->bIsNoRoaming) &&
+            (pA->bIsAPNDisabled == pB->bIsAPNDisabled) && (pA->bIsThisDefaultProfile == pB->bIsThisDefaultProfile)) ? 1 : 0;
+}
+
+/* Index of the listed profile with the ID, -1 when not listed */
+static int find_listed(const CellularProfileStruct *pList, int count, int profileId)
+{
+    int i;
+
+    for (i = 0; i < count; i++)
+    {
+        if (pList[i].ProfileID == profileId)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int lists_equal(const CellularProfileStruct *pA, int countA, const CellularProfileStruct *pB, int countB)
+{
+    int i;
+
+    if (countA != countB)
+    {
+        return 0;
+    }
+    for (i = 0; i < countA; i++)
+    {
+        if (!profile_equal(&pA[i], &pB[i]))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+typedef enum
+{
+    PROFILE_CREATE = 0,
+    PROFILE_MODIFY,
+    PROFILE_DELETE
+} ProfileOp_t;
+
+/* Applies a profile API to every record of the input, checking the list after each call */
+static uint32_t run_profile_op(FuzzReader_t *pIn, ProfileOp_t op)
+{
+    CellularProfileStruct profile;
+    CellularProfileStruct *pBefore = NULL;
+    CellularProfileStruct *pAfter = NULL;
+    int countBefore = 0, countAfter = 0, index;
+    uint32_t outcome = 0;
+    unsigned int record;
+    int result;
+
+    for (record = 0; (record < MAX_RECORDS) && (pIn->pos < pIn->size); record++)
+    {
+        take_profile(pIn, &profile);
+        if (cellular_hal_get_profile_list(&pBefore, &countBefore) != RETURN_OK)
+        {
+            check(0, "profile list unavailable");
+            break;
+        }
+        result = (op == PROFILE_CREATE) ? cellular_hal_profile_create(&profile, NULL) :
+                 (op == PROFILE_MODIFY) ? cellular_hal_profile_modify(&profile, NULL) :
+                 cellular_hal_profile_delete(&profile, NULL);
+        if (cellular_hal_get_profile_list(&pAfter, &countAfter) != RETURN_OK)
+        {
+            free(pBefore);
+            check(0, "profile list unavailable");
+            break;
+        }
+        index = find_listed(pAfter, countAfter, profile.ProfileID);
+        if (result != RETURN_OK)
+        {
+            check(lists_equal(pBefore, countBefore, pAfter, countAfter), "rejected call changed the profile list");
+        }
+        else if (op == PROFILE_CREATE)
+        {
+            check((countAfter == countBefore + 1) && (index >= 0) && profile_equal(&pAfter[index], &profile),
+                  "created profile not listed as given");
+        }
+        else if (op == PROFILE_MODIFY)
+        {
+            check((countAfter == countBefore) && (index >= 0) && profile_equal(&pAfter[index], &profile),
+                  "modified profile not listed as given");
+        }
+        else
+        {
+            check((countAfter == countBefore - 1) && (index < 0), "deleted profile still listed");
+        }
+        outcome = mark(outcome, (result * 64) + countAfter);
+        free(pBefore);
+        free(pAfter);
+        pBefore = NULL;
+        pAfter = NULL;
+    }
+    return outcome;
+}
+
+static uint32_t target_profile_create(FuzzReader_t *pIn)
+{
+    return run_profile_op(pIn, PROFILE_CREATE);
+}
+
+static uint32_t target_profile_modify(FuzzReader_t *pIn)
+{
+    return run_profile_op(pIn, PROFILE_MODIFY);
+}
+
+static uint32_t target_profile_delete(FuzzReader_t *pIn)
+{
+    return run_profile_op(pIn, PROFILE_DELETE);
+}
+
+static uint32_t target_init(FuzzReader_t *pIn)
+{
+    CellularContextInitInputStruct input;
+
+    memset(&input, 0, sizeof(input));
+    input.enIPFamilyPreference = (CellularIPFamilyPref_t)take_small(pIn);
+    input.enPreferenceTechnology = (CellularPrefAccessTechnology_t)take_small(pIn);
+    take_profile(pIn, &input.stIfInput);
+    return mix(0, cellular_hal_init(&input));
+}
+
+static int ip_ready_cb(CellularIPStruct *pstIPStruct, CellularDeviceIPReadyStatus_t ip_ready_status)
+{
+    (void)pstIPStruct;
+    (void)ip_ready_status;
+    return RETURN_OK;
+}
+
+static int packet_status_cb(char *device_name, CellularNetworkIPType_t ip_type, CellularNetworkPacketStatus_t packet_service_status)
+{
+    (void)device_name;
+    (void)ip_type;
+    (void)packet_service_status;
+    return RETURN_OK;
+}
+
+/* A flags byte chooses a profile or none and callbacks or none, then the IP type and the profile */
+static uint32_t target_start_network(FuzzReader_t *pIn)
+{
+    CellularNetworkCBStruct callbacks = { ip_ready_cb, packet_status_cb };
+    CellularProfileStruct profile;
+    CellularInterfaceStatus_t status;
+    uint8_t flags = take_u8(pIn);
+    CellularNetworkIPType_t ipType = (CellularNetworkIPType_t)take_small(pIn);
+    int result;
+
+    take_profile(pIn, &profile);
+    result = cellular_hal_start_network(ipType, (flags & 1) ? &profile : NULL, (flags & 2) ? NULL : &callbacks);
+    if (result == RETURN_OK)
+    {
+        check(cellular_hal_get_current_modem_interface_status(&status) == RETURN_OK, "interface status unavailable after start");
+    }
+    return mix(mix(0, flags & 3), result);
+}
+
+static uint32_t target_stop_network(FuzzReader_t *pIn)
+{
+    uint32_t outcome = 0;
+    unsigned int record;
+
+    for (record = 0; (record < MAX_RECORDS) && (pIn->pos < pIn->size); record++)
+    {
+        outcome = mark(outcome, cellular_hal_stop_network((CellularNetworkIPType_t)take_small(pIn)));
+    }
+    return outcome;
+}
+
+static uint32_t target_set_modem_operating_configuration(FuzzReader_t *pIn)
+{
+    uint32_t outcome = 0;
+    unsigned int record;
+    int value, result;
+
+    for (record = 0; (record < MAX_RECORDS) && (pIn->pos < pIn->size); record++)
+    {
+        value = take_small(pIn);
+        result = cellular_hal_set_modem_operating_configuration((CellularModemOperatingConfiguration_t)value);
+        outcome = mark(outcome, (result == RETURN_OK) ? value : -1000);
+    }
+    return outcome;
+}
+
+/* Records of slot and enable bytes; an accepted call shows in CardEnable, a rejected one changes nothing */
+static uint32_t target_sim_power_enable(FuzzReader_t *pIn)
+{
+    CellularUICCSlotInfoStruct before, after;
+    unsigned int slot;
+    unsigned char enable;
+    uint32_t outcome = 0;
+    unsigned int record;
+    int result, known;
+
+    for (record = 0; (record < MAX_RECORDS) && (pIn->pos < pIn->size); record++)
+    {
+        slot = take_u8(pIn);
+        enable = take_u8(pIn);
+        memset(&before, 0, sizeof(before));
+        memset(&after, 0, sizeof(after));
+        known = (cellular_hal_get_uicc_slot_info(slot, &before) == RETURN_OK);
+        result = cellular_hal_sim_power_enable(slot, enable);
+        if (result == RETURN_OK)
+        {
+            check(known && (cellular_hal_get_uicc_slot_info(slot, &after) == RETURN_OK) && (after.CardEnable == enable),
+                  "powered slot does not report CardEnable as set");
+        }
+        else if (known)
+        {
+            check((cellular_hal_get_uicc_slot_info(slot, &after) == RETURN_OK) && (after.CardEnable == before.CardEnable),
+                  "rejected call changed CardEnable");
+        }
+        outcome = mark(outcome, (result * 2) + known);
+    }
+    return outcome;
+}
+
+/* Records of 32-bit slot indexes, which must be accepted exactly below the slot count */
+static uint32_t target_get_uicc_slot_info(FuzzReader_t *pIn)
+{
+    CellularUICCSlotInfoStruct info;
+    unsigned int slots = 0;
+    unsigned int index;
+    uint32_t outcome = 0;
+    unsigned int record;
+    int result;
+
+    check(cellular_hal_get_total_no_of_uicc_slots(&slots) == RETURN_OK, "slot count unavailable");
+    for (record = 0; (record < MAX_RECORDS) && (pIn->pos < pIn->size); record++)
+    {
+        index = take_u32(pIn);
+        result = cellular_hal_get_uicc_slot_info(index, &info);
+        check((result == RETURN_OK) == (index < slots), "slot index accepted outside of the slot count or rejected inside it");
+        outcome = mark(outcome, result);
+    }
+    return outcome;
+}
+
+/* The whole input is the string; an accepted value is read back unchanged, a rejected one leaves the previous */
+static uint32_t target_set_modem_preferred_radio_technology(FuzzReader_t *pIn)
+{
+    char rat[CELLULAR_FUZZ_MAX_INPUT + 1];
+    char before[READ_BACK_LENGTH];
+    char after[READ_BACK_LENGTH];
+    int result;
+
+    memcpy(rat, pIn->pData, pIn->size);
+    rat[pIn->size] = '\0';
+    pIn->pos = pIn->size;
+    memset(before, 0, sizeof(before));
+    memset(after, 0, sizeof(after));
+    cellular_hal_get_modem_preferred_radio_technology(before);
+    result = cellular_hal_set_modem_preferred_radio_technology(rat);
+    check(cellular_hal_get_modem_preferred_radio_technology(after) == RETURN_OK, "preferred technology unavailable");
+    check(strcmp(after, (result == RETURN_OK) ? rat : before) == 0,
+          (result == RETURN_OK) ? "accepted technology not read back" : "rejected technology changed the preferred one");
+    return mix(mix(0, result), (int32_t)strlen(rat));
+}
+
+static const char *const gRatTokens[] = { "AUTO", "CDMA20001X", "EVDO", "GSM", "UMTS", "LTE", "NR", ",", NULL };
+static const char *const gValueTokens[] = { "\xff\xff\xff\xff", "\x7f", "\x80", "\x00\x00\x00\x80", NULL };
+
+static const FuzzTarget_t gTargets[] =
+{
+    { "init", target_init, gValueTokens },
+    { "sim_power_enable", target_sim_power_enable, gValueTokens },
+    { "get_uicc_slot_info", target_get_uicc_slot_info, gValueTokens },
+    { "profile_create", target_profile_create, gValueTokens },
+    { "profile_delete", target_profile_delete, gValueTokens },
+    { "profile_modify", target_profile_modify, gValueTokens },
+    { "start_network", target_start_network, gValueTokens },
+    { "stop_network", target_stop_network, gValueTokens },
+    { "set_modem_operating_configuration", target_set_modem_operating_configuration, gValueTokens },
+    { "set_modem_preferred_radio_technology", target_set_modem_preferred_radio_technology, gRatTokens },
+};
+
+#define TARGET_COUNT (sizeof(gTargets) / sizeof(gTargets[0]))
+
+static const FuzzTarget_t *find_target(const char *pName)
+{
+    unsigned int i;
+
+    for (i = 0; i < TARGET_COUNT; i++)
+    {
+        if (strcmp(gTargets[i].pName, pName) == 0)
+        {
+            return &gTargets[i];
+        }
+    }
+    return NULL;
+}
+
+/* Built-in seeds: valid calls, so mutation starts next to the accepted paths */
+static size_t make_seed(const FuzzTarget_t *pTarget, unsigned int index, uint8_t *pOut)
+{
+    static const char *const rats[] = { "AUTO", "LTE", "GSM,UMTS,LTE,NR" };
+    size_t size = 0;
+
+    if (pTarget->pFn == target_set_modem_preferred_radio_technology)
+    {
+        if (index >= sizeof(rats) / sizeof(rats[0]))
+        {
+            return 0;
+        }
+        size = strlen(rats[index]);
+        memcpy(pOut, rats[index], size);
+        return size;
+    }
+    if (index > 0)
+    {
+        return 0;
+    }
+    if (pTarget->pFn == target_init)
+    {
+        pOut[size++] = IP_FAMILY_IPV4_IPV6;
+        pOut[size++] = PREF_LTE;
+        size += put_profile(&pOut[size], 1, CELLULAR_PDP_TYPE_IPV4_OR_IPV6, CELLULAR_PDP_AUTHENTICATION_NONE);
+    }
+    else if (pTarget->pFn == target_start_network)
+    {
+        pOut[size++] = 1;
+        pOut[size++] = CELLULAR_NETWORK_IP_FAMILY_IPV4;
+        size += put_profile(&pOut[size], 1, CELLULAR_PDP_TYPE_IPV4, CELLULAR_PDP_AUTHENTICATION_PAP);
+    }
+    else if ((pTarget->pFn == target_profile_create) || (pTarget->pFn == target_profile_modify) ||
+             (pTarget->pFn == target_profile_delete))
+    {
+        /* The simulator comes up with profile 1, so modify and delete find it and create adds a second */
+        size += put_profile(&pOut[size], (pTarget->pFn == target_profile_create) ? 2 : 1, CELLULAR_PDP_TYPE_IPV6,
+                            CELLULAR_PDP_AUTHENTICATION_CHAP);
+    }
+    else if (pTarget->pFn == target_get_uicc_slot_info)
+    {
+        memset(pOut, 0, 8);
+        pOut[4] = 1;
+        size = 8;
+    }
+    else
+    {
+        /* Records of one or two small values */
+        pOut[size++] = 0;
+        pOut[size++] = 1;
+        pOut[size++] = 1;
+        pOut[size++] = 0;
+    }
+    return size;
+}
+
+/* Mutations stacked on a copy of a corpus input */
+static size_t mutate(const FuzzTarget_t *pTarget, uint8_t *pData, size_t size, const FuzzInput_t *pOther)
+{
+    static const uint8_t interesting[] = { 0x00, 0x01, 0x02, 0x03, 0x04, 0x7f, 0x80, 0xff, ',' };
+    const char *pToken;
+    unsigned int count = 1 + (next_random() % 4);
+    unsigned int tokens = 0;
+    size_t pos, length, i;
+
+    while (pTarget->ppDictionary[tokens] != NULL)
+    {
+        tokens++;
+    }
+    while (count-- > 0)
+    {
+        pos = (size > 0) ? next_random() % size : 0;
+        switch (next_random() % 8)
+        {
+            case 0:
+                if (size > 0)
+                {
+                    pData[pos] ^= (uint8_t)(1u << (next_random() % 8));
+                }
+                break;
+            case 1:
+                if (size > 0)
+                {
+                    pData[pos] = (uint8_t)next_random();
+                }
+                break;
+            case 2:
+                if (size > 0)
+                {
+                    pData[pos] = interesting[next_random() % sizeof(interesting)];
+                }
+                break;
+            case 3:
+                pToken = pTarget->ppDictionary[next_random() % tokens];
+                length = strlen(pToken);
+                if ((pToken[0] == '\0') || (size + length > CELLULAR_FUZZ_MAX_INPUT))
+                {
+                    break;
+                }
+                memmove(&pData[pos + length], &pData[pos], size - pos);
+                memcpy(&pData[pos], pToken, length);
+                size += length;
+                break;
+            case 4:
+                if (size > 0)
+                {
+                    length = 1 + (next_random() % (size - pos));
+                    memmove(&pData[pos], &pData[pos + length], size - pos - length);
+                    size -= length;
+                }
+                break;
+            case 5:
+                length = 1 + (next_random() % 8);
+                if (size + length > CELLULAR_FUZZ_MAX_INPUT)
+                {
+                    break;
+                }
+                memmove(&pData[pos + length], &pData[pos], size - pos);
+                for (i = 0; i < length; i++)
+                {
+                    pData[pos + i] = (uint8_t)next_random();
+                }
+                size += length;
+                break;
+            case 6:
+                /* Splice: this input up to pos, the other one from a point of its own */
+                if ((pOther != NULL) && (pOther->size > 0))
+                {
+                    i = next_random() % pOther->size;
+                    length = pOther->size - i;
+                    if (pos + length > CELLULAR_FUZZ_MAX_INPUT)
+                    {
+                        length = CELLULAR_FUZZ_MAX_INPUT - pos;
+                    }
+                    memcpy(&pData[pos], &pOther->pData[i], length);
+                    size = pos + length;
+                }
+                break;
+            default:
+                if (size > 1)
+                {
+                    i = next_random() % size;
+                    length = 1 + (next_random() % (size - ((i > pos) ? i : pos)));
+                    memmove(&pData[pos], &pData[i], length);
+                }
+                break;
+        }
+    }
+    return size;
+}
+
+static uint32_t exec_input(const FuzzTarget_t *pTarget, const uint8_t *pData, size_t size)
+{
+    FuzzReader_t in;
+
+    if (cellular_sim_available())
+    {
+        cellular_sim_reset();
+    }
+    in.pData = pData;
+    in.size = size;
+    in.pos = 0;
+    gpCheck = NULL;
+    return pTarget->pFn(&in);
+}
+
+unsigned int cellular_fuzz_target_count(void)
+{
+    return (unsigned int)TARGET_COUNT;
+}
+
+const char *cellular_fuzz_target_name(unsigned int index)
+{
+    return (index < TARGET_COUNT) ? gTargets[index].pName : NULL;
+}
+
+int cellular_fuzz_one(const char *pTarget, const uint8_t *pData, size_t size, uint32_t *pOutcome)
+{
+    const FuzzTarget_t *pFound = (pTarget != NULL) ? find_target(pTarget) : NULL;
+    uint8_t empty = 0;
+    uint32_t outcome;
+
+    if ((pFound == NULL) || ((pData == NULL) && (size > 0)))
+    {
+        return RETURN_ERROR;
+    }
+    outcome = exec_input(pFound, (pData != NULL) ? pData : &empty, (size > CELLULAR_FUZZ_MAX_INPUT) ? CELLULAR_FUZZ_MAX_INPUT : size);
+    if (pOutcome != NULL)
+    {
+        *pOutcome = outcome;
+    }
+    return (gpCheck == NULL) ? RETURN_OK : RETURN_ERROR;
+}
+
+/* Appends to a fixed buffer without the C library, for the crash handler */
+static size_t append(char *pOut, size_t used, size_t size, const char *pString)
+{
+    while ((*pString != '\0') && (used + 1 < size))
+    {
+        pOut[used++] = *pString++;
+    }
+    pOut[used] = '\0';
+    return used;
+}
+
+static void artifact_path(char *pPath, size_t size, const char *pDir, const char *pKind, const char *pTarget, uint32_t hash)
+{
+    static const char digits[] = "0123456789abcdef";
+    char hex[9];
+    size_t used;
+    int i;
+
+    for (i = 7; i >= 0; i--)
+    {
+        hex[i] = digits[hash & 0xF];
+        hash >>= 4;
+    }
+    hex[8] = '\0';
+    used = append(pPath, 0, size, pDir);
+    used = append(pPath, used, size, "/");
+    used = append(pPath, used, size, pKind);
+    if (pTarget != NULL)
+    {
+        used = append(pPath, used, size, "-");
+        used = append(pPath, used, size, pTarget);
+        used = append(pPath, used, size, "-");
+    }
+    append(pPath, used, size, hex);
+}
+
+static int save_file(const char *pPath, const uint8_t *pData, size_t size)
+{
+    int fd = open(pPath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    ssize_t written = 0;
+
+    if (fd < 0)
+    {
+        return -1;
+    }
+    if (size > 0)
+    {
+        written = write(fd, pData, size);
+    }
+    close(fd);
+    return (written == (ssize_t)size) ? 0 : -1;
+}
+
+static void crash_handler(int signo)
+{
+    char path[512];
+    char message[600];
+    size_t used;
+
+    if ((gpCrashDir != NULL) && (gpCrashData != NULL))
+    {
+        artifact_path(path, sizeof(path), gpCrashDir, "crash", gpCrashTarget, hash_bytes(gpCrashData, gCrashSize));
+        save_file(path, gpCrashData, gCrashSize);
+        used = append(message, 0, sizeof(message), "Fuzz: crash saved as ");
+        used = append(message, used, sizeof(message), path);
+        used = append(message, used, sizeof(message), "\n");
+        if (write(STDERR_FILENO, message, used) != (ssize_t)used)
+        {
+            /* Nothing else to report to, the file is what matters */
+        }
+    }
+    /* The action was reset on entry, so this ends the process the usual way and a sanitizer or core still sees it */
+    raise(signo);
+}
+
+static const int gCrashSignals[] = { SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT };
+
+#define CRASH_SIGNAL_COUNT (sizeof(gCrashSignals) / sizeof(gCrashSignals[0]))
+
+static void catch_crashes(struct sigaction *pOld, stack_t *pOldStack, void *pStack)
+{
+    struct sigaction action;
+    stack_t stack;
+    unsigned int i;
+
+    stack.ss_sp = pStack;
+    stack.ss_size = CRASH_STACK_SIZE;
+    stack.ss_flags = 0;
+    sigaltstack(&stack, pOldStack);
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = crash_handler;
+    action.sa_flags = SA_RESETHAND | SA_ONSTACK | SA_NODEFER;
+    sigemptyset(&action.sa_mask);
+    for (i = 0; i < CRASH_SIGNAL_COUNT; i++)
+    {
+        sigaction(gCrashSignals[i], &action, &pOld[i]);
+    }
+}
+
+static void release_crashes(const struct sigaction *pOld, const stack_t *pOldStack)
+{
+    unsigned int i;
+
+    for (i = 0; i < CRASH_SIGNAL_COUNT; i++)
+    {
+        sigaction(gCrashSignals[i], &pOld[i], NULL);
+    }
+    sigaltstack(pOldStack, NULL);
+}
+
+static int add_input(FuzzInput_t *pCorpus, unsigned int *pCount, const uint8_t *pData, size_t size)
+{
+    uint8_t *pCopy;
+
+    if (*pCount >= CELLULAR_FUZZ_MAX_CORPUS)
+    {
+        return -1;
+    }
+    pCopy = (uint8_t *)malloc((size > 0) ? size : 1);
+    if (pCopy == NULL)
+    {
+        return -1;
+    }
+    memcpy(pCopy, pData, size);
+    pCorpus[*pCount].pData = pCopy;
+    pCorpus[*pCount].size = size;
+    (*pCount)++;
+    return 0;
+}
+
+/* Returns 1 when the outcome was not seen before; a full table treats everything as seen */
+static int new_outcome(uint32_t *pSeen, unsigned int *pCount, uint32_t outcome)
+{
+    uint32_t key = (outcome != 0) ? outcome : 1;
+    unsigned int slot = key % MAX_OUTCOMES;
+    unsigned int probes;
+
+    for (probes = 0; probes < MAX_OUTCOMES; probes++)
+    {
+        if (pSeen[slot] == key)
+        {
+            return 0;
+        }
+        if (pSeen[slot] == 0)
+        {
+            if (*pCount + 1 >= MAX_OUTCOMES)
+            {
+                return 0;
+            }
+            pSeen[slot] = key;
+            (*pCount)++;
+            return 1;
+        }
+        slot = (slot + 1) % MAX_OUTCOMES;
+    }
+    return 0;
+}
+
+static void load_corpus(const char *pDir, FuzzInput_t *pCorpus, unsigned int *pCount)
+{
+    uint8_t data[CELLULAR_FUZZ_MAX_INPUT];
+    char path[1024];
+    struct dirent *pEntry;
+    DIR *pHandle = opendir(pDir);
+    ssize_t size;
+    int fd;
+
+    if (pHandle == NULL)
+    {
+        return;
+    }
+    while ((pEntry = readdir(pHandle)) != NULL)
+    {
+        if (pEntry->d_name[0] == '.')
+        {
+            continue;
+        }
+        snprintf(path, sizeof(path), "%s/%s", pDir, pEntry->d_name);
+        fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            continue;
+        }
+        size = read(fd, data, sizeof(data));
+        close(fd);
+        if ((size >= 0) && (add_input(pCorpus, pCount, data, (size_t)size) != 0))
+        {
+            break;
+        }
+    }
+    closedir(pHandle);
+}
+
+int cellular_fuzz_run(const char *pTarget, const CellularFuzzOptions_t *pOptions, CellularFuzzStats_t *pStats)
+{
+    const FuzzTarget_t *pFound = (pTarget != NULL) ? find_target(pTarget) : NULL;
+    struct sigaction oldActions[CRASH_SIGNAL_COUNT];
+    stack_t oldStack;
+    CellularFuzzStats_t stats;
+    FuzzInput_t *pCorpus = NULL;
+    uint32_t *pSeen = NULL;
+    uint8_t *pStack = NULL;
+    uint8_t data[CELLULAR_FUZZ_MAX_INPUT];
+    char corpusDir[512];
+    char path[1024];
+    unsigned int corpusCount = 0, parent, i;
+    uint64_t start, end, execStart, execNs, slowNs;
+    uint32_t outcome;
+    size_t size;
+    int result = RETURN_OK;
+
+    if ((pFound == NULL) || (pOptions == NULL) || ((pOptions->runs == 0) && (pOptions->seconds == 0)))
+    {
+        return RETURN_ERROR;
+    }
+    pCorpus = (FuzzInput_t *)calloc(CELLULAR_FUZZ_MAX_CORPUS, sizeof(FuzzInput_t));
+    pSeen = (uint32_t *)calloc(MAX_OUTCOMES, sizeof(uint32_t));
+    pStack = (uint8_t *)malloc(CRASH_STACK_SIZE);
+    if ((pCorpus == NULL) || (pSeen == NULL) || (pStack == NULL))
+    {
+        free(pCorpus);
+        free(pSeen);
+        free(pStack);
+        return RETURN_ERROR;
+    }
+    if (!cellular_sim_available())
+    {
+        UT_LOG_WARNING("Fuzz %s: no simulator to reset, HAL state carries over between execs", pFound->pName);
+    }
+
+    memset(&stats, 0, sizeof(stats));
+    gRandom = (pOptions->seed != 0) ? pOptions->seed : 1;
+    slowNs = (uint64_t)((pOptions->slow_us != 0) ? pOptions->slow_us : CELLULAR_FUZZ_DEFAULT_SLOW_US) * 1000;
+    for (i = 0; (size = make_seed(pFound, i, data)) > 0; i++)
+    {
+        add_input(pCorpus, &corpusCount, data, size);
+    }
+    if (pOptions->pDir != NULL)
+    {
+        snprintf(corpusDir, sizeof(corpusDir), "%s/%s", pOptions->pDir, pFound->pName);
+        mkdir(pOptions->pDir, 0755);
+        mkdir(corpusDir, 0755);
+        load_corpus(corpusDir, pCorpus, &corpusCount);
+    }
+    /* The starting inputs count as seen, so only mutations add to the corpus */
+    for (i = 0; i < corpusCount; i++)
+    {
+        new_outcome(pSeen, &stats.outcomes, exec_input(pFound, pCorpus[i].pData, pCorpus[i].size));
+    }
+
+    gpCrashTarget = pFound->pName;
+    gpCrashDir = pOptions->pDir;
+    gpCrashData = data;
+    catch_crashes(oldActions, &oldStack, pStack);
+    start = cellular_bench_now_ns();
+    end = (pOptions->seconds > 0) ? start + (uint64_t)pOptions->seconds * 1000000000ull : 0;
+    execStart = start;
+    while (((pOptions->runs == 0) || (stats.execs < pOptions->runs)) && ((end == 0) || (execStart < end)))
+    {
+        parent = next_random() % corpusCount;
+        size = pCorpus[parent].size;
+        memcpy(data, pCorpus[parent].pData, size);
+        size = mutate(pFound, data, size, &pCorpus[next_random() % corpusCount]);
+        gCrashSize = size;
+
+        execStart = cellular_bench_now_ns();
+        outcome = exec_input(pFound, data, size);
+        execNs = cellular_bench_now_ns() - execStart;
+        stats.execs++;
+        if (execNs > stats.max_exec_ns)
+        {
+            stats.max_exec_ns = execNs;
+        }
+
+        if (gpCheck != NULL)
+        {
+            stats.failures++;
+            if (pOptions->pDir != NULL)
+            {
+                artifact_path(path, sizeof(path), pOptions->pDir, "fail", pFound->pName, hash_bytes(data, size));
+                save_file(path, data, size);
+            }
+            if (stats.failures <= MAX_LOGGED)
+            {
+                UT_LOG_ERROR("Fuzz %s: %s, %zu byte input%s%s", pFound->pName, gpCheck, size,
+                             (pOptions->pDir != NULL) ? " saved as " : "", (pOptions->pDir != NULL) ? path : "");
+            }
+        }
+        if (execNs > slowNs)
+        {
+            stats.slow++;
+            if ((pOptions->pDir != NULL) && (stats.slow <= MAX_SLOW_SAVED))
+            {
+                artifact_path(path, sizeof(path), pOptions->pDir, "slow", pFound->pName, hash_bytes(data, size));
+                save_file(path, data, size);
+                UT_LOG_WARNING("Fuzz %s: exec of %llu us saved as %s", pFound->pName, (unsigned long long)(execNs / 1000), path);
+            }
+        }
+        if (new_outcome(pSeen, &stats.outcomes, outcome) && (add_input(pCorpus, &corpusCount, data, size) == 0) &&
+            (pOptions->pDir != NULL))
+        {
+            snprintf(path, sizeof(path), "%s/%08x", corpusDir, hash_bytes(data, size));
+            save_file(path, data, size);
+        }
+    }
+    stats.ns = cellular_bench_now_ns() - start;
+    release_crashes(oldActions, &oldStack);
+    gpCrashData = NULL;
+
+    stats.corpus = corpusCount;
+    stats.execs_per_sec = (stats.ns > 0) ? (double)stats.execs * 1e9 / (double)stats.ns : 0.0;
+    if (stats.failures > 0)
+    {
+        result = RETURN_ERROR;
+    }
+    if (pStats != NULL)
+    {
+        *pStats = stats;
+    }
+    for (i = 0; i < corpusCount; i++)
+    {
+        free(pCorpus[i].pData);
+    }
+    free(pCorpus);
+    free(pSeen);
+    free(pStack);
+    return result;
+}
+
+static unsigned long env_number(const char *pName, unsigned long fallback)
+{
+    const char *pValue = getenv(pName);
+
+    return (pValue != NULL) ? strtoul(pValue, NULL, 10) : fallback;
+}
+
+static int replay(const char *pTarget, const char *pPath)
+{
+    uint8_t data[CELLULAR_FUZZ_MAX_INPUT];
+    uint32_t outcome = 0;
+    ssize_t size;
+    int fd = open(pPath, O_RDONLY | O_CLOEXEC);
+    int result;
+
+    if (fd < 0)
+    {
+        UT_LOG_ERROR("Fuzz: cannot open [%s]", pPath);
+        return RETURN_ERROR;
+    }
+    size = read(fd, data, sizeof(data));
+    close(fd);
+    if (size < 0)
+    {
+        UT_LOG_ERROR("Fuzz: cannot read [%s]", pPath);
+        return RETURN_ERROR;
+    }
+    result = cellular_fuzz_one(pTarget, data, (size_t)size, &outcome);
+    if (result == RETURN_OK)
+    {
+        UT_LOG_INFO("Fuzz %s: %s passed, outcome %08x", pTarget, pPath, outcome);
+    }
+    else
+    {
+        UT_LOG_ERROR("Fuzz %s: %s failed: %s", pTarget, pPath, (gpCheck != NULL) ? gpCheck : "unknown target");
+    }
+    return result;
+}
+
+int cellular_fuzz_main(const char *pTargets)
+{
+    CellularFuzzOptions_t options;
+    CellularFuzzStats_t stats;
+    char list[512];
+    char *pSave = NULL;
+    char *pName;
+    unsigned int i, first;
+    int result = RETURN_OK;
+
+    if (pTargets == NULL)
+    {
+        return RETURN_ERROR;
+    }
+    snprintf(list, sizeof(list), "%s", (strcmp(pTargets, "all") == 0) ? "" : pTargets);
+    if (list[0] == '\0')
+    {
+        for (i = 0; i < TARGET_COUNT; i++)
+        {
+            strncat(list, (i > 0) ? "," : "", sizeof(list) - strlen(list) - 1);
+            strncat(list, gTargets[i].pName, sizeof(list) - strlen(list) - 1);
+        }
+    }
+    if (getenv("CELLULAR_FUZZ_INPUT") != NULL)
+    {
+        pName = strtok_r(list, ",", &pSave);
+        return (pName != NULL) ? replay(pName, getenv("CELLULAR_FUZZ_INPUT")) : RETURN_ERROR;
+    }
+
+    memset(&options, 0, sizeof(options));
+    options.seconds = (unsigned int)env_number("CELLULAR_FUZZ_SECONDS", 0);
+    options.runs = env_number("CELLULAR_FUZZ_RUNS", (options.seconds > 0) ? 0 : CELLULAR_FUZZ_DEFAULT_RUNS);
+    options.seed = (uint32_t)env_number("CELLULAR_FUZZ_SEED", (unsigned long)time(NULL));
+    options.slow_us = (unsigned int)env_number("CELLULAR_FUZZ_SLOW_US", CELLULAR_FUZZ_DEFAULT_SLOW_US);
+    options.pDir = (getenv("CELLULAR_FUZZ_DIR") != NULL) ? getenv("CELLULAR_FUZZ_DIR") : "cellular_hal_fuzz";
+    UT_LOG_INFO("Fuzz: seed %u, %llu runs and %u s per target, artifacts in %s", options.seed,
+                (unsigned long long)options.runs, options.seconds, options.pDir);
+
+    first = 1;
+    for (pName = strtok_r(list, ",", &pSave); pName != NULL; pName = strtok_r(NULL, ",", &pSave))
+    {
+        if (find_target(pName) == NULL)
+        {
+            UT_LOG_ERROR("Fuzz: unknown target [%s]", pName);
+            result = RETURN_ERROR;
+            continue;
+        }
+        if (cellular_fuzz_run(pName, &options, &stats) != RETURN_OK)
+        {
+            result = RETURN_ERROR;
+        }
+        if (first)
+        {
+            UT_LOG_INFO("| %-40s | %9s | %9s | %8s | %6s | %8s | %6s | %8s |", "Target", "execs", "execs/s",
+                        "outcomes", "corpus", "failures", "slow", "max us");
+            first = 0;
+        }
+        UT_LOG_INFO("| %-40s | %9llu | %9.0f | %8u | %6u | %8llu | %6llu | %8llu |", pName, (unsigned long long)stats.execs,
+                    stats.execs_per_sec, stats.outcomes, stats.corpus, (unsigned long long)stats.failures,
+                    (unsigned long long)stats.slow, (unsigned long long)(stats.max_exec_ns / 1000));
+        /* A crash in the next target ends the process, keep what is known so far */
+        cellular_log_flush();
+    }
+    return result;
+}
@@ -0,0 +1,685 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:*
+ * Copyright 2023 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file cellular_lock.c
+ * @brief Mutex, rwlock and condition variable contention per lock and HAL API
+ *
+ * Tracked locks live in an open addressing table filled with compare and swap, so a
+ * lookup takes no lock. An acquisition first tries the lock; only when that fails is the
+ * blocking call timed. The locks held by a thread are kept on a thread local stack, which
+ * lets unlock close the hold time without a table lookup.
+ */
+
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <ut_log.h>
+#include "cellular_lock.h"
+#include "cellular_bench.h"
+#include "cellular_metrics.h"
+
+#define MAX_LOCKS    64
+#define MAX_PAIRS    16
+#define MAX_HELD     16
+#define SCOPE_COUNT  (CELLULAR_HAL_API_COUNT + 1)
+
+typedef struct
+{
+    unsigned short waiter;
+    unsigned short holder;
+    uint64_t blocks;
+    uint64_t wait_ns;
+} LockPair_t;
+
+typedef struct
+{
+    const void *pLock;              /* Set once by compare and swap, NULL for a free slot */
+    const char *pKind;
+    unsigned int holder;            /* Scope of the last acquisition */
+    CellularLockStats_t stats[SCOPE_COUNT];
+    LockPair_t pairs[MAX_PAIRS];
+    unsigned int pairCount;
+} LockEntry_t;
+
+typedef struct
+{
+    const void *pLock;
+    LockEntry_t *pEntry;
+    unsigned int scope;
+    uint64_t since;
+} HeldLock_t;
+
+static int gStarted = 0;    /* Starts not yet stopped */
+static LockEntry_t gLocks[MAX_LOCKS];
+/* Guards the pair lists, always taken through the real functions */
+static pthread_mutex_t gPairLock = PTHREAD_MUTEX_INITIALIZER;
+
+static __thread unsigned int tScope = CELLULAR_LOCK_OUTSIDE;
+static __thread HeldLock_t tHeld[MAX_HELD];
+static __thread unsigned int tHeldCount = 0;
+
+static int (*gRealMutexLock)(pthread_mutex_t *);
+static int (*gRealMutexTrylock)(pthread_mutex_t *);
+static int (*gRealMutexUnlock)(pthread_mutex_t *);
+static int (*gRealRdlock)(pthread_rwlock_t *);
+static int (*gRealTryrdlock)(pthread_rwlock_t *);
+static int (*gRealWrlock)(pthread_rwlock_t *);
+static int (*gRealTrywrlock)(pthread_rwlock_t *);
+static int (*gRealRwUnlock)(pthread_rwlock_t *);
+static int (*gRealCondWait)(pthread_cond_t *, pthread_mutex_t *);
+static int (*gRealCondTimedwait)(pthread_cond_t *, pthread_mutex_t *, const struct timespec *);
+
+#define REAL(pointer, name) \
+    ((pointer != NULL) ? pointer : (pointer = (__typeof__(pointer))dlsym(RTLD_NEXT, name)))
+
+/* Some ABIs keep an older condition variable implementation as the first version of the symbol */
+#define REAL_COND(pointer, name) \
+    ((pointer != NULL) ? pointer : \
+     (pointer = (__typeof__(pointer))dlvsym(RTLD_NEXT, name, "GLIBC_2.3.2")) != NULL ? pointer : \
+     (pointer = (__typeof__(pointer))dlsym(RTLD_NEXT, name)))
+
+static const char *scope_name(unsigned int scope)
+{
+    return (scope == CELLULAR_LOCK_OUTSIDE) ? "(outside HAL calls)" : cellular_trace_api_name((CellularHalApi_t)scope);
+}
+
+static void add(uint64_t *pField, uint64_t value)
+{
+    __atomic_fetch_add(pField, value, __ATOMIC_RELAXED);
+}
+
+static void add_max(uint64_t *pField, uint64_t value)
+{
+    uint64_t current = __atomic_load_n(pField, __ATOMIC_RELAXED);
+
+    while ((value > current) &&
+           !__atomic_compare_exchange_n(pField, &current, value, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    {
+    }
+}
+
+static void pair_lock(int lock)
+{
+    if (lock && (REAL(gRealMutexLock, "pthread_mutex_lock") != NULL))
+    {
+        gRealMutexLock(&gPairLock);
+    }
+    else if (!lock && (REAL(gRealMutexUnlock, "pthread_mutex_unlock") != NULL))
+    {
+        gRealMutexUnlock(&gPairLock);
+    }
+}
+
+/* Returns the entry of a lock; a lock not seen yet is added only inside a HAL call */
+static LockEntry_t *find_lock(const void *pLock, const char *pKind)
+{
+    unsigned int slot = (unsigned int)(((uintptr_t)pLock >> 3) * 2654435761u) % MAX_LOCKS;
+    unsigned int i;
+    const void *pKey;
+
+    if (!__atomic_load_n(&gStarted, __ATOMIC_RELAXED))
+    {
+        return NULL;
+    }
+    for (i = 0; i < MAX_LOCKS; i++, slot = (slot + 1) % MAX_LOCKS)
+    {
+        pKey = __atomic_load_n(&gLocks[slot].pLock, __ATOMIC_ACQUIRE);
+        if (pKey == pLock)
+        {
+            return &gLocks[slot];
+        }
+        if (pKey != NULL)
+        {
+            continue;
+        }
+        if (tScope == CELLULAR_LOCK_OUTSIDE)
+        {
+            return NULL;
+        }
+        if (__atomic_compare_exchange_n(&gLocks[slot].pLock, &pKey, pLock, 0, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE))
+        {
+            gLocks[slot].pKind = pKind;
+            return &gLocks[slot];
+        }
+        if (pKey == pLock)
+        {
+            return &gLocks[slot];
+        }
+    }
+    return NULL;
+}
+
+static void add_pair(LockEntry_t *pEntry, unsigned int waiter, unsigned int holder, uint64_t waited)
+{
+    unsigned int i;
+
+    pair_lock(1);
+    for (i = 0; i < pEntry->pairCount; i++)
+    {
+        if ((pEntry->pairs[i].waiter == waiter) && (pEntry->pairs[i].holder == holder))
+        {
+            break;
+        }
+    }
+    if ((i == pEntry->pairCount) && (pEntry->pairCount < MAX_PAIRS))
+    {
+        pEntry->pairs[i].waiter = (unsigned short)waiter;
+        pEntry->pairs[i].holder = (unsigned short)holder;
+        pEntry->pairCount++;
+    }
+    if (i < pEntry->pairCount)
+    {
+        pEntry->pairs[i].blocks++;
+        pEntry->pairs[i].wait_ns += waited;
+    }
+    pair_lock(0);
+}
+
+/* Records a successful acquisition; waited is 0 when the try lock succeeded */
+static void acquired(const void *pLock, LockEntry_t *pEntry, int blocked, unsigned int holder, uint64_t waited)
+{
+    CellularLockStats_t *pStats = &pEntry->stats[tScope];
+
+    add(&pStats->acquisitions, 1);
+    if (blocked)
+    {
+        add(&pStats->contended, 1);
+        add(&pStats->wait_ns, waited);
+        add_max(&pStats->max_wait_ns, waited);
+        add_pair(pEntry, tScope, holder, waited);
+    }
+    __atomic_store_n(&pEntry->holder, tScope, __ATOMIC_RELAXED);
+    if (tHeldCount < MAX_HELD)
+    {
+        tHeld[tHeldCount].pLock = pLock;
+        tHeld[tHeldCount].pEntry = pEntry;
+        tHeld[tHeldCount].scope = tScope;
+        tHeld[tHeldCount++].since = cellular_bench_now_ns();
+    }
+}
+
+/* Closes the hold time of a lock this thread holds; returns 0 when it is not tracked */
+static int released(const void *pLock)
+{
+    CellularLockStats_t *pStats;
+    uint64_t held;
+    unsigned int i;
+
+    for (i = tHeldCount; i-- > 0;)
+    {
+        if (tHeld[i].pLock != pLock)
+        {
+            continue;
+        }
+        held = cellular_bench_now_ns() - tHeld[i].since;
+        pStats = &tHeld[i].pEntry->stats[tHeld[i].scope];
+        add(&pStats->hold_ns, held);
+        add_max(&pStats->max_hold_ns, held);
+        /* Locks need not be released in the order they were taken */
+        memmove(&tHeld[i], &tHeld[i + 1], (tHeldCount - i - 1) * sizeof(tHeld[0]));
+        tHeldCount--;
+        return 1;
+    }
+    return 0;
+}
+
+static void try_failed(LockEntry_t *pEntry, int result)
+{
+    if ((pEntry != NULL) && (result == EBUSY))
+    {
+        add(&pEntry->stats[tScope].contended, 1);
+    }
+}
+
+/* Tries first and times the blocking call only when the lock is busy */
+#define TIMED_ACQUIRE(pLock, kind, realTry, tryName, realLock, lockName) \
+    do { \
+        LockEntry_t *pEntry; \
+        unsigned int holder; \
+        uint64_t start; \
+        int result; \
+        if ((REAL(realTry, tryName) == NULL) || (REAL(realLock, lockName) == NULL)) \
+        { \
+            return EINVAL; \
+        } \
+        if ((pEntry = find_lock(pLock, kind)) == NULL) \
+        { \
+            return realLock(pLock); \
+        } \
+        result = realTry(pLock); \
+        if (result == 0) \
+        { \
+            acquired(pLock, pEntry, 0, 0, 0); \
+            return 0; \
+        } \
+        if (result != EBUSY) \
+        { \
+            return result; \
+        } \
+        holder = __atomic_load_n(&pEntry->holder, __ATOMIC_RELAXED); \
+        start = cellular_bench_now_ns(); \
+        result = realLock(pLock); \
+        if (result == 0) \
+        { \
+            acquired(pLock, pEntry, 1, holder, cellular_bench_now_ns() - start); \
+        } \
+        return result; \
+    } while (0)
+
+int pthread_mutex_lock(pthread_mutex_t *pMutex)
+{
+    TIMED_ACQUIRE(pMutex, "mutex", gRealMutexTrylock, "pthread_mutex_trylock", gRealMutexLock, "pthread_mutex_lock");
+}
+
+int pthread_mutex_trylock(pthread_mutex_t *pMutex)
+{
+    LockEntry_t *pEntry;
+    int result;
+
+    if (REAL(gRealMutexTrylock, "pthread_mutex_trylock") == NULL)
+    {
+        return EINVAL;
+    }
+    pEntry = find_lock(pMutex, "mutex");
+    result = gRealMutexTrylock(pMutex);
+    if ((result == 0) && (pEntry != NULL))
+    {
+        acquired(pMutex, pEntry, 0, 0, 0);
+    }
+    try_failed(pEntry, result);
+    return result;
+}
+
+int pthread_mutex_unlock(pthread_mutex_t *pMutex)
+{
+    if (REAL(gRealMutexUnlock, "pthread_mutex_unlock") == NULL)
+    {
+        return EINVAL;
+    }
+    if (tHeldCount > 0)
+    {
+        released(pMutex);
+    }
+    return gRealMutexUnlock(pMutex);
+}
+
+int pthread_rwlock_rdlock(pthread_rwlock_t *pRwlock)
+{
+    TIMED_ACQUIRE(pRwlock, "rwlock", gRealTryrdlock, "pthread_rwlock_tryrdlock", gRealRdlock, "pthread_rwlock_rdlock");
+}
+
+int pthread_rwlock_wrlock(pthread_rwlock_t *pRwlock)
+{
+    TIMED_ACQUIRE(pRwlock, "rwlock", gRealTrywrlock, "pthread_rwlock_trywrlock", gRealWrlock, "pthread_rwlock_wrlock");
+}
+
+int pthread_rwlock_tryrdlock(pthread_rwlock_t *pRwlock)
+{
+    LockEntry_t *pEntry;
+    int result;
+
+    if (REAL(gRealTryrdlock, "pthread_rwlock_tryrdlock") == NULL)
+    {
+        return EINVAL;
+    }
+    pEntry = find_lock(pRwlock, "rwlock");
+    result = gRealTryrdlock(pRwlock);
+    if ((result == 0) && (pEntry != NULL))
+    {
+        acquired(pRwlock, pEntry, 0, 0, 0);
+    }
+    try_failed(pEntry, result);
+    return result;
+}
+
+int pthread_rwlock_trywrlock(pthread_rwlock_t *pRwlock)
+{
+    LockEntry_t *pEntry;
+    int result;
+
+    if (REAL(gRealTrywrlock, "pthread_rwlock_trywrlock") == NULL)
+    {
+        return EINVAL;
+    }
+    pEntry = find_lock(pRwlock, "rwlock");
+    result = gRealTrywrlock(pRwlock);
+    if ((result == 0) && (pEntry != NULL))
+    {
+        acquired(pRwlock, pEntry, 0, 0, 0);
+    }
+    try_failed(pEntry, result);
+    return result;
+}
+
+int pthread_rwlock_unlock(pthread_rwlock_t *pRwlock)
+{
+    if (REAL(gRealRwUnlock, "pthread_rwlock_unlock") == NULL)
+    {
+        return EINVAL;
+    }
+    if (tHeldCount > 0)
+    {
+        released(pRwlock);
+    }
+    return gRealRwUnlock(pRwlock);
+}
+
+/* The mutex is released for the wait: the hold time stops and starts again on wake up */
+static void cond_woken(pthread_mutex_t *pMutex, int wasHeld, uint64_t start)
+{
+    LockEntry_t *pEntry;
+    uint64_t waited = cellular_bench_now_ns() - start;
+
+    if (!wasHeld || ((pEntry = find_lock(pMutex, "mutex")) == NULL))
+    {
+        return;
+    }
+    add(&pEntry->stats[tScope].cond_waits, 1);
+    add(&pEntry->stats[tScope].cond_wait_ns, waited);
+    if (tHeldCount < MAX_HELD)
+    {
+        tHeld[tHeldCount].pLock = pMutex;
+        tHeld[tHeldCount].pEntry = pEntry;
+        tHeld[tHeldCount].scope = tScope;
+        tHeld[tHeldCount++].since = cellular_bench_now_ns();
+    }
+}
+
+int pthread_cond_wait(pthread_cond_t *pCond, pthread_mutex_t *pMutex)
+{
+    uint64_t start;
+    int wasHeld = 0;
+    int result;
+
+    if (REAL_COND(gRealCondWait, "pthread_cond_wait") == NULL)
+    {
+        return EINVAL;
+    }
+    if (tHeldCount > 0)
+    {
+        wasHeld = released(pMutex);
+    }
+    start = cellular_bench_now_ns();
+    result = gRealCondWait(pCond, pMutex);
+    cond_woken(pMutex, wasHeld, start);
+    return result;
+}
+
+int pthread_cond_timedwait(pthread_cond_t *pCond, pthread_mutex_t *pMutex, const struct timespec *pTime)
+{
+    uint64_t start;
+    int wasHeld = 0;
+    int result;
+
+    if (REAL_COND(gRealCondTimedwait, "pthread_cond_timedwait") == NULL)
+    {
+        return EINVAL;
+    }
+    if (tHeldCount > 0)
+    {
+        wasHeld = released(pMutex);
+    }
+    start = cellular_bench_now_ns();
+    result = gRealCondTimedwait(pCond, pMutex, pTime);
+    cond_woken(pMutex, wasHeld, start);
+    return result;
+}
+
+static void probe_call_begin(CellularHalApi_t api)
+{
+    tScope = (unsigned int)api;
+}
+
+static void probe_call_end(CellularHalApi_t api)
+{
+    (void)api;
+    tScope = CELLULAR_LOCK_OUTSIDE;
+}
+
+/* Names a lock by its symbol when the HAL library exports it, by address otherwise */
+static void lock_name(const void *pLock, char *pName, size_t size)
+{
+    Dl_info info;
+
+    if ((dladdr(pLock, &info) != 0) && (info.dli_sname != NULL) && (info.dli_saddr != NULL))
+    {
+        snprintf(pName, size, "%s+%lu", info.dli_sname, (unsigned long)((const char *)pLock - (const char *)info.dli_saddr));
+    }
+    else
+    {
+        snprintf(pName, size, "%p", pLock);
+    }
+}
+
+/* Counter families by lock and api, "none" standing for acquisitions outside HAL calls */
+static void collect_metrics(FILE *pOut)
+{
+    static const char *names[5] = { "acquisitions", "blocked", "wait_seconds", "hold_seconds", "cond_wait_seconds" };
+    static const char *helps[5] =
+    {
+        "Acquisitions of a lock", "Acquisitions of a lock which blocked", "Time blocked acquiring a lock",
+        "Time a lock was held", "Time spent in condition waits on a lock"
+    };
+    const CellularLockStats_t *pStats;
+    char name[48];
+    char family[64];
+    char sample[72];
+    double value;
+    unsigned int f, i, s;
+
+    if (gStarted == 0)
+    {
+        return;
+    }
+    for (f = 0; f < 5; f++)
+    {
+        snprintf(family, sizeof(family), "cellular_hal_lock_%s", names[f]);
+        snprintf(sample, sizeof(sample), "%s_total", family);
+        cellular_metrics_family(pOut, family, CELLULAR_METRIC_COUNTER, helps[f]);
+        for (i = 0; i < MAX_LOCKS; i++)
+        {
+            if (gLocks[i].pLock == NULL)
+            {
+                continue;
+            }
+            lock_name(gLocks[i].pLock, name, sizeof(name));
+            for (s = 0; s < SCOPE_COUNT; s++)
+            {
+                pStats = &gLocks[i].stats[s];
+                if ((pStats->acquisitions == 0) && (pStats->contended == 0) && (pStats->cond_waits == 0))
+                {
+                    continue;
+                }
+                value = (f == 0) ? (double)pStats->acquisitions : (f == 1) ? (double)pStats->contended :
+                        (f == 2) ? (double)pStats->wait_ns / 1e9 : (f == 3) ? (double)pStats->hold_ns / 1e9 :
+                        (double)pStats->cond_wait_ns / 1e9;
+                cellular_metrics_sample(pOut, sample, value, "api", (s == CELLULAR_LOCK_OUTSIDE) ? "none" : scope_name(s),
+                                        "lock", name, "kind", (gLocks[i].pKind != NULL) ? gLocks[i].pKind : "unknown", NULL);
+            }
+        }
+    }
+}
+
+static const CellularTraceProbe_t gProbe =
+{
+    NULL, NULL, probe_call_begin, probe_call_end
+};
+
+int cellular_lock_start(void)
+{
+    if (gStarted > 0)
+    {
+        __atomic_fetch_add(&gStarted, 1, __ATOMIC_RELAXED);
+        return RETURN_OK;
+    }
+    if (cellular_trace_add_probe(&gProbe) != RETURN_OK)
+    {
+        return RETURN_ERROR;
+    }
+    __atomic_store_n(&gStarted, 1, __ATOMIC_RELEASE);
+    cellular_metrics_add_collector(collect_metrics);
+    return RETURN_OK;
+}
+
+void cellular_lock_stop(void)
+{
+    if ((gStarted == 0) || (__atomic_sub_fetch(&gStarted, 1, __ATOMIC_RELEASE) > 0))
+    {
+        return;
+    }
+    cellular_trace_remove_probe(&gProbe);
+    /* The interposers stopped looking locks up; hold times still being closed land in cleared entries */
+    pair_lock(1);
+    memset(gLocks, 0, sizeof(gLocks));
+    pair_lock(0);
+}
+
+int cellular_lock_get(const void *pLock, unsigned int scope, CellularLockStats_t *pStats)
+{
+    const CellularLockStats_t *pEntryStats;
+    unsigned int i;
+
+    if ((scope >= SCOPE_COUNT) || (pStats == NULL))
+    {
+        return RETURN_ERROR;
+    }
+    memset(pStats, 0, sizeof(*pStats));
+    for (i = 0; i < MAX_LOCKS; i++)
+    {
+        if ((gLocks[i].pLock == NULL) || ((pLock != NULL) && (gLocks[i].pLock != pLock)))
+        {
+            continue;
+        }
+        pEntryStats = &gLocks[i].stats[scope];
+        pStats->acquisitions += pEntryStats->acquisitions;
+        pStats->contended += pEntryStats->contended;
+        pStats->wait_ns += pEntryStats->wait_ns;
+        pStats->hold_ns += pEntryStats->hold_ns;
+        pStats->cond_waits += pEntryStats->cond_waits;
+        pStats->cond_wait_ns += pEntryStats->cond_wait_ns;
+        pStats->max_wait_ns = (pEntryStats->max_wait_ns > pStats->max_wait_ns) ? pEntryStats->max_wait_ns : pStats->max_wait_ns;
+        pStats->max_hold_ns = (pEntryStats->max_hold_ns > pStats->max_hold_ns) ? pEntryStats->max_hold_ns : pStats->max_hold_ns;
+    }
+    return RETURN_OK;
+}
+
+uint64_t cellular_lock_get_blocked_ns(const void *pLock, unsigned int waiter, unsigned int holder)
+{
+    uint64_t total = 0;
+    unsigned int i, p;
+
+    pair_lock(1);
+    for (i = 0; i < MAX_LOCKS; i++)
+    {
+        if ((gLocks[i].pLock == NULL) || ((pLock != NULL) && (gLocks[i].pLock != pLock)))
+        {
+            continue;
+        }
+        for (p = 0; p < gLocks[i].pairCount; p++)
+        {
+            if ((gLocks[i].pairs[p].waiter == waiter) && (gLocks[i].pairs[p].holder == holder))
+            {
+                total += gLocks[i].pairs[p].wait_ns;
+            }
+        }
+    }
+    pair_lock(0);
+    return total;
+}
+
+void cellular_lock_report(void)
+{
+    const CellularLockStats_t *pStats;
+    const LockEntry_t *pEntry;
+    char name[48];
+    char scopes[512];
+    unsigned char involved[SCOPE_COUNT];
+    size_t used;
+    uint64_t blocks, waited;
+    unsigned int i, s, p;
+
+    if (!gStarted)
+    {
+        return;
+    }
+    UT_LOG_INFO("| %-24s | %-6s | %-52s | %8s | %8s | %9s | %9s | %9s | %9s | %6s |",
+                "Lock", "Kind", "Scope", "acquired", "blocked", "wait us", "max wait", "hold us", "max hold", "cond");
+    for (i = 0; i < MAX_LOCKS; i++)
+    {
+        pEntry = &gLocks[i];
+        if (pEntry->pLock == NULL)
+        {
+            continue;
+        }
+        lock_name(pEntry->pLock, name, sizeof(name));
+        for (s = 0; s < SCOPE_COUNT; s++)
+        {
+            pStats = &pEntry->stats[s];
+            if ((pStats->acquisitions == 0) && (pStats->contended == 0) && (pStats->cond_waits == 0))
+            {
+                continue;
+            }
+            UT_LOG_INFO("| %-24.24s | %-6s | %-52s | %8llu | %8llu | %9llu | %9llu | %9llu | %9llu | %6llu |",
+                        name, (pEntry->pKind != NULL) ? pEntry->pKind : "?", scope_name(s), (unsigned long long)pStats->acquisitions,
+                        (unsigned long long)pStats->contended, (unsigned long long)(pStats->wait_ns / 1000),
+                        (unsigned long long)(pStats->max_wait_ns / 1000), (unsigned long long)(pStats->hold_ns / 1000),
+                        (unsigned long long)(pStats->max_hold_ns / 1000), (unsigned long long)pStats->cond_waits);
+        }
+    }
+
+    pair_lock(1);
+    UT_LOG_INFO("| %-24s | %-52s | %-52s | %8s | %9s |", "Lock", "Blocked scope", "Behind scope", "blocks", "wait us");
+    for (i = 0; i < MAX_LOCKS; i++)
+    {
+        pEntry = &gLocks[i];
+        if ((pEntry->pLock == NULL) || (pEntry->pairCount == 0))
+        {
+            continue;
+        }
+        lock_name(pEntry->pLock, name, sizeof(name));
+        blocks = 0;
+        waited = 0;
+        used = 0;
+        scopes[0] = '\0';
+        memset(involved, 0, sizeof(involved));
+        for (p = 0; p < pEntry->pairCount; p++)
+        {
+            UT_LOG_INFO("| %-24.24s | %-52s | %-52s | %8llu | %9llu |", name, scope_name(pEntry->pairs[p].waiter),
+                        scope_name(pEntry->pairs[p].holder), (unsigned long long)pEntry->pairs[p].blocks,
+                        (unsigned long long)(pEntry->pairs[p].wait_ns / 1000));
+            blocks += pEntry->pairs[p].blocks;
+            waited += pEntry->pairs[p].wait_ns;
+            involved[pEntry->pairs[p].waiter] = 1;
+            involved[pEntry->pairs[p].holder] = 1;
+        }
+        for (s = 0; s < SCOPE_COUNT; s++)
+        {
+            if (involved[s] && (used < sizeof(scopes)))
+            {
+                used += (size_t)snprintf(&scopes[used], sizeof(scopes) - used, "%s%s", (used > 0) ? ", " : "", scope_name(s));
+            }
+        }
+        UT_LOG_WARNING("Lock %s serializes %s: %llu blocked acquisitions, %llu us waiting", name, scopes,
+                       (unsigned long long)blocks, (unsigned long long)(waited / 1000));
+    }
+    pair_lock(0);
+}
@@ -0,0 +1,708 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:*
+ * Copyright 2023 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file cellular_log.c
+ * @brief Asynchronous logging backend for the test harness
+ *
+ * Every thread owns a single producer, single consumer byte ring. A record is a fixed
+ * header (format and function pointers, line, level) followed by the argument values in
+ * format order; the consumer walks the same format string to know how to read them back,
+ * so no type tags are stored. Head and tail are free running counters published with
+ * release/acquire ordering, which is all the synchronisation the fast path needs. When a
+ * thread exits its ring is drained and retired, and the next thread to log takes it over.
+ */
+
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/prctl.h>
+#include <sys/types.h>
+#include <ut_log.h>
+#include "cellular_log.h"
+#include "cellular_bench.h"
+#include "cellular_run.h"
+#include "cellular_trace.h"
+
+#define RING_SIZE   (64u * 1024u)
+#define MAX_RECORD  1024u
+#define MAX_STRING  256u
+#define LINE_LENGTH 1024u
+#define ENCODE_OVERFLOW ((size_t)-1)
+
+typedef enum
+{
+    LEN_NONE = 0,
+    LEN_HH,
+    LEN_H,
+    LEN_L,
+    LEN_LL,
+    LEN_Z,
+    LEN_J,
+    LEN_T,
+    LEN_BIG_L
+} LogLength_t;
+
+/* One conversion of a format string */
+typedef struct
+{
+    const char *pStart;      /* The '%' */
+    size_t length;           /* Characters up to and including the conversion */
+    unsigned int stars;      /* '*' width and precision arguments */
+    LogLength_t size;
+    char conversion;         /* 0 for an unsupported conversion, which ends argument handling */
+} LogSpec_t;
+
+typedef struct
+{
+    uint32_t size;           /* Header and arguments, rounded up to 8 bytes */
+    int32_t level;
+    int32_t line;
+    uint32_t reserved;
+    const char *pFormat;
+    const char *pFunction;
+} LogRecordHeader_t;
+
+typedef struct LogRing_s
+{
+    struct LogRing_s *pNext;
+    _Atomic uint64_t head;   /* Advanced by the owning thread */
+    _Atomic uint64_t tail;   /* Advanced by the consumer */
+    _Atomic uint64_t records;
+    _Atomic uint64_t stalls;
+    atomic_int retired;      /* Empty and free for the next thread which logs */
+    unsigned char data[RING_SIZE];
+} LogRing_t;
+
+static pthread_once_t gOnce = PTHREAD_ONCE_INIT;
+static pthread_mutex_t gRingLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t gConsumerLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t gRingKey;
+static _Atomic(LogRing_t *) gRings;
+static atomic_int gAsync;
+static _Atomic uint64_t gFormatted;
+static _Atomic uint64_t gSynchronous;
+static __thread LogRing_t *tRing;
+
+/* Parses the conversion at pFormat ('%'), returns 0 for "%%" which takes no argument */
+static int parse_spec(const char *pFormat, LogSpec_t *pSpec)
+{
+    const char *p = pFormat + 1;
+
+    memset(pSpec, 0, sizeof(*pSpec));
+    pSpec->pStart = pFormat;
+    if (*p == '%')
+    {
+        pSpec->length = 2;
+        return 0;
+    }
+    while ((*p != '\0') && (strchr("-+ #0'", *p) != NULL))
+    {
+        p++;
+    }
+    if (*p == '*')
+    {
+        pSpec->stars++;
+        p++;
+    }
+    while ((*p >= '0') && (*p <= '9'))
+    {
+        p++;
+    }
+    if (*p == '.')
+    {
+        p++;
+        if (*p == '*')
+        {
+            pSpec->stars++;
+            p++;
+        }
+        while ((*p >= '0') && (*p <= '9'))
+        {
+            p++;
+        }
+    }
+    switch (*p)
+    {
+        case 'h':
+            pSpec->size = (p[1] == 'h') ? LEN_HH : LEN_H;
+            p += (p[1] == 'h') ? 2 : 1;
+            break;
+        case 'l':
+            pSpec->size = (p[1] == 'l') ? LEN_LL : LEN_L;
+            p += (p[1] == 'l') ? 2 : 1;
+            break;
+        case 'z':
+            pSpec->size = LEN_Z;
+            p++;
+            break;
+        case 'j':
+            pSpec->size = LEN_J;
+            p++;
+            break;
+        case 't':
+            pSpec->size = LEN_T;
+            p++;
+            break;
+        case 'L':
+            pSpec->size = LEN_BIG_L;
+            p++;
+            break;
+        default:
+            break;
+    }
+    if ((*p != '\0') && (strchr("diouxXcfFeEgGaAsp", *p) != NULL))
+    {
+        pSpec->conversion = *p;
+        p++;
+    }
+    pSpec->length = (size_t)(p - pFormat);
+    return 1;
+}
+
+static int is_signed(char conversion)
+{
+    return (conversion == 'd') || (conversion == 'i');
+}
+
+static int is_float(char conversion)
+{
+    return (conversion != 0) && (strchr("fFeEgGaA", conversion) != NULL);
+}
+
+/* Appends the arguments of pFormat to pOut, returns the bytes used or ENCODE_OVERFLOW */
+static size_t encode_args(const char *pFormat, va_list args, unsigned char *pOut, size_t room)
+{
+    LogSpec_t spec;
+    const char *p = pFormat;
+    const char *pString;
+    size_t used = 0;
+    size_t length;
+    int64_t signedValue;
+    uint64_t unsignedValue;
+    double doubleValue;
+    long double longDoubleValue;
+    unsigned int i;
+    uint16_t stringLength;
+
+    while ((p = strchr(p, '%')) != NULL)
+    {
+        if (!parse_spec(p, &spec))
+        {
+            p += spec.length;
+            continue;
+        }
+        if (spec.conversion == 0)
+        {
+            break;
+        }
+        for (i = 0; i < spec.stars; i++)
+        {
+            signedValue = va_arg(args, int);
+            if (used + sizeof(signedValue) > room)
+            {
+                return ENCODE_OVERFLOW;
+            }
+            memcpy(pOut + used, &signedValue, sizeof(signedValue));
+            used += sizeof(signedValue);
+        }
+        if (spec.conversion == 's')
+        {
+            pString = va_arg(args, const char *);
+            pString = (pString != NULL) ? pString : "(null)";
+            length = strnlen(pString, MAX_STRING);
+            if (used + sizeof(stringLength) + length > room)
+            {
+                return ENCODE_OVERFLOW;
+            }
+            stringLength = (uint16_t)length;
+            memcpy(pOut + used, &stringLength, sizeof(stringLength));
+            memcpy(pOut + used + sizeof(stringLength), pString, length);
+            used += sizeof(stringLength) + length;
+        }
+        else if (is_float(spec.conversion) && (spec.size == LEN_BIG_L))
+        {
+            longDoubleValue = va_arg(args, long double);
+            if (used + sizeof(longDoubleValue) > room)
+            {
+                return ENCODE_OVERFLOW;
+            }
+            memcpy(pOut + used, &longDoubleValue, sizeof(longDoubleValue));
+            used += sizeof(longDoubleValue);
+        }
+        else
+        {
+            if (is_float(spec.conversion))
+            {
+                doubleValue = va_arg(args, double);
+                memcpy(&unsignedValue, &doubleValue, sizeof(unsignedValue));
+            }
+            else if (spec.conversion == 'p')
+            {
+                unsignedValue = (uint64_t)(uintptr_t)va_arg(args, void *);
+            }
+            else if (is_signed(spec.conversion))
+            {
+                switch (spec.size)
+                {
+                    case LEN_L: signedValue = va_arg(args, long); break;
+                    case LEN_LL: signedValue = va_arg(args, long long); break;
+                    case LEN_Z: signedValue = va_arg(args, ssize_t); break;
+                    case LEN_J: signedValue = va_arg(args, intmax_t); break;
+                    case LEN_T: signedValue = va_arg(args, ptrdiff_t); break;
+                    default: signedValue = va_arg(args, int); break;
+                }
+                unsignedValue = (uint64_t)signedValue;
+            }
+            else
+            {
+                switch (spec.size)
+                {
+                    case LEN_L: unsignedValue = va_arg(args, unsigned long); break;
+                    case LEN_LL: unsignedValue = va_arg(args, unsigned long long); break;
+                    case LEN_Z: unsignedValue = va_arg(args, size_t); break;
+                    case LEN_J: unsignedValue = va_arg(args, uintmax_t); break;
+                    case LEN_T: unsignedValue = (uint64_t)va_arg(args, ptrdiff_t); break;
+                    default: unsignedValue = va_arg(args, unsigned int); break;
+                }
+            }
+            if (used + sizeof(unsignedValue) > room)
+            {
+                return ENCODE_OVERFLOW;
+            }
+            memcpy(pOut + used, &unsignedValue, sizeof(unsignedValue));
+            used += sizeof(unsignedValue);
+        }
+        p += spec.length;
+    }
+    return used;
+}
+
+/* snprintf of one conversion, passing its '*' arguments ahead of the value */
+#define FORMAT_ONE(value) \
+    ((spec.stars == 0) ? snprintf(pOut, room, specText, value) : \
+     (spec.stars == 1) ? snprintf(pOut, room, specText, stars[0], value) : \
+                         snprintf(pOut, room, specText, stars[0], stars[1], value))
+
+/* Formats a record; pArgs holds the values written by encode_args() for the same format */
+static void format_record(const char *pFormat, const unsigned char *pArgs, char *pOut, size_t room)
+{
+    LogSpec_t spec;
+    const char *p = pFormat;
+    const char *pPercent;
+    char specText[64];
+    char stringValue[MAX_STRING + 1];
+    int stars[2] = { 0, 0 };
+    int64_t starValue;
+    uint64_t value;
+    double doubleValue;
+    long double longDoubleValue;
+    uint16_t stringLength;
+    unsigned int i;
+    size_t length;
+    int written;
+
+    while ((room > 1) && (*p != '\0'))
+    {
+        pPercent = strchr(p, '%');
+        length = (pPercent != NULL) ? (size_t)(pPercent - p) : strlen(p);
+        length = (length < room - 1) ? length : room - 1;
+        memcpy(pOut, p, length);
+        pOut += length;
+        room -= length;
+        p += length;
+        if ((pPercent == NULL) || (room <= 1) || (p != pPercent))
+        {
+            continue;
+        }
+        if (!parse_spec(p, &spec))
+        {
+            *pOut++ = '%';
+            room--;
+            p += spec.length;
+            continue;
+        }
+        if ((spec.conversion == 0) || (spec.length >= sizeof(specText)))
+        {
+            /* Unsupported conversion: the rest of the format is copied verbatim */
+            snprintf(pOut, room, "%s", p);
+            return;
+        }
+        memcpy(specText, p, spec.length);
+        specText[spec.length] = '\0';
+        for (i = 0; i < spec.stars; i++)
+        {
+            memcpy(&starValue, pArgs, sizeof(starValue));
+            pArgs += sizeof(starValue);
+            stars[i] = (int)starValue;
+        }
+        if (spec.conversion == 's')
+        {
+            memcpy(&stringLength, pArgs, sizeof(stringLength));
+            memcpy(stringValue, pArgs + sizeof(stringLength), stringLength);
+            stringValue[stringLength] = '\0';
+            pArgs += sizeof(stringLength) + stringLength;
+            written = FORMAT_ONE(stringValue);
+        }
+        else if (is_float(spec.conversion) && (spec.size == LEN_BIG_L))
+        {
+            memcpy(&longDoubleValue, pArgs, sizeof(longDoubleValue));
+            pArgs += sizeof(longDoubleValue);
+            written = FORMAT_ONE(longDoubleValue);
+        }
+        else
+        {
+            memcpy(&value, pArgs, sizeof(value));
+            pArgs += sizeof(value);
+            if (is_float(spec.conversion))
+            {
+                memcpy(&doubleValue, &value, sizeof(doubleValue));
+                written = FORMAT_ONE(doubleValue);
+            }
+            else if (spec.conversion == 'p')
+            {
+                written = FORMAT_ONE((void *)(uintptr_t)value);
+            }
+            else if (is_signed(spec.conversion))
+            {
+                switch (spec.size)
+                {
+                    case LEN_L: written = FORMAT_ONE((long)value); break;
+                    case LEN_LL: written = FORMAT_ONE((long long)value); break;
+                    case LEN_Z: written = FORMAT_ONE((ssize_t)value); break;
+                    case LEN_J: written = FORMAT_ONE((intmax_t)value); break;
+                    case LEN_T: written = FORMAT_ONE((ptrdiff_t)value); break;
+                    default: written = FORMAT_ONE((int)value); break;
+                }
+            }
+            else
+            {
+                switch (spec.size)
+                {
+                    case LEN_L: written = FORMAT_ONE((unsigned long)value); break;
+                    case LEN_LL: written = FORMAT_ONE((unsigned long long)value); break;
+                    case LEN_Z: written = FORMAT_ONE((size_t)value); break;
+                    case LEN_J: written = FORMAT_ONE((uintmax_t)value); break;
+                    case LEN_T: written = FORMAT_ONE((ptrdiff_t)value); break;
+                    default: written = FORMAT_ONE((unsigned int)value); break;
+                }
+            }
+        }
+        if (written < 0)
+        {
+            break;
+        }
+        length = ((size_t)written < room) ? (size_t)written : room - 1;
+        pOut += length;
+        room -= length;
+        p += spec.length;
+    }
+    *pOut = '\0';
+}
+
+/* Hands a formatted line to the ut-core log at its level */
+static void emit(int level, const char *pFunction, int line, const char *pText)
+{
+    switch (level)
+    {
+        case CELLULAR_LOG_LEVEL_DEBUG:
+            UT_LOG_DEBUG("%s:%d %s", pFunction, line, pText);
+            break;
+        case CELLULAR_LOG_LEVEL_INFO:
+            UT_LOG_INFO("%s:%d %s", pFunction, line, pText);
+            break;
+        case CELLULAR_LOG_LEVEL_WARNING:
+            UT_LOG_WARNING("%s:%d %s", pFunction, line, pText);
+            break;
+        default:
+            UT_LOG_ERROR("%s:%d %s", pFunction, line, pText);
+            break;
+    }
+}
+
+static void ring_copy_out(const LogRing_t *pRing, uint64_t position, void *pDest, size_t length)
+{
+    size_t offset = (size_t)(position & (RING_SIZE - 1));
+    size_t first = (length < RING_SIZE - offset) ? length : RING_SIZE - offset;
+
+    memcpy(pDest, &pRing->data[offset], first);
+    memcpy((unsigned char *)pDest + first, &pRing->data[0], length - first);
+}
+
+static void ring_copy_in(LogRing_t *pRing, uint64_t position, const void *pSource, size_t length)
+{
+    size_t offset = (size_t)(position & (RING_SIZE - 1));
+    size_t first = (length < RING_SIZE - offset) ? length : RING_SIZE - offset;
+
+    memcpy(&pRing->data[offset], pSource, first);
+    memcpy(&pRing->data[0], (const unsigned char *)pSource + first, length - first);
+}
+
+/* Formats and emits every pending record of every ring; gConsumerLock must be held */
+static unsigned int drain(void)
+{
+    unsigned char record[MAX_RECORD];
+    char text[LINE_LENGTH];
+    LogRecordHeader_t header;
+    LogRing_t *pRing;
+    uint64_t head, tail;
+    unsigned int count = 0;
+
+    for (pRing = atomic_load_explicit(&gRings, memory_order_acquire); pRing != NULL; pRing = pRing->pNext)
+    {
+        tail = atomic_load_explicit(&pRing->tail, memory_order_relaxed);
+        head = atomic_load_explicit(&pRing->head, memory_order_acquire);
+        while (tail != head)
+        {
+            ring_copy_out(pRing, tail, &header, sizeof(header));
+            ring_copy_out(pRing, tail, record, header.size);
+            format_record(header.pFormat, record + sizeof(header), text, sizeof(text));
+            emit(header.level, header.pFunction, header.line, text);
+            tail += header.size;
+            atomic_store_explicit(&pRing->tail, tail, memory_order_release);
+            count++;
+        }
+    }
+    atomic_fetch_add_explicit(&gFormatted, count, memory_order_relaxed);
+    return count;
+}
+
+static void *consumer_thread(void *pArg)
+{
+    unsigned int count;
+
+    (void)pArg;
+    prctl(PR_SET_NAME, "cellular_log", 0, 0, 0);
+    cellular_run_background_thread();
+    while (atomic_load(&gAsync))
+    {
+        pthread_mutex_lock(&gConsumerLock);
+        count = drain();
+        pthread_mutex_unlock(&gConsumerLock);
+        if (count == 0)
+        {
+            cellular_bench_sleep_ms(1);
+        }
+    }
+    return NULL;
+}
+
+static void atfork_child(void)
+{
+    LogRing_t *pRing;
+
+    /* The consumer does not exist in the child: drop the parent's records and log synchronously */
+    atomic_store(&gAsync, 0);
+    pthread_mutex_init(&gRingLock, NULL);
+    pthread_mutex_init(&gConsumerLock, NULL);
+    for (pRing = atomic_load(&gRings); pRing != NULL; pRing = pRing->pNext)
+    {
+        atomic_store(&pRing->tail, atomic_load(&pRing->head));
+        /* Only the forking thread exists in the child */
+        if (pRing != tRing)
+        {
+            atomic_store(&pRing->retired, 1);
+        }
+    }
+}
+
+/* Key destructor of an exiting thread: writes out its records and frees its ring for the next thread */
+static void ring_retire(void *pArg)
+{
+    LogRing_t *pRing = (LogRing_t *)pArg;
+
+    cellular_log_flush();
+    tRing = NULL;
+    atomic_store_explicit(&pRing->retired, 1, memory_order_release);
+}
+
+static void log_exit(void)
+{
+    cellular_log_flush();
+}
+
+static void log_once(void)
+{
+    const char *pAsync = getenv("CELLULAR_LOG_ASYNC");
+    pthread_t thread;
+
+    pthread_key_create(&gRingKey, ring_retire);
+    pthread_atfork(NULL, NULL, atfork_child);
+    atexit(log_exit);
+    if ((pAsync != NULL) && (strcmp(pAsync, "0") == 0))
+    {
+        return;
+    }
+    atomic_store(&gAsync, 1);
+    if (pthread_create(&thread, NULL, consumer_thread, NULL) != 0)
+    {
+        atomic_store(&gAsync, 0);
+        return;
+    }
+    pthread_detach(thread);
+}
+
+static LogRing_t *thread_ring(void)
+{
+    LogRing_t *pRing = tRing;
+
+    if (pRing != NULL)
+    {
+        return pRing;
+    }
+    cellular_trace_hold_abandon();
+    pthread_mutex_lock(&gRingLock);
+    for (pRing = atomic_load_explicit(&gRings, memory_order_relaxed); pRing != NULL; pRing = pRing->pNext)
+    {
+        if (atomic_load_explicit(&pRing->retired, memory_order_acquire))
+        {
+            atomic_store_explicit(&pRing->retired, 0, memory_order_relaxed);
+            break;
+        }
+    }
+    if (pRing == NULL)
+    {
+        pRing = (LogRing_t *)calloc(1, sizeof(LogRing_t));
+        if (pRing == NULL)
+        {
+            pthread_mutex_unlock(&gRingLock);
+            cellular_trace_release_abandon();
+            return NULL;
+        }
+        pRing->pNext = atomic_load_explicit(&gRings, memory_order_relaxed);
+        atomic_store_explicit(&gRings, pRing, memory_order_release);
+    }
+    pthread_mutex_unlock(&gRingLock);
+    cellular_trace_release_abandon();
+    pthread_setspecific(gRingKey, pRing);
+    tRing = pRing;
+    return pRing;
+}
+
+static void write_synchronous(int level, const char *pFunction, int line, const char *pFormat, va_list args)
+{
+    char text[LINE_LENGTH];
+
+    vsnprintf(text, sizeof(text), pFormat, args);
+    /* Not jumped out of by an abandoned test while the output stream is locked */
+    cellular_trace_hold_abandon();
+    emit(level, pFunction, line, text);
+    cellular_trace_release_abandon();
+    atomic_fetch_add_explicit(&gSynchronous, 1, memory_order_relaxed);
+}
+
+void cellular_log_write(int level, const char *pFunction, int line, const char *pFormat, ...)
+{
+    unsigned char record[MAX_RECORD];
+    LogRecordHeader_t header;
+    LogRing_t *pRing = NULL;
+    uint64_t head;
+    size_t used;
+    va_list args;
+    va_list copy;
+
+    pthread_once(&gOnce, log_once);
+    va_start(args, pFormat);
+    if (atomic_load_explicit(&gAsync, memory_order_relaxed) && (level < CELLULAR_LOG_LEVEL_ERROR))
+    {
+        pRing = thread_ring();
+    }
+    if (pRing == NULL)
+    {
+        if (level >= CELLULAR_LOG_LEVEL_ERROR)
+        {
+            cellular_log_flush();
+        }
+        write_synchronous(level, pFunction, line, pFormat, args);
+        va_end(args);
+        return;
+    }
+
+    va_copy(copy, args);
+    used = encode_args(pFormat, copy, record + sizeof(header), sizeof(record) - sizeof(header));
+    va_end(copy);
+    if (used == ENCODE_OVERFLOW)
+    {
+        /* Too large for a record */
+        write_synchronous(level, pFunction, line, pFormat, args);
+        va_end(args);
+        return;
+    }
+    va_end(args);
+
+    memset(&header, 0, sizeof(header));
+    header.size = (uint32_t)((sizeof(header) + used + 7u) & ~7u);
+    header.level = level;
+    header.line = line;
+    header.pFormat = pFormat;
+    header.pFunction = pFunction;
+    memcpy(record, &header, sizeof(header));
+
+    head = atomic_load_explicit(&pRing->head, memory_order_relaxed);
+    if ((head - atomic_load_explicit(&pRing->tail, memory_order_acquire)) + header.size > RING_SIZE)
+    {
+        /*
+         * Drain on this thread rather than wait for the consumer: a SCHED_FIFO producer
+         * yielding would never let a SCHED_OTHER consumer run on the same CPU
+         */
+        atomic_fetch_add_explicit(&pRing->stalls, 1, memory_order_relaxed);
+        cellular_log_flush();
+    }
+    ring_copy_in(pRing, head, record, header.size);
+    atomic_store_explicit(&pRing->head, head + header.size, memory_order_release);
+    atomic_fetch_add_explicit(&pRing->records, 1, memory_order_relaxed);
+}
+
+void cellular_log_flush(void)
+{
+    cellular_trace_hold_abandon();
+    pthread_mutex_lock(&gConsumerLock);
+    drain();
+    pthread_mutex_unlock(&gConsumerLock);
+    cellular_trace_release_abandon();
+}
+
+int cellular_log_is_async(void)
+{
+    pthread_once(&gOnce, log_once);
+    return atomic_load(&gAsync);
+}
+
+void cellular_log_get_stats(CellularLogStats_t *pStats)
+{
+    LogRing_t *pRing;
+
+    if (pStats == NULL)
+    {
+        return;
+    }
+    memset(pStats, 0, sizeof(*pStats));
+    for (pRing = atomic_load_explicit(&gRings, memory_order_acquire); pRing != NULL; pRing = pRing->pNext)
+    {
+        pStats->records += atomic_load_explicit(&pRing->records, memory_order_relaxed);
+        pStats->stalls += atomic_load_explicit(&pRing->stalls, memory_order_relaxed);
+        pStats->rings++;
+        pStats->retired += (uint32_t)atomic_load_explicit(&pRing->retired, memory_order_relaxed);
+    }
+    pStats->formatted = atomic_load(&gFormatted);
+    pStats->synchronous = atomic_load(&gSynchronous);
+    pStats->records += pStats->synchronous;
+}
@@ -0,0 +1,416 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:*
+ * Copyright 2023 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file cellular_matrix.c
+ * @brief Runs the init/start/stop sequence over many profiles in parallel processes
+ *
+ * Children report their result as one fixed size record over a pipe; the record is
+ * smaller than PIPE_BUF so it is written atomically and read once the child has exited.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <ut_log.h>
+#include "cellular_matrix.h"
+#include "cellular_bench.h"
+#include "cellular_profile_compiler.h"
+#include "cellular_sim.h"
+
+#define KILL_GRACE_MS 1000
+
+typedef struct
+{
+    pid_t pid;
+    int fd;
+    unsigned int index;
+    uint64_t start_ns;
+} MatrixChild_t;
+
+/* Callback state of the child process */
+static pthread_mutex_t gLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t gCond = PTHREAD_COND_INITIALIZER;
+static volatile unsigned int gReadyFamilies;
+static volatile unsigned int gDisconnected;
+static uint64_t gReadyNs;
+static uint64_t gDisconnectedNs;
+
+static int ip_ready_cb(CellularIPStruct *pstIPStruct, CellularDeviceIPReadyStatus_t ip_ready_status)
+{
+    pthread_mutex_lock(&gLock);
+    if ((pstIPStruct != NULL) && (ip_ready_status == DEVICE_NETWORK_IP_READY))
+    {
+        gReadyFamilies |= 1u << pstIPStruct->IPType;
+        gReadyNs = cellular_bench_now_ns();
+        pthread_cond_broadcast(&gCond);
+    }
+    pthread_mutex_unlock(&gLock);
+    return RETURN_OK;
+}
+
+static int packet_service_cb(char *device_name, CellularNetworkIPType_t ip_type, CellularNetworkPacketStatus_t packet_service_status)
+{
+    (void)device_name;
+    (void)ip_type;
+    pthread_mutex_lock(&gLock);
+    if (packet_service_status == DEVICE_NETWORK_STATUS_DISCONNECTED)
+    {
+        gDisconnected = 1;
+        gDisconnectedNs = cellular_bench_now_ns();
+        pthread_cond_broadcast(&gCond);
+    }
+    pthread_mutex_unlock(&gLock);
+    return RETURN_OK;
+}
+
+/* Waits until (*pFlags & mask) == mask or the deadline passes; gLock must be held */
+static int wait_flags(const volatile unsigned int *pFlags, unsigned int mask, uint64_t deadlineNs)
+{
+    struct timespec ts;
+    uint64_t offsetNs;
+
+    while ((*pFlags & mask) != mask)
+    {
+        if (cellular_bench_now_ns() >= deadlineNs)
+        {
+            return -1;
+        }
+        /* The condvar runs on CLOCK_REALTIME, so convert the monotonic deadline */
+        clock_gettime(CLOCK_REALTIME, &ts);
+        offsetNs = deadlineNs - cellular_bench_now_ns();
+        if (offsetNs > 10000000ull)
+        {
+            offsetNs = 10000000ull;
+        }
+        ts.tv_nsec += (long)offsetNs;
+        ts.tv_sec += ts.tv_nsec / 1000000000L;
+        ts.tv_nsec %= 1000000000L;
+        pthread_cond_timedwait(&gCond, &gLock, &ts);
+    }
+    return 0;
+}
+
+static CellularNetworkIPType_t ip_type_of(CellularPDPType_t pdpType)
+{
+    switch (pdpType)
+    {
+        case CELLULAR_PDP_TYPE_IPV6:
+            return CELLULAR_NETWORK_IP_FAMILY_IPV6;
+        case CELLULAR_PDP_TYPE_IPV4_OR_IPV6:
+            return CELLULAR_NETWORK_IP_FAMILY_IPV4_IPV6;
+        default:
+            /* PPP carries IPv4 */
+            return CELLULAR_NETWORK_IP_FAMILY_IPV4;
+    }
+}
+
+static CellularIPFamilyPref_t family_of(CellularPDPType_t pdpType)
+{
+    switch (pdpType)
+    {
+        case CELLULAR_PDP_TYPE_IPV6:
+            return IP_FAMILY_IPV6;
+        case CELLULAR_PDP_TYPE_IPV4_OR_IPV6:
+            return IP_FAMILY_IPV4_IPV6;
+        default:
+            return IP_FAMILY_IPV4;
+    }
+}
+
+/* The init/start/stop sequence of one profile, run in the child */
+static void run_profile(const CellularProfileStruct *pProfile, uint32_t timeoutMs, CellularMatrixResult_t *pResult)
+{
+    CellularContextInitInputStruct context;
+    CellularNetworkCBStruct callbacks;
+    CellularProfileStruct input = *pProfile;
+    CellularNetworkIPType_t ipType = ip_type_of(pProfile->PDPType);
+    unsigned int wanted = 0;
+    uint64_t deadlineNs = cellular_bench_now_ns() + ((uint64_t)timeoutMs * 1000000ull);
+    uint64_t startNs;
+
+    if (cellular_sim_available())
+    {
+        cellular_sim_reset();
+    }
+
+    memset(&context, 0, sizeof(context));
+    context.enIPFamilyPreference = family_of(pProfile->PDPType);
+    context.enPreferenceTechnology = PREF_LTE;
+    context.stIfInput = *pProfile;
+    startNs = cellular_bench_now_ns();
+    pResult->init_result = cellular_hal_init(&context);
+    pResult->init_us = (cellular_bench_now_ns() - startNs) / 1000;
+
+    memset(&callbacks, 0, sizeof(callbacks));
+    callbacks.device_network_ip_ready_cb = ip_ready_cb;
+    callbacks.packet_service_status_cb = packet_service_cb;
+    wanted = (ipType == CELLULAR_NETWORK_IP_FAMILY_IPV4_IPV6) ?
+             ((1u << CELLULAR_NETWORK_IP_FAMILY_IPV4) | (1u << CELLULAR_NETWORK_IP_FAMILY_IPV6)) : (1u << ipType);
+    startNs = cellular_bench_now_ns();
+    pResult->start_result = cellular_hal_start_network(ipType, &input, &callbacks);
+    pResult->start_us = (cellular_bench_now_ns() - startNs) / 1000;
+    if (pResult->start_result == RETURN_OK)
+    {
+        pthread_mutex_lock(&gLock);
+        pResult->ip_ready = (wait_flags(&gReadyFamilies, wanted, deadlineNs) == 0);
+        pResult->ip_ready_us = pResult->ip_ready ? (gReadyNs - startNs) / 1000 : 0;
+        pthread_mutex_unlock(&gLock);
+    }
+
+    startNs = cellular_bench_now_ns();
+    pResult->stop_result = cellular_hal_stop_network(ipType);
+    if (pResult->stop_result == RETURN_OK)
+    {
+        pthread_mutex_lock(&gLock);
+        pResult->disconnected = (wait_flags(&gDisconnected, 1, deadlineNs) == 0);
+        pResult->stop_us = ((pResult->disconnected ? gDisconnectedNs : cellular_bench_now_ns()) - startNs) / 1000;
+        pthread_mutex_unlock(&gLock);
+    }
+
+    pResult->status = ((pResult->init_result == RETURN_OK) && (pResult->start_result == RETURN_OK) &&
+                       (pResult->stop_result == RETURN_OK) && pResult->ip_ready) ? CELLULAR_MATRIX_PASS : CELLULAR_MATRIX_FAIL;
+}
+
+unsigned int cellular_matrix_cartesian(const CellularProfileStruct *pBase, CellularProfileStruct **ppProfiles)
+{
+    static const CellularPDPType_t pdpTypes[] = { CELLULAR_PDP_TYPE_IPV4, CELLULAR_PDP_TYPE_IPV6, CELLULAR_PDP_TYPE_PPP, CELLULAR_PDP_TYPE_IPV4_OR_IPV6 };
+    static const CellularPDPAuthentication_t auths[] = { CELLULAR_PDP_AUTHENTICATION_NONE, CELLULAR_PDP_AUTHENTICATION_PAP, CELLULAR_PDP_AUTHENTICATION_CHAP };
+    static const CellularPDPNetworkConfig_t configs[] = { CELLULAR_PDP_NETWORK_CONFIG_NAS, CELLULAR_PDP_NETWORK_CONFIG_DHCP };
+    const unsigned int total = (sizeof(pdpTypes) / sizeof(pdpTypes[0])) * (sizeof(auths) / sizeof(auths[0])) *
+                               (sizeof(configs) / sizeof(configs[0]));
+    CellularProfileStruct *pProfiles;
+    unsigned int t, a, c, n = 0;
+
+    if ((pBase == NULL) || (ppProfiles == NULL))
+    {
+        return 0;
+    }
+    pProfiles = (CellularProfileStruct *)calloc(total, sizeof(CellularProfileStruct));
+    if (pProfiles == NULL)
+    {
+        return 0;
+    }
+    for (t = 0; t < sizeof(pdpTypes) / sizeof(pdpTypes[0]); t++)
+    {
+        for (a = 0; a < sizeof(auths) / sizeof(auths[0]); a++)
+        {
+            for (c = 0; c < sizeof(configs) / sizeof(configs[0]); c++)
+            {
+                pProfiles[n] = *pBase;
+                pProfiles[n].ProfileID = pBase->ProfileID + (int)n;
+                pProfiles[n].PDPType = pdpTypes[t];
+                pProfiles[n].PDPAuthentication = auths[a];
+                pProfiles[n].PDPNetworkConfig = configs[c];
+                n++;
+            }
+        }
+    }
+    *ppProfiles = pProfiles;
+    return n;
+}
+
+static int spawn(const CellularProfileStruct *pProfile, unsigned int index, uint32_t timeoutMs, MatrixChild_t *pChild)
+{
+    CellularMatrixResult_t result;
+    int fds[2];
+    ssize_t written;
+
+    if (pipe(fds) != 0)
+    {
+        return -1;
+    }
+    pChild->start_ns = cellular_bench_now_ns();
+    pChild->pid = fork();
+    if (pChild->pid < 0)
+    {
+        close(fds[0]);
+        close(fds[1]);
+        return -1;
+    }
+    if (pChild->pid == 0)
+    {
+        close(fds[0]);
+        memset(&result, 0, sizeof(result));
+        result.profile = *pProfile;
+        run_profile(pProfile, timeoutMs, &result);
+        written = write(fds[1], &result, sizeof(result));
+        /* Leave without running the parent's atexit handlers */
+        _exit((written == (ssize_t)sizeof(result)) ? 0 : 1);
+    }
+    close(fds[1]);
+    pChild->fd = fds[0];
+    pChild->index = index;
+    return 0;
+}
+
+static void collect(MatrixChild_t *pChild, int exitStatus, CellularMatrixStatus_t lost, CellularMatrixResult_t *pResult)
+{
+    CellularMatrixResult_t received;
+    uint64_t totalUs = (cellular_bench_now_ns() - pChild->start_ns) / 1000;
+
+    if ((exitStatus == 0) && (read(pChild->fd, &received, sizeof(received)) == (ssize_t)sizeof(received)))
+    {
+        *pResult = received;
+    }
+    else
+    {
+        pResult->status = lost;
+    }
+    pResult->total_us = totalUs;
+    close(pChild->fd);
+    pChild->pid = 0;
+}
+
+int cellular_matrix_run(const CellularProfileStruct *pProfiles, unsigned int count, unsigned int jobs,
+                        uint32_t timeout_ms, CellularMatrixResult_t *pResults)
+{
+    MatrixChild_t *pChildren;
+    unsigned int next = 0, running = 0, done = 0, i;
+    int passed = 0;
+    int status;
+    pid_t pid;
+
+    if ((pProfiles == NULL) || (pResults == NULL))
+    {
+        return -1;
+    }
+    jobs = (jobs == 0) ? 1 : jobs;
+    pChildren = (MatrixChild_t *)calloc(jobs, sizeof(MatrixChild_t));
+    if (pChildren == NULL)
+    {
+        return -1;
+    }
+    memset(pResults, 0, count * sizeof(CellularMatrixResult_t));
+    for (i = 0; i < count; i++)
+    {
+        pResults[i].profile = pProfiles[i];
+        pResults[i].status = CELLULAR_MATRIX_CRASHED;
+    }
+
+    while (done < count)
+    {
+        for (i = 0; (i < jobs) && (next < count); i++)
+        {
+            if (pChildren[i].pid == 0)
+            {
+                if (spawn(&pProfiles[next], next, timeout_ms, &pChildren[i]) == 0)
+                {
+                    running++;
+                }
+                else
+                {
+                    UT_LOG_ERROR("Matrix profile %u could not be started: %s", next, strerror(errno));
+                    done++;
+                }
+                next++;
+            }
+        }
+
+        for (i = 0; i < jobs; i++)
+        {
+            if (pChildren[i].pid == 0)
+            {
+                continue;
+            }
+            pid = waitpid(pChildren[i].pid, &status, WNOHANG);
+            if (pid == pChildren[i].pid)
+            {
+                collect(&pChildren[i], (WIFEXITED(status) ? WEXITSTATUS(status) : -1), CELLULAR_MATRIX_CRASHED,
+                        &pResults[pChildren[i].index]);
+                running--;
+                done++;
+            }
+            else if ((cellular_bench_now_ns() - pChildren[i].start_ns) / 1000000ull > (uint64_t)timeout_ms + KILL_GRACE_MS)
+            {
+                kill(pChildren[i].pid, SIGKILL);
+                waitpid(pChildren[i].pid, &status, 0);
+                collect(&pChildren[i], -1, CELLULAR_MATRIX_TIMEOUT, &pResults[pChildren[i].index]);
+                running--;
+                done++;
+            }
+        }
+        if (running > 0)
+        {
+            cellular_bench_sleep_ms(1);
+        }
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        passed += (pResults[i].status == CELLULAR_MATRIX_PASS);
+    }
+    free(pChildren);
+    return passed;
+}
+
+const char *cellular_matrix_status_to_string(CellularMatrixStatus_t status)
+{
+    switch (status)
+    {
+        case CELLULAR_MATRIX_PASS:
+            return "PASS";
+        case CELLULAR_MATRIX_FAIL:
+            return "FAIL";
+        case CELLULAR_MATRIX_TIMEOUT:
+            return "TIMEOUT";
+        default:
+            return "CRASHED";
+    }
+}
+
+/* Enum name without its common prefix, e.g. "IPV4" for CELLULAR_PDP_TYPE_IPV4 */
+static const char *short_name(const char *pField, int value, const char *pPrefix)
+{
+    const char *pName = cellular_profile_enum_to_string(pField, value);
+    size_t length = strlen(pPrefix);
+
+    if (pName == NULL)
+    {
+        return "?";
+    }
+    return (strncmp(pName, pPrefix, length) == 0) ? pName + length : pName;
+}
+
+void cellular_matrix_log(const CellularMatrixResult_t *pResults, unsigned int count)
+{
+    const CellularMatrixResult_t *pResult;
+    unsigned int i;
+
+    UT_LOG_INFO("| %3s | %9s | %-12s | %-5s | %-5s | %-7s | %8s | %8s | %10s | %8s | %9s |", "#", "ProfileID", "PDPType",
+                "Auth", "Net", "Result", "init us", "start us", "ip rdy us", "stop us", "total us");
+    for (i = 0; (pResults != NULL) && (i < count); i++)
+    {
+        pResult = &pResults[i];
+        UT_LOG_INFO("| %3u | %9d | %-12s | %-5s | %-5s | %-7s | %8llu | %8llu | %10llu | %8llu | %9llu |", i,
+                    pResult->profile.ProfileID,
+                    short_name("PDPType", pResult->profile.PDPType, "CELLULAR_PDP_TYPE_"),
+                    short_name("PDPAuthentication", pResult->profile.PDPAuthentication, "CELLULAR_PDP_AUTHENTICATION_"),
+                    short_name("PDPNetworkConfig", pResult->profile.PDPNetworkConfig, "CELLULAR_PDP_NETWORK_CONFIG_"),
+                    cellular_matrix_status_to_string(pResult->status),
+                    (unsigned long long)pResult->init_us, (unsigned long long)pResult->start_us,
+                    (unsigned long long)pResult->ip_ready_us, (unsigned long long)pResult->stop_us,
+                    (unsigned long long)pResult->total_us);
+    }
+}
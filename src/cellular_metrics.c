@@ -0,0 +1,581 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:*
+ * Copyright 2023 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file cellular_metrics.c
+ * @brief OpenMetrics export of the harness timings, counters and histograms
+ *
+ * An export runs under one lock: the exporter's own families first, then every collector,
+ * then the # EOF terminator. The HTTP endpoint renders an export into memory per request
+ * and answers one request per connection.
+ */
+
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <ut_log.h>
+#include "cellular_metrics.h"
+#include "cellular_bench.h"
+#include "cellular_run.h"
+
+/* Build TARGET, set by the Makefile */
+#ifndef CELLULAR_TARGET
+#define CELLULAR_TARGET "unknown"
+#endif
+
+#define BUCKET_COUNT     13
+#define FIRMWARE_LENGTH  128
+#define REQUEST_LENGTH   1024
+
+typedef struct
+{
+    const char *pName;
+    const char *pHelp;
+    const char *pTest;
+    const char *pVariant;
+    double value;
+} MetricsResult_t;
+
+typedef struct
+{
+    uint64_t buckets[BUCKET_COUNT + 1];    /* Not cumulative, the last one is +Inf */
+    uint64_t count;
+    uint64_t sum_ns;
+} MetricsHistogram_t;
+
+typedef struct
+{
+    const char *pTitle;
+    uint64_t ns;
+} MetricsTest_t;
+
+/* Upper bounds of the latency buckets, from 10 us to 10 s */
+static const uint64_t gBucketNs[BUCKET_COUNT] =
+{
+    10000ull, 50000ull, 100000ull, 500000ull, 1000000ull, 5000000ull, 10000000ull,
+    50000000ull, 100000000ull, 500000000ull, 1000000000ull, 5000000000ull, 10000000000ull
+};
+
+static pthread_mutex_t gLock = PTHREAD_MUTEX_INITIALIZER;
+static int gStarted = 0;
+static CellularMetricsCollector_t gCollectors[CELLULAR_METRICS_MAX_COLLECTORS];
+static unsigned int gCollectorCount = 0;
+static MetricsHistogram_t gHistograms[CELLULAR_HAL_API_COUNT];
+static MetricsTest_t gTests[CELLULAR_TRACE_MAX_TESTS];
+static unsigned int gTestCount = 0;
+static const char *gCurrentTest = NULL;
+static uint64_t gTestStart = 0;
+static MetricsResult_t gResults[CELLULAR_METRICS_MAX_RESULTS];
+static unsigned int gResultCount = 0;
+static char gFirmware[FIRMWARE_LENGTH];
+static int gServerPort = -1;
+
+static __thread uint64_t tCallStart;
+
+static void probe_test_begin(const char *pTitle)
+{
+    gCurrentTest = pTitle;
+    gTestStart = cellular_bench_now_ns();
+}
+
+static void probe_test_end(const char *pTitle)
+{
+    uint64_t elapsed = cellular_bench_now_ns() - gTestStart;
+    unsigned int i;
+
+    pthread_mutex_lock(&gLock);
+    for (i = 0; (i < gTestCount) && (gTests[i].pTitle != pTitle); i++)
+    {
+    }
+    if (i < CELLULAR_TRACE_MAX_TESTS)
+    {
+        gTests[i].pTitle = pTitle;
+        gTests[i].ns = elapsed;
+        gTestCount = (i == gTestCount) ? gTestCount + 1 : gTestCount;
+    }
+    gCurrentTest = NULL;
+    pthread_mutex_unlock(&gLock);
+}
+
+static void probe_call_begin(CellularHalApi_t api)
+{
+    (void)api;
+    tCallStart = cellular_bench_now_ns();
+}
+
+static void probe_call_end(CellularHalApi_t api)
+{
+    MetricsHistogram_t *pHistogram = &gHistograms[api];
+    uint64_t elapsed = cellular_bench_now_ns() - tCallStart;
+    unsigned int b = 0;
+
+    while ((b < BUCKET_COUNT) && (elapsed > gBucketNs[b]))
+    {
+        b++;
+    }
+    __atomic_fetch_add(&pHistogram->buckets[b], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&pHistogram->count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&pHistogram->sum_ns, elapsed, __ATOMIC_RELAXED);
+}
+
+int cellular_metrics_start(void)
+{
+    static const CellularTraceProbe_t probe =
+    {
+        probe_test_begin, probe_test_end, probe_call_begin, probe_call_end
+    };
+
+    if (gStarted)
+    {
+        return RETURN_OK;
+    }
+    if (cellular_trace_add_probe(&probe) != RETURN_OK)
+    {
+        return RETURN_ERROR;
+    }
+    gStarted = 1;
+    return RETURN_OK;
+}
+
+int cellular_metrics_add_collector(CellularMetricsCollector_t collect)
+{
+    unsigned int i;
+    int result = RETURN_OK;
+
+    if (collect == NULL)
+    {
+        return RETURN_ERROR;
+    }
+    pthread_mutex_lock(&gLock);
+    for (i = 0; (i < gCollectorCount) && (gCollectors[i] != collect); i++)
+    {
+    }
+    if ((i == gCollectorCount) && (gCollectorCount < CELLULAR_METRICS_MAX_COLLECTORS))
+    {
+        gCollectors[gCollectorCount++] = collect;
+    }
+    else if (i == gCollectorCount)
+    {
+        result = RETURN_ERROR;
+    }
+    pthread_mutex_unlock(&gLock);
+    return result;
+}
+
+void cellular_metrics_family(FILE *pOut, const char *pName, CellularMetricType_t type, const char *pHelp)
+{
+    size_t length = strlen(pName);
+
+    fprintf(pOut, "# TYPE %s %s\n", pName,
+            (type == CELLULAR_METRIC_COUNTER) ? "counter" : (type == CELLULAR_METRIC_HISTOGRAM) ? "histogram" : "gauge");
+    if ((length > 8) && (strcmp(&pName[length - 8], "_seconds") == 0))
+    {
+        fprintf(pOut, "# UNIT %s seconds\n", pName);
+    }
+    fprintf(pOut, "# HELP %s %s\n", pName, pHelp);
+}
+
+static void write_label(FILE *pOut, int *pFirst, const char *pName, const char *pValue)
+{
+    const char *pChar;
+
+    fprintf(pOut, "%s%s=\"", *pFirst ? "" : ",", pName);
+    for (pChar = pValue; *pChar != '\0'; pChar++)
+    {
+        if ((*pChar == '\\') || (*pChar == '"'))
+        {
+            fputc('\\', pOut);
+            fputc(*pChar, pOut);
+        }
+        else if (*pChar == '\n')
+        {
+            fputs("\\n", pOut);
+        }
+        else
+        {
+            fputc(*pChar, pOut);
+        }
+    }
+    fputc('"', pOut);
+    *pFirst = 0;
+}
+
+void cellular_metrics_sample(FILE *pOut, const char *pName, double value, ...)
+{
+    const char *pLabel;
+    const char *pValue;
+    va_list args;
+    int first = 1;
+
+    fprintf(pOut, "%s{", pName);
+    va_start(args, value);
+    while ((pLabel = va_arg(args, const char *)) != NULL)
+    {
+        pValue = va_arg(args, const char *);
+        if (pValue != NULL)
+        {
+            write_label(pOut, &first, pLabel, pValue);
+        }
+    }
+    va_end(args);
+    write_label(pOut, &first, "target", CELLULAR_TARGET);
+    write_label(pOut, &first, "firmware", (gFirmware[0] != '\0') ? gFirmware : "unknown");
+    fprintf(pOut, "} %.15g\n", value);
+}
+
+int cellular_metrics_set(const char *pName, const char *pHelp, const char *pVariant, double value)
+{
+    MetricsResult_t *pResult;
+    unsigned int i;
+    int result = RETURN_OK;
+
+    if ((pName == NULL) || (pHelp == NULL))
+    {
+        return RETURN_ERROR;
+    }
+    pthread_mutex_lock(&gLock);
+    for (i = 0; i < gResultCount; i++)
+    {
+        pResult = &gResults[i];
+        if ((strcmp(pResult->pName, pName) == 0) && (pResult->pTest == gCurrentTest) &&
+            (((pVariant == NULL) && (pResult->pVariant == NULL)) ||
+             ((pVariant != NULL) && (pResult->pVariant != NULL) && (strcmp(pResult->pVariant, pVariant) == 0))))
+        {
+            break;
+        }
+    }
+    if (i < gResultCount)
+    {
+        gResults[i].value = value;
+    }
+    else if (gResultCount < CELLULAR_METRICS_MAX_RESULTS)
+    {
+        /* Names and variants are usually literals; copies keep formatted ones valid */
+        pResult = &gResults[gResultCount];
+        pResult->pName = strdup(pName);
+        pResult->pHelp = strdup(pHelp);
+        pResult->pVariant = (pVariant != NULL) ? strdup(pVariant) : NULL;
+        pResult->pTest = gCurrentTest;
+        pResult->value = value;
+        if ((pResult->pName != NULL) && (pResult->pHelp != NULL))
+        {
+            gResultCount++;
+        }
+        else
+        {
+            result = RETURN_ERROR;
+        }
+    }
+    else
+    {
+        result = RETURN_ERROR;
+    }
+    pthread_mutex_unlock(&gLock);
+    return result;
+}
+
+int cellular_metrics_get_result(unsigned int index, const char **ppName, const char **ppHelp, const char **ppVariant, double *pValue)
+{
+    int result = RETURN_ERROR;
+
+    if ((ppName == NULL) || (ppHelp == NULL) || (ppVariant == NULL) || (pValue == NULL))
+    {
+        return RETURN_ERROR;
+    }
+    pthread_mutex_lock(&gLock);
+    if (index < gResultCount)
+    {
+        *ppName = gResults[index].pName;
+        *ppHelp = gResults[index].pHelp;
+        *ppVariant = gResults[index].pVariant;
+        *pValue = gResults[index].value;
+        result = RETURN_OK;
+    }
+    pthread_mutex_unlock(&gLock);
+    return result;
+}
+
+static void read_firmware(void)
+{
+    char firmware[FIRMWARE_LENGTH] = { 0 };
+
+    if (gFirmware[0] != '\0')
+    {
+        return;
+    }
+    /* Retried on every export until the modem answers */
+    if ((cellular_hal_get_modem_firmware_version(firmware) == RETURN_OK) && (firmware[0] != '\0'))
+    {
+        snprintf(gFirmware, sizeof(gFirmware), "%s", firmware);
+    }
+}
+
+static void write_own_families(FILE *pOut)
+{
+    const MetricsHistogram_t *pHistogram;
+    char bound[16];
+    char name[96];
+    uint64_t cumulative;
+    unsigned int a, b, i, j;
+
+    cellular_metrics_family(pOut, "cellular_hal_call_duration_seconds", CELLULAR_METRIC_HISTOGRAM,
+                            "Wall time of cellular_hal calls made by the tests");
+    for (a = 0; a < CELLULAR_HAL_API_COUNT; a++)
+    {
+        pHistogram = &gHistograms[a];
+        if (pHistogram->count == 0)
+        {
+            continue;
+        }
+        cumulative = 0;
+        for (b = 0; b <= BUCKET_COUNT; b++)
+        {
+            cumulative += pHistogram->buckets[b];
+            if (b < BUCKET_COUNT)
+            {
+                snprintf(bound, sizeof(bound), "%g", (double)gBucketNs[b] / 1e9);
+            }
+            cellular_metrics_sample(pOut, "cellular_hal_call_duration_seconds_bucket", (double)cumulative,
+                                    "api", cellular_trace_api_name((CellularHalApi_t)a),
+                                    "le", (b < BUCKET_COUNT) ? bound : "+Inf", NULL);
+        }
+        cellular_metrics_sample(pOut, "cellular_hal_call_duration_seconds_count", (double)pHistogram->count,
+                                "api", cellular_trace_api_name((CellularHalApi_t)a), NULL);
+        cellular_metrics_sample(pOut, "cellular_hal_call_duration_seconds_sum", (double)pHistogram->sum_ns / 1e9,
+                                "api", cellular_trace_api_name((CellularHalApi_t)a), NULL);
+    }
+
+    cellular_metrics_family(pOut, "cellular_test_duration_seconds", CELLULAR_METRIC_GAUGE, "Wall time of the last run of each test");
+    for (i = 0; i < gTestCount; i++)
+    {
+        cellular_metrics_sample(pOut, "cellular_test_duration_seconds", (double)gTests[i].ns / 1e9, "test", gTests[i].pTitle, NULL);
+    }
+
+    /* One family per result name, in the order the names were first set */
+    for (i = 0; i < gResultCount; i++)
+    {
+        for (j = 0; (j < i) && (strcmp(gResults[j].pName, gResults[i].pName) != 0); j++)
+        {
+        }
+        if (j < i)
+        {
+            continue;
+        }
+        snprintf(name, sizeof(name), "cellular_bench_%s", gResults[i].pName);
+        cellular_metrics_family(pOut, name, CELLULAR_METRIC_GAUGE, gResults[i].pHelp);
+        for (j = i; j < gResultCount; j++)
+        {
+            if (strcmp(gResults[j].pName, gResults[i].pName) == 0)
+            {
+                cellular_metrics_sample(pOut, name, gResults[j].value,
+                                        "test", (gResults[j].pTest != NULL) ? gResults[j].pTest : "",
+                                        "variant", gResults[j].pVariant, NULL);
+            }
+        }
+    }
+}
+
+/* Writes a complete exposition; serialized so collectors never run concurrently */
+static void export_all(FILE *pOut)
+{
+    static pthread_mutex_t exportLock = PTHREAD_MUTEX_INITIALIZER;
+    CellularMetricsCollector_t collectors[CELLULAR_METRICS_MAX_COLLECTORS];
+    unsigned int count, i;
+
+    pthread_mutex_lock(&exportLock);
+    read_firmware();
+    pthread_mutex_lock(&gLock);
+    write_own_families(pOut);
+    count = gCollectorCount;
+    memcpy(collectors, gCollectors, sizeof(collectors));
+    pthread_mutex_unlock(&gLock);
+    for (i = 0; i < count; i++)
+    {
+        collectors[i](pOut);
+    }
+    fprintf(pOut, "# EOF\n");
+    pthread_mutex_unlock(&exportLock);
+}
+
+int cellular_metrics_write(const char *pPath)
+{
+    char temporary[512];
+    FILE *pOut;
+    int failed;
+
+    if (pPath == NULL)
+    {
+        return RETURN_ERROR;
+    }
+    /* Scrapers reading the file never see a partial exposition */
+    snprintf(temporary, sizeof(temporary), "%s.tmp", pPath);
+    pOut = fopen(temporary, "w");
+    if (pOut == NULL)
+    {
+        UT_LOG_ERROR("Cannot write metrics to %s", temporary);
+        return RETURN_ERROR;
+    }
+    export_all(pOut);
+    failed = ferror(pOut);
+    if ((fclose(pOut) != 0) || failed || (rename(temporary, pPath) != 0))
+    {
+        UT_LOG_ERROR("Cannot write metrics to %s", pPath);
+        unlink(temporary);
+        return RETURN_ERROR;
+    }
+    return RETURN_OK;
+}
+
+static void send_all(int fd, const char *pData, size_t size)
+{
+    ssize_t sent;
+
+    while (size > 0)
+    {
+        sent = send(fd, pData, size, MSG_NOSIGNAL);
+        if (sent <= 0)
+        {
+            return;
+        }
+        pData += sent;
+        size -= (size_t)sent;
+    }
+}
+
+static void answer(int fd)
+{
+    char request[REQUEST_LENGTH];
+    char header[256];
+    struct pollfd pfd = { fd, POLLIN, 0 };
+    char *pBody = NULL;
+    size_t bodySize = 0, used = 0;
+    ssize_t received;
+    FILE *pOut;
+
+    /* Only the request line matters; wait at most a second for it */
+    while ((used < sizeof(request) - 1) && (poll(&pfd, 1, 1000) > 0))
+    {
+        received = recv(fd, &request[used], sizeof(request) - 1 - used, 0);
+        if (received <= 0)
+        {
+            break;
+        }
+        used += (size_t)received;
+        request[used] = '\0';
+        if (strstr(request, "\r\n") != NULL)
+        {
+            break;
+        }
+    }
+    request[used] = '\0';
+    if ((strncmp(request, "GET /metrics ", 13) != 0) && (strncmp(request, "GET / ", 6) != 0))
+    {
+        snprintf(header, sizeof(header), "HTTP/1.0 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+        send_all(fd, header, strlen(header));
+        return;
+    }
+    pOut = open_memstream(&pBody, &bodySize);
+    if (pOut == NULL)
+    {
+        return;
+    }
+    export_all(pOut);
+    fclose(pOut);
+    snprintf(header, sizeof(header),
+             "HTTP/1.0 200 OK\r\nContent-Type: application/openmetrics-text; version=1.0.0; charset=utf-8\r\n"
+             "Content-Length: %zu\r\nConnection: close\r\n\r\n", bodySize);
+    send_all(fd, header, strlen(header));
+    send_all(fd, pBody, bodySize);
+    free(pBody);
+}
+
+static void *server_thread(void *pArg)
+{
+    int listenFd = (int)(intptr_t)pArg;
+    int fd;
+
+    prctl(PR_SET_NAME, "cellular_http", 0, 0, 0);
+    cellular_run_background_thread();
+    for (;;)
+    {
+        /* Close on exec, so the forked test children do not hold the clients open */
+        fd = accept4(listenFd, NULL, NULL, SOCK_CLOEXEC);
+        if (fd < 0)
+        {
+            /* Out of descriptors or memory lasts: back off rather than spin until it passes */
+            if ((errno != EINTR) && (errno != ECONNABORTED))
+            {
+                cellular_bench_sleep_ms(100);
+            }
+            continue;
+        }
+        answer(fd);
+        close(fd);
+    }
+    return NULL;
+}
+
+int cellular_metrics_serve(unsigned short port)
+{
+    struct sockaddr_in address;
+    socklen_t length = sizeof(address);
+    pthread_t thread;
+    int fd, enable = 1;
+
+    pthread_mutex_lock(&gLock);
+    if (gServerPort >= 0)
+    {
+        pthread_mutex_unlock(&gLock);
+        return gServerPort;
+    }
+    fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if ((fd < 0) ||
+        (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable)) != 0) ||
+        (bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0) ||
+        (listen(fd, 4) != 0) ||
+        (getsockname(fd, (struct sockaddr *)&address, &length) != 0) ||
+        (pthread_create(&thread, NULL, server_thread, (void *)(intptr_t)fd) != 0))
+    {
+        UT_LOG_ERROR("Cannot serve metrics on 127.0.0.1:%u", port);
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        pthread_mutex_unlock(&gLock);
+        return -1;
+    }
+    pthread_detach(thread);
+    gServerPort = ntohs(address.sin_port);
+    pthread_mutex_unlock(&gLock);
+    UT_LOG_INFO("Serving metrics at http://127.0.0.1:%d/metrics", gServerPort);
+    return gServerPort;
+}
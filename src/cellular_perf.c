@@ -0,0 +1,440 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:*
+ * Copyright 2023 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file cellular_perf.c
+ * @brief CPU and scheduler counters around every test and HAL call
+ */
+
+#define _GNU_SOURCE /* RUSAGE_THREAD */
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <ut_log.h>
+#include "cellular_perf.h"
+#include "cellular_bench.h"
+#include "cellular_metrics.h"
+
+/* Group members in read order, the task clock leads */
+enum
+{
+    EVENT_TASK_CLOCK = 0,
+    EVENT_CONTEXT_SWITCHES,
+    EVENT_PAGE_FAULTS,
+    EVENT_CYCLES,
+    EVENT_INSTRUCTIONS,
+    EVENT_COUNT
+};
+
+typedef struct
+{
+    uint32_t type;
+    uint64_t config;
+} PerfEvent_t;
+
+static const PerfEvent_t gEvents[EVENT_COUNT] =
+{
+    { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK },
+    { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES },
+    { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS }
+};
+
+typedef struct
+{
+    const char *pTitle;
+    CellularPerfCounters_t counters;
+} PerfTest_t;
+
+typedef struct
+{
+    int fds[EVENT_COUNT];
+    unsigned int events;
+} PerfGroup_t;
+
+static pthread_once_t gOnce = PTHREAD_ONCE_INIT;
+static pthread_mutex_t gLock = PTHREAD_MUTEX_INITIALIZER;
+static CellularPerfSource_t gPreferred = CELLULAR_PERF_SOURCE_HARDWARE;
+static CellularPerfSource_t gSource = CELLULAR_PERF_SOURCE_RUSAGE;
+static int gExcludeKernel = 0;
+static int gStarted = 0;
+static CellularPerfCounters_t gApis[CELLULAR_HAL_API_COUNT];
+static PerfTest_t gTests[CELLULAR_TRACE_MAX_TESTS];
+static unsigned int gTestCount = 0;
+
+static pthread_key_t gGroupKey;
+static PerfGroup_t gProbeGroup;
+
+/* Group of the calling thread, released by the key destructor at thread exit */
+static __thread PerfGroup_t *tGroup = NULL;
+static __thread int tGroupOpened = 0;
+static __thread CellularPerfCounters_t tTestStart;
+static __thread CellularPerfCounters_t tCallStart;
+
+static int open_event(unsigned int event, int groupFd)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = gEvents[event].type;
+    attr.config = gEvents[event].config;
+    attr.read_format = PERF_FORMAT_GROUP;
+    attr.exclude_kernel = (unsigned int)gExcludeKernel;
+    attr.exclude_hv = (unsigned int)gExcludeKernel;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, groupFd, PERF_FLAG_FD_CLOEXEC);
+}
+
+/* Opens the group of the calling thread; events is 0 when perf_event is not usable */
+static void open_group(CellularPerfSource_t source, PerfGroup_t *pGroup)
+{
+    unsigned int last = (source == CELLULAR_PERF_SOURCE_HARDWARE) ? EVENT_INSTRUCTIONS : EVENT_PAGE_FAULTS;
+    int fd;
+
+    pGroup->events = 0;
+    if (source == CELLULAR_PERF_SOURCE_RUSAGE)
+    {
+        return;
+    }
+    while (pGroup->events <= last)
+    {
+        fd = open_event(pGroup->events, (pGroup->events == 0) ? -1 : pGroup->fds[0]);
+        if (fd < 0)
+        {
+            break;
+        }
+        pGroup->fds[pGroup->events++] = fd;
+    }
+}
+
+static void close_group(void *pArg)
+{
+    PerfGroup_t *pGroup = (PerfGroup_t *)pArg;
+
+    while (pGroup->events > 0)
+    {
+        close(pGroup->fds[--pGroup->events]);
+    }
+    if (pGroup != &gProbeGroup)
+    {
+        free(pGroup);
+    }
+}
+
+/* The inherited descriptors count the parent thread, the child opens its own group */
+static void atfork_child(void)
+{
+    if (tGroup != NULL)
+    {
+        close_group(tGroup);
+        tGroup = NULL;
+        pthread_setspecific(gGroupKey, NULL);
+    }
+    tGroupOpened = 0;
+}
+
+static void detect_source(void)
+{
+    CellularPerfSource_t source = gPreferred;
+    unsigned int wanted = (source == CELLULAR_PERF_SOURCE_HARDWARE) ? EVENT_INSTRUCTIONS : EVENT_PAGE_FAULTS;
+
+    pthread_key_create(&gGroupKey, close_group);
+    pthread_atfork(NULL, NULL, atfork_child);
+    open_group(source, &gProbeGroup);
+    if ((gProbeGroup.events <= wanted) && (errno == EACCES))
+    {
+        /* perf_event_paranoid 2 allows user space counting only */
+        close_group(&gProbeGroup);
+        gExcludeKernel = 1;
+        open_group(source, &gProbeGroup);
+    }
+    if (gProbeGroup.events == 0)
+    {
+        source = CELLULAR_PERF_SOURCE_RUSAGE;
+    }
+    else if (gProbeGroup.events <= EVENT_CYCLES)
+    {
+        source = CELLULAR_PERF_SOURCE_SOFTWARE;
+    }
+    close_group(&gProbeGroup);
+    gSource = source;
+}
+
+static void read_counters(CellularPerfCounters_t *pCounters)
+{
+    uint64_t values[1 + EVENT_COUNT];
+    struct rusage usage;
+    ssize_t length;
+
+    memset(pCounters, 0, sizeof(*pCounters));
+    pCounters->wall_ns = cellular_bench_now_ns();
+    if (!tGroupOpened)
+    {
+        tGroupOpened = 1;
+        tGroup = (PerfGroup_t *)calloc(1, sizeof(PerfGroup_t));
+        if (tGroup != NULL)
+        {
+            open_group(gSource, tGroup);
+            pthread_setspecific(gGroupKey, tGroup);
+        }
+    }
+    if ((tGroup != NULL) && (tGroup->events > 0))
+    {
+        length = read(tGroup->fds[0], values, sizeof(values));
+        if ((length >= (ssize_t)(2 * sizeof(uint64_t))) && (values[0] >= 1))
+        {
+            pCounters->cpu_ns = values[1 + EVENT_TASK_CLOCK];
+            pCounters->context_switches = (values[0] > EVENT_CONTEXT_SWITCHES) ? values[1 + EVENT_CONTEXT_SWITCHES] : 0;
+            pCounters->page_faults = (values[0] > EVENT_PAGE_FAULTS) ? values[1 + EVENT_PAGE_FAULTS] : 0;
+            pCounters->cycles = (values[0] > EVENT_CYCLES) ? values[1 + EVENT_CYCLES] : 0;
+            pCounters->instructions = (values[0] > EVENT_INSTRUCTIONS) ? values[1 + EVENT_INSTRUCTIONS] : 0;
+            return;
+        }
+    }
+    pCounters->cpu_ns = cellular_bench_thread_cpu_ns();
+    if (getrusage(RUSAGE_THREAD, &usage) == 0)
+    {
+        pCounters->context_switches = (uint64_t)(usage.ru_nvcsw + usage.ru_nivcsw);
+        pCounters->page_faults = (uint64_t)(usage.ru_minflt + usage.ru_majflt);
+    }
+}
+
+/* Adds now - start to pTotal */
+static void accumulate(CellularPerfCounters_t *pTotal, const CellularPerfCounters_t *pStart, const CellularPerfCounters_t *pNow)
+{
+    pTotal->calls++;
+    pTotal->wall_ns += pNow->wall_ns - pStart->wall_ns;
+    pTotal->cpu_ns += pNow->cpu_ns - pStart->cpu_ns;
+    pTotal->context_switches += pNow->context_switches - pStart->context_switches;
+    pTotal->page_faults += pNow->page_faults - pStart->page_faults;
+    pTotal->cycles += pNow->cycles - pStart->cycles;
+    pTotal->instructions += pNow->instructions - pStart->instructions;
+}
+
+static void probe_test_begin(const char *pTitle)
+{
+    (void)pTitle;
+    read_counters(&tTestStart);
+}
+
+static void probe_test_end(const char *pTitle)
+{
+    CellularPerfCounters_t now;
+    unsigned int i;
+
+    read_counters(&now);
+    pthread_mutex_lock(&gLock);
+    i = 0;
+    while ((i < gTestCount) && (gTests[i].pTitle != pTitle))
+    {
+        i++;
+    }
+    if (i < CELLULAR_TRACE_MAX_TESTS)
+    {
+        if (i == gTestCount)
+        {
+            gTests[gTestCount++].pTitle = pTitle;
+        }
+        accumulate(&gTests[i].counters, &tTestStart, &now);
+    }
+    pthread_mutex_unlock(&gLock);
+}
+
+static void probe_call_begin(CellularHalApi_t api)
+{
+    (void)api;
+    read_counters(&tCallStart);
+}
+
+static void probe_call_end(CellularHalApi_t api)
+{
+    CellularPerfCounters_t now;
+
+    read_counters(&now);
+    pthread_mutex_lock(&gLock);
+    accumulate(&gApis[api], &tCallStart, &now);
+    pthread_mutex_unlock(&gLock);
+}
+
+static uint64_t counter_field(const CellularPerfCounters_t *pCounters, size_t offset)
+{
+    return *(const uint64_t *)((const char *)pCounters + offset);
+}
+
+/* One counter family per field and scope kind: cellular_hal_call_<field> by api, cellular_test_<field> by test */
+static void collect_metrics(FILE *pOut)
+{
+    static const struct
+    {
+        const char *pName;
+        const char *pHelp;
+        size_t offset;
+        double scale;
+    } fields[] =
+    {
+        { "wall_seconds", "Wall time", offsetof(CellularPerfCounters_t, wall_ns), 1e-9 },
+        { "cpu_seconds", "On-CPU time of the calling thread", offsetof(CellularPerfCounters_t, cpu_ns), 1e-9 },
+        { "context_switches", "Context switches of the calling thread", offsetof(CellularPerfCounters_t, context_switches), 1.0 },
+        { "page_faults", "Page faults of the calling thread", offsetof(CellularPerfCounters_t, page_faults), 1.0 },
+        { "cycles", "CPU cycles of the calling thread", offsetof(CellularPerfCounters_t, cycles), 1.0 },
+        { "instructions", "Instructions retired by the calling thread", offsetof(CellularPerfCounters_t, instructions), 1.0 }
+    };
+    char name[64];
+    char sample[72];
+    char help[96];
+    unsigned int f, i;
+
+    pthread_mutex_lock(&gLock);
+    for (f = 0; f < sizeof(fields) / sizeof(fields[0]); f++)
+    {
+        if ((fields[f].offset >= offsetof(CellularPerfCounters_t, cycles)) && (gSource != CELLULAR_PERF_SOURCE_HARDWARE))
+        {
+            continue;
+        }
+        snprintf(name, sizeof(name), "cellular_hal_call_%s", fields[f].pName);
+        snprintf(sample, sizeof(sample), "%s_total", name);
+        snprintf(help, sizeof(help), "%s inside cellular_hal calls", fields[f].pHelp);
+        cellular_metrics_family(pOut, name, CELLULAR_METRIC_COUNTER, help);
+        for (i = 0; i < CELLULAR_HAL_API_COUNT; i++)
+        {
+            if (gApis[i].calls > 0)
+            {
+                cellular_metrics_sample(pOut, sample, (double)counter_field(&gApis[i], fields[f].offset) * fields[f].scale,
+                                        "api", cellular_trace_api_name((CellularHalApi_t)i), NULL);
+            }
+        }
+        snprintf(name, sizeof(name), "cellular_test_%s", fields[f].pName);
+        snprintf(sample, sizeof(sample), "%s_total", name);
+        snprintf(help, sizeof(help), "%s of the tests", fields[f].pHelp);
+        cellular_metrics_family(pOut, name, CELLULAR_METRIC_COUNTER, help);
+        for (i = 0; i < gTestCount; i++)
+        {
+            cellular_metrics_sample(pOut, sample, (double)counter_field(&gTests[i].counters, fields[f].offset) * fields[f].scale,
+                                    "test", gTests[i].pTitle, NULL);
+        }
+    }
+    pthread_mutex_unlock(&gLock);
+}
+
+CellularPerfSource_t cellular_perf_start(CellularPerfSource_t preferred)
+{
+    static const CellularTraceProbe_t probe =
+    {
+        probe_test_begin, probe_test_end, probe_call_begin, probe_call_end
+    };
+
+    gPreferred = preferred;
+    pthread_once(&gOnce, detect_source);
+    if (!gStarted && (cellular_trace_add_probe(&probe) == RETURN_OK))
+    {
+        gStarted = 1;
+        /* Opens the group of the calling thread now rather than inside the first test */
+        read_counters(&tTestStart);
+        cellular_metrics_add_collector(collect_metrics);
+    }
+    return gSource;
+}
+
+int cellular_perf_read(CellularPerfCounters_t *pCounters)
+{
+    if (pCounters == NULL)
+    {
+        return RETURN_ERROR;
+    }
+    pthread_once(&gOnce, detect_source);
+    read_counters(pCounters);
+    return RETURN_OK;
+}
+
+int cellular_perf_get_api(CellularHalApi_t api, CellularPerfCounters_t *pCounters)
+{
+    if (((unsigned int)api >= CELLULAR_HAL_API_COUNT) || (pCounters == NULL))
+    {
+        return RETURN_ERROR;
+    }
+    pthread_mutex_lock(&gLock);
+    *pCounters = gApis[api];
+    pthread_mutex_unlock(&gLock);
+    return RETURN_OK;
+}
+
+static void log_row(const char *pName, const CellularPerfCounters_t *pCounters)
+{
+    uint64_t blocked = (pCounters->wall_ns > pCounters->cpu_ns) ? pCounters->wall_ns - pCounters->cpu_ns : 0;
+    double ipc = (pCounters->cycles > 0) ? (double)pCounters->instructions / (double)pCounters->cycles : 0.0;
+
+    UT_LOG_INFO("| %-52s | %6llu | %10llu | %10llu | %10llu | %7llu | %7llu | %12llu | %4.2f |", pName,
+                (unsigned long long)pCounters->calls, (unsigned long long)(pCounters->wall_ns / 1000),
+                (unsigned long long)(pCounters->cpu_ns / 1000), (unsigned long long)(blocked / 1000),
+                (unsigned long long)pCounters->context_switches, (unsigned long long)pCounters->page_faults,
+                (unsigned long long)pCounters->instructions, ipc);
+}
+
+static void log_header(const char *pTitle)
+{
+    UT_LOG_INFO("| %-52s | %6s | %10s | %10s | %10s | %7s | %7s | %12s | %4s |", pTitle, "calls", "wall us",
+                "on-CPU us", "blocked us", "ctx sw", "faults", "instructions", "IPC");
+}
+
+void cellular_perf_report(void)
+{
+    unsigned int i;
+
+    if (!gStarted)
+    {
+        return;
+    }
+    pthread_mutex_lock(&gLock);
+    UT_LOG_INFO("Performance counters from %s", cellular_perf_source_to_string(gSource));
+    log_header("Test");
+    for (i = 0; i < gTestCount; i++)
+    {
+        log_row(gTests[i].pTitle, &gTests[i].counters);
+    }
+    log_header("HAL API");
+    for (i = 0; i < CELLULAR_HAL_API_COUNT; i++)
+    {
+        if (gApis[i].calls > 0)
+        {
+            log_row(cellular_trace_api_name((CellularHalApi_t)i), &gApis[i]);
+        }
+    }
+    pthread_mutex_unlock(&gLock);
+}
+
+const char *cellular_perf_source_to_string(CellularPerfSource_t source)
+{
+    switch (source)
+    {
+        case CELLULAR_PERF_SOURCE_HARDWARE:
+            return "perf_event hardware and software events";
+        case CELLULAR_PERF_SOURCE_SOFTWARE:
+            return "perf_event software events";
+        case CELLULAR_PERF_SOURCE_RUSAGE:
+            return "thread CPU clock and getrusage";
+        default:
+            return "unknown";
+    }
+}
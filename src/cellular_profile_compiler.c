@@ -0,0 +1,259 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:*
+ * Copyright 2023 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file cellular_profile_compiler.c
+ * @brief Compiles YAML test profiles into the binary profile store format
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <ut_log.h>
+#include <ut_kvp_profile.h>
+#include "cellular_profile_compiler.h"
+#include "cellular_profile_store.h"
+
+#define KEY_LENGTH 128
+
+typedef struct
+{
+    const char *pName;
+    int value;
+} EnumName_t;
+
+typedef struct
+{
+    const char *pField;
+    const EnumName_t *pNames;
+    unsigned int count;
+} EnumTable_t;
+
+static const EnumName_t gProfileTypeNames[] =
+{
+    { "CELLULAR_PROFILE_TYPE_3GPP", CELLULAR_PROFILE_TYPE_3GPP },
+    { "CELLULAR_PROFILE_TYPE_3GPP2", CELLULAR_PROFILE_TYPE_3GPP2 }
+};
+
+static const EnumName_t gPdpTypeNames[] =
+{
+    { "CELLULAR_PDP_TYPE_IPV4", CELLULAR_PDP_TYPE_IPV4 },
+    { "CELLULAR_PDP_TYPE_PPP", CELLULAR_PDP_TYPE_PPP },
+    { "CELLULAR_PDP_TYPE_IPV6", CELLULAR_PDP_TYPE_IPV6 },
+    { "CELLULAR_PDP_TYPE_IPV4_OR_IPV6", CELLULAR_PDP_TYPE_IPV4_OR_IPV6 }
+};
+
+static const EnumName_t gPdpAuthenticationNames[] =
+{
+    { "CELLULAR_PDP_AUTHENTICATION_NONE", CELLULAR_PDP_AUTHENTICATION_NONE },
+    { "CELLULAR_PDP_AUTHENTICATION_PAP", CELLULAR_PDP_AUTHENTICATION_PAP },
+    { "CELLULAR_PDP_AUTHENTICATION_CHAP", CELLULAR_PDP_AUTHENTICATION_CHAP }
+};
+
+static const EnumName_t gPdpNetworkConfigNames[] =
+{
+    { "CELLULAR_PDP_NETWORK_CONFIG_NAS", CELLULAR_PDP_NETWORK_CONFIG_NAS },
+    { "CELLULAR_PDP_NETWORK_CONFIG_DHCP", CELLULAR_PDP_NETWORK_CONFIG_DHCP }
+};
+
+#define ENUM_TABLE(field, names) { field, names, sizeof(names) / sizeof(names[0]) }
+
+static const EnumTable_t gEnumTables[] =
+{
+    ENUM_TABLE("ProfileType", gProfileTypeNames),
+    ENUM_TABLE("PDPType", gPdpTypeNames),
+    ENUM_TABLE("PDPAuthentication", gPdpAuthenticationNames),
+    ENUM_TABLE("PDPNetworkConfig", gPdpNetworkConfigNames)
+};
+
+static const EnumTable_t *find_table(const char *pField)
+{
+    unsigned int i;
+
+    for (i = 0; (pField != NULL) && (i < sizeof(gEnumTables) / sizeof(gEnumTables[0])); i++)
+    {
+        if (strcmp(gEnumTables[i].pField, pField) == 0)
+        {
+            return &gEnumTables[i];
+        }
+    }
+    return NULL;
+}
+
+int cellular_profile_enum_from_string(const char *pField, const char *pName, int *pValue)
+{
+    const EnumTable_t *pTable = find_table(pField);
+    unsigned int i;
+
+    if ((pTable == NULL) || (pName == NULL) || (pValue == NULL))
+    {
+        return RETURN_ERROR;
+    }
+    for (i = 0; i < pTable->count; i++)
+    {
+        if (strcmp(pTable->pNames[i].pName, pName) == 0)
+        {
+            *pValue = pTable->pNames[i].value;
+            return RETURN_OK;
+        }
+    }
+    return RETURN_ERROR;
+}
+
+const char *cellular_profile_enum_to_string(const char *pField, int value)
+{
+    const EnumTable_t *pTable = find_table(pField);
+    unsigned int i;
+
+    for (i = 0; (pTable != NULL) && (i < pTable->count); i++)
+    {
+        if (pTable->pNames[i].value == value)
+        {
+            return pTable->pNames[i].pName;
+        }
+    }
+    return NULL;
+}
+
+static void get_string(const char *pPrefix, const char *pField, char *pValue)
+{
+    char key[KEY_LENGTH];
+
+    snprintf(key, sizeof(key), "%s.%s", pPrefix, pField);
+    pValue[0] = '\0';
+    UT_KVP_PROFILE_GET_STRING(key, pValue);
+}
+
+static uint32_t get_uint32(const char *pPrefix, const char *pField)
+{
+    char key[KEY_LENGTH];
+
+    snprintf(key, sizeof(key), "%s.%s", pPrefix, pField);
+    return UT_KVP_PROFILE_GET_UINT32(key);
+}
+
+static int get_enum(const char *pPrefix, const char *pField, int *pValue)
+{
+    char value[UT_KVP_MAX_ELEMENT_SIZE];
+
+    get_string(pPrefix, pField, value);
+    if (cellular_profile_enum_from_string(pField, value, pValue) != RETURN_OK)
+    {
+        UT_LOG_ERROR("%s.%s: unknown value [%s]", pPrefix, pField, value);
+        return RETURN_ERROR;
+    }
+    return RETURN_OK;
+}
+
+int cellular_profile_from_kvp(const char *pPrefix, CellularProfileStruct *pProfile)
+{
+    char value[UT_KVP_MAX_ELEMENT_SIZE];
+    int enumValue = 0;
+    int result = RETURN_OK;
+
+    if ((pPrefix == NULL) || (pProfile == NULL))
+    {
+        return RETURN_ERROR;
+    }
+    memset(pProfile, 0, sizeof(*pProfile));
+
+    pProfile->ProfileID = (int)get_uint32(pPrefix, "ProfileID");
+    pProfile->PDPContextNumber = (int)get_uint32(pPrefix, "PDPContextNumber");
+    pProfile->ProxyPort = get_uint32(pPrefix, "ProxyPort");
+
+    result |= get_enum(pPrefix, "ProfileType", &enumValue);
+    pProfile->ProfileType = (CellularProfileType_t)enumValue;
+    result |= get_enum(pPrefix, "PDPType", &enumValue);
+    pProfile->PDPType = (CellularPDPType_t)enumValue;
+    result |= get_enum(pPrefix, "PDPAuthentication", &enumValue);
+    pProfile->PDPAuthentication = (CellularPDPAuthentication_t)enumValue;
+    result |= get_enum(pPrefix, "PDPNetworkConfig", &enumValue);
+    pProfile->PDPNetworkConfig = (CellularPDPNetworkConfig_t)enumValue;
+
+    /* The YAML values may be longer than the fields; the precision truncates them explicitly */
+    get_string(pPrefix, "ProfileName", value);
+    snprintf(pProfile->ProfileName, sizeof(pProfile->ProfileName), "%.*s", (int)sizeof(pProfile->ProfileName) - 1, value);
+    get_string(pPrefix, "APN", value);
+    snprintf(pProfile->APN, sizeof(pProfile->APN), "%.*s", (int)sizeof(pProfile->APN) - 1, value);
+    get_string(pPrefix, "Username", value);
+    snprintf(pProfile->Username, sizeof(pProfile->Username), "%.*s", (int)sizeof(pProfile->Username) - 1, value);
+    get_string(pPrefix, "Password", value);
+    snprintf(pProfile->Password, sizeof(pProfile->Password), "%.*s", (int)sizeof(pProfile->Password) - 1, value);
+    get_string(pPrefix, "Proxy", value);
+    snprintf(pProfile->Proxy, sizeof(pProfile->Proxy), "%.*s", (int)sizeof(pProfile->Proxy) - 1, value);
+
+    get_string(pPrefix, "bIsNoRoaming", value);
+    pProfile->bIsNoRoaming = (value[0] == '1');
+    get_string(pPrefix, "bIsAPNDisabled", value);
+    pProfile->bIsAPNDisabled = (value[0] == '1');
+    get_string(pPrefix, "bIsThisDefaultProfile", value);
+    pProfile->bIsThisDefaultProfile = (value[0] == '1');
+
+    return (result == RETURN_OK) ? RETURN_OK : RETURN_ERROR;
+}
+
+int cellular_profile_compile(const char *pOutPath, unsigned int *pCount)
+{
+    cellular_profile_store_t *pStore = cellular_profile_store_create();
+    CellularProfileStruct profile;
+    char prefix[KEY_LENGTH];
+    uint32_t listCount;
+    uint32_t i;
+    int result = RETURN_OK;
+
+    if ((pStore == NULL) || (pOutPath == NULL))
+    {
+        cellular_profile_store_destroy(pStore);
+        return RETURN_ERROR;
+    }
+
+    if ((cellular_profile_from_kvp(CELLULAR_PROFILE_CONFIG_KEY, &profile) != RETURN_OK) ||
+        (cellular_profile_store_put(pStore, &profile) != RETURN_OK))
+    {
+        result = RETURN_ERROR;
+    }
+
+    listCount = ut_kvp_getListCount(ut_kvp_profile_getInstance(), CELLULAR_PROFILE_LIST_KEY);
+    for (i = 0; (i < listCount) && (result == RETURN_OK); i++)
+    {
+        snprintf(prefix, sizeof(prefix), "%s.%u", CELLULAR_PROFILE_LIST_KEY, i);
+        if ((cellular_profile_from_kvp(prefix, &profile) != RETURN_OK) ||
+            (cellular_profile_store_put(pStore, &profile) != RETURN_OK))
+        {
+            result = RETURN_ERROR;
+        }
+    }
+
+    if (result == RETURN_OK)
+    {
+        result = cellular_profile_store_save(pStore, pOutPath);
+    }
+    if (result == RETURN_OK)
+    {
+        UT_LOG_INFO("Compiled %u profiles into %s", cellular_profile_store_count(pStore), pOutPath);
+    }
+    else
+    {
+        UT_LOG_ERROR("Profile compilation into %s failed", pOutPath);
+    }
+    if (pCount != NULL)
+    {
+        *pCount = cellular_profile_store_count(pStore);
+    }
+    cellular_profile_store_destroy(pStore);
+    return result;
+}
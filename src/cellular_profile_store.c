@@ -0,0 +1,660 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:*
+ * Copyright 2023 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file cellular_profile_store.c
+ * @brief Local profile store indexed by ProfileID and APN, with binary persistence
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "cellular_profile_store.h"
+
+#define ALIGN8(x) (((x) + 7u) & ~7u)
+
+struct cellular_profile_store_s
+{
+    CellularProfileStruct *pRecords;      /* Sorted by ProfileID */
+    const CellularProfileStruct **ppByApn; /* Sorted by APN */
+    unsigned int count;
+    unsigned int capacity;
+};
+
+static uint32_t fnv1a(const uint8_t *pData, size_t length)
+{
+    uint32_t hash = 2166136261u;
+    size_t i;
+
+    for (i = 0; i < length; i++)
+    {
+        hash ^= pData[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/* Copies field by field into a zeroed record so padding bytes never reach the file */
+static void copy_profile(CellularProfileStruct *pDst, const CellularProfileStruct *pSrc)
+{
+    memset(pDst, 0, sizeof(*pDst));
+    pDst->ProfileID = pSrc->ProfileID;
+    pDst->ProfileType = pSrc->ProfileType;
+    pDst->PDPContextNumber = pSrc->PDPContextNumber;
+    pDst->PDPType = pSrc->PDPType;
+    pDst->PDPAuthentication = pSrc->PDPAuthentication;
+    pDst->PDPNetworkConfig = pSrc->PDPNetworkConfig;
+    snprintf(pDst->ProfileName, sizeof(pDst->ProfileName), "%s", pSrc->ProfileName);
+    snprintf(pDst->APN, sizeof(pDst->APN), "%s", pSrc->APN);
+    snprintf(pDst->Username, sizeof(pDst->Username), "%s", pSrc->Username);
+    snprintf(pDst->Password, sizeof(pDst->Password), "%s", pSrc->Password);
+    snprintf(pDst->Proxy, sizeof(pDst->Proxy), "%s", pSrc->Proxy);
+    pDst->ProxyPort = pSrc->ProxyPort;
+    pDst->bIsNoRoaming = pSrc->bIsNoRoaming;
+    pDst->bIsAPNDisabled = pSrc->bIsAPNDisabled;
+    pDst->bIsThisDefaultProfile = pSrc->bIsThisDefaultProfile;
+}
+
+int cellular_profile_equal(const CellularProfileStruct *pA, const CellularProfileStruct *pB)
+{
+    return (pA->ProfileID == pB->ProfileID) &&
+           (pA->ProfileType == pB->ProfileType) &&
+           (pA->PDPContextNumber == pB->PDPContextNumber) &&
+           (pA->PDPType == pB->PDPType) &&
+           (pA->PDPAuthentication == pB->PDPAuthentication) &&
+           (pA->PDPNetworkConfig == pB->PDPNetworkConfig) &&
+           (strncmp(pA->ProfileName, pB->ProfileName, sizeof(pA->ProfileName)) == 0) &&
+           (strncmp(pA->APN, pB->APN, sizeof(pA->APN)) == 0) &&
+           (strncmp(pA->Username, pB->Username, sizeof(pA->Username)) == 0) &&
+           (strncmp(pA->Password, pB->Password, sizeof(pA->Password)) == 0) &&
+           (strncmp(pA->Proxy, pB->Proxy, sizeof(pA->Proxy)) == 0) &&
+           (pA->ProxyPort == pB->ProxyPort) &&
+           (pA->bIsNoRoaming == pB->bIsNoRoaming) &&
+           (pA->bIsAPNDisabled == pB->bIsAPNDisabled) &&
+           (pA->bIsThisDefaultProfile == pB->bIsThisDefaultProfile);
+}
+
+static int compare_apn(const void *pLeft, const void *pRight)
+{
+    const CellularProfileStruct *pA = *(const CellularProfileStruct *const *)pLeft;
+    const CellularProfileStruct *pB = *(const CellularProfileStruct *const *)pRight;
+    int result = strncmp(pA->APN, pB->APN, sizeof(pA->APN));
+
+    if (result == 0)
+    {
+        result = (pA->ProfileID > pB->ProfileID) - (pA->ProfileID < pB->ProfileID);
+    }
+    return result;
+}
+
+static int compare_profile_ptr_id(const void *pLeft, const void *pRight)
+{
+    const CellularProfileStruct *pA = *(const CellularProfileStruct *const *)pLeft;
+    const CellularProfileStruct *pB = *(const CellularProfileStruct *const *)pRight;
+
+    return (pA->ProfileID > pB->ProfileID) - (pA->ProfileID < pB->ProfileID);
+}
+
+static void rebuild_apn_index(cellular_profile_store_t *pStore)
+{
+    unsigned int i;
+
+    for (i = 0; i < pStore->count; i++)
+    {
+        pStore->ppByApn[i] = &pStore->pRecords[i];
+    }
+    qsort(pStore->ppByApn, pStore->count, sizeof(pStore->ppByApn[0]), compare_apn);
+}
+
+/* Returns the position of 'profileId', or the insertion point with *pFound = 0 */
+static unsigned int search_id(const cellular_profile_store_t *pStore, int profileId, int *pFound)
+{
+    unsigned int low = 0;
+    unsigned int high = pStore->count;
+    unsigned int mid;
+
+    *pFound = 0;
+    while (low < high)
+    {
+        mid = low + ((high - low) / 2);
+        if (pStore->pRecords[mid].ProfileID < profileId)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    if ((low < pStore->count) && (pStore->pRecords[low].ProfileID == profileId))
+    {
+        *pFound = 1;
+    }
+    return low;
+}
+
+int cellular_profile_file_map(const char *pPath, CellularProfileFileView_t *pView)
+{
+    const CellularProfileFileHeader_t *pHeader;
+    struct stat st;
+    size_t indexBytes;
+    uint32_t i;
+    void *pBase;
+    int fd;
+
+    if ((pPath == NULL) || (pView == NULL))
+    {
+        return RETURN_ERROR;
+    }
+    memset(pView, 0, sizeof(*pView));
+
+    fd = open(pPath, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return RETURN_ERROR;
+    }
+    if ((fstat(fd, &st) != 0) || (st.st_size < (off_t)sizeof(CellularProfileFileHeader_t)))
+    {
+        close(fd);
+        return RETURN_ERROR;
+    }
+    pBase = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (pBase == MAP_FAILED)
+    {
+        return RETURN_ERROR;
+    }
+
+    pHeader = (const CellularProfileFileHeader_t *)pBase;
+    indexBytes = (size_t)pHeader->count * sizeof(uint32_t);
+    if ((memcmp(pHeader->magic, CELLULAR_PROFILE_FILE_MAGIC, sizeof(pHeader->magic)) != 0) ||
+        (pHeader->version != CELLULAR_PROFILE_FILE_VERSION) ||
+        (pHeader->header_size != sizeof(CellularProfileFileHeader_t)) ||
+        (pHeader->record_size != sizeof(CellularProfileStruct)) ||
+        (pHeader->file_size != (uint32_t)st.st_size) ||
+        ((pHeader->records_offset | pHeader->by_id_offset | pHeader->by_apn_offset) & 7u) ||
+        ((uint64_t)pHeader->records_offset + ((uint64_t)pHeader->count * sizeof(CellularProfileStruct)) > pHeader->file_size) ||
+        ((uint64_t)pHeader->by_id_offset + indexBytes > pHeader->file_size) ||
+        ((uint64_t)pHeader->by_apn_offset + indexBytes > pHeader->file_size) ||
+        (fnv1a((const uint8_t *)pBase + sizeof(CellularProfileFileHeader_t), pHeader->file_size - sizeof(CellularProfileFileHeader_t)) != pHeader->checksum))
+    {
+        munmap(pBase, (size_t)st.st_size);
+        return RETURN_ERROR;
+    }
+
+    pView->pBase = pBase;
+    pView->length = (size_t)st.st_size;
+    pView->count = pHeader->count;
+    pView->pRecords = (const CellularProfileStruct *)((const uint8_t *)pBase + pHeader->records_offset);
+    pView->pById = (const uint32_t *)((const uint8_t *)pBase + pHeader->by_id_offset);
+    pView->pByApn = (const uint32_t *)((const uint8_t *)pBase + pHeader->by_apn_offset);
+    for (i = 0; i < pView->count; i++)
+    {
+        if ((pView->pById[i] >= pView->count) || (pView->pByApn[i] >= pView->count))
+        {
+            cellular_profile_file_unmap(pView);
+            return RETURN_ERROR;
+        }
+    }
+    return RETURN_OK;
+}
+
+void cellular_profile_file_unmap(CellularProfileFileView_t *pView)
+{
+    if ((pView != NULL) && (pView->pBase != NULL))
+    {
+        munmap(pView->pBase, pView->length);
+        memset(pView, 0, sizeof(*pView));
+    }
+}
+
+const CellularProfileStruct *cellular_profile_file_find_by_id(const CellularProfileFileView_t *pView, int profileId)
+{
+    uint32_t low = 0;
+    uint32_t high;
+    uint32_t mid;
+    const CellularProfileStruct *pRecord;
+
+    if ((pView == NULL) || (pView->pBase == NULL))
+    {
+        return NULL;
+    }
+    high = pView->count;
+    while (low < high)
+    {
+        mid = low + ((high - low) / 2);
+        pRecord = &pView->pRecords[pView->pById[mid]];
+        if (pRecord->ProfileID == profileId)
+        {
+            return pRecord;
+        }
+        if (pRecord->ProfileID < profileId)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    return NULL;
+}
+
+const CellularProfileStruct *cellular_profile_file_find_by_apn(const CellularProfileFileView_t *pView, const char *pApn)
+{
+    uint32_t low = 0;
+    uint32_t high;
+    uint32_t mid;
+    const CellularProfileStruct *pRecord;
+    int result;
+
+    if ((pView == NULL) || (pView->pBase == NULL) || (pApn == NULL))
+    {
+        return NULL;
+    }
+    high = pView->count;
+    while (low < high)
+    {
+        mid = low + ((high - low) / 2);
+        pRecord = &pView->pRecords[pView->pByApn[mid]];
+        result = strncmp(pRecord->APN, pApn, sizeof(pRecord->APN));
+        if (result < 0)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    if ((low < pView->count) && (strncmp(pView->pRecords[pView->pByApn[low]].APN, pApn, sizeof(pView->pRecords[0].APN)) == 0))
+    {
+        return &pView->pRecords[pView->pByApn[low]];
+    }
+    return NULL;
+}
+
+cellular_profile_store_t *cellular_profile_store_create(void)
+{
+    return (cellular_profile_store_t *)calloc(1, sizeof(cellular_profile_store_t));
+}
+
+void cellular_profile_store_destroy(cellular_profile_store_t *pStore)
+{
+    if (pStore != NULL)
+    {
+        free(pStore->pRecords);
+        free(pStore->ppByApn);
+        free(pStore);
+    }
+}
+
+static int reserve(cellular_profile_store_t *pStore, unsigned int capacity)
+{
+    CellularProfileStruct *pRecords;
+    const CellularProfileStruct **ppByApn;
+
+    if (capacity <= pStore->capacity)
+    {
+        return RETURN_OK;
+    }
+    if (capacity < (pStore->capacity * 2))
+    {
+        capacity = pStore->capacity * 2;
+    }
+    if (capacity < 8)
+    {
+        capacity = 8;
+    }
+    /* The index first: if the records then fail to grow, the index still points at them */
+    ppByApn = (const CellularProfileStruct **)realloc((void *)pStore->ppByApn, capacity * sizeof(ppByApn[0]));
+    if (ppByApn == NULL)
+    {
+        return RETURN_ERROR;
+    }
+    pStore->ppByApn = ppByApn;
+    pRecords = (CellularProfileStruct *)realloc(pStore->pRecords, capacity * sizeof(CellularProfileStruct));
+    if (pRecords == NULL)
+    {
+        return RETURN_ERROR;
+    }
+    pStore->pRecords = pRecords;
+    pStore->capacity = capacity;
+    /* Records may have moved */
+    rebuild_apn_index(pStore);
+    return RETURN_OK;
+}
+
+int cellular_profile_store_load(cellular_profile_store_t *pStore, const char *pPath)
+{
+    CellularProfileFileView_t view;
+    uint32_t i;
+
+    if (pStore == NULL)
+    {
+        return RETURN_ERROR;
+    }
+    if (cellular_profile_file_map(pPath, &view) != RETURN_OK)
+    {
+        return RETURN_ERROR;
+    }
+    if (reserve(pStore, view.count) != RETURN_OK)
+    {
+        cellular_profile_file_unmap(&view);
+        return RETURN_ERROR;
+    }
+    /* Records are stored in ProfileID order, which is the store's own order */
+    for (i = 0; i < view.count; i++)
+    {
+        copy_profile(&pStore->pRecords[i], &view.pRecords[view.pById[i]]);
+    }
+    pStore->count = view.count;
+    rebuild_apn_index(pStore);
+    cellular_profile_file_unmap(&view);
+    return RETURN_OK;
+}
+
+int cellular_profile_store_save(const cellular_profile_store_t *pStore, const char *pPath)
+{
+    CellularProfileFileHeader_t *pHeader;
+    uint32_t *pById;
+    uint32_t *pByApn;
+    uint8_t *pBuffer;
+    size_t recordBytes;
+    size_t indexBytes;
+    size_t total;
+    char tmpPath[512];
+    unsigned int i;
+    FILE *pFile;
+    int result = RETURN_ERROR;
+
+    if ((pStore == NULL) || (pPath == NULL) || (snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", pPath) >= (int)sizeof(tmpPath)))
+    {
+        return RETURN_ERROR;
+    }
+
+    recordBytes = ALIGN8(pStore->count * sizeof(CellularProfileStruct));
+    indexBytes = ALIGN8(pStore->count * sizeof(uint32_t));
+    total = ALIGN8(sizeof(CellularProfileFileHeader_t)) + recordBytes + (2 * indexBytes);
+    pBuffer = (uint8_t *)calloc(1, total);
+    if (pBuffer == NULL)
+    {
+        return RETURN_ERROR;
+    }
+
+    pHeader = (CellularProfileFileHeader_t *)pBuffer;
+    memcpy(pHeader->magic, CELLULAR_PROFILE_FILE_MAGIC, sizeof(pHeader->magic));
+    pHeader->version = CELLULAR_PROFILE_FILE_VERSION;
+    pHeader->header_size = sizeof(CellularProfileFileHeader_t);
+    pHeader->record_size = sizeof(CellularProfileStruct);
+    pHeader->count = pStore->count;
+    pHeader->records_offset = ALIGN8(sizeof(CellularProfileFileHeader_t));
+    pHeader->by_id_offset = pHeader->records_offset + (uint32_t)recordBytes;
+    pHeader->by_apn_offset = pHeader->by_id_offset + (uint32_t)indexBytes;
+    pHeader->file_size = (uint32_t)total;
+
+    if (pStore->count > 0)
+    {
+        memcpy(pBuffer + pHeader->records_offset, pStore->pRecords, pStore->count * sizeof(CellularProfileStruct));
+    }
+    pById = (uint32_t *)(pBuffer + pHeader->by_id_offset);
+    pByApn = (uint32_t *)(pBuffer + pHeader->by_apn_offset);
+    for (i = 0; i < pStore->count; i++)
+    {
+        pById[i] = i;
+        pByApn[i] = (uint32_t)(pStore->ppByApn[i] - pStore->pRecords);
+    }
+    pHeader->checksum = fnv1a(pBuffer + sizeof(CellularProfileFileHeader_t), total - sizeof(CellularProfileFileHeader_t));
+
+    pFile = fopen(tmpPath, "wb");
+    if (pFile != NULL)
+    {
+        if ((fwrite(pBuffer, 1, total, pFile) == total) && (fflush(pFile) == 0) && (fsync(fileno(pFile)) == 0))
+        {
+            result = RETURN_OK;
+        }
+        if (fclose(pFile) != 0)
+        {
+            result = RETURN_ERROR;
+        }
+        if ((result == RETURN_OK) && (rename(tmpPath, pPath) != 0))
+        {
+            result = RETURN_ERROR;
+        }
+        if (result != RETURN_OK)
+        {
+            unlink(tmpPath);
+        }
+    }
+    free(pBuffer);
+    return result;
+}
+
+int cellular_profile_store_put(cellular_profile_store_t *pStore, const CellularProfileStruct *pProfile)
+{
+    unsigned int pos;
+    int found;
+
+    if ((pStore == NULL) || (pProfile == NULL))
+    {
+        return RETURN_ERROR;
+    }
+    pos = search_id(pStore, pProfile->ProfileID, &found);
+    if (!found)
+    {
+        if (reserve(pStore, pStore->count + 1) != RETURN_OK)
+        {
+            return RETURN_ERROR;
+        }
+        memmove(&pStore->pRecords[pos + 1], &pStore->pRecords[pos], (pStore->count - pos) * sizeof(CellularProfileStruct));
+        pStore->count++;
+    }
+    copy_profile(&pStore->pRecords[pos], pProfile);
+    rebuild_apn_index(pStore);
+    return RETURN_OK;
+}
+
+int cellular_profile_store_remove(cellular_profile_store_t *pStore, int profileId)
+{
+    unsigned int pos;
+    int found;
+
+    if (pStore == NULL)
+    {
+        return RETURN_ERROR;
+    }
+    pos = search_id(pStore, profileId, &found);
+    if (!found)
+    {
+        return RETURN_ERROR;
+    }
+    memmove(&pStore->pRecords[pos], &pStore->pRecords[pos + 1], (pStore->count - pos - 1) * sizeof(CellularProfileStruct));
+    pStore->count--;
+    rebuild_apn_index(pStore);
+    return RETURN_OK;
+}
+
+const CellularProfileStruct *cellular_profile_store_find_by_id(const cellular_profile_store_t *pStore, int profileId)
+{
+    unsigned int pos;
+    int found;
+
+    if (pStore == NULL)
+    {
+        return NULL;
+    }
+    pos = search_id(pStore, profileId, &found);
+    return found ? &pStore->pRecords[pos] : NULL;
+}
+
+const CellularProfileStruct *cellular_profile_store_find_by_apn(const cellular_profile_store_t *pStore, const char *pApn)
+{
+    unsigned int low = 0;
+    unsigned int high;
+    unsigned int mid;
+
+    if ((pStore == NULL) || (pApn == NULL))
+    {
+        return NULL;
+    }
+    high = pStore->count;
+    while (low < high)
+    {
+        mid = low + ((high - low) / 2);
+        if (strncmp(pStore->ppByApn[mid]->APN, pApn, sizeof(pStore->ppByApn[mid]->APN)) < 0)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    if ((low < pStore->count) && (strncmp(pStore->ppByApn[low]->APN, pApn, sizeof(pStore->ppByApn[low]->APN)) == 0))
+    {
+        return pStore->ppByApn[low];
+    }
+    return NULL;
+}
+
+unsigned int cellular_profile_store_count(const cellular_profile_store_t *pStore)
+{
+    return (pStore != NULL) ? pStore->count : 0;
+}
+
+const CellularProfileStruct *cellular_profile_store_at(const cellular_profile_store_t *pStore, unsigned int index)
+{
+    if ((pStore == NULL) || (index >= pStore->count))
+    {
+        return NULL;
+    }
+    return &pStore->pRecords[index];
+}
+
+const CellularProfileStruct *cellular_profile_store_default(const cellular_profile_store_t *pStore)
+{
+    unsigned int i;
+
+    if ((pStore == NULL) || (pStore->count == 0))
+    {
+        return NULL;
+    }
+    for (i = 0; i < pStore->count; i++)
+    {
+        if (pStore->pRecords[i].bIsThisDefaultProfile)
+        {
+            return &pStore->pRecords[i];
+        }
+    }
+    return &pStore->pRecords[0];
+}
+
+int cellular_profile_store_sync(const cellular_profile_store_t *pStore, cellular_device_profile_status_api_callback pCallback,
+                                int allowDelete, CellularProfileSyncResult_t *pResult)
+{
+    CellularProfileStruct *pHalProfiles = NULL;
+    CellularProfileStruct **ppHalById = NULL;
+    CellularProfileStruct **ppMatch;
+    CellularProfileStruct key;
+    CellularProfileStruct *pKey = &key;
+    CellularProfileStruct work;
+    int halCount = 0;
+    unsigned int i;
+    int status;
+
+    if ((pStore == NULL) || (pResult == NULL))
+    {
+        return RETURN_ERROR;
+    }
+    memset(pResult, 0, sizeof(*pResult));
+
+    if (cellular_hal_get_profile_list(&pHalProfiles, &halCount) != RETURN_OK)
+    {
+        free(pHalProfiles);
+        return RETURN_ERROR;
+    }
+    if ((pHalProfiles == NULL) || (halCount < 0))
+    {
+        halCount = 0;
+    }
+    if (halCount > 0)
+    {
+        ppHalById = (CellularProfileStruct **)malloc((size_t)halCount * sizeof(ppHalById[0]));
+        if (ppHalById == NULL)
+        {
+            free(pHalProfiles);
+            return RETURN_ERROR;
+        }
+        for (i = 0; i < (unsigned int)halCount; i++)
+        {
+            ppHalById[i] = &pHalProfiles[i];
+        }
+        qsort(ppHalById, (size_t)halCount, sizeof(ppHalById[0]), compare_profile_ptr_id);
+    }
+
+    memset(&key, 0, sizeof(key));
+    for (i = 0; i < pStore->count; i++)
+    {
+        key.ProfileID = pStore->pRecords[i].ProfileID;
+        ppMatch = (halCount > 0) ? (CellularProfileStruct **)bsearch(&pKey, ppHalById, (size_t)halCount, sizeof(ppHalById[0]), compare_profile_ptr_id) : NULL;
+        if ((ppMatch != NULL) && cellular_profile_equal(*ppMatch, &pStore->pRecords[i]))
+        {
+            pResult->unchanged++;
+            continue;
+        }
+        /* The HAL takes a non-const pointer, so hand it a scratch copy */
+        work = pStore->pRecords[i];
+        if (ppMatch == NULL)
+        {
+            status = cellular_hal_profile_create(&work, pCallback);
+            pResult->created++;
+        }
+        else
+        {
+            status = cellular_hal_profile_modify(&work, pCallback);
+            pResult->modified++;
+        }
+        if (status != RETURN_OK)
+        {
+            pResult->failed++;
+        }
+    }
+
+    if (allowDelete)
+    {
+        for (i = 0; i < (unsigned int)halCount; i++)
+        {
+            if (cellular_profile_store_find_by_id(pStore, pHalProfiles[i].ProfileID) == NULL)
+            {
+                pResult->deleted++;
+                if (cellular_hal_profile_delete(&pHalProfiles[i], pCallback) != RETURN_OK)
+                {
+                    pResult->failed++;
+                }
+            }
+        }
+    }
+
+    free(ppHalById);
+    free(pHalProfiles);
+    return (pResult->failed == 0) ? RETURN_OK : RETURN_ERROR;
+}
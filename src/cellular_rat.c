@@ -0,0 +1,63 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:*
+ * Copyright 2023 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file cellular_rat.c
+ * @brief Radio access technology names used by the cellular_hal RAT APIs
+ */
+
+#include <string.h>
+#include "cellular_rat.h"
+
+static const char *gRatNames[CELLULAR_RAT_MAX] =
+{
+    "UNKNOWN",
+    "CDMA20001X",
+    "EVDO",
+    "GSM",
+    "UMTS",
+    "LTE",
+    "NR"
+};
+
+CellularRat_t cellular_rat_from_string(const char *pName)
+{
+    int rat;
+
+    if ((pName == NULL) || (pName[0] == '\0'))
+    {
+        return CELLULAR_RAT_UNKNOWN;
+    }
+    for (rat = CELLULAR_RAT_UNKNOWN + 1; rat < CELLULAR_RAT_MAX; rat++)
+    {
+        if (strcmp(pName, gRatNames[rat]) == 0)
+        {
+            return (CellularRat_t)rat;
+        }
+    }
+    return CELLULAR_RAT_UNKNOWN;
+}
+
+const char *cellular_rat_to_string(CellularRat_t rat)
+{
+    if (((int)rat < 0) || (rat >= CELLULAR_RAT_MAX))
+    {
+        return gRatNames[CELLULAR_RAT_UNKNOWN];
+    }
+    return gRatNames[rat];
+}
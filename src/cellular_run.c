@@ -0,0 +1,224 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:*
+ * Copyright 2023 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file cellular_run.c
+ * @brief Run conditions for stable benchmark results
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <ut_log.h>
+#include "cellular_run.h"
+#include "cellular_metrics.h"
+
+static CellularRunConditions_t gConditions = { "", 0, 0, 0, "unknown" };
+
+/* Parses "0-1,3" into a CPU set; returns -1 on a malformed list */
+static int parse_cpus(const char *pList, cpu_set_t *pSet)
+{
+    const char *pChar = pList;
+    char *pEnd;
+    long first, last, cpu;
+
+    CPU_ZERO(pSet);
+    while (*pChar != '\0')
+    {
+        first = strtol(pChar, &pEnd, 10);
+        if ((pEnd == pChar) || (first < 0))
+        {
+            return -1;
+        }
+        last = first;
+        if (*pEnd == '-')
+        {
+            pChar = pEnd + 1;
+            last = strtol(pChar, &pEnd, 10);
+            if ((pEnd == pChar) || (last < first))
+            {
+                return -1;
+            }
+        }
+        for (cpu = first; (cpu <= last) && (cpu < CPU_SETSIZE); cpu++)
+        {
+            CPU_SET((int)cpu, pSet);
+        }
+        pChar = (*pEnd == ',') ? pEnd + 1 : pEnd;
+        if ((*pEnd != ',') && (*pEnd != '\0'))
+        {
+            return -1;
+        }
+    }
+    return (CPU_COUNT(pSet) > 0) ? 0 : -1;
+}
+
+/* Formats a CPU set as a list with ranges, the way it is given */
+static void format_cpus(const cpu_set_t *pSet, char *pList, size_t size)
+{
+    size_t used = 0;
+    int cpu, last;
+
+    pList[0] = '\0';
+    for (cpu = 0; (cpu < CPU_SETSIZE) && (used < size); cpu++)
+    {
+        if (!CPU_ISSET(cpu, pSet))
+        {
+            continue;
+        }
+        for (last = cpu; (last + 1 < CPU_SETSIZE) && CPU_ISSET(last + 1, pSet); last++)
+        {
+        }
+        used += (size_t)snprintf(&pList[used], size - used, (last > cpu) ? "%s%d-%d" : "%s%d", (used > 0) ? "," : "", cpu, last);
+        cpu = last;
+    }
+}
+
+static void read_governor(void)
+{
+    FILE *pFile = fopen("/sys/devices/system/cpu/cpu0/cpufreq/scaling_governor", "r");
+
+    if (pFile == NULL)
+    {
+        return;
+    }
+    if (fgets(gConditions.governor, sizeof(gConditions.governor), pFile) != NULL)
+    {
+        gConditions.governor[strcspn(gConditions.governor, "\n")] = '\0';
+    }
+    fclose(pFile);
+}
+
+/* The conditions as an info metric, one sample of value 1 */
+static void collect_metrics(FILE *pOut)
+{
+    char priority[16];
+    char warmup[16];
+
+    snprintf(priority, sizeof(priority), "%d", gConditions.fifo_priority);
+    snprintf(warmup, sizeof(warmup), "%u", gConditions.warmup);
+    cellular_metrics_family(pOut, "cellular_run_info", CELLULAR_METRIC_GAUGE, "Conditions the tests ran under");
+    cellular_metrics_sample(pOut, "cellular_run_info", 1.0, "cpus", gConditions.cpus,
+                            "sched", (gConditions.fifo_priority > 0) ? "fifo" : "other", "priority", priority,
+                            "mlock", gConditions.memory_locked ? "yes" : "no", "warmup", warmup,
+                            "governor", gConditions.governor, NULL);
+}
+
+int cellular_run_apply(void)
+{
+    struct sched_param param;
+    cpu_set_t set;
+    const char *pValue;
+    int result = RETURN_OK;
+
+    pValue = getenv("CELLULAR_RUN_CPUS");
+    if (pValue != NULL)
+    {
+        if (parse_cpus(pValue, &set) != 0)
+        {
+            UT_LOG_WARNING("CELLULAR_RUN_CPUS: invalid CPU list [%s]", pValue);
+            result = RETURN_ERROR;
+        }
+        else if (sched_setaffinity(0, sizeof(set), &set) != 0)
+        {
+            UT_LOG_WARNING("Cannot pin to CPUs %s: %s", pValue, strerror(errno));
+            result = RETURN_ERROR;
+        }
+    }
+
+    pValue = getenv("CELLULAR_RUN_FIFO");
+    if (pValue != NULL)
+    {
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = atoi(pValue);
+        if (param.sched_priority < sched_get_priority_min(SCHED_FIFO))
+        {
+            param.sched_priority = sched_get_priority_min(SCHED_FIFO);
+        }
+        if (param.sched_priority > sched_get_priority_max(SCHED_FIFO))
+        {
+            param.sched_priority = sched_get_priority_max(SCHED_FIFO);
+        }
+        /* Only the test thread: threads it creates inherit it, the ones it does not create are left alone */
+        if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0)
+        {
+            UT_LOG_WARNING("Cannot set SCHED_FIFO priority %d, CAP_SYS_NICE or an RLIMIT_RTPRIO is needed", param.sched_priority);
+            result = RETURN_ERROR;
+        }
+        else
+        {
+            gConditions.fifo_priority = param.sched_priority;
+        }
+    }
+
+    if ((getenv("CELLULAR_RUN_MLOCK") != NULL) && (strcmp(getenv("CELLULAR_RUN_MLOCK"), "0") != 0))
+    {
+        if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+        {
+            UT_LOG_WARNING("Cannot lock memory: %s, raise RLIMIT_MEMLOCK", strerror(errno));
+            result = RETURN_ERROR;
+        }
+        else
+        {
+            gConditions.memory_locked = 1;
+        }
+    }
+
+    pValue = getenv("CELLULAR_RUN_WARMUP");
+    gConditions.warmup = (pValue != NULL) ? (unsigned int)strtoul(pValue, NULL, 10) : 0;
+
+    if (sched_getaffinity(0, sizeof(set), &set) == 0)
+    {
+        format_cpus(&set, gConditions.cpus, sizeof(gConditions.cpus));
+    }
+    read_governor();
+    UT_LOG_INFO("Run conditions: CPUs %s, %s priority %d, memory %s, %u warm-up passes, governor %s", gConditions.cpus,
+                (gConditions.fifo_priority > 0) ? "SCHED_FIFO" : "SCHED_OTHER", gConditions.fifo_priority,
+                gConditions.memory_locked ? "locked" : "not locked", gConditions.warmup, gConditions.governor);
+    cellular_metrics_add_collector(collect_metrics);
+    return result;
+}
+
+void cellular_run_get_conditions(CellularRunConditions_t *pConditions)
+{
+    if (pConditions != NULL)
+    {
+        *pConditions = gConditions;
+    }
+}
+
+unsigned int cellular_run_warmup(void)
+{
+    return gConditions.warmup;
+}
+
+void cellular_run_background_thread(void)
+{
+    struct sched_param param;
+
+    if (gConditions.fifo_priority > 0)
+    {
+        memset(&param, 0, sizeof(param));
+        pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+    }
+}
@@ -0,0 +1,536 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:*
+ * Copyright 2023 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file cellular_sampler.c
+ * @brief Sampling CPU profiler writing folded stacks per test
+ *
+ * The handler neither allocates nor locks: stacks are counted in an open addressing
+ * table claimed with compare-and-swap, and symbols are only resolved when the table
+ * is written out. backtrace() is called once before the timer starts, so the unwinder
+ * is loaded outside of the handler.
+ */
+
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <errno.h>
+#include <execinfo.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/prctl.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <ut_log.h>
+#include "cellular_sampler.h"
+#include "cellular_bench.h"
+#include "cellular_metrics.h"
+
+/* Frames of the handler and of the signal return trampoline above the interrupted one */
+#define HANDLER_FRAMES 2
+#define MAX_LINE       4096
+#define TOP_FUNCTIONS  10
+
+typedef struct
+{
+    uint64_t hash;                               /* 0 while the entry is free */
+    int ready;                                   /* Set once the key below is written */
+    const char *pTest;
+    int testId;
+    int api;
+    char thread[16];
+    int depth;
+    void *pcs[CELLULAR_SAMPLER_MAX_DEPTH];
+    uint64_t count;
+} SamplerStack_t;
+
+typedef struct
+{
+    char *pLine;
+    uint64_t count;
+} SamplerLine_t;
+
+static SamplerStack_t *gpStacks = NULL;
+static unsigned int gHz = 0;
+static unsigned int gStarts = 0;    /* Starts not yet stopped */
+static uint64_t gSamples = 0;
+static uint64_t gDropped = 0;
+static uint64_t gStackCount = 0;
+static uint64_t gHandlerNs = 0;
+static uint64_t gStartCpuNs = 0;
+static __thread int tApi = -1;
+
+static void probe_call_begin(CellularHalApi_t api)
+{
+    tApi = (int)api;
+}
+
+static void probe_call_end(CellularHalApi_t api)
+{
+    tApi = -1;
+}
+
+static int same_stack(const SamplerStack_t *pStack, const SamplerStack_t *pKey)
+{
+    return (pStack->pTest == pKey->pTest) && (pStack->testId == pKey->testId) && (pStack->api == pKey->api) &&
+           (pStack->depth == pKey->depth) && (strncmp(pStack->thread, pKey->thread, sizeof(pKey->thread)) == 0) &&
+           (memcmp(pStack->pcs, pKey->pcs, (size_t)pKey->depth * sizeof(void *)) == 0);
+}
+
+static uint64_t hash_bytes(uint64_t hash, const void *pData, size_t size)
+{
+    const unsigned char *pByte = (const unsigned char *)pData;
+    size_t i;
+
+    for (i = 0; i < size; i++)
+    {
+        hash = (hash ^ pByte[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+static void on_sigprof(int sig)
+{
+    int savedErrno = errno;
+    uint64_t begin = cellular_bench_now_ns();
+    void *pcs[CELLULAR_SAMPLER_MAX_DEPTH + HANDLER_FRAMES];
+    SamplerStack_t key;
+    SamplerStack_t *pStack;
+    uint64_t hash, expected;
+    unsigned int probe;
+    int depth;
+
+    memset(&key, 0, sizeof(key));
+    depth = backtrace(pcs, CELLULAR_SAMPLER_MAX_DEPTH + HANDLER_FRAMES) - HANDLER_FRAMES;
+    key.depth = (depth > 0) ? depth : 0;
+    memcpy(key.pcs, &pcs[HANDLER_FRAMES], (size_t)key.depth * sizeof(void *));
+    key.pTest = cellular_trace_current_test(&key.testId);
+    key.api = tApi;
+    prctl(PR_GET_NAME, key.thread, 0, 0, 0);
+    hash = hash_bytes(14695981039346656037ULL, &key.pTest, sizeof(key.pTest));
+    hash = hash_bytes(hash, &key.testId, sizeof(key.testId));
+    hash = hash_bytes(hash, &key.api, sizeof(key.api));
+    hash = hash_bytes(hash, key.thread, sizeof(key.thread));
+    hash = hash_bytes(hash, key.pcs, (size_t)key.depth * sizeof(void *)) | 1;
+
+    for (probe = 0; probe < CELLULAR_SAMPLER_MAX_STACKS; probe++)
+    {
+        pStack = &gpStacks[(hash + probe) % CELLULAR_SAMPLER_MAX_STACKS];
+        expected = 0;
+        if ((__atomic_load_n(&pStack->hash, __ATOMIC_ACQUIRE) == hash) && __atomic_load_n(&pStack->ready, __ATOMIC_ACQUIRE) &&
+            same_stack(pStack, &key))
+        {
+            __atomic_add_fetch(&pStack->count, 1, __ATOMIC_RELAXED);
+            break;
+        }
+        if (__atomic_compare_exchange_n(&pStack->hash, &expected, hash, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        {
+            /* Claimed: a concurrent sample of the same stack may claim another entry, they are merged on writing */
+            pStack->pTest = key.pTest;
+            pStack->testId = key.testId;
+            pStack->api = key.api;
+            memcpy(pStack->thread, key.thread, sizeof(key.thread));
+            pStack->depth = key.depth;
+            memcpy(pStack->pcs, key.pcs, (size_t)key.depth * sizeof(void *));
+            pStack->count = 1;
+            __atomic_store_n(&pStack->ready, 1, __ATOMIC_RELEASE);
+            __atomic_add_fetch(&gStackCount, 1, __ATOMIC_RELAXED);
+            break;
+        }
+    }
+    if (probe == CELLULAR_SAMPLER_MAX_STACKS)
+    {
+        __atomic_add_fetch(&gDropped, 1, __ATOMIC_RELAXED);
+    }
+    else
+    {
+        __atomic_add_fetch(&gSamples, 1, __ATOMIC_RELAXED);
+    }
+    __atomic_add_fetch(&gHandlerNs, cellular_bench_now_ns() - begin, __ATOMIC_RELAXED);
+    errno = savedErrno;
+}
+
+/* Symbol of a frame, library+offset when it is not exported */
+static void frame_name(void *pPc, int interrupted, char *pName, size_t size)
+{
+    /* Return addresses point after the call, into the next statement */
+    const char *pLookup = interrupted ? (const char *)pPc : (const char *)pPc - 1;
+    const char *pBase;
+    Dl_info info;
+
+    if ((dladdr(pLookup, &info) == 0) || (info.dli_fname == NULL))
+    {
+        snprintf(pName, size, "%p", pPc);
+        return;
+    }
+    if (info.dli_sname != NULL)
+    {
+        snprintf(pName, size, "%s", info.dli_sname);
+        return;
+    }
+    pBase = strrchr(info.dli_fname, '/');
+    snprintf(pName, size, "%s+0x%lx", (pBase != NULL) ? pBase + 1 : info.dli_fname,
+             (unsigned long)(pLookup - (const char *)info.dli_fbase));
+}
+
+static void fold_stack(const SamplerStack_t *pStack, char *pLine, size_t size)
+{
+    char frame[256];
+    size_t used;
+    int i;
+
+    if (pStack->pTest == NULL)
+    {
+        used = (size_t)snprintf(pLine, size, "(no test);%s", pStack->thread);
+    }
+    else
+    {
+        used = (size_t)snprintf(pLine, size, "%s [%05d];%s", pStack->pTest, pStack->testId, pStack->thread);
+    }
+    if ((pStack->api >= 0) && (used < size))
+    {
+        used += (size_t)snprintf(&pLine[used], size - used, ";%s", cellular_trace_api_name((CellularHalApi_t)pStack->api));
+    }
+    for (i = pStack->depth - 1; (i >= 0) && (used < size); i--)
+    {
+        frame_name(pStack->pcs[i], i == 0, frame, sizeof(frame));
+        used += (size_t)snprintf(&pLine[used], size - used, ";%s", frame);
+    }
+}
+
+static int compare_lines(const void *pA, const void *pB)
+{
+    return strcmp(((const SamplerLine_t *)pA)->pLine, ((const SamplerLine_t *)pB)->pLine);
+}
+
+static int compare_counts(const void *pA, const void *pB)
+{
+    uint64_t a = ((const SamplerLine_t *)pA)->count;
+    uint64_t b = ((const SamplerLine_t *)pB)->count;
+
+    return (a < b) ? 1 : (a > b) ? -1 : 0;
+}
+
+/* Every ready stack folded, sorted and with equal lines merged; returns the number of lines, -1 on error */
+static int fold_all(SamplerLine_t **ppLines)
+{
+    SamplerLine_t *pLines = (SamplerLine_t *)calloc(CELLULAR_SAMPLER_MAX_STACKS, sizeof(SamplerLine_t));
+    char *pBuffer = (char *)malloc(MAX_LINE);
+    unsigned int i;
+    int count = 0, merged = 0;
+
+    if ((pLines == NULL) || (pBuffer == NULL))
+    {
+        free(pLines);
+        free(pBuffer);
+        return -1;
+    }
+    for (i = 0; i < CELLULAR_SAMPLER_MAX_STACKS; i++)
+    {
+        if (!__atomic_load_n(&gpStacks[i].ready, __ATOMIC_ACQUIRE))
+        {
+            continue;
+        }
+        fold_stack(&gpStacks[i], pBuffer, MAX_LINE);
+        pLines[count].pLine = strdup(pBuffer);
+        pLines[count].count = __atomic_load_n(&gpStacks[i].count, __ATOMIC_RELAXED);
+        if (pLines[count].pLine != NULL)
+        {
+            count++;
+        }
+    }
+    free(pBuffer);
+    qsort(pLines, (size_t)count, sizeof(SamplerLine_t), compare_lines);
+    for (i = 0; i < (unsigned int)count; i++)
+    {
+        if ((merged > 0) && (strcmp(pLines[merged - 1].pLine, pLines[i].pLine) == 0))
+        {
+            pLines[merged - 1].count += pLines[i].count;
+            free(pLines[i].pLine);
+            continue;
+        }
+        pLines[merged++] = pLines[i];
+    }
+    *ppLines = pLines;
+    return merged;
+}
+
+static void free_lines(SamplerLine_t *pLines, int count)
+{
+    int i;
+
+    for (i = 0; i < count; i++)
+    {
+        free(pLines[i].pLine);
+    }
+    free(pLines);
+}
+
+/* CPU samples per test, so the CPU time of a test is its samples over the rate */
+static void collect_metrics(FILE *pOut)
+{
+    const char *pTests[CELLULAR_TRACE_MAX_TESTS + 1];
+    uint64_t counts[CELLULAR_TRACE_MAX_TESTS + 1];
+    CellularSamplerStats_t stats;
+    unsigned int tests = 0, i, t;
+
+    if (gHz == 0)
+    {
+        return;
+    }
+    for (i = 0; i < CELLULAR_SAMPLER_MAX_STACKS; i++)
+    {
+        if (!__atomic_load_n(&gpStacks[i].ready, __ATOMIC_ACQUIRE))
+        {
+            continue;
+        }
+        for (t = 0; (t < tests) && (pTests[t] != gpStacks[i].pTest); t++)
+        {
+        }
+        if (t == tests)
+        {
+            if (tests == CELLULAR_TRACE_MAX_TESTS + 1)
+            {
+                continue;
+            }
+            pTests[tests] = gpStacks[i].pTest;
+            counts[tests++] = 0;
+        }
+        counts[t] += __atomic_load_n(&gpStacks[i].count, __ATOMIC_RELAXED);
+    }
+    cellular_metrics_family(pOut, "cellular_test_cpu_samples", CELLULAR_METRIC_COUNTER, "CPU profile samples taken during a test");
+    for (t = 0; t < tests; t++)
+    {
+        cellular_metrics_sample(pOut, "cellular_test_cpu_samples_total", (double)counts[t],
+                                "test", (pTests[t] != NULL) ? pTests[t] : "none", NULL);
+    }
+    cellular_sampler_get_stats(&stats);
+    cellular_metrics_family(pOut, "cellular_sampler_overhead_ratio", CELLULAR_METRIC_GAUGE,
+                            "Share of the sampled CPU time spent in the profiler");
+    cellular_metrics_sample(pOut, "cellular_sampler_overhead_ratio", stats.overhead, NULL);
+}
+
+static const CellularTraceProbe_t gProbe =
+{
+    NULL, NULL, probe_call_begin, probe_call_end
+};
+
+int cellular_sampler_start(unsigned int hz)
+{
+    struct sigaction action;
+    struct itimerval timer;
+    void *pcs[4];
+
+    if (gHz != 0)
+    {
+        gStarts++;
+        return RETURN_OK;
+    }
+    hz = (hz == 0) ? CELLULAR_SAMPLER_DEFAULT_HZ : (hz > 10000) ? 10000 : hz;
+    /* Kept after a reset: a signal raised before the timer was disarmed may still be handled */
+    if (gpStacks == NULL)
+    {
+        gpStacks = (SamplerStack_t *)calloc(CELLULAR_SAMPLER_MAX_STACKS, sizeof(SamplerStack_t));
+    }
+    if (gpStacks == NULL)
+    {
+        UT_LOG_ERROR("Sampler table allocation failed");
+        return RETURN_ERROR;
+    }
+    if (cellular_trace_add_probe(&gProbe) != RETURN_OK)
+    {
+        return RETURN_ERROR;
+    }
+    backtrace(pcs, 4);
+
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = on_sigprof;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    memset(&timer, 0, sizeof(timer));
+    timer.it_interval.tv_usec = 1000000 / hz;
+    timer.it_value = timer.it_interval;
+    if ((sigaction(SIGPROF, &action, NULL) != 0) || (setitimer(ITIMER_PROF, &timer, NULL) != 0))
+    {
+        UT_LOG_ERROR("Sampling timer setup failed: %s", strerror(errno));
+        cellular_trace_remove_probe(&gProbe);
+        return RETURN_ERROR;
+    }
+    gHz = hz;
+    gStarts = 1;
+    gStartCpuNs = cellular_bench_process_cpu_ns();
+    cellular_metrics_add_collector(collect_metrics);
+    return RETURN_OK;
+}
+
+void cellular_sampler_stop(void)
+{
+    struct itimerval timer;
+
+    if ((gStarts == 0) || (--gStarts > 0))
+    {
+        return;
+    }
+    memset(&timer, 0, sizeof(timer));
+    setitimer(ITIMER_PROF, &timer, NULL);
+}
+
+void cellular_sampler_reset(void)
+{
+    if ((gHz == 0) || (gStarts > 0))
+    {
+        return;
+    }
+    cellular_trace_remove_probe(&gProbe);
+    memset(gpStacks, 0, CELLULAR_SAMPLER_MAX_STACKS * sizeof(SamplerStack_t));
+    __atomic_store_n(&gSamples, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&gDropped, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&gStackCount, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&gHandlerNs, 0, __ATOMIC_RELAXED);
+    gHz = 0;
+}
+
+int cellular_sampler_get_stats(CellularSamplerStats_t *pStats)
+{
+    uint64_t cpuNs;
+
+    if (pStats == NULL)
+    {
+        return RETURN_ERROR;
+    }
+    pStats->samples = __atomic_load_n(&gSamples, __ATOMIC_RELAXED);
+    pStats->dropped = __atomic_load_n(&gDropped, __ATOMIC_RELAXED);
+    pStats->stacks = __atomic_load_n(&gStackCount, __ATOMIC_RELAXED);
+    pStats->handler_ns = __atomic_load_n(&gHandlerNs, __ATOMIC_RELAXED);
+    pStats->hz = gHz;
+    cpuNs = (gHz != 0) ? cellular_bench_process_cpu_ns() - gStartCpuNs : 0;
+    pStats->overhead = (cpuNs > 0) ? (double)pStats->handler_ns / (double)cpuNs : 0.0;
+    return RETURN_OK;
+}
+
+int cellular_sampler_write(const char *pPath)
+{
+    SamplerLine_t *pLines = NULL;
+    char tmpPath[256];
+    FILE *pFile;
+    int count, i, failed;
+
+    if ((gHz == 0) || (pPath == NULL))
+    {
+        return RETURN_ERROR;
+    }
+    count = fold_all(&pLines);
+    if (count < 0)
+    {
+        return RETURN_ERROR;
+    }
+    snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", pPath);
+    pFile = fopen(tmpPath, "w");
+    if (pFile == NULL)
+    {
+        UT_LOG_ERROR("Cannot write folded stacks to %s: %s", tmpPath, strerror(errno));
+        free_lines(pLines, count);
+        return RETURN_ERROR;
+    }
+    for (i = 0; i < count; i++)
+    {
+        fprintf(pFile, "%s %llu\n", pLines[i].pLine, (unsigned long long)pLines[i].count);
+    }
+    failed = (fclose(pFile) != 0) || (rename(tmpPath, pPath) != 0);
+    free_lines(pLines, count);
+    if (failed)
+    {
+        UT_LOG_ERROR("Cannot write folded stacks to %s", pPath);
+        unlink(tmpPath);
+        return RETURN_ERROR;
+    }
+    UT_LOG_INFO("Folded stacks written to %s", pPath);
+    return RETURN_OK;
+}
+
+void cellular_sampler_report(void)
+{
+    SamplerLine_t *pLeaves;
+    CellularSamplerStats_t stats;
+    char name[256];
+    unsigned int count = 0, i, l;
+    uint64_t total = 0;
+
+    if (gHz == 0)
+    {
+        return;
+    }
+    cellular_sampler_get_stats(&stats);
+    UT_LOG_INFO("Sampler: %llu samples at %u Hz, %llu stacks, %llu dropped, %.1f us per sample, overhead %.2f%%",
+                (unsigned long long)stats.samples, stats.hz, (unsigned long long)stats.stacks,
+                (unsigned long long)stats.dropped,
+                (stats.samples + stats.dropped > 0) ? (double)stats.handler_ns / 1000.0 / (double)(stats.samples + stats.dropped) : 0.0,
+                stats.overhead * 100.0);
+
+    /* Self samples per function: the interrupted frame of each stack */
+    pLeaves = (SamplerLine_t *)calloc(CELLULAR_SAMPLER_MAX_STACKS, sizeof(SamplerLine_t));
+    if (pLeaves == NULL)
+    {
+        return;
+    }
+    for (i = 0; i < CELLULAR_SAMPLER_MAX_STACKS; i++)
+    {
+        if (!__atomic_load_n(&gpStacks[i].ready, __ATOMIC_ACQUIRE) || (gpStacks[i].depth == 0))
+        {
+            continue;
+        }
+        frame_name(gpStacks[i].pcs[0], 1, name, sizeof(name));
+        for (l = 0; (l < count) && (strcmp(pLeaves[l].pLine, name) != 0); l++)
+        {
+        }
+        if (l == count)
+        {
+            pLeaves[l].pLine = strdup(name);
+            if (pLeaves[l].pLine == NULL)
+            {
+                continue;
+            }
+            pLeaves[l].count = 0;
+            count++;
+        }
+        pLeaves[l].count += gpStacks[i].count;
+        total += gpStacks[i].count;
+    }
+    qsort(pLeaves, count, sizeof(SamplerLine_t), compare_counts);
+    UT_LOG_INFO("| %-56s | %8s | %6s |", "Function", "Self", "%");
+    for (l = 0; l < count; l++)
+    {
+        if (l < TOP_FUNCTIONS)
+        {
+            UT_LOG_INFO("| %-56s | %8llu | %5.1f%% |", pLeaves[l].pLine, (unsigned long long)pLeaves[l].count,
+                        100.0 * (double)pLeaves[l].count / (double)total);
+        }
+        free(pLeaves[l].pLine);
+    }
+    free(pLeaves);
+    if (stats.overhead > CELLULAR_SAMPLER_OVERHEAD_LIMIT)
+    {
+        UT_LOG_WARNING("Sampler overhead %.1f%% exceeds %.0f%%, lower CELLULAR_SAMPLER", stats.overhead * 100.0,
+                       CELLULAR_SAMPLER_OVERHEAD_LIMIT * 100.0);
+    }
+    if (stats.dropped > 0)
+    {
+        UT_LOG_WARNING("Sampler table full: %llu samples dropped", (unsigned long long)stats.dropped);
+    }
+}
@@ -0,0 +1,333 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:*
+ * Copyright 2023 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file cellular_scan_index.c
+ * @brief Persistent index of network scan results keyed by (MCC, MNC, RAT)
+ *
+ * Linear probing over a power of two table with backward shift deletion, so there are
+ * no tombstones and probe sequences stay short however many scans are merged.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "cellular_scan_index.h"
+
+#define RAT_STRING_LENGTH 128
+
+typedef struct
+{
+    uint32_t key;
+    uint8_t used;
+    CellularScanIndexEntry_t entry;
+} ScanSlot_t;
+
+struct cellular_scan_index_s
+{
+    ScanSlot_t *pSlots;
+    uint32_t mask;
+    uint32_t max_entries;
+    uint32_t max_age_scans;
+    CellularScanIndexStats_t stats;
+};
+
+/* MCC and MNC are at most three digits (10 bits each), the RAT fits in 4 bits */
+static uint32_t make_key(unsigned int mcc, unsigned int mnc, CellularRat_t rat)
+{
+    return ((mcc & 0x3FFu) << 14) | ((mnc & 0x3FFu) << 4) | ((uint32_t)rat & 0xFu);
+}
+
+static uint32_t hash_key(uint32_t key)
+{
+    /* Fibonacci hashing; the table mask selects the low bits of the mixed value */
+    uint32_t h = key * 2654435761u;
+
+    return h ^ (h >> 16);
+}
+
+/* 'pProbes' counts the slots inspected, NULL when the caller is not a lookup */
+static ScanSlot_t *find_slot(cellular_scan_index_t *pIndex, uint32_t key, uint64_t *pProbes)
+{
+    uint32_t pos = hash_key(key) & pIndex->mask;
+
+    for (;;)
+    {
+        if (pProbes != NULL)
+        {
+            (*pProbes)++;
+        }
+        if (!pIndex->pSlots[pos].used)
+        {
+            return NULL;
+        }
+        if (pIndex->pSlots[pos].key == key)
+        {
+            return &pIndex->pSlots[pos];
+        }
+        pos = (pos + 1) & pIndex->mask;
+    }
+}
+
+/* Removes the slot at 'pos' and shifts the rest of its cluster back so lookups never see a gap */
+static void remove_slot(cellular_scan_index_t *pIndex, uint32_t pos)
+{
+    uint32_t next = pos;
+    uint32_t home;
+
+    for (;;)
+    {
+        next = (next + 1) & pIndex->mask;
+        if (!pIndex->pSlots[next].used)
+        {
+            break;
+        }
+        home = hash_key(pIndex->pSlots[next].key) & pIndex->mask;
+        /* Move 'next' into the hole unless its home lies cyclically within (pos, next] */
+        if (((next > pos) && ((home <= pos) || (home > next))) ||
+            ((next < pos) && ((home <= pos) && (home > next))))
+        {
+            pIndex->pSlots[pos] = pIndex->pSlots[next];
+            pos = next;
+        }
+    }
+    pIndex->pSlots[pos].used = 0;
+    pIndex->stats.entries--;
+}
+
+static void age_out(cellular_scan_index_t *pIndex)
+{
+    uint32_t pos = 0;
+    uint32_t visited = 0;    /* Slots checked since the last removal */
+
+    if (pIndex->max_age_scans == 0)
+    {
+        return;
+    }
+    /* The backward shift can wrap an entry from the end of the table to its start, so the scan goes round until a full lap removed nothing */
+    while (visited <= pIndex->mask)
+    {
+        if (pIndex->pSlots[pos].used &&
+            ((pIndex->stats.scans - pIndex->pSlots[pos].entry.last_seen_scan) >= pIndex->max_age_scans))
+        {
+            /* Re-examine 'pos': the backward shift may have moved another entry into it */
+            remove_slot(pIndex, pos);
+            pIndex->stats.aged_out++;
+            visited = 0;
+            continue;
+        }
+        pos = (pos + 1) & pIndex->mask;
+        visited++;
+    }
+}
+
+static void replace_oldest(cellular_scan_index_t *pIndex)
+{
+    uint32_t pos;
+    uint32_t oldest = 0;
+    uint32_t oldestScan = UINT32_MAX;
+
+    for (pos = 0; pos <= pIndex->mask; pos++)
+    {
+        if (pIndex->pSlots[pos].used && (pIndex->pSlots[pos].entry.last_seen_scan < oldestScan))
+        {
+            oldestScan = pIndex->pSlots[pos].entry.last_seen_scan;
+            oldest = pos;
+        }
+    }
+    if (oldestScan != UINT32_MAX)
+    {
+        remove_slot(pIndex, oldest);
+        pIndex->stats.replaced++;
+    }
+}
+
+cellular_scan_index_t *cellular_scan_index_create(unsigned int max_entries, unsigned int max_age_scans)
+{
+    cellular_scan_index_t *pIndex;
+    uint32_t size = 2;
+
+    if ((max_entries == 0) || (max_entries > (1u << 20)))
+    {
+        return NULL;
+    }
+    while (size < (2u * max_entries))
+    {
+        size <<= 1;
+    }
+    pIndex = (cellular_scan_index_t *)calloc(1, sizeof(cellular_scan_index_t));
+    if (pIndex == NULL)
+    {
+        return NULL;
+    }
+    pIndex->pSlots = (ScanSlot_t *)calloc(size, sizeof(ScanSlot_t));
+    if (pIndex->pSlots == NULL)
+    {
+        free(pIndex);
+        return NULL;
+    }
+    pIndex->mask = size - 1;
+    pIndex->max_entries = max_entries;
+    pIndex->max_age_scans = max_age_scans;
+    pIndex->stats.capacity = max_entries;
+    return pIndex;
+}
+
+void cellular_scan_index_destroy(cellular_scan_index_t *pIndex)
+{
+    if (pIndex != NULL)
+    {
+        free(pIndex->pSlots);
+        free(pIndex);
+    }
+}
+
+int cellular_scan_index_merge(cellular_scan_index_t *pIndex, const CellularNetworkScanResultInfoStruct *pResults, unsigned int count, CellularRat_t rat)
+{
+    const CellularNetworkScanResultInfoStruct *pResult;
+    CellularScanIndexEntry_t *pEntry;
+    ScanSlot_t *pSlot;
+    uint32_t key;
+    uint32_t pos;
+    unsigned int i;
+    int inserted = 0;
+
+    if ((pIndex == NULL) || ((pResults == NULL) && (count > 0)))
+    {
+        return -1;
+    }
+
+    pIndex->stats.scans++;
+    for (i = 0; i < count; i++)
+    {
+        pResult = &pResults[i];
+        key = make_key(pResult->MCC, pResult->MNC, rat);
+        pSlot = find_slot(pIndex, key, NULL);
+        if (pSlot == NULL)
+        {
+            if (pIndex->stats.entries >= pIndex->max_entries)
+            {
+                replace_oldest(pIndex);
+            }
+            pos = hash_key(key) & pIndex->mask;
+            while (pIndex->pSlots[pos].used)
+            {
+                pos = (pos + 1) & pIndex->mask;
+            }
+            pSlot = &pIndex->pSlots[pos];
+            memset(pSlot, 0, sizeof(*pSlot));
+            pSlot->used = 1;
+            pSlot->key = key;
+            pSlot->entry.MCC = pResult->MCC;
+            pSlot->entry.MNC = pResult->MNC;
+            pSlot->entry.rat = rat;
+            pSlot->entry.first_seen_scan = pIndex->stats.scans;
+            pIndex->stats.entries++;
+            pIndex->stats.inserts++;
+            inserted++;
+        }
+        else
+        {
+            pIndex->stats.updates++;
+        }
+        pEntry = &pSlot->entry;
+        memcpy(pEntry->network_name, pResult->network_name, sizeof(pEntry->network_name));
+        pEntry->network_name[sizeof(pEntry->network_name) - 1] = '\0';
+        pEntry->network_allowed_flag = pResult->network_allowed_flag;
+        if (pEntry->last_seen_scan != pIndex->stats.scans)
+        {
+            pEntry->seen_count++;
+        }
+        pEntry->last_seen_scan = pIndex->stats.scans;
+    }
+    age_out(pIndex);
+    return inserted;
+}
+
+int cellular_scan_index_scan(cellular_scan_index_t *pIndex)
+{
+    CellularNetworkScanResultInfoStruct *pResults = NULL;
+    unsigned int count = 0;
+    char currentRat[RAT_STRING_LENGTH] = {"\0"};
+    int inserted;
+
+    if (pIndex == NULL)
+    {
+        return -1;
+    }
+    if (cellular_hal_get_available_networks_information(&pResults, &count) != RETURN_OK)
+    {
+        free(pResults);
+        return -1;
+    }
+    if (cellular_hal_get_modem_current_radio_technology(currentRat) != RETURN_OK)
+    {
+        currentRat[0] = '\0';
+    }
+    inserted = cellular_scan_index_merge(pIndex, pResults, (pResults != NULL) ? count : 0, cellular_rat_from_string(currentRat));
+    free(pResults);
+    return inserted;
+}
+
+const CellularScanIndexEntry_t *cellular_scan_index_lookup(cellular_scan_index_t *pIndex, unsigned int mcc, unsigned int mnc, CellularRat_t rat)
+{
+    const CellularScanIndexEntry_t *pBest = NULL;
+    ScanSlot_t *pSlot;
+    int r;
+
+    if (pIndex == NULL)
+    {
+        return NULL;
+    }
+    pIndex->stats.lookups++;
+    if (rat != CELLULAR_RAT_UNKNOWN)
+    {
+        pSlot = find_slot(pIndex, make_key(mcc, mnc, rat), &pIndex->stats.probes);
+        return (pSlot != NULL) ? &pSlot->entry : NULL;
+    }
+
+    /* Any RAT: a fixed number of probes, one per RAT */
+    for (r = CELLULAR_RAT_UNKNOWN; r < CELLULAR_RAT_MAX; r++)
+    {
+        pSlot = find_slot(pIndex, make_key(mcc, mnc, (CellularRat_t)r), &pIndex->stats.probes);
+        if ((pSlot != NULL) && ((pBest == NULL) || (pSlot->entry.last_seen_scan > pBest->last_seen_scan)))
+        {
+            pBest = &pSlot->entry;
+        }
+    }
+    return pBest;
+}
+
+int cellular_scan_index_is_visible(cellular_scan_index_t *pIndex, unsigned int mcc, unsigned int mnc, CellularRat_t rat)
+{
+    return (cellular_scan_index_lookup(pIndex, mcc, mnc, rat) != NULL) ? 1 : 0;
+}
+
+int cellular_scan_index_is_allowed(cellular_scan_index_t *pIndex, unsigned int mcc, unsigned int mnc, CellularRat_t rat)
+{
+    const CellularScanIndexEntry_t *pEntry = cellular_scan_index_lookup(pIndex, mcc, mnc, rat);
+
+    return ((pEntry != NULL) && (pEntry->network_allowed_flag == TRUE)) ? 1 : 0;
+}
+
+void cellular_scan_index_get_stats(const cellular_scan_index_t *pIndex, CellularScanIndexStats_t *pStats)
+{
+    if ((pIndex != NULL) && (pStats != NULL))
+    {
+        *pStats = pIndex->stats;
+    }
+}
@@ -0,0 +1,750 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:*
+ * Copyright 2023 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file cellular_syscall.c
+ * @brief Counts and times the system calls made inside each HAL call
+ *
+ * The wrappers below replace the C library entry points for the whole process. Outside
+ * of a HAL call they cost a thread local check; inside one, the call is timed and added
+ * to a per thread buffer which is merged into the totals when the HAL call returns.
+ */
+
+/* The wrappers must define the plain symbols, not the fortified or 64 bit redirections */
+#undef _FORTIFY_SOURCE
+#undef _FILE_OFFSET_BITS
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <ut_log.h>
+#include "cellular_syscall.h"
+#include "cellular_bench.h"
+#include "cellular_metrics.h"
+
+#define MAX_TARGETS      64
+#define TARGET_LENGTH    48
+#define FD_CACHE         1024
+#define CALL_TARGETS     16
+
+typedef struct
+{
+    int target;
+    uint32_t opens;
+    uint32_t count[CELLULAR_SYSCALL_COUNT];
+    uint64_t ns[CELLULAR_SYSCALL_COUNT];
+} CallTarget_t;
+
+static pthread_mutex_t gLock = PTHREAD_MUTEX_INITIALIZER;
+static int gStarted = 0;    /* Starts not yet stopped */
+static char gTargets[MAX_TARGETS][TARGET_LENGTH];
+static int gTargetCount = 0;
+static int gFdTargets[FD_CACHE];    /* Target index + 1, 0 when not resolved */
+static CellularSyscallStats_t gStats[CELLULAR_HAL_API_COUNT][MAX_TARGETS];
+static uint64_t gApiCalls[CELLULAR_HAL_API_COUNT];
+static uint64_t gApiMax[CELLULAR_HAL_API_COUNT];
+
+static __thread int tApi = -1;
+static __thread CallTarget_t tCall[CALL_TARGETS];
+static __thread unsigned int tCallTargets = 0;
+static __thread struct { int fd; int target; } tResolved[CALL_TARGETS];
+static __thread unsigned int tResolvedCount = 0;
+
+static int (*gRealOpen)(const char *, int, ...);
+static int (*gRealOpen64)(const char *, int, ...);
+static int (*gRealOpenat)(int, const char *, int, ...);
+static int (*gRealClose)(int);
+static ssize_t (*gRealRead)(int, void *, size_t);
+static ssize_t (*gRealWrite)(int, const void *, size_t);
+static int (*gRealIoctl)(int, unsigned long, ...);
+static int (*gRealPoll)(struct pollfd *, nfds_t, int);
+static ssize_t (*gRealSendmsg)(int, const struct msghdr *, int);
+static ssize_t (*gRealRecvmsg)(int, struct msghdr *, int);
+
+#define REAL(pointer, name) \
+    ((pointer != NULL) ? pointer : (pointer = (__typeof__(pointer))dlsym(RTLD_NEXT, name)))
+
+static const char *gSyscallNames[CELLULAR_SYSCALL_COUNT] =
+{
+    "open", "close", "read", "write", "ioctl", "poll", "sendmsg", "recvmsg"
+};
+
+/* Returns the index of a target name, adding it when new; "other" once the table is full */
+static int intern_target(const char *pName)
+{
+    int i;
+
+    pthread_mutex_lock(&gLock);
+    for (i = 0; i < gTargetCount; i++)
+    {
+        if (strncmp(gTargets[i], pName, TARGET_LENGTH - 1) == 0)
+        {
+            break;
+        }
+    }
+    if ((i == gTargetCount) && (gTargetCount < MAX_TARGETS - 1))
+    {
+        snprintf(gTargets[gTargetCount++], TARGET_LENGTH, "%s", pName);
+    }
+    else if (i == gTargetCount)
+    {
+        snprintf(gTargets[MAX_TARGETS - 1], TARGET_LENGTH, "other");
+        gTargetCount = MAX_TARGETS;
+        i = MAX_TARGETS - 1;
+    }
+    pthread_mutex_unlock(&gLock);
+    return i;
+}
+
+/* Names the target of a descriptor opened outside the current HAL call */
+static int resolve_target(int fd)
+{
+    char link[32];
+    char name[TARGET_LENGTH];
+    char *pInode;
+    ssize_t length;
+    int domain = 0, protocol = 0;
+    socklen_t size = sizeof(domain);
+
+    snprintf(link, sizeof(link), "/proc/self/fd/%d", fd);
+    length = readlink(link, name, sizeof(name) - 1);
+    if (length <= 0)
+    {
+        return intern_target("unknown");
+    }
+    name[length] = '\0';
+    if (strncmp(name, "socket:", 7) == 0)
+    {
+        getsockopt(fd, SOL_SOCKET, SO_DOMAIN, &domain, &size);
+        size = sizeof(protocol);
+        getsockopt(fd, SOL_SOCKET, SO_PROTOCOL, &protocol, &size);
+        switch (domain)
+        {
+            case AF_NETLINK:
+                snprintf(name, sizeof(name), "netlink:%d", protocol);
+                break;
+            case AF_UNIX:
+                snprintf(name, sizeof(name), "unix");
+                break;
+            case AF_INET:
+            case AF_INET6:
+                snprintf(name, sizeof(name), "%s:%s", (domain == AF_INET) ? "inet" : "inet6",
+                         (protocol == IPPROTO_UDP) ? "udp" : (protocol == IPPROTO_TCP) ? "tcp" : "raw");
+                break;
+            default:
+                snprintf(name, sizeof(name), "socket:%d", domain);
+                break;
+        }
+    }
+    else if ((pInode = strstr(name, ":[")) != NULL)
+    {
+        /* pipe:[1234] and anon_inode:[eventfd] group by kind */
+        if (pInode[2] >= '0' && pInode[2] <= '9')
+        {
+            *pInode = '\0';
+        }
+    }
+    return intern_target(name);
+}
+
+/*
+ * Descriptors opened inside a HAL call are cached until closed. Others are resolved once
+ * per HAL call only, as the C library may reuse their number without passing through here.
+ */
+static int fd_target(int fd)
+{
+    unsigned int i;
+    int target;
+
+    if (fd < 0)
+    {
+        return intern_target("invalid");
+    }
+    if (fd < FD_CACHE)
+    {
+        target = __atomic_load_n(&gFdTargets[fd], __ATOMIC_RELAXED);
+        if (target > 0)
+        {
+            return target - 1;
+        }
+    }
+    for (i = 0; i < tResolvedCount; i++)
+    {
+        if (tResolved[i].fd == fd)
+        {
+            return tResolved[i].target;
+        }
+    }
+    target = resolve_target(fd);
+    if (tResolvedCount < CALL_TARGETS)
+    {
+        tResolved[tResolvedCount].fd = fd;
+        tResolved[tResolvedCount++].target = target;
+    }
+    return target;
+}
+
+static int forget_fd(int fd)
+{
+    if ((fd >= 0) && (fd < FD_CACHE))
+    {
+        __atomic_store_n(&gFdTargets[fd], 0, __ATOMIC_RELAXED);
+    }
+    return fd;
+}
+
+static CallTarget_t *call_target(int target)
+{
+    unsigned int i;
+
+    for (i = 0; i < tCallTargets; i++)
+    {
+        if (tCall[i].target == target)
+        {
+            return &tCall[i];
+        }
+    }
+    if (tCallTargets == CALL_TARGETS)
+    {
+        /* The last slot absorbs everything once the call touched too many targets */
+        return &tCall[CALL_TARGETS - 1];
+    }
+    memset(&tCall[tCallTargets], 0, sizeof(tCall[0]));
+    tCall[tCallTargets].target = target;
+    return &tCall[tCallTargets++];
+}
+
+static void record(int target, CellularSyscall_t syscall, uint64_t elapsed)
+{
+    CallTarget_t *pTarget = call_target(target);
+
+    pTarget->count[syscall]++;
+    pTarget->ns[syscall] += elapsed;
+}
+
+static int record_open(const char *pPath, int fd, uint64_t start)
+{
+    uint64_t elapsed = cellular_bench_now_ns() - start;
+    int target = intern_target((pPath != NULL) ? pPath : "invalid");
+
+    if ((fd >= 0) && (fd < FD_CACHE))
+    {
+        __atomic_store_n(&gFdTargets[fd], target + 1, __ATOMIC_RELAXED);
+    }
+    record(target, CELLULAR_SYSCALL_OPEN, elapsed);
+    call_target(target)->opens++;
+    return fd;
+}
+
+static int open_mode(int flags, va_list args)
+{
+    return ((flags & O_CREAT) || ((flags & O_TMPFILE) == O_TMPFILE)) ? va_arg(args, int) : 0;
+}
+
+int open(const char *pPath, int flags, ...)
+{
+    va_list args;
+    uint64_t start = cellular_bench_now_ns();
+    int mode;
+
+    va_start(args, flags);
+    mode = open_mode(flags, args);
+    va_end(args);
+    if (REAL(gRealOpen, "open") == NULL)
+    {
+        return -1;
+    }
+    if (tApi < 0)
+    {
+        return forget_fd(gRealOpen(pPath, flags, mode));
+    }
+    return record_open(pPath, gRealOpen(pPath, flags, mode), start);
+}
+
+int open64(const char *pPath, int flags, ...)
+{
+    va_list args;
+    uint64_t start = cellular_bench_now_ns();
+    int mode;
+
+    va_start(args, flags);
+    mode = open_mode(flags, args);
+    va_end(args);
+    if (REAL(gRealOpen64, "open64") == NULL)
+    {
+        return -1;
+    }
+    if (tApi < 0)
+    {
+        return forget_fd(gRealOpen64(pPath, flags, mode));
+    }
+    return record_open(pPath, gRealOpen64(pPath, flags, mode), start);
+}
+
+int openat(int dirFd, const char *pPath, int flags, ...)
+{
+    va_list args;
+    uint64_t start = cellular_bench_now_ns();
+    int mode;
+
+    va_start(args, flags);
+    mode = open_mode(flags, args);
+    va_end(args);
+    if (REAL(gRealOpenat, "openat") == NULL)
+    {
+        return -1;
+    }
+    if (tApi < 0)
+    {
+        return forget_fd(gRealOpenat(dirFd, pPath, flags, mode));
+    }
+    return record_open(pPath, gRealOpenat(dirFd, pPath, flags, mode), start);
+}
+
+/* Entry points of code built with _FORTIFY_SOURCE */
+int __open_2(const char *pPath, int flags)
+{
+    return open(pPath, flags);
+}
+
+int __open64_2(const char *pPath, int flags)
+{
+    return open64(pPath, flags);
+}
+
+int __openat_2(int dirFd, const char *pPath, int flags)
+{
+    return openat(dirFd, pPath, flags);
+}
+
+int close(int fd)
+{
+    uint64_t start;
+    int target;
+    int result;
+
+    if (REAL(gRealClose, "close") == NULL)
+    {
+        return -1;
+    }
+    if (tApi < 0)
+    {
+        return gRealClose(forget_fd(fd));
+    }
+    /* The target has to be known before the descriptor goes away */
+    target = fd_target(fd);
+    forget_fd(fd);
+    start = cellular_bench_now_ns();
+    result = gRealClose(fd);
+    record(target, CELLULAR_SYSCALL_CLOSE, cellular_bench_now_ns() - start);
+    return result;
+}
+
+ssize_t read(int fd, void *pBuffer, size_t count)
+{
+    uint64_t start;
+    ssize_t result;
+
+    if (REAL(gRealRead, "read") == NULL)
+    {
+        return -1;
+    }
+    if (tApi < 0)
+    {
+        return gRealRead(fd, pBuffer, count);
+    }
+    start = cellular_bench_now_ns();
+    result = gRealRead(fd, pBuffer, count);
+    /* Elapsed time is taken before the target lookup, which may readlink() */
+    start = cellular_bench_now_ns() - start;
+    record(fd_target(fd), CELLULAR_SYSCALL_READ, start);
+    return result;
+}
+
+ssize_t __read_chk(int fd, void *pBuffer, size_t count, size_t bufferLength)
+{
+    (void)bufferLength;
+    return read(fd, pBuffer, count);
+}
+
+ssize_t write(int fd, const void *pBuffer, size_t count)
+{
+    uint64_t start;
+    ssize_t result;
+
+    if (REAL(gRealWrite, "write") == NULL)
+    {
+        return -1;
+    }
+    if (tApi < 0)
+    {
+        return gRealWrite(fd, pBuffer, count);
+    }
+    start = cellular_bench_now_ns();
+    result = gRealWrite(fd, pBuffer, count);
+    start = cellular_bench_now_ns() - start;
+    record(fd_target(fd), CELLULAR_SYSCALL_WRITE, start);
+    return result;
+}
+
+int ioctl(int fd, unsigned long request, ...)
+{
+    va_list args;
+    void *pArg;
+    uint64_t start;
+    int result;
+
+    /* Every ioctl takes at most one argument, an integer or a pointer */
+    va_start(args, request);
+    pArg = va_arg(args, void *);
+    va_end(args);
+    if (REAL(gRealIoctl, "ioctl") == NULL)
+    {
+        return -1;
+    }
+    if (tApi < 0)
+    {
+        return gRealIoctl(fd, request, pArg);
+    }
+    start = cellular_bench_now_ns();
+    result = gRealIoctl(fd, request, pArg);
+    start = cellular_bench_now_ns() - start;
+    record(fd_target(fd), CELLULAR_SYSCALL_IOCTL, start);
+    return result;
+}
+
+int poll(struct pollfd *pFds, nfds_t count, int timeout)
+{
+    uint64_t start;
+    int result;
+
+    if (REAL(gRealPoll, "poll") == NULL)
+    {
+        return -1;
+    }
+    if (tApi < 0)
+    {
+        return gRealPoll(pFds, count, timeout);
+    }
+    start = cellular_bench_now_ns();
+    result = gRealPoll(pFds, count, timeout);
+    /* Attributed to the first descriptor polled */
+    start = cellular_bench_now_ns() - start;
+    record((count > 0) ? fd_target(pFds[0].fd) : intern_target("none"), CELLULAR_SYSCALL_POLL, start);
+    return result;
+}
+
+int __poll_chk(struct pollfd *pFds, nfds_t count, int timeout, size_t fdsLength)
+{
+    (void)fdsLength;
+    return poll(pFds, count, timeout);
+}
+
+ssize_t sendmsg(int fd, const struct msghdr *pMessage, int flags)
+{
+    uint64_t start;
+    ssize_t result;
+
+    if (REAL(gRealSendmsg, "sendmsg") == NULL)
+    {
+        return -1;
+    }
+    if (tApi < 0)
+    {
+        return gRealSendmsg(fd, pMessage, flags);
+    }
+    start = cellular_bench_now_ns();
+    result = gRealSendmsg(fd, pMessage, flags);
+    start = cellular_bench_now_ns() - start;
+    record(fd_target(fd), CELLULAR_SYSCALL_SENDMSG, start);
+    return result;
+}
+
+ssize_t recvmsg(int fd, struct msghdr *pMessage, int flags)
+{
+    uint64_t start;
+    ssize_t result;
+
+    if (REAL(gRealRecvmsg, "recvmsg") == NULL)
+    {
+        return -1;
+    }
+    if (tApi < 0)
+    {
+        return gRealRecvmsg(fd, pMessage, flags);
+    }
+    start = cellular_bench_now_ns();
+    result = gRealRecvmsg(fd, pMessage, flags);
+    start = cellular_bench_now_ns() - start;
+    record(fd_target(fd), CELLULAR_SYSCALL_RECVMSG, start);
+    return result;
+}
+
+static void probe_call_begin(CellularHalApi_t api)
+{
+    tCallTargets = 0;
+    tResolvedCount = 0;
+    tApi = (int)api;
+}
+
+static void probe_call_end(CellularHalApi_t api)
+{
+    CellularSyscallStats_t *pStats;
+    CallTarget_t *pCall;
+    uint64_t callTotal = 0, targetTotal = 0;
+    unsigned int i, s;
+
+    tApi = -1;
+    pthread_mutex_lock(&gLock);
+    gApiCalls[api]++;
+    for (i = 0; i < tCallTargets; i++)
+    {
+        pCall = &tCall[i];
+        pStats = &gStats[api][pCall->target];
+        targetTotal = 0;
+        for (s = 0; s < CELLULAR_SYSCALL_COUNT; s++)
+        {
+            pStats->count[s] += pCall->count[s];
+            pStats->ns[s] += pCall->ns[s];
+            targetTotal += pCall->count[s];
+        }
+        pStats->calls++;
+        pStats->redundant_opens += (pCall->opens > 1) ? pCall->opens - 1 : 0;
+        pStats->max_per_call = (targetTotal > pStats->max_per_call) ? targetTotal : pStats->max_per_call;
+        callTotal += targetTotal;
+    }
+    gApiMax[api] = (callTotal > gApiMax[api]) ? callTotal : gApiMax[api];
+    pthread_mutex_unlock(&gLock);
+}
+
+/* Counter families by api, target and system call */
+static void collect_metrics(FILE *pOut)
+{
+    const CellularSyscallStats_t *pStats;
+    unsigned int a, family;
+    int t, s;
+
+    if (gStarted == 0)
+    {
+        return;
+    }
+    pthread_mutex_lock(&gLock);
+    for (family = 0; family < 2; family++)
+    {
+        cellular_metrics_family(pOut, (family == 0) ? "cellular_hal_syscalls" : "cellular_hal_syscall_seconds", CELLULAR_METRIC_COUNTER,
+                                (family == 0) ? "System calls made inside cellular_hal calls" : "Time spent in system calls inside cellular_hal calls");
+        for (a = 0; a < CELLULAR_HAL_API_COUNT; a++)
+        {
+            for (t = 0; t < gTargetCount; t++)
+            {
+                pStats = &gStats[a][t];
+                for (s = 0; (pStats->calls > 0) && (s < CELLULAR_SYSCALL_COUNT); s++)
+                {
+                    if (pStats->count[s] == 0)
+                    {
+                        continue;
+                    }
+                    cellular_metrics_sample(pOut, (family == 0) ? "cellular_hal_syscalls_total" : "cellular_hal_syscall_seconds_total",
+                                            (family == 0) ? (double)pStats->count[s] : (double)pStats->ns[s] / 1e9,
+                                            "api", cellular_trace_api_name((CellularHalApi_t)a), "fd", gTargets[t],
+                                            "syscall", gSyscallNames[s], NULL);
+                }
+            }
+        }
+    }
+    cellular_metrics_family(pOut, "cellular_hal_redundant_opens", CELLULAR_METRIC_COUNTER,
+                            "Opens of a target already open in the same cellular_hal call");
+    for (a = 0; a < CELLULAR_HAL_API_COUNT; a++)
+    {
+        for (t = 0; t < gTargetCount; t++)
+        {
+            if (gStats[a][t].redundant_opens > 0)
+            {
+                cellular_metrics_sample(pOut, "cellular_hal_redundant_opens_total", (double)gStats[a][t].redundant_opens,
+                                        "api", cellular_trace_api_name((CellularHalApi_t)a), "fd", gTargets[t], NULL);
+            }
+        }
+    }
+    pthread_mutex_unlock(&gLock);
+}
+
+static const CellularTraceProbe_t gProbe =
+{
+    NULL, NULL, probe_call_begin, probe_call_end
+};
+
+int cellular_syscall_start(void)
+{
+    if (gStarted > 0)
+    {
+        gStarted++;
+        return RETURN_OK;
+    }
+    if (cellular_trace_add_probe(&gProbe) != RETURN_OK)
+    {
+        return RETURN_ERROR;
+    }
+    gStarted = 1;
+    cellular_metrics_add_collector(collect_metrics);
+    return RETURN_OK;
+}
+
+void cellular_syscall_stop(void)
+{
+    if ((gStarted == 0) || (--gStarted > 0))
+    {
+        return;
+    }
+    cellular_trace_remove_probe(&gProbe);
+    pthread_mutex_lock(&gLock);
+    memset(gFdTargets, 0, sizeof(gFdTargets));
+    memset(gStats, 0, sizeof(gStats));
+    memset(gApiCalls, 0, sizeof(gApiCalls));
+    memset(gApiMax, 0, sizeof(gApiMax));
+    gTargetCount = 0;
+    pthread_mutex_unlock(&gLock);
+}
+
+int cellular_syscall_get(CellularHalApi_t api, const char *pTarget, CellularSyscallStats_t *pStats)
+{
+    int t, s;
+
+    if (((unsigned int)api >= CELLULAR_HAL_API_COUNT) || (pStats == NULL))
+    {
+        return RETURN_ERROR;
+    }
+    memset(pStats, 0, sizeof(*pStats));
+    pthread_mutex_lock(&gLock);
+    for (t = 0; t < gTargetCount; t++)
+    {
+        if ((pTarget != NULL) && (strncmp(gTargets[t], pTarget, TARGET_LENGTH - 1) != 0))
+        {
+            continue;
+        }
+        for (s = 0; s < CELLULAR_SYSCALL_COUNT; s++)
+        {
+            pStats->count[s] += gStats[api][t].count[s];
+            pStats->ns[s] += gStats[api][t].ns[s];
+        }
+        pStats->redundant_opens += gStats[api][t].redundant_opens;
+        if (pTarget != NULL)
+        {
+            pStats->calls = gStats[api][t].calls;
+            pStats->max_per_call = gStats[api][t].max_per_call;
+        }
+    }
+    if (pTarget == NULL)
+    {
+        pStats->calls = gApiCalls[api];
+        pStats->max_per_call = gApiMax[api];
+    }
+    pthread_mutex_unlock(&gLock);
+    return RETURN_OK;
+}
+
+void cellular_syscall_report(void)
+{
+    const CellularSyscallStats_t *pStats;
+    uint64_t total, ns;
+    unsigned int a;
+    int t, s;
+
+    if (!gStarted)
+    {
+        return;
+    }
+    pthread_mutex_lock(&gLock);
+    UT_LOG_INFO("| %-44s | %-20s | %5s | %5s | %5s | %5s | %5s | %5s | %5s | %5s | %5s | %9s | %7s | %4s |",
+                "HAL API", "Target", "calls", "open", "close", "read", "write", "ioctl", "poll", "smsg", "rmsg",
+                "total us", "avg/call", "max");
+    for (a = 0; a < CELLULAR_HAL_API_COUNT; a++)
+    {
+        for (t = 0; t < gTargetCount; t++)
+        {
+            pStats = &gStats[a][t];
+            if (pStats->calls == 0)
+            {
+                continue;
+            }
+            total = 0;
+            ns = 0;
+            for (s = 0; s < CELLULAR_SYSCALL_COUNT; s++)
+            {
+                total += pStats->count[s];
+                ns += pStats->ns[s];
+            }
+            UT_LOG_INFO("| %-44s | %-20.20s | %5llu | %5llu | %5llu | %5llu | %5llu | %5llu | %5llu | %5llu | %5llu | %9llu | %7.1f | %4llu |",
+                        cellular_trace_api_name((CellularHalApi_t)a), gTargets[t], (unsigned long long)pStats->calls,
+                        (unsigned long long)pStats->count[CELLULAR_SYSCALL_OPEN], (unsigned long long)pStats->count[CELLULAR_SYSCALL_CLOSE],
+                        (unsigned long long)pStats->count[CELLULAR_SYSCALL_READ], (unsigned long long)pStats->count[CELLULAR_SYSCALL_WRITE],
+                        (unsigned long long)pStats->count[CELLULAR_SYSCALL_IOCTL], (unsigned long long)pStats->count[CELLULAR_SYSCALL_POLL],
+                        (unsigned long long)pStats->count[CELLULAR_SYSCALL_SENDMSG], (unsigned long long)pStats->count[CELLULAR_SYSCALL_RECVMSG],
+                        (unsigned long long)(ns / 1000), (double)total / (double)pStats->calls,
+                        (unsigned long long)pStats->max_per_call);
+        }
+    }
+
+    /* Patterns worth a look in the vendor code */
+    for (a = 0; a < CELLULAR_HAL_API_COUNT; a++)
+    {
+        for (t = 0; t < gTargetCount; t++)
+        {
+            pStats = &gStats[a][t];
+            if (pStats->calls == 0)
+            {
+                continue;
+            }
+            total = 0;
+            for (s = 0; s < CELLULAR_SYSCALL_COUNT; s++)
+            {
+                total += pStats->count[s];
+            }
+            if (pStats->redundant_opens > 0)
+            {
+                UT_LOG_WARNING("%s opens %s again while it is open: %llu redundant opens in %llu calls",
+                               cellular_trace_api_name((CellularHalApi_t)a), gTargets[t],
+                               (unsigned long long)pStats->redundant_opens, (unsigned long long)pStats->calls);
+            }
+            else if ((gApiCalls[a] > 1) && (pStats->count[CELLULAR_SYSCALL_OPEN] >= gApiCalls[a]))
+            {
+                UT_LOG_WARNING("%s opens %s on every call (%llu opens in %llu calls)",
+                               cellular_trace_api_name((CellularHalApi_t)a), gTargets[t],
+                               (unsigned long long)pStats->count[CELLULAR_SYSCALL_OPEN], (unsigned long long)gApiCalls[a]);
+            }
+            if (total > CELLULAR_SYSCALL_CHATTY * pStats->calls)
+            {
+                UT_LOG_WARNING("%s is chatty on %s: %.1f system calls per call",
+                               cellular_trace_api_name((CellularHalApi_t)a), gTargets[t], (double)total / (double)pStats->calls);
+            }
+        }
+    }
+    pthread_mutex_unlock(&gLock);
+}
+
+const char *cellular_syscall_to_string(CellularSyscall_t syscall)
+{
+    return ((unsigned int)syscall < CELLULAR_SYSCALL_COUNT) ? gSyscallNames[syscall] : "unknown";
+}
@@ -0,0 +1,285 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:*
+ * Copyright 2023 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file cellular_trace.c
+ * @brief Test and HAL call scopes for instrumentation probes
+ *
+ * ut-core calls a test as a plain function without context, so each wrapped test gets
+ * one of a fixed set of trampolines which knows its slot. The trampoline also keeps a
+ * jump point so a test blocked for good can be abandoned from a signal handler.
+ */
+
+#include <pthread.h>
+#include <setjmp.h>
+#include <stddef.h>
+#include "cellular_trace.h"
+
+typedef struct
+{
+    const char *pTitle;
+    UT_TestFunction_t pFunction;
+    const int *pGroup;
+    const int *pId;
+} TraceTest_t;
+
+int gCellularTraceProbeCount = 0;
+static CellularTraceProbe_t gProbes[CELLULAR_TRACE_MAX_PROBES];
+static TraceTest_t gTests[CELLULAR_TRACE_MAX_TESTS];
+static unsigned int gTestCount = 0;
+static CellularTraceRunner_t gRunner = NULL;
+static CellularTraceAbandon_t gAbandon = NULL;
+static const int *gpGroup = NULL;
+static const int *gpId = NULL;
+/* Slot of the running test, -1 between tests; read from signal handlers */
+static volatile int gCurrentTest = -1;
+static sigjmp_buf gTestJump;
+static volatile int gJumpArmed = 0;
+static pthread_t gTestThread;
+/* API the thread is inside of, closed for it when its test is abandoned */
+static __thread int tOpenApi = -1;
+/* Sections the thread is in which it must not be jumped out of, and an abandon waiting for them */
+static __thread volatile int tHold = 0;
+static __thread volatile int tPending = 0;
+
+#define CELLULAR_TRACE_API_NAME(name) "cellular_hal_" #name,
+static const char *gApiNames[CELLULAR_HAL_API_COUNT] = { CELLULAR_TRACE_API_LIST(CELLULAR_TRACE_API_NAME) };
+
+static void run_test(unsigned int slot)
+{
+    const TraceTest_t *pTest = &gTests[slot];
+    int i;
+
+    for (i = 0; i < gCellularTraceProbeCount; i++)
+    {
+        if (gProbes[i].test_begin != NULL)
+        {
+            gProbes[i].test_begin(pTest->pTitle);
+        }
+    }
+    gCurrentTest = (int)slot;
+    gTestThread = pthread_self();
+    if (sigsetjmp(gTestJump, 1) == 0)
+    {
+        gJumpArmed = 1;
+        if (gRunner != NULL)
+        {
+            gRunner(pTest->pTitle, pTest->pFunction);
+        }
+        else
+        {
+            pTest->pFunction();
+        }
+    }
+    else
+    {
+        if (tOpenApi >= 0)
+        {
+            cellular_trace_call_end((CellularHalApi_t)tOpenApi);
+        }
+        UT_FAIL("Test abandoned");
+    }
+    gJumpArmed = 0;
+    tPending = 0;
+    gCurrentTest = -1;
+    for (i = gCellularTraceProbeCount - 1; i >= 0; i--)
+    {
+        if (gProbes[i].test_end != NULL)
+        {
+            gProbes[i].test_end(pTest->pTitle);
+        }
+    }
+}
+
+#define TRAMPOLINE(tens, units) static void trampoline_##tens##units(void) { run_test((tens) * 10 + (units)); }
+#define TRAMPOLINE_10(tens) TRAMPOLINE(tens, 0) TRAMPOLINE(tens, 1) TRAMPOLINE(tens, 2) TRAMPOLINE(tens, 3) TRAMPOLINE(tens, 4) \
+                            TRAMPOLINE(tens, 5) TRAMPOLINE(tens, 6) TRAMPOLINE(tens, 7) TRAMPOLINE(tens, 8) TRAMPOLINE(tens, 9)
+#define TRAMPOLINE_REF_10(tens) trampoline_##tens##0, trampoline_##tens##1, trampoline_##tens##2, trampoline_##tens##3, \
+                                trampoline_##tens##4, trampoline_##tens##5, trampoline_##tens##6, trampoline_##tens##7, \
+                                trampoline_##tens##8, trampoline_##tens##9
+
+TRAMPOLINE_10(0) TRAMPOLINE_10(1) TRAMPOLINE_10(2) TRAMPOLINE_10(3) TRAMPOLINE_10(4) TRAMPOLINE_10(5)
+TRAMPOLINE_10(6) TRAMPOLINE_10(7) TRAMPOLINE_10(8) TRAMPOLINE_10(9) TRAMPOLINE_10(10) TRAMPOLINE_10(11)
+
+static const UT_TestFunction_t gTrampolines[CELLULAR_TRACE_MAX_TESTS] =
+{
+    TRAMPOLINE_REF_10(0), TRAMPOLINE_REF_10(1), TRAMPOLINE_REF_10(2), TRAMPOLINE_REF_10(3),
+    TRAMPOLINE_REF_10(4), TRAMPOLINE_REF_10(5), TRAMPOLINE_REF_10(6), TRAMPOLINE_REF_10(7),
+    TRAMPOLINE_REF_10(8), TRAMPOLINE_REF_10(9), TRAMPOLINE_REF_10(10), TRAMPOLINE_REF_10(11)
+};
+
+int cellular_trace_add_probe(const CellularTraceProbe_t *pProbe)
+{
+    if ((pProbe == NULL) || (gCellularTraceProbeCount >= CELLULAR_TRACE_MAX_PROBES))
+    {
+        return RETURN_ERROR;
+    }
+    gProbes[gCellularTraceProbeCount] = *pProbe;
+    gCellularTraceProbeCount++;
+    return RETURN_OK;
+}
+
+int cellular_trace_remove_probe(const CellularTraceProbe_t *pProbe)
+{
+    int i;
+
+    if (pProbe == NULL)
+    {
+        return RETURN_ERROR;
+    }
+    for (i = 0; i < gCellularTraceProbeCount; i++)
+    {
+        if ((gProbes[i].test_begin == pProbe->test_begin) && (gProbes[i].test_end == pProbe->test_end) &&
+            (gProbes[i].call_begin == pProbe->call_begin) && (gProbes[i].call_end == pProbe->call_end))
+        {
+            break;
+        }
+    }
+    if (i == gCellularTraceProbeCount)
+    {
+        return RETURN_ERROR;
+    }
+    /* Keep the order of the others, their end callbacks still run in reverse */
+    for (; i < gCellularTraceProbeCount - 1; i++)
+    {
+        gProbes[i] = gProbes[i + 1];
+    }
+    gCellularTraceProbeCount--;
+    return RETURN_OK;
+}
+
+void cellular_trace_set_runner(CellularTraceRunner_t runner)
+{
+    gRunner = runner;
+}
+
+void cellular_trace_set_abandon(CellularTraceAbandon_t abandon)
+{
+    gAbandon = abandon;
+}
+
+UT_TestFunction_t cellular_trace_wrap_test(const char *pTitle, UT_TestFunction_t pFunction)
+{
+    if ((gTestCount >= CELLULAR_TRACE_MAX_TESTS) || (pFunction == NULL))
+    {
+        return pFunction;
+    }
+    gTests[gTestCount].pTitle = pTitle;
+    gTests[gTestCount].pFunction = pFunction;
+    gTests[gTestCount].pGroup = gpGroup;
+    gTests[gTestCount].pId = gpId;
+    return gTrampolines[gTestCount++];
+}
+
+UT_test_t *cellular_trace_add_test(UT_test_suite_t *pSuite, const char *pTitle, UT_TestFunction_t pFunction)
+{
+    return UT_add_test(pSuite, pTitle, cellular_trace_wrap_test(pTitle, pFunction));
+}
+
+void cellular_trace_set_test_id(const int *pGroup, const int *pId)
+{
+    gpGroup = pGroup;
+    gpId = pId;
+}
+
+const char *cellular_trace_current_test(int *pId)
+{
+    int slot = gCurrentTest;
+    const TraceTest_t *pTest;
+
+    if (slot < 0)
+    {
+        if (pId != NULL)
+        {
+            *pId = -1;
+        }
+        return NULL;
+    }
+    pTest = &gTests[slot];
+    if (pId != NULL)
+    {
+        *pId = ((pTest->pGroup != NULL) && (pTest->pId != NULL)) ? *pTest->pGroup * 1000 + *pTest->pId : -1;
+    }
+    return pTest->pTitle;
+}
+
+const char *cellular_trace_api_name(CellularHalApi_t api)
+{
+    return ((unsigned int)api < CELLULAR_HAL_API_COUNT) ? gApiNames[api] : "unknown";
+}
+
+int cellular_trace_abandon_test(void)
+{
+    if (!gJumpArmed || !pthread_equal(pthread_self(), gTestThread))
+    {
+        return RETURN_ERROR;
+    }
+    if ((gAbandon != NULL) && (gAbandon() == RETURN_OK))
+    {
+        return RETURN_OK;
+    }
+    if (tHold > 0)
+    {
+        tPending = 1;
+        return RETURN_OK;
+    }
+    gJumpArmed = 0;
+    siglongjmp(gTestJump, 1);
+}
+
+void cellular_trace_hold_abandon(void)
+{
+    tHold++;
+}
+
+void cellular_trace_release_abandon(void)
+{
+    if ((--tHold == 0) && tPending)
+    {
+        tPending = 0;
+        cellular_trace_abandon_test();
+    }
+}
+
+void cellular_trace_call_begin(CellularHalApi_t api)
+{
+    int i;
+
+    tOpenApi = (int)api;
+    for (i = 0; i < gCellularTraceProbeCount; i++)
+    {
+        if (gProbes[i].call_begin != NULL)
+        {
+            gProbes[i].call_begin(api);
+        }
+    }
+}
+
+void cellular_trace_call_end(CellularHalApi_t api)
+{
+    int i;
+
+    tOpenApi = -1;
+    for (i = gCellularTraceProbeCount - 1; i >= 0; i--)
+    {
+        if (gProbes[i].call_end != NULL)
+        {
+            gProbes[i].call_end(api);
+        }
+    }
+}
@@ -0,0 +1,683 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:*
+ * Copyright 2023 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file cellular_watchdog.c
+ * @brief Deadlines for tests and HAL calls, with a diagnosis of what hung
+ *
+ * The probe takes no lock: a call of an API with a deadline claims a slot of a fixed
+ * table with compare-and-swap and releases it on return, and every call is written to
+ * a ring of the last calls. The watchdog thread polls at a tenth of the shortest
+ * deadline, so it adds no wakeups to short tests.
+ */
+
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <errno.h>
+#include <execinfo.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <ut_log.h>
+#include "cellular_watchdog.h"
+#include "cellular_bench.h"
+#include "cellular_fork.h"
+#include "cellular_log.h"
+#include "cellular_metrics.h"
+
+#define MAX_CALLS      64
+#define MAX_THREADS    64
+#define DUMP_FRAMES    32
+#define DUMP_WAIT_MS   500
+/* Frames of the dump handler and of the signal return trampoline */
+#define HANDLER_FRAMES 2
+
+typedef struct
+{
+    int tid;                     /* 0 while the slot is free */
+    int api;
+    uint64_t start_ns;
+    uint64_t deadline_ns;        /* 0 until the slot is armed */
+    int reported;
+} WatchCall_t;
+
+typedef struct
+{
+    int api;
+    int tid;
+    uint64_t start_ns;
+    uint64_t end_ns;             /* 0 while the call runs */
+} WatchHistory_t;
+
+typedef struct
+{
+    int tid;
+    int done;
+    int depth;
+    void *pcs[DUMP_FRAMES + HANDLER_FRAMES];
+} WatchDump_t;
+
+typedef struct
+{
+    uint64_t calls;
+    uint64_t ns;
+    uint64_t max_ns;
+} WatchApiTime_t;
+
+static pthread_once_t gOnce = PTHREAD_ONCE_INIT;
+static int gStarted = 0;    /* Starts not yet stopped */
+static int gRunning = 0;
+static pthread_t gThread;
+static CellularWatchdogAction_t gAction = CELLULAR_WATCHDOG_SKIP;
+static unsigned int gTestMs = 0;
+static unsigned int gDefaultApiMs = 0;
+static unsigned int gApiMs[CELLULAR_HAL_API_COUNT];
+static volatile unsigned int gPeriodMs = 1000;
+
+static int gTestTid = 0;
+static uint64_t gTestStartNs = 0;
+static uint64_t gTestDeadlineNs = 0;
+static int gTestReported = 0;
+
+static WatchCall_t gCalls[MAX_CALLS];
+static WatchHistory_t gHistory[CELLULAR_WATCHDOG_HISTORY];
+static unsigned int gHistoryNext = 0;
+static WatchApiTime_t gApiTimes[CELLULAR_HAL_API_COUNT];
+static WatchDump_t gDump[MAX_THREADS];
+static int gDumpCount = 0;
+static CellularWatchdogHang_t gHangs[CELLULAR_WATCHDOG_MAX_HANGS];
+static unsigned int gHangCount = 0;
+
+static __thread int tCall = -1;
+static __thread int tHistory = -1;
+static __thread uint64_t tStartNs = 0;
+
+static int current_tid(void)
+{
+    return (int)syscall(SYS_gettid);
+}
+
+static unsigned int api_deadline_ms(int api)
+{
+    return (gApiMs[api] != 0) ? gApiMs[api] : gDefaultApiMs;
+}
+
+/* A tenth of the shortest deadline, between 10 ms and 1 s */
+static void update_period(void)
+{
+    unsigned int shortest = gTestMs;
+    unsigned int i;
+
+    for (i = 0; i < CELLULAR_HAL_API_COUNT; i++)
+    {
+        if ((api_deadline_ms((int)i) != 0) && ((shortest == 0) || (api_deadline_ms((int)i) < shortest)))
+        {
+            shortest = api_deadline_ms((int)i);
+        }
+    }
+    gPeriodMs = (shortest == 0) ? 1000 : (shortest / 10 < 10) ? 10 : (shortest / 10 > 1000) ? 1000 : shortest / 10;
+}
+
+static void probe_test_begin(const char *pTitle)
+{
+    gTestTid = current_tid();
+    gTestReported = 0;
+    gTestStartNs = cellular_bench_now_ns();
+    __atomic_store_n(&gTestDeadlineNs, (gTestMs != 0) ? gTestStartNs + (uint64_t)gTestMs * 1000000ULL : 0, __ATOMIC_RELEASE);
+}
+
+static void probe_test_end(const char *pTitle)
+{
+    __atomic_store_n(&gTestDeadlineNs, 0, __ATOMIC_RELEASE);
+}
+
+static void probe_call_begin(CellularHalApi_t api)
+{
+    unsigned int deadlineMs = api_deadline_ms((int)api);
+    WatchHistory_t *pEntry;
+    int tid = current_tid();
+    int expected, i, slot;
+
+    tStartNs = cellular_bench_now_ns();
+    tHistory = (int)(__atomic_fetch_add(&gHistoryNext, 1, __ATOMIC_RELAXED) % CELLULAR_WATCHDOG_HISTORY);
+    pEntry = &gHistory[tHistory];
+    pEntry->end_ns = 0;
+    pEntry->api = (int)api;
+    pEntry->tid = tid;
+    pEntry->start_ns = tStartNs;
+
+    tCall = -1;
+    if (deadlineMs == 0)
+    {
+        return;
+    }
+    for (i = 0; i < MAX_CALLS; i++)
+    {
+        slot = (tid + i) % MAX_CALLS;
+        expected = 0;
+        if (__atomic_compare_exchange_n(&gCalls[slot].tid, &expected, tid, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+        {
+            gCalls[slot].api = (int)api;
+            gCalls[slot].start_ns = tStartNs;
+            gCalls[slot].reported = 0;
+            __atomic_store_n(&gCalls[slot].deadline_ns, tStartNs + (uint64_t)deadlineMs * 1000000ULL, __ATOMIC_RELEASE);
+            tCall = slot;
+            return;
+        }
+    }
+}
+
+static void probe_call_end(CellularHalApi_t api)
+{
+    uint64_t now = cellular_bench_now_ns();
+    uint64_t ns = now - tStartNs;
+    WatchApiTime_t *pTime = &gApiTimes[api];
+    uint64_t max = __atomic_load_n(&pTime->max_ns, __ATOMIC_RELAXED);
+
+    __atomic_add_fetch(&pTime->calls, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&pTime->ns, ns, __ATOMIC_RELAXED);
+    while ((ns > max) && !__atomic_compare_exchange_n(&pTime->max_ns, &max, ns, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    {
+    }
+    if ((tHistory >= 0) && (gHistory[tHistory].start_ns == tStartNs))
+    {
+        gHistory[tHistory].end_ns = now;
+    }
+    if (tCall >= 0)
+    {
+        __atomic_store_n(&gCalls[tCall].deadline_ns, 0, __ATOMIC_RELEASE);
+        __atomic_store_n(&gCalls[tCall].tid, 0, __ATOMIC_RELEASE);
+        tCall = -1;
+    }
+}
+
+static void on_dump(int sig)
+{
+    int savedErrno = errno;
+    int tid = current_tid();
+    int count = __atomic_load_n(&gDumpCount, __ATOMIC_ACQUIRE);
+    int i;
+
+    for (i = 0; i < count; i++)
+    {
+        if (gDump[i].tid == tid)
+        {
+            gDump[i].depth = backtrace(gDump[i].pcs, DUMP_FRAMES + HANDLER_FRAMES);
+            __atomic_store_n(&gDump[i].done, 1, __ATOMIC_RELEASE);
+            break;
+        }
+    }
+    errno = savedErrno;
+}
+
+static void on_abandon(int sig)
+{
+    cellular_trace_abandon_test();
+}
+
+static void thread_name(int tid, char *pName, size_t size)
+{
+    char path[64];
+    FILE *pFile;
+
+    snprintf(pName, size, "?");
+    snprintf(path, sizeof(path), "/proc/self/task/%d/comm", tid);
+    pFile = fopen(path, "r");
+    if (pFile == NULL)
+    {
+        return;
+    }
+    if (fgets(pName, (int)size, pFile) != NULL)
+    {
+        pName[strcspn(pName, "\n")] = '\0';
+    }
+    fclose(pFile);
+}
+
+/* Every other thread logs its own stack from the dump signal handler; returns the threads logged */
+static unsigned int dump_threads(void)
+{
+    struct dirent *pEntry;
+    DIR *pDir = opendir("/proc/self/task");
+    char name[32];
+    char **ppSymbols;
+    uint64_t start;
+    int self = current_tid();
+    int count = 0, answered, i, f;
+
+    while ((pDir != NULL) && ((pEntry = readdir(pDir)) != NULL) && (count < MAX_THREADS))
+    {
+        if ((pEntry->d_name[0] < '0') || (pEntry->d_name[0] > '9') || (atoi(pEntry->d_name) == self))
+        {
+            continue;
+        }
+        gDump[count].tid = atoi(pEntry->d_name);
+        gDump[count].done = 0;
+        gDump[count].depth = 0;
+        count++;
+    }
+    if (pDir != NULL)
+    {
+        closedir(pDir);
+    }
+    __atomic_store_n(&gDumpCount, count, __ATOMIC_RELEASE);
+    for (i = 0; i < count; i++)
+    {
+        syscall(SYS_tgkill, getpid(), gDump[i].tid, CELLULAR_WATCHDOG_DUMP_SIGNAL);
+    }
+    start = cellular_bench_now_ns();
+    do
+    {
+        for (i = 0, answered = 0; i < count; i++)
+        {
+            answered += __atomic_load_n(&gDump[i].done, __ATOMIC_ACQUIRE);
+        }
+        if (answered < count)
+        {
+            cellular_bench_sleep_ms(1);
+        }
+    } while ((answered < count) && (cellular_bench_now_ns() - start < DUMP_WAIT_MS * 1000000ULL));
+
+    for (i = 0; i < count; i++)
+    {
+        thread_name(gDump[i].tid, name, sizeof(name));
+        if (!__atomic_load_n(&gDump[i].done, __ATOMIC_ACQUIRE) || (gDump[i].depth <= HANDLER_FRAMES))
+        {
+            UT_LOG_ERROR("Thread %d (%s): no stack, the thread did not answer", gDump[i].tid, name);
+            continue;
+        }
+        UT_LOG_ERROR("Thread %d (%s):", gDump[i].tid, name);
+        ppSymbols = backtrace_symbols(&gDump[i].pcs[HANDLER_FRAMES], gDump[i].depth - HANDLER_FRAMES);
+        for (f = 0; f < gDump[i].depth - HANDLER_FRAMES; f++)
+        {
+            UT_LOG_ERROR("    #%-2d %s", f, (ppSymbols != NULL) ? ppSymbols[f] : "?");
+        }
+        free(ppSymbols);
+    }
+    __atomic_store_n(&gDumpCount, 0, __ATOMIC_RELEASE);
+    return (unsigned int)count;
+}
+
+/* The last HAL calls, newest first, and the time per API so far */
+static void log_timings(uint64_t now)
+{
+    const WatchHistory_t *pEntry;
+    const WatchApiTime_t *pTime;
+    unsigned int next = __atomic_load_n(&gHistoryNext, __ATOMIC_RELAXED);
+    unsigned int i;
+
+    UT_LOG_ERROR("| %-52s | %7s | %12s | %12s |", "Last HAL calls", "thread", "started ms", "duration us");
+    for (i = 1; (i <= CELLULAR_WATCHDOG_HISTORY) && (i <= next); i++)
+    {
+        pEntry = &gHistory[(next - i) % CELLULAR_WATCHDOG_HISTORY];
+        if (pEntry->end_ns == 0)
+        {
+            UT_LOG_ERROR("| %-52s | %7d | %9llu ago | %12s |", cellular_trace_api_name((CellularHalApi_t)pEntry->api), pEntry->tid,
+                         (unsigned long long)((now - pEntry->start_ns) / 1000000), "running");
+        }
+        else
+        {
+            UT_LOG_ERROR("| %-52s | %7d | %9llu ago | %12llu |", cellular_trace_api_name((CellularHalApi_t)pEntry->api), pEntry->tid,
+                         (unsigned long long)((now - pEntry->start_ns) / 1000000),
+                         (unsigned long long)((pEntry->end_ns - pEntry->start_ns) / 1000));
+        }
+    }
+    UT_LOG_ERROR("| %-52s | %7s | %12s | %12s |", "Time per API", "calls", "mean us", "max us");
+    for (i = 0; i < CELLULAR_HAL_API_COUNT; i++)
+    {
+        pTime = &gApiTimes[i];
+        if (pTime->calls > 0)
+        {
+            UT_LOG_ERROR("| %-52s | %7llu | %12llu | %12llu |", cellular_trace_api_name((CellularHalApi_t)i),
+                         (unsigned long long)pTime->calls, (unsigned long long)(pTime->ns / pTime->calls / 1000),
+                         (unsigned long long)(pTime->max_ns / 1000));
+        }
+    }
+}
+
+static void expire(CellularHalApi_t api, int tid, uint64_t start_ns, unsigned int deadline_ms)
+{
+    uint64_t now = cellular_bench_now_ns();
+    CellularWatchdogHang_t hang;
+
+    memset(&hang, 0, sizeof(hang));
+    hang.pTest = cellular_trace_current_test(NULL);
+    hang.api = api;
+    hang.tid = tid;
+    hang.deadline_ms = deadline_ms;
+    hang.elapsed_ms = (unsigned int)((now - start_ns) / 1000000);
+    UT_LOG_ERROR("Watchdog: %s on thread %d in test %s has run %u ms, deadline %u ms",
+                 (api == CELLULAR_HAL_API_COUNT) ? "test" : cellular_trace_api_name(api), tid,
+                 (hang.pTest != NULL) ? hang.pTest : "none", hang.elapsed_ms, deadline_ms);
+    hang.threads = dump_threads();
+    log_timings(now);
+    if (gTestStartNs != 0)
+    {
+        UT_LOG_ERROR("Test %s running for %llu ms", (hang.pTest != NULL) ? hang.pTest : "none",
+                     (unsigned long long)((now - gTestStartNs) / 1000000));
+    }
+
+    if (gAction == CELLULAR_WATCHDOG_ABORT)
+    {
+        UT_LOG_ERROR("Watchdog: aborting");
+        cellular_log_flush();
+        abort();
+    }
+    if ((hang.pTest != NULL) && (tid == gTestTid))
+    {
+        UT_LOG_ERROR("Watchdog: abandoning test %s, later results may be affected by the HAL state it left", hang.pTest);
+        hang.abandoned = 1;
+        /* No expiry of the abandoned test is reported twice */
+        gTestReported = 1;
+        syscall(SYS_tgkill, getpid(), tid, CELLULAR_WATCHDOG_ABANDON_SIGNAL);
+    }
+    else
+    {
+        UT_LOG_ERROR("Watchdog: thread %d is left blocked", tid);
+    }
+    if (gHangCount < CELLULAR_WATCHDOG_MAX_HANGS)
+    {
+        gHangs[gHangCount] = hang;
+    }
+    __atomic_add_fetch(&gHangCount, 1, __ATOMIC_RELEASE);
+}
+
+static void *watchdog_thread(void *pArg)
+{
+    uint64_t now, deadline;
+    unsigned int slept;
+    int i;
+
+    prctl(PR_SET_NAME, "cellular_wdog", 0, 0, 0);
+    while (__atomic_load_n(&gRunning, __ATOMIC_ACQUIRE))
+    {
+        /* In slices, so a shorter deadline set meanwhile is checked at its own period and a stop is seen soon */
+        for (slept = 0; (slept < gPeriodMs) && __atomic_load_n(&gRunning, __ATOMIC_ACQUIRE); slept += 10)
+        {
+            cellular_bench_sleep_ms(10);
+        }
+        now = cellular_bench_now_ns();
+        deadline = __atomic_load_n(&gTestDeadlineNs, __ATOMIC_ACQUIRE);
+        if ((deadline != 0) && (now > deadline) && !gTestReported)
+        {
+            gTestReported = 1;
+            expire(CELLULAR_HAL_API_COUNT, gTestTid, gTestStartNs, gTestMs);
+        }
+        for (i = 0; i < MAX_CALLS; i++)
+        {
+            deadline = __atomic_load_n(&gCalls[i].deadline_ns, __ATOMIC_ACQUIRE);
+            if ((deadline != 0) && (now > deadline) && !gCalls[i].reported)
+            {
+                gCalls[i].reported = 1;
+                expire((CellularHalApi_t)gCalls[i].api, gCalls[i].tid, gCalls[i].start_ns, api_deadline_ms(gCalls[i].api));
+            }
+        }
+    }
+    return NULL;
+}
+
+static int same_hang(const CellularWatchdogHang_t *pA, const CellularWatchdogHang_t *pB)
+{
+    return (pA->pTest == pB->pTest) && (pA->api == pB->api) && (pA->abandoned == pB->abandoned);
+}
+
+/* One sample per test, API and action */
+static void collect_metrics(FILE *pOut)
+{
+    unsigned int count = (gHangCount < CELLULAR_WATCHDOG_MAX_HANGS) ? gHangCount : CELLULAR_WATCHDOG_MAX_HANGS;
+    unsigned int i, j, expiries;
+
+    if (gStarted == 0)
+    {
+        return;
+    }
+    cellular_metrics_family(pOut, "cellular_watchdog_expiries", CELLULAR_METRIC_COUNTER, "Test and HAL call deadlines which expired");
+    for (i = 0; i < count; i++)
+    {
+        for (j = 0; (j < i) && !same_hang(&gHangs[j], &gHangs[i]); j++)
+        {
+        }
+        if (j < i)
+        {
+            continue;
+        }
+        for (j = i, expiries = 0; j < count; j++)
+        {
+            expiries += (unsigned int)same_hang(&gHangs[j], &gHangs[i]);
+        }
+        cellular_metrics_sample(pOut, "cellular_watchdog_expiries_total", (double)expiries,
+                                "test", (gHangs[i].pTest != NULL) ? gHangs[i].pTest : "none",
+                                "api", (gHangs[i].api == CELLULAR_HAL_API_COUNT) ? "none" : cellular_trace_api_name(gHangs[i].api),
+                                "action", gHangs[i].abandoned ? "abandoned" : "none", NULL);
+    }
+}
+
+/* Deadlines and the record of calls and hangs, as before the first start */
+static void clear_state(void)
+{
+    gTestMs = 0;
+    gDefaultApiMs = 0;
+    memset(gApiMs, 0, sizeof(gApiMs));
+    update_period();
+    __atomic_store_n(&gTestDeadlineNs, 0, __ATOMIC_RELEASE);
+    memset(gCalls, 0, sizeof(gCalls));
+    memset(gHistory, 0, sizeof(gHistory));
+    gHistoryNext = 0;
+    memset(gApiTimes, 0, sizeof(gApiTimes));
+    memset(gHangs, 0, sizeof(gHangs));
+    gHangCount = 0;
+}
+
+static const CellularTraceProbe_t gProbe =
+{
+    probe_test_begin, probe_test_end, probe_call_begin, probe_call_end
+};
+
+/* The watchdog thread does not survive a fork: a child runs without the watchdog and can start its own */
+static void atfork_child(void)
+{
+    if (gStarted > 0)
+    {
+        cellular_trace_remove_probe(&gProbe);
+    }
+    gStarted = 0;
+    gRunning = 0;
+    clear_state();
+}
+
+static void watchdog_once(void)
+{
+    pthread_atfork(NULL, NULL, atfork_child);
+}
+
+int cellular_watchdog_start(unsigned int test_ms, CellularWatchdogAction_t action)
+{
+    struct sigaction dumpAction;
+    struct sigaction abandonAction;
+    void *pcs[4];
+
+    pthread_once(&gOnce, watchdog_once);
+    if (gStarted > 0)
+    {
+        gStarted++;
+        return RETURN_OK;
+    }
+    gTestMs = test_ms;
+    gAction = action;
+    update_period();
+    /* Loads the unwinder before the handler needs it */
+    backtrace(pcs, 4);
+    memset(&dumpAction, 0, sizeof(dumpAction));
+    dumpAction.sa_handler = on_dump;
+    dumpAction.sa_flags = SA_RESTART;
+    sigemptyset(&dumpAction.sa_mask);
+    memset(&abandonAction, 0, sizeof(abandonAction));
+    abandonAction.sa_handler = on_abandon;
+    sigemptyset(&abandonAction.sa_mask);
+    if ((sigaction(CELLULAR_WATCHDOG_DUMP_SIGNAL, &dumpAction, NULL) != 0) ||
+        (sigaction(CELLULAR_WATCHDOG_ABANDON_SIGNAL, &abandonAction, NULL) != 0))
+    {
+        UT_LOG_ERROR("Watchdog signal setup failed: %s", strerror(errno));
+        return RETURN_ERROR;
+    }
+    if (cellular_trace_add_probe(&gProbe) != RETURN_OK)
+    {
+        return RETURN_ERROR;
+    }
+    __atomic_store_n(&gRunning, 1, __ATOMIC_RELEASE);
+    if (pthread_create(&gThread, NULL, watchdog_thread, NULL) != 0)
+    {
+        UT_LOG_ERROR("Watchdog thread creation failed");
+        __atomic_store_n(&gRunning, 0, __ATOMIC_RELEASE);
+        cellular_trace_remove_probe(&gProbe);
+        return RETURN_ERROR;
+    }
+    gStarted = 1;
+    cellular_metrics_add_collector(collect_metrics);
+    return RETURN_OK;
+}
+
+void cellular_watchdog_stop(void)
+{
+    if ((gStarted == 0) || (--gStarted > 0))
+    {
+        return;
+    }
+    cellular_trace_remove_probe(&gProbe);
+    __atomic_store_n(&gRunning, 0, __ATOMIC_RELEASE);
+    pthread_join(gThread, NULL);
+    clear_state();
+}
+
+/* The HAL calls of a forked test run in its child, which has no watchdog thread */
+static void warn_forked(void)
+{
+    if (cellular_fork_active())
+    {
+        UT_LOG_WARNING("Watchdog: API deadlines are not enforced while tests run in forked children, only the test deadline is");
+    }
+}
+
+static int set_deadline(CellularHalApi_t api, unsigned int ms)
+{
+    if ((unsigned int)api > CELLULAR_HAL_API_COUNT)
+    {
+        return RETURN_ERROR;
+    }
+    if (api == CELLULAR_HAL_API_COUNT)
+    {
+        gDefaultApiMs = ms;
+    }
+    else
+    {
+        gApiMs[api] = ms;
+    }
+    update_period();
+    return RETURN_OK;
+}
+
+int cellular_watchdog_set_api_deadline(CellularHalApi_t api, unsigned int ms)
+{
+    if (ms != 0)
+    {
+        warn_forked();
+    }
+    return set_deadline(api, ms);
+}
+
+int cellular_watchdog_set_api_deadlines(const char *pList)
+{
+    char copy[1024];
+    char *pSave = NULL;
+    char *pEntry;
+    char *pValue;
+    const char *pName;
+    int result = RETURN_OK;
+    unsigned int i;
+
+    if (pList == NULL)
+    {
+        return RETURN_ERROR;
+    }
+    warn_forked();
+    snprintf(copy, sizeof(copy), "%s", pList);
+    for (pEntry = strtok_r(copy, ",", &pSave); pEntry != NULL; pEntry = strtok_r(NULL, ",", &pSave))
+    {
+        pValue = strchr(pEntry, '=');
+        if (pValue == NULL)
+        {
+            set_deadline(CELLULAR_HAL_API_COUNT, (unsigned int)atoi(pEntry) * 1000);
+            continue;
+        }
+        *pValue++ = '\0';
+        for (i = 0; i < CELLULAR_HAL_API_COUNT; i++)
+        {
+            pName = cellular_trace_api_name((CellularHalApi_t)i);
+            if ((strcmp(pName, pEntry) == 0) || (strcmp(pName + strlen("cellular_hal_"), pEntry) == 0))
+            {
+                set_deadline((CellularHalApi_t)i, (unsigned int)atoi(pValue) * 1000);
+                break;
+            }
+        }
+        if (i == CELLULAR_HAL_API_COUNT)
+        {
+            UT_LOG_ERROR("Watchdog: unknown API [%s]", pEntry);
+            result = RETURN_ERROR;
+        }
+    }
+    return result;
+}
+
+unsigned int cellular_watchdog_get_hangs(CellularWatchdogHang_t *pHangs, unsigned int max)
+{
+    unsigned int count = __atomic_load_n(&gHangCount, __ATOMIC_ACQUIRE);
+    unsigned int i;
+
+    for (i = 0; (pHangs != NULL) && (i < max) && (i < count) && (i < CELLULAR_WATCHDOG_MAX_HANGS); i++)
+    {
+        pHangs[i] = gHangs[i];
+    }
+    return count;
+}
+
+void cellular_watchdog_report(void)
+{
+    unsigned int count = (gHangCount < CELLULAR_WATCHDOG_MAX_HANGS) ? gHangCount : CELLULAR_WATCHDOG_MAX_HANGS;
+    unsigned int i;
+
+    if (!gStarted)
+    {
+        return;
+    }
+    UT_LOG_INFO("Watchdog: %u deadlines expired, test deadline %u ms, poll period %u ms", gHangCount, gTestMs, gPeriodMs);
+    if (count == 0)
+    {
+        return;
+    }
+    UT_LOG_INFO("| %-52s | %-52s | %10s | %10s | %-9s |", "Test", "Scope", "elapsed ms", "deadline", "action");
+    for (i = 0; i < count; i++)
+    {
+        UT_LOG_INFO("| %-52s | %-52s | %10u | %10u | %-9s |", (gHangs[i].pTest != NULL) ? gHangs[i].pTest : "none",
+                    (gHangs[i].api == CELLULAR_HAL_API_COUNT) ? "test" : cellular_trace_api_name(gHangs[i].api),
+                    gHangs[i].elapsed_ms, gHangs[i].deadline_ms, gHangs[i].abandoned ? "abandoned" : "none");
+    }
+}
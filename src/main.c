@@ -18,6 +18,22 @@
 #include<stdio.h>
 #include <ut.h>
 #include <ut_log.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cellular_profile_compiler.h"
+#include "cellular_census.h"
+#include "cellular_perf.h"
+#include "cellular_syscall.h"
+#include "cellular_lock.h"
+#include "cellular_metrics.h"
+#include "cellular_run.h"
+#include "cellular_sampler.h"
+#include "cellular_watchdog.h"
+#include "cellular_fork.h"
+#include "cellular_fuzz.h"
+#include "cellular_atmodem.h"
+#include "cellular_ctlmodem.h"
+#include "cellular_sim.h"
 
 extern int register_hal_l1_tests( void );
 
@@ -27,6 +43,110 @@ int main(int argc, char** argv)
 
     UT_init( argc, argv );
 
+    /* Compile the YAML profiles into a profile store file and exit without running tests */
+    if (getenv("CELLULAR_PROFILE_COMPILE") != NULL)
+    {
+        return (cellular_profile_compile(getenv("CELLULAR_PROFILE_COMPILE"), NULL) == RETURN_OK) ? 0 : 1;
+    }
+
+    /* Pin, schedule and lock memory as bin/run.sh asked, before any thread inherits the old settings */
+    cellular_run_apply();
+
+    /* Answer AT commands on a pty and, on the simulator, send the HAL calls over it */
+    if (getenv("CELLULAR_ATMODEM") != NULL)
+    {
+        cellular_atmodem_start((unsigned int)atoi(getenv("CELLULAR_ATMODEM")), 0);
+        if (getenv("CELLULAR_ATMODEM_LATENCY") != NULL)
+        {
+            cellular_atmodem_set_latencies(getenv("CELLULAR_ATMODEM_LATENCY"));
+        }
+        if (getenv("CELLULAR_ATMODEM_LINK") != NULL)
+        {
+            cellular_atmodem_link(getenv("CELLULAR_ATMODEM_LINK"));
+        }
+        if (cellular_sim_available() && (cellular_atmodem_path() != NULL))
+        {
+            cellular_sim_set_at_device(cellular_atmodem_path());
+        }
+    }
+
+    /* Answer the binary control protocol on a socket; on the simulator it takes over from AT */
+    if (getenv("CELLULAR_CTLMODEM") != NULL)
+    {
+        cellular_ctlmodem_start((unsigned int)atoi(getenv("CELLULAR_CTLMODEM")));
+        if (getenv("CELLULAR_CTLMODEM_LATENCY") != NULL)
+        {
+            cellular_ctlmodem_set_latencies(getenv("CELLULAR_CTLMODEM_LATENCY"));
+        }
+        if (cellular_sim_available() && (cellular_ctlmodem_path() != NULL))
+        {
+            cellular_sim_set_ctl_device(cellular_ctlmodem_path());
+        }
+    }
+
+    /* Fuzz the HAL calls taking structs and strings in-process and exit without running tests */
+    if (getenv("CELLULAR_FUZZ") != NULL)
+    {
+        return (cellular_fuzz_main(getenv("CELLULAR_FUZZ")) == RETURN_OK) ? 0 : 1;
+    }
+
+    /* List threads and descriptors around every test and HAL call; first, so the other probes do not measure it */
+    if (getenv("CELLULAR_CENSUS") != NULL)
+    {
+        cellular_census_start();
+    }
+
+    /* Run every test in a copy-on-write child of the initialized process, so none inherits what another left behind; before the watchdog, which warns about what it cannot see there */
+    if ((getenv("CELLULAR_FORK") != NULL) && (strcmp(getenv("CELLULAR_FORK"), "0") != 0))
+    {
+        cellular_fork_start();
+    }
+
+    /* Diagnose and get past tests and HAL calls which overrun their deadlines */
+    if ((getenv("CELLULAR_WATCHDOG") != NULL) || (getenv("CELLULAR_WATCHDOG_API") != NULL))
+    {
+        cellular_watchdog_start((getenv("CELLULAR_WATCHDOG") != NULL) ? (unsigned int)atoi(getenv("CELLULAR_WATCHDOG")) * 1000 : 0,
+                                ((getenv("CELLULAR_WATCHDOG_ACTION") != NULL) && (strcmp(getenv("CELLULAR_WATCHDOG_ACTION"), "abort") == 0)) ?
+                                CELLULAR_WATCHDOG_ABORT : CELLULAR_WATCHDOG_SKIP);
+        if (getenv("CELLULAR_WATCHDOG_API") != NULL)
+        {
+            cellular_watchdog_set_api_deadlines(getenv("CELLULAR_WATCHDOG_API"));
+        }
+    }
+
+    /* Count CPU and scheduler events around every test and HAL call */
+    if (getenv("CELLULAR_PERF") != NULL)
+    {
+        cellular_perf_start((strcmp(getenv("CELLULAR_PERF"), "sw") == 0) ? CELLULAR_PERF_SOURCE_SOFTWARE :
+                            (strcmp(getenv("CELLULAR_PERF"), "rusage") == 0) ? CELLULAR_PERF_SOURCE_RUSAGE :
+                            CELLULAR_PERF_SOURCE_HARDWARE);
+    }
+
+    /* Count the system calls made inside every HAL call, grouped by descriptor target */
+    if (getenv("CELLULAR_SYSCALLS") != NULL)
+    {
+        cellular_syscall_start();
+    }
+
+    /* Time the mutex and rwlock waits and holds inside every HAL call, per lock */
+    if (getenv("CELLULAR_LOCKS") != NULL)
+    {
+        cellular_lock_start();
+    }
+
+    /* Sample the stacks of every thread at CELLULAR_SAMPLER Hz of CPU time, tagged with the test and HAL call */
+    if (getenv("CELLULAR_SAMPLER") != NULL)
+    {
+        cellular_sampler_start((unsigned int)atoi(getenv("CELLULAR_SAMPLER")));
+    }
+
+    /* Export the results to a file after the run and over HTTP while it runs; added last so the latency histograms exclude the other probes */
+    cellular_metrics_start();
+    if (getenv("CELLULAR_METRICS_PORT") != NULL)
+    {
+        cellular_metrics_serve((unsigned short)atoi(getenv("CELLULAR_METRICS_PORT")));
+    }
+
     registerReturn = register_hal_l1_tests();
     if (registerReturn == 0)
     {
@@ -39,5 +159,17 @@ int main(int argc, char** argv)
     }
     /* Begin test executions */
     UT_run_tests();
+    cellular_census_report();
+    cellular_perf_report();
+    cellular_syscall_report();
+    cellular_sampler_stop();
+    cellular_lock_report();
+    cellular_sampler_report();
+    cellular_watchdog_report();
+    cellular_fork_report();
+    cellular_atmodem_report();
+    cellular_ctlmodem_report();
+    cellular_sampler_write((getenv("CELLULAR_SAMPLER_FILE") != NULL) ? getenv("CELLULAR_SAMPLER_FILE") : "cellular_hal_samples.folded");
+    cellular_metrics_write((getenv("CELLULAR_METRICS_FILE") != NULL) ? getenv("CELLULAR_METRICS_FILE") : "cellular_hal_metrics.prom");
     return 0;
 }
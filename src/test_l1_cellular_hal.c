@@ -36,8 +36,13 @@
 #include <string.h>
 #include "cellular_hal.h"
 #include <ut_kvp_profile.h>
-
-#define MAX_STRING_LENGTH 250
+#define CELLULAR_LOG_REPLACE_UT_LOG
+#include "cellular_log.h"
+#define CELLULAR_TRACE_HAL_CALLS
+#include "cellular_trace.h"
+#include "cellular_profile_store.h"
+#include "cellular_profile_compiler.h"
+#include "cellular_bench.h"
 
 static int gTestGroup = 1;
 static int gTestID = 1;
@@ -445,7 +450,7 @@ void test_l1_cellular_hal_negative2_sim_power_enable(void)
  * **Test Procedure:** @n
  * | Variation / Step | Description | Test Data | Expected Result | Notes |
  * | :----: | :---------: | :----------: | :--------------: | :-----: |
- * | 01 | Invoking cellular_hal_get_total_no_of_uicc_slots with  valid total_slots value | total_slots = valid value | RETURN_OK | Should be successful |
+ * | 01 | Invoking cellular_hal_get_total_no_of_uicc_slots with  valid total_slots value | total_slots = valid value | RETURN_OK, total_slots = cellular/config/slot_count when set, else 1 to 3 | Should be successful |
  */
 void test_l1_cellular_hal_positive1_get_total_no_of_uicc_slots(void)
 {
@@ -454,12 +459,16 @@ void test_l1_cellular_hal_positive1_get_total_no_of_uicc_slots(void)
 
     int result = 0;
     unsigned int total_slots = 0;
+    unsigned int slot_count = 0;
+
+    /* Optional; when the profile gives the count of the platform, nothing else is accepted */
+    slot_count = UT_KVP_PROFILE_GET_UINT32("cellular/config/slot_count");
 
     UT_LOG_DEBUG("Invoking cellular_hal_get_total_no_of_uicc_slots with total_slots = 0");
     result = cellular_hal_get_total_no_of_uicc_slots(&total_slots);
     UT_LOG_DEBUG("Return Status: %d", result);
 
-    if ((total_slots == 1) || (total_slots == 2))
+    if ((slot_count != 0) ? (total_slots == slot_count) : ((total_slots >= 1) && (total_slots <= 3)))
     {
         UT_LOG_DEBUG("total number of uicc_slots %u which is a valid value", total_slots);
         UT_PASS("cellular_hal_get_total_no_of_uicc_slots validation success");
@@ -489,7 +498,8 @@ void test_l1_cellular_hal_positive1_get_total_no_of_uicc_slots(void)
  * **Test Procedure:** @n
  * | Variation / Step | Description | Test Data | Expected Result| Notes |
  * | :----: | :---------: | :----------: | :--------------: | :-----: |
- * | 01 | Invoking cellular_hal_get_uicc_slot_info function with valid slot index and slot info structure |  slot_index = valid value, slot_info = valid struct |  RETURN_OK | Should be successful |
+ * | 01 | Invoking cellular_hal_get_total_no_of_uicc_slots to get the slot count | total_slots = valid pointer | RETURN_OK | Should be successful |
+ * | 02 | Invoking cellular_hal_get_uicc_slot_info function for every slot | slot_index = 0 to total_slots - 1, slot_info = valid struct |  RETURN_OK, valid structure fields | Should be successful |
  */
 void test_l1_cellular_hal_positive1_cellular_hal_get_uicc_slot_info(void)
 {
@@ -498,17 +508,23 @@ void test_l1_cellular_hal_positive1_cellular_hal_get_uicc_slot_info(void)
 
     int status = 0;
     unsigned int slot_index = 0;
+    unsigned int total_slots = 0;
 
     CellularUICCSlotInfoStruct *slot_info = (CellularUICCSlotInfoStruct *)malloc(sizeof(CellularUICCSlotInfoStruct));
 
     if (slot_info != NULL)
     {
-        memset(slot_info, 0, sizeof(CellularUICCSlotInfoStruct));
-        UT_LOG_DEBUG("Invoking cellular_hal_get_uicc_slot_info with valid input");
-        status = cellular_hal_get_uicc_slot_info(slot_index, slot_info);
-        UT_LOG_DEBUG("Return Status: %d", status);
-        if (slot_info != NULL)
+        UT_LOG_DEBUG("Invoking cellular_hal_get_total_no_of_uicc_slots");
+        status = cellular_hal_get_total_no_of_uicc_slots(&total_slots);
+        UT_LOG_DEBUG("Return Status: %d, total_slots: %u", status, total_slots);
+        UT_ASSERT_EQUAL(status, RETURN_OK);
+        for (slot_index = 0; slot_index < total_slots; slot_index++)
         {
+            memset(slot_info, 0, sizeof(CellularUICCSlotInfoStruct));
+            UT_LOG_DEBUG("Invoking cellular_hal_get_uicc_slot_info with slot_index = %u", slot_index);
+            status = cellular_hal_get_uicc_slot_info(slot_index, slot_info);
+            UT_LOG_DEBUG("Return Status: %d", status);
+            UT_ASSERT_EQUAL(status, RETURN_OK);
             if (slot_info->SlotEnable == TRUE || slot_info->SlotEnable == FALSE)
             {
                 UT_LOG_DEBUG("slot_info->SlotEnable is %d which is a valid value", slot_info->SlotEnable);
@@ -604,14 +620,8 @@ void test_l1_cellular_hal_positive1_cellular_hal_get_uicc_slot_info(void)
                 UT_LOG_DEBUG("slot_info->msisdn is %s", slot_info->msisdn);
                 UT_PASS("slot_info->msisdn validation success");
             }
-            free(slot_info);
-        }
-        else
-        {
-            UT_LOG_DEBUG("API RETURNS NULL POINTER");
-            UT_FAIL("API RETURNS NULL POINTER");
         }
-        UT_ASSERT_EQUAL(status, RETURN_OK);
+        free(slot_info);
     }
     else
     {
@@ -2961,102 +2971,112 @@ int init_cellular_hal_init()
 int teardown()
 {
     UT_LOG_DEBUG("suit [L1_cellular_hal] completed");
+    cellular_log_flush();
     return 0;
 }
 
-int test_cellular_hal_l1_register(void)
+/**
+ * @brief Fill the global test profile from the cellular.config.profile section of the YAML profile
+ */
+static void load_profile_from_yaml(void)
 {
-    // Create the test suite
-    pSuite = UT_add_suite("[L1_cellular_hal]", init_cellular_hal_init, teardown);
-    if (pSuite == NULL)
+    if (cellular_profile_from_kvp(CELLULAR_PROFILE_CONFIG_KEY, &profile) != RETURN_OK)
     {
-        return -1;
+        UT_LOG_ERROR("Profile %s could not be resolved", CELLULAR_PROFILE_CONFIG_KEY);
     }
+}
 
-    char retrievedString[MAX_STRING_LENGTH];
-
-    profile.ProfileID = UT_KVP_PROFILE_GET_UINT32("cellular.config.profile.ProfileID");
+/**
+ * @brief Take the global test profile from a profile store file, skipping the YAML lookups
+ *
+ * @return int - 0 when the profile was loaded, otherwise failure
+ */
+static int load_profile_from_store(const char *pPath)
+{
+    CellularProfileFileView_t view;
+    const CellularProfileStruct *pStored = NULL;
+    unsigned int i = 0;
 
-    UT_KVP_PROFILE_GET_STRING("cellular.config.profile.ProfileType", retrievedString);
-    if (strcmp(retrievedString, "CELLULAR_PROFILE_TYPE_3GPP") == 0)
-    {
-        profile.ProfileType = CELLULAR_PROFILE_TYPE_3GPP;
-    }
-    else if (strcmp(retrievedString, "CELLULAR_PROFILE_TYPE_3GPP2") == 0)
+    if (pPath == NULL)
     {
-        profile.ProfileType = CELLULAR_PROFILE_TYPE_3GPP2;
+        return -1;
     }
-
-    profile.PDPContextNumber = UT_KVP_PROFILE_GET_UINT32("cellular.config.profile.PDPContextNumber");
-
-    UT_KVP_PROFILE_GET_STRING("cellular.config.profile.PDPType", retrievedString);
-    if (strcmp(retrievedString, "CELLULAR_PDP_TYPE_IPV4") == 0)
+    if (cellular_profile_file_map(pPath, &view) != RETURN_OK)
     {
-        profile.PDPType = CELLULAR_PDP_TYPE_IPV4;
+        UT_LOG_DEBUG("Profile store %s not usable, falling back to YAML", pPath);
+        return -1;
     }
-    else if (strcmp(retrievedString, "CELLULAR_PDP_TYPE_IPV6") == 0)
+    for (i = 0; (i < view.count) && (pStored == NULL); i++)
     {
-        profile.PDPType = CELLULAR_PDP_TYPE_IPV6;
+        if (view.pRecords[i].bIsThisDefaultProfile)
+        {
+            pStored = &view.pRecords[i];
+        }
     }
-    else if (strcmp(retrievedString, "CELLULAR_PDP_TYPE_PPP") == 0)
+    if ((pStored == NULL) && (view.count > 0))
     {
-        profile.PDPType = CELLULAR_PDP_TYPE_PPP;
+        pStored = &view.pRecords[view.pById[0]];
     }
-    else if (strcmp(retrievedString, "CELLULAR_PDP_TYPE_IPV4_OR_IPV6") == 0)
+    if (pStored != NULL)
     {
-        profile.PDPType = CELLULAR_PDP_TYPE_IPV4_OR_IPV6;
+        profile = *pStored;
+        UT_LOG_DEBUG("Profile %d loaded from profile store %s", profile.ProfileID, pPath);
     }
+    cellular_profile_file_unmap(&view);
+    return (pStored != NULL) ? 0 : -1;
+}
+
+/**
+ * @brief Save the global test profile to a profile store file so later runs skip the YAML lookups
+ */
+static void save_profile_to_store(const char *pPath)
+{
+    cellular_profile_store_t *pStore = cellular_profile_store_create();
 
-    UT_KVP_PROFILE_GET_STRING("cellular.config.profile.PDPAuthentication", retrievedString);
-    if (strcmp(retrievedString, "CELLULAR_PDP_AUTHENTICATION_NONE") == 0)
+    if ((pStore != NULL) &&
+        (cellular_profile_store_put(pStore, &profile) == RETURN_OK) &&
+        (cellular_profile_store_save(pStore, pPath) == RETURN_OK))
     {
-        profile.PDPAuthentication = CELLULAR_PDP_AUTHENTICATION_NONE;
+        UT_LOG_DEBUG("Profile %d saved to profile store %s", profile.ProfileID, pPath);
     }
-    else if (strcmp(retrievedString, "CELLULAR_PDP_AUTHENTICATION_PAP") == 0)
+    else
     {
-        profile.PDPAuthentication = CELLULAR_PDP_AUTHENTICATION_PAP;
+        UT_LOG_ERROR("Failed to save profile store %s", pPath);
     }
-    else if (strcmp(retrievedString, "CELLULAR_PDP_AUTHENTICATION_CHAP") == 0)
+    cellular_profile_store_destroy(pStore);
+}
+
+int test_cellular_hal_l1_register(void)
+{
+    char *pStorePath = NULL;
+    uint64_t startNs = 0;
+
+    // Create the test suite
+    pSuite = UT_add_suite("[L1_cellular_hal]", init_cellular_hal_init, teardown);
+    if (pSuite == NULL)
     {
-        profile.PDPAuthentication = CELLULAR_PDP_AUTHENTICATION_CHAP;
+        return -1;
     }
+    cellular_trace_set_test_id(&gTestGroup, &gTestID);
 
-    UT_KVP_PROFILE_GET_STRING("cellular.config.profile.PDPNetworkConfig", retrievedString);
-    if (strcmp(retrievedString, "CELLULAR_PDP_NETWORK_CONFIG_NAS") == 0)
+    pStorePath = getenv("CELLULAR_PROFILE_STORE");
+    startNs = cellular_bench_now_ns();
+    if (load_profile_from_store(pStorePath) == 0)
     {
-        profile.PDPNetworkConfig = CELLULAR_PDP_NETWORK_CONFIG_NAS;
+        UT_LOG_INFO("Profile loaded from store %s in %llu us", pStorePath,
+                    (unsigned long long)((cellular_bench_now_ns() - startNs) / 1000));
     }
-    else if (strcmp(retrievedString, "CELLULAR_PDP_NETWORK_CONFIG_DHCP") == 0)
+    else
     {
-        profile.PDPNetworkConfig = CELLULAR_PDP_NETWORK_CONFIG_DHCP;
+        load_profile_from_yaml();
+        UT_LOG_INFO("Profile loaded from YAML in %llu us",
+                    (unsigned long long)((cellular_bench_now_ns() - startNs) / 1000));
+        if (pStorePath != NULL)
+        {
+            save_profile_to_store(pStorePath);
+        }
     }
 
-    UT_KVP_PROFILE_GET_STRING("cellular.config.profile.ProfileName", retrievedString);
-    strncpy(profile.ProfileName, retrievedString, sizeof(profile.ProfileName));
-
-    UT_KVP_PROFILE_GET_STRING("cellular.config.profile.APN", retrievedString);
-    strncpy(profile.APN, retrievedString, sizeof(profile.APN));
-
-    UT_KVP_PROFILE_GET_STRING("cellular.config.profile.Username", retrievedString);
-    strncpy(profile.Username, retrievedString, sizeof(profile.Username));
-
-    UT_KVP_PROFILE_GET_STRING("cellular.config.profile.Password", retrievedString);
-    strncpy(profile.Password, retrievedString, sizeof(profile.Password));
-
-    UT_KVP_PROFILE_GET_STRING("cellular.config.profile.Proxy", retrievedString);
-    strncpy(profile.Proxy, retrievedString, sizeof(profile.Proxy));
-
-    profile.ProxyPort = UT_KVP_PROFILE_GET_UINT32("cellular.config.profile.ProxyPort");
-
-    UT_KVP_PROFILE_GET_STRING("cellular.config.profile.bIsNoRoaming", retrievedString);
-    profile.bIsNoRoaming = (retrievedString[0] == '1');
-
-    UT_KVP_PROFILE_GET_STRING("cellular.config.profile.bIsAPNDisabled", retrievedString);
-    profile.bIsAPNDisabled = (retrievedString[0] == '1');
-
-    UT_KVP_PROFILE_GET_STRING("cellular.config.profile.bIsThisDefaultProfile", retrievedString);
-    profile.bIsThisDefaultProfile = (retrievedString[0] == '1');
-
     UT_add_test(pSuite, "l1_cellular_hal_positive1_IsModemDevicePresent", test_l1_cellular_hal_positive1_IsModemDevicePresent);
     UT_add_test(pSuite, "l1_cellular_hal_positive1_init", test_l1_cellular_hal_positive1_init);
     UT_add_test(pSuite, "l1_cellular_hal_positive2_init", test_l1_cellular_hal_positive2_init);
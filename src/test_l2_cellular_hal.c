@@ -0,0 +1,3897 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:*
+ * Copyright 2023 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file test_l2_cellular_hal.c
+ * @page cellular_hal_l2 Level 2 Tests
+ *
+ * ## Module's Role
+ * This module includes Level 2 scenario and performance tests.
+ * They exercise sequences of cellular_hal APIs and measure the cost of the
+ * patterns consumers use on top of them.
+ *
+ * **Pre-Conditions:**  None@n
+ * **Dependencies:** None@n
+ *
+ * Tunables are read from the profile under `cellular.bench`; a missing key selects the default.
+ *
+ * Ref to API Definition specification documentation : [halSpec.md](../../../docs/halSpec.md)
+ */
+
+#include <ut.h>
+#include <ut_log.h>
+#include <pthread.h>
+#include <errno.h>
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <signal.h>
+#include <CUnit/CUnit.h>
+#include "cellular_hal.h"
+#include <ut_kvp_profile.h>
+#include "cellular_bench.h"
+#include "cellular_delta.h"
+#include "cellular_scan_index.h"
+#define CELLULAR_LOG_REPLACE_UT_LOG
+#include "cellular_log.h"
+#define CELLULAR_TRACE_HAL_CALLS
+#include "cellular_trace.h"
+#include "cellular_profile_store.h"
+#include "cellular_profile_compiler.h"
+#include "cellular_matrix.h"
+#include "cellular_sim.h"
+#include "cellular_perf.h"
+#include "cellular_syscall.h"
+#include "cellular_census.h"
+#include "cellular_lock.h"
+#include "cellular_metrics.h"
+#include "cellular_run.h"
+#include "cellular_sampler.h"
+#include "cellular_watchdog.h"
+#include "cellular_fuzz.h"
+#include "cellular_atmodem.h"
+#include "cellular_ctlmodem.h"
+#include "cellular_fork.h"
+
+static int gTestGroup = 2;
+static int gTestID = 1;
+
+/* Test profile loaded by the L1 registration */
+extern CellularProfileStruct profile;
+
+/* Returns the profile value for 'key', or 'defaultValue' when the key is absent */
+static uint32_t bench_config(const char *key, uint32_t defaultValue)
+{
+    uint32_t value = UT_KVP_PROFILE_GET_UINT32(key);
+
+    return (value == 0) ? defaultValue : value;
+}
+
+typedef struct
+{
+    unsigned int interval_ms;
+    volatile int stop;
+    uint64_t wakeups;
+    uint64_t useful;
+} PollConsumer_t;
+
+typedef struct
+{
+    cellular_delta_sub_t *pSub;
+    int stop_fd;
+    uint64_t wakeups;
+    uint64_t useful;
+} DeltaConsumer_t;
+
+/* Full polling consumer: reads both APIs every interval and compares with its own copy */
+static void *poll_consumer_thread(void *pArg)
+{
+    PollConsumer_t *pConsumer = (PollConsumer_t *)pArg;
+    CellularCurrentPlmnInfoStruct prev;
+    CellularCurrentPlmnInfoStruct cur;
+    CellularInterfaceStatus_t prevStatus = IF_UNKNOWN;
+    CellularInterfaceStatus_t curStatus = IF_UNKNOWN;
+
+    memset(&prev, 0, sizeof(prev));
+    while (!pConsumer->stop)
+    {
+        memset(&cur, 0, sizeof(cur));
+        cellular_hal_get_current_plmn_information(&cur);
+        cellular_hal_get_current_modem_interface_status(&curStatus);
+        pConsumer->wakeups++;
+        if ((pConsumer->wakeups == 1) || (cellular_delta_compare_plmn(&prev, &cur) != 0) || (prevStatus != curStatus))
+        {
+            pConsumer->useful++;
+        }
+        prev = cur;
+        prevStatus = curStatus;
+        cellular_bench_sleep_ms(pConsumer->interval_ms);
+    }
+    return NULL;
+}
+
+/* Delta consumer: sleeps in epoll until its eventfd or the stop eventfd becomes readable */
+static void *delta_consumer_thread(void *pArg)
+{
+    DeltaConsumer_t *pConsumer = (DeltaConsumer_t *)pArg;
+    CellularDeltaChange_t change;
+    struct epoll_event ev;
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    int got;
+
+    if (epfd < 0)
+    {
+        return NULL;
+    }
+    ev.events = EPOLLIN;
+    ev.data.fd = cellular_delta_subscriber_fd(pConsumer->pSub);
+    epoll_ctl(epfd, EPOLL_CTL_ADD, ev.data.fd, &ev);
+    ev.data.fd = pConsumer->stop_fd;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, ev.data.fd, &ev);
+
+    for (;;)
+    {
+        if (epoll_wait(epfd, &ev, 1, -1) <= 0)
+        {
+            continue;
+        }
+        if (ev.data.fd == pConsumer->stop_fd)
+        {
+            break;
+        }
+        pConsumer->wakeups++;
+        got = 0;
+        while (cellular_delta_read(pConsumer->pSub, &change))
+        {
+            got = 1;
+        }
+        pConsumer->useful += got;
+    }
+    close(epfd);
+    return NULL;
+}
+
+/* Runs 'consumers' epoll consumers against one delta engine, each subscribed to what a polling consumer reads, returns the number of consumers started */
+static unsigned int run_delta_phase(DeltaConsumer_t *pConsumers, pthread_t *pThreads, unsigned int consumers,
+                                    unsigned int interval_ms, unsigned int duration_ms)
+{
+    cellular_delta_t *pDelta = cellular_delta_create(interval_ms);
+    int stop_fd = eventfd(0, EFD_CLOEXEC);
+    unsigned int started = 0;
+    unsigned int i = 0;
+    uint64_t one = 1;
+
+    if ((pDelta == NULL) || (stop_fd < 0))
+    {
+        UT_LOG_ERROR("delta engine setup failed");
+        cellular_delta_destroy(pDelta);
+        if (stop_fd >= 0)
+        {
+            close(stop_fd);
+        }
+        return 0;
+    }
+
+    for (i = 0; i < consumers; i++)
+    {
+        pConsumers[i].pSub = cellular_delta_subscribe(pDelta, CELLULAR_DELTA_ALL);
+        pConsumers[i].stop_fd = stop_fd;
+        if ((pConsumers[i].pSub == NULL) ||
+            (pthread_create(&pThreads[i], NULL, delta_consumer_thread, &pConsumers[i]) != 0))
+        {
+            break;
+        }
+    }
+    started = i;
+
+    if (cellular_delta_start(pDelta) != RETURN_OK)
+    {
+        UT_LOG_ERROR("cellular_delta_start failed");
+    }
+    cellular_bench_sleep_ms(duration_ms);
+    if (write(stop_fd, &one, sizeof(one)) != (ssize_t)sizeof(one))
+    {
+        UT_LOG_ERROR("Failed to signal delta consumers");
+    }
+    for (i = 0; i < started; i++)
+    {
+        pthread_join(pThreads[i], NULL);
+    }
+    cellular_delta_destroy(pDelta);
+    close(stop_fd);
+    return started;
+}
+
+/**
+ * @brief Verify that the delta engine delivers the baseline reading and filters fields per subscriber
+ *
+ * The engine is polled twice by hand. The first poll establishes the baseline and must notify every
+ * subscriber; the changes seen by a subscriber must never contain fields outside its mask.
+ *
+ * **Test Group ID:** Module: 02 @n
+ * **Test Case ID:** 001 @n
+ * **Priority:** Medium @n@n
+ *
+ * **Pre-Conditions:** None @n
+ * **Dependencies:** None @n
+ * **User Interaction:** If user chose to run the test in interactive mode, then the test case has to be selected via console. @n
+ *
+ * **Test Procedure:** @n
+ * | Variation / Step | Description | Test Data | Expected Result | Notes |
+ * | :----: | :---------: | :----------: | :--------------: | :-----: |
+ * | 01 | Create a delta engine and subscribe for PLMN fields and for interface status | masks = PLMN_ALL, INTERFACE_STATUS | valid handles | Should be successful |
+ * | 02 | Poll the engine once | None | every field reported as changed, both eventfds signalled | Should be successful |
+ * | 03 | Drain both subscribers | None | only subscribed fields present | Should be successful |
+ * | 04 | Poll the engine again and drain | None | only subscribed fields present | Should be successful |
+ */
+void test_l2_cellular_hal_delta_notification(void)
+{
+    gTestID = 1;
+    UT_LOG_INFO("In %s [%02d%03d]\n", __FUNCTION__, gTestGroup, gTestID);
+
+    cellular_delta_t *pDelta = cellular_delta_create(10);
+    cellular_delta_sub_t *pPlmnSub = NULL;
+    cellular_delta_sub_t *pIfSub = NULL;
+    CellularDeltaChange_t change;
+    CellularDeltaStats_t stats;
+    int changed = 0;
+    int pass = 0;
+
+    if (pDelta == NULL)
+    {
+        UT_FAIL("cellular_delta_create failed");
+        return;
+    }
+    pPlmnSub = cellular_delta_subscribe(pDelta, CELLULAR_DELTA_PLMN_ALL);
+    pIfSub = cellular_delta_subscribe(pDelta, CELLULAR_DELTA_INTERFACE_STATUS);
+    UT_ASSERT_PTR_NOT_NULL(pPlmnSub);
+    UT_ASSERT_PTR_NOT_NULL(pIfSub);
+
+    for (pass = 0; (pass < 2) && (pPlmnSub != NULL) && (pIfSub != NULL); pass++)
+    {
+        changed = cellular_delta_poll_once(pDelta);
+        UT_LOG_DEBUG("Poll %d changed mask: 0x%x", pass, changed);
+        if (pass == 0)
+        {
+            UT_ASSERT_EQUAL(changed, CELLULAR_DELTA_ALL);
+        }
+        while (cellular_delta_read(pPlmnSub, &change))
+        {
+            UT_ASSERT_EQUAL(change.changed & ~(uint32_t)CELLULAR_DELTA_PLMN_ALL, 0);
+        }
+        while (cellular_delta_read(pIfSub, &change))
+        {
+            UT_ASSERT_EQUAL(change.changed & ~(uint32_t)CELLULAR_DELTA_INTERFACE_STATUS, 0);
+        }
+    }
+
+    cellular_delta_get_stats(pDelta, &stats);
+    UT_LOG_DEBUG("polls: %llu errors: %llu changes: %llu notifications: %llu", (unsigned long long)stats.polls,
+                 (unsigned long long)stats.poll_errors, (unsigned long long)stats.changes, (unsigned long long)stats.notifications);
+    UT_ASSERT_EQUAL(stats.polls, 2);
+    cellular_delta_destroy(pDelta);
+
+    UT_LOG_INFO("Out %s\n", __FUNCTION__);
+}
+
+/**
+ * @brief Measure consumer wakeups and CPU time of full polling against delta notification
+ *
+ * N consumers first poll cellular_hal_get_current_plmn_information() and
+ * cellular_hal_get_current_modem_interface_status() themselves at a fixed interval. The same N
+ * consumers then wait in epoll on a delta engine subscription polling at the same interval.
+ * Wakeups, wakeups which carried a change, and process CPU time are reported for both phases.
+ *
+ * **Test Group ID:** Module: 02 @n
+ * **Test Case ID:** 002 @n
+ * **Priority:** Low @n@n
+ *
+ * **Pre-Conditions:** None @n
+ * **Dependencies:** None @n
+ * **User Interaction:** If user chose to run the test in interactive mode, then the test case has to be selected via console. @n
+ *
+ * **Test Procedure:** @n
+ * | Variation / Step | Description | Test Data | Expected Result | Notes |
+ * | :----: | :---------: | :----------: | :--------------: | :-----: |
+ * | 01 | Run N polling consumers for the configured duration | cellular.bench.delta.consumers, interval_ms, duration_ms | wakeups and CPU recorded | Should be successful |
+ * | 02 | Run N epoll consumers on a delta engine, subscribed to every field the polling consumers read, for the same duration | same | wakeups and CPU recorded | Should be successful |
+ * | 03 | Compare the phases | None | delta wakeups <= polling wakeups, no spurious wakeups | Should be successful |
+ */
+void test_l2_cellular_hal_delta_benchmark(void)
+{
+    gTestID = 2;
+    UT_LOG_INFO("In %s [%02d%03d]\n", __FUNCTION__, gTestGroup, gTestID);
+
+    unsigned int consumers = bench_config("cellular.bench.delta.consumers", 4);
+    unsigned int interval_ms = bench_config("cellular.bench.delta.interval_ms", 10);
+    unsigned int duration_ms = bench_config("cellular.bench.delta.duration_ms", 1000);
+    PollConsumer_t *pPoll = (PollConsumer_t *)calloc(consumers, sizeof(PollConsumer_t));
+    DeltaConsumer_t *pDeltaConsumers = (DeltaConsumer_t *)calloc(consumers, sizeof(DeltaConsumer_t));
+    pthread_t *pThreads = (pthread_t *)calloc(consumers, sizeof(pthread_t));
+    uint64_t pollWakeups = 0, pollUseful = 0, pollCpu = 0;
+    uint64_t deltaWakeups = 0, deltaUseful = 0, deltaCpu = 0;
+    uint64_t cpuStart = 0;
+    unsigned int i = 0;
+    unsigned int started = 0;
+    unsigned int pass;
+
+    if ((pPoll == NULL) || (pDeltaConsumers == NULL) || (pThreads == NULL))
+    {
+        UT_LOG_DEBUG("Malloc operation failed");
+        UT_FAIL("Memory allocation with malloc failed");
+        free(pPoll);
+        free(pDeltaConsumers);
+        free(pThreads);
+        return;
+    }
+
+    /* The passes before the last are warm-up */
+    for (pass = 0; pass <= cellular_run_warmup(); pass++)
+    {
+        memset(pPoll, 0, consumers * sizeof(PollConsumer_t));
+        memset(pDeltaConsumers, 0, consumers * sizeof(DeltaConsumer_t));
+        pollWakeups = pollUseful = deltaWakeups = deltaUseful = 0;
+
+        UT_LOG_DEBUG("Polling phase: %u consumers, interval %u ms, duration %u ms", consumers, interval_ms, duration_ms);
+        cpuStart = cellular_bench_process_cpu_ns();
+        for (i = 0; i < consumers; i++)
+        {
+            pPoll[i].interval_ms = interval_ms;
+            if (pthread_create(&pThreads[i], NULL, poll_consumer_thread, &pPoll[i]) != 0)
+            {
+                break;
+            }
+        }
+        started = i;
+        cellular_bench_sleep_ms(duration_ms);
+        for (i = 0; i < started; i++)
+        {
+            pPoll[i].stop = 1;
+        }
+        for (i = 0; i < started; i++)
+        {
+            pthread_join(pThreads[i], NULL);
+            pollWakeups += pPoll[i].wakeups;
+            pollUseful += pPoll[i].useful;
+        }
+        pollCpu = cellular_bench_process_cpu_ns() - cpuStart;
+        UT_ASSERT_EQUAL(started, consumers);
+
+        UT_LOG_DEBUG("Delta phase: %u consumers, engine interval %u ms, duration %u ms", consumers, interval_ms, duration_ms);
+        cpuStart = cellular_bench_process_cpu_ns();
+        started = run_delta_phase(pDeltaConsumers, pThreads, consumers, interval_ms, duration_ms);
+        deltaCpu = cellular_bench_process_cpu_ns() - cpuStart;
+        UT_ASSERT_EQUAL(started, consumers);
+        for (i = 0; i < started; i++)
+        {
+            deltaWakeups += pDeltaConsumers[i].wakeups;
+            deltaUseful += pDeltaConsumers[i].useful;
+        }
+    }
+
+    UT_LOG_INFO("Polling : wakeups %llu useful %llu cpu %llu us", (unsigned long long)pollWakeups,
+                (unsigned long long)pollUseful, (unsigned long long)(pollCpu / 1000));
+    UT_LOG_INFO("Delta   : wakeups %llu useful %llu cpu %llu us", (unsigned long long)deltaWakeups,
+                (unsigned long long)deltaUseful, (unsigned long long)(deltaCpu / 1000));
+    if (pollWakeups > 0)
+    {
+        UT_LOG_INFO("Wakeups saved: %.1f%%", 100.0 * (double)(pollWakeups - (deltaWakeups < pollWakeups ? deltaWakeups : pollWakeups)) / (double)pollWakeups);
+    }
+    if (pollCpu > 0)
+    {
+        UT_LOG_INFO("CPU saved: %.1f%%", 100.0 * ((double)pollCpu - (double)deltaCpu) / (double)pollCpu);
+    }
+    cellular_metrics_set("consumer_wakeups", "Wakeups of all consumers during the run", "polling", (double)pollWakeups);
+    cellular_metrics_set("consumer_wakeups", "Wakeups of all consumers during the run", "delta", (double)deltaWakeups);
+    cellular_metrics_set("consumer_cpu_seconds", "Process CPU time during the run", "polling", (double)pollCpu / 1e9);
+    cellular_metrics_set("consumer_cpu_seconds", "Process CPU time during the run", "delta", (double)deltaCpu / 1e9);
+    UT_ASSERT_TRUE(deltaWakeups <= pollWakeups);
+    UT_ASSERT_EQUAL(deltaWakeups, deltaUseful);
+
+    free(pPoll);
+    free(pDeltaConsumers);
+    free(pThreads);
+    UT_LOG_INFO("Out %s\n", __FUNCTION__);
+}
+
+/* Deterministic generator so benchmark inputs are identical between runs */
+static uint32_t bench_rand(uint32_t *pState)
+{
+    *pState = (*pState * 1103515245u) + 12345u;
+    return (*pState >> 8) & 0xFFFFFFu;
+}
+
+static void fill_scan(CellularNetworkScanResultInfoStruct *pResults, unsigned int count, uint32_t *pSeed)
+{
+    unsigned int i;
+
+    for (i = 0; i < count; i++)
+    {
+        memset(&pResults[i], 0, sizeof(pResults[i]));
+        pResults[i].MCC = 200 + (bench_rand(pSeed) % 600);
+        pResults[i].MNC = bench_rand(pSeed) % 1000;
+        pResults[i].network_allowed_flag = (bench_rand(pSeed) & 1) ? TRUE : FALSE;
+        snprintf(pResults[i].network_name, sizeof(pResults[i].network_name), "PLMN %03u-%03u", pResults[i].MCC, pResults[i].MNC);
+    }
+}
+
+/**
+ * @brief Verify that the scan index merges HAL scan results, ages out stale entries and stays bounded
+ *
+ * **Test Group ID:** Module: 02 @n
+ * **Test Case ID:** 003 @n
+ * **Priority:** Medium @n@n
+ *
+ * **Pre-Conditions:** None @n
+ * **Dependencies:** None @n
+ * **User Interaction:** If user chose to run the test in interactive mode, then the test case has to be selected via console. @n
+ *
+ * **Test Procedure:** @n
+ * | Variation / Step | Description | Test Data | Expected Result | Notes |
+ * | :----: | :---------: | :----------: | :--------------: | :-----: |
+ * | 01 | Invoke cellular_hal_get_available_networks_information and merge the result | rat = current RAT | every returned PLMN visible, allowed flag preserved | Should be successful |
+ * | 02 | Merge max_age_scans empty scans | count = 0 | index is empty | Should be successful |
+ * | 03 | Merge many random scans larger than the capacity | seed = fixed | entries never exceed capacity | Should be successful |
+ * | 04 | Merge random subsets of a pool of PLMNs smaller than the capacity into a new index | seed = fixed | a PLMN is visible exactly when one of the last max_age_scans scans reported it | Should be successful |
+ */
+void test_l2_cellular_hal_scan_index_merge(void)
+{
+    gTestID = 3;
+    UT_LOG_INFO("In %s [%02d%03d]\n", __FUNCTION__, gTestGroup, gTestID);
+
+    const unsigned int capacity = 64;
+    const unsigned int maxAge = 3;
+    cellular_scan_index_t *pIndex = cellular_scan_index_create(capacity, maxAge);
+    CellularNetworkScanResultInfoStruct *network_info = NULL;
+    CellularNetworkScanResultInfoStruct synthetic[32];
+    CellularScanIndexStats_t stats;
+    uint64_t reported[4];    /* PLMNs of the pool in each of the last maxAge + 1 scans */
+    uint64_t recent;
+    unsigned int j, count;
+    int visible;
+    int failed = 0;
+    char current_rat[128] = {"\0"};
+    CellularRat_t rat = CELLULAR_RAT_UNKNOWN;
+    unsigned int total_network_count = 0;
+    unsigned int i = 0;
+    uint32_t seed = 1;
+    int status = 0;
+
+    if (pIndex == NULL)
+    {
+        UT_FAIL("cellular_scan_index_create failed");
+        return;
+    }
+
+    UT_LOG_DEBUG("Invoking cellular_hal_get_available_networks_information");
+    status = cellular_hal_get_available_networks_information(&network_info, &total_network_count);
+    UT_LOG_DEBUG("Return Status : %d, total_network_count : %u", status, total_network_count);
+    UT_ASSERT_EQUAL(status, RETURN_OK);
+    if (cellular_hal_get_modem_current_radio_technology(current_rat) == RETURN_OK)
+    {
+        rat = cellular_rat_from_string(current_rat);
+    }
+    if (network_info != NULL)
+    {
+        UT_ASSERT_TRUE(cellular_scan_index_merge(pIndex, network_info, total_network_count, rat) >= 0);
+        for (i = 0; i < total_network_count; i++)
+        {
+            UT_ASSERT_EQUAL(cellular_scan_index_is_visible(pIndex, network_info[i].MCC, network_info[i].MNC, rat), 1);
+            UT_ASSERT_EQUAL(cellular_scan_index_is_visible(pIndex, network_info[i].MCC, network_info[i].MNC, CELLULAR_RAT_UNKNOWN), 1);
+        }
+        free(network_info);
+    }
+
+    for (i = 0; i < maxAge; i++)
+    {
+        cellular_scan_index_merge(pIndex, NULL, 0, rat);
+    }
+    cellular_scan_index_get_stats(pIndex, &stats);
+    UT_LOG_DEBUG("After %u empty scans: entries %u aged_out %llu", maxAge, stats.entries, (unsigned long long)stats.aged_out);
+    UT_ASSERT_EQUAL(stats.entries, 0);
+
+    for (i = 0; i < 1000; i++)
+    {
+        fill_scan(synthetic, sizeof(synthetic) / sizeof(synthetic[0]), &seed);
+        cellular_scan_index_merge(pIndex, synthetic, sizeof(synthetic) / sizeof(synthetic[0]), (CellularRat_t)(CELLULAR_RAT_GSM + (i % 4)));
+        cellular_scan_index_get_stats(pIndex, &stats);
+        if (stats.entries > capacity)
+        {
+            break;
+        }
+    }
+    UT_LOG_DEBUG("After %u scans: entries %u inserts %llu aged_out %llu replaced %llu", stats.scans, stats.entries,
+                 (unsigned long long)stats.inserts, (unsigned long long)stats.aged_out, (unsigned long long)stats.replaced);
+    UT_ASSERT_TRUE(stats.entries <= capacity);
+    for (i = 0; i < sizeof(synthetic) / sizeof(synthetic[0]); i++)
+    {
+        UT_ASSERT_EQUAL(cellular_scan_index_is_allowed(pIndex, synthetic[i].MCC, synthetic[i].MNC, CELLULAR_RAT_UNKNOWN),
+                        (synthetic[i].network_allowed_flag == TRUE) ? 1 : 0);
+    }
+    cellular_scan_index_destroy(pIndex);
+
+    /* Nothing is replaced, so every entry leaves by ageing, including those the backward shift wrapped to the start of the table */
+    pIndex = cellular_scan_index_create(capacity, maxAge);
+    if (pIndex == NULL)
+    {
+        UT_FAIL("cellular_scan_index_create failed");
+        return;
+    }
+    memset(reported, 0, sizeof(reported));
+    for (i = 0; (i < 1000) && !failed; i++)
+    {
+        count = 0;
+        reported[i % 4] = 0;
+        for (j = 0; j < 48; j++)
+        {
+            if ((bench_rand(&seed) % 3) == 0)
+            {
+                memset(&synthetic[count], 0, sizeof(synthetic[count]));
+                synthetic[count].MCC = 310 + j;
+                synthetic[count].MNC = j * 7;
+                reported[i % 4] |= 1ULL << j;
+                count++;
+            }
+            if (count == sizeof(synthetic) / sizeof(synthetic[0]))
+            {
+                break;
+            }
+        }
+        cellular_scan_index_merge(pIndex, synthetic, count, CELLULAR_RAT_LTE);
+        recent = reported[i % 4] | reported[(i + 3) % 4] | reported[(i + 2) % 4];
+        for (j = 0; (j < 48) && !failed; j++)
+        {
+            visible = cellular_scan_index_is_visible(pIndex, 310 + j, j * 7, CELLULAR_RAT_UNKNOWN);
+            if (visible != (int)((recent >> j) & 1))
+            {
+                UT_LOG_ERROR("Scan %u: PLMN %03u-%03u visible %d, reported in the last %u scans %d", i, 310 + j, j * 7, visible, maxAge,
+                             !visible);
+                UT_FAIL("entry visibility does not follow the last max_age_scans scans");
+                failed = 1;
+            }
+        }
+    }
+    cellular_scan_index_get_stats(pIndex, &stats);
+    UT_LOG_DEBUG("After %u scans of a pool of 48: entries %u aged_out %llu replaced %llu", stats.scans, stats.entries,
+                 (unsigned long long)stats.aged_out, (unsigned long long)stats.replaced);
+    UT_ASSERT_EQUAL(stats.replaced, 0);
+
+    cellular_scan_index_destroy(pIndex);
+    UT_LOG_INFO("Out %s\n", __FUNCTION__);
+}
+
+/**
+ * @brief Compare PLMN lookups in the scan index against a linear search of the scan arrays
+ *
+ * **Test Group ID:** Module: 02 @n
+ * **Test Case ID:** 004 @n
+ * **Priority:** Low @n@n
+ *
+ * **Pre-Conditions:** None @n
+ * **Dependencies:** None @n
+ * **User Interaction:** If user chose to run the test in interactive mode, then the test case has to be selected via console. @n
+ *
+ * **Test Procedure:** @n
+ * | Variation / Step | Description | Test Data | Expected Result | Notes |
+ * | :----: | :---------: | :----------: | :--------------: | :-----: |
+ * | 01 | Build scans of random PLMNs and merge them into an index | cellular.bench.scan_index.networks, scans, lookups | index populated | Should be successful |
+ * | 02 | Answer the same lookups by linear search and by index | None | both give identical answers, ns per lookup reported | Should be successful |
+ */
+void test_l2_cellular_hal_scan_index_benchmark(void)
+{
+    gTestID = 4;
+    UT_LOG_INFO("In %s [%02d%03d]\n", __FUNCTION__, gTestGroup, gTestID);
+
+    unsigned int networks = bench_config("cellular.bench.scan_index.networks", 64);
+    unsigned int scans = bench_config("cellular.bench.scan_index.scans", 8);
+    unsigned int lookups = bench_config("cellular.bench.scan_index.lookups", 100000);
+    unsigned int total = networks * scans;
+    CellularNetworkScanResultInfoStruct *pAll = (CellularNetworkScanResultInfoStruct *)calloc(total, sizeof(CellularNetworkScanResultInfoStruct));
+    cellular_scan_index_t *pIndex = cellular_scan_index_create(total, 0);
+    CellularScanIndexStats_t stats;
+    uint32_t seed = 7;
+    uint32_t querySeed = 0;
+    uint64_t start = 0, linearNs = 0, indexNs = 0;
+    unsigned int linearHits = 0, indexHits = 0;
+    unsigned int i = 0, j = 0, mcc = 0, mnc = 0, pass = 0;
+
+    if ((pAll == NULL) || (pIndex == NULL))
+    {
+        UT_LOG_DEBUG("Malloc operation failed");
+        UT_FAIL("Memory allocation with malloc failed");
+        free(pAll);
+        cellular_scan_index_destroy(pIndex);
+        return;
+    }
+
+    fill_scan(pAll, total, &seed);
+    for (i = 0; i < scans; i++)
+    {
+        cellular_scan_index_merge(pIndex, &pAll[i * networks], networks, CELLULAR_RAT_LTE);
+    }
+
+    /* Half of the queries hit a known PLMN, the other half are random; the passes before the last are warm-up */
+    for (pass = 0; pass <= cellular_run_warmup(); pass++)
+    {
+        linearHits = 0;
+        indexHits = 0;
+        querySeed = 99;
+        start = cellular_bench_now_ns();
+        for (i = 0; i < lookups; i++)
+        {
+            j = bench_rand(&querySeed) % total;
+            mcc = (i & 1) ? pAll[j].MCC : 200 + (j % 600);
+            mnc = (i & 1) ? pAll[j].MNC : j % 1000;
+            for (j = 0; j < total; j++)
+            {
+                if ((pAll[j].MCC == mcc) && (pAll[j].MNC == mnc))
+                {
+                    linearHits++;
+                    break;
+                }
+            }
+        }
+        linearNs = cellular_bench_now_ns() - start;
+
+        querySeed = 99;
+        start = cellular_bench_now_ns();
+        for (i = 0; i < lookups; i++)
+        {
+            j = bench_rand(&querySeed) % total;
+            mcc = (i & 1) ? pAll[j].MCC : 200 + (j % 600);
+            mnc = (i & 1) ? pAll[j].MNC : j % 1000;
+            indexHits += cellular_scan_index_is_visible(pIndex, mcc, mnc, CELLULAR_RAT_LTE);
+        }
+        indexNs = cellular_bench_now_ns() - start;
+    }
+
+    cellular_scan_index_get_stats(pIndex, &stats);
+    UT_LOG_INFO("Scan index: %u networks x %u scans, %u entries, mean probe length %.2f", networks, scans, stats.entries,
+                (stats.lookups > 0) ? (double)stats.probes / (double)stats.lookups : 0.0);
+    UT_LOG_INFO("Linear search: %.1f ns/lookup, index: %.1f ns/lookup, hits %u/%u", (double)linearNs / lookups,
+                (double)indexNs / lookups, linearHits, indexHits);
+    cellular_metrics_set("lookup_seconds", "Time per PLMN visibility lookup", "linear", (double)linearNs / lookups / 1e9);
+    cellular_metrics_set("lookup_seconds", "Time per PLMN visibility lookup", "index", (double)indexNs / lookups / 1e9);
+    UT_ASSERT_EQUAL(linearHits, indexHits);
+
+    cellular_scan_index_destroy(pIndex);
+    free(pAll);
+    UT_LOG_INFO("Out %s\n", __FUNCTION__);
+}
+
+/* Creates an empty temporary file path for a profile store, returns 0 on success */
+static int make_store_path(char *pPath, size_t length)
+{
+    int fd;
+
+    snprintf(pPath, length, "/tmp/cellular_profile_store_XXXXXX");
+    fd = mkstemp(pPath);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    close(fd);
+    return 0;
+}
+
+/**
+ * @brief Verify save, map and load of the profile store and its ProfileID and APN indices
+ *
+ * **Test Group ID:** Module: 02 @n
+ * **Test Case ID:** 005 @n
+ * **Priority:** Medium @n@n
+ *
+ * **Pre-Conditions:** None @n
+ * **Dependencies:** None @n
+ * **User Interaction:** If user chose to run the test in interactive mode, then the test case has to be selected via console. @n
+ *
+ * **Test Procedure:** @n
+ * | Variation / Step | Description | Test Data | Expected Result | Notes |
+ * | :----: | :---------: | :----------: | :--------------: | :-----: |
+ * | 01 | Put the test profile and derived profiles with distinct ProfileID and APN into a store | count = 16 | RETURN_OK | Should be successful |
+ * | 02 | Save the store and map the file | temporary file | RETURN_OK | Should be successful |
+ * | 03 | Look up every profile by ProfileID and APN in the mapped file | None | identical profiles | Should be successful |
+ * | 04 | Load the file into a second store | None | identical profiles | Should be successful |
+ * | 05 | Flip one byte of the file and map it again | None | RETURN_ERROR | Should be rejected |
+ */
+void test_l2_cellular_hal_profile_store_persistence(void)
+{
+    gTestID = 5;
+    UT_LOG_INFO("In %s [%02d%03d]\n", __FUNCTION__, gTestGroup, gTestID);
+
+    const unsigned int count = 16;
+    cellular_profile_store_t *pStore = cellular_profile_store_create();
+    cellular_profile_store_t *pLoaded = cellular_profile_store_create();
+    const CellularProfileStruct *pFound = NULL;
+    CellularProfileFileView_t view;
+    CellularProfileStruct entry;
+    char path[64];
+    unsigned int i = 0;
+    FILE *pFile = NULL;
+
+    if ((pStore == NULL) || (pLoaded == NULL) || (make_store_path(path, sizeof(path)) != 0))
+    {
+        UT_FAIL("profile store setup failed");
+        cellular_profile_store_destroy(pStore);
+        cellular_profile_store_destroy(pLoaded);
+        return;
+    }
+
+    /* Insert in descending ProfileID order so the index has to sort */
+    for (i = count; i > 0; i--)
+    {
+        entry = profile;
+        entry.ProfileID = profile.ProfileID + (int)i - 1;
+        snprintf(entry.APN, sizeof(entry.APN), "%.48s%u", profile.APN, count - i);
+        entry.bIsThisDefaultProfile = (i == 1);
+        UT_ASSERT_EQUAL(cellular_profile_store_put(pStore, &entry), RETURN_OK);
+    }
+    UT_ASSERT_EQUAL(cellular_profile_store_count(pStore), count);
+    UT_ASSERT_EQUAL(cellular_profile_store_save(pStore, path), RETURN_OK);
+
+    UT_ASSERT_EQUAL(cellular_profile_file_map(path, &view), RETURN_OK);
+    UT_ASSERT_EQUAL(view.count, count);
+    for (i = 0; i < cellular_profile_store_count(pStore); i++)
+    {
+        const CellularProfileStruct *pExpected = cellular_profile_store_at(pStore, i);
+
+        pFound = cellular_profile_file_find_by_id(&view, pExpected->ProfileID);
+        UT_ASSERT_TRUE((pFound != NULL) && cellular_profile_equal(pFound, pExpected));
+        pFound = cellular_profile_file_find_by_apn(&view, pExpected->APN);
+        UT_ASSERT_TRUE((pFound != NULL) && cellular_profile_equal(pFound, pExpected));
+    }
+    cellular_profile_file_unmap(&view);
+
+    UT_ASSERT_EQUAL(cellular_profile_store_load(pLoaded, path), RETURN_OK);
+    UT_ASSERT_EQUAL(cellular_profile_store_count(pLoaded), count);
+    for (i = 0; i < cellular_profile_store_count(pLoaded); i++)
+    {
+        UT_ASSERT_TRUE(cellular_profile_equal(cellular_profile_store_at(pLoaded, i), cellular_profile_store_at(pStore, i)));
+    }
+    pFound = cellular_profile_store_default(pLoaded);
+    UT_ASSERT_TRUE((pFound != NULL) && (pFound->ProfileID == profile.ProfileID));
+
+    pFile = fopen(path, "r+b");
+    if (pFile != NULL)
+    {
+        fseek(pFile, -1, SEEK_END);
+        fputc(0x5A, pFile);
+        fclose(pFile);
+        UT_ASSERT_EQUAL(cellular_profile_file_map(path, &view), RETURN_ERROR);
+    }
+
+    unlink(path);
+    cellular_profile_store_destroy(pStore);
+    cellular_profile_store_destroy(pLoaded);
+    UT_LOG_INFO("Out %s\n", __FUNCTION__);
+}
+
+static int profile_status_cb(char *profile_id, CellularProfileType_t profile_type, CellularDeviceProfileSelectionStatus_t device_profile_status)
+{
+    UT_LOG_DEBUG("Profile status callback: profile_id %s type %d status %d", (profile_id != NULL) ? profile_id : "NULL", profile_type, device_profile_status);
+    return RETURN_OK;
+}
+
+/**
+ * @brief Verify that syncing the profile store with the HAL only touches profiles that differ
+ *
+ * **Test Group ID:** Module: 02 @n
+ * **Test Case ID:** 006 @n
+ * **Priority:** Medium @n@n
+ *
+ * **Pre-Conditions:** None @n
+ * **Dependencies:** None @n
+ * **User Interaction:** If user chose to run the test in interactive mode, then the test case has to be selected via console. @n
+ *
+ * **Test Procedure:** @n
+ * | Variation / Step | Description | Test Data | Expected Result | Notes |
+ * | :----: | :---------: | :----------: | :--------------: | :-----: |
+ * | 01 | Sync a store holding the test profile | allowDelete = 0 | RETURN_OK, every profile accounted for | Should be successful |
+ * | 02 | Sync the same store again | allowDelete = 0 | no more create/modify calls than the first sync | Should be successful |
+ */
+void test_l2_cellular_hal_profile_store_sync(void)
+{
+    gTestID = 6;
+    UT_LOG_INFO("In %s [%02d%03d]\n", __FUNCTION__, gTestGroup, gTestID);
+
+    cellular_profile_store_t *pStore = cellular_profile_store_create();
+    CellularProfileSyncResult_t first;
+    CellularProfileSyncResult_t second;
+    int status = 0;
+
+    if ((pStore == NULL) || (cellular_profile_store_put(pStore, &profile) != RETURN_OK))
+    {
+        UT_FAIL("profile store setup failed");
+        cellular_profile_store_destroy(pStore);
+        return;
+    }
+
+    status = cellular_profile_store_sync(pStore, profile_status_cb, 0, &first);
+    UT_LOG_DEBUG("First sync: status %d created %u modified %u deleted %u unchanged %u failed %u", status,
+                 first.created, first.modified, first.deleted, first.unchanged, first.failed);
+    UT_ASSERT_EQUAL(status, RETURN_OK);
+    UT_ASSERT_EQUAL(first.created + first.modified + first.unchanged, cellular_profile_store_count(pStore));
+
+    status = cellular_profile_store_sync(pStore, profile_status_cb, 0, &second);
+    UT_LOG_DEBUG("Second sync: status %d created %u modified %u deleted %u unchanged %u failed %u", status,
+                 second.created, second.modified, second.deleted, second.unchanged, second.failed);
+    UT_ASSERT_EQUAL(status, RETURN_OK);
+    UT_ASSERT_TRUE((second.created + second.modified) <= (first.created + first.modified));
+
+    cellular_profile_store_destroy(pStore);
+    UT_LOG_INFO("Out %s\n", __FUNCTION__);
+}
+
+/**
+ * @brief Verify the compiled profile file and compare its startup cost with YAML parsing
+ *
+ * **Test Group ID:** Module: 02 @n
+ * **Test Case ID:** 007 @n
+ * **Priority:** Low @n@n
+ *
+ * **Pre-Conditions:** None @n
+ * **Dependencies:** None @n
+ * **User Interaction:** If user chose to run the test in interactive mode, then the test case has to be selected via console. @n
+ *
+ * **Test Procedure:** @n
+ * | Variation / Step | Description | Test Data | Expected Result | Notes |
+ * | :----: | :---------: | :----------: | :--------------: | :-----: |
+ * | 01 | Check every enum name maps to a value and back | None | names round trip, unknown name is RETURN_ERROR | Should be successful |
+ * | 02 | Compile the YAML profiles into a temporary file | None | RETURN_OK, at least one profile | Should be successful |
+ * | 03 | Map the file and find the test profile | None | profile equal to the one read from YAML | Should be successful |
+ * | 04 | Resolve the profiles from YAML and from the mapped file repeatedly | cellular.bench.profile_compiler.loads | us per load reported for both | Should be successful |
+ */
+void test_l2_cellular_hal_profile_compiler(void)
+{
+    gTestID = 7;
+    UT_LOG_INFO("In %s [%02d%03d]\n", __FUNCTION__, gTestGroup, gTestID);
+
+    static const char *fields[] = { "ProfileType", "PDPType", "PDPAuthentication", "PDPNetworkConfig" };
+    unsigned int loads = bench_config("cellular.bench.profile_compiler.loads", 100);
+    const CellularProfileStruct *pFound = NULL;
+    CellularProfileFileView_t view;
+    CellularProfileStruct fromYaml;
+    CellularProfileStruct copy;
+    const char *pName = NULL;
+    char path[64];
+    char prefix[64];
+    unsigned int count = 0;
+    unsigned int listCount = ut_kvp_getListCount(ut_kvp_profile_getInstance(), CELLULAR_PROFILE_LIST_KEY);
+    unsigned int i = 0, f = 0, pass = 0;
+    int value = 0;
+    uint64_t start = 0, yamlNs = 0, fileNs = 0;
+
+    for (f = 0; f < sizeof(fields) / sizeof(fields[0]); f++)
+    {
+        /* Every enum of the HAL profile has fewer than 8 values */
+        for (i = 0; i < 8; i++)
+        {
+            pName = cellular_profile_enum_to_string(fields[f], (int)i);
+            if (pName != NULL)
+            {
+                UT_ASSERT_EQUAL(cellular_profile_enum_from_string(fields[f], pName, &value), RETURN_OK);
+                UT_ASSERT_EQUAL(value, (int)i);
+            }
+        }
+    }
+    UT_ASSERT_EQUAL(cellular_profile_enum_from_string("PDPType", "CELLULAR_PDP_TYPE_X25", &value), RETURN_ERROR);
+
+    if (make_store_path(path, sizeof(path)) != 0)
+    {
+        UT_FAIL("temporary file creation failed");
+        return;
+    }
+    UT_ASSERT_EQUAL(cellular_profile_compile(path, &count), RETURN_OK);
+    UT_ASSERT_TRUE(count >= 1);
+    UT_ASSERT_EQUAL(cellular_profile_from_kvp(CELLULAR_PROFILE_CONFIG_KEY, &fromYaml), RETURN_OK);
+
+    if (cellular_profile_file_map(path, &view) != RETURN_OK)
+    {
+        UT_FAIL("compiled profile file could not be mapped");
+        unlink(path);
+        return;
+    }
+    pFound = cellular_profile_file_find_by_id(&view, fromYaml.ProfileID);
+    UT_ASSERT_TRUE((pFound != NULL) && cellular_profile_equal(pFound, &fromYaml));
+    cellular_profile_file_unmap(&view);
+
+    /* One load = every profile resolved to a CellularProfileStruct, as done at startup; the last pass is timed */
+    for (pass = 0; pass <= cellular_run_warmup(); pass++)
+    {
+        start = cellular_bench_now_ns();
+        for (i = 0; i < loads; i++)
+        {
+            cellular_profile_from_kvp(CELLULAR_PROFILE_CONFIG_KEY, &copy);
+            for (f = 0; f < listCount; f++)
+            {
+                snprintf(prefix, sizeof(prefix), "%s.%u", CELLULAR_PROFILE_LIST_KEY, f);
+                cellular_profile_from_kvp(prefix, &copy);
+            }
+        }
+        yamlNs = cellular_bench_now_ns() - start;
+
+        start = cellular_bench_now_ns();
+        for (i = 0; i < loads; i++)
+        {
+            if (cellular_profile_file_map(path, &view) != RETURN_OK)
+            {
+                break;
+            }
+            for (f = 0; f < view.count; f++)
+            {
+                copy = view.pRecords[f];
+            }
+            cellular_profile_file_unmap(&view);
+        }
+        fileNs = cellular_bench_now_ns() - start;
+    }
+    UT_ASSERT_EQUAL(i, loads);
+
+    UT_LOG_INFO("Profile load of %u profiles: YAML %.1f us, compiled file %.1f us", count,
+                (double)yamlNs / loads / 1000.0, (double)fileNs / loads / 1000.0);
+    cellular_metrics_set("profile_load_seconds", "Time to load every test profile", "yaml", (double)yamlNs / loads / 1e9);
+    cellular_metrics_set("profile_load_seconds", "Time to load every test profile", "compiled", (double)fileNs / loads / 1e9);
+
+    unlink(path);
+    UT_LOG_INFO("Out %s\n", __FUNCTION__);
+}
+
+/*
+ * Profiles of the matrix run: CELLULAR_PROFILE_MATRIX selects "cartesian" (the default, every
+ * PDP combination of the test profile), "list" (the YAML profiles) or a profile store file
+ */
+static unsigned int load_matrix_profiles(CellularProfileStruct **ppProfiles)
+{
+    const char *pSource = getenv("CELLULAR_PROFILE_MATRIX");
+    CellularProfileFileView_t view;
+    unsigned int listCount = 0;
+    unsigned int count = 0;
+    unsigned int i = 0;
+    char prefix[64];
+
+    if ((pSource == NULL) || (strcmp(pSource, "cartesian") == 0))
+    {
+        return cellular_matrix_cartesian(&profile, ppProfiles);
+    }
+    if (strcmp(pSource, "list") == 0)
+    {
+        listCount = ut_kvp_getListCount(ut_kvp_profile_getInstance(), CELLULAR_PROFILE_LIST_KEY);
+        *ppProfiles = (CellularProfileStruct *)calloc(listCount + 1, sizeof(CellularProfileStruct));
+        if (*ppProfiles == NULL)
+        {
+            return 0;
+        }
+        (*ppProfiles)[count++] = profile;
+        for (i = 0; i < listCount; i++)
+        {
+            snprintf(prefix, sizeof(prefix), "%s.%u", CELLULAR_PROFILE_LIST_KEY, i);
+            if (cellular_profile_from_kvp(prefix, &(*ppProfiles)[count]) == RETURN_OK)
+            {
+                count++;
+            }
+        }
+        return count;
+    }
+    if (cellular_profile_file_map(pSource, &view) != RETURN_OK)
+    {
+        UT_LOG_ERROR("Matrix profile store %s not usable", pSource);
+        return 0;
+    }
+    *ppProfiles = (CellularProfileStruct *)calloc(view.count, sizeof(CellularProfileStruct));
+    if (*ppProfiles != NULL)
+    {
+        memcpy(*ppProfiles, view.pRecords, view.count * sizeof(CellularProfileStruct));
+        count = view.count;
+    }
+    cellular_profile_file_unmap(&view);
+    return count;
+}
+
+/**
+ * @brief Run the init/start/stop sequence for a matrix of profiles, each in its own process
+ *
+ * **Test Group ID:** Module: 02 @n
+ * **Test Case ID:** 008 @n
+ * **Priority:** Medium @n@n
+ *
+ * **Pre-Conditions:** None @n
+ * **Dependencies:** None @n
+ * **User Interaction:** If user chose to run the test in interactive mode, then the test case has to be selected via console. @n
+ *
+ * **Test Procedure:** @n
+ * | Variation / Step | Description | Test Data | Expected Result | Notes |
+ * | :----: | :---------: | :----------: | :--------------: | :-----: |
+ * | 01 | Build the profile matrix | CELLULAR_PROFILE_MATRIX | at least one profile | Should be successful |
+ * | 02 | Run init, start_network and stop_network per profile in parallel processes | cellular.bench.matrix.jobs, timeout_ms | RETURN_OK and IP ready for every profile | Should be successful |
+ * | 03 | Log the result table and the wall time against the summed profile time | None | None | Should be successful |
+ */
+void test_l2_cellular_hal_profile_matrix(void)
+{
+    gTestID = 8;
+    UT_LOG_INFO("In %s [%02d%03d]\n", __FUNCTION__, gTestGroup, gTestID);
+
+    /* Concurrent sessions only make sense against the simulator, a real modem runs one at a time */
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned int jobs = bench_config("cellular.bench.matrix.jobs", (cellular_sim_available() && (cpus > 0)) ? (uint32_t)cpus : 1);
+    uint32_t timeoutMs = bench_config("cellular.bench.matrix.timeout_ms", 10000);
+    CellularProfileStruct *pProfiles = NULL;
+    CellularMatrixResult_t *pResults = NULL;
+    unsigned int count = load_matrix_profiles(&pProfiles);
+    uint64_t start = 0, wallUs = 0, sumUs = 0;
+    unsigned int i = 0;
+    int passed = 0;
+
+    pResults = (CellularMatrixResult_t *)calloc((count > 0) ? count : 1, sizeof(CellularMatrixResult_t));
+    if ((count == 0) || (pResults == NULL))
+    {
+        UT_FAIL("profile matrix setup failed");
+        free(pProfiles);
+        free(pResults);
+        return;
+    }
+
+    start = cellular_bench_now_ns();
+    passed = cellular_matrix_run(pProfiles, count, jobs, timeoutMs, pResults);
+    wallUs = (cellular_bench_now_ns() - start) / 1000;
+    for (i = 0; i < count; i++)
+    {
+        sumUs += pResults[i].total_us;
+    }
+
+    cellular_matrix_log(pResults, count);
+    UT_LOG_INFO("Profile matrix: %d/%u passed, %u jobs, wall %llu us, summed %llu us", passed, count, jobs,
+                (unsigned long long)wallUs, (unsigned long long)sumUs);
+    cellular_metrics_set("matrix_wall_seconds", "Wall time of the profile matrix", NULL, (double)wallUs / 1e6);
+    cellular_metrics_set("matrix_profiles_passed", "Profiles of the matrix which passed", NULL, (double)passed);
+    UT_ASSERT_EQUAL(passed, (int)count);
+
+    free(pProfiles);
+    free(pResults);
+    UT_LOG_INFO("Out %s\n", __FUNCTION__);
+}
+
+static void *log_thread(void *pArg)
+{
+    (void)pArg;
+    UT_LOG_DEBUG("Logging thread exits");
+    return NULL;
+}
+
+/**
+ * @brief Measure the cost of a log call on the calling thread
+ *
+ * **Test Group ID:** Module: 02 @n
+ * **Test Case ID:** 009 @n
+ * **Priority:** Low @n@n
+ *
+ * **Pre-Conditions:** None @n
+ * **Dependencies:** None @n
+ * **User Interaction:** If user chose to run the test in interactive mode, then the test case has to be selected via console. @n
+ *
+ * **Test Procedure:** @n
+ * | Variation / Step | Description | Test Data | Expected Result | Notes |
+ * | :----: | :---------: | :----------: | :--------------: | :-----: |
+ * | 01 | Log lines with integer, string, double and pointer arguments | cellular.bench.log.lines | ns per call reported | Should be successful |
+ * | 02 | Flush the logger | None | every record written out | Should be successful |
+ * | 03 | Log from threads started one after another | 8 threads | at most one ring allocated | Should be successful |
+ *
+ * Run once with CELLULAR_LOG_ASYNC=0 for the synchronous reference.
+ */
+void test_l2_cellular_hal_log_benchmark(void)
+{
+    gTestID = 9;
+    UT_LOG_INFO("In %s [%02d%03d]\n", __FUNCTION__, gTestGroup, gTestID);
+
+    unsigned int lines = bench_config("cellular.bench.log.lines", 1000);
+    CellularLogStats_t before;
+    CellularLogStats_t after;
+    char apn[32];
+    uint64_t start = 0, callNs = 0, flushNs = 0;
+    unsigned int i = 0, pass = 0;
+    pthread_t thread;
+
+    /* Warm-up passes fill the record pool and the formatter's caches */
+    for (pass = 0; pass < cellular_run_warmup(); pass++)
+    {
+        for (i = 0; i < lines; i++)
+        {
+            UT_LOG_DEBUG("warm-up %u apn %s rssi %.1f dBm at %p", i, "apn", -70.0, (void *)apn);
+        }
+    }
+    cellular_log_flush();
+    cellular_log_get_stats(&before);
+    start = cellular_bench_now_ns();
+    for (i = 0; i < lines; i++)
+    {
+        /* A stack buffer, as the HAL tests log, which is reused before the record is formatted */
+        snprintf(apn, sizeof(apn), "apn%u", i);
+        UT_LOG_DEBUG("line %u apn %s rssi %.1f dBm at %p", i, apn, -70.0 - (double)(i % 30), (void *)apn);
+    }
+    callNs = cellular_bench_now_ns() - start;
+    start = cellular_bench_now_ns();
+    cellular_log_flush();
+    flushNs = cellular_bench_now_ns() - start;
+    cellular_log_get_stats(&after);
+
+    /* Other threads may log around the flush, so only this test's lines are counted */
+    UT_ASSERT_TRUE(after.records - before.records >= lines);
+    UT_ASSERT_TRUE((after.formatted + after.synchronous) - (before.formatted + before.synchronous) >= lines);
+    UT_LOG_INFO("Log %s: %.0f ns per call, flush %llu us, %llu stalls", cellular_log_is_async() ? "async" : "synchronous",
+                (lines > 0) ? (double)callNs / lines : 0.0, (unsigned long long)(flushNs / 1000),
+                (unsigned long long)(after.stalls - before.stalls));
+    cellular_metrics_set("log_call_seconds", "Time per test log call", cellular_log_is_async() ? "async" : "synchronous",
+                         (lines > 0) ? (double)callNs / lines / 1e9 : 0.0);
+
+    /* An exiting thread's ring is taken over by the next thread which logs */
+    cellular_log_get_stats(&before);
+    for (i = 0; i < 8; i++)
+    {
+        if (pthread_create(&thread, NULL, log_thread, NULL) != 0)
+        {
+            UT_FAIL("pthread_create failed");
+            break;
+        }
+        pthread_join(thread, NULL);
+    }
+    cellular_log_get_stats(&after);
+    UT_LOG_DEBUG("Rings %u, retired %u", after.rings, after.retired);
+    UT_ASSERT_TRUE(after.rings - before.rings <= 1);
+
+    UT_LOG_INFO("Out %s\n", __FUNCTION__);
+}
+
+/**
+ * @brief Check the performance counters separate on-CPU from blocked time
+ *
+ * **Test Group ID:** Module: 02 @n
+ * **Test Case ID:** 010 @n
+ * **Priority:** Low @n@n
+ *
+ * **Pre-Conditions:** None @n
+ * **Dependencies:** None @n
+ * **User Interaction:** If user chose to run the test in interactive mode, then the test case has to be selected via console. @n
+ *
+ * **Test Procedure:** @n
+ * | Variation / Step | Description | Test Data | Expected Result | Notes |
+ * | :----: | :---------: | :----------: | :--------------: | :-----: |
+ * | 01 | Spin on the CPU for 50 ms | None | on-CPU time at least half the wall time | Should be successful |
+ * | 02 | Sleep for 50 ms | None | blocked time at least 40 ms, at least one context switch | Should be successful |
+ * | 03 | Call cellular_hal_get_signal_info | None | with CELLULAR_PERF set, the call is counted | Should be successful |
+ */
+void test_l2_cellular_hal_perf_counters(void)
+{
+    gTestID = 10;
+    UT_LOG_INFO("In %s [%02d%03d]\n", __FUNCTION__, gTestGroup, gTestID);
+
+    CellularPerfCounters_t start;
+    CellularPerfCounters_t spun;
+    CellularPerfCounters_t slept;
+    CellularPerfCounters_t before;
+    CellularPerfCounters_t after;
+    CellularSignalInfoStruct signal;
+    volatile uint64_t spins = 0;
+    uint64_t busyNs = 0, blockedNs = 0;
+
+    UT_ASSERT_EQUAL(cellular_perf_read(NULL), RETURN_ERROR);
+    UT_ASSERT_EQUAL(cellular_perf_read(&start), RETURN_OK);
+    while (cellular_bench_now_ns() - start.wall_ns < 50000000ULL)
+    {
+        spins++;
+    }
+    cellular_perf_read(&spun);
+    cellular_bench_sleep_ms(50);
+    cellular_perf_read(&slept);
+
+    busyNs = spun.cpu_ns - start.cpu_ns;
+    blockedNs = (slept.wall_ns - spun.wall_ns) - (slept.cpu_ns - spun.cpu_ns);
+    UT_LOG_INFO("Spin: wall %llu us, on-CPU %llu us, %llu instructions; sleep: blocked %llu us, %llu context switches",
+                (unsigned long long)((spun.wall_ns - start.wall_ns) / 1000), (unsigned long long)(busyNs / 1000),
+                (unsigned long long)(spun.instructions - start.instructions), (unsigned long long)(blockedNs / 1000),
+                (unsigned long long)(slept.context_switches - spun.context_switches));
+    UT_ASSERT_TRUE(busyNs >= (spun.wall_ns - start.wall_ns) / 2);
+    UT_ASSERT_TRUE(blockedNs >= 40000000ULL);
+    UT_ASSERT_TRUE(slept.context_switches > spun.context_switches);
+
+    cellular_perf_get_api(CELLULAR_HAL_API_get_signal_info, &before);
+    cellular_hal_get_signal_info(&signal);
+    cellular_perf_get_api(CELLULAR_HAL_API_get_signal_info, &after);
+    if (getenv("CELLULAR_PERF") != NULL)
+    {
+        UT_ASSERT_EQUAL(after.calls, before.calls + 1);
+    }
+
+    UT_LOG_INFO("Out %s\n", __FUNCTION__);
+}
+
+/**
+ * @brief Check the system calls made inside a HAL call are counted per target
+ *
+ * **Test Group ID:** Module: 02 @n
+ * **Test Case ID:** 011 @n
+ * **Priority:** Low @n@n
+ *
+ * **Pre-Conditions:** None @n
+ * **Dependencies:** None @n
+ * **User Interaction:** If user chose to run the test in interactive mode, then the test case has to be selected via console. @n
+ *
+ * **Test Procedure:** @n
+ * | Variation / Step | Description | Test Data | Expected Result | Notes |
+ * | :----: | :---------: | :----------: | :--------------: | :-----: |
+ * | 01 | Start the system call counters | None | RETURN_OK | Should be successful |
+ * | 02 | Inside a cellular_hal_get_device_imei scope open /dev/null twice, write, ioctl and close it, write to a pipe opened before | None | two opens, one of them redundant, two closes, one write, one ioctl on /dev/null and one write on the pipe | Should be successful |
+ * | 03 | Do the same outside a HAL call | None | nothing counted | Should be successful |
+ * | 04 | Stop the system call counters | None | the later tests are not counted | Should be successful |
+ */
+void test_l2_cellular_hal_syscall_profile(void)
+{
+    gTestID = 11;
+    UT_LOG_INFO("In %s [%02d%03d]\n", __FUNCTION__, gTestGroup, gTestID);
+
+    CellularSyscallStats_t before;
+    CellularSyscallStats_t after;
+    CellularSyscallStats_t pipeBefore;
+    CellularSyscallStats_t pipeAfter;
+    int pipeFds[2] = { -1, -1 };
+    int fd = -1, again = -1, pending = 0;
+    unsigned int round = 0;
+
+    UT_ASSERT_EQUAL(cellular_syscall_start(), RETURN_OK);
+    UT_ASSERT_EQUAL(cellular_syscall_get(CELLULAR_HAL_API_COUNT, NULL, &before), RETURN_ERROR);
+    if (pipe(pipeFds) != 0)
+    {
+        cellular_syscall_stop();
+        UT_FAIL("pipe creation failed");
+        return;
+    }
+
+    /* Round 0 runs inside the scope, round 1 outside of it */
+    for (round = 0; round < 2; round++)
+    {
+        cellular_syscall_get(CELLULAR_HAL_API_get_device_imei, "/dev/null", &before);
+        cellular_syscall_get(CELLULAR_HAL_API_get_device_imei, "pipe", &pipeBefore);
+        if (round == 0)
+        {
+            cellular_trace_call_begin(CELLULAR_HAL_API_get_device_imei);
+        }
+        fd = open("/dev/null", O_WRONLY);
+        again = open("/dev/null", O_WRONLY);
+        UT_ASSERT_TRUE((fd >= 0) && (again >= 0));
+        UT_ASSERT_EQUAL(write(fd, "x", 1), 1);
+        ioctl(fd, FIONREAD, &pending);
+        close(again);
+        close(fd);
+        UT_ASSERT_EQUAL(write(pipeFds[1], "x", 1), 1);
+        if (round == 0)
+        {
+            cellular_trace_call_end(CELLULAR_HAL_API_get_device_imei);
+        }
+        cellular_syscall_get(CELLULAR_HAL_API_get_device_imei, "/dev/null", &after);
+        cellular_syscall_get(CELLULAR_HAL_API_get_device_imei, "pipe", &pipeAfter);
+
+        UT_LOG_DEBUG("Round %u: /dev/null open %llu close %llu write %llu ioctl %llu redundant %llu, pipe write %llu", round,
+                     (unsigned long long)(after.count[CELLULAR_SYSCALL_OPEN] - before.count[CELLULAR_SYSCALL_OPEN]),
+                     (unsigned long long)(after.count[CELLULAR_SYSCALL_CLOSE] - before.count[CELLULAR_SYSCALL_CLOSE]),
+                     (unsigned long long)(after.count[CELLULAR_SYSCALL_WRITE] - before.count[CELLULAR_SYSCALL_WRITE]),
+                     (unsigned long long)(after.count[CELLULAR_SYSCALL_IOCTL] - before.count[CELLULAR_SYSCALL_IOCTL]),
+                     (unsigned long long)(after.redundant_opens - before.redundant_opens),
+                     (unsigned long long)(pipeAfter.count[CELLULAR_SYSCALL_WRITE] - pipeBefore.count[CELLULAR_SYSCALL_WRITE]));
+        UT_ASSERT_EQUAL(after.count[CELLULAR_SYSCALL_OPEN] - before.count[CELLULAR_SYSCALL_OPEN], (round == 0) ? 2 : 0);
+        UT_ASSERT_EQUAL(after.count[CELLULAR_SYSCALL_CLOSE] - before.count[CELLULAR_SYSCALL_CLOSE], (round == 0) ? 2 : 0);
+        UT_ASSERT_EQUAL(after.count[CELLULAR_SYSCALL_WRITE] - before.count[CELLULAR_SYSCALL_WRITE], (round == 0) ? 1 : 0);
+        UT_ASSERT_EQUAL(after.count[CELLULAR_SYSCALL_IOCTL] - before.count[CELLULAR_SYSCALL_IOCTL], (round == 0) ? 1 : 0);
+        UT_ASSERT_EQUAL(after.redundant_opens - before.redundant_opens, (round == 0) ? 1 : 0);
+        UT_ASSERT_EQUAL(pipeAfter.count[CELLULAR_SYSCALL_WRITE] - pipeBefore.count[CELLULAR_SYSCALL_WRITE], (round == 0) ? 1 : 0);
+    }
+
+    close(pipeFds[0]);
+    close(pipeFds[1]);
+    cellular_syscall_stop();
+    UT_LOG_INFO("Out %s\n", __FUNCTION__);
+}
+
+static void *census_thread(void *pArg)
+{
+    char byte = 0;
+
+    prctl(PR_SET_NAME, "census_probe", 0, 0, 0);
+    /* Parked until the test writes to the pipe */
+    if (read(*(int *)pArg, &byte, 1) < 0)
+    {
+        UT_LOG_ERROR("census pipe read failed");
+    }
+    return NULL;
+}
+
+/**
+ * @brief Check the census attributes threads and descriptors to the HAL call which created them
+ *
+ * **Test Group ID:** Module: 02 @n
+ * **Test Case ID:** 012 @n
+ * **Priority:** Low @n@n
+ *
+ * **Pre-Conditions:** None @n
+ * **Dependencies:** None @n
+ * **User Interaction:** If user chose to run the test in interactive mode, then the test case has to be selected via console. @n
+ *
+ * **Test Procedure:** @n
+ * | Variation / Step | Description | Test Data | Expected Result | Notes |
+ * | :----: | :---------: | :----------: | :--------------: | :-----: |
+ * | 01 | Start the census | None | RETURN_OK | Should be successful |
+ * | 02 | Inside a cellular_hal_get_modem_firmware_version scope create a pipe and a thread | None | one thread and two descriptors created, thread listed with its name | Should be successful |
+ * | 03 | Inside a second scope release the thread and close the pipe | None | one thread exited and two descriptors closed | Should be successful |
+ * | 04 | Stop the census | None | the later tests are not listed | Should be successful |
+ */
+void test_l2_cellular_hal_census(void)
+{
+    gTestID = 12;
+    UT_LOG_INFO("In %s [%02d%03d]\n", __FUNCTION__, gTestGroup, gTestID);
+
+    CellularCensusThread_t threads[CELLULAR_CENSUS_MAX_THREADS];
+    CellularCensusStats_t before;
+    CellularCensusStats_t after;
+    pthread_t thread;
+    unsigned int threadCount = 0, fdCount = 0, count = 0, i = 0;
+    int pipeFds[2] = { -1, -1 };
+    int found = 0;
+
+    UT_ASSERT_EQUAL(cellular_census_start(), RETURN_OK);
+    UT_ASSERT_EQUAL(cellular_census_count(&threadCount, &fdCount), RETURN_OK);
+    UT_ASSERT_TRUE((threadCount >= 1) && (fdCount >= 3));
+    UT_ASSERT_EQUAL(cellular_census_get_api(CELLULAR_HAL_API_COUNT, &before), RETURN_ERROR);
+
+    cellular_census_get_api(CELLULAR_HAL_API_get_modem_firmware_version, &before);
+    cellular_trace_call_begin(CELLULAR_HAL_API_get_modem_firmware_version);
+    if (pipe(pipeFds) != 0)
+    {
+        cellular_trace_call_end(CELLULAR_HAL_API_get_modem_firmware_version);
+        cellular_census_stop();
+        UT_FAIL("pipe creation failed");
+        return;
+    }
+    if (pthread_create(&thread, NULL, census_thread, &pipeFds[0]) != 0)
+    {
+        cellular_trace_call_end(CELLULAR_HAL_API_get_modem_firmware_version);
+        close(pipeFds[0]);
+        close(pipeFds[1]);
+        cellular_census_stop();
+        UT_FAIL("thread creation failed");
+        return;
+    }
+    /* Let the thread name itself before the scope lists it */
+    cellular_bench_sleep_ms(10);
+    cellular_trace_call_end(CELLULAR_HAL_API_get_modem_firmware_version);
+    cellular_census_get_api(CELLULAR_HAL_API_get_modem_firmware_version, &after);
+    UT_LOG_DEBUG("Created %llu threads and %llu descriptors",
+                 (unsigned long long)(after.threads_created - before.threads_created),
+                 (unsigned long long)(after.fds_opened - before.fds_opened));
+    UT_ASSERT_TRUE(after.threads_created - before.threads_created >= 1);
+    UT_ASSERT_EQUAL(after.fds_opened - before.fds_opened, 2);
+
+    count = cellular_census_get_threads(threads, CELLULAR_CENSUS_MAX_THREADS);
+    for (i = 0; i < count; i++)
+    {
+        if ((strcmp(threads[i].name, "census_probe") == 0) && threads[i].alive && (threads[i].pCreatedBy != NULL) &&
+            (strcmp(threads[i].pCreatedBy, "cellular_hal_get_modem_firmware_version") == 0))
+        {
+            found = 1;
+        }
+    }
+    UT_ASSERT_TRUE(found);
+
+    before = after;
+    cellular_trace_call_begin(CELLULAR_HAL_API_get_modem_firmware_version);
+    UT_ASSERT_EQUAL(write(pipeFds[1], "x", 1), 1);
+    pthread_join(thread, NULL);
+    close(pipeFds[0]);
+    close(pipeFds[1]);
+    cellular_trace_call_end(CELLULAR_HAL_API_get_modem_firmware_version);
+    cellular_census_get_api(CELLULAR_HAL_API_get_modem_firmware_version, &after);
+    UT_ASSERT_TRUE(after.threads_exited - before.threads_exited >= 1);
+    UT_ASSERT_EQUAL(after.fds_closed - before.fds_closed, 2);
+
+    cellular_census_stop();
+    UT_LOG_INFO("Out %s\n", __FUNCTION__);
+}
+
+typedef struct
+{
+    pthread_mutex_t *pMutex;
+    volatile int held;
+    unsigned int hold_ms;
+} LockHolder_t;
+
+typedef struct
+{
+    volatile int *pStop;
+    uint64_t calls;
+} LockWorker_t;
+
+/* Holds the mutex for hold_ms inside a cellular_hal_get_signal_info scope */
+static void *lock_holder_thread(void *pArg)
+{
+    LockHolder_t *pHolder = (LockHolder_t *)pArg;
+
+    cellular_trace_call_begin(CELLULAR_HAL_API_get_signal_info);
+    pthread_mutex_lock(pHolder->pMutex);
+    pHolder->held = 1;
+    cellular_bench_sleep_ms(pHolder->hold_ms);
+    pthread_mutex_unlock(pHolder->pMutex);
+    cellular_trace_call_end(CELLULAR_HAL_API_get_signal_info);
+    return NULL;
+}
+
+static void *lock_worker_thread(void *pArg)
+{
+    LockWorker_t *pWorker = (LockWorker_t *)pArg;
+    CellularSignalInfoStruct signalInfo;
+
+    /* Load, not timing: under SCHED_FIFO the test thread must still wake up to stop it */
+    cellular_run_background_thread();
+    while (!*pWorker->pStop)
+    {
+        cellular_hal_get_signal_info(&signalInfo);
+        pWorker->calls++;
+    }
+    return NULL;
+}
+
+/* Runs 'threads' callers of cellular_hal_get_signal_info for duration_ms; returns the calls made */
+static uint64_t run_lock_stress(unsigned int threads, unsigned int duration_ms, uint64_t *pWaitNs)
+{
+    CellularLockStats_t before;
+    CellularLockStats_t after;
+    LockWorker_t *pWorkers = (LockWorker_t *)calloc(threads, sizeof(LockWorker_t));
+    pthread_t *pThreads = (pthread_t *)calloc(threads, sizeof(pthread_t));
+    volatile int stop = 0;
+    uint64_t calls = 0;
+    unsigned int i, started;
+
+    if ((pWorkers == NULL) || (pThreads == NULL))
+    {
+        free(pWorkers);
+        free(pThreads);
+        return 0;
+    }
+    cellular_lock_get(NULL, CELLULAR_HAL_API_get_signal_info, &before);
+    for (started = 0; started < threads; started++)
+    {
+        pWorkers[started].pStop = &stop;
+        if (pthread_create(&pThreads[started], NULL, lock_worker_thread, &pWorkers[started]) != 0)
+        {
+            break;
+        }
+    }
+    cellular_bench_sleep_ms(duration_ms);
+    stop = 1;
+    for (i = 0; i < started; i++)
+    {
+        pthread_join(pThreads[i], NULL);
+        calls += pWorkers[i].calls;
+    }
+    cellular_lock_get(NULL, CELLULAR_HAL_API_get_signal_info, &after);
+    *pWaitNs = after.wait_ns - before.wait_ns;
+    free(pWorkers);
+    free(pThreads);
+    return (started == threads) ? calls : 0;
+}
+
+/**
+ * @brief Measure the waits and holds of the locks taken inside HAL calls and the throughput of concurrent callers
+ *
+ * **Test Group ID:** Module: 02 @n
+ * **Test Case ID:** 013 @n
+ * **Priority:** Low @n@n
+ *
+ * **Pre-Conditions:** None @n
+ * **Dependencies:** None @n
+ * **User Interaction:** If user chose to run the test in interactive mode, then the test case has to be selected via console. @n
+ *
+ * **Test Procedure:** @n
+ * | Variation / Step | Description | Test Data | Expected Result | Notes |
+ * | :----: | :---------: | :----------: | :--------------: | :-----: |
+ * | 01 | Start the lock profiler | None | RETURN_OK | Should be successful |
+ * | 02 | Hold a mutex for 20 ms in a cellular_hal_get_signal_info scope on a second thread and take it in a cellular_hal_get_device_imei scope | hold = 20 ms | one blocked acquisition of at least 10 ms, recorded behind cellular_hal_get_signal_info | Should be successful |
+ * | 03 | Wait on a condition variable with the mutex in the same scope | timeout = 5 ms | one condition wait, not counted as hold time | Should be successful |
+ * | 04 | Call cellular_hal_get_signal_info from 1 and then N threads for the configured duration | cellular.bench.lock.threads, duration_ms | calls made in both phases, throughput and lock wait logged | Should be successful | * | 05 | Stop the lock profiler | None | the later tests are not tracked | Should be successful |
+ */
+void test_l2_cellular_hal_lock_contention(void)
+{
+    gTestID = 13;
+    UT_LOG_INFO("In %s [%02d%03d]\n", __FUNCTION__, gTestGroup, gTestID);
+
+    unsigned int threads = bench_config("cellular.bench.lock.threads", 4);
+    unsigned int duration_ms = bench_config("cellular.bench.lock.duration_ms", 500);
+    pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+    pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+    LockHolder_t holder = { &mutex, 0, 20 };
+    CellularLockStats_t waiter;
+    CellularLockStats_t held;
+    struct timespec due;
+    pthread_t thread;
+    uint64_t singleCalls = 0, singleWait = 0, multiCalls = 0, multiWait = 0;
+    unsigned int pass;
+
+    UT_ASSERT_EQUAL(cellular_lock_start(), RETURN_OK);
+    UT_ASSERT_EQUAL(cellular_lock_get(NULL, CELLULAR_LOCK_OUTSIDE + 1, &waiter), RETURN_ERROR);
+
+    if (pthread_create(&thread, NULL, lock_holder_thread, &holder) != 0)
+    {
+        cellular_lock_stop();
+        UT_FAIL("thread creation failed");
+        return;
+    }
+    while (!holder.held)
+    {
+        cellular_bench_sleep_ms(1);
+    }
+    cellular_trace_call_begin(CELLULAR_HAL_API_get_device_imei);
+    pthread_mutex_lock(&mutex);
+    clock_gettime(CLOCK_REALTIME, &due);
+    due.tv_nsec += 5000000;
+    if (due.tv_nsec >= 1000000000)
+    {
+        due.tv_sec++;
+        due.tv_nsec -= 1000000000;
+    }
+    pthread_cond_timedwait(&cond, &mutex, &due);
+    pthread_mutex_unlock(&mutex);
+    cellular_trace_call_end(CELLULAR_HAL_API_get_device_imei);
+    pthread_join(thread, NULL);
+
+    cellular_lock_get(&mutex, CELLULAR_HAL_API_get_device_imei, &waiter);
+    cellular_lock_get(&mutex, CELLULAR_HAL_API_get_signal_info, &held);
+    UT_LOG_DEBUG("Waiter: acquired %llu blocked %llu wait %llu us hold %llu us cond %llu; holder: hold %llu us",
+                 (unsigned long long)waiter.acquisitions, (unsigned long long)waiter.contended,
+                 (unsigned long long)(waiter.wait_ns / 1000), (unsigned long long)(waiter.hold_ns / 1000),
+                 (unsigned long long)waiter.cond_waits, (unsigned long long)(held.hold_ns / 1000));
+    UT_ASSERT_EQUAL(waiter.acquisitions, 1);
+    UT_ASSERT_EQUAL(waiter.contended, 1);
+    UT_ASSERT_TRUE(waiter.wait_ns >= 10000000ull);
+    UT_ASSERT_EQUAL(waiter.cond_waits, 1);
+    UT_ASSERT_TRUE(waiter.hold_ns < waiter.cond_wait_ns);
+    UT_ASSERT_TRUE(held.hold_ns >= 15000000ull);
+    UT_ASSERT_TRUE(cellular_lock_get_blocked_ns(&mutex, CELLULAR_HAL_API_get_device_imei, CELLULAR_HAL_API_get_signal_info) >= 10000000ull);
+
+    /* The passes before the last are warm-up */
+    for (pass = 0; pass <= cellular_run_warmup(); pass++)
+    {
+        singleCalls = run_lock_stress(1, duration_ms, &singleWait);
+        multiCalls = run_lock_stress(threads, duration_ms, &multiWait);
+    }
+    UT_LOG_INFO("1 thread : %llu calls/s, %llu us waiting on locks", (unsigned long long)(singleCalls * 1000 / duration_ms),
+                (unsigned long long)(singleWait / 1000));
+    UT_LOG_INFO("%u threads: %llu calls/s, %llu us waiting on locks (%.1f%% of the callers' time), scaling %.2fx", threads,
+                (unsigned long long)(multiCalls * 1000 / duration_ms), (unsigned long long)(multiWait / 1000),
+                100.0 * (double)multiWait / ((double)threads * duration_ms * 1000000.0),
+                (singleCalls > 0) ? (double)multiCalls / (double)singleCalls : 0.0);
+    cellular_metrics_set("hal_calls_per_second", "cellular_hal_get_signal_info calls per second", "1 thread",
+                         (double)singleCalls * 1000.0 / duration_ms);
+    cellular_metrics_set("hal_calls_per_second", "cellular_hal_get_signal_info calls per second", "threads",
+                         (double)multiCalls * 1000.0 / duration_ms);
+    cellular_metrics_set("lock_wait_seconds", "Time the callers spent blocked on locks", "threads", (double)multiWait / 1e9);
+    UT_ASSERT_TRUE(singleCalls > 0);
+    UT_ASSERT_TRUE(multiCalls > 0);
+
+    pthread_cond_destroy(&cond);
+    pthread_mutex_destroy(&mutex);
+    cellular_lock_stop();
+    UT_LOG_INFO("Out %s\n", __FUNCTION__);
+}
+
+/* Returns the line of 'pText' starting with 'pPrefix', or NULL */
+static const char *find_line(const char *pText, const char *pPrefix)
+{
+    const char *pLine = pText;
+
+    while (pLine != NULL)
+    {
+        if (strncmp(pLine, pPrefix, strlen(pPrefix)) == 0)
+        {
+            return pLine;
+        }
+        pLine = strchr(pLine, '\n');
+        pLine = (pLine != NULL) ? pLine + 1 : NULL;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Check the OpenMetrics export to a file and over HTTP
+ *
+ * **Test Group ID:** Module: 02 @n
+ * **Test Case ID:** 014 @n
+ * **Priority:** Low @n@n
+ *
+ * **Pre-Conditions:** None @n
+ * **Dependencies:** None @n
+ * **User Interaction:** If user chose to run the test in interactive mode, then the test case has to be selected via console. @n
+ *
+ * **Test Procedure:** @n
+ * | Variation / Step | Description | Test Data | Expected Result | Notes |
+ * | :----: | :---------: | :----------: | :--------------: | :-----: |
+ * | 01 | Start the exporter, publish a result and invoke cellular_hal_get_signal_info | variant = "a\"b" | RETURN_OK | Should be successful |
+ * | 02 | Write the metrics to a file | path in /tmp | histogram with api, target and firmware labels, the escaped result, # EOF last | Should be successful |
+ * | 03 | Serve the metrics on a free port and request /metrics and /other | 127.0.0.1 | 200 with the same families, then 404 | Should be successful |
+ */
+void test_l2_cellular_hal_metrics_export(void)
+{
+    gTestID = 14;
+    UT_LOG_INFO("In %s [%02d%03d]\n", __FUNCTION__, gTestGroup, gTestID);
+
+    char path[] = "/tmp/cellular_metrics_XXXXXX";
+    static char text[262144];
+    CellularSignalInfoStruct signalInfo;
+    struct sockaddr_in address;
+    const char *pRequests[2] = { "GET /metrics HTTP/1.0\r\n\r\n", "GET /other HTTP/1.0\r\n\r\n" };
+    size_t used = 0;
+    ssize_t received;
+    int fd, port, r;
+
+    UT_ASSERT_EQUAL(cellular_metrics_start(), RETURN_OK);
+    UT_ASSERT_EQUAL(cellular_metrics_set("export_check", "Value published by the export test", "a\"b", 42.0), RETURN_OK);
+    UT_ASSERT_EQUAL(cellular_metrics_set("export_check", "Value published by the export test", "a\"b", 43.0), RETURN_OK);
+    cellular_hal_get_signal_info(&signalInfo);
+
+    fd = mkstemp(path);
+    if (fd < 0)
+    {
+        UT_FAIL("temporary file creation failed");
+        return;
+    }
+    close(fd);
+    UT_ASSERT_EQUAL(cellular_metrics_write(path), RETURN_OK);
+    fd = open(path, O_RDONLY);
+    while ((fd >= 0) && ((received = read(fd, &text[used], sizeof(text) - 1 - used)) > 0))
+    {
+        used += (size_t)received;
+    }
+    text[used] = '\0';
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+    unlink(path);
+    UT_LOG_DEBUG("Exported %zu bytes", used);
+    UT_ASSERT_PTR_NOT_NULL(find_line(text, "# TYPE cellular_hal_call_duration_seconds histogram"));
+    UT_ASSERT_PTR_NOT_NULL(find_line(text, "# UNIT cellular_hal_call_duration_seconds seconds"));
+    UT_ASSERT_PTR_NOT_NULL(find_line(text, "cellular_hal_call_duration_seconds_bucket{api=\"cellular_hal_get_signal_info\",le=\"+Inf\",target="));
+    UT_ASSERT_PTR_NOT_NULL(find_line(text, "cellular_bench_export_check{test=\"l2_cellular_hal_metrics_export\",variant=\"a\\\"b\","));
+    UT_ASSERT_PTR_NOT_NULL(strstr(text, "firmware=\""));
+    UT_ASSERT_PTR_NOT_NULL(strstr(text, "\"} 43\n"));
+    UT_ASSERT_TRUE((used >= 6) && (strcmp(&text[used - 6], "# EOF\n") == 0));
+
+    port = cellular_metrics_serve(0);
+    UT_ASSERT_TRUE(port > 0);
+    for (r = 0; (port > 0) && (r < 2); r++)
+    {
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_port = htons((unsigned short)port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if ((fd < 0) || (connect(fd, (struct sockaddr *)&address, sizeof(address)) != 0))
+        {
+            UT_FAIL("metrics endpoint connection failed");
+            if (fd >= 0)
+            {
+                close(fd);
+            }
+            break;
+        }
+        UT_ASSERT_EQUAL(write(fd, pRequests[r], strlen(pRequests[r])), (ssize_t)strlen(pRequests[r]));
+        used = 0;
+        while ((received = read(fd, &text[used], sizeof(text) - 1 - used)) > 0)
+        {
+            used += (size_t)received;
+        }
+        text[used] = '\0';
+        close(fd);
+        if (r == 0)
+        {
+            UT_ASSERT_EQUAL(strncmp(text, "HTTP/1.0 200 OK\r\n", 17), 0);
+            UT_ASSERT_PTR_NOT_NULL(strstr(text, "application/openmetrics-text"));
+            UT_ASSERT_PTR_NOT_NULL(strstr(text, "\ncellular_bench_export_check{"));
+            UT_ASSERT_TRUE((used >= 6) && (strcmp(&text[used - 6], "# EOF\n") == 0));
+        }
+        else
+        {
+            UT_ASSERT_EQUAL(strncmp(text, "HTTP/1.0 404", 12), 0);
+        }
+    }
+
+    UT_LOG_INFO("Out %s\n", __FUNCTION__);
+}
+
+/**
+ * @brief Check the sampling profiler tags CPU samples with the test, its ID and the HAL call
+ *
+ * **Test Group ID:** Module: 02 @n
+ * **Test Case ID:** 015 @n
+ * **Priority:** Low @n@n
+ *
+ * **Pre-Conditions:** None @n
+ * **Dependencies:** None @n
+ * **User Interaction:** If user chose to run the test in interactive mode, then the test case has to be selected via console. @n
+ *
+ * **Test Procedure:** @n
+ * | Variation / Step | Description | Test Data | Expected Result | Notes |
+ * | :----: | :---------: | :----------: | :--------------: | :-----: |
+ * | 01 | Start the sampler | CELLULAR_SAMPLER_DEFAULT_HZ unless already started | RETURN_OK | Should be successful |
+ * | 02 | Spin on the CPU inside a cellular_hal_get_signal_info scope | 200 ms | no sample dropped | Should be successful |
+ * | 03 | Write the folded stacks | path in /tmp | lines of this test tagged [02015] with the API frame, at least 5 samples | Should be successful |
+ * | 04 | Compare the handler time with the sampled CPU time | None | below CELLULAR_SAMPLER_OVERHEAD_LIMIT | Should be successful |
+ * | 05 | Stop and reset the sampler | None | the later tests are not sampled, unless CELLULAR_SAMPLER started it for the run | Should be successful |
+ */
+void test_l2_cellular_hal_sampling_profiler(void)
+{
+    gTestID = 15;
+    UT_LOG_INFO("In %s [%02d%03d]\n", __FUNCTION__, gTestGroup, gTestID);
+
+    char path[] = "/tmp/cellular_samples_XXXXXX";
+    char line[4096];
+    const char *pPrefix = "l2_cellular_hal_sampling_profiler [02015];";
+    const char *pCount;
+    CellularSamplerStats_t stats;
+    volatile uint64_t spins = 0;
+    uint64_t start = 0, tagged = 0;
+    FILE *pFile;
+    int fd;
+
+    UT_ASSERT_EQUAL(cellular_sampler_start(0), RETURN_OK);
+    UT_ASSERT_EQUAL(cellular_sampler_get_stats(NULL), RETURN_ERROR);
+
+    cellular_trace_call_begin(CELLULAR_HAL_API_get_signal_info);
+    start = cellular_bench_now_ns();
+    while (cellular_bench_now_ns() - start < 200000000ULL)
+    {
+        spins++;
+    }
+    cellular_trace_call_end(CELLULAR_HAL_API_get_signal_info);
+    cellular_sampler_get_stats(&stats);
+
+    fd = mkstemp(path);
+    if (fd < 0)
+    {
+        cellular_sampler_stop();
+        cellular_sampler_reset();
+        UT_FAIL("temporary file creation failed");
+        return;
+    }
+    close(fd);
+    UT_ASSERT_EQUAL(cellular_sampler_write(path), RETURN_OK);
+    pFile = fopen(path, "r");
+    while ((pFile != NULL) && (fgets(line, sizeof(line), pFile) != NULL))
+    {
+        pCount = strrchr(line, ' ');
+        if ((strncmp(line, pPrefix, strlen(pPrefix)) == 0) && (strstr(line, ";cellular_hal_get_signal_info;") != NULL) &&
+            (pCount != NULL))
+        {
+            tagged += strtoull(pCount + 1, NULL, 10);
+        }
+    }
+    if (pFile != NULL)
+    {
+        fclose(pFile);
+    }
+    unlink(path);
+
+    UT_LOG_INFO("Sampler at %u Hz: %llu samples of the spin tagged, overhead %.2f%%", stats.hz, (unsigned long long)tagged,
+                stats.overhead * 100.0);
+    UT_ASSERT_EQUAL(stats.dropped, 0);
+    UT_ASSERT_TRUE(tagged >= 5);
+    UT_ASSERT_TRUE(stats.overhead < CELLULAR_SAMPLER_OVERHEAD_LIMIT);
+
+    cellular_sampler_stop();
+    cellular_sampler_reset();
+    UT_LOG_INFO("Out %s\n", __FUNCTION__);
+}
+
+/* A cellular_hal_get_device_imei call blocked until the test writes to the pipe */
+static void *hung_call_thread(void *pArg)
+{
+    char byte = 0;
+
+    prctl(PR_SET_NAME, "hung_call", 0, 0, 0);
+    cellular_trace_call_begin(CELLULAR_HAL_API_get_device_imei);
+    if (read(*(int *)pArg, &byte, 1) < 0)
+    {
+        UT_LOG_ERROR("watchdog pipe read failed");
+    }
+    cellular_trace_call_end(CELLULAR_HAL_API_get_device_imei);
+    return NULL;
+}
+
+/**
+ * @brief Check the watchdog reports a HAL call which overruns its deadline
+ *
+ * **Test Group ID:** Module: 02 @n
+ * **Test Case ID:** 016 @n
+ * **Priority:** Low @n@n
+ *
+ * **Pre-Conditions:** None @n
+ * **Dependencies:** None @n
+ * **User Interaction:** If user chose to run the test in interactive mode, then the test case has to be selected via console. @n
+ *
+ * **Test Procedure:** @n
+ * | Variation / Step | Description | Test Data | Expected Result | Notes |
+ * | :----: | :---------: | :----------: | :--------------: | :-----: |
+ * | 01 | Start the watchdog and set a deadline for cellular_hal_get_device_imei | 100 ms | RETURN_OK, RETURN_ERROR for an unknown API name | Should be successful |
+ * | 02 | Block a cellular_hal_get_device_imei scope on a second thread | up to 2 s | one expiry of the API on that thread, stacks of this thread and the blocked one logged, the test not abandoned | Should be successful |
+ * | 03 | Release the thread, remove the deadline and stop the watchdog | None | the thread returns | Should be successful |
+ *
+ * Skipped with CELLULAR_WATCHDOG_ACTION=abort, which would end the run.
+ */
+void test_l2_cellular_hal_watchdog(void)
+{
+    gTestID = 16;
+    UT_LOG_INFO("In %s [%02d%03d]\n", __FUNCTION__, gTestGroup, gTestID);
+
+    CellularWatchdogHang_t hangs[CELLULAR_WATCHDOG_MAX_HANGS];
+    CellularWatchdogHang_t *pHang = NULL;
+    unsigned int before, after, waited;
+    int pipeFds[2] = { -1, -1 };
+    pthread_t thread;
+
+    if ((getenv("CELLULAR_WATCHDOG_ACTION") != NULL) && (strcmp(getenv("CELLULAR_WATCHDOG_ACTION"), "abort") == 0))
+    {
+        UT_LOG_INFO("Skipped: the watchdog aborts on expiry");
+        return;
+    }
+    UT_ASSERT_EQUAL(cellular_watchdog_start(0, CELLULAR_WATCHDOG_SKIP), RETURN_OK);
+    UT_ASSERT_EQUAL(cellular_watchdog_set_api_deadlines("get_device_imei=1,no_such_api=1"), RETURN_ERROR);
+    UT_ASSERT_EQUAL(cellular_watchdog_set_api_deadline(CELLULAR_HAL_API_get_device_imei, 100), RETURN_OK);
+    before = cellular_watchdog_get_hangs(NULL, 0);
+
+    if ((pipe(pipeFds) != 0) || (pthread_create(&thread, NULL, hung_call_thread, &pipeFds[0]) != 0))
+    {
+        UT_FAIL("thread creation failed");
+        cellular_watchdog_set_api_deadline(CELLULAR_HAL_API_get_device_imei, 0);
+        cellular_watchdog_stop();
+        return;
+    }
+    for (waited = 0, after = before; (after == before) && (waited < 2000); waited += 10)
+    {
+        cellular_bench_sleep_ms(10);
+        after = cellular_watchdog_get_hangs(hangs, CELLULAR_WATCHDOG_MAX_HANGS);
+    }
+    cellular_watchdog_set_api_deadline(CELLULAR_HAL_API_get_device_imei, 0);
+    UT_ASSERT_EQUAL(write(pipeFds[1], "x", 1), 1);
+    pthread_join(thread, NULL);
+    close(pipeFds[0]);
+    close(pipeFds[1]);
+
+    UT_ASSERT_EQUAL(after, before + 1);
+    if ((after == before + 1) && (before < CELLULAR_WATCHDOG_MAX_HANGS))
+    {
+        pHang = &hangs[before];
+        UT_LOG_INFO("Watchdog expiry after %u ms of %s, %u threads dumped", pHang->elapsed_ms,
+                    cellular_trace_api_name(pHang->api), pHang->threads);
+        UT_ASSERT_EQUAL(pHang->api, CELLULAR_HAL_API_get_device_imei);
+        UT_ASSERT_TRUE(pHang->elapsed_ms >= 100);
+        UT_ASSERT_TRUE(pHang->threads >= 2);
+        UT_ASSERT_EQUAL(pHang->abandoned, 0);
+        UT_ASSERT_PTR_NOT_NULL(pHang->pTest);
+    }
+
+    cellular_watchdog_stop();
+    UT_LOG_INFO("Out %s\n", __FUNCTION__);
+}
+
+/**
+ * @brief Fuzz every input-taking HAL API for a fixed number of execs
+ *
+ * **Test Group ID:** Module: 02 @n
+ * **Test Case ID:** 017 @n
+ * **Priority:** Low @n@n
+ *
+ * **Pre-Conditions:** Simulator linked @n
+ * **Dependencies:** None @n
+ * **User Interaction:** If user chose to run the test in interactive mode, then the test case has to be selected via console. @n
+ *
+ * **Test Procedure:** @n
+ * | Variation / Step | Description | Test Data | Expected Result | Notes |
+ * | :----: | :---------: | :----------: | :--------------: | :-----: |
+ * | 01 | Run each fuzz target from a fixed seed, resetting the simulator between execs | cellular.bench.fuzz.runs | no result contradicting the read-back, no crash | Should be successful |
+ * | 02 | Log and publish the execs per second of each target | None | None | Should be successful |
+ *
+ * Long runs are made with CELLULAR_FUZZ instead; a vendor HAL cannot be reset between execs and is skipped.
+ */
+void test_l2_cellular_hal_fuzz_inputs(void)
+{
+    gTestID = 17;
+    UT_LOG_INFO("In %s [%02d%03d]\n", __FUNCTION__, gTestGroup, gTestID);
+
+    CellularFuzzOptions_t options;
+    CellularFuzzStats_t stats;
+    const char *pTarget;
+    unsigned int i;
+
+    if (!cellular_sim_available())
+    {
+        UT_LOG_INFO("Skipped: no simulator to reset between execs");
+        return;
+    }
+    memset(&options, 0, sizeof(options));
+    options.runs = bench_config("cellular.bench.fuzz.runs", 20000);
+    options.seed = 1;
+    for (i = 0; (pTarget = cellular_fuzz_target_name(i)) != NULL; i++)
+    {
+        memset(&stats, 0, sizeof(stats));
+        UT_ASSERT_EQUAL(cellular_fuzz_run(pTarget, &options, &stats), RETURN_OK);
+        UT_ASSERT_EQUAL(stats.execs, options.runs);
+        UT_LOG_INFO("Fuzz %s: %llu execs at %.0f/s, %u outcomes, %llu failures, longest %llu us", pTarget,
+                    (unsigned long long)stats.execs, stats.execs_per_sec, stats.outcomes,
+                    (unsigned long long)stats.failures, (unsigned long long)(stats.max_exec_ns / 1000));
+        cellular_metrics_set("fuzz_execs_per_second", "Fuzz execs per second, simulator reset included", pTarget, stats.execs_per_sec);
+    }
+    UT_ASSERT_EQUAL(cellular_fuzz_target_count(), i);
+    cellular_sim_reset();
+
+    UT_LOG_INFO("Out %s\n", __FUNCTION__);
+}
+
+/* Calls one of the AT-backed getters timed by test 018 */
+static int at_round_trip_call(unsigned int api)
+{
+    CellularSignalInfoStruct signal;
+    CellularCurrentPlmnInfoStruct plmn;
+    CellularUICCStatus_t status;
+    char value[128];
+
+    switch (api)
+    {
+        case 0:
+            return cellular_hal_get_device_imei(value);
+        case 1:
+            return cellular_hal_get_signal_info(&signal);
+        case 2:
+            return cellular_hal_get_current_plmn_information(&plmn);
+        case 3:
+            return cellular_hal_get_modem_current_radio_technology(value);
+        default:
+            return cellular_hal_get_active_card_status(&status);
+    }
+}
+
+/**
+ * @brief Round trip of the HAL calls the reference HAL sends over the AT modem emulator
+ *
+ * **Test Group ID:** Module: 02 @n
+ * **Test Case ID:** 018 @n
+ * **Priority:** Low @n@n
+ *
+ * **Pre-Conditions:** Simulator linked @n
+ * **Dependencies:** None @n
+ * **User Interaction:** If user chose to run the test in interactive mode, then the test case has to be selected via console. @n
+ *
+ * **Test Procedure:** @n
+ * | Variation / Step | Description | Test Data | Expected Result | Notes |
+ * | :----: | :---------: | :----------: | :--------------: | :-----: |
+ * | 01 | Start the emulator unless CELLULAR_ATMODEM did, and send the HAL calls over its pty | cellular.bench.at.baud | RETURN_OK, 0 | Should be successful |
+ * | 02 | Call each AT-backed getter and publish the mean round trip | cellular.bench.at.calls | RETURN_OK, the emulator's IMEI, no round trip shorter than its bytes on the line | Should be successful |
+ * | 03 | Give +CSQ a latency and call cellular_hal_get_signal_info | 50 ms | RETURN_OK after at least 50 ms | Should be successful |
+ * | 04 | Remove the latency; detach and stop the emulator if this test started it, go back to CELLULAR_CTLMODEM's socket | None | None | Should be successful |
+ */
+void test_l2_cellular_hal_at_round_trip(void)
+{
+    gTestID = 18;
+    UT_LOG_INFO("In %s [%02d%03d]\n", __FUNCTION__, gTestGroup, gTestID);
+
+    static const char *apis[] =
+    {
+        "get_device_imei", "get_signal_info", "get_current_plmn_information",
+        "get_modem_current_radio_technology", "get_active_card_status"
+    };
+    /* AT+CGSN<CR> out, <CR><LF>IMEI<CR><LF><CR><LF>OK<CR><LF> back */
+    const uint64_t imeiBytes = 8 + 2 + strlen(CELLULAR_ATMODEM_IMEI) + 2 + 6;
+    unsigned int baud = bench_config("cellular.bench.at.baud", CELLULAR_ATMODEM_DEFAULT_BAUD);
+    unsigned int calls = bench_config("cellular.bench.at.calls", 20);
+    CellularAtmodemStats_t stats;
+    CellularSignalInfoStruct signal;
+    char imei[16] = {"\0"};
+    uint64_t start, ns = 0;
+    unsigned int i, n, pass;
+    int started = 0;
+
+    if (!cellular_sim_available())
+    {
+        UT_LOG_INFO("Skipped: a vendor HAL talks to its own modem");
+        return;
+    }
+    if (cellular_atmodem_path() == NULL)
+    {
+        if (cellular_atmodem_start(baud, 0) != RETURN_OK)
+        {
+            UT_FAIL("cellular_atmodem_start failed");
+            return;
+        }
+        started = 1;
+    }
+    cellular_atmodem_get_stats(&stats);
+    baud = stats.baud;
+    /* A control-protocol socket would take the calls over */
+    cellular_sim_set_ctl_device(NULL);
+    if (cellular_sim_set_at_device(cellular_atmodem_path()) != 0)
+    {
+        UT_FAIL("cellular_sim_set_at_device failed");
+        if (started)
+        {
+            cellular_atmodem_stop();
+        }
+        return;
+    }
+
+    UT_ASSERT_EQUAL(cellular_hal_get_device_imei(imei), RETURN_OK);
+    UT_ASSERT_EQUAL(strcmp(imei, CELLULAR_ATMODEM_IMEI), 0);
+    for (i = 0; i < sizeof(apis) / sizeof(apis[0]); i++)
+    {
+        /* The passes before the last are warm-up */
+        for (pass = 0; pass <= cellular_run_warmup(); pass++)
+        {
+            start = cellular_bench_now_ns();
+            for (n = 0; n < calls; n++)
+            {
+                UT_ASSERT_EQUAL(at_round_trip_call(i), RETURN_OK);
+            }
+            ns = (cellular_bench_now_ns() - start) / ((calls > 0) ? calls : 1);
+        }
+        UT_LOG_INFO("AT round trip %s: %llu us at %u baud", apis[i], (unsigned long long)(ns / 1000), baud);
+        cellular_metrics_set("at_round_trip_seconds", "Mean HAL call time over the AT modem emulator", apis[i], (double)ns / 1e9);
+        if ((i == 0) && (baud > 0))
+        {
+            UT_ASSERT_TRUE(ns >= (imeiBytes * 10 * 1000000000ULL) / baud);
+        }
+    }
+
+    UT_ASSERT_EQUAL(cellular_atmodem_set_latency("+CSQ", 50), RETURN_OK);
+    start = cellular_bench_now_ns();
+    UT_ASSERT_EQUAL(cellular_hal_get_signal_info(&signal), RETURN_OK);
+    UT_ASSERT_TRUE(cellular_bench_now_ns() - start >= 50000000ULL);
+    UT_ASSERT_EQUAL(cellular_atmodem_set_latency("+CSQ", -1), RETURN_OK);
+
+    if (started)
+    {
+        cellular_sim_set_at_device(NULL);
+        cellular_atmodem_stop();
+    }
+    if (cellular_ctlmodem_path() != NULL)
+    {
+        cellular_sim_set_ctl_device(cellular_ctlmodem_path());
+    }
+
+    UT_LOG_INFO("Out %s\n", __FUNCTION__);
+}
+
+typedef struct
+{
+    unsigned int calls;
+    unsigned int failures;
+} TransportCaller_t;
+
+static void *transport_caller_thread(void *pArg)
+{
+    TransportCaller_t *pCaller = (TransportCaller_t *)pArg;
+    char imei[16];
+    unsigned int i;
+
+    for (i = 0; i < pCaller->calls; i++)
+    {
+        pCaller->failures += (cellular_hal_get_device_imei(imei) != RETURN_OK);
+    }
+    return NULL;
+}
+
+/* Runs the callers against the attached transport, returns the calls per second */
+static double transport_run(const char *pTransport, unsigned int threads, unsigned int calls)
+{
+    pthread_t pThreads[CELLULAR_CTLMODEM_MAX_PENDING];
+    TransportCaller_t pCallers[CELLULAR_CTLMODEM_MAX_PENDING];
+    unsigned int i, pass, started = 0, failures = 0;
+    uint64_t start, ns = 0;
+
+    /* The passes before the last are warm-up */
+    for (pass = 0; pass <= cellular_run_warmup(); pass++)
+    {
+        start = cellular_bench_now_ns();
+        for (started = 0; started < threads; started++)
+        {
+            pCallers[started].calls = calls;
+            pCallers[started].failures = 0;
+            if (pthread_create(&pThreads[started], NULL, transport_caller_thread, &pCallers[started]) != 0)
+            {
+                break;
+            }
+        }
+        for (i = 0; i < started; i++)
+        {
+            pthread_join(pThreads[i], NULL);
+            failures += pCallers[i].failures;
+        }
+        ns = cellular_bench_now_ns() - start;
+    }
+    UT_ASSERT_EQUAL(started, threads);
+    UT_ASSERT_EQUAL(failures, 0);
+    if ((started == 0) || (ns == 0))
+    {
+        return 0.0;
+    }
+    UT_LOG_INFO("%s: %u threads x %u calls in %llu ms, %.0f calls/s", pTransport, started, calls,
+                (unsigned long long)(ns / 1000000), (double)(started * calls) * 1e9 / (double)ns);
+    cellular_metrics_set("transport_calls_per_second", "HAL calls completed per second from concurrent callers", pTransport,
+                         (double)(started * calls) * 1e9 / (double)ns);
+    cellular_metrics_set("transport_call_seconds", "Mean HAL call time seen by one of the concurrent callers", pTransport,
+                         (double)ns / 1e9 / (double)calls);
+    return (double)(started * calls) * 1e9 / (double)ns;
+}
+
+/**
+ * @brief Throughput of concurrent HAL calls over the serial AT transport and the pipelined control protocol
+ *
+ * Both emulators give the identity request the same latency. AT has one command on the line at a
+ * time, so the callers queue behind each other; the control protocol has all of them outstanding.
+ *
+ * **Test Group ID:** Module: 02 @n
+ * **Test Case ID:** 019 @n
+ * **Priority:** Low @n@n
+ *
+ * **Pre-Conditions:** Simulator linked @n
+ * **Dependencies:** None @n
+ * **User Interaction:** If user chose to run the test in interactive mode, then the test case has to be selected via console. @n
+ *
+ * **Test Procedure:** @n
+ * | Variation / Step | Description | Test Data | Expected Result | Notes |
+ * | :----: | :---------: | :----------: | :--------------: | :-----: |
+ * | 01 | Start the emulators which CELLULAR_ATMODEM and CELLULAR_CTLMODEM did not start, give +CGSN and get_identity a latency | cellular.bench.transport.latency_ms | RETURN_OK | Should be successful |
+ * | 02 | Send the HAL calls over the pty, call cellular_hal_get_device_imei from concurrent threads and publish the rate | cellular.bench.transport.threads, cellular.bench.transport.calls | RETURN_OK for every call | Should be successful |
+ * | 03 | Repeat over the control-protocol socket | As above | RETURN_OK for every call, more calls per second than over AT, more than one request outstanding at once | Should be successful |
+ * | 04 | Remove the latencies, stop the emulators this test started and go back to the transports set before | None | None | Should be successful |
+ */
+void test_l2_cellular_hal_transport_benchmark(void)
+{
+    gTestID = 19;
+    UT_LOG_INFO("In %s [%02d%03d]\n", __FUNCTION__, gTestGroup, gTestID);
+
+    int latency = (int)bench_config("cellular.bench.transport.latency_ms", 2);
+    unsigned int threads = bench_config("cellular.bench.transport.threads", 4);
+    unsigned int calls = bench_config("cellular.bench.transport.calls", 50);
+    CellularCtlmodemStats_t stats;
+    int atStarted = 0, ctlStarted = 0;
+    double atRate, ctlRate;
+
+    if (!cellular_sim_available())
+    {
+        UT_LOG_INFO("Skipped: a vendor HAL talks to its own modem");
+        return;
+    }
+    if (threads > CELLULAR_CTLMODEM_MAX_PENDING)
+    {
+        threads = CELLULAR_CTLMODEM_MAX_PENDING;
+    }
+    if (cellular_atmodem_path() == NULL)
+    {
+        atStarted = (cellular_atmodem_start(CELLULAR_ATMODEM_DEFAULT_BAUD, 0) == RETURN_OK);
+    }
+    if (cellular_ctlmodem_path() == NULL)
+    {
+        ctlStarted = (cellular_ctlmodem_start(0) == RETURN_OK);
+    }
+    if ((cellular_atmodem_path() == NULL) || (cellular_ctlmodem_path() == NULL))
+    {
+        UT_FAIL("emulator start failed");
+    }
+    else
+    {
+        cellular_atmodem_set_latency("+CGSN", latency);
+        cellular_ctlmodem_set_latency("get_identity", latency);
+
+        cellular_sim_set_ctl_device(NULL);
+        UT_ASSERT_EQUAL(cellular_sim_set_at_device(cellular_atmodem_path()), 0);
+        atRate = transport_run("at", threads, calls);
+
+        UT_ASSERT_EQUAL(cellular_sim_set_ctl_device(cellular_ctlmodem_path()), 0);
+        ctlRate = transport_run("ctl", threads, calls);
+        cellular_ctlmodem_get_stats(&stats);
+        UT_LOG_INFO("Control protocol %.1fx the AT rate, %u requests outstanding at most", (atRate > 0.0) ? ctlRate / atRate : 0.0,
+                    stats.max_outstanding);
+        UT_ASSERT_TRUE(ctlRate > atRate);
+        UT_ASSERT_TRUE((threads < 2) || (stats.max_outstanding > 1));
+
+        cellular_atmodem_set_latency("+CGSN", -1);
+        cellular_ctlmodem_set_latency("get_identity", -1);
+    }
+
+    cellular_sim_set_at_device(atStarted ? NULL : cellular_atmodem_path());
+    cellular_sim_set_ctl_device(ctlStarted ? NULL : cellular_ctlmodem_path());
+    if (atStarted)
+    {
+        cellular_atmodem_stop();
+    }
+    if (ctlStarted)
+    {
+        cellular_ctlmodem_stop();
+    }
+
+    UT_LOG_INFO("Out %s\n", __FUNCTION__);
+}
+
+typedef struct
+{
+    volatile int stop;
+    uint64_t calls;
+    uint64_t ns;
+} StatsPoller_t;
+
+static void *stats_poller_thread(void *pArg)
+{
+    StatsPoller_t *pPoller = (StatsPoller_t *)pArg;
+    CellularPacketStatsStruct stats;
+    uint64_t start;
+
+    while (!pPoller->stop)
+    {
+        start = cellular_bench_now_ns();
+        cellular_hal_get_packet_statistics(&stats);
+        pPoller->ns += cellular_bench_now_ns() - start;
+        pPoller->calls++;
+    }
+    return NULL;
+}
+
+/* Relative difference of a HAL counter from the kernel's, published per counter */
+static double counter_error(const char *pCounter, unsigned long hal, uint64_t kernel)
+{
+    double error = (kernel > 0) ? (((double)hal > (double)kernel) ? (double)hal - (double)kernel : (double)kernel - (double)hal) / (double)kernel : 0.0;
+
+    UT_LOG_INFO("%s: HAL %lu, kernel %llu", pCounter, hal, (unsigned long long)kernel);
+    cellular_metrics_set("dataplane_counter_error_ratio", "Difference of a HAL packet counter from the TUN device's, relative to the device's", pCounter, error);
+    return error;
+}
+
+/**
+ * @brief Packet statistics against the kernel's counters of the session's TUN device, and their cost under load
+ *
+ * **Test Group ID:** Module: 02 @n
+ * **Test Case ID:** 020 @n
+ * **Priority:** Low @n@n
+ *
+ * **Pre-Conditions:** Simulator linked, CAP_SYS_ADMIN and CAP_NET_ADMIN, /dev/net/tun @n
+ * **Dependencies:** None @n
+ * **User Interaction:** If user chose to run the test in interactive mode, then the test case has to be selected via console. @n
+ *
+ * **Test Procedure:** @n
+ * | Variation / Step | Description | Test Data | Expected Result | Notes |
+ * | :----: | :---------: | :----------: | :--------------: | :-----: |
+ * | 01 | Enable the data plane and start an IPv4 session | Default profile | RETURN_OK, interface up | Should be successful |
+ * | 02 | Push traffic both ways without polling and publish the rate | cellular.bench.dataplane.megabits, cellular.bench.dataplane.packet_size | 0 | Should be successful |
+ * | 03 | Push it again while a thread polls cellular_hal_get_packet_statistics, publish the rate and the cost of a poll | As above | 0, RETURN_OK | Should be successful |
+ * | 04 | Compare the HAL counters with the device's once the modem read everything | None | Equal packets and bytes both ways | Should be successful |
+ * | 05 | Stop the session, drop the data plane and reset the modem | None | RETURN_OK | Should be successful |
+ */
+void test_l2_cellular_hal_data_plane(void)
+{
+    gTestID = 20;
+    UT_LOG_INFO("In %s [%02d%03d]\n", __FUNCTION__, gTestGroup, gTestID);
+
+    uint64_t bytes = (uint64_t)bench_config("cellular.bench.dataplane.megabits", 1000) * 125000ULL;
+    uint32_t packetSize = bench_config("cellular.bench.dataplane.packet_size", 1400);
+    static const char *variants[] = { "unpolled", "polled" };
+    CellularNetworkCBStruct callbacks;
+    CellularInterfaceStatus_t status = IF_DOWN;
+    CellularPacketStatsStruct stats;
+    CellularSimLinkStats_t link;
+    CellularSimTraffic_t traffic;
+    StatsPoller_t poller;
+    pthread_t thread;
+    unsigned int i, pass, waited;
+    int failed = 0;
+    double error = 0.0;
+
+    if (!cellular_sim_available())
+    {
+        UT_LOG_INFO("Skipped: a vendor HAL has the modem's own data path");
+        return;
+    }
+    if (cellular_sim_set_data_plane(1) != 0)
+    {
+        UT_LOG_INFO("Skipped: no network namespace or TUN device without CAP_SYS_ADMIN and CAP_NET_ADMIN");
+        return;
+    }
+    cellular_sim_reset();
+    memset(&callbacks, 0, sizeof(callbacks));
+    UT_ASSERT_EQUAL(cellular_hal_start_network(CELLULAR_NETWORK_IP_FAMILY_IPV4, NULL, &callbacks), RETURN_OK);
+    for (waited = 0; (waited < 2000) && (status != IF_UP); waited += 5)
+    {
+        cellular_bench_sleep_ms(5);
+        cellular_hal_get_current_modem_interface_status(&status);
+    }
+    if ((status != IF_UP) || (cellular_sim_get_link_stats(&link) != 0))
+    {
+        UT_FAIL("session did not come up on the data plane");
+        cellular_sim_set_data_plane(0);
+        cellular_sim_reset();
+        return;
+    }
+
+    for (i = 0; i < sizeof(variants) / sizeof(variants[0]); i++)
+    {
+        /* The passes before the last are warm-up */
+        for (pass = 0; pass <= cellular_run_warmup(); pass++)
+        {
+            memset(&poller, 0, sizeof(poller));
+            if ((i == 1) && (pthread_create(&thread, NULL, stats_poller_thread, &poller) != 0))
+            {
+                UT_FAIL("poller thread failed");
+                failed = 1;
+                break;
+            }
+            UT_ASSERT_EQUAL(cellular_sim_generate_traffic(bytes, bytes, packetSize, &traffic), 0);
+            if (i == 1)
+            {
+                poller.stop = 1;
+                pthread_join(thread, NULL);
+            }
+        }
+        if (failed)
+        {
+            break;
+        }
+        if (traffic.elapsed_ns > 0)
+        {
+            UT_LOG_INFO("%s: %llu + %llu packets in %llu ms, %.0f Mbit/s", variants[i], (unsigned long long)traffic.uplink_packets,
+                        (unsigned long long)traffic.downlink_packets, (unsigned long long)(traffic.elapsed_ns / 1000000),
+                        (double)(traffic.uplink_bytes + traffic.downlink_bytes) * 8000.0 / (double)traffic.elapsed_ns);
+            cellular_metrics_set("dataplane_megabits_per_second", "Traffic pushed through the TUN device, both directions", variants[i],
+                                 (double)(traffic.uplink_bytes + traffic.downlink_bytes) * 8000.0 / (double)traffic.elapsed_ns);
+        }
+        if (poller.calls > 0)
+        {
+            UT_LOG_INFO("%llu packet statistics polls, %llu ns each", (unsigned long long)poller.calls,
+                        (unsigned long long)(poller.ns / poller.calls));
+            cellular_metrics_set("dataplane_stats_poll_seconds", "Mean cellular_hal_get_packet_statistics time under load", NULL,
+                                 (double)poller.ns / 1e9 / (double)poller.calls);
+        }
+    }
+
+    /* The modem counts a packet right after the kernel hands it over */
+    for (waited = 0; waited < 1000; waited += 5)
+    {
+        UT_ASSERT_EQUAL(cellular_hal_get_packet_statistics(&stats), RETURN_OK);
+        UT_ASSERT_EQUAL(cellular_sim_get_link_stats(&link), 0);
+        if ((stats.PacketsSent == link.tx_packets) && (stats.PacketsReceived == link.rx_packets))
+        {
+            break;
+        }
+        cellular_bench_sleep_ms(5);
+    }
+    UT_LOG_INFO("Device drops: %llu sent, %llu received", (unsigned long long)link.tx_dropped, (unsigned long long)link.rx_dropped);
+    error += counter_error("packets_sent", stats.PacketsSent, link.tx_packets);
+    error += counter_error("bytes_sent", stats.BytesSent, link.tx_bytes);
+    error += counter_error("packets_received", stats.PacketsReceived, link.rx_packets);
+    error += counter_error("bytes_received", stats.BytesReceived, link.rx_bytes);
+    UT_ASSERT_TRUE(error == 0.0);
+    UT_ASSERT_TRUE(stats.PacketsReceived >= 2 * traffic.downlink_packets);
+
+    UT_ASSERT_EQUAL(cellular_hal_stop_network(CELLULAR_NETWORK_IP_FAMILY_IPV4), RETURN_OK);
+    cellular_sim_set_data_plane(0);
+    cellular_sim_reset();
+
+    UT_LOG_INFO("Out %s\n", __FUNCTION__);
+}
+
+/* Latest slot and registration callbacks, for the benchmarks timing them */
+static pthread_mutex_t gCallbackLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t gCallbackCond = PTHREAD_COND_INITIALIZER;
+static int gSlotReady = -1;
+static int gRegistration = DEVICE_NAS_STATUS_NOT_REGISTERED;
+static unsigned int gRegistrationLosses = 0;
+static char gSlotType[8];
+
+static int uicc_slot_status_cb(char *slot_name, char *slot_type, int slot_num, CellularDeviceSlotStatus_t device_slot_status)
+{
+    (void)slot_name;
+    pthread_mutex_lock(&gCallbackLock);
+    if (device_slot_status == DEVICE_SLOT_STATUS_READY)
+    {
+        gSlotReady = slot_num;
+        snprintf(gSlotType, sizeof(gSlotType), "%s", slot_type);
+    }
+    pthread_cond_broadcast(&gCallbackCond);
+    pthread_mutex_unlock(&gCallbackLock);
+    return RETURN_OK;
+}
+
+static int registration_status_cb(CellularDeviceNASStatus_t device_registration_status, CellularDeviceNASRoamingStatus_t roaming_status,
+                                  CellularModemRegisteredServiceType_t registered_service)
+{
+    (void)roaming_status;
+    (void)registered_service;
+    pthread_mutex_lock(&gCallbackLock);
+    gRegistrationLosses += ((gRegistration == DEVICE_NAS_STATUS_REGISTERED) && (device_registration_status != DEVICE_NAS_STATUS_REGISTERED));
+    gRegistration = device_registration_status;
+    pthread_cond_broadcast(&gCallbackCond);
+    pthread_mutex_unlock(&gCallbackLock);
+    return RETURN_OK;
+}
+
+/* Waits until *pValue is 'expected'; returns the ns since 'start', at least 1, or 0 on timeout */
+static uint64_t callback_wait(const int *pValue, int expected, uint64_t start, unsigned int timeout_ms)
+{
+    struct timespec deadline;
+    uint64_t waited = 0;
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += (timeout_ms / 1000) + 1;
+    pthread_mutex_lock(&gCallbackLock);
+    while ((*pValue != expected) && (pthread_cond_timedwait(&gCallbackCond, &gCallbackLock, &deadline) != ETIMEDOUT))
+    {
+    }
+    if (*pValue == expected)
+    {
+        waited = cellular_bench_now_ns() - start;
+        waited = (waited > 0) ? waited : 1;
+    }
+    pthread_mutex_unlock(&gCallbackLock);
+    return waited;
+}
+
+/**
+ * @brief Every UICC slot's contents, and the time to power a slot's card and to switch to it until registered
+ *
+ * **Test Group ID:** Module: 02 @n
+ * **Test Case ID:** 021 @n
+ * **Priority:** Medium @n@n
+ *
+ * **Pre-Conditions:** Steps 02 to 05 need the simulator @n
+ * **Dependencies:** None @n
+ * **User Interaction:** If user chose to run the test in interactive mode, then the test case has to be selected via console. @n
+ *
+ * **Test Procedure:** @n
+ * | Variation / Step | Description | Test Data | Expected Result | Notes |
+ * | :----: | :---------: | :----------: | :--------------: | :-----: |
+ * | 01 | Invoke cellular_hal_get_uicc_slot_info for every slot of cellular_hal_get_total_no_of_uicc_slots | None | RETURN_OK, a distinct ICCID per present card | Should be successful |
+ * | 02 | Toggle the power of every slot and publish the mean time of a toggle | cellular.bench.slots.toggles | RETURN_OK | Should be successful |
+ * | 03 | Switch to every other slot in turn: power it, power off the active one, invoke cellular_hal_select_device_slot | None | READY for the new slot, then REGISTERED | Should be successful |
+ * | 04 | Publish the time to READY and to registration per slot | None | None | Should be successful |
+ * | 05 | Take the card out of the next slot and power off the active one | None | the slot after the empty one is selected | Should be successful |
+ */
+void test_l2_cellular_hal_uicc_slots(void)
+{
+    gTestID = 21;
+    UT_LOG_INFO("In %s [%02d%03d]\n", __FUNCTION__, gTestGroup, gTestID);
+
+    unsigned int toggles = bench_config("cellular.bench.slots.toggles", 10);
+    CellularUICCSlotInfoStruct info[CELLULAR_SIM_MAX_SLOTS];
+    CellularUICCSlotInfoStruct empty;
+    CellularSimConfig_t config;
+    unsigned int total = 0;
+    unsigned int active = 0;
+    unsigned int slot, i, j, pass;
+    uint64_t start, ready, registered, ns = 0;
+    char variant[16];
+    int failed = 0;
+
+    UT_ASSERT_EQUAL(cellular_hal_get_total_no_of_uicc_slots(&total), RETURN_OK);
+    UT_LOG_INFO("%u UICC slots", total);
+    for (i = 0; (i < total) && (i < CELLULAR_SIM_MAX_SLOTS); i++)
+    {
+        memset(&info[i], 0, sizeof(info[i]));
+        UT_ASSERT_EQUAL(cellular_hal_get_uicc_slot_info(i, &info[i]), RETURN_OK);
+        UT_LOG_INFO("slot%u: present %d, enabled %d, application %d, status %d, ICCID %s", i + 1, info[i].IsCardPresent,
+                    info[i].CardEnable, info[i].Application, info[i].Status, info[i].iccid);
+        for (j = 0; j < i; j++)
+        {
+            if (info[i].IsCardPresent && info[j].IsCardPresent && (strcmp(info[i].iccid, info[j].iccid) == 0))
+            {
+                UT_FAIL("two cards with the same ICCID");
+            }
+        }
+    }
+
+    if (!cellular_sim_available())
+    {
+        UT_LOG_INFO("Skipped the switches: they take the cards of a vendor HAL out of service");
+        UT_LOG_INFO("Out %s\n", __FUNCTION__);
+        return;
+    }
+    cellular_sim_reset();
+    cellular_sim_get_config(&config);
+    UT_ASSERT_EQUAL(cellular_hal_monitor_device_registration(registration_status_cb), RETURN_OK);
+
+    for (slot = 0; slot < total; slot++)
+    {
+        /* The passes before the last are warm-up */
+        for (pass = 0; pass <= cellular_run_warmup(); pass++)
+        {
+            start = cellular_bench_now_ns();
+            for (i = 0; i < toggles; i++)
+            {
+                UT_ASSERT_EQUAL(cellular_hal_sim_power_enable(slot, 0), RETURN_OK);
+                UT_ASSERT_EQUAL(cellular_hal_sim_power_enable(slot, 1), RETURN_OK);
+            }
+            ns = cellular_bench_now_ns() - start;
+        }
+        snprintf(variant, sizeof(variant), "slot%u", slot + 1);
+        cellular_metrics_set("uicc_power_toggle_seconds", "Mean time of a cellular_hal_sim_power_enable off and on", variant,
+                             (double)ns / 1e9 / (double)toggles);
+    }
+    /* Toggling the active slot took its registration down and up again */
+    UT_ASSERT_TRUE(callback_wait(&gRegistration, DEVICE_NAS_STATUS_REGISTERED, cellular_bench_now_ns(), 2000) > 0);
+
+    /* Each pass switches through every slot back to the first; the passes before the last are warm-up */
+    for (pass = 0; (pass <= cellular_run_warmup()) && !failed; pass++)
+    {
+        for (i = 1; i <= total; i++)
+        {
+            slot = (active + 1) % total;
+            if (slot == active)
+            {
+                break;
+            }
+            UT_ASSERT_EQUAL(cellular_hal_sim_power_enable(slot, 1), RETURN_OK);
+            UT_ASSERT_EQUAL(cellular_hal_sim_power_enable(active, 0), RETURN_OK);
+            UT_ASSERT_TRUE(callback_wait(&gRegistration, DEVICE_NAS_STATUS_NOT_REGISTERED, cellular_bench_now_ns(), 2000) > 0);
+            pthread_mutex_lock(&gCallbackLock);
+            gSlotReady = -1;
+            pthread_mutex_unlock(&gCallbackLock);
+            start = cellular_bench_now_ns();
+            UT_ASSERT_EQUAL(cellular_hal_select_device_slot(uicc_slot_status_cb), RETURN_OK);
+            ready = callback_wait(&gSlotReady, (int)slot, start, 2000);
+            registered = callback_wait(&gRegistration, DEVICE_NAS_STATUS_REGISTERED, start, 2000);
+            if ((ready == 0) || (registered == 0))
+            {
+                UT_FAIL("slot switch did not complete");
+                failed = 1;
+                break;
+            }
+            UT_ASSERT_TRUE(registered >= (uint64_t)(config.slot_select_delay_ms + config.registration_delay_ms) * 1000000ULL);
+            if (pass == cellular_run_warmup())
+            {
+                UT_LOG_INFO("slot%u -> slot%u (%s): ready after %llu us, registered after %llu us", active + 1, slot + 1, gSlotType,
+                            (unsigned long long)(ready / 1000), (unsigned long long)(registered / 1000));
+                snprintf(variant, sizeof(variant), "slot%u", slot + 1);
+                cellular_metrics_set("uicc_slot_switch_seconds", "cellular_hal_select_device_slot until the slot is ready", variant, (double)ready / 1e9);
+                cellular_metrics_set("uicc_slot_registration_seconds", "cellular_hal_select_device_slot until registered on the slot's card", variant,
+                                     (double)registered / 1e9);
+            }
+            active = slot;
+        }
+    }
+
+    /* An empty slot is passed over */
+    if (total >= 3)
+    {
+        memset(&empty, 0, sizeof(empty));
+        empty.SlotEnable = TRUE;
+        empty.CardEnable = TRUE;
+        empty.Status = CELLULAR_UICC_STATUS_EMPTY;
+        UT_ASSERT_EQUAL(cellular_sim_set_slot_info((active + 1) % total, &empty), 0);
+        UT_ASSERT_EQUAL(cellular_hal_sim_power_enable((active + 2) % total, 1), RETURN_OK);
+        UT_ASSERT_EQUAL(cellular_hal_sim_power_enable(active, 0), RETURN_OK);
+        pthread_mutex_lock(&gCallbackLock);
+        gSlotReady = -1;
+        pthread_mutex_unlock(&gCallbackLock);
+        UT_ASSERT_EQUAL(cellular_hal_select_device_slot(uicc_slot_status_cb), RETURN_OK);
+        UT_ASSERT_TRUE(callback_wait(&gSlotReady, (int)((active + 2) % total), cellular_bench_now_ns(), 2000) > 0);
+    }
+    cellular_sim_reset();
+
+    UT_LOG_INFO("Out %s\n", __FUNCTION__);
+}
+
+/* RSRP of 'count' single steps through the HAL, for the correlation and reproducibility checks */
+static void channel_trajectory(int *pRsrp, unsigned int count)
+{
+    CellularSignalInfoStruct signalInfo;
+    unsigned int i;
+
+    for (i = 0; i < count; i++)
+    {
+        cellular_sim_step_channel(1);
+        memset(&signalInfo, 0, sizeof(signalInfo));
+        cellular_hal_get_signal_info(&signalInfo);
+        pRsrp[i] = signalInfo.RSRP;
+    }
+}
+
+/* Lag one autocorrelation of a series */
+static double lag_correlation(const int *pValues, unsigned int count)
+{
+    double mean = 0.0, variance = 0.0, covariance = 0.0;
+    unsigned int i;
+
+    for (i = 0; i < count; i++)
+    {
+        mean += (double)pValues[i] / (double)count;
+    }
+    for (i = 0; i < count; i++)
+    {
+        variance += ((double)pValues[i] - mean) * ((double)pValues[i] - mean);
+        covariance += (i > 0) ? ((double)pValues[i] - mean) * ((double)pValues[i - 1] - mean) : 0.0;
+    }
+    return (variance > 0.0) ? covariance / variance : 0.0;
+}
+
+/**
+ * @brief Signal, serving cell and radio technology driven by the simulator's channel model and by a recorded trace
+ *
+ * **Test Group ID:** Module: 02 @n
+ * **Test Case ID:** 022 @n
+ * **Priority:** Medium @n@n
+ *
+ * **Pre-Conditions:** Simulator linked @n
+ * **Dependencies:** None @n
+ * **User Interaction:** If user chose to run the test in interactive mode, then the test case has to be selected via console. @n
+ *
+ * **Test Procedure:** @n
+ * | Variation / Step | Description | Test Data | Expected Result | Notes |
+ * | :----: | :---------: | :----------: | :--------------: | :-----: |
+ * | 01 | Step the model twice from the same seed, reading the signal through cellular_hal_get_signal_info | cellular.bench.channel.seed | Same RSRP trajectory, lag one correlation above 0.5, values in range | Should be successful |
+ * | 02 | Step it over a long drive and publish the rates of signal, cell, area and technology changes | cellular.bench.channel.steps | Handovers and technology changes seen, cell id as reported by cellular_hal_get_current_plmn_information | Should be successful |
+ * | 03 | Restrict the preferred technology to LTE and step on | preferred_rat = "LTE" | cellular_hal_get_modem_current_radio_technology never NR | Should be successful |
+ * | 04 | Replay a trace line by line | Three lines | Each line's values through the HAL | Should be successful |
+ * | 05 | Run the model on the event thread | 10 ms steps for 200 ms | Steps taken | Should be successful |
+ */
+void test_l2_cellular_hal_channel_model(void)
+{
+    gTestID = 22;
+    UT_LOG_INFO("In %s [%02d%03d]\n", __FUNCTION__, gTestGroup, gTestID);
+
+    const unsigned int count = 1000;
+    unsigned int steps = bench_config("cellular.bench.channel.steps", 36000);
+    char path[] = "/tmp/cellular_channel_XXXXXX";
+    static const char trace[] = "# ms RSSI RSRQ RSRP SNR TXPower cell area RAT\n"
+                                "0 -60 -8 -85 22 2 0x100 0x10 NR\n"
+                                "500 -75 -12 -104 6 17 0x100 0x10 LTE\n"
+                                "1500 -85 -15 -117 -2 23 0x101 0x11 UMTS\n";
+    static const char *variants[] = { "signal", "cell", "area", "rat" };
+    CellularSimChannel_t channel;
+    CellularSimChannelStats_t stats;
+    CellularSignalInfoStruct signalInfo;
+    CellularCurrentPlmnInfoStruct plmn;
+    char rat[128];
+    int *pFirst = (int *)calloc(count, sizeof(int));
+    int *pSecond = (int *)calloc(count, sizeof(int));
+    uint64_t changes[4];
+    unsigned int i;
+    int nr = 0, fd;
+    double seconds;
+
+    if (!cellular_sim_available())
+    {
+        UT_LOG_INFO("Skipped: a vendor HAL reports the real radio");
+        free(pFirst);
+        free(pSecond);
+        return;
+    }
+    if ((pFirst == NULL) || (pSecond == NULL))
+    {
+        UT_FAIL("Memory allocation with malloc failed");
+        free(pFirst);
+        free(pSecond);
+        return;
+    }
+    cellular_sim_reset();
+    cellular_sim_default_channel(&channel);
+    channel.seed = bench_config("cellular.bench.channel.seed", 1);
+    channel.timed = 0;
+
+    UT_ASSERT_EQUAL(cellular_sim_set_channel(&channel), 0);
+    channel_trajectory(pFirst, count);
+    UT_ASSERT_EQUAL(cellular_sim_set_channel(&channel), 0);
+    channel_trajectory(pSecond, count);
+    UT_ASSERT_EQUAL(memcmp(pFirst, pSecond, count * sizeof(int)), 0);
+    UT_LOG_INFO("RSRP lag one correlation over %u steps: %.3f", count, lag_correlation(pFirst, count));
+    UT_ASSERT_TRUE(lag_correlation(pFirst, count) > 0.5);
+    UT_ASSERT_EQUAL(cellular_hal_get_signal_info(&signalInfo), RETURN_OK);
+    UT_ASSERT_TRUE((signalInfo.RSRP >= -140) && (signalInfo.RSRP <= -44));
+    UT_ASSERT_TRUE((signalInfo.RSRQ >= -20) && (signalInfo.RSRQ <= -3));
+    UT_ASSERT_TRUE((signalInfo.SNR >= -20) && (signalInfo.SNR <= 30));
+    UT_ASSERT_TRUE((signalInfo.TXPower >= -40) && (signalInfo.TXPower <= 23));
+    UT_ASSERT_TRUE(signalInfo.RSSI > signalInfo.RSRP);
+
+    UT_ASSERT_EQUAL(cellular_sim_set_channel(&channel), 0);
+    UT_ASSERT_EQUAL(cellular_sim_step_channel(steps), 0);
+    UT_ASSERT_EQUAL(cellular_sim_get_channel_stats(&stats), 0);
+    UT_ASSERT_EQUAL(cellular_hal_get_current_plmn_information(&plmn), RETURN_OK);
+    UT_LOG_INFO("%llu steps over %llu s: %llu signal changes, %llu handovers, %llu area changes, %llu technology changes, now in cell %lu",
+                (unsigned long long)stats.steps, (unsigned long long)(stats.simulated_ms / 1000), (unsigned long long)stats.signal_changes,
+                (unsigned long long)stats.handovers, (unsigned long long)stats.area_changes, (unsigned long long)stats.rat_changes, plmn.cell_id);
+    UT_ASSERT_EQUAL(stats.steps, steps);
+    UT_ASSERT_TRUE(stats.handovers > 0);
+    UT_ASSERT_TRUE(stats.rat_changes > 0);
+    UT_ASSERT_TRUE(plmn.cell_id != 0x1A2B3C);
+    changes[0] = stats.signal_changes;
+    changes[1] = stats.handovers;
+    changes[2] = stats.area_changes;
+    changes[3] = stats.rat_changes;
+    seconds = (double)stats.simulated_ms / 1000.0;
+    for (i = 0; (i < 4) && (seconds > 0.0); i++)
+    {
+        cellular_metrics_set("channel_changes_per_second", "Changes per simulated second of the default channel model", variants[i],
+                             (double)changes[i] / seconds);
+    }
+
+    UT_ASSERT_EQUAL(cellular_hal_set_modem_preferred_radio_technology("LTE"), RETURN_OK);
+    for (i = 0; i < count; i++)
+    {
+        cellular_sim_step_channel(10);
+        UT_ASSERT_EQUAL(cellular_hal_get_modem_current_radio_technology(rat), RETURN_OK);
+        nr += (strcmp(rat, "NR") == 0);
+    }
+    UT_ASSERT_EQUAL(nr, 0);
+    UT_ASSERT_EQUAL(cellular_hal_set_modem_preferred_radio_technology("AUTO"), RETURN_OK);
+
+    fd = mkstemp(path);
+    if ((fd < 0) || (write(fd, trace, sizeof(trace) - 1) != (ssize_t)(sizeof(trace) - 1)))
+    {
+        UT_FAIL("temporary file creation failed");
+    }
+    else
+    {
+        UT_ASSERT_EQUAL(cellular_sim_set_channel_trace(path, 0), 0);
+        cellular_hal_get_signal_info(&signalInfo);
+        UT_ASSERT_EQUAL(signalInfo.RSRP, -85);
+        cellular_hal_get_modem_current_radio_technology(rat);
+        UT_ASSERT_EQUAL(strcmp(rat, "NR"), 0);
+        cellular_sim_step_channel(2);
+        cellular_hal_get_signal_info(&signalInfo);
+        cellular_hal_get_current_plmn_information(&plmn);
+        cellular_hal_get_modem_current_radio_technology(rat);
+        UT_ASSERT_TRUE((signalInfo.RSRP == -117) && (signalInfo.SNR == -2) && (signalInfo.TXPower == 23));
+        UT_ASSERT_TRUE((plmn.cell_id == 0x101) && (plmn.area_code == 0x11));
+        UT_ASSERT_EQUAL(strcmp(rat, "UMTS"), 0);
+        cellular_sim_get_channel_stats(&stats);
+        UT_ASSERT_TRUE((stats.steps == 2) && (stats.simulated_ms == 1500) && (stats.handovers == 1) && (stats.rat_changes == 2));
+    }
+    if (fd >= 0)
+    {
+        close(fd);
+        unlink(path);
+    }
+
+    channel.timed = 1;
+    channel.step_ms = 10;
+    UT_ASSERT_EQUAL(cellular_sim_set_channel(&channel), 0);
+    cellular_bench_sleep_ms(200);
+    cellular_sim_get_channel_stats(&stats);
+    UT_LOG_INFO("%llu timed steps in 200 ms", (unsigned long long)stats.steps);
+    UT_ASSERT_TRUE(stats.steps >= 10);
+
+    cellular_sim_set_channel(NULL);
+    cellular_sim_reset();
+    free(pFirst);
+    free(pSecond);
+    UT_LOG_INFO("Out %s\n", __FUNCTION__);
+}
+
+#define RAT_SWITCH_MAX_VALUES 8
+
+/* 1 when the current technology is one the preference allows */
+static int rat_in_preference(const char *pCurrent, const char *pPreferred)
+{
+    char copy[128];
+    char *pSave = NULL;
+    char *pToken;
+
+    if (pCurrent[0] == '\0')
+    {
+        return 0;
+    }
+    if (strcmp(pPreferred, "AUTO") == 0)
+    {
+        return 1;
+    }
+    snprintf(copy, sizeof(copy), "%s", pPreferred);
+    for (pToken = strtok_r(copy, ",", &pSave); pToken != NULL; pToken = strtok_r(NULL, ",", &pSave))
+    {
+        if (strstr(pCurrent, pToken) != NULL)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Sets the preference and waits until the modem uses it and is registered; returns the ns of the call, the change and the registration, 0 on failure */
+static int rat_switch(const char *pPreferred, unsigned int timeout_ms, uint64_t *pCallNs, uint64_t *pChangeNs, uint64_t *pServiceNs)
+{
+    char value[128];
+    char current[128];
+    uint64_t start, deadline;
+    unsigned int losses;
+
+    snprintf(value, sizeof(value), "%s", pPreferred);
+    pthread_mutex_lock(&gCallbackLock);
+    losses = gRegistrationLosses;
+    pthread_mutex_unlock(&gCallbackLock);
+    start = cellular_bench_now_ns();
+    deadline = start + (uint64_t)timeout_ms * 1000000ULL;
+    if (cellular_hal_set_modem_preferred_radio_technology(value) != RETURN_OK)
+    {
+        return 0;
+    }
+    *pCallNs = cellular_bench_now_ns() - start;
+    do
+    {
+        memset(current, 0, sizeof(current));
+        cellular_hal_get_modem_current_radio_technology(current);
+        *pChangeNs = cellular_bench_now_ns() - start;
+        if (rat_in_preference(current, pPreferred))
+        {
+            break;
+        }
+        cellular_bench_sleep_ms(1);
+    } while (cellular_bench_now_ns() < deadline);
+    if (!rat_in_preference(current, pPreferred))
+    {
+        return 0;
+    }
+    /* Service was kept when the registration never dropped */
+    pthread_mutex_lock(&gCallbackLock);
+    losses = gRegistrationLosses - losses;
+    pthread_mutex_unlock(&gCallbackLock);
+    *pServiceNs = *pChangeNs;
+    if ((losses > 0) || (gRegistration != DEVICE_NAS_STATUS_REGISTERED))
+    {
+        *pServiceNs = callback_wait(&gRegistration, DEVICE_NAS_STATUS_REGISTERED, start, timeout_ms);
+    }
+    return (*pServiceNs > 0) ? 1 : 0;
+}
+
+/**
+ * @brief Time of every switch between the supported radio technologies, as a from/to matrix
+ *
+ * **Test Group ID:** Module: 02 @n
+ * **Test Case ID:** 023 @n
+ * **Priority:** Low @n@n
+ *
+ * **Pre-Conditions:** Modem registered @n
+ * **Dependencies:** None @n
+ * **User Interaction:** If user chose to run the test in interactive mode, then the test case has to be selected via console. @n
+ *
+ * **Test Procedure:** @n
+ * | Variation / Step | Description | Test Data | Expected Result | Notes |
+ * | :----: | :---------: | :----------: | :--------------: | :-----: |
+ * | 01 | Invoke cellular_hal_get_modem_supported_radio_technology and cellular_hal_get_modem_preferred_radio_technology | None | RETURN_OK | Should be successful |
+ * | 02 | For every ordered pair of supported values and AUTO, set the first and wait until it is in use and registered | cellular.bench.rat_switch.timeout_ms | RETURN_OK, registered | Should be successful |
+ * | 03 | Set the second and time the call, the change of cellular_hal_get_modem_current_radio_technology and the registration callback | None | RETURN_OK, registered again | Should be successful |
+ * | 04 | Log the matrices and publish each pair's times | None | None | Should be successful |
+ * | 05 | Restore the preferred radio technology | Value of step 01 | RETURN_OK | Should be successful |
+ */
+void test_l2_cellular_hal_rat_switch(void)
+{
+    gTestID = 23;
+    UT_LOG_INFO("In %s [%02d%03d]\n", __FUNCTION__, gTestGroup, gTestID);
+
+    unsigned int timeout_ms = bench_config("cellular.bench.rat_switch.timeout_ms", 30000);
+    CellularCurrentPlmnInfoStruct plmn;
+    char values[RAT_SWITCH_MAX_VALUES][16];
+    uint64_t changeNs[RAT_SWITCH_MAX_VALUES][RAT_SWITCH_MAX_VALUES];
+    uint64_t serviceNs[RAT_SWITCH_MAX_VALUES][RAT_SWITCH_MAX_VALUES];
+    char supported[128] = { 0 };
+    char original[128] = { 0 };
+    char row[256];
+    char pair[40];
+    char *pSave = NULL;
+    char *pToken;
+    uint64_t callNs, unused;
+    unsigned int count = 0, from, to, pass;
+    size_t used;
+    int failed = 0;
+
+    UT_ASSERT_EQUAL(cellular_hal_get_modem_supported_radio_technology(supported), RETURN_OK);
+    UT_ASSERT_EQUAL(cellular_hal_get_modem_preferred_radio_technology(original), RETURN_OK);
+    for (pToken = strtok_r(supported, ",", &pSave); (pToken != NULL) && (count < RAT_SWITCH_MAX_VALUES - 1); pToken = strtok_r(NULL, ",", &pSave))
+    {
+        snprintf(values[count++], sizeof(values[0]), "%s", pToken);
+    }
+    snprintf(values[count++], sizeof(values[0]), "AUTO");
+    memset(changeNs, 0, sizeof(changeNs));
+    memset(serviceNs, 0, sizeof(serviceNs));
+    memset(&plmn, 0, sizeof(plmn));
+    cellular_hal_get_current_plmn_information(&plmn);
+    pthread_mutex_lock(&gCallbackLock);
+    gRegistration = plmn.registration_status;
+    pthread_mutex_unlock(&gCallbackLock);
+    UT_ASSERT_EQUAL(cellular_hal_monitor_device_registration(registration_status_cb), RETURN_OK);
+
+    /* The passes before the last are warm-up */
+    for (pass = 0; (pass <= cellular_run_warmup()) && !failed; pass++)
+    {
+        for (from = 0; (from < count) && !failed; from++)
+        {
+            for (to = 0; (to < count) && !failed; to++)
+            {
+                if (to == from)
+                {
+                    continue;
+                }
+                if (!rat_switch(values[from], timeout_ms, &unused, &unused, &unused) ||
+                    !rat_switch(values[to], timeout_ms, &callNs, &changeNs[from][to], &serviceNs[from][to]))
+                {
+                    UT_LOG_ERROR("%s -> %s did not complete in %u ms", values[from], values[to], timeout_ms);
+                    UT_FAIL("radio technology switch failed");
+                    failed = 1;
+                    break;
+                }
+                if (pass < cellular_run_warmup())
+                {
+                    continue;
+                }
+                snprintf(pair, sizeof(pair), "%s->%s", values[from], values[to]);
+                cellular_metrics_set("rat_switch_call_seconds", "cellular_hal_set_modem_preferred_radio_technology call time", pair, (double)callNs / 1e9);
+                cellular_metrics_set("rat_switch_seconds", "Preferred radio technology set until the current one is within it", pair,
+                                     (double)changeNs[from][to] / 1e9);
+                cellular_metrics_set("rat_switch_service_seconds", "Preferred radio technology set until registered again", pair,
+                                     (double)serviceNs[from][to] / 1e9);
+            }
+        }
+    }
+
+    /* Rows are the technology switched from, columns the one switched to, in ms until registered */
+    used = (size_t)snprintf(row, sizeof(row), "%-8s", "from\\to");
+    for (to = 0; to < count; to++)
+    {
+        used += (size_t)snprintf(&row[used], sizeof(row) - used, "%9s", values[to]);
+    }
+    UT_LOG_INFO("%s", row);
+    for (from = 0; from < count; from++)
+    {
+        used = (size_t)snprintf(row, sizeof(row), "%-8s", values[from]);
+        for (to = 0; (to < count) && (used < sizeof(row)); to++)
+        {
+            if (to == from)
+            {
+                used += (size_t)snprintf(&row[used], sizeof(row) - used, "%9s", "-");
+            }
+            else
+            {
+                used += (size_t)snprintf(&row[used], sizeof(row) - used, "%9.1f", (double)serviceNs[from][to] / 1e6);
+            }
+        }
+        UT_LOG_INFO("%s", row);
+    }
+
+    UT_ASSERT_EQUAL(cellular_hal_set_modem_preferred_radio_technology(original), RETURN_OK);
+    if (cellular_sim_available())
+    {
+        cellular_sim_reset();
+    }
+    UT_LOG_INFO("Out %s\n", __FUNCTION__);
+}
+
+#define CYCLE_MAX_COUNT 1000
+
+/* Waits until the registration callback reported 'registration' and the interface is up or not; returns the ns since 'start', 0 on timeout */
+static uint64_t cycle_settle(int registration, int up, uint64_t start, unsigned int timeout_ms)
+{
+    CellularInterfaceStatus_t status = IF_UNKNOWN;
+    uint64_t deadline = start + (uint64_t)timeout_ms * 1000000ULL;
+
+    if (callback_wait(&gRegistration, registration, start, timeout_ms) == 0)
+    {
+        return 0;
+    }
+    for (;;)
+    {
+        cellular_hal_get_current_modem_interface_status(&status);
+        if ((status == IF_UP) == (up != 0))
+        {
+            return cellular_bench_now_ns() - start;
+        }
+        if (cellular_bench_now_ns() >= deadline)
+        {
+            return 0;
+        }
+        cellular_bench_sleep_ms(1);
+    }
+}
+
+/* Logs and publishes the median, 99th percentile and maximum of the samples as '<variant>,p50' and so on */
+static void latency_report(const char *pName, const char *pHelp, const char *pVariant, uint64_t *pSamples, unsigned int count)
+{
+    static const unsigned int percentiles[] = { 50, 99, 100 };
+    static const char *labels[] = { "p50", "p99", "max" };
+    uint64_t values[3];
+    char variant[64];
+    unsigned int i;
+
+    for (i = 0; i < 3; i++)
+    {
+        values[i] = cellular_bench_percentile(pSamples, count, percentiles[i]);
+        snprintf(variant, sizeof(variant), "%s,%s", pVariant, labels[i]);
+        cellular_metrics_set(pName, pHelp, variant, (double)values[i] / 1e9);
+    }
+    UT_LOG_INFO("%-26s p50 %8.1f ms, p99 %8.1f ms, max %8.1f ms", pVariant, (double)values[0] / 1e6, (double)values[1] / 1e6,
+                (double)values[2] / 1e6);
+}
+
+/**
+ * @brief Cycle time of attach/detach and of ONLINE/LOW_POWER, with the tail latency of each transition
+ *
+ * **Test Group ID:** Module: 02 @n
+ * **Test Case ID:** 024 @n
+ * **Priority:** Low @n@n
+ *
+ * **Pre-Conditions:** Modem registered @n
+ * **Dependencies:** None @n
+ * **User Interaction:** If user chose to run the test in interactive mode, then the test case has to be selected via console. @n
+ *
+ * **Test Procedure:** @n
+ * | Variation / Step | Description | Test Data | Expected Result | Notes |
+ * | :----: | :---------: | :----------: | :--------------: | :-----: |
+ * | 01 | Invoke cellular_hal_start_network and wait until registered and the interface is up | IPv4, default profile | RETURN_OK | Should be successful |
+ * | 02 | Invoke cellular_hal_set_modem_network_detach and cellular_hal_set_modem_network_attach in turn, each until registration and interface status settle | cellular.bench.cycles.count, timeout_ms | RETURN_OK, not registered and down, then registered and up | Should be successful |
+ * | 03 | Invoke cellular_hal_set_modem_operating_configuration with LOW_POWER and ONLINE in turn the same way | cellular.bench.cycles.count, timeout_ms | RETURN_OK, not registered and down, then registered and up | Should be successful |
+ * | 04 | Publish the cycles per second and the median, 99th percentile and maximum of every transition | None | None | Should be successful |
+ * | 05 | Invoke cellular_hal_stop_network | IPv4 | RETURN_OK | Should be successful |
+ */
+void test_l2_cellular_hal_power_cycles(void)
+{
+    gTestID = 24;
+    UT_LOG_INFO("In %s [%02d%03d]\n", __FUNCTION__, gTestGroup, gTestID);
+
+    unsigned int count = bench_config("cellular.bench.cycles.count", 20);
+    unsigned int timeout_ms = bench_config("cellular.bench.cycles.timeout_ms", 30000);
+    static const char *cycles[] = { "attach", "lowpower" };
+    static const char *transitions[][2] = { { "detach", "attach" }, { "lowpower", "online" } };
+    CellularCurrentPlmnInfoStruct plmn;
+    CellularNetworkCBStruct callbacks;
+    uint64_t *pSamples[2];
+    uint64_t start, down, up, ns = 0;
+    unsigned int cycle, i, pass;
+    double rate;
+    int result;
+    int failed = 0;
+
+    count = (count > CYCLE_MAX_COUNT) ? CYCLE_MAX_COUNT : count;
+    pSamples[0] = calloc(count, sizeof(uint64_t));
+    pSamples[1] = calloc(count, sizeof(uint64_t));
+    if ((pSamples[0] == NULL) || (pSamples[1] == NULL))
+    {
+        UT_FAIL("out of memory");
+        free(pSamples[0]);
+        free(pSamples[1]);
+        return;
+    }
+    if (cellular_sim_available())
+    {
+        cellular_sim_reset();
+    }
+    memset(&plmn, 0, sizeof(plmn));
+    cellular_hal_get_current_plmn_information(&plmn);
+    pthread_mutex_lock(&gCallbackLock);
+    gRegistration = plmn.registration_status;
+    pthread_mutex_unlock(&gCallbackLock);
+    UT_ASSERT_EQUAL(cellular_hal_monitor_device_registration(registration_status_cb), RETURN_OK);
+    memset(&callbacks, 0, sizeof(callbacks));
+    UT_ASSERT_EQUAL(cellular_hal_start_network(CELLULAR_NETWORK_IP_FAMILY_IPV4, NULL, &callbacks), RETURN_OK);
+    if (cycle_settle(DEVICE_NAS_STATUS_REGISTERED, 1, cellular_bench_now_ns(), timeout_ms) == 0)
+    {
+        UT_FAIL("session did not come up");
+        failed = 1;
+    }
+
+    for (cycle = 0; (cycle < 2) && !failed; cycle++)
+    {
+        /* The passes before the last are warm-up */
+        for (pass = 0; (pass <= cellular_run_warmup()) && !failed; pass++)
+        {
+            start = cellular_bench_now_ns();
+            for (i = 0; (i < count) && !failed; i++)
+            {
+                down = cellular_bench_now_ns();
+                result = (cycle == 0) ? cellular_hal_set_modem_network_detach() :
+                                        cellular_hal_set_modem_operating_configuration(CELLULAR_MODEM_SET_LOW_POWER_MODE);
+                UT_ASSERT_EQUAL(result, RETURN_OK);
+                pSamples[0][i] = cycle_settle(DEVICE_NAS_STATUS_NOT_REGISTERED, 0, down, timeout_ms);
+                up = cellular_bench_now_ns();
+                result = (cycle == 0) ? cellular_hal_set_modem_network_attach() :
+                                        cellular_hal_set_modem_operating_configuration(CELLULAR_MODEM_SET_ONLINE);
+                UT_ASSERT_EQUAL(result, RETURN_OK);
+                pSamples[1][i] = cycle_settle(DEVICE_NAS_STATUS_REGISTERED, 1, up, timeout_ms);
+                if ((pSamples[0][i] == 0) || (pSamples[1][i] == 0))
+                {
+                    UT_LOG_ERROR("%s cycle %u did not settle in %u ms", cycles[cycle], i, timeout_ms);
+                    UT_FAIL("transition did not settle");
+                    failed = 1;
+                }
+            }
+            ns = cellular_bench_now_ns() - start;
+        }
+        if (failed)
+        {
+            break;
+        }
+        rate = (double)count * 1e9 / (double)ns;
+        UT_LOG_INFO("%u %s cycles, %.2f per second", count, cycles[cycle], rate);
+        cellular_metrics_set("power_cycles_per_second", "Full down and up cycles until settled, back to back", cycles[cycle], rate);
+        latency_report("power_cycle_transition_seconds", "Call until registration and interface status settle", transitions[cycle][0],
+                       pSamples[0], count);
+        latency_report("power_cycle_transition_seconds", "Call until registration and interface status settle", transitions[cycle][1],
+                       pSamples[1], count);
+    }
+
+    UT_ASSERT_EQUAL(cellular_hal_stop_network(CELLULAR_NETWORK_IP_FAMILY_IPV4), RETURN_OK);
+    if (cellular_sim_available())
+    {
+        cellular_sim_reset();
+    }
+    free(pSamples[0]);
+    free(pSamples[1]);
+    UT_LOG_INFO("Out %s\n", __FUNCTION__);
+}
+
+#define RESET_STAGES 5
+
+static int gDeviceOpen = -1;
+
+static int device_open_status_cb(char *device_name, char *wan_ifname, CellularDeviceOpenStatus_t device_open_status,
+                                 CellularModemOperatingConfiguration_t modem_operating_config)
+{
+    (void)device_name;
+    (void)wan_ifname;
+    (void)modem_operating_config;
+    pthread_mutex_lock(&gCallbackLock);
+    gDeviceOpen = (int)device_open_status;
+    pthread_cond_broadcast(&gCallbackCond);
+    pthread_mutex_unlock(&gCallbackLock);
+    return RETURN_OK;
+}
+
+/* Waits until cellular_hal_IsModemDevicePresent reports 'present'; returns the ns since 'start', 0 on timeout */
+static uint64_t reset_wait_present(unsigned int present, uint64_t start, unsigned int timeout_ms)
+{
+    uint64_t deadline = start + (uint64_t)timeout_ms * 1000000ULL;
+
+    while ((cellular_hal_IsModemDevicePresent() != 0) != (present != 0))
+    {
+        if (cellular_bench_now_ns() >= deadline)
+        {
+            return 0;
+        }
+        cellular_bench_sleep_ms(1);
+    }
+    return cellular_bench_now_ns() - start;
+}
+
+/* Invokes cellular_hal_select_device_slot; returns the slot reported ready, -1 on timeout */
+static int select_slot(unsigned int timeout_ms)
+{
+    unsigned int waited;
+    int slot = -1;
+
+    pthread_mutex_lock(&gCallbackLock);
+    gSlotReady = -1;
+    pthread_mutex_unlock(&gCallbackLock);
+    if (cellular_hal_select_device_slot(uicc_slot_status_cb) != RETURN_OK)
+    {
+        return -1;
+    }
+    for (waited = 0; (waited < timeout_ms) && (slot < 0); waited++)
+    {
+        cellular_bench_sleep_ms(1);
+        pthread_mutex_lock(&gCallbackLock);
+        slot = gSlotReady;
+        pthread_mutex_unlock(&gCallbackLock);
+    }
+    return slot;
+}
+
+/* Brings the modem back the way a connection manager does, filling the ns since 'start' at which each stage was reached; returns the stages reached */
+static unsigned int reset_recover(int slot, uint64_t start, unsigned int timeout_ms, uint64_t *pStages)
+{
+    CellularDeviceContextCBStruct device;
+    CellularNetworkCBStruct callbacks;
+
+    memset(&device, 0, sizeof(device));
+    device.device_open_status_cb = device_open_status_cb;
+    memset(&callbacks, 0, sizeof(callbacks));
+    pthread_mutex_lock(&gCallbackLock);
+    gDeviceOpen = -1;
+    gSlotReady = -1;
+    pthread_mutex_unlock(&gCallbackLock);
+
+    if ((pStages[0] = reset_wait_present(1, start, timeout_ms)) == 0)
+    {
+        return 0;
+    }
+    if ((cellular_hal_open_device(&device) != RETURN_OK) ||
+        ((pStages[1] = callback_wait(&gDeviceOpen, DEVICE_OPEN_STATUS_READY, start, timeout_ms)) == 0))
+    {
+        return 1;
+    }
+    if ((cellular_hal_select_device_slot(uicc_slot_status_cb) != RETURN_OK) ||
+        ((pStages[2] = callback_wait(&gSlotReady, slot, start, timeout_ms)) == 0))
+    {
+        return 2;
+    }
+    if ((cellular_hal_monitor_device_registration(registration_status_cb) != RETURN_OK) ||
+        ((pStages[3] = callback_wait(&gRegistration, DEVICE_NAS_STATUS_REGISTERED, start, timeout_ms)) == 0))
+    {
+        return 3;
+    }
+    if ((cellular_hal_start_network(CELLULAR_NETWORK_IP_FAMILY_IPV4, NULL, &callbacks) != RETURN_OK) ||
+        ((pStages[4] = cycle_settle(DEVICE_NAS_STATUS_REGISTERED, 1, start, timeout_ms)) == 0))
+    {
+        return 4;
+    }
+    return RESET_STAGES;
+}
+
+/**
+ * @brief Outage of cellular_hal_modem_reset, and optionally cellular_hal_modem_factory_reset, by recovery stage
+ *
+ * **Test Group ID:** Module: 02 @n
+ * **Test Case ID:** 025 @n
+ * **Priority:** Low @n@n
+ *
+ * **Pre-Conditions:** Modem registered @n
+ * **Dependencies:** None @n
+ * **User Interaction:** If user chose to run the test in interactive mode, then the test case has to be selected via console. @n
+ *
+ * **Test Procedure:** @n
+ * | Variation / Step | Description | Test Data | Expected Result | Notes |
+ * | :----: | :---------: | :----------: | :--------------: | :-----: |
+ * | 01 | Invoke cellular_hal_start_network and wait until the interface is up | IPv4, default profile | RETURN_OK | Should be successful |
+ * | 02 | Invoke cellular_hal_modem_reset and wait until cellular_hal_IsModemDevicePresent reports the modem gone and back | cellular.bench.reset.cycles, timeout_ms | RETURN_OK | Should be successful |
+ * | 03 | Invoke cellular_hal_open_device, cellular_hal_select_device_slot, cellular_hal_monitor_device_registration and cellular_hal_start_network in turn, each until its callback or the interface status says so | None | open, slot ready, registered, interface up | Should be successful |
+ * | 04 | Repeat 02 and 03 with cellular_hal_modem_factory_reset when enabled | cellular.bench.reset.factory | As above | Only when the profile enables it, it wipes the modem's profiles |
+ * | 05 | Publish the median, 99th percentile and maximum time to every stage | None | None | Should be successful |
+ */
+void test_l2_cellular_hal_reset_recovery(void)
+{
+    gTestID = 25;
+    UT_LOG_INFO("In %s [%02d%03d]\n", __FUNCTION__, gTestGroup, gTestID);
+
+    unsigned int cycles = bench_config("cellular.bench.reset.cycles", 10);
+    unsigned int timeout_ms = bench_config("cellular.bench.reset.timeout_ms", 60000);
+    unsigned int factory = UT_KVP_PROFILE_GET_UINT32("cellular.bench.reset.factory");
+    static const char *resets[] = { "modem_reset", "factory_reset" };
+    static const char *stages[RESET_STAGES] = { "present", "open", "sim_ready", "registered", "data_up" };
+    CellularCurrentPlmnInfoStruct plmn;
+    CellularNetworkCBStruct callbacks;
+    uint64_t *pSamples[RESET_STAGES];
+    uint64_t times[RESET_STAGES];
+    uint64_t start;
+    unsigned int kind, cycle, stage, reached, pass;
+    char variant[40];
+    int slot;
+    int failed = 0;
+
+    cycles = (cycles > CYCLE_MAX_COUNT) ? CYCLE_MAX_COUNT : cycles;
+    for (stage = 0; stage < RESET_STAGES; stage++)
+    {
+        pSamples[stage] = calloc(cycles, sizeof(uint64_t));
+        failed |= (pSamples[stage] == NULL);
+    }
+    if (cellular_sim_available())
+    {
+        cellular_sim_reset();
+    }
+    memset(&callbacks, 0, sizeof(callbacks));
+    memset(&plmn, 0, sizeof(plmn));
+    cellular_hal_get_current_plmn_information(&plmn);
+    pthread_mutex_lock(&gCallbackLock);
+    gRegistration = plmn.registration_status;
+    pthread_mutex_unlock(&gCallbackLock);
+    /* The slot the modem comes back on */
+    slot = select_slot(timeout_ms);
+    UT_ASSERT_EQUAL(cellular_hal_monitor_device_registration(registration_status_cb), RETURN_OK);
+    UT_ASSERT_EQUAL(cellular_hal_start_network(CELLULAR_NETWORK_IP_FAMILY_IPV4, NULL, &callbacks), RETURN_OK);
+    if (failed || (slot < 0) || (cycle_settle(DEVICE_NAS_STATUS_REGISTERED, 1, cellular_bench_now_ns(), timeout_ms) == 0))
+    {
+        UT_FAIL("no slot ready or the session did not come up");
+        failed = 1;
+    }
+
+    for (kind = 0; (kind < ((factory != 0) ? 2 : 1)) && !failed; kind++)
+    {
+        /* The passes before the last are warm-up */
+        for (pass = 0; (pass <= cellular_run_warmup()) && !failed; pass++)
+        {
+            for (cycle = 0; (cycle < cycles) && !failed; cycle++)
+            {
+                memset(times, 0, sizeof(times));
+                pthread_mutex_lock(&gCallbackLock);
+                gRegistration = DEVICE_NAS_STATUS_NOT_REGISTERED;
+                pthread_mutex_unlock(&gCallbackLock);
+                start = cellular_bench_now_ns();
+                UT_ASSERT_EQUAL((kind == 0) ? cellular_hal_modem_reset() : cellular_hal_modem_factory_reset(), RETURN_OK);
+                /* The modem has to go away first, or the old instance would pass for the restarted one */
+                if (reset_wait_present(0, start, timeout_ms) == 0)
+                {
+                    UT_LOG_ERROR("%s: the modem stayed present", resets[kind]);
+                    UT_FAIL("modem did not reset");
+                    failed = 1;
+                    break;
+                }
+                reached = reset_recover(slot, start, timeout_ms, times);
+                if (reached < RESET_STAGES)
+                {
+                    UT_LOG_ERROR("%s cycle %u: not %s within %u ms", resets[kind], cycle, stages[reached], timeout_ms);
+                    UT_FAIL("modem did not recover");
+                    failed = 1;
+                    break;
+                }
+                for (stage = 0; stage < RESET_STAGES; stage++)
+                {
+                    pSamples[stage][cycle] = times[stage];
+                }
+            }
+        }
+        for (stage = 0; (stage < RESET_STAGES) && !failed; stage++)
+        {
+            snprintf(variant, sizeof(variant), "%s,%s", resets[kind], stages[stage]);
+            latency_report("reset_recovery_seconds", "Modem reset until the stage is reached", variant, pSamples[stage], cycles);
+        }
+    }
+
+    UT_ASSERT_EQUAL(cellular_hal_stop_network(CELLULAR_NETWORK_IP_FAMILY_IPV4), RETURN_OK);
+    if (cellular_sim_available())
+    {
+        cellular_sim_reset();
+    }
+    for (stage = 0; stage < RESET_STAGES; stage++)
+    {
+        free(pSamples[stage]);
+    }
+    UT_LOG_INFO("Out %s\n", __FUNCTION__);
+}
+
+/* Waits until cellular_hal_get_active_card_status and cellular_hal_get_uicc_slot_info both show the card on or off; returns the ns since 'start', 0 on timeout or a card in error after switching on */
+static uint64_t sim_power_settle(unsigned int slot, unsigned char enable, uint64_t start, unsigned int timeout_ms)
+{
+    CellularUICCSlotInfoStruct info;
+    CellularUICCStatus_t status;
+    uint64_t deadline = start + (uint64_t)timeout_ms * 1000000ULL;
+
+    for (;;)
+    {
+        status = CELLULAR_UICC_STATUS_EMPTY;
+        memset(&info, 0, sizeof(info));
+        cellular_hal_get_active_card_status(&status);
+        cellular_hal_get_uicc_slot_info(slot, &info);
+        if (enable && info.CardEnable && ((status == CELLULAR_UICC_STATUS_ERROR) || (info.Status == CELLULAR_UICC_STATUS_ERROR)))
+        {
+            return 0;
+        }
+        if (enable ? ((status == CELLULAR_UICC_STATUS_VALID) && info.CardEnable) : ((status == CELLULAR_UICC_STATUS_EMPTY) && !info.CardEnable))
+        {
+            return cellular_bench_now_ns() - start;
+        }
+        if (cellular_bench_now_ns() >= deadline)
+        {
+            return 0;
+        }
+        cellular_bench_sleep_ms(1);
+    }
+}
+
+/**
+ * @brief Time for a SIM power toggle to show, and the fastest toggling the card takes without going into error
+ *
+ * **Test Group ID:** Module: 02 @n
+ * **Test Case ID:** 026 @n
+ * **Priority:** Low @n@n
+ *
+ * **Pre-Conditions:** A valid card in the active slot @n
+ * **Dependencies:** None @n
+ * **User Interaction:** If user chose to run the test in interactive mode, then the test case has to be selected via console. @n
+ *
+ * **Test Procedure:** @n
+ * | Variation / Step | Description | Test Data | Expected Result | Notes |
+ * | :----: | :---------: | :----------: | :--------------: | :-----: |
+ * | 01 | On the simulator, make a card take its configured time to switch | cellular.bench.sim_power.sim_delay_ms | 0 | Simulator only |
+ * | 02 | Invoke cellular_hal_sim_power_enable off and on for the active slot, each until cellular_hal_get_active_card_status and cellular_hal_get_uicc_slot_info show it | cellular.bench.sim_power.toggles, timeout_ms | RETURN_OK, EMPTY and disabled, then VALID and enabled | Should be successful |
+ * | 03 | Publish the median, 99th percentile and maximum time of each direction and the settled toggles per second | None | None | Should be successful |
+ * | 04 | Toggle at fixed intervals from twice the slowest switch down, shortening them by a quarter until the card ends in error | cellular.bench.sim_power.sweep_toggles | RETURN_OK | Should be successful |
+ * | 05 | Power the card off and on, each until settled, after an interval which left it in error | None | VALID | Should be successful |
+ * | 06 | Publish the toggles per second of the shortest interval the card took | None | None | Should be successful |
+ */
+void test_l2_cellular_hal_sim_power(void)
+{
+    gTestID = 26;
+    UT_LOG_INFO("In %s [%02d%03d]\n", __FUNCTION__, gTestGroup, gTestID);
+
+    unsigned int toggles = bench_config("cellular.bench.sim_power.toggles", 20);
+    unsigned int sweep = bench_config("cellular.bench.sim_power.sweep_toggles", 6);
+    unsigned int timeout_ms = bench_config("cellular.bench.sim_power.timeout_ms", 10000);
+    uint32_t simDelay = bench_config("cellular.bench.sim_power.sim_delay_ms", 25);
+    CellularSimConfig_t original;
+    CellularSimConfig_t config;
+    uint64_t *pOff;
+    uint64_t *pOn;
+    uint64_t start, slowest, ns = 0;
+    unsigned int i, pass, interval_ms, settle_ms, safe_ms = 0, unsafe_ms = 0;
+    double rate;
+    int slot;
+    int failed = 0;
+
+    toggles = (toggles > CYCLE_MAX_COUNT) ? CYCLE_MAX_COUNT : toggles;
+    pOff = calloc(toggles, sizeof(uint64_t));
+    pOn = calloc(toggles, sizeof(uint64_t));
+    if ((pOff == NULL) || (pOn == NULL))
+    {
+        UT_FAIL("out of memory");
+        free(pOff);
+        free(pOn);
+        return;
+    }
+    if (cellular_sim_available())
+    {
+        cellular_sim_get_config(&original);
+        config = original;
+        config.sim_power_delay_ms = simDelay;
+        UT_ASSERT_EQUAL(cellular_sim_configure(&config), 0);
+    }
+    slot = select_slot(timeout_ms);
+    if (slot < 0)
+    {
+        UT_FAIL("no slot ready");
+        failed = 1;
+    }
+
+    /* The passes before the last are warm-up */
+    for (pass = 0; (pass <= cellular_run_warmup()) && !failed; pass++)
+    {
+        start = cellular_bench_now_ns();
+        for (i = 0; (i < toggles) && !failed; i++)
+        {
+            UT_ASSERT_EQUAL(cellular_hal_sim_power_enable((unsigned int)slot, 0), RETURN_OK);
+            pOff[i] = sim_power_settle((unsigned int)slot, 0, cellular_bench_now_ns(), timeout_ms);
+            UT_ASSERT_EQUAL(cellular_hal_sim_power_enable((unsigned int)slot, 1), RETURN_OK);
+            pOn[i] = sim_power_settle((unsigned int)slot, 1, cellular_bench_now_ns(), timeout_ms);
+            if ((pOff[i] == 0) || (pOn[i] == 0))
+            {
+                UT_LOG_ERROR("toggle %u did not settle in %u ms", i, timeout_ms);
+                UT_FAIL("card did not settle");
+                failed = 1;
+            }
+        }
+        ns = cellular_bench_now_ns() - start;
+    }
+    if (!failed)
+    {
+        rate = 2.0 * (double)toggles * 1e9 / (double)ns;
+        UT_LOG_INFO("%u settled toggles, %.1f per second", 2 * toggles, rate);
+        cellular_metrics_set("sim_power_settled_toggles_per_second", "cellular_hal_sim_power_enable calls per second, each waiting until shown", NULL, rate);
+        latency_report("sim_power_settle_seconds", "cellular_hal_sim_power_enable until card status and slot info show it", "off", pOff, toggles);
+        latency_report("sim_power_settle_seconds", "cellular_hal_sim_power_enable until card status and slot info show it", "on", pOn, toggles);
+        if (cellular_sim_available())
+        {
+            UT_ASSERT_TRUE(cellular_bench_percentile(pOn, toggles, 100) >= (uint64_t)simDelay * 1000000ULL);
+        }
+    }
+
+    /* Shorter and shorter intervals until the card cannot keep up */
+    slowest = cellular_bench_percentile(pOff, toggles, 100);
+    slowest = (cellular_bench_percentile(pOn, toggles, 100) > slowest) ? cellular_bench_percentile(pOn, toggles, 100) : slowest;
+    settle_ms = (unsigned int)((slowest + 999999ULL) / 1000000ULL);
+    for (interval_ms = 2 * ((settle_ms > 0) ? settle_ms : 1); (interval_ms > 0) && !failed && (unsafe_ms == 0);
+         interval_ms = (interval_ms * 3 / 4 < interval_ms) ? interval_ms * 3 / 4 : interval_ms - 1)
+    {
+        for (i = 0; i < sweep; i++)
+        {
+            UT_ASSERT_EQUAL(cellular_hal_sim_power_enable((unsigned int)slot, 0), RETURN_OK);
+            cellular_bench_sleep_ms(interval_ms);
+            UT_ASSERT_EQUAL(cellular_hal_sim_power_enable((unsigned int)slot, 1), RETURN_OK);
+            cellular_bench_sleep_ms(interval_ms);
+        }
+        if (sim_power_settle((unsigned int)slot, 1, cellular_bench_now_ns(), timeout_ms) > 0)
+        {
+            safe_ms = interval_ms;
+            continue;
+        }
+        UT_LOG_INFO("Toggling every %u ms left the card in error", interval_ms);
+        unsafe_ms = interval_ms;
+        UT_ASSERT_EQUAL(cellular_hal_sim_power_enable((unsigned int)slot, 0), RETURN_OK);
+        sim_power_settle((unsigned int)slot, 0, cellular_bench_now_ns(), timeout_ms);
+        UT_ASSERT_EQUAL(cellular_hal_sim_power_enable((unsigned int)slot, 1), RETURN_OK);
+        if (sim_power_settle((unsigned int)slot, 1, cellular_bench_now_ns(), timeout_ms) == 0)
+        {
+            UT_FAIL("card did not recover from the error");
+            failed = 1;
+        }
+    }
+    if (!failed && (safe_ms > 0))
+    {
+        UT_LOG_INFO("Toggles every %u ms are safe, %.1f per second%s", safe_ms, 1000.0 / (double)safe_ms,
+                    (unsafe_ms == 0) ? ", and no shorter interval made the card fail" : "");
+        cellular_metrics_set("sim_power_max_safe_toggles_per_second", "Fastest cellular_hal_sim_power_enable toggling the card took without error", NULL,
+                             1000.0 / (double)safe_ms);
+    }
+    if (cellular_sim_available())
+    {
+        /* Toggling faster than the card switches has to be caught */
+        UT_ASSERT_TRUE((unsafe_ms > 0) && (safe_ms > unsafe_ms));
+        cellular_sim_configure(&original);
+    }
+    free(pOff);
+    free(pOn);
+    UT_LOG_INFO("Out %s\n", __FUNCTION__);
+}
+
+/* Waits for a child forked by a test, killing it after timeout_ms; returns its exit status, -1 when it was killed or died of a signal */
+static int child_wait(pid_t pid, unsigned int timeout_ms)
+{
+    uint64_t deadline = cellular_bench_now_ns() + (uint64_t)timeout_ms * 1000000ULL;
+    int status = 0;
+    pid_t got;
+
+    while ((got = waitpid(pid, &status, WNOHANG)) == 0)
+    {
+        if (cellular_bench_now_ns() >= deadline)
+        {
+            UT_LOG_ERROR("Child %d still running after %u ms, killed", (int)pid, timeout_ms);
+            kill(pid, SIGKILL);
+            while ((waitpid(pid, &status, 0) < 0) && (errno == EINTR))
+            {
+            }
+            return -1;
+        }
+        cellular_bench_sleep_ms(10);
+    }
+    if ((got < 0) || !WIFEXITED(status))
+    {
+        return -1;
+    }
+    return WEXITSTATUS(status);
+}
+
+static volatile int gAfterAbandonRan = 0;
+
+/* Blocks in a cellular_hal_get_device_imei scope, taking the simulator and logger locks over and over, until it is abandoned */
+static void watchdog_hang_test(void)
+{
+    CellularSimConfig_t config;
+
+    cellular_trace_call_begin(CELLULAR_HAL_API_get_device_imei);
+    for (;;)
+    {
+        if (cellular_sim_available())
+        {
+            cellular_sim_get_config(&config);
+        }
+        cellular_log_flush();
+    }
+}
+
+/* Runs after the abandoned test, taking the same locks */
+static void watchdog_after_test(void)
+{
+    CellularSimConfig_t config;
+
+    if (cellular_sim_available())
+    {
+        cellular_sim_get_config(&config);
+    }
+    UT_LOG_INFO("Test after the abandoned one runs");
+    cellular_log_flush();
+    gAfterAbandonRan = 1;
+}
+
+/* Child of test 027; returns the first check which failed, 0 when all passed */
+static int watchdog_abandon_child(void)
+{
+    UT_TestFunction_t pHang = cellular_trace_wrap_test("l2_cellular_hal_watchdog_hang", watchdog_hang_test);
+    UT_TestFunction_t pAfter = cellular_trace_wrap_test("l2_cellular_hal_watchdog_after", watchdog_after_test);
+    unsigned int failures = CU_get_number_of_failure_records();
+    CellularWatchdogHang_t hang;
+    unsigned int hangs;
+
+    prctl(PR_SET_PDEATHSIG, SIGKILL, 0, 0, 0);
+    if ((pHang == watchdog_hang_test) || (pAfter == watchdog_after_test))
+    {
+        return 1;
+    }
+    /* In this process, also when the run uses the fork server */
+    cellular_trace_set_runner(NULL);
+    cellular_trace_set_abandon(NULL);
+    if ((cellular_watchdog_start(0, CELLULAR_WATCHDOG_SKIP) != RETURN_OK) ||
+        (cellular_watchdog_set_api_deadline(CELLULAR_HAL_API_get_device_imei, 100) != RETURN_OK))
+    {
+        return 2;
+    }
+    pHang();
+    pAfter();
+    hangs = cellular_watchdog_get_hangs(&hang, 1);
+    cellular_watchdog_stop();
+    if (CU_get_number_of_failure_records() != failures + 1)
+    {
+        return 3;
+    }
+    if ((hangs != 1) || !hang.abandoned || (hang.api != CELLULAR_HAL_API_get_device_imei))
+    {
+        return 4;
+    }
+    return gAfterAbandonRan ? 0 : 5;
+}
+
+/**
+ * @brief Check a test blocked in a HAL call is abandoned and the test after it runs
+ *
+ * **Test Group ID:** Module: 02 @n
+ * **Test Case ID:** 027 @n
+ * **Priority:** Low @n@n
+ *
+ * **Pre-Conditions:** None @n
+ * **Dependencies:** None @n
+ * **User Interaction:** If user chose to run the test in interactive mode, then the test case has to be selected via console. @n
+ *
+ * **Test Procedure:** @n
+ * | Variation / Step | Description | Test Data | Expected Result | Notes |
+ * | :----: | :---------: | :----------: | :--------------: | :-----: |
+ * | 01 | In a forked child, start the watchdog with a deadline for cellular_hal_get_device_imei | 100 ms | RETURN_OK | Should be successful |
+ * | 02 | Run a wrapped test which blocks in a cellular_hal_get_device_imei scope, taking the simulator and logger locks over and over | None | the test failed once, one hang reported as abandoned | Should be successful |
+ * | 03 | Run a wrapped test after it which takes the same locks and logs | None | the test returns | Should be successful |
+ * | 04 | Wait for the child | 30 s | exit status 0 | Should be successful |
+ *
+ * The child keeps the failure of the abandoned test out of this run.
+ */
+void test_l2_cellular_hal_watchdog_abandon(void)
+{
+    gTestID = 27;
+    UT_LOG_INFO("In %s [%02d%03d]\n", __FUNCTION__, gTestGroup, gTestID);
+
+    pid_t pid;
+    int status;
+
+    /* Nothing buffered may reach the output twice */
+    cellular_log_flush();
+    fflush(NULL);
+    pid = fork();
+    if (pid == 0)
+    {
+        status = watchdog_abandon_child();
+        cellular_log_flush();
+        fflush(NULL);
+        _exit(status);
+    }
+    if (pid < 0)
+    {
+        UT_FAIL("fork failed");
+        return;
+    }
+    status = child_wait(pid, 30000);
+    if (status != 0)
+    {
+        UT_LOG_ERROR("Abandon child failed check %d", status);
+    }
+    UT_ASSERT_EQUAL(status, 0);
+
+    UT_LOG_INFO("Out %s\n", __FUNCTION__);
+}
+
+#define FORK_SERVER_RESULT 42.0
+
+/* Fails once, sets a result and stops at a fatal failure; the failure after it must not be reached */
+static void fork_failing_test(void)
+{
+    UT_FAIL("forked failure");
+    cellular_metrics_set("fork_server_result", "Result set in a forked child", "replayed", FORK_SERVER_RESULT);
+    UT_FAIL_FATAL("forked fatal failure");
+    UT_FAIL("past the fatal failure");
+}
+
+/* Dies before the test returns */
+static void fork_crashing_test(void)
+{
+    raise(SIGSEGV);
+    UT_FAIL("survived SIGSEGV");
+}
+
+/* Returns the condition of the failure 'back' records from the end of the failure list, which contains the assertion message; NULL when there are fewer */
+static const char *failure_condition(unsigned int back)
+{
+    unsigned int count = CU_get_number_of_failure_records();
+    CU_pFailureRecord pFailure = CU_get_failure_list();
+    unsigned int i;
+
+    if (back >= count)
+    {
+        return NULL;
+    }
+    for (i = 0; (pFailure != NULL) && (i < count - 1 - back); i++)
+    {
+        pFailure = pFailure->pNext;
+    }
+    return (pFailure != NULL) ? pFailure->strCondition : NULL;
+}
+
+/* Child of test 028; returns the first check which failed, 0 when all passed */
+static int fork_server_child(void)
+{
+    UT_TestFunction_t pFailing = cellular_trace_wrap_test("l2_cellular_hal_fork_failing", fork_failing_test);
+    UT_TestFunction_t pCrashing = cellular_trace_wrap_test("l2_cellular_hal_fork_crashing", fork_crashing_test);
+    unsigned int failures = CU_get_number_of_failure_records();
+    const char *pName, *pHelp, *pVariant, *pCondition;
+    CellularForkStats_t before, after;
+    double value = 0.0;
+    unsigned int i;
+
+    prctl(PR_SET_PDEATHSIG, SIGKILL, 0, 0, 0);
+    if ((pFailing == fork_failing_test) || (pCrashing == fork_crashing_test))
+    {
+        return 1;
+    }
+    cellular_fork_start();
+    cellular_fork_get_stats(&before);
+
+    /* Both failures replayed with their condition, nothing after the fatal one */
+    pFailing();
+    if (CU_get_number_of_failure_records() != failures + 2)
+    {
+        return 2;
+    }
+    pCondition = failure_condition(1);
+    if ((pCondition == NULL) || (strstr(pCondition, "forked failure") == NULL))
+    {
+        return 3;
+    }
+    pCondition = failure_condition(0);
+    if ((pCondition == NULL) || (strstr(pCondition, "forked fatal failure") == NULL))
+    {
+        return 4;
+    }
+    for (i = 0; cellular_metrics_get_result(i, &pName, &pHelp, &pVariant, &value) == RETURN_OK; i++)
+    {
+        if ((strcmp(pName, "fork_server_result") == 0) && (pVariant != NULL) && (strcmp(pVariant, "replayed") == 0))
+        {
+            break;
+        }
+    }
+    if ((cellular_metrics_get_result(i, &pName, &pHelp, &pVariant, &value) != RETURN_OK) || (value != FORK_SERVER_RESULT))
+    {
+        return 5;
+    }
+
+    /* The dead child fails its test */
+    pCrashing();
+    if (CU_get_number_of_failure_records() != failures + 3)
+    {
+        return 6;
+    }
+    cellular_fork_get_stats(&after);
+    if ((after.tests - before.tests != 2) || (after.lost - before.lost != 1))
+    {
+        return 7;
+    }
+    return 0;
+}
+
+/**
+ * @brief Check the fork server carries the failures, fatal failures, results and death of a forked test back
+ *
+ * **Test Group ID:** Module: 02 @n
+ * **Test Case ID:** 028 @n
+ * **Priority:** Low @n@n
+ *
+ * **Pre-Conditions:** None @n
+ * **Dependencies:** None @n
+ * **User Interaction:** If user chose to run the test in interactive mode, then the test case has to be selected via console. @n
+ *
+ * **Test Procedure:** @n
+ * | Variation / Step | Description | Test Data | Expected Result | Notes |
+ * | :----: | :---------: | :----------: | :--------------: | :-----: |
+ * | 01 | In a forked child, start the fork server | None | RETURN_OK | Should be successful |
+ * | 02 | Run a wrapped test which fails, sets a result and fails fatally before a third failure | None | the first two failures replayed with their conditions, the result set | Should be successful |
+ * | 03 | Run a wrapped test which raises SIGSEGV | None | the test failed, one more child lost of two tests forked | Should be successful |
+ * | 04 | Wait for the child | 120 s | exit status 0 | Should be successful |
+ *
+ * The child keeps the replayed failures out of this run. The first fork also times a re-initialization.
+ */
+void test_l2_cellular_hal_fork_server(void)
+{
+    gTestID = 28;
+    UT_LOG_INFO("In %s [%02d%03d]\n", __FUNCTION__, gTestGroup, gTestID);
+
+    pid_t pid;
+    int status;
+
+    /* Nothing buffered may reach the output twice */
+    cellular_log_flush();
+    fflush(NULL);
+    pid = fork();
+    if (pid == 0)
+    {
+        status = fork_server_child();
+        cellular_log_flush();
+        fflush(NULL);
+        _exit(status);
+    }
+    if (pid < 0)
+    {
+        UT_FAIL("fork failed");
+        return;
+    }
+    status = child_wait(pid, 120000);
+    if (status != 0)
+    {
+        UT_LOG_ERROR("Fork server child failed check %d", status);
+    }
+    UT_ASSERT_EQUAL(status, 0);
+
+    UT_LOG_INFO("Out %s\n", __FUNCTION__);
+}
+
+static UT_test_suite_t *pSuite = NULL;
+
+/* Writes out the queued log lines before ut-core prints the suite results */
+static int teardown_cellular_hal_l2(void)
+{
+    cellular_log_flush();
+    return 0;
+}
+
+/**
+ * @brief Register the L2 tests for this module
+ *
+ * @return int - 0 on success, otherwise failure
+ */
+int test_cellular_hal_l2_register(void)
+{
+    pSuite = UT_add_suite("[L2_cellular_hal]", NULL, teardown_cellular_hal_l2);
+    if (pSuite == NULL)
+    {
+        return -1;
+    }
+    cellular_trace_set_test_id(&gTestGroup, &gTestID);
+
+    UT_add_test(pSuite, "l2_cellular_hal_delta_notification", test_l2_cellular_hal_delta_notification);
+    UT_add_test(pSuite, "l2_cellular_hal_delta_benchmark", test_l2_cellular_hal_delta_benchmark);
+    UT_add_test(pSuite, "l2_cellular_hal_scan_index_merge", test_l2_cellular_hal_scan_index_merge);
+    UT_add_test(pSuite, "l2_cellular_hal_scan_index_benchmark", test_l2_cellular_hal_scan_index_benchmark);
+    UT_add_test(pSuite, "l2_cellular_hal_profile_store_persistence", test_l2_cellular_hal_profile_store_persistence);
+    UT_add_test(pSuite, "l2_cellular_hal_profile_store_sync", test_l2_cellular_hal_profile_store_sync);
+    UT_add_test(pSuite, "l2_cellular_hal_profile_compiler", test_l2_cellular_hal_profile_compiler);
+    UT_add_test(pSuite, "l2_cellular_hal_profile_matrix", test_l2_cellular_hal_profile_matrix);
+    UT_add_test(pSuite, "l2_cellular_hal_log_benchmark", test_l2_cellular_hal_log_benchmark);
+    UT_add_test(pSuite, "l2_cellular_hal_perf_counters", test_l2_cellular_hal_perf_counters);
+    UT_add_test(pSuite, "l2_cellular_hal_syscall_profile", test_l2_cellular_hal_syscall_profile);
+    UT_add_test(pSuite, "l2_cellular_hal_census", test_l2_cellular_hal_census);
+    UT_add_test(pSuite, "l2_cellular_hal_lock_contention", test_l2_cellular_hal_lock_contention);
+    UT_add_test(pSuite, "l2_cellular_hal_metrics_export", test_l2_cellular_hal_metrics_export);
+    UT_add_test(pSuite, "l2_cellular_hal_sampling_profiler", test_l2_cellular_hal_sampling_profiler);
+    UT_add_test(pSuite, "l2_cellular_hal_watchdog", test_l2_cellular_hal_watchdog);
+    UT_add_test(pSuite, "l2_cellular_hal_fuzz_inputs", test_l2_cellular_hal_fuzz_inputs);
+    UT_add_test(pSuite, "l2_cellular_hal_at_round_trip", test_l2_cellular_hal_at_round_trip);
+    UT_add_test(pSuite, "l2_cellular_hal_transport_benchmark", test_l2_cellular_hal_transport_benchmark);
+    UT_add_test(pSuite, "l2_cellular_hal_data_plane", test_l2_cellular_hal_data_plane);
+    UT_add_test(pSuite, "l2_cellular_hal_uicc_slots", test_l2_cellular_hal_uicc_slots);
+    UT_add_test(pSuite, "l2_cellular_hal_channel_model", test_l2_cellular_hal_channel_model);
+    UT_add_test(pSuite, "l2_cellular_hal_rat_switch", test_l2_cellular_hal_rat_switch);
+    UT_add_test(pSuite, "l2_cellular_hal_power_cycles", test_l2_cellular_hal_power_cycles);
+    UT_add_test(pSuite, "l2_cellular_hal_reset_recovery", test_l2_cellular_hal_reset_recovery);
+    UT_add_test(pSuite, "l2_cellular_hal_sim_power", test_l2_cellular_hal_sim_power);
+    UT_add_test(pSuite, "l2_cellular_hal_watchdog_abandon", test_l2_cellular_hal_watchdog_abandon);
+    UT_add_test(pSuite, "l2_cellular_hal_fork_server", test_l2_cellular_hal_fork_server);
+
+    return 0;
+}
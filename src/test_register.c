@@ -19,11 +19,15 @@
 /* L1 Testing Functions */
 extern int test_cellular_hal_l1_register(void);
 
+/* L2 Testing Functions */
+extern int test_cellular_hal_l2_register(void);
+
 int register_hal_l1_tests( void )
 {
     int registerFailed=0;
 
     registerFailed |= test_cellular_hal_l1_register();
+    registerFailed |= test_cellular_hal_l2_register();
 
     return registerFailed;
 }
\ No newline at end of file